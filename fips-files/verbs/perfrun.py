@@ -0,0 +1,123 @@
+"""fips verb to run the headless samples for perf and render-regression tests"""
+
+import os
+import json
+import glob
+import subprocess
+
+from mod import log, util, project
+
+# number of frames each sample runs
+NumFrames = 300
+
+# build configuration
+def get_build_config():
+    p = util.get_host_platform()
+    if p == 'osx':
+        return 'sapp-metal-osx-ninja-release'
+    elif p == 'win':
+        return 'sapp-d3d11-win64-vstudio-release'
+    else:
+        return 'sapp-linux-ninja-release'
+
+#-------------------------------------------------------------------------------
+def get_results_dir(fips_dir, name):
+    proj_build_dir = util.get_deploy_root_dir(fips_dir, 'sokol-samples')
+    return '{}/sokol-perfrun/{}'.format(proj_build_dir, name)
+
+#-------------------------------------------------------------------------------
+def run_samples(fips_dir, proj_dir, name, num_frames):
+    build_config = get_build_config()
+    project.gen(fips_dir, proj_dir, build_config)
+    project.build(fips_dir, proj_dir, build_config)
+
+    deploy_dir = util.get_deploy_dir(fips_dir, 'sokol-samples', build_config)
+    results_dir = get_results_dir(fips_dir, name)
+    if not os.path.isdir(results_dir):
+        os.makedirs(results_dir)
+    exe_ext = '.exe' if util.get_host_platform() == 'win' else ''
+    exes = sorted(glob.glob('{}/*-headless{}'.format(deploy_dir, exe_ext)))
+    if len(exes) == 0:
+        log.error("No headless samples found in '{}'".format(deploy_dir))
+    for exe in exes:
+        sample = os.path.basename(exe)[:-len('-headless' + exe_ext)]
+        out_path = '{}/{}.json'.format(results_dir, sample)
+        log.info('> {}'.format(sample))
+        # run in the deploy dir so samples find their assets
+        res = subprocess.call([exe, '--frames', str(num_frames), '--out', out_path], cwd=deploy_dir)
+        if res != 0:
+            log.warn("'{}' failed with exit code {}".format(sample, res))
+    log.colored(log.GREEN, 'Wrote results to {}'.format(results_dir))
+
+#-------------------------------------------------------------------------------
+def load_results(results_dir):
+    results = {}
+    for path in glob.glob('{}/*.json'.format(results_dir)):
+        with open(path, 'r') as f:
+            results[os.path.splitext(os.path.basename(path))[0]] = json.load(f)
+    return results
+
+#-------------------------------------------------------------------------------
+def compare(fips_dir, name, baseline):
+    cur_dir = get_results_dir(fips_dir, name)
+    base_dir = get_results_dir(fips_dir, baseline)
+    cur = load_results(cur_dir)
+    base = load_results(base_dir)
+    if len(cur) == 0 or len(base) == 0:
+        log.error("No results in '{}' or '{}'".format(cur_dir, base_dir))
+    num_changed = 0
+    log.info('{:<28} {:>10} {:>10} {:>8}  {}'.format('sample', 'base ms', 'cur ms', 'ratio', 'commands'))
+    for sample in sorted(cur.keys()):
+        if sample not in base:
+            log.info('{:<28} (new)'.format(sample))
+            continue
+        c = cur[sample]
+        b = base[sample]
+        # the command hash is only comparable for the same number of frames
+        cmds = 'same'
+        if c['num_frames'] != b['num_frames']:
+            cmds = 'num_frames differs'
+        elif c['command_hash'] != b['command_hash']:
+            num_changed += 1
+            first = next((i for i, (cf, bf) in enumerate(zip(c['frames'], b['frames'])) if cf['hash'] != bf['hash']), -1)
+            cmds = 'CHANGED (first in frame {})'.format(first)
+        cur_ms = c['frame_ms']['median']
+        base_ms = b['frame_ms']['median']
+        ratio = (cur_ms / base_ms) if base_ms > 0.0 else 0.0
+        line = '{:<28} {:>10.4f} {:>10.4f} {:>8.2f}  {}'.format(sample, base_ms, cur_ms, ratio, cmds)
+        if cmds.startswith('CHANGED'):
+            log.colored(log.YELLOW, line)
+        else:
+            log.info(line)
+    if num_changed > 0:
+        log.colored(log.YELLOW, '{} sample(s) changed their command stream'.format(num_changed))
+    else:
+        log.colored(log.GREEN, 'No command stream changes')
+
+#-------------------------------------------------------------------------------
+def run(fips_dir, proj_dir, args):
+    if len(args) > 0:
+        action = args[0]
+        if action == 'run':
+            name = args[1] if len(args) > 1 else 'current'
+            num_frames = int(args[2]) if len(args) > 2 else NumFrames
+            run_samples(fips_dir, proj_dir, name, num_frames)
+        elif action == 'compare':
+            if len(args) < 2:
+                log.error("Params 'compare baseline [name]' expected")
+            baseline = args[1]
+            name = args[2] if len(args) > 2 else 'current'
+            compare(fips_dir, name, baseline)
+        else:
+            log.error("Invalid param '{}', expected 'run' or 'compare'".format(action))
+    else:
+        log.error("Params 'run|compare' expected")
+
+#-------------------------------------------------------------------------------
+def help():
+    log.info(log.YELLOW +
+             'fips perfrun run [name] [num_frames]\n' +
+             'fips perfrun compare baseline [name]\n' +
+             log.DEF +
+             '    run the headless samples and compare perf and command streams\n' +
+             '    (results are stored under fips-deploy/sokol-perfrun/[name])')
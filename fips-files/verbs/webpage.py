@@ -52,9 +52,11 @@ samples = [
     [ 'vertexpull', 'vertexpull-sapp.c', 'vertexpull-sapp.glsl' ],
     [ 'vertexindexbuffer', 'vertexindexbuffer-sapp.c', 'vertexindexbuffer-sapp.glsl'],
     [ 'vertextexture', 'vertextexture-sapp.c', 'vertextexture-sapp.glsl'],
+    [ 'terrain', 'terrain-sapp.c', 'terrain-sapp.glsl' ],
     [ 'sbuftex', 'sbuftex-sapp.c', 'sbuftex-sapp.glsl' ],
     [ 'shapes', 'shapes-sapp.c', 'shapes-sapp.glsl'],
     [ 'shapes-transform', 'shapes-transform-sapp.c', 'shapes-transform-sapp.glsl'],
+    [ 'shapes-lod', 'shapes-lod-sapp.c', 'shapes-lod-sapp.glsl'],
     [ 'offscreen', 'offscreen-sapp.c', 'offscreen-sapp.glsl' ],
     [ 'offscreen-msaa', 'offscreen-msaa-sapp.c', 'offscreen-msaa-sapp.glsl' ],
     [ 'instancing', 'instancing-sapp.c', 'instancing-sapp.glsl' ],
@@ -69,6 +71,7 @@ samples = [
     [ 'cubemap-jpeg', 'cubemap-jpeg-sapp.c', 'cubemap-jpeg-sapp.glsl' ],
     [ 'cubemaprt', 'cubemaprt-sapp.c', 'cubemaprt-sapp.glsl' ],
     [ 'miprender', 'miprender-sapp.c', 'miprender-sapp.glsl' ],
+    [ 'mipgen', 'mipgen-sapp.c', 'mipgen-sapp.glsl' ],
     [ 'layerrender', 'layerrender-sapp.c', 'layerrender-sapp.glsl' ],
     [ 'primtypes', 'primtypes-sapp.c', 'primtypes-sapp.glsl'],
     [ 'uvwrap', 'uvwrap-sapp.c', 'uvwrap-sapp.glsl'],
@@ -81,6 +84,7 @@ samples = [
     [ 'sdf', 'sdf-sapp.c', 'sdf-sapp.glsl'],
     [ 'shadows', 'shadows-sapp.c', 'shadows-sapp.glsl'],
     [ 'shadows-depthtex', 'shadows-depthtex-sapp.c', 'shadows-depthtex-sapp.glsl'],
+    [ 'shadows-csm', 'shadows-csm-sapp.c', 'shadows-csm-sapp.glsl'],
     [ 'imgui', 'imgui-sapp.cc', None ],
     [ 'imgui-dock', 'imgui-dock-sapp.cc', None ],
     [ 'imgui-highdpi', 'imgui-highdpi-sapp.cc', None ],
@@ -88,6 +92,7 @@ samples = [
     [ 'imgui-images', 'imgui-images-sapp.c', None ],
     [ 'imgui-usercallback', 'imgui-usercallback-sapp.c', 'imgui-usercallback-sapp.glsl'],
     [ 'nuklear', 'nuklear-sapp.c', None ],
+    [ 'nuklear-cached', 'nuklear-cached-sapp.c', 'nuklear-cached-sapp.glsl' ],
     [ 'nuklear-images', 'nuklear-images-sapp.c', None ],
     [ 'sgl-microui', 'sgl-microui-sapp.c', None],
     [ 'fontstash', 'fontstash-sapp.c', None],
@@ -109,6 +114,7 @@ samples = [
     [ 'sgl', 'sgl-sapp.c', None ],
     [ 'sgl-lines', 'sgl-lines-sapp.c', None ],
     [ 'sgl-points', 'sgl-points-sapp.c', None ],
+    [ 'sgl-record', 'sgl-record-sapp.c', 'sgl-record-sapp.glsl' ],
     [ 'sgl-context', 'sgl-context-sapp.c', None ],
     [ 'loadpng', 'loadpng-sapp.c', 'loadpng-sapp.glsl'],
     [ 'plmpeg', 'plmpeg-sapp.c', 'plmpeg-sapp.glsl'],
@@ -123,6 +129,7 @@ samples = [
     [ 'spine-skinsets', 'spine-skinsets-sapp.c', None ],
     [ 'spine-switch-skinsets', 'spine-switch-skinsets-sapp.c', None ],
     [ 'spine-contexts', 'spine-contexts-sapp.c', None ],
+    [ 'spine-streaming', 'spine-streaming-sapp.c', None ],
 ]
 
 compute_samples = [
@@ -131,6 +138,7 @@ compute_samples = [
     [ 'computeboids', 'computeboids-sapp.c', 'computeboids-sapp.glsl' ],
     [ 'write-storageimage', 'write-storageimage-sapp.c', 'write-storageimage-sapp.glsl' ],
     [ 'imageblur', 'imageblur-sapp.c', 'imageblur-sapp.glsl' ],
+    [ 'deferred', 'deferred-sapp.c', 'deferred-sapp.glsl' ],
 ]
 
 # assets that must also be copied
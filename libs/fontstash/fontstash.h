@@ -107,6 +107,10 @@ FONS_DEF void fonsGetAtlasSize(FONScontext* s, int* width, int* height);
 FONS_DEF int fonsExpandAtlas(FONScontext* s, int width, int height);
 // Resets the whole stash.
 FONS_DEF int fonsResetAtlas(FONScontext* stash, int width, int height);
+// Marks the start of a new frame. When called once per frame, a full atlas evicts the least
+// recently used shelf of glyphs not used in the current frame (evicted glyphs are rasterized
+// again on demand) before falling back to the FONS_ATLAS_FULL error callback.
+FONS_DEF void fonsNextFrame(FONScontext* s);
 
 // Add fonts
 FONS_DEF int fonsGetFontByName(FONScontext* s, const char* name);
@@ -127,6 +131,18 @@ FONS_DEF void fonsSetFont(FONScontext* s, int font);
 
 // Draw text
 FONS_DEF float fonsDrawText(FONScontext* s, float x, float y, const char* string, const char* end);
+// Same as fonsDrawText(), but keeps the generated quads in a small layout cache keyed by string,
+// position and state (font, size, blur, spacing, align, color), repeated calls only copy the quads.
+FONS_DEF float fonsDrawTextCached(FONScontext* s, float x, float y, const char* string, const char* end);
+
+// Pre-warm glyphs, rasterizes the glyphs of a string or a codepoint range with the current
+// font, size and blur into the atlas without drawing anything. Returns the number of new glyphs.
+FONS_DEF int fonsPrewarmText(FONScontext* s, const char* string, const char* end);
+FONS_DEF int fonsPrewarmCodepoints(FONScontext* s, unsigned int first, unsigned int last);
+// Optional job callback to rasterize pre-warmed glyphs in parallel. The callback must call
+// job(data, i) for every i in [0, count) from any number of threads, and return when all jobs
+// are done. Ignored with FONS_USE_FREETYPE.
+FONS_DEF void fonsSetJobCallback(FONScontext* s, void (*callback)(void* uptr, void (*job)(void* data, int index), void* data, int count), void* uptr);
 
 // Measure text
 FONS_DEF float fonsTextBounds(FONScontext* s, float x, float y, const char* string, const char* end, float* bounds);
@@ -325,6 +341,7 @@ static int fons__tt_getGlyphKernAdvance(FONSttFontImpl *font, int glyph1, int gl
 #ifndef FONS_SCRATCH_BUF_SIZE
 #	define FONS_SCRATCH_BUF_SIZE 64000
 #endif
+// Initial size of the per-font glyph hash table, must be pow2, the table grows as needed.
 #ifndef FONS_HASH_LUT_SIZE
 #	define FONS_HASH_LUT_SIZE 256
 #endif
@@ -337,12 +354,19 @@ static int fons__tt_getGlyphKernAdvance(FONSttFontImpl *font, int glyph1, int gl
 #ifndef FONS_INIT_ATLAS_NODES
 #	define FONS_INIT_ATLAS_NODES 256
 #endif
+// Atlas shelf heights are rounded up to this granularity so that glyphs of similar size share shelves.
+#ifndef FONS_ATLAS_SHELF_ROUND
+#	define FONS_ATLAS_SHELF_ROUND 4
+#endif
 #ifndef FONS_VERTEX_COUNT
 #	define FONS_VERTEX_COUNT 1024
 #endif
 #ifndef FONS_MAX_STATES
 #	define FONS_MAX_STATES 20
 #endif
+#ifndef FONS_LAYOUT_CACHE_SIZE
+#	define FONS_LAYOUT_CACHE_SIZE 64
+#endif
 #ifndef FONS_MAX_FALLBACKS
 #	define FONS_MAX_FALLBACKS 20
 #endif
@@ -358,6 +382,11 @@ static unsigned int fons__hashint(unsigned int a)
 	return a;
 }
 
+static unsigned int fons__hashglyph(unsigned int codepoint, short isize, short iblur)
+{
+	return fons__hashint(codepoint ^ ((unsigned int)isize << 16) ^ ((unsigned int)iblur << 27));
+}
+
 static int fons__mini(int a, int b)
 {
 	return a < b ? a : b;
@@ -372,7 +401,8 @@ struct FONSglyph
 {
 	unsigned int codepoint;
 	int index;
-	int next;
+	int next;	// next free glyph slot, only valid while shelf == -1
+	int shelf;	// atlas shelf the glyph lives in, -1 for free (evicted) slots
 	short size, blur;
 	short x0,y0,x1,y1;
 	short xadv,xoff,yoff;
@@ -392,7 +422,11 @@ struct FONSfont
 	FONSglyph* glyphs;
 	int cglyphs;
 	int nglyphs;
-	int lut[FONS_HASH_LUT_SIZE];
+	int* lut;	// open addressing glyph table, FONS__LUT_EMPTY, FONS__LUT_DELETED or glyph index
+	int clut;
+	int nlut;	// live + deleted slots
+	int nlive;
+	int freeGlyph;
 	int fallbacks[FONS_MAX_FALLBACKS];
 	int nfallbacks;
 };
@@ -409,20 +443,56 @@ struct FONSstate
 };
 typedef struct FONSstate FONSstate;
 
-struct FONSatlasNode {
-	short x, y, width;
+struct FONSatlasShelf {
+	short x, y, height;
+	unsigned char pinned;
+	int lastUsed;
+	int generation;	// bumped when the shelf is evicted
 };
-typedef struct FONSatlasNode FONSatlasNode;
+typedef struct FONSatlasShelf FONSatlasShelf;
 
 struct FONSatlas
 {
 	int width, height;
-	FONSatlasNode* nodes;
-	int nnodes;
-	int cnodes;
+	FONSatlasShelf* shelves;
+	int nshelves;
+	int cshelves;
+	int nexty;
 };
 typedef struct FONSatlas FONSatlas;
 
+// Deferred glyph rasterization, font is a copy so that jobs don't touch the font array.
+struct FONSrasterJob {
+	FONSttFontImpl font;
+	float scale;
+	int index, x, y, w, h, pad, blur;
+};
+typedef struct FONSrasterJob FONSrasterJob;
+
+struct FONSlayout
+{
+	unsigned int hash;
+	char* str;
+	int len;
+	int font;
+	short isize, iblur;
+	float spacing;
+	int align;
+	unsigned int color;
+	float x, y;
+	float advance;
+	float* verts;
+	float* tcoords;
+	unsigned int* colors;
+	int nverts, cverts;
+	int* shelves;	// (shelf index, shelf generation) pairs the quads depend on
+	int nshelves, cshelves;
+	int atlasGeneration;
+	int lastUsed;
+	int valid;
+};
+typedef struct FONSlayout FONSlayout;
+
 struct FONScontext
 {
 	FONSparams params;
@@ -443,6 +513,16 @@ struct FONScontext
 	int nstates;
 	void (*handleError)(void* uptr, int error, int val);
 	void* errorUptr;
+	int frame;
+	int atlasGeneration;	// bumped when all glyph positions are invalidated
+	FONSrasterJob* jobs;
+	int njobs, cjobs;
+	int deferRaster;
+	int jobCount;
+	void (*runJobs)(void* uptr, void (*job)(void* data, int index), void* data, int count);
+	void* jobsUptr;
+	FONSlayout layouts[FONS_LAYOUT_CACHE_SIZE];
+	FONSlayout* capture;
 };
 
 #ifdef STB_TRUETYPE_IMPLEMENTATION
@@ -452,6 +532,10 @@ static void* fons__tmpalloc(size_t size, void* up)
 	unsigned char* ptr;
 	FONScontext* stash = (FONScontext*)up;
 
+	// Raster jobs may run on other threads and can't use the scratch buffer.
+	if (stash == NULL)
+		return malloc(size);
+
 	// 16-byte align the returned pointer
 	size = (size + 0xf) & ~0xf;
 
@@ -467,9 +551,8 @@ static void* fons__tmpalloc(size_t size, void* up)
 
 static void fons__tmpfree(void* ptr, void* up)
 {
-	(void)ptr;
-	(void)up;
-	// empty
+	if (up == NULL)
+		free(ptr);
 }
 
 #endif // STB_TRUETYPE_IMPLEMENTATION
@@ -513,16 +596,17 @@ static unsigned int fons__decutf8(unsigned int* state, unsigned int* codep, unsi
 	return *state;
 }
 
-// Atlas based on Skyline Bin Packer by Jukka Jylänki
+// Shelf atlas with least-recently-used shelf eviction. Glyphs are packed left to right
+// into horizontal shelves, a shelf is the unit of eviction.
 
 static void fons__deleteAtlas(FONSatlas* atlas)
 {
 	if (atlas == NULL) return;
-	if (atlas->nodes != NULL) free(atlas->nodes);
+	if (atlas->shelves != NULL) free(atlas->shelves);
 	free(atlas);
 }
 
-static FONSatlas* fons__allocAtlas(int w, int h, int nnodes)
+static FONSatlas* fons__allocAtlas(int w, int h, int nshelves)
 {
 	FONSatlas* atlas = NULL;
 
@@ -534,18 +618,13 @@ static FONSatlas* fons__allocAtlas(int w, int h, int nnodes)
 	atlas->width = w;
 	atlas->height = h;
 
-	// Allocate space for skyline nodes
-	atlas->nodes = (FONSatlasNode*)malloc(sizeof(FONSatlasNode) * nnodes);
-	if (atlas->nodes == NULL) goto error;
-	memset(atlas->nodes, 0, sizeof(FONSatlasNode) * nnodes);
-	atlas->nnodes = 0;
-	atlas->cnodes = nnodes;
-
-	// Init root node.
-	atlas->nodes[0].x = 0;
-	atlas->nodes[0].y = 0;
-	atlas->nodes[0].width = (short)w;
-	atlas->nnodes++;
+	// Allocate space for shelves
+	atlas->shelves = (FONSatlasShelf*)malloc(sizeof(FONSatlasShelf) * nshelves);
+	if (atlas->shelves == NULL) goto error;
+	memset(atlas->shelves, 0, sizeof(FONSatlasShelf) * nshelves);
+	atlas->nshelves = 0;
+	atlas->cshelves = nshelves;
+	atlas->nexty = 0;
 
 	return atlas;
 
@@ -554,40 +633,27 @@ error:
 	return NULL;
 }
 
-static int fons__atlasInsertNode(FONSatlas* atlas, int idx, int x, int y, int w)
+static int fons__atlasAddShelf(FONSatlas* atlas, int h)
 {
-	int i;
-	// Insert node
-	if (atlas->nnodes+1 > atlas->cnodes) {
-		atlas->cnodes = atlas->cnodes == 0 ? 8 : atlas->cnodes * 2;
-		atlas->nodes = (FONSatlasNode*)realloc(atlas->nodes, sizeof(FONSatlasNode) * atlas->cnodes);
-		if (atlas->nodes == NULL)
-			return 0;
+	FONSatlasShelf* shelf;
+	if (atlas->nshelves+1 > atlas->cshelves) {
+		atlas->cshelves = atlas->cshelves == 0 ? 8 : atlas->cshelves * 2;
+		atlas->shelves = (FONSatlasShelf*)realloc(atlas->shelves, sizeof(FONSatlasShelf) * atlas->cshelves);
+		if (atlas->shelves == NULL)
+			return -1;
 	}
-	for (i = atlas->nnodes; i > idx; i--)
-		atlas->nodes[i] = atlas->nodes[i-1];
-	atlas->nodes[idx].x = (short)x;
-	atlas->nodes[idx].y = (short)y;
-	atlas->nodes[idx].width = (short)w;
-	atlas->nnodes++;
-
-	return 1;
-}
-
-static void fons__atlasRemoveNode(FONSatlas* atlas, int idx)
-{
-	int i;
-	if (atlas->nnodes == 0) return;
-	for (i = idx; i < atlas->nnodes-1; i++)
-		atlas->nodes[i] = atlas->nodes[i+1];
-	atlas->nnodes--;
+	shelf = &atlas->shelves[atlas->nshelves];
+	memset(shelf, 0, sizeof(FONSatlasShelf));
+	shelf->y = (short)atlas->nexty;
+	shelf->height = (short)h;
+	atlas->nexty += h;
+	return atlas->nshelves++;
 }
 
 static void fons__atlasExpand(FONSatlas* atlas, int w, int h)
 {
-	// Insert node for empty space
-	if (w > atlas->width)
-		fons__atlasInsertNode(atlas, atlas->nnodes, atlas->width, 0, w - atlas->width);
+	// Shelves extend over the whole atlas width, and new shelves are added below
+	// the existing ones, so only the size needs to be updated.
 	atlas->width = w;
 	atlas->height = h;
 }
@@ -596,111 +662,207 @@ static void fons__atlasReset(FONSatlas* atlas, int w, int h)
 {
 	atlas->width = w;
 	atlas->height = h;
-	atlas->nnodes = 0;
+	atlas->nshelves = 0;
+	atlas->nexty = 0;
+}
 
-	// Init root node.
-	atlas->nodes[0].x = 0;
-	atlas->nodes[0].y = 0;
-	atlas->nodes[0].width = (short)w;
-	atlas->nnodes++;
+static void fons__atlasShelfAddRect(FONSatlas* atlas, int idx, int rw, int frame, int* rx, int* ry)
+{
+	FONSatlasShelf* shelf = &atlas->shelves[idx];
+	*rx = shelf->x;
+	*ry = shelf->y;
+	shelf->x += (short)rw;
+	shelf->lastUsed = frame;
 }
 
-static int fons__atlasAddSkylineLevel(FONSatlas* atlas, int idx, int x, int y, int w, int h)
+static int fons__atlasAddRect(FONSatlas* atlas, int rw, int rh, int frame, int* rx, int* ry, int* rshelf)
 {
-	int i;
+	int i, besti = -1, besth = 0;
+	int sh = (rh + FONS_ATLAS_SHELF_ROUND-1) & ~(FONS_ATLAS_SHELF_ROUND-1);
+	FONSatlasShelf* shelf;
 
-	// Insert new node
-	if (fons__atlasInsertNode(atlas, idx, x, y+h, w) == 0)
+	if (rw > atlas->width)
 		return 0;
 
-	// Delete skyline segments that fall under the shadow of the new segment.
-	for (i = idx+1; i < atlas->nnodes; i++) {
-		if (atlas->nodes[i].x < atlas->nodes[i-1].x + atlas->nodes[i-1].width) {
-			int shrink = atlas->nodes[i-1].x + atlas->nodes[i-1].width - atlas->nodes[i].x;
-			atlas->nodes[i].x += (short)shrink;
-			atlas->nodes[i].width -= (short)shrink;
-			if (atlas->nodes[i].width <= 0) {
-				fons__atlasRemoveNode(atlas, i);
-				i--;
-			} else {
-				break;
-			}
-		} else {
-			break;
+	// Best height fit of existing shelves, but don't waste more than 1/4 of a shelf.
+	for (i = 0; i < atlas->nshelves; i++) {
+		shelf = &atlas->shelves[i];
+		if (shelf->pinned || shelf->height < rh || shelf->x + rw > atlas->width)
+			continue;
+		if (shelf->height > sh + sh/4)
+			continue;
+		if (besti == -1 || shelf->height < besth) {
+			besti = i;
+			besth = shelf->height;
 		}
 	}
 
-	// Merge same height skyline segments that are next to each other.
-	for (i = 0; i < atlas->nnodes-1; i++) {
-		if (atlas->nodes[i].y == atlas->nodes[i+1].y) {
-			atlas->nodes[i].width += atlas->nodes[i+1].width;
-			fons__atlasRemoveNode(atlas, i+1);
-			i--;
-		}
+	// Otherwise open a new shelf in the unused space below the existing shelves.
+	if (besti == -1) {
+		if (atlas->nexty + sh > atlas->height)
+			return 0;
+		besti = fons__atlasAddShelf(atlas, sh);
+		if (besti == -1)
+			return 0;
 	}
 
+	fons__atlasShelfAddRect(atlas, besti, rw, frame, rx, ry);
+	*rshelf = besti;
+
 	return 1;
 }
 
-static int fons__atlasRectFits(FONSatlas* atlas, int i, int w, int h)
+// Finds the least recently used run of adjacent shelves which together can hold the rect
+// and haven't been used in the current frame, returns the first shelf and the run length
+// in count, or -1. Glyphs used in the current frame may already have been emitted as
+// quads, so their shelves must not be overwritten. Merged away shelves have zero height.
+static int fons__atlasFindEvictableShelves(FONSatlas* atlas, int rw, int rh, int frame, int* count)
 {
-	// Checks if there is enough space at the location of skyline span 'i',
-	// and return the max height of all skyline spans under that at that location,
-	// (think tetris block being dropped at that position). Or -1 if no space found.
-	int x = atlas->nodes[i].x;
-	int y = atlas->nodes[i].y;
-	int spaceLeft;
-	if (x + w > atlas->width)
+	int i, j, besti = -1, bestn = 0, bestUsed = 0, bestHeight = 0;
+	FONSatlasShelf* shelf;
+
+	if (rw > atlas->width)
 		return -1;
-	spaceLeft = w;
-	while (spaceLeft > 0) {
-		if (i == atlas->nnodes) return -1;
-		y = fons__maxi(y, atlas->nodes[i].y);
-		if (y + h > atlas->height) return -1;
-		spaceLeft -= atlas->nodes[i].width;
-		++i;
+	for (i = 0; i < atlas->nshelves; i++) {
+		int h = 0, lastUsed = 0;
+		// A merged away shelf has no valid position, so it can't start a run.
+		if (atlas->shelves[i].height == 0)
+			continue;
+		for (j = i; j < atlas->nshelves && h < rh; j++) {
+			shelf = &atlas->shelves[j];
+			if (shelf->pinned || (shelf->height > 0 && shelf->lastUsed >= frame))
+				break;
+			h += shelf->height;
+			lastUsed = fons__maxi(lastUsed, shelf->lastUsed);
+		}
+		if (h < rh)
+			continue;
+		if (besti == -1 || lastUsed < bestUsed || (lastUsed == bestUsed && h < bestHeight)) {
+			besti = i;
+			bestn = j - i;
+			bestUsed = lastUsed;
+			bestHeight = h;
+		}
 	}
-	return y;
+	*count = bestn;
+	return besti;
 }
 
-static int fons__atlasAddRect(FONSatlas* atlas, int rw, int rh, int* rx, int* ry)
+// Merges a run of evicted shelves into a shelf of the rounded height rh, what is left of the
+// run goes to the second shelf of the run, so that the merged shelf doesn't keep the height
+// of the whole run. A single shelf keeps its height, splitting it would need a new shelf index.
+static void fons__atlasMergeShelves(FONSatlas* atlas, int first, int count, int rh)
 {
-	int besth = atlas->height, bestw = atlas->width, besti = -1;
-	int bestx = -1, besty = -1, i;
-
-	// Bottom left fit heuristic.
-	for (i = 0; i < atlas->nnodes; i++) {
-		int y = fons__atlasRectFits(atlas, i, rw, rh);
-		if (y != -1) {
-			if (y + rh < besth || (y + rh == besth && atlas->nodes[i].width < bestw)) {
-				besti = i;
-				bestw = atlas->nodes[i].width;
-				besth = y + rh;
-				bestx = atlas->nodes[i].x;
-				besty = y;
-			}
-		}
+	int i, h = 0;
+	int sh = (rh + FONS_ATLAS_SHELF_ROUND-1) & ~(FONS_ATLAS_SHELF_ROUND-1);
+	for (i = first; i < first+count; i++) {
+		h += atlas->shelves[i].height;
+		atlas->shelves[i].height = 0;
+	}
+	if (count > 1 && sh < h) {
+		atlas->shelves[first].height = (short)sh;
+		atlas->shelves[first+1].y = (short)(atlas->shelves[first].y + sh);
+		atlas->shelves[first+1].height = (short)(h - sh);
+		atlas->shelves[first+1].x = 0;
+	} else {
+		atlas->shelves[first].height = (short)h;
 	}
+}
 
-	if (besti == -1)
-		return 0;
+// Open addressing glyph hash table with linear probing.
 
-	// Perform the actual packing.
-	if (fons__atlasAddSkylineLevel(atlas, besti, bestx, besty, rw, rh) == 0)
-		return 0;
+#define FONS__LUT_EMPTY -1
+#define FONS__LUT_DELETED -2
 
-	*rx = bestx;
-	*ry = besty;
+static int fons__lutAlloc(FONSfont* font, int size)
+{
+	font->lut = (int*)malloc(sizeof(int) * size);
+	if (font->lut == NULL) return 0;
+	memset(font->lut, 0xff, sizeof(int) * size);	// FONS__LUT_EMPTY
+	font->clut = size;
+	font->nlut = 0;
+	font->nlive = 0;
+	return 1;
+}
 
+static int fons__lutFind(FONSfont* font, unsigned int codepoint, short isize, short iblur)
+{
+	unsigned int mask = (unsigned int)font->clut - 1;
+	unsigned int i = fons__hashglyph(codepoint, isize, iblur) & mask;
+	while (font->lut[i] != FONS__LUT_EMPTY) {
+		int g = font->lut[i];
+		if (g >= 0 && font->glyphs[g].codepoint == codepoint && font->glyphs[g].size == isize && font->glyphs[g].blur == iblur)
+			return g;
+		i = (i + 1) & mask;
+	}
+	return -1;
+}
+
+static void fons__lutPut(FONSfont* font, int g)
+{
+	unsigned int mask = (unsigned int)font->clut - 1;
+	unsigned int i = fons__hashglyph(font->glyphs[g].codepoint, font->glyphs[g].size, font->glyphs[g].blur) & mask;
+	while (font->lut[i] >= 0)
+		i = (i + 1) & mask;
+	if (font->lut[i] == FONS__LUT_EMPTY)
+		font->nlut++;
+	font->lut[i] = g;
+	font->nlive++;
+}
+
+// Makes room for one more glyph, called before a new glyph is committed so that the
+// fons__lutPut() afterwards can't fail.
+static int fons__lutReserve(FONSfont* font)
+{
+	// Keep the load factor (including deleted slots) below 3/4, rehashing drops deleted slots.
+	if ((font->nlut+1) * 4 > font->clut * 3) {
+		int* oldLut = font->lut;
+		int oldSize = font->clut, size = font->clut, i;
+		while ((font->nlive+1) * 2 > size)
+			size *= 2;
+		if (!fons__lutAlloc(font, size)) {
+			font->lut = oldLut;
+			font->clut = oldSize;
+			return 0;
+		}
+		for (i = 0; i < oldSize; i++) {
+			if (oldLut[i] >= 0)
+				fons__lutPut(font, oldLut[i]);
+		}
+		free(oldLut);
+	}
 	return 1;
 }
 
+static void fons__lutRemove(FONSfont* font, int g)
+{
+	unsigned int mask = (unsigned int)font->clut - 1;
+	unsigned int i = fons__hashglyph(font->glyphs[g].codepoint, font->glyphs[g].size, font->glyphs[g].blur) & mask;
+	while (font->lut[i] != FONS__LUT_EMPTY) {
+		if (font->lut[i] == g) {
+			font->lut[i] = FONS__LUT_DELETED;
+			font->nlive--;
+			return;
+		}
+		i = (i + 1) & mask;
+	}
+}
+
+static void fons__lutClear(FONSfont* font)
+{
+	memset(font->lut, 0xff, sizeof(int) * font->clut);	// FONS__LUT_EMPTY
+	font->nlut = 0;
+	font->nlive = 0;
+}
+
 static void fons__addWhiteRect(FONScontext* stash, int w, int h)
 {
-	int x, y, gx, gy;
+	int x, y, gx, gy, shelf;
 	unsigned char* dst;
-	if (fons__atlasAddRect(stash->atlas, w, h, &gx, &gy) == 0)
+	if (fons__atlasAddRect(stash->atlas, w, h, stash->frame, &gx, &gy, &shelf) == 0)
 		return;
+	// The white rect must never be evicted.
+	stash->atlas->shelves[shelf].pinned = 1;
 
 	// Rasterize
 	dst = &stash->texData[gx + gy * stash->params.width];
@@ -856,6 +1018,7 @@ static void fons__freeFont(FONSfont* font)
 {
 	if (font == NULL) return;
 	if (font->glyphs) free(font->glyphs);
+	if (font->lut) free(font->lut);
 	if (font->freeData && font->data) free(font->data);
 	free(font);
 }
@@ -877,6 +1040,9 @@ static int fons__allocFont(FONScontext* stash)
 	if (font->glyphs == NULL) goto error;
 	font->cglyphs = FONS_INIT_GLYPHS;
 	font->nglyphs = 0;
+	font->freeGlyph = -1;
+
+	if (!fons__lutAlloc(font, FONS_HASH_LUT_SIZE)) goto error;
 
 	stash->fonts[stash->nfonts++] = font;
 	return stash->nfonts-1;
@@ -889,7 +1055,7 @@ error:
 
 int fonsAddFontMem(FONScontext* stash, const char* name, unsigned char* data, int dataSize, int freeData)
 {
-	int i, ascent, descent, fh, lineGap;
+	int ascent, descent, fh, lineGap;
 	FONSfont* font;
 
 	int idx = fons__allocFont(stash);
@@ -901,10 +1067,6 @@ int fonsAddFontMem(FONScontext* stash, const char* name, unsigned char* data, in
 	strncpy(font->name, name, sizeof(font->name));
 	font->name[sizeof(font->name)-1] = '\0';
 
-	// Init hash lookup.
-	for (i = 0; i < FONS_HASH_LUT_SIZE; ++i)
-		font->lut[i] = -1;
-
 	// Read in the font data.
 	font->dataSize = dataSize;
 	font->data = data;
@@ -943,6 +1105,12 @@ int fonsGetFontByName(FONScontext* s, const char* name)
 
 static FONSglyph* fons__allocGlyph(FONSfont* font)
 {
+	// Reuse slots of evicted glyphs first.
+	if (font->freeGlyph != -1) {
+		FONSglyph* glyph = &font->glyphs[font->freeGlyph];
+		font->freeGlyph = glyph->next;
+		return glyph;
+	}
 	if (font->nglyphs+1 > font->cglyphs) {
 		font->cglyphs = font->cglyphs == 0 ? 8 : font->cglyphs * 2;
 		font->glyphs = (FONSglyph*)realloc(font->glyphs, sizeof(FONSglyph) * font->cglyphs);
@@ -1018,17 +1186,146 @@ static void fons__blur(FONScontext* stash, unsigned char* dst, int w, int h, int
 //	fons__blurcols(dst, w, h, dstStride, alpha);
 }
 
+static void fons__evictShelf(FONScontext* stash, int shelfIndex)
+{
+	int i, j, y;
+	FONSatlasShelf* shelf = &stash->atlas->shelves[shelfIndex];
+
+	// Drop all glyphs living in the shelf, they are rasterized again when needed.
+	for (i = 0; i < stash->nfonts; i++) {
+		FONSfont* font = stash->fonts[i];
+		for (j = 0; j < font->nglyphs; j++) {
+			FONSglyph* glyph = &font->glyphs[j];
+			if (glyph->shelf != shelfIndex)
+				continue;
+			fons__lutRemove(font, j);
+			glyph->shelf = -1;
+			glyph->next = font->freeGlyph;
+			font->freeGlyph = j;
+		}
+	}
+
+	// Clear the shelf texels, glyphs rely on an empty border.
+	for (y = shelf->y; y < shelf->y + shelf->height; y++)
+		memset(&stash->texData[y * stash->params.width], 0, shelf->x);
+	stash->dirtyRect[0] = 0;
+	stash->dirtyRect[1] = fons__mini(stash->dirtyRect[1], shelf->y);
+	stash->dirtyRect[2] = fons__maxi(stash->dirtyRect[2], shelf->x);
+	stash->dirtyRect[3] = fons__maxi(stash->dirtyRect[3], shelf->y + shelf->height);
+
+	shelf->x = 0;
+	shelf->generation++;
+}
+
+static void fons__renderGlyph(FONSrasterJob* job, unsigned char* texData, int stride)
+{
+	int x, y, gw = job->w, gh = job->h, pad = job->pad;
+	unsigned char* dst;
+
+	// Rasterize
+	dst = &texData[(job->x+pad) + (job->y+pad) * stride];
+	fons__tt_renderGlyphBitmap(&job->font, dst, gw-pad*2,gh-pad*2, stride, job->scale,job->scale, job->index);
+
+	// Make sure there is one pixel empty border.
+	dst = &texData[job->x + job->y * stride];
+	for (y = 0; y < gh; y++) {
+		dst[y*stride] = 0;
+		dst[gw-1 + y*stride] = 0;
+	}
+	for (x = 0; x < gw; x++) {
+		dst[x] = 0;
+		dst[x + (gh-1)*stride] = 0;
+	}
+
+	// Debug code to color the glyph background
+/*	unsigned char* fdst = &texData[job->x + job->y * stride];
+	for (y = 0; y < gh; y++) {
+		for (x = 0; x < gw; x++) {
+			int a = (int)fdst[x+y*stride] + 20;
+			if (a > 255) a = 255;
+			fdst[x+y*stride] = a;
+		}
+	}*/
+
+	// Blur
+	if (job->blur > 0)
+		fons__blur(NULL, dst, gw,gh, stride, job->blur);
+}
+
+static void fons__rasterJob(void* data, int index)
+{
+	FONScontext* stash = (FONScontext*)data;
+	fons__renderGlyph(&stash->jobs[index], stash->texData, stash->params.width);
+}
+
+static void fons__runRasterJobs(FONScontext* stash)
+{
+	int i;
+	if (stash->njobs == 0)
+		return;
+#ifndef FONS_USE_FREETYPE
+	if (stash->runJobs != NULL && stash->njobs > 1) {
+		stash->runJobs(stash->jobsUptr, fons__rasterJob, stash, stash->njobs);
+		stash->njobs = 0;
+		return;
+	}
+#endif
+	for (i = 0; i < stash->njobs; i++)
+		fons__rasterJob(stash, i);
+	stash->njobs = 0;
+}
+
+static int fons__pushRasterJob(FONScontext* stash, const FONSrasterJob* job)
+{
+	if (stash->njobs+1 > stash->cjobs) {
+		int cjobs = stash->cjobs == 0 ? 64 : stash->cjobs * 2;
+		FONSrasterJob* jobs = (FONSrasterJob*)realloc(stash->jobs, sizeof(FONSrasterJob) * cjobs);
+		if (jobs == NULL)
+			return 0;
+		stash->jobs = jobs;
+		stash->cjobs = cjobs;
+	}
+	stash->jobs[stash->njobs] = *job;
+#ifndef FONS_USE_FREETYPE
+	// Jobs may run on other threads, let stb_truetype allocate from the heap.
+	stash->jobs[stash->njobs].font.font.userdata = NULL;
+#endif
+	stash->njobs++;
+	stash->jobCount++;
+	return 1;
+}
+
+static void fons__captureShelf(FONSlayout* layout, FONSatlas* atlas, int shelf)
+{
+	int i;
+	for (i = 0; i < layout->nshelves; i++) {
+		if (layout->shelves[i*2] == shelf)
+			return;
+	}
+	if (layout->nshelves+1 > layout->cshelves) {
+		int cshelves = layout->cshelves == 0 ? 8 : layout->cshelves * 2;
+		int* shelves = (int*)realloc(layout->shelves, sizeof(int) * 2 * cshelves);
+		if (shelves == NULL) {
+			layout->valid = 0;
+			return;
+		}
+		layout->shelves = shelves;
+		layout->cshelves = cshelves;
+	}
+	layout->shelves[layout->nshelves*2+0] = shelf;
+	layout->shelves[layout->nshelves*2+1] = atlas->shelves[shelf].generation;
+	layout->nshelves++;
+}
+
 static FONSglyph* fons__getGlyph(FONScontext* stash, FONSfont* font, unsigned int codepoint,
 								 short isize, short iblur)
 {
-	int i, g, advance, lsb, x0, y0, x1, y1, gw, gh, gx, gy, x, y;
+	int i, g, advance, lsb, x0, y0, x1, y1, gw, gh, gx, gy, shelf;
 	float scale;
 	FONSglyph* glyph = NULL;
-	unsigned int h;
 	float size = isize/10.0f;
 	int pad, added;
-	unsigned char* bdst;
-	unsigned char* dst;
+	FONSrasterJob job;
 	FONSfont* renderFont = font;
 
 	if (isize < 2) return NULL;
@@ -1039,12 +1336,12 @@ static FONSglyph* fons__getGlyph(FONScontext* stash, FONSfont* font, unsigned in
 	stash->nscratch = 0;
 
 	// Find code point and size.
-	h = fons__hashint(codepoint) & (FONS_HASH_LUT_SIZE-1);
-	i = font->lut[h];
-	while (i != -1) {
-		if (font->glyphs[i].codepoint == codepoint && font->glyphs[i].size == isize && font->glyphs[i].blur == iblur)
-			return &font->glyphs[i];
-		i = font->glyphs[i].next;
+	i = fons__lutFind(font, codepoint, isize, iblur);
+	if (i != -1) {
+		stash->atlas->shelves[font->glyphs[i].shelf].lastUsed = stash->frame;
+		if (stash->capture != NULL)
+			fons__captureShelf(stash->capture, stash->atlas, font->glyphs[i].shelf);
+		return &font->glyphs[i];
 	}
 
 	// Could not find glyph, create it.
@@ -1068,17 +1365,36 @@ static FONSglyph* fons__getGlyph(FONScontext* stash, FONSfont* font, unsigned in
 	gw = x1-x0 + pad*2;
 	gh = y1-y0 + pad*2;
 
+	// Make room in the hash lookup before anything is allocated for the glyph.
+	if (!fons__lutReserve(font)) return NULL;
+
 	// Find free spot for the rect in the atlas
-	added = fons__atlasAddRect(stash->atlas, gw, gh, &gx, &gy);
+	added = fons__atlasAddRect(stash->atlas, gw, gh, stash->frame, &gx, &gy, &shelf);
+	if (added == 0) {
+		// Atlas is full, evict the least recently used shelves (if any) and put the glyph there.
+		int count = 0;
+		int evict = fons__atlasFindEvictableShelves(stash->atlas, gw, gh, stash->frame, &count);
+		if (evict != -1) {
+			for (i = evict; i < evict+count; i++)
+				fons__evictShelf(stash, i);
+			fons__atlasMergeShelves(stash->atlas, evict, count, gh);
+			fons__atlasShelfAddRect(stash->atlas, evict, gw, stash->frame, &gx, &gy);
+			shelf = evict;
+			added = 1;
+		}
+	}
 	if (added == 0 && stash->handleError != NULL) {
 		// Atlas is full, let the user to resize the atlas (or not), and try again.
+		// Deferred glyphs must be in place before the atlas gets changed.
+		fons__runRasterJobs(stash);
 		stash->handleError(stash->errorUptr, FONS_ATLAS_FULL, 0);
-		added = fons__atlasAddRect(stash->atlas, gw, gh, &gx, &gy);
+		added = fons__atlasAddRect(stash->atlas, gw, gh, stash->frame, &gx, &gy, &shelf);
 	}
 	if (added == 0) return NULL;
 
 	// Init glyph.
 	glyph = fons__allocGlyph(font);
+	if (glyph == NULL) return NULL;
 	glyph->codepoint = codepoint;
 	glyph->size = isize;
 	glyph->blur = iblur;
@@ -1090,43 +1406,27 @@ static FONSglyph* fons__getGlyph(FONScontext* stash, FONSfont* font, unsigned in
 	glyph->xadv = (short)(scale * advance * 10.0f);
 	glyph->xoff = (short)(x0 - pad);
 	glyph->yoff = (short)(y0 - pad);
-	glyph->next = 0;
-
-	// Insert char to hash lookup.
-	glyph->next = font->lut[h];
-	font->lut[h] = font->nglyphs-1;
-
-	// Rasterize
-	dst = &stash->texData[(glyph->x0+pad) + (glyph->y0+pad) * stash->params.width];
-	fons__tt_renderGlyphBitmap(&renderFont->font, dst, gw-pad*2,gh-pad*2, stash->params.width, scale,scale, g);
-
-	// Make sure there is one pixel empty border.
-	dst = &stash->texData[glyph->x0 + glyph->y0 * stash->params.width];
-	for (y = 0; y < gh; y++) {
-		dst[y*stash->params.width] = 0;
-		dst[gw-1 + y*stash->params.width] = 0;
-	}
-	for (x = 0; x < gw; x++) {
-		dst[x] = 0;
-		dst[x + (gh-1)*stash->params.width] = 0;
-	}
-
-	// Debug code to color the glyph background
-/*	unsigned char* fdst = &stash->texData[glyph->x0 + glyph->y0 * stash->params.width];
-	for (y = 0; y < gh; y++) {
-		for (x = 0; x < gw; x++) {
-			int a = (int)fdst[x+y*stash->params.width] + 20;
-			if (a > 255) a = 255;
-			fdst[x+y*stash->params.width] = a;
-		}
-	}*/
-
-	// Blur
-	if (iblur > 0) {
-		stash->nscratch = 0;
-		bdst = &stash->texData[glyph->x0 + glyph->y0 * stash->params.width];
-		fons__blur(stash, bdst, gw,gh, stash->params.width, iblur);
-	}
+	glyph->next = -1;
+	glyph->shelf = shelf;
+
+	// Insert char to hash lookup, there is room after fons__lutReserve().
+	fons__lutPut(font, (int)(glyph - font->glyphs));
+
+	// Rasterize now, or defer to fons__runRasterJobs() when pre-warming.
+	job.font = renderFont->font;
+	job.scale = scale;
+	job.index = g;
+	job.x = gx;
+	job.y = gy;
+	job.w = gw;
+	job.h = gh;
+	job.pad = pad;
+	job.blur = iblur;
+	if (!stash->deferRaster || !fons__pushRasterJob(stash, &job))
+		fons__renderGlyph(&job, stash->texData, stash->params.width);
+
+	if (stash->capture != NULL)
+		fons__captureShelf(stash->capture, stash->atlas, shelf);
 
 	stash->dirtyRect[0] = fons__mini(stash->dirtyRect[0], glyph->x0);
 	stash->dirtyRect[1] = fons__mini(stash->dirtyRect[1], glyph->y0);
@@ -1188,6 +1488,31 @@ static void fons__getQuad(FONScontext* stash, FONSfont* font,
 	*x += (int)(glyph->xadv / 10.0f + 0.5f);
 }
 
+static void fons__captureVerts(FONScontext* stash)
+{
+	FONSlayout* layout = stash->capture;
+	int n = stash->nverts;
+	if (layout->nverts+n > layout->cverts) {
+		int cverts = fons__maxi(layout->nverts+n, layout->cverts * 2);
+		float* verts = (float*)realloc(layout->verts, sizeof(float) * 2 * cverts);
+		float* tcoords;
+		unsigned int* colors;
+		if (verts == NULL) { layout->valid = 0; return; }
+		layout->verts = verts;
+		tcoords = (float*)realloc(layout->tcoords, sizeof(float) * 2 * cverts);
+		if (tcoords == NULL) { layout->valid = 0; return; }
+		layout->tcoords = tcoords;
+		colors = (unsigned int*)realloc(layout->colors, sizeof(unsigned int) * cverts);
+		if (colors == NULL) { layout->valid = 0; return; }
+		layout->colors = colors;
+		layout->cverts = cverts;
+	}
+	memcpy(layout->verts + layout->nverts*2, stash->verts, sizeof(float) * 2 * n);
+	memcpy(layout->tcoords + layout->nverts*2, stash->tcoords, sizeof(float) * 2 * n);
+	memcpy(layout->colors + layout->nverts, stash->colors, sizeof(unsigned int) * n);
+	layout->nverts += n;
+}
+
 static void fons__flush(FONScontext* stash)
 {
 	// Flush texture
@@ -1203,6 +1528,8 @@ static void fons__flush(FONScontext* stash)
 
 	// Flush triangles
 	if (stash->nverts > 0) {
+		if (stash->capture != NULL)
+			fons__captureVerts(stash);
 		if (stash->params.renderDraw != NULL)
 			stash->params.renderDraw(stash->params.userPtr, stash->verts, stash->tcoords, stash->colors, stash->nverts);
 		stash->nverts = 0;
@@ -1309,6 +1636,189 @@ FONS_DEF float fonsDrawText(FONScontext* stash,
 	return x;
 }
 
+static unsigned int fons__hashstr(const char* str, int len)
+{
+	// FNV-1a
+	unsigned int h = 2166136261u;
+	int i;
+	for (i = 0; i < len; i++) {
+		h ^= (unsigned char)str[i];
+		h *= 16777619u;
+	}
+	return h;
+}
+
+static int fons__layoutValid(FONScontext* stash, FONSlayout* layout)
+{
+	int i;
+	if (!layout->valid || layout->atlasGeneration != stash->atlasGeneration)
+		return 0;
+	for (i = 0; i < layout->nshelves; i++) {
+		int shelf = layout->shelves[i*2+0];
+		if (shelf >= stash->atlas->nshelves || stash->atlas->shelves[shelf].generation != layout->shelves[i*2+1])
+			return 0;
+	}
+	return 1;
+}
+
+FONS_DEF float fonsDrawTextCached(FONScontext* stash,
+				   float x, float y,
+				   const char* str, const char* end)
+{
+	FONSstate* state;
+	FONSlayout* layout = NULL;
+	unsigned int hash;
+	short isize, iblur;
+	int i, len, n, generation;
+
+	if (stash == NULL) return x;
+	state = fons__getState(stash);
+	isize = (short)(state->size*10.0f);
+	iblur = (short)state->blur;
+
+	if (end == NULL)
+		end = str + strlen(str);
+	len = (int)(end - str);
+	hash = fons__hashstr(str, len);
+
+	for (i = 0; i < FONS_LAYOUT_CACHE_SIZE; i++) {
+		FONSlayout* l = &stash->layouts[i];
+		if (l->str != NULL && l->hash == hash && l->len == len && l->font == state->font &&
+			l->isize == isize && l->iblur == iblur && l->spacing == state->spacing &&
+			l->align == state->align && l->color == state->color && l->x == x && l->y == y &&
+			memcmp(l->str, str, len) == 0) {
+			layout = l;
+			break;
+		}
+	}
+
+	if (layout != NULL && fons__layoutValid(stash, layout)) {
+		// Cache hit, keep the glyphs alive and copy the quads.
+		for (i = 0; i < layout->nshelves; i++)
+			stash->atlas->shelves[layout->shelves[i*2]].lastUsed = stash->frame;
+		layout->lastUsed = stash->frame;
+		fons__flush(stash);
+		for (i = 0; i < layout->nverts; i += n) {
+			n = fons__mini(layout->nverts - i, FONS_VERTEX_COUNT - FONS_VERTEX_COUNT % 6);
+			memcpy(stash->verts, layout->verts + i*2, sizeof(float) * 2 * n);
+			memcpy(stash->tcoords, layout->tcoords + i*2, sizeof(float) * 2 * n);
+			memcpy(stash->colors, layout->colors + i, sizeof(unsigned int) * n);
+			stash->nverts = n;
+			fons__flush(stash);
+		}
+		return layout->advance;
+	}
+
+	if (layout == NULL) {
+		// Replace an unused or the least recently used layout.
+		layout = &stash->layouts[0];
+		for (i = 0; i < FONS_LAYOUT_CACHE_SIZE; i++) {
+			FONSlayout* l = &stash->layouts[i];
+			if (l->str == NULL) {
+				layout = l;
+				break;
+			}
+			if (l->lastUsed < layout->lastUsed)
+				layout = l;
+		}
+		if (layout->str != NULL) free(layout->str);
+		layout->str = (char*)malloc(len > 0 ? len : 1);
+		if (layout->str == NULL)
+			return fonsDrawText(stash, x, y, str, end);
+		memcpy(layout->str, str, len);
+		layout->hash = hash;
+		layout->len = len;
+		layout->font = state->font;
+		layout->isize = isize;
+		layout->iblur = iblur;
+		layout->spacing = state->spacing;
+		layout->align = state->align;
+		layout->color = state->color;
+		layout->x = x;
+		layout->y = y;
+	}
+
+	// Cache miss, record the quads while drawing.
+	fons__flush(stash);
+	layout->nverts = 0;
+	layout->nshelves = 0;
+	layout->valid = 1;
+	layout->lastUsed = stash->frame;
+	generation = stash->atlasGeneration;
+	stash->capture = layout;
+	layout->advance = fonsDrawText(stash, x, y, str, end);
+	stash->capture = NULL;
+	layout->atlasGeneration = generation;
+	if (generation != stash->atlasGeneration)
+		layout->valid = 0;
+
+	return layout->advance;
+}
+
+static int fons__prewarmGlyph(FONScontext* stash, FONSfont* font, unsigned int codepoint, short isize, short iblur)
+{
+	int count = stash->jobCount;
+	fons__getGlyph(stash, font, codepoint, isize, iblur);
+	return stash->jobCount - count;
+}
+
+FONS_DEF int fonsPrewarmText(FONScontext* stash, const char* str, const char* end)
+{
+	FONSstate* state;
+	unsigned int codepoint;
+	unsigned int utf8state = 0;
+	FONSfont* font;
+	int n = 0;
+
+	if (stash == NULL) return 0;
+	state = fons__getState(stash);
+	if (state->font < 0 || state->font >= stash->nfonts) return 0;
+	font = stash->fonts[state->font];
+	if (font->data == NULL) return 0;
+
+	if (end == NULL)
+		end = str + strlen(str);
+
+	stash->deferRaster = 1;
+	for (; str != end; ++str) {
+		if (fons__decutf8(&utf8state, &codepoint, *(const unsigned char*)str))
+			continue;
+		n += fons__prewarmGlyph(stash, font, codepoint, (short)(state->size*10.0f), (short)state->blur);
+	}
+	stash->deferRaster = 0;
+	fons__runRasterJobs(stash);
+
+	return n;
+}
+
+FONS_DEF int fonsPrewarmCodepoints(FONScontext* stash, unsigned int first, unsigned int last)
+{
+	FONSstate* state;
+	FONSfont* font;
+	unsigned int codepoint;
+	int i, n = 0;
+
+	if (stash == NULL) return 0;
+	state = fons__getState(stash);
+	if (state->font < 0 || state->font >= stash->nfonts) return 0;
+	font = stash->fonts[state->font];
+	if (font->data == NULL) return 0;
+
+	stash->deferRaster = 1;
+	for (codepoint = first; codepoint <= last && codepoint >= first; codepoint++) {
+		// Skip codepoints which would only end up as missing glyph boxes.
+		int found = fons__tt_getGlyphIndex(&font->font, codepoint) != 0;
+		for (i = 0; i < font->nfallbacks && !found; i++)
+			found = fons__tt_getGlyphIndex(&stash->fonts[font->fallbacks[i]]->font, codepoint) != 0;
+		if (found)
+			n += fons__prewarmGlyph(stash, font, codepoint, (short)(state->size*10.0f), (short)state->blur);
+	}
+	stash->deferRaster = 0;
+	fons__runRasterJobs(stash);
+
+	return n;
+}
+
 FONS_DEF int fonsTextIterInit(FONScontext* stash, FONStextIter* iter,
 					 float x, float y, const char* str, const char* end)
 {
@@ -1410,20 +1920,22 @@ FONS_DEF void fonsDrawDebug(FONScontext* stash, float x, float y)
 	fons__vertex(stash, x+0, y+h, 0, 1, 0xffffffff);
 	fons__vertex(stash, x+w, y+h, 1, 1, 0xffffffff);
 
-	// Drawbug draw atlas
-	for (i = 0; i < stash->atlas->nnodes; i++) {
-		FONSatlasNode* n = &stash->atlas->nodes[i];
+	// Drawbug draw atlas shelves, cold shelves (not used in this frame) are drawn darker
+	for (i = 0; i < stash->atlas->nshelves; i++) {
+		FONSatlasShelf* n = &stash->atlas->shelves[i];
+		unsigned int col = n->lastUsed >= stash->frame ? 0xc00000ff : 0xc0000080;
+		int sy = n->y + n->height;
 
 		if (stash->nverts+6 > FONS_VERTEX_COUNT)
 			fons__flush(stash);
 
-		fons__vertex(stash, x+n->x+0, y+n->y+0, u, v, 0xc00000ff);
-		fons__vertex(stash, x+n->x+n->width, y+n->y+1, u, v, 0xc00000ff);
-		fons__vertex(stash, x+n->x+n->width, y+n->y+0, u, v, 0xc00000ff);
+		fons__vertex(stash, x+0, y+sy+0, u, v, col);
+		fons__vertex(stash, x+n->x, y+sy+1, u, v, col);
+		fons__vertex(stash, x+n->x, y+sy+0, u, v, col);
 
-		fons__vertex(stash, x+n->x+0, y+n->y+0, u, v, 0xc00000ff);
-		fons__vertex(stash, x+n->x+0, y+n->y+1, u, v, 0xc00000ff);
-		fons__vertex(stash, x+n->x+n->width, y+n->y+1, u, v, 0xc00000ff);
+		fons__vertex(stash, x+0, y+sy+0, u, v, col);
+		fons__vertex(stash, x+0, y+sy+1, u, v, col);
+		fons__vertex(stash, x+n->x, y+sy+1, u, v, col);
 	}
 
 	fons__flush(stash);
@@ -1591,6 +2103,15 @@ FONS_DEF void fonsDeleteInternal(FONScontext* stash)
 	if (stash->fonts) free(stash->fonts);
 	if (stash->texData) free(stash->texData);
 	if (stash->scratch) free(stash->scratch);
+	if (stash->jobs) free(stash->jobs);
+	for (i = 0; i < FONS_LAYOUT_CACHE_SIZE; i++) {
+		FONSlayout* layout = &stash->layouts[i];
+		if (layout->str) free(layout->str);
+		if (layout->verts) free(layout->verts);
+		if (layout->tcoords) free(layout->tcoords);
+		if (layout->colors) free(layout->colors);
+		if (layout->shelves) free(layout->shelves);
+	}
 	free(stash);
 }
 
@@ -1601,6 +2122,13 @@ FONS_DEF void fonsSetErrorCallback(FONScontext* stash, void (*callback)(void* up
 	stash->errorUptr = uptr;
 }
 
+FONS_DEF void fonsSetJobCallback(FONScontext* stash, void (*callback)(void* uptr, void (*job)(void* data, int index), void* data, int count), void* uptr)
+{
+	if (stash == NULL) return;
+	stash->runJobs = callback;
+	stash->jobsUptr = uptr;
+}
+
 FONS_DEF void fonsGetAtlasSize(FONScontext* stash, int* width, int* height)
 {
 	if (stash == NULL) return;
@@ -1610,7 +2138,7 @@ FONS_DEF void fonsGetAtlasSize(FONScontext* stash, int* width, int* height)
 
 FONS_DEF int fonsExpandAtlas(FONScontext* stash, int width, int height)
 {
-	int i, maxy = 0;
+	int i, maxy;
 	unsigned char* data = NULL;
 	if (stash == NULL) return 0;
 
@@ -1649,8 +2177,7 @@ FONS_DEF int fonsExpandAtlas(FONScontext* stash, int width, int height)
 	fons__atlasExpand(stash->atlas, width, height);
 
 	// Add existing data as dirty.
-	for (i = 0; i < stash->atlas->nnodes; i++)
-		maxy = fons__maxi(maxy, stash->atlas->nodes[i].y);
+	maxy = stash->atlas->nexty;
 	stash->dirtyRect[0] = 0;
 	stash->dirtyRect[1] = 0;
 	stash->dirtyRect[2] = stash->params.width;
@@ -1661,12 +2188,15 @@ FONS_DEF int fonsExpandAtlas(FONScontext* stash, int width, int height)
 	stash->itw = 1.0f/stash->params.width;
 	stash->ith = 1.0f/stash->params.height;
 
+	// Cached layouts use the old texture coordinates.
+	stash->atlasGeneration++;
+
 	return 1;
 }
 
 FONS_DEF int fonsResetAtlas(FONScontext* stash, int width, int height)
 {
-	int i, j;
+	int i;
 	if (stash == NULL) return 0;
 
 	// Flush pending glyphs.
@@ -1696,8 +2226,8 @@ FONS_DEF int fonsResetAtlas(FONScontext* stash, int width, int height)
 	for (i = 0; i < stash->nfonts; i++) {
 		FONSfont* font = stash->fonts[i];
 		font->nglyphs = 0;
-		for (j = 0; j < FONS_HASH_LUT_SIZE; j++)
-			font->lut[j] = -1;
+		font->freeGlyph = -1;
+		fons__lutClear(font);
 	}
 
 	stash->params.width = width;
@@ -1705,10 +2235,19 @@ FONS_DEF int fonsResetAtlas(FONScontext* stash, int width, int height)
 	stash->itw = 1.0f/stash->params.width;
 	stash->ith = 1.0f/stash->params.height;
 
+	// Cached layouts refer to the old glyphs.
+	stash->atlasGeneration++;
+
 	// Add white rect at 0,0 for debug drawing.
 	fons__addWhiteRect(stash, 2,2);
 
 	return 1;
 }
 
+FONS_DEF void fonsNextFrame(FONScontext* stash)
+{
+	if (stash == NULL) return;
+	stash->frame++;
+}
+
 #endif // FONTSTASH_IMPLEMENTATION
@@ -0,0 +1,525 @@
+//------------------------------------------------------------------------------
+//  sokol-headless.c
+//
+//  Runs a sokol_app.h sample without a window for performance and
+//  render-regression tests. This is linked instead of the 'sokol' lib,
+//  provides main(), and:
+//
+//  - implements sokol_gfx.h with the dummy backend and trace hooks
+//  - implements the sokol_app.h functions which are commonly called
+//    by the samples (window size, frame duration, sample count, ...)
+//    and sglue_environment()/sglue_swapchain(), but no input or
+//    platform-specific functions
+//  - calls sokol_main() and drives the init/frame/cleanup callbacks
+//    for a number of frames with a fixed frame duration
+//  - counts sokol-gfx calls and resources with trace hooks, and hashes
+//    the per-frame command stream (pass actions, pipelines, bindings,
+//    uniform data, draw parameters, buffer update sizes) so that changes
+//    in rendering show up as different hashes between runs (the dummy
+//    backend doesn't render anything, so there are no pixels to compare)
+//  - writes the results as JSON to stdout or a file
+//
+//  Usage: xxx-headless [--frames N] [--out file.json]
+//
+//  See fips-files/verbs/perfrun.py for running all headless samples.
+//------------------------------------------------------------------------------
+#if defined(_MSC_VER)
+#define _CRT_SECURE_NO_WARNINGS (1)
+#endif
+// the samples are compiled for the backend in the build config, and their
+// shader descs are looked up with sg_query_backend(), so remember that
+// backend and report it from sg_query_backend() (the dummy backend
+// ignores the shader code)
+#if defined(SOKOL_GLCORE)
+#define HEADLESS_SHADER_BACKEND SG_BACKEND_GLCORE
+#elif defined(SOKOL_GLES3)
+#define HEADLESS_SHADER_BACKEND SG_BACKEND_GLES3
+#elif defined(SOKOL_D3D11)
+#define HEADLESS_SHADER_BACKEND SG_BACKEND_D3D11
+#elif defined(SOKOL_METAL)
+#define HEADLESS_SHADER_BACKEND SG_BACKEND_METAL_MACOS
+#elif defined(SOKOL_WGPU)
+#define HEADLESS_SHADER_BACKEND SG_BACKEND_WGPU
+#else
+#define HEADLESS_SHADER_BACKEND SG_BACKEND_DUMMY
+#endif
+// but always use the dummy backend for rendering
+#undef SOKOL_GLCORE
+#undef SOKOL_GLES3
+#undef SOKOL_D3D11
+#undef SOKOL_METAL
+#undef SOKOL_WGPU
+#define SOKOL_DUMMY_BACKEND
+#define SOKOL_TRACE_HOOKS
+#define SOKOL_GFX_IMPL
+#define SOKOL_TIME_IMPL
+#define SOKOL_LOG_IMPL
+// sg_setup() is wrapped below to install the trace hooks right after setup
+#define sg_setup _headless_sg_setup
+#define sg_query_backend _headless_sg_query_backend
+#include "sokol_gfx.h"
+#undef sg_setup
+#undef sg_query_backend
+#include "sokol_time.h"
+#include "sokol_log.h"
+// only the declarations, sokol_app.h is not implemented
+#include "sokol_app.h"
+#include "sokol_glue.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define HEADLESS_DEFAULT_NUM_FRAMES (120)
+#define HEADLESS_FRAME_DURATION (1.0 / 60.0)
+
+typedef enum {
+    CALL_BEGIN_PASS,
+    CALL_APPLY_PIPELINE,
+    CALL_APPLY_BINDINGS,
+    CALL_APPLY_UNIFORMS,
+    CALL_DRAW,
+    CALL_DISPATCH,
+    CALL_UPDATE_BUFFER,
+    CALL_APPEND_BUFFER,
+    CALL_UPDATE_IMAGE,
+    NUM_CALLS,
+} call_t;
+
+static const char* call_names[NUM_CALLS] = {
+    "begin_pass", "apply_pipeline", "apply_bindings", "apply_uniforms", "draw",
+    "dispatch", "update_buffer", "append_buffer", "update_image",
+};
+
+typedef enum {
+    RES_BUFFER,
+    RES_IMAGE,
+    RES_SAMPLER,
+    RES_SHADER,
+    RES_PIPELINE,
+    RES_VIEW,
+    NUM_RES,
+} res_t;
+
+static const char* res_names[NUM_RES] = {
+    "buffers", "images", "samplers", "shaders", "pipelines", "views",
+};
+
+typedef struct {
+    double time_ms;
+    uint32_t calls[NUM_CALLS];
+    uint64_t bytes_uploaded;
+    uint64_t num_elements;
+    uint64_t hash;
+} frame_stats_t;
+
+static struct {
+    sapp_desc desc;
+    int width;
+    int height;
+    int sample_count;
+    uint64_t frame_count;
+    bool quit_requested;
+    bool mouse_shown;
+    bool mouse_locked;
+    int num_frames;
+    const char* out_path;
+    const char* name;
+    frame_stats_t* frames;
+    frame_stats_t* cur;     // 0 during init and cleanup
+    int resources[NUM_RES];
+    int peak_resources[NUM_RES];
+    uint64_t hash;
+} state;
+
+//== sokol_app.h subset ========================================================
+int sapp_width(void) { return state.width; }
+float sapp_widthf(void) { return (float)state.width; }
+int sapp_height(void) { return state.height; }
+float sapp_heightf(void) { return (float)state.height; }
+int sapp_color_format(void) { return (int)SG_PIXELFORMAT_RGBA8; }
+int sapp_depth_format(void) { return (int)SG_PIXELFORMAT_DEPTH_STENCIL; }
+int sapp_sample_count(void) { return state.sample_count; }
+bool sapp_high_dpi(void) { return false; }
+float sapp_dpi_scale(void) { return 1.0f; }
+uint64_t sapp_frame_count(void) { return state.frame_count; }
+double sapp_frame_duration(void) { return HEADLESS_FRAME_DURATION; }
+bool sapp_isvalid(void) { return true; }
+void* sapp_userdata(void) { return state.desc.user_data; }
+sapp_desc sapp_query_desc(void) { return state.desc; }
+void sapp_request_quit(void) { state.quit_requested = true; }
+void sapp_quit(void) { state.quit_requested = true; }
+void sapp_set_window_title(const char* str) { (void)str; }
+void sapp_show_mouse(bool show) { state.mouse_shown = show; }
+bool sapp_mouse_shown(void) { return state.mouse_shown; }
+void sapp_lock_mouse(bool lock) { state.mouse_locked = lock; }
+bool sapp_mouse_locked(void) { return state.mouse_locked; }
+
+//== sokol_glue.h ==============================================================
+sg_environment sglue_environment(void) {
+    sg_environment env;
+    memset(&env, 0, sizeof(env));
+    env.defaults.color_format = (sg_pixel_format) sapp_color_format();
+    env.defaults.depth_format = (sg_pixel_format) sapp_depth_format();
+    env.defaults.sample_count = sapp_sample_count();
+    return env;
+}
+
+sg_swapchain sglue_swapchain(void) {
+    sg_swapchain swapchain;
+    memset(&swapchain, 0, sizeof(swapchain));
+    swapchain.width = sapp_width();
+    swapchain.height = sapp_height();
+    swapchain.sample_count = sapp_sample_count();
+    swapchain.color_format = (sg_pixel_format) sapp_color_format();
+    swapchain.depth_format = (sg_pixel_format) sapp_depth_format();
+    return swapchain;
+}
+
+//== trace hooks ===============================================================
+// FNV-1a
+static void hash_bytes(const void* ptr, size_t size) {
+    const uint8_t* bytes = (const uint8_t*)ptr;
+    uint64_t h = state.hash;
+    for (size_t i = 0; i < size; i++) {
+        h = (h ^ bytes[i]) * 0x100000001B3ULL;
+    }
+    state.hash = h;
+}
+
+static void count_call(call_t call) {
+    if (state.cur) {
+        state.cur->calls[call]++;
+    }
+    hash_bytes(&call, sizeof(call));
+}
+
+static void count_resource(res_t res, int delta) {
+    state.resources[res] += delta;
+    if (state.resources[res] > state.peak_resources[res]) {
+        state.peak_resources[res] = state.resources[res];
+    }
+}
+
+static void count_upload(size_t size) {
+    if (state.cur) {
+        state.cur->bytes_uploaded += size;
+    }
+}
+
+static void trace_make_buffer(const sg_buffer_desc* desc, sg_buffer result, void* user_data) {
+    (void)desc; (void)result; (void)user_data;
+    count_resource(RES_BUFFER, 1);
+}
+
+static void trace_make_image(const sg_image_desc* desc, sg_image result, void* user_data) {
+    (void)desc; (void)result; (void)user_data;
+    count_resource(RES_IMAGE, 1);
+}
+
+static void trace_make_sampler(const sg_sampler_desc* desc, sg_sampler result, void* user_data) {
+    (void)desc; (void)result; (void)user_data;
+    count_resource(RES_SAMPLER, 1);
+}
+
+static void trace_make_shader(const sg_shader_desc* desc, sg_shader result, void* user_data) {
+    (void)desc; (void)result; (void)user_data;
+    count_resource(RES_SHADER, 1);
+}
+
+static void trace_make_pipeline(const sg_pipeline_desc* desc, sg_pipeline result, void* user_data) {
+    (void)desc; (void)result; (void)user_data;
+    count_resource(RES_PIPELINE, 1);
+}
+
+static void trace_make_view(const sg_view_desc* desc, sg_view result, void* user_data) {
+    (void)desc; (void)result; (void)user_data;
+    count_resource(RES_VIEW, 1);
+}
+
+static void trace_destroy_buffer(sg_buffer buf, void* user_data) {
+    (void)buf; (void)user_data;
+    count_resource(RES_BUFFER, -1);
+}
+
+static void trace_destroy_image(sg_image img, void* user_data) {
+    (void)img; (void)user_data;
+    count_resource(RES_IMAGE, -1);
+}
+
+static void trace_destroy_sampler(sg_sampler smp, void* user_data) {
+    (void)smp; (void)user_data;
+    count_resource(RES_SAMPLER, -1);
+}
+
+static void trace_destroy_shader(sg_shader shd, void* user_data) {
+    (void)shd; (void)user_data;
+    count_resource(RES_SHADER, -1);
+}
+
+static void trace_destroy_pipeline(sg_pipeline pip, void* user_data) {
+    (void)pip; (void)user_data;
+    count_resource(RES_PIPELINE, -1);
+}
+
+static void trace_destroy_view(sg_view view, void* user_data) {
+    (void)view; (void)user_data;
+    count_resource(RES_VIEW, -1);
+}
+
+static void trace_begin_pass(const sg_pass* pass, void* user_data) {
+    (void)user_data;
+    count_call(CALL_BEGIN_PASS);
+    hash_bytes(&pass->action, sizeof(pass->action));
+}
+
+static void trace_apply_pipeline(sg_pipeline pip, void* user_data) {
+    (void)user_data;
+    count_call(CALL_APPLY_PIPELINE);
+    hash_bytes(&pip, sizeof(pip));
+}
+
+static void trace_apply_bindings(const sg_bindings* bindings, void* user_data) {
+    (void)user_data;
+    count_call(CALL_APPLY_BINDINGS);
+    hash_bytes(bindings, sizeof(sg_bindings));
+}
+
+static void trace_apply_uniforms(int ub_slot, const sg_range* data, void* user_data) {
+    (void)user_data;
+    count_call(CALL_APPLY_UNIFORMS);
+    hash_bytes(&ub_slot, sizeof(ub_slot));
+    hash_bytes(data->ptr, data->size);
+}
+
+static void trace_draw(int base_element, int num_elements, int num_instances, void* user_data) {
+    (void)user_data;
+    count_call(CALL_DRAW);
+    if (state.cur) {
+        state.cur->num_elements += (uint64_t)num_elements * (uint64_t)num_instances;
+    }
+    const int params[3] = { base_element, num_elements, num_instances };
+    hash_bytes(params, sizeof(params));
+}
+
+static void trace_dispatch(int num_groups_x, int num_groups_y, int num_groups_z, void* user_data) {
+    (void)user_data;
+    count_call(CALL_DISPATCH);
+    const int params[3] = { num_groups_x, num_groups_y, num_groups_z };
+    hash_bytes(params, sizeof(params));
+}
+
+static void trace_update_buffer(sg_buffer buf, const sg_range* data, void* user_data) {
+    (void)buf; (void)user_data;
+    count_call(CALL_UPDATE_BUFFER);
+    count_upload(data->size);
+    // only hash the size, samples which display their own timings
+    // via sokol_debugtext.h would otherwise never produce the same hash
+    hash_bytes(&data->size, sizeof(data->size));
+}
+
+static void trace_append_buffer(sg_buffer buf, const sg_range* data, int result, void* user_data) {
+    (void)buf; (void)result; (void)user_data;
+    count_call(CALL_APPEND_BUFFER);
+    count_upload(data->size);
+    hash_bytes(&data->size, sizeof(data->size));
+}
+
+static void trace_update_image(sg_image img, const sg_image_data* data, void* user_data) {
+    (void)img; (void)user_data;
+    count_call(CALL_UPDATE_IMAGE);
+    for (int face = 0; face < SG_CUBEFACE_NUM; face++) {
+        for (int mip = 0; mip < SG_MAX_MIPMAPS; mip++) {
+            count_upload(data->subimage[face][mip].size);
+        }
+    }
+}
+
+//== runner ====================================================================
+void sg_setup(const sg_desc* desc) {
+    _headless_sg_setup(desc);
+    sg_install_trace_hooks(&(sg_trace_hooks){
+        .make_buffer = trace_make_buffer,
+        .make_image = trace_make_image,
+        .make_sampler = trace_make_sampler,
+        .make_shader = trace_make_shader,
+        .make_pipeline = trace_make_pipeline,
+        .make_view = trace_make_view,
+        .destroy_buffer = trace_destroy_buffer,
+        .destroy_image = trace_destroy_image,
+        .destroy_sampler = trace_destroy_sampler,
+        .destroy_shader = trace_destroy_shader,
+        .destroy_pipeline = trace_destroy_pipeline,
+        .destroy_view = trace_destroy_view,
+        .begin_pass = trace_begin_pass,
+        .apply_pipeline = trace_apply_pipeline,
+        .apply_bindings = trace_apply_bindings,
+        .apply_uniforms = trace_apply_uniforms,
+        .draw = trace_draw,
+        .dispatch = trace_dispatch,
+        .update_buffer = trace_update_buffer,
+        .append_buffer = trace_append_buffer,
+        .update_image = trace_update_image,
+    });
+}
+
+sg_backend sg_query_backend(void) {
+    return HEADLESS_SHADER_BACKEND;
+}
+
+static void call_init(void) {
+    if (state.desc.init_cb) {
+        state.desc.init_cb();
+    } else if (state.desc.init_userdata_cb) {
+        state.desc.init_userdata_cb(state.desc.user_data);
+    }
+}
+
+static void call_frame(void) {
+    if (state.desc.frame_cb) {
+        state.desc.frame_cb();
+    } else if (state.desc.frame_userdata_cb) {
+        state.desc.frame_userdata_cb(state.desc.user_data);
+    }
+}
+
+static void call_cleanup(void) {
+    if (state.desc.cleanup_cb) {
+        state.desc.cleanup_cb();
+    } else if (state.desc.cleanup_userdata_cb) {
+        state.desc.cleanup_userdata_cb(state.desc.user_data);
+    }
+}
+
+static int compare_double(const void* a, const void* b) {
+    const double da = *(const double*)a;
+    const double db = *(const double*)b;
+    return (da < db) ? -1 : ((da > db) ? 1 : 0);
+}
+
+static void write_json(FILE* fp, double init_ms, double cleanup_ms) {
+    const int n = (int)state.frame_count;
+    double* times = (double*) malloc((size_t)(n > 0 ? n : 1) * sizeof(double));
+    double sum = 0.0;
+    for (int i = 0; i < n; i++) {
+        times[i] = state.frames[i].time_ms;
+        sum += times[i];
+    }
+    qsort(times, (size_t)n, sizeof(double), compare_double);
+    fprintf(fp, "{\n");
+    fprintf(fp, "  \"sample\": \"%s\",\n", state.name);
+    fprintf(fp, "  \"width\": %d,\n  \"height\": %d,\n  \"sample_count\": %d,\n", state.width, state.height, state.sample_count);
+    fprintf(fp, "  \"num_frames\": %d,\n", n);
+    fprintf(fp, "  \"frame_duration\": %f,\n", HEADLESS_FRAME_DURATION);
+    fprintf(fp, "  \"init_ms\": %.3f,\n  \"cleanup_ms\": %.3f,\n", init_ms, cleanup_ms);
+    if (n > 0) {
+        fprintf(fp, "  \"frame_ms\": { \"mean\": %.4f, \"median\": %.4f, \"p95\": %.4f, \"max\": %.4f },\n",
+            sum / n, times[n / 2], times[(n * 95) / 100], times[n - 1]);
+    }
+    fprintf(fp, "  \"calls_per_frame\": {");
+    for (int c = 0; c < NUM_CALLS; c++) {
+        double total = 0.0;
+        for (int i = 0; i < n; i++) {
+            total += state.frames[i].calls[c];
+        }
+        fprintf(fp, "%s \"%s\": %.2f", (c > 0) ? "," : "", call_names[c], (n > 0) ? (total / n) : 0.0);
+    }
+    fprintf(fp, " },\n");
+    double bytes = 0.0, elements = 0.0;
+    for (int i = 0; i < n; i++) {
+        bytes += (double)state.frames[i].bytes_uploaded;
+        elements += (double)state.frames[i].num_elements;
+    }
+    fprintf(fp, "  \"bytes_uploaded_per_frame\": %.1f,\n", (n > 0) ? (bytes / n) : 0.0);
+    fprintf(fp, "  \"elements_per_frame\": %.1f,\n", (n > 0) ? (elements / n) : 0.0);
+    fprintf(fp, "  \"peak_resources\": {");
+    for (int r = 0; r < NUM_RES; r++) {
+        fprintf(fp, "%s \"%s\": %d", (r > 0) ? "," : "", res_names[r], state.peak_resources[r]);
+    }
+    fprintf(fp, " },\n");
+    fprintf(fp, "  \"command_hash\": \"%016llx\",\n", (unsigned long long)state.hash);
+    fprintf(fp, "  \"frames\": [\n");
+    for (int i = 0; i < n; i++) {
+        const frame_stats_t* f = &state.frames[i];
+        fprintf(fp, "    { \"ms\": %.4f, \"draws\": %u, \"uniforms\": %u, \"bytes\": %llu, \"hash\": \"%016llx\" }%s\n",
+            f->time_ms, f->calls[CALL_DRAW], f->calls[CALL_APPLY_UNIFORMS],
+            (unsigned long long)f->bytes_uploaded, (unsigned long long)f->hash, (i < (n - 1)) ? "," : "");
+    }
+    fprintf(fp, "  ]\n}\n");
+    free(times);
+}
+
+static const char* sample_name(const char* path) {
+    const char* name = path;
+    for (const char* p = path; *p; p++) {
+        if ((*p == '/') || (*p == '\\')) {
+            name = p + 1;
+        }
+    }
+    return name;
+}
+
+int main(int argc, char* argv[]) {
+    state.num_frames = HEADLESS_DEFAULT_NUM_FRAMES;
+    state.name = sample_name(argv[0]);
+    for (int i = 1; i < argc; i++) {
+        if ((0 == strcmp(argv[i], "--frames")) && ((i + 1) < argc)) {
+            state.num_frames = atoi(argv[++i]);
+        } else if ((0 == strcmp(argv[i], "--out")) && ((i + 1) < argc)) {
+            state.out_path = argv[++i];
+        } else {
+            fprintf(stderr, "usage: %s [--frames N] [--out file.json]\n", state.name);
+            return 10;
+        }
+    }
+    if (state.num_frames < 1) {
+        state.num_frames = 1;
+    }
+    state.frames = (frame_stats_t*) calloc((size_t)state.num_frames, sizeof(frame_stats_t));
+    state.mouse_shown = true;
+    stm_setup();
+
+    // the sample's sokol_main() only fills in the desc, the argument
+    // parsing above only uses the harness arguments
+    char* sample_argv[1] = { argv[0] };
+    state.desc = sokol_main(1, sample_argv);
+    state.width = (state.desc.width > 0) ? state.desc.width : 640;
+    state.height = (state.desc.height > 0) ? state.desc.height : 480;
+    state.sample_count = (state.desc.sample_count > 0) ? state.desc.sample_count : 1;
+    state.hash = 0xCBF29CE484222325ULL;
+
+    uint64_t start = stm_now();
+    call_init();
+    const double init_ms = stm_ms(stm_since(start));
+    while ((state.frame_count < (uint64_t)state.num_frames) && !state.quit_requested) {
+        frame_stats_t* f = &state.frames[state.frame_count];
+        state.cur = f;
+        const uint64_t frame_hash_start = state.hash;
+        start = stm_now();
+        call_frame();
+        f->time_ms = stm_ms(stm_since(start));
+        // per-frame hash: the running hash state at the end of this frame,
+        // mixed with the state at its start, so a change shows up in the
+        // first frame it happens in and all following frames
+        f->hash = state.hash ^ (frame_hash_start * 0x9E3779B97F4A7C15ULL);
+        state.cur = 0;
+        state.frame_count++;
+    }
+    start = stm_now();
+    call_cleanup();
+    const double cleanup_ms = stm_ms(stm_since(start));
+
+    FILE* fp = stdout;
+    if (state.out_path) {
+        fp = fopen(state.out_path, "w");
+        if (!fp) {
+            fprintf(stderr, "failed to open '%s'\n", state.out_path);
+            return 10;
+        }
+    }
+    write_json(fp, init_ms, cleanup_ms);
+    if (fp != stdout) {
+        fclose(fp);
+    }
+    free(state.frames);
+    return 0;
+}
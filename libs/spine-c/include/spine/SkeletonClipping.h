@@ -40,6 +40,19 @@
 extern "C" {
 #endif
 
+/* Convex decomposition of a clipping attachment, stored as vertex offsets into the
+ * attachment's world vertices so it can be reused across frames as long as the
+ * attachment is only moved by an affine bone transform (no weights, no deform). */
+typedef struct spClippingPolygonCache {
+	spClippingAttachment *attachment;
+	int attachmentId;
+	int worldVerticesLength;
+	int /*boolean*/ reversed;
+	spArrayShortArray *polygonIndices;
+} spClippingPolygonCache;
+
+_SP_ARRAY_DECLARE_TYPE(spClippingPolygonCacheArray, spClippingPolygonCache *)
+
 typedef struct spSkeletonClipping {
 	spTriangulator *triangulator;
 	spFloatArray *clippingPolygon;
@@ -50,6 +63,18 @@ typedef struct spSkeletonClipping {
 	spFloatArray *scratch;
 	spClippingAttachment *clipAttachment;
 	spArrayFloatArray *clippingPolygons;
+
+	/* per-attachment decomposition cache and the polygons rebuilt from it */
+	spClippingPolygonCacheArray *polygonCaches;
+	int nextPolygonCache;
+	spArrayFloatArray *cachedPolygons;
+	spArrayFloatArray *cachedPolygonPool;
+
+	/* per-polygon AABB (minX, minY, maxX, maxY) and edge data in SoA layout,
+	 * padded to a multiple of 4 edges for the batched inside test */
+	spFloatArray *clippingBounds;
+	spFloatArray *clippingEdges;
+	spIntArray *clippingEdgeOffsets;
 } spSkeletonClipping;
 
 SP_API spSkeletonClipping *spSkeletonClipping_create(void);
@@ -30,6 +30,16 @@
 #include <spine/SkeletonClipping.h>
 #include <spine/extension.h>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SP_CLIPPING_SSE2
+#include <emmintrin.h>
+#endif
+
+/* upper bound of clipping attachments whose decomposition is kept around */
+#define MAX_POLYGON_CACHES 32
+
+_SP_ARRAY_IMPLEMENT_TYPE(spClippingPolygonCacheArray, spClippingPolygonCache *)
+
 spSkeletonClipping *spSkeletonClipping_create(void) {
 	spSkeletonClipping *clipping = CALLOC(spSkeletonClipping, 1);
 
@@ -40,11 +50,26 @@ spSkeletonClipping *spSkeletonClipping_create(void) {
 	clipping->clippedUVs = spFloatArray_create(128);
 	clipping->clippedTriangles = spUnsignedShortArray_create(128);
 	clipping->scratch = spFloatArray_create(128);
+	clipping->polygonCaches = spClippingPolygonCacheArray_create(4);
+	clipping->cachedPolygons = spArrayFloatArray_create(16);
+	clipping->cachedPolygonPool = spArrayFloatArray_create(16);
+	clipping->clippingBounds = spFloatArray_create(64);
+	clipping->clippingEdges = spFloatArray_create(256);
+	clipping->clippingEdgeOffsets = spIntArray_create(32);
 
 	return clipping;
 }
 
+static void _disposePolygonIndices(spArrayShortArray *polygonIndices) {
+	int i;
+	for (i = 0; i < polygonIndices->size; i++) {
+		spShortArray_dispose(polygonIndices->items[i]);
+	}
+	spArrayShortArray_clear(polygonIndices);
+}
+
 void spSkeletonClipping_dispose(spSkeletonClipping *self) {
+	int i;
 	spTriangulator_dispose(self->triangulator);
 	spFloatArray_dispose(self->clippingPolygon);
 	spFloatArray_dispose(self->clipOutput);
@@ -52,10 +77,26 @@ void spSkeletonClipping_dispose(spSkeletonClipping *self) {
 	spFloatArray_dispose(self->clippedUVs);
 	spUnsignedShortArray_dispose(self->clippedTriangles);
 	spFloatArray_dispose(self->scratch);
+	for (i = 0; i < self->polygonCaches->size; i++) {
+		spClippingPolygonCache *cache = self->polygonCaches->items[i];
+		_disposePolygonIndices(cache->polygonIndices);
+		spArrayShortArray_dispose(cache->polygonIndices);
+		FREE(cache);
+	}
+	spClippingPolygonCacheArray_dispose(self->polygonCaches);
+	for (i = 0; i < self->cachedPolygonPool->size; i++) {
+		spFloatArray_dispose(self->cachedPolygonPool->items[i]);
+	}
+	spArrayFloatArray_dispose(self->cachedPolygonPool);
+	spArrayFloatArray_dispose(self->cachedPolygons);
+	spFloatArray_dispose(self->clippingBounds);
+	spFloatArray_dispose(self->clippingEdges);
+	spIntArray_dispose(self->clippingEdgeOffsets);
 	FREE(self);
 }
 
-static void _makeClockwise(spFloatArray *polygon) {
+/* Returns 1 if the vertex order had to be reversed. */
+static int _makeClockwise(spFloatArray *polygon) {
 	int i, n, lastX;
 	float *vertices = polygon->items;
 	int verticeslength = polygon->size;
@@ -70,7 +111,7 @@ static void _makeClockwise(spFloatArray *polygon) {
 		p2y = vertices[i + 3];
 		area += p1x * p2y - p2x * p1y;
 	}
-	if (area < 0) return;
+	if (area < 0) return 0;
 
 	for (i = 0, lastX = verticeslength - 2, n = verticeslength >> 1; i < n; i += 2) {
 		float x = vertices[i], y = vertices[i + 1];
@@ -80,27 +121,151 @@ static void _makeClockwise(spFloatArray *polygon) {
 		vertices[other] = x;
 		vertices[other + 1] = y;
 	}
+	return 1;
+}
+
+static spClippingPolygonCache *_findPolygonCache(spSkeletonClipping *self, spClippingAttachment *clip) {
+	int i;
+	for (i = 0; i < self->polygonCaches->size; i++) {
+		spClippingPolygonCache *cache = self->polygonCaches->items[i];
+		/* the attachment id guards against a new attachment reusing a disposed attachment's address */
+		if (cache->attachment == clip && cache->attachmentId == clip->super.id) return cache;
+	}
+	return 0;
+}
+
+static spClippingPolygonCache *_obtainPolygonCache(spSkeletonClipping *self, spClippingAttachment *clip) {
+	spClippingPolygonCache *cache;
+	if (self->polygonCaches->size < MAX_POLYGON_CACHES) {
+		cache = CALLOC(spClippingPolygonCache, 1);
+		cache->polygonIndices = spArrayShortArray_create(4);
+		spClippingPolygonCacheArray_add(self->polygonCaches, cache);
+	} else {
+		cache = self->polygonCaches->items[self->nextPolygonCache];
+		self->nextPolygonCache = (self->nextPolygonCache + 1) % MAX_POLYGON_CACHES;
+		_disposePolygonIndices(cache->polygonIndices);
+	}
+	cache->attachment = clip;
+	cache->attachmentId = clip->super.id;
+	return cache;
+}
+
+static spArrayFloatArray *_polygonsFromCache(spSkeletonClipping *self, spClippingPolygonCache *cache) {
+	int i, ii, n;
+	float *vertices = self->clippingPolygon->items;
+	spArrayFloatArray *polygons = self->cachedPolygons;
+	spArrayFloatArray_clear(polygons);
+	for (i = 0; i < cache->polygonIndices->size; i++) {
+		spShortArray *indices = cache->polygonIndices->items[i];
+		spFloatArray *polygon;
+		float *items;
+		if (i < self->cachedPolygonPool->size) polygon = self->cachedPolygonPool->items[i];
+		else {
+			polygon = spFloatArray_create(16);
+			spArrayFloatArray_add(self->cachedPolygonPool, polygon);
+		}
+		n = indices->size;
+		items = spFloatArray_setSize(polygon, (n << 1) + 2)->items;
+		for (ii = 0; ii < n; ii++) {
+			int offset = indices->items[ii];
+			items[ii << 1] = vertices[offset];
+			items[(ii << 1) + 1] = vertices[offset + 1];
+		}
+		items[n << 1] = items[0];
+		items[(n << 1) + 1] = items[1];
+		spArrayFloatArray_add(polygons, polygon);
+	}
+	return polygons;
+}
+
+/* Precomputes the per-polygon AABBs and edge equations used by the trivial reject/accept tests. */
+static void _prepareClippingPolygons(spSkeletonClipping *self) {
+	int i, ii, n = self->clippingPolygons->size;
+	float *bounds = spFloatArray_setSize(self->clippingBounds, n << 2)->items;
+	int *offsets = spIntArray_setSize(self->clippingEdgeOffsets, n << 1)->items;
+	int offset = 0;
+	for (i = 0; i < n; i++) {
+		int edgeCount = (self->clippingPolygons->items[i]->size - 2) >> 1;
+		offsets[i << 1] = offset;
+		offsets[(i << 1) + 1] = (edgeCount + 3) & ~3;
+		offset += offsets[(i << 1) + 1] << 2;
+	}
+	spFloatArray_setSize(self->clippingEdges, offset);
+	for (i = 0; i < n; i++) {
+		spFloatArray *polygon = self->clippingPolygons->items[i];
+		float *vertices = polygon->items;
+		int edgeCount = (polygon->size - 2) >> 1;
+		int padded = offsets[(i << 1) + 1];
+		float *edgeX = self->clippingEdges->items + offsets[i << 1];
+		float *edgeY = edgeX + padded, *ex = edgeY + padded, *ey = ex + padded;
+		float minX = vertices[0], minY = vertices[1], maxX = vertices[0], maxY = vertices[1];
+		for (ii = 0; ii < padded; ii++) {
+			/* padding repeats the first edge, which doesn't change the result */
+			int v = (ii < edgeCount ? ii : 0) << 1;
+			edgeX[ii] = vertices[v];
+			edgeY[ii] = vertices[v + 1];
+			ex[ii] = vertices[v] - vertices[v + 2];
+			ey[ii] = vertices[v + 1] - vertices[v + 3];
+			minX = MIN(minX, vertices[v]);
+			minY = MIN(minY, vertices[v + 1]);
+			maxX = MAX(maxX, vertices[v]);
+			maxY = MAX(maxY, vertices[v + 1]);
+		}
+		bounds[i << 2] = minX;
+		bounds[(i << 2) + 1] = minY;
+		bounds[(i << 2) + 2] = maxX;
+		bounds[(i << 2) + 3] = maxY;
+	}
 }
 
 int spSkeletonClipping_clipStart(spSkeletonClipping *self, spSlot *slot, spClippingAttachment *clip) {
-	int i, n;
+	int i, n, reversed;
 	float *vertices;
+	spClippingPolygonCache *cache = 0;
 	if (self->clipAttachment) return 0;
 	self->clipAttachment = clip;
 
 	n = clip->super.worldVerticesLength;
 	vertices = spFloatArray_setSize(self->clippingPolygon, n)->items;
 	spVertexAttachment_computeWorldVertices(SUPER(clip), slot, 0, n, vertices, 0, 2);
-	_makeClockwise(self->clippingPolygon);
+	reversed = _makeClockwise(self->clippingPolygon);
+
+	/* Unweighted, undeformed attachments are only moved by an affine bone transform, which
+	 * keeps the convex decomposition valid unless the transform flips the winding. */
+	if (!clip->super.bones && slot->deformCount == 0) {
+		cache = _findPolygonCache(self, clip);
+		if (cache && cache->reversed == reversed && cache->worldVerticesLength == n) {
+			self->clippingPolygons = _polygonsFromCache(self, cache);
+			_prepareClippingPolygons(self);
+			return self->clippingPolygons->size;
+		}
+		if (cache) _disposePolygonIndices(cache->polygonIndices);
+		else
+			cache = _obtainPolygonCache(self, clip);
+		cache->reversed = reversed;
+		cache->worldVerticesLength = n;
+	}
+
 	self->clippingPolygons = spTriangulator_decompose(self->triangulator, self->clippingPolygon,
 													  spTriangulator_triangulate(self->triangulator,
 																				 self->clippingPolygon));
 	for (i = 0, n = self->clippingPolygons->size; i < n; i++) {
 		spFloatArray *polygon = self->clippingPolygons->items[i];
-		_makeClockwise(polygon);
+		int polygonReversed = _makeClockwise(polygon);
+		if (cache) {
+			spShortArray *source = self->triangulator->convexPolygonsIndices->items[i];
+			spShortArray *indices = spShortArray_create(source->size);
+			int ii, count = source->size;
+			spShortArray_setSize(indices, count);
+			for (ii = 0; ii < count; ii++) {
+				indices->items[ii] = source->items[polygonReversed ? count - 1 - ii : ii];
+			}
+			spArrayShortArray_add(cache->polygonIndices, indices);
+		}
 		spFloatArray_add(polygon, polygon->items[0]);
 		spFloatArray_add(polygon, polygon->items[1]);
 	}
+	_prepareClippingPolygons(self);
 	return self->clippingPolygons->size;
 }
 
@@ -218,6 +383,36 @@ _clip(spSkeletonClipping *self, float x1, float y1, float x2, float y2, float x3
 	return clipped;
 }
 
+/* Returns 1 if all three triangle vertices are strictly inside the convex polygon, using the
+ * same edge test as _clip(), so an accepted triangle is exactly one that _clip() would leave
+ * unclipped. Edges are tested 4 at a time. */
+static int _containsTriangle(const float *edges, int paddedEdgeCount, float x1, float y1, float x2, float y2,
+							 float x3, float y3) {
+	const float *edgeX = edges, *edgeY = edges + paddedEdgeCount;
+	const float *ex = edgeY + paddedEdgeCount, *ey = ex + paddedEdgeCount;
+	int i;
+#ifdef SP_CLIPPING_SSE2
+	__m128 px1 = _mm_set1_ps(x1), py1 = _mm_set1_ps(y1);
+	__m128 px2 = _mm_set1_ps(x2), py2 = _mm_set1_ps(y2);
+	__m128 px3 = _mm_set1_ps(x3), py3 = _mm_set1_ps(y3);
+	for (i = 0; i < paddedEdgeCount; i += 4) {
+		__m128 eX = _mm_loadu_ps(edgeX + i), eY = _mm_loadu_ps(edgeY + i);
+		__m128 dX = _mm_loadu_ps(ex + i), dY = _mm_loadu_ps(ey + i);
+		__m128 inside = _mm_cmpgt_ps(_mm_mul_ps(dY, _mm_sub_ps(eX, px1)), _mm_mul_ps(dX, _mm_sub_ps(eY, py1)));
+		inside = _mm_and_ps(inside, _mm_cmpgt_ps(_mm_mul_ps(dY, _mm_sub_ps(eX, px2)), _mm_mul_ps(dX, _mm_sub_ps(eY, py2))));
+		inside = _mm_and_ps(inside, _mm_cmpgt_ps(_mm_mul_ps(dY, _mm_sub_ps(eX, px3)), _mm_mul_ps(dX, _mm_sub_ps(eY, py3))));
+		if (_mm_movemask_ps(inside) != 0xF) return 0;
+	}
+#else
+	for (i = 0; i < paddedEdgeCount; i++) {
+		if (!(ey[i] * (edgeX[i] - x1) > ex[i] * (edgeY[i] - y1))) return 0;
+		if (!(ey[i] * (edgeX[i] - x2) > ex[i] * (edgeY[i] - y2))) return 0;
+		if (!(ey[i] * (edgeX[i] - x3) > ex[i] * (edgeY[i] - y3))) return 0;
+	}
+#endif
+	return 1;
+}
+
 void spSkeletonClipping_clipTriangles(spSkeletonClipping *self, float *vertices, int verticesLength,
 									  unsigned short *triangles, int trianglesLength, float *uvs, int stride) {
 	int i;
@@ -227,17 +422,25 @@ void spSkeletonClipping_clipTriangles(spSkeletonClipping *self, float *vertices,
 	spUnsignedShortArray *clippedTriangles = self->clippedTriangles;
 	spFloatArray **polygons = self->clippingPolygons->items;
 	int polygonsCount = self->clippingPolygons->size;
+	float *bounds = self->clippingBounds->items;
+	float *edges = self->clippingEdges->items;
+	int *edgeOffsets = self->clippingEdgeOffsets->items;
 
 	short index = 0;
 	spFloatArray_clear(clippedVertices);
 	spFloatArray_clear(clippedUVs);
 	spUnsignedShortArray_clear(clippedTriangles);
+	/* reserve for the common case of every triangle passing unclipped, to avoid growing per triangle */
+	spFloatArray_ensureCapacity(clippedVertices, trianglesLength << 1);
+	spFloatArray_ensureCapacity(clippedUVs, trianglesLength << 1);
+	spUnsignedShortArray_ensureCapacity(clippedTriangles, trianglesLength);
 	i = 0;
 continue_outer:
 	for (; i < trianglesLength; i += 3) {
 		int p;
 		int vertexOffset = triangles[i] * stride;
 		float x2, y2, u2, v2, x3, y3, u3, v3;
+		float minX, minY, maxX, maxY;
 		float x1 = vertices[vertexOffset], y1 = vertices[vertexOffset + 1];
 		float u1 = uvs[vertexOffset], v1 = uvs[vertexOffset + 1];
 
@@ -253,9 +456,19 @@ continue_outer:
 		u3 = uvs[vertexOffset];
 		v3 = uvs[vertexOffset + 1];
 
+		minX = MIN(x1, MIN(x2, x3));
+		minY = MIN(y1, MIN(y2, y3));
+		maxX = MAX(x1, MAX(x2, x3));
+		maxY = MAX(y1, MAX(y2, y3));
+
 		for (p = 0; p < polygonsCount; p++) {
 			int s = clippedVertices->size;
-			if (_clip(self, x1, y1, x2, y2, x3, y3, polygons[p], clipOutput)) {
+			float *polygonBounds = bounds + (p << 2);
+			/* trivial reject: triangle can't overlap this convex polygon */
+			if (maxX < polygonBounds[0] || maxY < polygonBounds[1] || minX > polygonBounds[2] || minY > polygonBounds[3]) continue;
+			/* trivial accept: fully inside, skip Sutherland-Hodgman and emit the triangle as is */
+			if (!_containsTriangle(edges + edgeOffsets[p << 1], edgeOffsets[(p << 1) + 1], x1, y1, x2, y2, x3, y3) &&
+				_clip(self, x1, y1, x2, y2, x3, y3, polygons[p], clipOutput)) {
 				int ii;
 				float d0, d1, d2, d4, d;
 				unsigned short *clippedTrianglesItems;
@@ -3,7 +3,23 @@
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wunused-function"
 #endif
+// PNG files go through libs/util/pngdec.h first, see stbi_load_from_memory() below
+#define stbi_load_from_memory stbi__stock_load_from_memory
 #include "stb_image.h"
+#undef stbi_load_from_memory
 #if defined(__clang__)
 #pragma clang diagnostic pop
 #endif
+#include "util/pngdec.h"
+
+// pngdec handles the common 8-bit PNG variants, everything else (and all
+// errors, to get the stb_image failure reasons) goes to stb_image
+STBIDEF stbi_uc *stbi_load_from_memory(stbi_uc const *buffer, int len, int *x, int *y, int *comp, int req_comp) {
+    if (!stbi__vertically_flip_on_load && (len > 0) && (req_comp >= 0) && (req_comp <= 4)) {
+        stbi_uc* pixels = 0;
+        if (pngdec_decode(buffer, (size_t)len, req_comp, &pixels, x, y, comp) == PNGDEC_OK) {
+            return pixels;
+        }
+    }
+    return stbi__stock_load_from_memory(buffer, len, x, y, comp, req_comp);
+}
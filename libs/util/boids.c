@@ -0,0 +1,247 @@
+#include "boids.h"
+#include "jobs.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <math.h>
+#include <assert.h>
+
+#define BOIDS_DEFAULT_NUM_THREADS (4)
+#define BOIDS_MAX_THREADS (32)
+
+typedef void (*boids_job_func_t)(boids_t* boids, int first, int last);
+
+struct boids_t {
+    int max_particles;
+    int num_threads;
+    int num_particles;
+    int cur;
+    boids_particle_t* particles[2];
+    boids_params_t params;
+    // spatial grid, particles sorted by grid cell
+    int grid_dim;
+    uint32_t* cell_start;           // grid_dim * grid_dim + 1 entries
+    uint32_t* cell_cursor;
+    uint32_t* particle_cell;
+    uint32_t* sorted_index;         // original particle index of sorted particles
+    boids_particle_t* sorted;
+    // current job, split into one range per thread
+    jobs_t* jobs;
+    boids_job_func_t job_func;
+    int job_count;
+};
+
+//== WORKER THREADS ============================================================
+static void boids_run_range(void* user_data, int range) {
+    boids_t* boids = (boids_t*)user_data;
+    const int first = (int)(((int64_t)range * boids->job_count) / boids->num_threads);
+    const int last = (int)(((int64_t)(range + 1) * boids->job_count) / boids->num_threads);
+    if (first < last) {
+        boids->job_func(boids, first, last);
+    }
+}
+
+// run job_func over [0, count) split into one range per thread, and wait until all are done
+static void boids_run(boids_t* boids, boids_job_func_t job_func, int count) {
+    boids->job_func = job_func;
+    boids->job_count = count;
+    jobs_run(boids->jobs, boids_run_range, boids, boids->num_threads);
+}
+
+//== SIMULATION ================================================================
+typedef struct {
+    float c_mass[2];
+    float c_vel[2];
+    float col_vel[2];
+    int c_mass_count;
+    int c_vel_count;
+} boids_accum_t;
+
+static inline void boids_accumulate(const boids_params_t* params, boids_accum_t* acc, const boids_particle_t* self, const boids_particle_t* other) {
+    const float dx = other->pos[0] - self->pos[0];
+    const float dy = other->pos[1] - self->pos[1];
+    const float dist = sqrtf(dx * dx + dy * dy);
+    if (dist < params->rule1_distance) {
+        acc->c_mass[0] += other->pos[0];
+        acc->c_mass[1] += other->pos[1];
+        acc->c_mass_count++;
+    }
+    if (dist < params->rule2_distance) {
+        acc->col_vel[0] -= dx;
+        acc->col_vel[1] -= dy;
+    }
+    if (dist < params->rule3_distance) {
+        acc->c_vel[0] += other->vel[0];
+        acc->c_vel[1] += other->vel[1];
+        acc->c_vel_count++;
+    }
+}
+
+// same as the end of the computeboids compute shader
+static inline boids_particle_t boids_integrate(const boids_params_t* params, const boids_accum_t* acc, const boids_particle_t* self) {
+    float c_mass[2] = { acc->c_mass[0], acc->c_mass[1] };
+    float c_vel[2] = { acc->c_vel[0], acc->c_vel[1] };
+    if (acc->c_mass_count > 0) {
+        c_mass[0] = c_mass[0] / (float)acc->c_mass_count - self->pos[0];
+        c_mass[1] = c_mass[1] / (float)acc->c_mass_count - self->pos[1];
+    }
+    if (acc->c_vel_count > 0) {
+        c_vel[0] /= (float)acc->c_vel_count;
+        c_vel[1] /= (float)acc->c_vel_count;
+    }
+    boids_particle_t p = *self;
+    p.vel[0] += c_mass[0] * params->rule1_scale + acc->col_vel[0] * params->rule2_scale + c_vel[0] * params->rule3_scale;
+    p.vel[1] += c_mass[1] * params->rule1_scale + acc->col_vel[1] * params->rule2_scale + c_vel[1] * params->rule3_scale;
+
+    // clamp velocity for a more pleasing simulation
+    const float len = sqrtf(p.vel[0] * p.vel[0] + p.vel[1] * p.vel[1]);
+    if (len > 0.1f) {
+        p.vel[0] *= 0.1f / len;
+        p.vel[1] *= 0.1f / len;
+    }
+
+    // kinematic update
+    p.pos[0] += p.vel[0] * params->dt;
+    p.pos[1] += p.vel[1] * params->dt;
+    // wrap around boundary
+    for (int i = 0; i < 2; i++) {
+        if (p.pos[i] < -1.0f) { p.pos[i] = 1.0f; }
+        else if (p.pos[i] > 1.0f) { p.pos[i] = -1.0f; }
+    }
+    return p;
+}
+
+static inline int boids_cell_coord(float pos, int grid_dim) {
+    const int c = (int)((pos + 1.0f) * 0.5f * (float)grid_dim);
+    return (c < 0) ? 0 : ((c >= grid_dim) ? grid_dim - 1 : c);
+}
+
+// counting sort of all particles into grid cells
+static void boids_build_grid(boids_t* boids) {
+    const int dim = boids->grid_dim;
+    const int num_cells = dim * dim;
+    const boids_particle_t* src = boids->particles[boids->cur];
+    memset(boids->cell_start, 0, (size_t)(num_cells + 1) * sizeof(uint32_t));
+    for (int i = 0; i < boids->num_particles; i++) {
+        const int cell = boids_cell_coord(src[i].pos[1], dim) * dim + boids_cell_coord(src[i].pos[0], dim);
+        boids->particle_cell[i] = (uint32_t)cell;
+        boids->cell_start[cell + 1]++;
+    }
+    for (int i = 0; i < num_cells; i++) {
+        boids->cell_start[i + 1] += boids->cell_start[i];
+    }
+    memcpy(boids->cell_cursor, boids->cell_start, (size_t)num_cells * sizeof(uint32_t));
+    for (int i = 0; i < boids->num_particles; i++) {
+        const uint32_t slot = boids->cell_cursor[boids->particle_cell[i]]++;
+        boids->sorted[slot] = src[i];
+        boids->sorted_index[slot] = (uint32_t)i;
+    }
+}
+
+// update a range of particles in grid order, neighbours are only looked up in the surrounding cells
+static void boids_grid_job(boids_t* boids, int first, int last) {
+    const boids_params_t* params = &boids->params;
+    const int dim = boids->grid_dim;
+    boids_particle_t* dst = boids->particles[boids->cur ^ 1];
+    for (int slot = first; slot < last; slot++) {
+        const uint32_t index = boids->sorted_index[slot];
+        const boids_particle_t* self = &boids->sorted[slot];
+        const int cell = (int)boids->particle_cell[index];
+        const int cx = cell % dim;
+        const int cy = cell / dim;
+        const int x0 = (cx > 0) ? cx - 1 : 0;
+        const int x1 = (cx < dim - 1) ? cx + 1 : dim - 1;
+        const int y0 = (cy > 0) ? cy - 1 : 0;
+        const int y1 = (cy < dim - 1) ? cy + 1 : dim - 1;
+        boids_accum_t acc = {0};
+        for (int y = y0; y <= y1; y++) {
+            // the cells of a row are consecutive in the sorted particle array
+            const uint32_t begin = boids->cell_start[y * dim + x0];
+            const uint32_t end = boids->cell_start[y * dim + x1 + 1];
+            for (uint32_t other = begin; other < end; other++) {
+                if (other != (uint32_t)slot) {
+                    boids_accumulate(params, &acc, self, &boids->sorted[other]);
+                }
+            }
+        }
+        dst[index] = boids_integrate(params, &acc, self);
+    }
+}
+
+static void boids_bruteforce_job(boids_t* boids, int first, int last) {
+    const boids_params_t* params = &boids->params;
+    const boids_particle_t* src = boids->particles[boids->cur];
+    boids_particle_t* dst = boids->particles[boids->cur ^ 1];
+    for (int i = first; i < last; i++) {
+        boids_accum_t acc = {0};
+        for (int j = 0; j < boids->num_particles; j++) {
+            if (j != i) {
+                boids_accumulate(params, &acc, &src[i], &src[j]);
+            }
+        }
+        dst[i] = boids_integrate(params, &acc, &src[i]);
+    }
+}
+
+//== PUBLIC API ================================================================
+boids_t* boids_create(const boids_desc_t* desc) {
+    assert(desc && (desc->max_particles > 0));
+    boids_t* boids = (boids_t*)calloc(1, sizeof(boids_t));
+    boids->max_particles = desc->max_particles;
+    boids->num_threads = (desc->num_threads > 0) ? desc->num_threads : BOIDS_DEFAULT_NUM_THREADS;
+    if (boids->num_threads > BOIDS_MAX_THREADS) {
+        boids->num_threads = BOIDS_MAX_THREADS;
+    }
+    const size_t max_particles = (size_t)desc->max_particles;
+    const size_t max_cells = BOIDS_MAX_GRID_DIM * BOIDS_MAX_GRID_DIM;
+    boids->particles[0] = (boids_particle_t*)calloc(max_particles, sizeof(boids_particle_t));
+    boids->particles[1] = (boids_particle_t*)calloc(max_particles, sizeof(boids_particle_t));
+    boids->sorted = (boids_particle_t*)calloc(max_particles, sizeof(boids_particle_t));
+    boids->sorted_index = (uint32_t*)calloc(max_particles, sizeof(uint32_t));
+    boids->particle_cell = (uint32_t*)calloc(max_particles, sizeof(uint32_t));
+    boids->cell_start = (uint32_t*)calloc(max_cells + 1, sizeof(uint32_t));
+    boids->cell_cursor = (uint32_t*)calloc(max_cells, sizeof(uint32_t));
+    boids->jobs = jobs_create(&(jobs_desc_t){ .num_threads = boids->num_threads });
+    return boids;
+}
+
+void boids_destroy(boids_t* boids) {
+    assert(boids);
+    jobs_destroy(boids->jobs);
+    free(boids->particles[0]);
+    free(boids->particles[1]);
+    free(boids->sorted);
+    free(boids->sorted_index);
+    free(boids->particle_cell);
+    free(boids->cell_start);
+    free(boids->cell_cursor);
+    free(boids);
+}
+
+void boids_set_particles(boids_t* boids, const boids_particle_t* particles, int num_particles) {
+    assert(boids && particles && (num_particles <= boids->max_particles));
+    memcpy(boids->particles[boids->cur], particles, (size_t)num_particles * sizeof(boids_particle_t));
+}
+
+const boids_particle_t* boids_particles(const boids_t* boids) {
+    assert(boids);
+    return boids->particles[boids->cur];
+}
+
+void boids_update(boids_t* boids, const boids_params_t* params, int num_particles) {
+    assert(boids && params && (num_particles <= boids->max_particles));
+    boids->params = *params;
+    boids->num_particles = num_particles;
+    boids->grid_dim = boids_grid_dim(params);
+    boids_build_grid(boids);
+    boids_run(boids, boids_grid_job, num_particles);
+    boids->cur ^= 1;
+}
+
+void boids_update_bruteforce(boids_t* boids, const boids_params_t* params, int num_particles) {
+    assert(boids && params && (num_particles <= boids->max_particles));
+    boids->params = *params;
+    boids->num_particles = num_particles;
+    boids_run(boids, boids_bruteforce_job, num_particles);
+    boids->cur ^= 1;
+}
@@ -0,0 +1,68 @@
+#pragma once
+/*
+    CPU boids simulation with a uniform-grid spatial hash, used as reference
+    and fallback for computeboids-sapp.c and by computeboids-bench.c.
+
+    The simulation rules are the same as in the computeboids compute shader.
+    Each update sorts the particles into grid cells with a counting sort
+    and only tests neighbours in the surrounding 3x3 cells. The grid cell
+    size is at least the largest rule distance. The neighbour loop is split
+    into ranges, which run on worker threads (except on the web).
+*/
+#include <stdint.h>
+#include <stddef.h>
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#define BOIDS_MAX_GRID_DIM (512)
+
+// same memory layout as the particle struct in computeboids-sapp.glsl
+typedef struct boids_particle_t {
+    float pos[2];
+    float vel[2];
+} boids_particle_t;
+
+typedef struct boids_params_t {
+    float dt;
+    float rule1_distance;
+    float rule2_distance;
+    float rule3_distance;
+    float rule1_scale;
+    float rule2_scale;
+    float rule3_scale;
+} boids_params_t;
+
+typedef struct boids_desc_t {
+    int max_particles;
+    int num_threads;    // including the calling thread, default: 4
+} boids_desc_t;
+
+typedef struct boids_t boids_t;
+
+boids_t* boids_create(const boids_desc_t* desc);
+void boids_destroy(boids_t* boids);
+// copy particles into the simulation, num_particles must be <= max_particles
+void boids_set_particles(boids_t* boids, const boids_particle_t* particles, int num_particles);
+// get the current particles
+const boids_particle_t* boids_particles(const boids_t* boids);
+// update the first num_particles particles using the spatial grid
+void boids_update(boids_t* boids, const boids_params_t* params, int num_particles);
+// O(N^2) reference update which tests all particle pairs
+void boids_update_bruteforce(boids_t* boids, const boids_params_t* params, int num_particles);
+
+// number of grid cells along each axis for the simulation area [-1, +1]
+static inline int boids_grid_dim(const boids_params_t* params) {
+    float max_dist = params->rule1_distance;
+    if (params->rule2_distance > max_dist) { max_dist = params->rule2_distance; }
+    if (params->rule3_distance > max_dist) { max_dist = params->rule3_distance; }
+    if (max_dist * BOIDS_MAX_GRID_DIM <= 2.0f) {
+        return BOIDS_MAX_GRID_DIM;
+    }
+    const int dim = (int)(2.0f / max_dist);
+    return (dim < 1) ? 1 : dim;
+}
+
+#if defined(__cplusplus)
+}
+#endif
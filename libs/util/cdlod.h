@@ -0,0 +1,389 @@
+#pragma once
+/*
+    Quadtree terrain LOD selection after Filip Strugar's "Continuous
+    Distance-Dependent Level of Detail for Rendering Heightmaps" (CDLOD).
+    Include after vecmath.h.
+
+    The square terrain [0, size] x [0, size] is covered by a quadtree with
+    num_levels levels, level 0 being the finest. Every selected node is
+    rendered with the same grid patch, so a node's vertex density only
+    depends on its size. Each level has a distance range: a node is split
+    into its children when its bounding box reaches into the range of the
+    next finer level, and vertices morph into the grid of the next
+    coarser level between morph_start and morph_end (the end of the
+    node's own range), which makes neighbouring levels meet without
+    cracks. Nodes which are out of their range are rendered whole with
+    their parent's level of detail (fully morphed, see cdlod_select()).
+
+    The node bounding boxes come from a min/max pyramid of the height
+    function, sampled on a CDLOD_MINMAX_DIM^2 grid by cdlod_init() and
+    widened by a margin for the detail between the samples.
+
+    Heights are streamed as tiles, one tile per quadtree node at the
+    node's resolution, kept in CDLOD_CACHE_SLOTS slots with LRU eviction.
+    cdlod_select() only splits a node once all 4 children are resident
+    and requests the missing ones, the application then allocates slots
+    with cdlod_alloc_tile() and fills them, coarse levels first. Until the
+    children arrive the parent is rendered instead, which may show brief
+    cracks against already refined neighbours.
+*/
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include <assert.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define CDLOD_MAX_LEVELS (12)
+#define CDLOD_MAX_SELECTED (2048)
+#define CDLOD_MINMAX_DIM (256)          // min/max pyramid cells along the terrain edge
+#define CDLOD_MINMAX_SIZE ((CDLOD_MINMAX_DIM * CDLOD_MINMAX_DIM * 4 - 1) / 3)
+#define CDLOD_MORPH_START (0.7f)        // morph region starts at 70% between the previous and own range
+#define CDLOD_CACHE_SLOTS (1024)
+#define CDLOD_CACHE_HASH (4096)         // power of 2, at least 2 * CDLOD_CACHE_SLOTS
+#define CDLOD_MAX_REQUESTS (64)
+#define CDLOD_INVALID_KEY (0xFFFFFFFF)
+
+#if defined(__cplusplus)
+using namespace vecmath;
+#endif
+
+typedef struct {
+    float size;             // terrain edge length
+    int num_levels;         // 1..CDLOD_MAX_LEVELS
+    float (*height)(float x, float z, void* user_data);
+    void* user_data;
+    float margin;           // added to the min/max bounds of the sampled heights
+} cdlod_desc_t;
+
+typedef struct {
+    vec3_t eye_pos;
+    vec4_t planes[6];       // inward frustum planes, xyz: normal, w: distance
+} cdlod_view_t;
+
+// a selected node
+typedef struct {
+    float x, z;             // min corner
+    float size;
+    float min_y, max_y;
+    int level;
+    int slot;               // tile cache slot with the node's heights
+    float morph_start;
+    float morph_end;
+} cdlod_node_t;
+
+typedef struct {
+    uint32_t key;
+    uint32_t last_used;
+} _cdlod_slot_t;
+
+typedef struct {
+    float size;
+    int num_levels;
+    float ranges[CDLOD_MAX_LEVELS];
+    float minmax[CDLOD_MINMAX_SIZE][2];     // level 0 is CDLOD_MINMAX_DIM^2, then halved
+    int minmax_offset[CDLOD_MAX_LEVELS + 8];
+    int num_minmax_levels;
+    // tile cache
+    uint32_t frame;
+    int num_resident;
+    _cdlod_slot_t slots[CDLOD_CACHE_SLOTS];
+    int hash[CDLOD_CACHE_HASH];             // slot index or -1, linear probing
+    int num_requests;
+    uint32_t requests[CDLOD_MAX_REQUESTS];  // sorted coarse to fine
+    // selection result
+    int num_selected;
+    cdlod_node_t selected[CDLOD_MAX_SELECTED];
+} cdlod_t;
+
+static uint32_t cdlod_tile_key(int level, int ix, int iz) {
+    assert((level >= 0) && (level < 16) && (ix >= 0) && (ix < 4096) && (iz >= 0) && (iz < 4096));
+    return ((uint32_t)level << 24) | ((uint32_t)iz << 12) | (uint32_t)ix;
+}
+
+static int cdlod_key_level(uint32_t key) { return (int)(key >> 24); }
+static int cdlod_key_x(uint32_t key) { return (int)(key & 0xFFF); }
+static int cdlod_key_z(uint32_t key) { return (int)((key >> 12) & 0xFFF); }
+
+static float cdlod_node_size(const cdlod_t* t, int level) {
+    return t->size / (float)(1 << (t->num_levels - 1 - level));
+}
+
+static void cdlod_init(cdlod_t* t, const cdlod_desc_t* desc) {
+    assert(t && desc && desc->height);
+    assert((desc->num_levels > 0) && (desc->num_levels <= CDLOD_MAX_LEVELS));
+    memset(t, 0, sizeof(cdlod_t));
+    t->size = desc->size;
+    t->num_levels = desc->num_levels;
+    for (int i = 0; i < CDLOD_CACHE_SLOTS; i++) {
+        t->slots[i].key = CDLOD_INVALID_KEY;
+    }
+    for (int i = 0; i < CDLOD_CACHE_HASH; i++) {
+        t->hash[i] = -1;
+    }
+
+    // min/max of the 4 corner samples of each cell, then the coarser levels
+    const int dim = CDLOD_MINMAX_DIM;
+    const float cell = desc->size / (float)dim;
+    float row[2][CDLOD_MINMAX_DIM + 1];
+    for (int x = 0; x <= dim; x++) {
+        row[0][x] = desc->height((float)x * cell, 0.0f, desc->user_data);
+    }
+    for (int z = 0; z < dim; z++) {
+        float* r0 = row[z & 1];
+        float* r1 = row[(z + 1) & 1];
+        for (int x = 0; x <= dim; x++) {
+            r1[x] = desc->height((float)x * cell, (float)(z + 1) * cell, desc->user_data);
+        }
+        for (int x = 0; x < dim; x++) {
+            float* mm = t->minmax[z * dim + x];
+            mm[0] = fminf(fminf(r0[x], r0[x + 1]), fminf(r1[x], r1[x + 1])) - desc->margin;
+            mm[1] = fmaxf(fmaxf(r0[x], r0[x + 1]), fmaxf(r1[x], r1[x + 1])) + desc->margin;
+        }
+    }
+    int offset = dim * dim;
+    t->minmax_offset[0] = 0;
+    t->num_minmax_levels = 1;
+    for (int d = dim / 2; d >= 1; d /= 2) {
+        const float (*src)[2] = (const float (*)[2]) t->minmax[t->minmax_offset[t->num_minmax_levels - 1]];
+        float (*dst)[2] = t->minmax + offset;
+        for (int z = 0; z < d; z++) {
+            for (int x = 0; x < d; x++) {
+                const int s = (z * 2) * (d * 2) + x * 2;
+                const int s1 = s + d * 2;
+                dst[z * d + x][0] = fminf(fminf(src[s][0], src[s + 1][0]), fminf(src[s1][0], src[s1 + 1][0]));
+                dst[z * d + x][1] = fmaxf(fmaxf(src[s][1], src[s + 1][1]), fmaxf(src[s1][1], src[s1 + 1][1]));
+            }
+        }
+        t->minmax_offset[t->num_minmax_levels++] = offset;
+        offset += d * d;
+    }
+    assert(offset == CDLOD_MINMAX_SIZE);
+}
+
+/* set the range of the finest level, each coarser level doubles it */
+static void cdlod_set_ranges(cdlod_t* t, float leaf_range) {
+    // closer ranges than twice the node size cause level jumps of more than one
+    leaf_range = fmaxf(leaf_range, 2.0f * cdlod_node_size(t, 0));
+    for (int i = 0; i < t->num_levels; i++) {
+        t->ranges[i] = leaf_range * (float)(1 << i);
+    }
+}
+
+static void _cdlod_bounds(const cdlod_t* t, int level, int ix, int iz, float* out_min, float* out_max) {
+    // the pyramid level whose cells have the node's size, or the finest
+    // level's cell which contains the node
+    const float cells = t->size / cdlod_node_size(t, level);
+    int mm_level = 0;
+    int d = CDLOD_MINMAX_DIM;
+    while ((d > 1) && ((float)d > cells)) {
+        d /= 2;
+        mm_level++;
+    }
+    if ((float)d < cells) {
+        const int nodes_per_cell = (int)(cells / (float)d);
+        ix /= nodes_per_cell;
+        iz /= nodes_per_cell;
+    }
+    const float* mm = t->minmax[t->minmax_offset[mm_level] + iz * d + ix];
+    *out_min = mm[0];
+    *out_max = mm[1];
+}
+
+static bool _cdlod_box_in_frustum(const cdlod_view_t* view, vec3_t bmin, vec3_t bmax) {
+    for (int i = 0; i < 6; i++) {
+        const vec4_t p = view->planes[i];
+        // the box corner furthest along the plane normal
+        const float x = (p.x >= 0.0f) ? bmax.x : bmin.x;
+        const float y = (p.y >= 0.0f) ? bmax.y : bmin.y;
+        const float z = (p.z >= 0.0f) ? bmax.z : bmin.z;
+        if ((p.x * x + p.y * y + p.z * z + p.w) < 0.0f) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool _cdlod_box_in_sphere(vec3_t bmin, vec3_t bmax, vec3_t center, float radius) {
+    const float dx = fmaxf(fmaxf(bmin.x - center.x, 0.0f), center.x - bmax.x);
+    const float dy = fmaxf(fmaxf(bmin.y - center.y, 0.0f), center.y - bmax.y);
+    const float dz = fmaxf(fmaxf(bmin.z - center.z, 0.0f), center.z - bmax.z);
+    return (dx * dx + dy * dy + dz * dz) <= (radius * radius);
+}
+
+//== tile cache ===============================================================
+static uint32_t _cdlod_hash(uint32_t key) {
+    key ^= key >> 16;
+    key *= 0x7feb352d;
+    key ^= key >> 15;
+    return key & (CDLOD_CACHE_HASH - 1);
+}
+
+/* returns the slot of a resident tile, or -1 */
+static int cdlod_find_tile(const cdlod_t* t, uint32_t key) {
+    for (uint32_t i = _cdlod_hash(key); t->hash[i] != -1; i = (i + 1) & (CDLOD_CACHE_HASH - 1)) {
+        if (t->slots[t->hash[i]].key == key) {
+            return t->hash[i];
+        }
+    }
+    return -1;
+}
+
+static void _cdlod_hash_remove(cdlod_t* t, uint32_t key) {
+    const uint32_t mask = CDLOD_CACHE_HASH - 1;
+    uint32_t i = _cdlod_hash(key);
+    while ((t->hash[i] != -1) && (t->slots[t->hash[i]].key != key)) {
+        i = (i + 1) & mask;
+    }
+    assert(t->hash[i] != -1);
+    t->hash[i] = -1;
+    // backward shift deletion: move up entries which can't be found past the gap anymore
+    for (uint32_t j = (i + 1) & mask; t->hash[j] != -1; j = (j + 1) & mask) {
+        const uint32_t home = _cdlod_hash(t->slots[t->hash[j]].key);
+        if (((j - home) & mask) >= ((j - i) & mask)) {
+            t->hash[i] = t->hash[j];
+            t->hash[j] = -1;
+            i = j;
+        }
+    }
+}
+
+static void _cdlod_request(cdlod_t* t, uint32_t key) {
+    for (int i = 0; i < t->num_requests; i++) {
+        if (t->requests[i] == key) {
+            return;
+        }
+    }
+    if (t->num_requests < CDLOD_MAX_REQUESTS) {
+        t->requests[t->num_requests++] = key;
+    }
+}
+
+/* Allocate a cache slot for a requested tile, evicts the least recently
+   used tile which wasn't touched by the last cdlod_select(). Returns -1
+   if all slots are in use.
+*/
+static int cdlod_alloc_tile(cdlod_t* t, uint32_t key) {
+    assert(cdlod_find_tile(t, key) == -1);
+    int slot = -1;
+    uint32_t oldest = t->frame;
+    for (int i = 0; i < CDLOD_CACHE_SLOTS; i++) {
+        if (t->slots[i].key == CDLOD_INVALID_KEY) {
+            slot = i;
+            break;
+        }
+        if (t->slots[i].last_used < oldest) {
+            oldest = t->slots[i].last_used;
+            slot = i;
+        }
+    }
+    if (slot == -1) {
+        return -1;
+    }
+    if (t->slots[slot].key != CDLOD_INVALID_KEY) {
+        _cdlod_hash_remove(t, t->slots[slot].key);
+    } else {
+        t->num_resident++;
+    }
+    t->slots[slot].key = key;
+    t->slots[slot].last_used = t->frame;
+    uint32_t i = _cdlod_hash(key);
+    while (t->hash[i] != -1) {
+        i = (i + 1) & (CDLOD_CACHE_HASH - 1);
+    }
+    t->hash[i] = slot;
+    return slot;
+}
+
+//== selection ================================================================
+static void _cdlod_add(cdlod_t* t, int level, int slot, vec3_t bmin, vec3_t bmax) {
+    if (t->num_selected == CDLOD_MAX_SELECTED) {
+        return;
+    }
+    const float prev_range = (level > 0) ? t->ranges[level - 1] : 0.0f;
+    t->slots[slot].last_used = t->frame;
+    t->selected[t->num_selected++] = (cdlod_node_t){
+        .x = bmin.x,
+        .z = bmin.z,
+        .size = bmax.x - bmin.x,
+        .min_y = bmin.y,
+        .max_y = bmax.y,
+        .level = level,
+        .slot = slot,
+        .morph_start = prev_range + (t->ranges[level] - prev_range) * CDLOD_MORPH_START,
+        .morph_end = t->ranges[level],
+    };
+}
+
+// returns false if the node is out of its range, and its parent has to cover it
+static bool _cdlod_select_node(cdlod_t* t, const cdlod_view_t* view, int level, int ix, int iz) {
+    const float size = cdlod_node_size(t, level);
+    float min_y, max_y;
+    _cdlod_bounds(t, level, ix, iz, &min_y, &max_y);
+    const vec3_t bmin = vec3((float)ix * size, min_y, (float)iz * size);
+    const vec3_t bmax = vec3(bmin.x + size, max_y, bmin.z + size);
+    if (!_cdlod_box_in_frustum(view, bmin, bmax)) {
+        return true;
+    }
+    const bool is_root = level == (t->num_levels - 1);
+    if (!is_root && !_cdlod_box_in_sphere(bmin, bmax, view->eye_pos, t->ranges[level])) {
+        return false;
+    }
+    // the parent has made sure that the tile is resident, except for the root
+    const int slot = cdlod_find_tile(t, cdlod_tile_key(level, ix, iz));
+    if (slot == -1) {
+        _cdlod_request(t, cdlod_tile_key(level, ix, iz));
+        return true;
+    }
+    t->slots[slot].last_used = t->frame;
+
+    bool split = (level > 0) && _cdlod_box_in_sphere(bmin, bmax, view->eye_pos, t->ranges[level - 1]);
+    int child_slots[4] = { -1, -1, -1, -1 };
+    for (int i = 0; split && (i < 4); i++) {
+        const uint32_t key = cdlod_tile_key(level - 1, ix * 2 + (i & 1), iz * 2 + (i >> 1));
+        child_slots[i] = cdlod_find_tile(t, key);
+        if (child_slots[i] == -1) {
+            _cdlod_request(t, key);
+        }
+    }
+    for (int i = 0; split && (i < 4); i++) {
+        split = child_slots[i] != -1;
+    }
+    if (!split) {
+        _cdlod_add(t, level, slot, bmin, bmax);
+        return true;
+    }
+    for (int i = 0; i < 4; i++) {
+        const int cx = ix * 2 + (i & 1);
+        const int cz = iz * 2 + (i >> 1);
+        if (!_cdlod_select_node(t, view, level - 1, cx, cz)) {
+            // outside of the child's range all vertices are fully morphed,
+            // so the child renders with this node's level of detail
+            float cmin_y, cmax_y;
+            _cdlod_bounds(t, level - 1, cx, cz, &cmin_y, &cmax_y);
+            const float csize = size * 0.5f;
+            const vec3_t cmin = vec3((float)cx * csize, cmin_y, (float)cz * csize);
+            _cdlod_add(t, level - 1, child_slots[i], cmin, vec3(cmin.x + csize, cmax_y, cmin.z + csize));
+        }
+    }
+    return true;
+}
+
+/* select the visible nodes into t->selected, and the missing tiles into t->requests */
+static void cdlod_select(cdlod_t* t, const cdlod_view_t* view) {
+    assert(t && view);
+    t->frame++;
+    t->num_selected = 0;
+    t->num_requests = 0;
+    _cdlod_select_node(t, view, t->num_levels - 1, 0, 0);
+    // coarse levels first, so that splits unlock in order
+    for (int i = 1; i < t->num_requests; i++) {
+        const uint32_t key = t->requests[i];
+        int j = i - 1;
+        while ((j >= 0) && (cdlod_key_level(t->requests[j]) < cdlod_key_level(key))) {
+            t->requests[j + 1] = t->requests[j];
+            j--;
+        }
+        t->requests[j + 1] = key;
+    }
+}
@@ -0,0 +1,228 @@
+#pragma once
+/*
+    Cascaded shadow maps for a directional light. Include after vecmath.h.
+
+    - the view frustum is split into 2..CSM_MAX_CASCADES slices, with
+      split distances blended between logarithmic and uniform
+    - each cascade covers the bounding sphere of its frustum slice, so the
+      cascade size doesn't change when the camera rotates, and the cascade
+      center is snapped to shadow map texels in light space, so that shadow
+      edges don't shimmer when the camera moves
+    - the far cascades can be cached: they are enlarged by a margin and
+      only re-centered on a coarse grid, so they only move after the camera
+      has travelled some distance; csm_update() flags a cached cascade as
+      'dirty' only when it has moved, the light direction has changed or
+      csm_invalidate_static() has been called
+    - csm_sphere_visible() tests a caster's bounding sphere against the
+      light volume of a cascade (including the space between the cascade
+      and the light, up to CSM_DEFAULT_CASTER_DISTANCE)
+
+    The intended use of cached cascades is to keep the static casters in a
+    separate depth map which is only re-rendered when the cascade is dirty,
+    and to add the dynamic casters on top of a copy of it (see
+    shadows-csm-sapp.c).
+
+    The light view-projection matrices use D3D-style clip space depth (0..1),
+    use '@glsl_options fixup_clipspace' in the shadow pass vertex shader.
+*/
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "frustum.h"
+
+#define CSM_MAX_CASCADES (4)
+#define CSM_DEFAULT_NUM_CASCADES (4)
+#define CSM_DEFAULT_RESOLUTION (1024)
+#define CSM_DEFAULT_SPLIT_LAMBDA (0.75f)
+#define CSM_DEFAULT_CACHE_MARGIN (0.25f)
+#define CSM_DEFAULT_CASTER_DISTANCE (100.0f)
+
+#if defined(__cplusplus)
+using namespace vecmath;
+#endif
+
+typedef struct {
+    int num_cascades;           // 2..CSM_MAX_CASCADES
+    int resolution;             // shadow map width and height of a cascade
+    float split_lambda;         // 0.0: uniform split distances, 1.0: logarithmic
+    int first_cached;           // index of the first cached cascade (default: num_cascades / 2)
+    bool cache_all;             // cache all cascades (first_cached is ignored)
+    bool no_cache;              // disable caching
+    float cache_margin;         // border of cached cascades, relative to their radius
+    float caster_distance;      // how far in front of a cascade casters are included
+    float shadow_distance;      // shadows end at this view distance (default: camera far plane)
+} csm_desc_t;
+
+// the camera the cascades are computed for
+typedef struct {
+    vec3_t eye_pos;
+    vec3_t forward;             // normalized view direction
+    float fov;                  // vertical field of view in degrees
+    float aspect;
+    float nearz;
+    float farz;
+} csm_view_t;
+
+typedef struct {
+    float near_dist;            // view distance range of the cascade
+    float far_dist;
+    float radius;               // half size of the cascade in light space
+    vec3_t center;              // snapped center in world space
+    mat44_t view_proj;          // light view-projection matrix
+    vec4_t planes[6];           // light volume, pointing inward
+    bool cached;
+    bool dirty;                 // cached cascade must re-render its static casters
+} csm_cascade_t;
+
+typedef struct {
+    int num_cascades;
+    int resolution;
+    float split_lambda;
+    int first_cached;
+    float cache_margin;
+    float caster_distance;
+    float shadow_distance;
+    uint32_t static_version;
+    csm_cascade_t cascades[CSM_MAX_CASCADES];
+    // state the cached cascades were last rendered with
+    struct {
+        bool valid;
+        mat44_t view_proj;
+        uint32_t static_version;
+    } rendered[CSM_MAX_CASCADES];
+} csm_t;
+
+static float _csm_def(float val, float def) {
+    return ((val == 0.0f) ? def : val);
+}
+
+static void csm_init(csm_t* csm, const csm_desc_t* desc) {
+    assert(csm && desc);
+    memset(csm, 0, sizeof(csm_t));
+    csm->num_cascades = (int)_csm_def((float)desc->num_cascades, (float)CSM_DEFAULT_NUM_CASCADES);
+    assert((csm->num_cascades >= 2) && (csm->num_cascades <= CSM_MAX_CASCADES));
+    csm->resolution = (int)_csm_def((float)desc->resolution, (float)CSM_DEFAULT_RESOLUTION);
+    csm->split_lambda = _csm_def(desc->split_lambda, CSM_DEFAULT_SPLIT_LAMBDA);
+    assert(!(desc->no_cache && desc->cache_all));
+    if (desc->no_cache) {
+        csm->first_cached = csm->num_cascades;
+    } else if (desc->cache_all) {
+        csm->first_cached = 0;
+    } else {
+        csm->first_cached = (int)_csm_def((float)desc->first_cached, (float)(csm->num_cascades / 2));
+    }
+    assert((csm->first_cached >= 0) && (csm->first_cached <= csm->num_cascades));
+    csm->cache_margin = _csm_def(desc->cache_margin, CSM_DEFAULT_CACHE_MARGIN);
+    csm->caster_distance = _csm_def(desc->caster_distance, CSM_DEFAULT_CASTER_DISTANCE);
+    csm->shadow_distance = desc->shadow_distance;
+}
+
+/* call when static casters have moved, all cached cascades become dirty */
+static void csm_invalidate_static(csm_t* csm) {
+    assert(csm);
+    csm->static_version++;
+}
+
+/* enable or disable caching at runtime */
+static void csm_set_cache(csm_t* csm, bool enabled, int first_cached) {
+    assert(csm && (first_cached >= 0) && (first_cached <= csm->num_cascades));
+    csm->first_cached = enabled ? first_cached : csm->num_cascades;
+    for (int i = 0; i < CSM_MAX_CASCADES; i++) {
+        csm->rendered[i].valid = false;
+    }
+}
+
+// bounding sphere of a frustum slice, which only depends on the slice
+// distances and the frustum shape, not on the camera orientation
+static void _csm_slice_sphere(float n, float f, float k2, float* out_dist, float* out_radius) {
+    if (k2 >= ((f - n) / (f + n))) {
+        *out_dist = f;
+        *out_radius = f * sqrtf(k2);
+    } else {
+        *out_dist = 0.5f * (f + n) * (1.0f + k2);
+        *out_radius = 0.5f * sqrtf((f - n) * (f - n) + 2.0f * (f * f + n * n) * k2 + (f + n) * (f + n) * k2 * k2);
+    }
+}
+
+static float _csm_snap(float val, float step) {
+    return floorf(val / step + 0.5f) * step;
+}
+
+/* update the cascades for a camera and a normalized direction towards the light */
+static void csm_update(csm_t* csm, const csm_view_t* view, vec3_t light_dir) {
+    assert(csm && view);
+    const float n = view->nearz;
+    const float f = (csm->shadow_distance > 0.0f) ? vm_min(csm->shadow_distance, view->farz) : view->farz;
+    const float tan_y = tanf(vm_radians(view->fov) * 0.5f);
+    const float tan_x = tan_y * view->aspect;
+    const float k2 = tan_x * tan_x + tan_y * tan_y;
+
+    // a light space rotation with a fixed up vector, so that the texel
+    // grid only moves when the light direction changes
+    const vec3_t up = (fabsf(light_dir.y) > 0.99f) ? vec3(1.0f, 0.0f, 0.0f) : vec3(0.0f, 1.0f, 0.0f);
+    const mat44_t light_rot = mat44_look_at_rh(vec3(0.0f, 0.0f, 0.0f), vec3_neg(light_dir), up);
+    const mat44_t inv_light_rot = mat44_transpose(light_rot);
+
+    float near_dist = n;
+    for (int i = 0; i < csm->num_cascades; i++) {
+        csm_cascade_t* c = &csm->cascades[i];
+        const float t = (float)(i + 1) / (float)csm->num_cascades;
+        const float log_split = n * powf(f / n, t);
+        const float uni_split = n + (f - n) * t;
+        c->near_dist = near_dist;
+        c->far_dist = csm->split_lambda * log_split + (1.0f - csm->split_lambda) * uni_split;
+        near_dist = c->far_dist;
+
+        float center_dist, radius;
+        _csm_slice_sphere(c->near_dist, c->far_dist, k2, &center_dist, &radius);
+        c->cached = i >= csm->first_cached;
+        // cached cascades are re-centered on a grid of margin-sized cells,
+        // the slice sphere stays inside as long as its center is inside
+        // the cell, both grids are multiples of the texel size
+        c->radius = c->cached ? (radius * (1.0f + csm->cache_margin)) : radius;
+        const float texel_size = (2.0f * c->radius) / (float)csm->resolution;
+        const float grid = c->cached ? (texel_size * vm_max(1.0f, floorf((radius * csm->cache_margin) / texel_size))) : texel_size;
+        const vec3_t center = vec3_add(view->eye_pos, vec3_mulf(view->forward, center_dist));
+        vec4_t ls_center = vec4_transform(vec4(center.x, center.y, center.z, 1.0f), light_rot);
+        ls_center.x = _csm_snap(ls_center.x, grid);
+        ls_center.y = _csm_snap(ls_center.y, grid);
+        if (c->cached) {
+            // also quantize the depth, so that the matrix only changes at grid steps
+            ls_center.z = _csm_snap(ls_center.z, grid);
+        }
+        c->center = vec4_xyz(vec4_transform(ls_center, inv_light_rot));
+
+        const float depth_range = 2.0f * c->radius + csm->caster_distance;
+        const vec3_t eye = vec3_add(c->center, vec3_mulf(light_dir, c->radius + csm->caster_distance));
+        const mat44_t light_view = mat44_look_at_rh(eye, c->center, up);
+        const mat44_t light_proj = mat44_ortho_rh(2.0f * c->radius, 2.0f * c->radius, 0.0f, depth_range);
+        c->view_proj = vm_mul(light_view, light_proj);
+        frustum_planes(&c->view_proj, c->planes);
+
+        // the caller renders dirty cascades in this frame
+        if (c->cached) {
+            c->dirty = !csm->rendered[i].valid
+                || (csm->rendered[i].static_version != csm->static_version)
+                || (0 != memcmp(&csm->rendered[i].view_proj, &c->view_proj, sizeof(mat44_t)));
+            csm->rendered[i].valid = true;
+            csm->rendered[i].view_proj = c->view_proj;
+            csm->rendered[i].static_version = csm->static_version;
+        } else {
+            c->dirty = true;
+        }
+    }
+}
+
+/* true if a caster's bounding sphere is inside the light volume of a cascade */
+static bool csm_sphere_visible(const csm_cascade_t* c, vec3_t center, float radius) {
+    assert(c);
+    for (int i = 0; i < 6; i++) {
+        const vec4_t p = c->planes[i];
+        if ((p.x * center.x + p.y * center.y + p.z * center.z + p.w) < -radius) {
+            return false;
+        }
+    }
+    return true;
+}
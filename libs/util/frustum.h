@@ -0,0 +1,34 @@
+#pragma once
+/*
+    View frustum planes for CPU culling. Include after vecmath.h.
+
+    frustum_planes() extracts the six planes from a view-projection matrix
+    (Gribb/Hartmann), normalized and pointing inward, in the order left,
+    right, bottom, top, near, far. A point p is inside a plane if
+    dot(plane.xyz, p) + plane.w >= 0, and a sphere is outside the frustum
+    if that distance is less than -radius for any plane.
+
+    The near plane assumes a D3D-style clip space depth range of 0..w,
+    as produced by the vecmath projection functions.
+*/
+#if defined(__cplusplus)
+using namespace vecmath;
+#endif
+
+static inline void frustum_planes(const mat44_t* view_proj, vec4_t planes[6]) {
+    const float* m = (const float*)view_proj;
+    #define FRUSTUM_CLIP_ROW(r) vec4(m[(r)], m[4 + (r)], m[8 + (r)], m[12 + (r)])
+    const vec4_t r0 = FRUSTUM_CLIP_ROW(0);
+    const vec4_t r1 = FRUSTUM_CLIP_ROW(1);
+    const vec4_t r2 = FRUSTUM_CLIP_ROW(2);
+    const vec4_t r3 = FRUSTUM_CLIP_ROW(3);
+    #undef FRUSTUM_CLIP_ROW
+    const vec4_t p[6] = {
+        vec4_add(r3, r0), vec4_sub(r3, r0),
+        vec4_add(r3, r1), vec4_sub(r3, r1),
+        r2, vec4_sub(r3, r2),
+    };
+    for (int i = 0; i < 6; i++) {
+        planes[i] = vec4_mulf(p[i], 1.0f / vec3_length(vec3(p[i].x, p[i].y, p[i].z)));
+    }
+}
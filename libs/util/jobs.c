@@ -0,0 +1,239 @@
+//------------------------------------------------------------------------------
+//  jobs.c
+//
+//  See jobs.h for details.
+//------------------------------------------------------------------------------
+#include "jobs.h"
+#include <stdlib.h>
+#include <stdbool.h>
+#include <assert.h>
+
+#if defined(__EMSCRIPTEN__)
+#define JOBS_USE_THREADS (0)
+#elif defined(_WIN32)
+#define JOBS_USE_THREADS (1)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#define JOBS_USE_THREADS (1)
+#include <pthread.h>
+#endif
+
+#define JOBS_DEFAULT_NUM_THREADS (4)
+#define JOBS_MAX_THREADS (32)
+
+struct jobs_t {
+    int num_threads;
+    // current run
+    jobs_func_t func;
+    void* user_data;
+    int num_jobs;
+    #if JOBS_USE_THREADS
+    int next_job;
+    bool quit;
+    int generation;
+    int num_done;
+    #if defined(_WIN32)
+    CRITICAL_SECTION mutex;
+    CONDITION_VARIABLE start_cond;
+    CONDITION_VARIABLE done_cond;
+    HANDLE threads[JOBS_MAX_THREADS];
+    #else
+    pthread_mutex_t mutex;
+    pthread_cond_t start_cond;
+    pthread_cond_t done_cond;
+    pthread_t threads[JOBS_MAX_THREADS];
+    #endif
+    #endif
+};
+
+#if JOBS_USE_THREADS
+static void jobs_lock(jobs_t* jobs) {
+    #if defined(_WIN32)
+    EnterCriticalSection(&jobs->mutex);
+    #else
+    pthread_mutex_lock(&jobs->mutex);
+    #endif
+}
+
+static void jobs_unlock(jobs_t* jobs) {
+    #if defined(_WIN32)
+    LeaveCriticalSection(&jobs->mutex);
+    #else
+    pthread_mutex_unlock(&jobs->mutex);
+    #endif
+}
+
+static void jobs_wait_start(jobs_t* jobs) {
+    #if defined(_WIN32)
+    SleepConditionVariableCS(&jobs->start_cond, &jobs->mutex, INFINITE);
+    #else
+    pthread_cond_wait(&jobs->start_cond, &jobs->mutex);
+    #endif
+}
+
+static void jobs_wait_done(jobs_t* jobs) {
+    #if defined(_WIN32)
+    SleepConditionVariableCS(&jobs->done_cond, &jobs->mutex, INFINITE);
+    #else
+    pthread_cond_wait(&jobs->done_cond, &jobs->mutex);
+    #endif
+}
+
+static void jobs_signal_start(jobs_t* jobs) {
+    #if defined(_WIN32)
+    WakeAllConditionVariable(&jobs->start_cond);
+    #else
+    pthread_cond_broadcast(&jobs->start_cond);
+    #endif
+}
+
+static void jobs_signal_done(jobs_t* jobs) {
+    #if defined(_WIN32)
+    WakeConditionVariable(&jobs->done_cond);
+    #else
+    pthread_cond_signal(&jobs->done_cond);
+    #endif
+}
+
+// take the next job until all jobs of the current run are taken,
+// called and returns with the mutex locked
+static void jobs_take_jobs(jobs_t* jobs) {
+    while (jobs->next_job < jobs->num_jobs) {
+        const int job_index = jobs->next_job++;
+        jobs_unlock(jobs);
+        jobs->func(jobs->user_data, job_index);
+        jobs_lock(jobs);
+    }
+}
+
+static void jobs_worker_loop(jobs_t* jobs) {
+    int generation = 0;
+    jobs_lock(jobs);
+    while (true) {
+        while (!jobs->quit && (jobs->generation == generation)) {
+            jobs_wait_start(jobs);
+        }
+        if (jobs->quit) {
+            break;
+        }
+        generation = jobs->generation;
+        jobs_take_jobs(jobs);
+        if (++jobs->num_done == (jobs->num_threads - 1)) {
+            jobs_signal_done(jobs);
+        }
+    }
+    jobs_unlock(jobs);
+}
+
+#if defined(_WIN32)
+static DWORD WINAPI jobs_thread_func(LPVOID arg) {
+    jobs_worker_loop((jobs_t*)arg);
+    return 0;
+}
+#else
+static void* jobs_thread_func(void* arg) {
+    jobs_worker_loop((jobs_t*)arg);
+    return 0;
+}
+#endif
+
+static void jobs_workers_setup(jobs_t* jobs) {
+    #if defined(_WIN32)
+    InitializeCriticalSection(&jobs->mutex);
+    InitializeConditionVariable(&jobs->start_cond);
+    InitializeConditionVariable(&jobs->done_cond);
+    #else
+    pthread_mutex_init(&jobs->mutex, 0);
+    pthread_cond_init(&jobs->start_cond, 0);
+    pthread_cond_init(&jobs->done_cond, 0);
+    #endif
+    // the calling thread is the first thread
+    for (int i = 0; i < jobs->num_threads - 1; i++) {
+        #if defined(_WIN32)
+        jobs->threads[i] = CreateThread(NULL, 0, jobs_thread_func, jobs, 0, NULL);
+        #else
+        pthread_create(&jobs->threads[i], 0, jobs_thread_func, jobs);
+        #endif
+    }
+}
+
+static void jobs_workers_shutdown(jobs_t* jobs) {
+    jobs_lock(jobs);
+    jobs->quit = true;
+    jobs_signal_start(jobs);
+    jobs_unlock(jobs);
+    #if defined(_WIN32)
+    if (jobs->num_threads > 1) {
+        WaitForMultipleObjects((DWORD)(jobs->num_threads - 1), jobs->threads, TRUE, INFINITE);
+    }
+    for (int i = 0; i < jobs->num_threads - 1; i++) {
+        CloseHandle(jobs->threads[i]);
+    }
+    DeleteCriticalSection(&jobs->mutex);
+    #else
+    for (int i = 0; i < jobs->num_threads - 1; i++) {
+        pthread_join(jobs->threads[i], 0);
+    }
+    pthread_cond_destroy(&jobs->done_cond);
+    pthread_cond_destroy(&jobs->start_cond);
+    pthread_mutex_destroy(&jobs->mutex);
+    #endif
+}
+
+static void jobs_run_all(jobs_t* jobs) {
+    jobs_lock(jobs);
+    jobs->next_job = 0;
+    if (jobs->num_threads > 1) {
+        jobs->num_done = 0;
+        jobs->generation++;
+        jobs_signal_start(jobs);
+    }
+    jobs_take_jobs(jobs);
+    // workers which wake up late find no jobs left, but still need to check in
+    while (jobs->num_done < (jobs->num_threads - 1)) {
+        jobs_wait_done(jobs);
+    }
+    jobs_unlock(jobs);
+}
+#else
+static void jobs_workers_setup(jobs_t* jobs) { (void)jobs; }
+static void jobs_workers_shutdown(jobs_t* jobs) { (void)jobs; }
+
+static void jobs_run_all(jobs_t* jobs) {
+    for (int i = 0; i < jobs->num_jobs; i++) {
+        jobs->func(jobs->user_data, i);
+    }
+}
+#endif
+
+//== PUBLIC API ================================================================
+jobs_t* jobs_create(const jobs_desc_t* desc) {
+    assert(desc);
+    jobs_t* jobs = (jobs_t*)calloc(1, sizeof(jobs_t));
+    jobs->num_threads = (desc->num_threads > 0) ? desc->num_threads : JOBS_DEFAULT_NUM_THREADS;
+    if (jobs->num_threads > JOBS_MAX_THREADS) {
+        jobs->num_threads = JOBS_MAX_THREADS;
+    }
+    jobs_workers_setup(jobs);
+    return jobs;
+}
+
+void jobs_destroy(jobs_t* jobs) {
+    assert(jobs);
+    jobs_workers_shutdown(jobs);
+    free(jobs);
+}
+
+void jobs_run(jobs_t* jobs, jobs_func_t func, void* user_data, int num_jobs) {
+    assert(jobs && func && (num_jobs >= 0));
+    jobs->func = func;
+    jobs->user_data = user_data;
+    jobs->num_jobs = num_jobs;
+    jobs_run_all(jobs);
+}
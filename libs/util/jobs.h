@@ -0,0 +1,32 @@
+#pragma once
+/*
+    Minimal fork-join job helper for the libs/util modules (boids, meshgen).
+
+    A jobs_t owns num_threads - 1 persistent worker threads. jobs_run()
+    calls a job function once for each job index, the workers and the
+    calling thread take the next job index until all jobs are taken, and
+    jobs_run() returns when all jobs are done. Jobs are started in index
+    order, so sorting them by decreasing cost improves load balancing.
+
+    On the web (no threads) all jobs run on the calling thread.
+*/
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+typedef struct jobs_desc_t {
+    int num_threads;    // including the calling thread, default: 4
+} jobs_desc_t;
+
+typedef struct jobs_t jobs_t;
+
+typedef void (*jobs_func_t)(void* user_data, int job_index);
+
+jobs_t* jobs_create(const jobs_desc_t* desc);
+void jobs_destroy(jobs_t* jobs);
+// call func(user_data, i) for all i in [0, num_jobs), returns when all jobs are done
+void jobs_run(jobs_t* jobs, jobs_func_t func, void* user_data, int num_jobs);
+
+#if defined(__cplusplus)
+}
+#endif
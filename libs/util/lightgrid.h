@@ -0,0 +1,178 @@
+#pragma once
+/*
+    Clustered light culling on the CPU. Include after vecmath.h.
+
+    The view frustum is divided into LGRID_DIM_X * LGRID_DIM_Y tiles in
+    screen space and LGRID_DIM_Z slices in view depth (exponentially
+    distributed between the near and far plane). lgrid_build() assigns
+    light bounding spheres to all clusters they overlap and writes:
+
+    - clusters[]: one entry per cluster, (offset << LGRID_COUNT_BITS) | count,
+      at index (z * LGRID_DIM_Y + y) * LGRID_DIM_X + x
+    - indices[]: the light indices of all clusters, back to back
+
+    A fragment shader finds its cluster from the view space position with
+    the same math as _lgrid_tile() and _lgrid_slice(), using the values
+    in lgrid_t.shader_params.
+
+    The sphere test is conservative: the screen space bounds of the
+    sphere are computed for each depth slice it touches.
+*/
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+#include <stdint.h>
+
+#define LGRID_DIM_X (16)
+#define LGRID_DIM_Y (8)
+#define LGRID_DIM_Z (24)
+#define LGRID_NUM_CLUSTERS (LGRID_DIM_X * LGRID_DIM_Y * LGRID_DIM_Z)
+#define LGRID_MAX_LIGHTS (1024)
+#define LGRID_INDEX_ROW (1024)      // width of the light index texture
+#define LGRID_MAX_INDICES (LGRID_INDEX_ROW * 64)
+#define LGRID_COUNT_BITS (12)
+#define LGRID_MAX_CLUSTER_LIGHTS ((1 << LGRID_COUNT_BITS) - 1)
+
+#if defined(__cplusplus)
+using namespace vecmath;
+#endif
+
+// a light's world space bounding sphere
+typedef struct {
+    vec3_t pos;
+    float radius;
+} lgrid_light_t;
+
+typedef struct {
+    mat44_t view;
+    float fov;              // vertical field of view in degrees
+    float aspect;
+    float nearz;
+    float farz;
+} lgrid_view_t;
+
+typedef struct {
+    // x: tan(fov_x/2), y: tan(fov_y/2), z: near plane, w: LGRID_DIM_Z / log(far/near)
+    vec4_t shader_params;
+    int num_indices;
+    int num_dropped;        // light indices which didn't fit into indices[]
+    int num_occupied;       // clusters with at least one light
+    uint32_t clusters[LGRID_NUM_CLUSTERS];
+    uint32_t indices[LGRID_MAX_INDICES];
+    // first and last depth slice of each light
+    int16_t slices[LGRID_MAX_LIGHTS][2];
+    uint16_t counts[LGRID_NUM_CLUSTERS];
+} lgrid_t;
+
+static int _lgrid_clampi(int val, int min_val, int max_val) {
+    return (val < min_val) ? min_val : ((val > max_val) ? max_val : val);
+}
+
+// screen space tile of a view space coordinate divided by depth
+static int _lgrid_tile(float coord_over_depth, float tan_half_fov, int dim) {
+    return _lgrid_clampi((int)floorf(((coord_over_depth / tan_half_fov) * 0.5f + 0.5f) * (float)dim), 0, dim - 1);
+}
+
+static int _lgrid_slice(const lgrid_t* g, float depth) {
+    if (depth <= g->shader_params.z) {
+        return 0;
+    }
+    return _lgrid_clampi((int)floorf(logf(depth / g->shader_params.z) * g->shader_params.w), 0, LGRID_DIM_Z - 1);
+}
+
+static float _lgrid_slice_depth(const lgrid_t* g, int slice) {
+    return g->shader_params.z * expf((float)slice / g->shader_params.w);
+}
+
+// tile range of the interval [c - r, c + r] of a coordinate over the depth interval [z0, z1]
+static void _lgrid_tile_range(float c, float r, float z0, float z1, float tan_half_fov, int dim, int* out_min, int* out_max) {
+    const float lo = c - r;
+    const float hi = c + r;
+    *out_min = _lgrid_tile(lo / ((lo >= 0.0f) ? z1 : z0), tan_half_fov, dim);
+    *out_max = _lgrid_tile(hi / ((hi >= 0.0f) ? z0 : z1), tan_half_fov, dim);
+}
+
+/* bin lights into clusters, index_offset is added to the light indices */
+static void lgrid_build(lgrid_t* g, const lgrid_view_t* view, const lgrid_light_t* lights, int num_lights, int index_offset) {
+    assert(g && view && (num_lights >= 0) && (num_lights <= LGRID_MAX_LIGHTS));
+    const float tan_y = tanf(vm_radians(view->fov) * 0.5f);
+    const float tan_x = tan_y * view->aspect;
+    g->shader_params = vec4(tan_x, tan_y, view->nearz, (float)LGRID_DIM_Z / logf(view->farz / view->nearz));
+    memset(g->counts, 0, sizeof(g->counts));
+
+    // cluster ranges and per-cluster light counts
+    for (int i = 0; i < num_lights; i++) {
+        int16_t* slices = g->slices[i];
+        const vec4_t p = vec4_transform(vec4(lights[i].pos.x, lights[i].pos.y, lights[i].pos.z, 1.0f), view->view);
+        const float r = lights[i].radius;
+        const float depth = -p.z;
+        if (((depth + r) < view->nearz) || ((depth - r) > view->farz)) {
+            slices[0] = 1; slices[1] = 0;
+            continue;
+        }
+        const int z0 = _lgrid_slice(g, depth - r);
+        const int z1 = _lgrid_slice(g, depth + r);
+        slices[0] = (int16_t)z0;
+        slices[1] = (int16_t)z1;
+        for (int z = z0; z <= z1; z++) {
+            const float d0 = fmaxf(fmaxf(_lgrid_slice_depth(g, z), depth - r), view->nearz);
+            const float d1 = fmaxf(fminf(_lgrid_slice_depth(g, z + 1), depth + r), d0);
+            int x0, x1, y0, y1;
+            _lgrid_tile_range(p.x, r, d0, d1, tan_x, LGRID_DIM_X, &x0, &x1);
+            _lgrid_tile_range(p.y, r, d0, d1, tan_y, LGRID_DIM_Y, &y0, &y1);
+            for (int y = y0; y <= y1; y++) {
+                for (int x = x0; x <= x1; x++) {
+                    g->counts[(z * LGRID_DIM_Y + y) * LGRID_DIM_X + x]++;
+                }
+            }
+        }
+    }
+
+    // cluster offsets
+    int offset = 0;
+    g->num_dropped = 0;
+    g->num_occupied = 0;
+    for (int i = 0; i < LGRID_NUM_CLUSTERS; i++) {
+        int count = g->counts[i];
+        if (count > LGRID_MAX_CLUSTER_LIGHTS) {
+            g->num_dropped += count - LGRID_MAX_CLUSTER_LIGHTS;
+            count = LGRID_MAX_CLUSTER_LIGHTS;
+        }
+        if ((offset + count) > LGRID_MAX_INDICES) {
+            g->num_dropped += (offset + count) - LGRID_MAX_INDICES;
+            count = LGRID_MAX_INDICES - offset;
+        }
+        if (count > 0) {
+            g->num_occupied++;
+        }
+        g->clusters[i] = ((uint32_t)offset << LGRID_COUNT_BITS) | (uint32_t)count;
+        // from here on counts[] is the write cursor of the cluster
+        g->counts[i] = 0;
+        offset += count;
+    }
+    g->num_indices = offset;
+
+    // light indices, same traversal as above
+    for (int i = 0; i < num_lights; i++) {
+        const int16_t* slices = g->slices[i];
+        const vec4_t p = vec4_transform(vec4(lights[i].pos.x, lights[i].pos.y, lights[i].pos.z, 1.0f), view->view);
+        const float r = lights[i].radius;
+        const float depth = -p.z;
+        for (int z = slices[0]; z <= slices[1]; z++) {
+            const float d0 = fmaxf(fmaxf(_lgrid_slice_depth(g, z), depth - r), view->nearz);
+            const float d1 = fmaxf(fminf(_lgrid_slice_depth(g, z + 1), depth + r), d0);
+            int x0, x1, y0, y1;
+            _lgrid_tile_range(p.x, r, d0, d1, tan_x, LGRID_DIM_X, &x0, &x1);
+            _lgrid_tile_range(p.y, r, d0, d1, tan_y, LGRID_DIM_Y, &y0, &y1);
+            for (int y = y0; y <= y1; y++) {
+                for (int x = x0; x <= x1; x++) {
+                    const int c = (z * LGRID_DIM_Y + y) * LGRID_DIM_X + x;
+                    const uint32_t count = g->clusters[c] & LGRID_MAX_CLUSTER_LIGHTS;
+                    if (g->counts[c] < count) {
+                        g->indices[(g->clusters[c] >> LGRID_COUNT_BITS) + g->counts[c]++] = (uint32_t)(i + index_offset);
+                    }
+                }
+            }
+        }
+    }
+}
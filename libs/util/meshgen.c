@@ -0,0 +1,503 @@
+//------------------------------------------------------------------------------
+//  meshgen.c
+//
+//  See meshgen.h for details.
+//------------------------------------------------------------------------------
+#include "meshgen.h"
+#include "meshproc.h"
+#include "jobs.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+
+#define MESHGEN_DEFAULT_NUM_THREADS (4)
+#define MESHGEN_MAX_THREADS (32)
+#define MESHGEN_PI (3.14159265358979323846f)
+
+// unquantized vertex in the per-job scratch memory
+typedef struct {
+    float pos[3];
+    float normal[3];
+    float uv[2];
+} meshgen_fvertex_t;
+
+typedef struct {
+    meshgen_fvertex_t* vertices;
+    uint32_t* indices;
+    uint32_t num_vertices;
+    uint32_t num_indices;
+} meshgen_scratch_t;
+
+// one job per shape LOD
+typedef struct {
+    const meshgen_shape_t* shape;   // with defaults applied and LOD tessellation
+    meshgen_lod_t range;
+    float acmr_before;
+    float acmr_after;
+} meshgen_job_t;
+
+typedef struct {
+    uint32_t size;
+    int job;
+} meshgen_job_order_t;
+
+typedef struct {
+    const meshgen_desc_t* desc;
+    meshgen_shape_t* lod_shapes;
+    meshgen_job_t* jobs;
+    meshgen_job_order_t* order;     // jobs sorted by size, largest first
+    int num_jobs;
+} meshgen_ctx_t;
+
+//== SHAPE SIZES ===============================================================
+static int meshgen_def(int val, int def) {
+    return (val == 0) ? def : val;
+}
+
+static float meshgen_deff(float val, float def) {
+    return (val == 0.0f) ? def : val;
+}
+
+static meshgen_shape_t meshgen_shape_defaults(const meshgen_shape_t* shape) {
+    meshgen_shape_t res = *shape;
+    res.width = meshgen_deff(res.width, 1.0f);
+    res.height = meshgen_deff(res.height, 1.0f);
+    res.depth = meshgen_deff(res.depth, 1.0f);
+    res.radius = meshgen_deff(res.radius, 0.5f);
+    res.ring_radius = meshgen_deff(res.ring_radius, 0.2f);
+    res.tiles = meshgen_def(res.tiles, 1);
+    res.slices = meshgen_def(res.slices, 5);
+    res.stacks = meshgen_def(res.stacks, 4);
+    res.num_lods = meshgen_def(res.num_lods, 1);
+    if (res.num_lods > MESHGEN_MAX_LODS) {
+        res.num_lods = MESHGEN_MAX_LODS;
+    }
+    return res;
+}
+
+static int meshgen_lod_tess(int tess, int lod, int min_tess) {
+    const int res = tess >> lod;
+    return (res < min_tess) ? min_tess : res;
+}
+
+// tessellation of a LOD, the shape must have defaults applied
+static meshgen_shape_t meshgen_lod_shape(const meshgen_shape_t* shape, int lod) {
+    meshgen_shape_t res = *shape;
+    res.tiles = meshgen_lod_tess(shape->tiles, lod, 1);
+    switch (shape->type) {
+        case MESHGEN_SHAPE_SPHERE:
+            res.slices = meshgen_lod_tess(shape->slices, lod, 3);
+            res.stacks = meshgen_lod_tess(shape->stacks, lod, 2);
+            break;
+        case MESHGEN_SHAPE_CYLINDER:
+            res.slices = meshgen_lod_tess(shape->slices, lod, 3);
+            res.stacks = meshgen_lod_tess(shape->stacks, lod, 1);
+            break;
+        default:
+            res.slices = meshgen_lod_tess(shape->slices, lod, 3);
+            res.stacks = meshgen_lod_tess(shape->stacks, lod, 3);
+            break;
+    }
+    return res;
+}
+
+static meshgen_sizes_t meshgen_lod_sizes(const meshgen_shape_t* s) {
+    const uint32_t tiles = (uint32_t)s->tiles;
+    const uint32_t slices = (uint32_t)s->slices;
+    const uint32_t stacks = (uint32_t)s->stacks;
+    meshgen_sizes_t res = { 0, 0 };
+    switch (s->type) {
+        case MESHGEN_SHAPE_BOX:
+            res.num_vertices = 6 * (tiles + 1) * (tiles + 1);
+            res.num_indices = 6 * tiles * tiles * 6;
+            break;
+        case MESHGEN_SHAPE_PLANE:
+            res.num_vertices = (tiles + 1) * (tiles + 1);
+            res.num_indices = tiles * tiles * 6;
+            break;
+        case MESHGEN_SHAPE_SPHERE:
+            // one triangle per slice in the top and bottom stack
+            res.num_vertices = (slices + 1) * (stacks + 1);
+            res.num_indices = slices * (stacks - 1) * 6;
+            break;
+        case MESHGEN_SHAPE_CYLINDER:
+            // side, plus center and rim vertices for each cap
+            res.num_vertices = (slices + 1) * (stacks + 1) + 2 * (slices + 2);
+            res.num_indices = slices * stacks * 6 + 2 * slices * 3;
+            break;
+        case MESHGEN_SHAPE_TORUS:
+            res.num_vertices = (slices + 1) * (stacks + 1);
+            res.num_indices = slices * stacks * 6;
+            break;
+        default:
+            break;
+    }
+    return res;
+}
+
+static float meshgen_shape_radius(const meshgen_shape_t* s) {
+    switch (s->type) {
+        case MESHGEN_SHAPE_BOX:
+            return 0.5f * sqrtf(s->width * s->width + s->height * s->height + s->depth * s->depth);
+        case MESHGEN_SHAPE_PLANE:
+            return 0.5f * sqrtf(s->width * s->width + s->depth * s->depth);
+        case MESHGEN_SHAPE_SPHERE:
+            return s->radius;
+        case MESHGEN_SHAPE_CYLINDER:
+            return sqrtf(s->radius * s->radius + 0.25f * s->height * s->height);
+        case MESHGEN_SHAPE_TORUS:
+            return s->radius + s->ring_radius;
+        default:
+            return 0.0f;
+    }
+}
+
+//== GENERATORS ================================================================
+static void meshgen_vtx(meshgen_scratch_t* m, float px, float py, float pz, float nx, float ny, float nz, float u, float v) {
+    meshgen_fvertex_t* vtx = &m->vertices[m->num_vertices++];
+    vtx->pos[0] = px; vtx->pos[1] = py; vtx->pos[2] = pz;
+    vtx->normal[0] = nx; vtx->normal[1] = ny; vtx->normal[2] = nz;
+    vtx->uv[0] = u; vtx->uv[1] = v;
+}
+
+static void meshgen_tri(meshgen_scratch_t* m, uint32_t i0, uint32_t i1, uint32_t i2) {
+    m->indices[m->num_indices++] = i0;
+    m->indices[m->num_indices++] = i1;
+    m->indices[m->num_indices++] = i2;
+}
+
+// two triangles for each cell of a (cols+1) * (rows+1) vertex grid starting at base
+static void meshgen_grid_tris(meshgen_scratch_t* m, uint32_t base, uint32_t cols, uint32_t rows) {
+    for (uint32_t y = 0; y < rows; y++) {
+        for (uint32_t x = 0; x < cols; x++) {
+            const uint32_t i0 = base + y * (cols + 1) + x;
+            const uint32_t i1 = i0 + 1;
+            const uint32_t i2 = i0 + cols + 1;
+            const uint32_t i3 = i2 + 1;
+            meshgen_tri(m, i0, i2, i1);
+            meshgen_tri(m, i1, i2, i3);
+        }
+    }
+}
+
+static void meshgen_gen_plane(meshgen_scratch_t* m, const meshgen_shape_t* s) {
+    const uint32_t tiles = (uint32_t)s->tiles;
+    const uint32_t base = m->num_vertices;
+    for (uint32_t iz = 0; iz <= tiles; iz++) {
+        const float tz = (float)iz / (float)tiles;
+        for (uint32_t ix = 0; ix <= tiles; ix++) {
+            const float tx = (float)ix / (float)tiles;
+            meshgen_vtx(m, (tx - 0.5f) * s->width, 0.0f, (tz - 0.5f) * s->depth, 0.0f, 1.0f, 0.0f, tx, tz);
+        }
+    }
+    meshgen_grid_tris(m, base, tiles, tiles);
+}
+
+static void meshgen_gen_box(meshgen_scratch_t* m, const meshgen_shape_t* s) {
+    // per face: normal, u axis, v axis (v = n x u, so the triangles wind counter-clockwise)
+    static const float faces[6][3][3] = {
+        { { +1, 0, 0 }, { 0, 0, -1 }, { 0, +1, 0 } },
+        { { -1, 0, 0 }, { 0, 0, +1 }, { 0, +1, 0 } },
+        { { 0, +1, 0 }, { +1, 0, 0 }, { 0, 0, -1 } },
+        { { 0, -1, 0 }, { +1, 0, 0 }, { 0, 0, +1 } },
+        { { 0, 0, +1 }, { +1, 0, 0 }, { 0, +1, 0 } },
+        { { 0, 0, -1 }, { -1, 0, 0 }, { 0, +1, 0 } },
+    };
+    const uint32_t tiles = (uint32_t)s->tiles;
+    const float ext[3] = { 0.5f * s->width, 0.5f * s->height, 0.5f * s->depth };
+    for (int f = 0; f < 6; f++) {
+        const float* n = faces[f][0];
+        const float* du = faces[f][1];
+        const float* dv = faces[f][2];
+        const uint32_t base = m->num_vertices;
+        for (uint32_t iv = 0; iv <= tiles; iv++) {
+            const float tv = (float)iv / (float)tiles;
+            for (uint32_t iu = 0; iu <= tiles; iu++) {
+                const float tu = (float)iu / (float)tiles;
+                float p[3];
+                for (int i = 0; i < 3; i++) {
+                    p[i] = (n[i] + du[i] * (2.0f * tu - 1.0f) + dv[i] * (2.0f * tv - 1.0f)) * ext[i];
+                }
+                meshgen_vtx(m, p[0], p[1], p[2], n[0], n[1], n[2], tu, 1.0f - tv);
+            }
+        }
+        // the grid helper winds (u, v) clockwise, so swap the grid axes
+        for (uint32_t y = 0; y < tiles; y++) {
+            for (uint32_t x = 0; x < tiles; x++) {
+                const uint32_t i0 = base + y * (tiles + 1) + x;
+                const uint32_t i1 = i0 + 1;
+                const uint32_t i2 = i0 + tiles + 1;
+                const uint32_t i3 = i2 + 1;
+                meshgen_tri(m, i0, i1, i2);
+                meshgen_tri(m, i2, i1, i3);
+            }
+        }
+    }
+}
+
+static void meshgen_gen_sphere(meshgen_scratch_t* m, const meshgen_shape_t* s) {
+    const uint32_t slices = (uint32_t)s->slices;
+    const uint32_t stacks = (uint32_t)s->stacks;
+    const uint32_t base = m->num_vertices;
+    for (uint32_t stack = 0; stack <= stacks; stack++) {
+        const float tv = (float)stack / (float)stacks;
+        const float theta = tv * MESHGEN_PI;
+        const float sin_theta = sinf(theta);
+        const float cos_theta = cosf(theta);
+        for (uint32_t slice = 0; slice <= slices; slice++) {
+            const float tu = (float)slice / (float)slices;
+            const float phi = tu * 2.0f * MESHGEN_PI;
+            const float nx = sin_theta * sinf(phi);
+            const float ny = cos_theta;
+            const float nz = sin_theta * cosf(phi);
+            meshgen_vtx(m, nx * s->radius, ny * s->radius, nz * s->radius, nx, ny, nz, tu, tv);
+        }
+    }
+    const uint32_t row = slices + 1;
+    for (uint32_t stack = 0; stack < stacks; stack++) {
+        for (uint32_t slice = 0; slice < slices; slice++) {
+            const uint32_t i0 = base + stack * row + slice;
+            const uint32_t i1 = i0 + 1;
+            const uint32_t i2 = i0 + row;
+            const uint32_t i3 = i2 + 1;
+            if (stack != 0) {
+                meshgen_tri(m, i0, i2, i1);
+            }
+            if (stack != (stacks - 1)) {
+                meshgen_tri(m, i1, i2, i3);
+            }
+        }
+    }
+}
+
+static void meshgen_gen_cylinder(meshgen_scratch_t* m, const meshgen_shape_t* s) {
+    const uint32_t slices = (uint32_t)s->slices;
+    const uint32_t stacks = (uint32_t)s->stacks;
+    const float half_height = 0.5f * s->height;
+    // side, from top to bottom
+    const uint32_t side_base = m->num_vertices;
+    for (uint32_t stack = 0; stack <= stacks; stack++) {
+        const float tv = (float)stack / (float)stacks;
+        const float y = half_height - tv * s->height;
+        for (uint32_t slice = 0; slice <= slices; slice++) {
+            const float tu = (float)slice / (float)slices;
+            const float phi = tu * 2.0f * MESHGEN_PI;
+            const float nx = sinf(phi);
+            const float nz = cosf(phi);
+            meshgen_vtx(m, nx * s->radius, y, nz * s->radius, nx, 0.0f, nz, tu, tv);
+        }
+    }
+    meshgen_grid_tris(m, side_base, slices, stacks);
+    // top and bottom cap
+    for (int cap = 0; cap < 2; cap++) {
+        const float ny = (cap == 0) ? 1.0f : -1.0f;
+        const float y = ny * half_height;
+        const uint32_t center = m->num_vertices;
+        meshgen_vtx(m, 0.0f, y, 0.0f, 0.0f, ny, 0.0f, 0.5f, 0.5f);
+        for (uint32_t slice = 0; slice <= slices; slice++) {
+            const float phi = ((float)slice / (float)slices) * 2.0f * MESHGEN_PI;
+            const float sx = sinf(phi);
+            const float sz = cosf(phi);
+            meshgen_vtx(m, sx * s->radius, y, sz * s->radius, 0.0f, ny, 0.0f, 0.5f + 0.5f * sx, 0.5f + 0.5f * sz);
+        }
+        for (uint32_t slice = 0; slice < slices; slice++) {
+            const uint32_t i0 = center + 1 + slice;
+            if (cap == 0) {
+                meshgen_tri(m, center, i0, i0 + 1);
+            } else {
+                meshgen_tri(m, center, i0 + 1, i0);
+            }
+        }
+    }
+}
+
+static void meshgen_gen_torus(meshgen_scratch_t* m, const meshgen_shape_t* s) {
+    const uint32_t sides = (uint32_t)s->slices;
+    const uint32_t rings = (uint32_t)s->stacks;
+    const uint32_t base = m->num_vertices;
+    for (uint32_t ring = 0; ring <= rings; ring++) {
+        const float tv = (float)ring / (float)rings;
+        const float phi = tv * 2.0f * MESHGEN_PI;
+        const float sin_phi = sinf(phi);
+        const float cos_phi = cosf(phi);
+        for (uint32_t side = 0; side <= sides; side++) {
+            const float tu = (float)side / (float)sides;
+            const float theta = tu * 2.0f * MESHGEN_PI;
+            const float sin_theta = sinf(theta);
+            const float cos_theta = cosf(theta);
+            const float nx = cos_theta * sin_phi;
+            const float ny = sin_theta;
+            const float nz = cos_theta * cos_phi;
+            const float r = s->radius + s->ring_radius * cos_theta;
+            meshgen_vtx(m, r * sin_phi, s->ring_radius * sin_theta, r * cos_phi, nx, ny, nz, tu, tv);
+        }
+    }
+    meshgen_grid_tris(m, base, sides, rings);
+}
+
+static void meshgen_generate(meshgen_scratch_t* m, const meshgen_shape_t* s) {
+    switch (s->type) {
+        case MESHGEN_SHAPE_BOX:         meshgen_gen_box(m, s); break;
+        case MESHGEN_SHAPE_PLANE:       meshgen_gen_plane(m, s); break;
+        case MESHGEN_SHAPE_SPHERE:      meshgen_gen_sphere(m, s); break;
+        case MESHGEN_SHAPE_CYLINDER:    meshgen_gen_cylinder(m, s); break;
+        case MESHGEN_SHAPE_TORUS:       meshgen_gen_torus(m, s); break;
+        default: break;
+    }
+}
+
+//== QUANTIZATION ==============================================================
+static void meshgen_quantize(meshgen_vertex_t* dst, const meshgen_fvertex_t* src) {
+    dst->pos[0] = meshproc_half(src->pos[0]);
+    dst->pos[1] = meshproc_half(src->pos[1]);
+    dst->pos[2] = meshproc_half(src->pos[2]);
+    dst->pos[3] = 0x3C00;   // 1.0
+    meshproc_oct_encode(src->normal, dst->normal);
+    dst->uv[0] = meshproc_unorm16(src->uv[0]);
+    dst->uv[1] = meshproc_unorm16(src->uv[1]);
+}
+
+//== JOBS ======================================================================
+static void meshgen_run_job(const meshgen_desc_t* desc, meshgen_job_t* job) {
+    const meshgen_lod_t* r = &job->range;
+    meshgen_scratch_t m = {
+        .vertices = (meshgen_fvertex_t*)malloc(r->num_vertices * sizeof(meshgen_fvertex_t)),
+        .indices = (uint32_t*)malloc(r->num_elements * sizeof(uint32_t)),
+    };
+    meshgen_generate(&m, job->shape);
+    assert((m.num_vertices == r->num_vertices) && (m.num_indices == r->num_elements));
+
+    // reorder triangles, then vertices by first use, unreferenced vertices
+    // (e.g. the last one of a sphere pole row) go to the end
+    uint32_t* remap = (uint32_t*)malloc(m.num_vertices * sizeof(uint32_t));
+    job->acmr_before = meshproc_acmr(m.indices, m.num_indices, m.num_vertices);
+    if (!desc->no_optimize) {
+        meshproc_optimize_vertex_cache(m.indices, m.num_indices, m.num_vertices);
+    }
+    meshproc_optimize_vertex_fetch(remap, m.indices, m.num_indices, m.num_vertices);
+    meshgen_vertex_t* dst_vertices = desc->vertices + r->base_vertex;
+    for (uint32_t i = 0; i < m.num_vertices; i++) {
+        meshgen_quantize(&dst_vertices[remap[i]], &m.vertices[i]);
+    }
+    job->acmr_after = meshproc_acmr(m.indices, m.num_indices, m.num_vertices);
+    uint32_t* dst_indices = desc->indices + r->base_element;
+    for (uint32_t i = 0; i < m.num_indices; i++) {
+        dst_indices[i] = r->base_vertex + m.indices[i];
+    }
+
+    free(remap);
+    free(m.indices);
+    free(m.vertices);
+}
+
+// runs the jobs in the sorted order
+static void meshgen_run_ordered_job(void* user_data, int order_index) {
+    meshgen_ctx_t* ctx = (meshgen_ctx_t*)user_data;
+    meshgen_run_job(ctx->desc, &ctx->jobs[ctx->order[order_index].job]);
+}
+
+static void meshgen_run_jobs(meshgen_ctx_t* ctx, int num_threads) {
+    if (num_threads > ctx->num_jobs) {
+        num_threads = ctx->num_jobs;
+    }
+    if (num_threads < 1) {
+        num_threads = 1;
+    }
+    jobs_t* jobs = jobs_create(&(jobs_desc_t){ .num_threads = num_threads });
+    jobs_run(jobs, meshgen_run_ordered_job, ctx, ctx->num_jobs);
+    jobs_destroy(jobs);
+}
+
+static int meshgen_cmp_job_size(const void* a, const void* b) {
+    const meshgen_job_order_t* oa = (const meshgen_job_order_t*)a;
+    const meshgen_job_order_t* ob = (const meshgen_job_order_t*)b;
+    if (oa->size != ob->size) {
+        return (oa->size > ob->size) ? -1 : 1;
+    }
+    return oa->job - ob->job;
+}
+
+//== PUBLIC API ================================================================
+meshgen_sizes_t meshgen_query_sizes(const meshgen_shape_t* shapes, int num_shapes) {
+    assert(shapes || (num_shapes == 0));
+    meshgen_sizes_t res = { 0, 0 };
+    for (int i = 0; i < num_shapes; i++) {
+        const meshgen_shape_t shape = meshgen_shape_defaults(&shapes[i]);
+        for (int lod = 0; lod < shape.num_lods; lod++) {
+            const meshgen_shape_t lod_shape = meshgen_lod_shape(&shape, lod);
+            const meshgen_sizes_t sizes = meshgen_lod_sizes(&lod_shape);
+            res.num_vertices += sizes.num_vertices;
+            res.num_indices += sizes.num_indices;
+        }
+    }
+    return res;
+}
+
+meshgen_result_t meshgen_build(const meshgen_desc_t* desc) {
+    assert(desc && desc->shapes && desc->meshes && desc->vertices && desc->indices);
+    meshgen_result_t res = { 0 };
+    const meshgen_sizes_t total = meshgen_query_sizes(desc->shapes, desc->num_shapes);
+    if ((total.num_vertices > desc->max_vertices) || (total.num_indices > desc->max_indices)) {
+        return res;
+    }
+    int num_threads = (desc->num_threads > 0) ? desc->num_threads : MESHGEN_DEFAULT_NUM_THREADS;
+    if (num_threads > MESHGEN_MAX_THREADS) {
+        num_threads = MESHGEN_MAX_THREADS;
+    }
+
+    // assign each LOD its range of the arenas up front, so the jobs don't need to synchronize
+    meshgen_ctx_t ctx = { .desc = desc };
+    const size_t max_jobs = (size_t)desc->num_shapes * MESHGEN_MAX_LODS;
+    ctx.lod_shapes = (meshgen_shape_t*)calloc(max_jobs, sizeof(meshgen_shape_t));
+    ctx.jobs = (meshgen_job_t*)calloc(max_jobs, sizeof(meshgen_job_t));
+    ctx.order = (meshgen_job_order_t*)calloc(max_jobs, sizeof(meshgen_job_order_t));
+    uint32_t base_vertex = 0;
+    uint32_t base_element = 0;
+    for (int i = 0; i < desc->num_shapes; i++) {
+        const meshgen_shape_t shape = meshgen_shape_defaults(&desc->shapes[i]);
+        meshgen_mesh_t* mesh = &desc->meshes[i];
+        memset(mesh, 0, sizeof(meshgen_mesh_t));
+        mesh->num_lods = shape.num_lods;
+        mesh->radius = meshgen_shape_radius(&shape);
+        for (int lod = 0; lod < shape.num_lods; lod++) {
+            const int job_index = ctx.num_jobs++;
+            ctx.lod_shapes[job_index] = meshgen_lod_shape(&shape, lod);
+            const meshgen_sizes_t sizes = meshgen_lod_sizes(&ctx.lod_shapes[job_index]);
+            meshgen_job_t* job = &ctx.jobs[job_index];
+            job->shape = &ctx.lod_shapes[job_index];
+            job->range.base_vertex = base_vertex;
+            job->range.num_vertices = sizes.num_vertices;
+            job->range.base_element = base_element;
+            job->range.num_elements = sizes.num_indices;
+            mesh->lods[lod] = job->range;
+            ctx.order[job_index].size = sizes.num_indices;
+            ctx.order[job_index].job = job_index;
+            base_vertex += sizes.num_vertices;
+            base_element += sizes.num_indices;
+        }
+    }
+    // start with the biggest jobs for better load balancing
+    qsort(ctx.order, (size_t)ctx.num_jobs, sizeof(meshgen_job_order_t), meshgen_cmp_job_size);
+
+    meshgen_run_jobs(&ctx, num_threads);
+
+    double misses_before = 0.0;
+    double misses_after = 0.0;
+    for (int i = 0; i < ctx.num_jobs; i++) {
+        const double num_tris = (double)ctx.jobs[i].range.num_elements / 3.0;
+        misses_before += ctx.jobs[i].acmr_before * num_tris;
+        misses_after += ctx.jobs[i].acmr_after * num_tris;
+    }
+    res.valid = true;
+    res.num_vertices = base_vertex;
+    res.num_indices = base_element;
+    if (base_element > 0) {
+        res.acmr_before = (float)(misses_before * 3.0 / base_element);
+        res.acmr_after = (float)(misses_after * 3.0 / base_element);
+    }
+    free(ctx.order);
+    free(ctx.jobs);
+    free(ctx.lod_shapes);
+    return res;
+}
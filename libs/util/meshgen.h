@@ -0,0 +1,118 @@
+#pragma once
+/*
+    Procedural shape meshes with LODs, generated in parallel into
+    caller-provided vertex and index arenas.
+
+    The shapes are the same as in sokol_shape.h (box, plane, sphere,
+    cylinder and torus), but without the 16-bit index limit, so they can
+    be tessellated much higher. Each shape gets up to MESHGEN_MAX_LODS
+    levels of detail, each LOD halves the tessellation of the previous one.
+
+    meshgen_build() splits the work into one job per shape LOD and runs
+    the jobs on worker threads (except on the web). Each job:
+
+    - generates the mesh into thread-local scratch memory
+    - reorders the triangles for the post-transform vertex cache
+      (Tom Forsyth's linear-speed vertex cache optimisation, see meshproc.h)
+    - reorders the vertices by first use in the index buffer
+    - writes quantized vertices and 32-bit indices into its own range of
+      the caller's arenas
+
+    The index values already include the LOD's base vertex, so all LODs
+    of all shapes can go into one vertex buffer and one index buffer and
+    each LOD is drawn with sg_draw(base_element, num_elements, 1).
+
+    The vertex format is 16 bytes:
+
+    - position: SG_VERTEXFORMAT_HALF4 (w is 1.0)
+    - normal:   SG_VERTEXFORMAT_SHORT2N, octahedron-encoded unit vector
+    - texcoord: SG_VERTEXFORMAT_USHORT2N
+
+    Use meshgen_query_sizes() to size the arenas.
+*/
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#define MESHGEN_MAX_LODS (8)
+
+typedef enum meshgen_shape_type_t {
+    MESHGEN_SHAPE_BOX,
+    MESHGEN_SHAPE_PLANE,
+    MESHGEN_SHAPE_SPHERE,
+    MESHGEN_SHAPE_CYLINDER,
+    MESHGEN_SHAPE_TORUS,
+    MESHGEN_NUM_SHAPE_TYPES,
+} meshgen_shape_type_t;
+
+// zero-initialized items get the same defaults as in sokol_shape.h
+typedef struct meshgen_shape_t {
+    meshgen_shape_type_t type;
+    float width;            // box, plane (default: 1.0)
+    float height;           // box, cylinder (default: 1.0)
+    float depth;            // box, plane (default: 1.0)
+    float radius;           // sphere, cylinder, torus (default: 0.5)
+    float ring_radius;      // torus (default: 0.2)
+    int tiles;              // box, plane (default: 1)
+    int slices;             // sphere, cylinder, torus sides (default: 5)
+    int stacks;             // sphere, cylinder, torus rings (default: 4)
+    int num_lods;           // default: 1
+} meshgen_shape_t;
+
+typedef struct meshgen_vertex_t {
+    uint16_t pos[4];        // half floats
+    int16_t normal[2];      // octahedron-encoded, snorm16
+    uint16_t uv[2];         // unorm16
+} meshgen_vertex_t;
+
+typedef struct meshgen_lod_t {
+    uint32_t base_vertex;
+    uint32_t num_vertices;
+    uint32_t base_element;
+    uint32_t num_elements;
+} meshgen_lod_t;
+
+typedef struct meshgen_mesh_t {
+    int num_lods;
+    float radius;           // bounding sphere radius around the origin
+    meshgen_lod_t lods[MESHGEN_MAX_LODS];
+} meshgen_mesh_t;
+
+typedef struct meshgen_sizes_t {
+    uint32_t num_vertices;
+    uint32_t num_indices;
+} meshgen_sizes_t;
+
+typedef struct meshgen_desc_t {
+    const meshgen_shape_t* shapes;
+    int num_shapes;
+    meshgen_mesh_t* meshes;         // num_shapes items, written by meshgen_build()
+    meshgen_vertex_t* vertices;     // caller-provided vertex arena
+    uint32_t max_vertices;
+    uint32_t* indices;              // caller-provided index arena
+    uint32_t max_indices;
+    bool no_optimize;               // skip the vertex cache optimisation
+    int num_threads;                // including the calling thread, default: 4
+} meshgen_desc_t;
+
+typedef struct meshgen_result_t {
+    bool valid;                     // false if the arenas are too small
+    uint32_t num_vertices;
+    uint32_t num_indices;
+    // average cache miss ratio (vertex shader invocations per triangle) for
+    // a 16-entry FIFO cache, before and after the index reordering
+    float acmr_before;
+    float acmr_after;
+} meshgen_result_t;
+
+// total number of vertices and indices of all shapes and their LODs
+meshgen_sizes_t meshgen_query_sizes(const meshgen_shape_t* shapes, int num_shapes);
+// generate all shapes into the arenas
+meshgen_result_t meshgen_build(const meshgen_desc_t* desc);
+
+#if defined(__cplusplus)
+}
+#endif
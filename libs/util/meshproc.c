@@ -0,0 +1,807 @@
+//------------------------------------------------------------------------------
+//  meshproc.c
+//
+//  See meshproc.h for details.
+//------------------------------------------------------------------------------
+#include "meshproc.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+
+// simulated post-transform cache size for the optimisation
+#define MESHPROC_OPT_CACHE_SIZE (32)
+// FIFO cache size for the ACMR statistics and the overdraw clusters
+#define MESHPROC_FIFO_CACHE_SIZE (16)
+
+// EXT_meshopt_compression constants
+#define MESHPROC_VERTEX_HEADER (0xA0)
+#define MESHPROC_INDEX_HEADER (0xE0)
+#define MESHPROC_SEQUENCE_HEADER (0xD0)
+#define MESHPROC_BYTE_GROUP_SIZE (16)
+#define MESHPROC_BYTE_GROUP_DECODE_LIMIT (24)
+#define MESHPROC_VERTEX_BLOCK_SIZE_BYTES (8192)
+#define MESHPROC_VERTEX_BLOCK_MAX_SIZE (256)
+#define MESHPROC_TAIL_MAX_SIZE (32)
+
+//== FIFO CACHE SIMULATION =====================================================
+// stamps must have num_vertices zero-initialized items, returns the number of misses
+static uint32_t meshproc_fifo_tri(const uint32_t* tri, uint32_t* stamps, uint32_t* time) {
+    uint32_t misses = 0;
+    for (int i = 0; i < 3; i++) {
+        const uint32_t v = tri[i];
+        if ((stamps[v] == 0) || ((*time - stamps[v]) > MESHPROC_FIFO_CACHE_SIZE)) {
+            stamps[v] = (*time)++;
+            misses++;
+        }
+    }
+    return misses;
+}
+
+float meshproc_acmr(const uint32_t* indices, uint32_t num_indices, uint32_t num_vertices) {
+    const uint32_t num_tris = num_indices / 3;
+    if (num_tris == 0) {
+        return 0.0f;
+    }
+    uint32_t* stamps = (uint32_t*)calloc(num_vertices, sizeof(uint32_t));
+    uint32_t time = MESHPROC_FIFO_CACHE_SIZE + 1;
+    uint32_t misses = 0;
+    for (uint32_t t = 0; t < num_tris; t++) {
+        misses += meshproc_fifo_tri(&indices[t * 3], stamps, &time);
+    }
+    free(stamps);
+    return (float)misses / (float)num_tris;
+}
+
+//== VERTEX CACHE OPTIMISATION =================================================
+static float meshproc_vertex_score(int cache_pos, uint32_t remaining) {
+    if (remaining == 0) {
+        return -1.0f;
+    }
+    float score = 0.0f;
+    if (cache_pos >= 0) {
+        if (cache_pos < 3) {
+            // the vertices of the last triangle are scored lower on purpose
+            score = 0.75f;
+        } else {
+            const float scale = 1.0f / (float)(MESHPROC_OPT_CACHE_SIZE - 3);
+            score = powf(1.0f - (float)(cache_pos - 3) * scale, 1.5f);
+        }
+    }
+    // boost vertices with few remaining triangles, so that lone triangles get done early
+    score += 2.0f / sqrtf((float)remaining);
+    return score;
+}
+
+// Tom Forsyth's linear-speed vertex cache optimisation
+void meshproc_optimize_vertex_cache(uint32_t* indices, uint32_t num_indices, uint32_t num_vertices) {
+    const uint32_t num_tris = num_indices / 3;
+    if (num_tris == 0) {
+        return;
+    }
+    uint32_t* remaining = (uint32_t*)calloc(num_vertices, sizeof(uint32_t));
+    uint32_t* tri_offset = (uint32_t*)calloc(num_vertices + 1, sizeof(uint32_t));
+    uint32_t* tri_list = (uint32_t*)malloc(num_indices * sizeof(uint32_t));
+    int* cache_pos = (int*)malloc(num_vertices * sizeof(int));
+    float* vertex_score = (float*)malloc(num_vertices * sizeof(float));
+    float* tri_score = (float*)calloc(num_tris, sizeof(float));
+    bool* tri_added = (bool*)calloc(num_tris, sizeof(bool));
+    uint32_t* out = (uint32_t*)malloc(num_indices * sizeof(uint32_t));
+
+    // per-vertex lists of triangles which have not been added yet
+    for (uint32_t i = 0; i < num_indices; i++) {
+        remaining[indices[i]]++;
+    }
+    for (uint32_t v = 0; v < num_vertices; v++) {
+        tri_offset[v + 1] = tri_offset[v] + remaining[v];
+        remaining[v] = 0;
+    }
+    for (uint32_t i = 0; i < num_indices; i++) {
+        const uint32_t v = indices[i];
+        tri_list[tri_offset[v] + remaining[v]++] = i / 3;
+    }
+    for (uint32_t v = 0; v < num_vertices; v++) {
+        cache_pos[v] = -1;
+        vertex_score[v] = meshproc_vertex_score(-1, remaining[v]);
+    }
+    for (uint32_t i = 0; i < num_indices; i++) {
+        tri_score[i / 3] += vertex_score[indices[i]];
+    }
+
+    uint32_t cache[MESHPROC_OPT_CACHE_SIZE + 3];
+    int cache_len = 0;
+    int64_t best_tri = -1;
+    float best_score = -1.0f;
+    for (uint32_t t = 0; t < num_tris; t++) {
+        if (tri_score[t] > best_score) {
+            best_score = tri_score[t];
+            best_tri = t;
+        }
+    }
+    uint32_t scan_cursor = 0;
+    for (uint32_t out_tri = 0; out_tri < num_tris; out_tri++) {
+        if (best_tri < 0) {
+            // nothing in the cache has triangles left, continue with the next unused triangle
+            while (tri_added[scan_cursor]) {
+                scan_cursor++;
+            }
+            best_tri = scan_cursor;
+        }
+        const uint32_t t = (uint32_t)best_tri;
+        tri_added[t] = true;
+        const uint32_t* tri = &indices[t * 3];
+        out[out_tri * 3 + 0] = tri[0];
+        out[out_tri * 3 + 1] = tri[1];
+        out[out_tri * 3 + 2] = tri[2];
+
+        // remove the triangle from its vertices' lists
+        for (int i = 0; i < 3; i++) {
+            const uint32_t v = tri[i];
+            uint32_t* list = &tri_list[tri_offset[v]];
+            for (uint32_t j = 0; j < remaining[v]; j++) {
+                if (list[j] == t) {
+                    list[j] = list[remaining[v] - 1];
+                    remaining[v]--;
+                    break;
+                }
+            }
+        }
+
+        // move the triangle's vertices to the front of the cache
+        uint32_t new_cache[MESHPROC_OPT_CACHE_SIZE + 3];
+        int new_len = 0;
+        for (int i = 0; i < 3; i++) {
+            new_cache[new_len++] = tri[i];
+        }
+        for (int i = 0; i < cache_len; i++) {
+            const uint32_t v = cache[i];
+            if ((v != tri[0]) && (v != tri[1]) && (v != tri[2])) {
+                new_cache[new_len++] = v;
+            }
+        }
+
+        // rescore the vertices in the cache (and the ones which just dropped out)
+        for (int i = 0; i < new_len; i++) {
+            const uint32_t v = new_cache[i];
+            cache_pos[v] = (i < MESHPROC_OPT_CACHE_SIZE) ? i : -1;
+            const float score = meshproc_vertex_score(cache_pos[v], remaining[v]);
+            const float diff = score - vertex_score[v];
+            vertex_score[v] = score;
+            const uint32_t* list = &tri_list[tri_offset[v]];
+            for (uint32_t j = 0; j < remaining[v]; j++) {
+                tri_score[list[j]] += diff;
+            }
+        }
+        best_tri = -1;
+        best_score = -1.0f;
+        for (int i = 0; i < new_len; i++) {
+            const uint32_t v = new_cache[i];
+            const uint32_t* list = &tri_list[tri_offset[v]];
+            for (uint32_t j = 0; j < remaining[v]; j++) {
+                if (tri_score[list[j]] > best_score) {
+                    best_score = tri_score[list[j]];
+                    best_tri = list[j];
+                }
+            }
+        }
+        cache_len = (new_len < MESHPROC_OPT_CACHE_SIZE) ? new_len : MESHPROC_OPT_CACHE_SIZE;
+        memcpy(cache, new_cache, (size_t)cache_len * sizeof(uint32_t));
+    }
+    memcpy(indices, out, num_indices * sizeof(uint32_t));
+
+    free(out);
+    free(tri_added);
+    free(tri_score);
+    free(vertex_score);
+    free(cache_pos);
+    free(tri_list);
+    free(tri_offset);
+    free(remaining);
+}
+
+//== OVERDRAW OPTIMISATION =====================================================
+typedef struct {
+    float key;
+    uint32_t cluster;
+} meshproc_cluster_key_t;
+
+static int meshproc_cmp_cluster_key(const void* a, const void* b) {
+    const meshproc_cluster_key_t* ka = (const meshproc_cluster_key_t*)a;
+    const meshproc_cluster_key_t* kb = (const meshproc_cluster_key_t*)b;
+    // descending key, keep the original order on ties
+    if (ka->key != kb->key) {
+        return (ka->key > kb->key) ? -1 : 1;
+    }
+    return (ka->cluster < kb->cluster) ? -1 : ((ka->cluster > kb->cluster) ? 1 : 0);
+}
+
+static const float* meshproc_pos(const float* positions, size_t stride, uint32_t v) {
+    return (const float*)((const uint8_t*)positions + v * stride);
+}
+
+void meshproc_optimize_overdraw(uint32_t* indices, uint32_t num_indices, const float* positions, uint32_t num_vertices, size_t position_stride, float threshold) {
+    const uint32_t num_tris = num_indices / 3;
+    if (num_tris == 0) {
+        return;
+    }
+    uint32_t* stamps = (uint32_t*)calloc(num_vertices, sizeof(uint32_t));
+    uint32_t* hard = (uint32_t*)malloc((num_tris + 1) * sizeof(uint32_t));
+    uint32_t* soft = (uint32_t*)malloc((num_tris + 1) * sizeof(uint32_t));
+    uint32_t time = MESHPROC_FIFO_CACHE_SIZE + 1;
+
+    // hard cluster boundaries: where all 3 vertices miss the cache, the vertex
+    // cache optimisation has started over in a disjoint part of the mesh
+    uint32_t num_hard = 0;
+    for (uint32_t t = 0; t < num_tris; t++) {
+        const uint32_t misses = meshproc_fifo_tri(&indices[t * 3], stamps, &time);
+        if ((t == 0) || (misses == 3)) {
+            hard[num_hard++] = t;
+        }
+    }
+    hard[num_hard] = num_tris;
+
+    // soft boundaries: split the hard clusters further wherever the running
+    // ACMR is within the threshold of the whole hard cluster's ACMR
+    uint32_t num_soft = 0;
+    for (uint32_t c = 0; c < num_hard; c++) {
+        const uint32_t start = hard[c];
+        const uint32_t end = hard[c + 1];
+        time += MESHPROC_FIFO_CACHE_SIZE + 1;
+        uint32_t cluster_misses = 0;
+        for (uint32_t t = start; t < end; t++) {
+            cluster_misses += meshproc_fifo_tri(&indices[t * 3], stamps, &time);
+        }
+        const float cluster_threshold = threshold * ((float)cluster_misses / (float)(end - start));
+        soft[num_soft++] = start;
+        time += MESHPROC_FIFO_CACHE_SIZE + 1;
+        uint32_t running_misses = 0;
+        uint32_t running_tris = 0;
+        for (uint32_t t = start; t < end; t++) {
+            running_misses += meshproc_fifo_tri(&indices[t * 3], stamps, &time);
+            running_tris++;
+            if (((float)running_misses / (float)running_tris) <= cluster_threshold) {
+                soft[num_soft++] = t + 1;
+                time += MESHPROC_FIFO_CACHE_SIZE + 1;
+                running_misses = 0;
+                running_tris = 0;
+            }
+        }
+        // the last soft cluster is usually a small leftover, merge it with the one before
+        if (soft[num_soft - 1] != start) {
+            num_soft--;
+        }
+    }
+    soft[num_soft] = num_tris;
+
+    // sort key: how much a cluster faces away from the mesh center
+    float mesh_center[3] = { 0.0f, 0.0f, 0.0f };
+    for (uint32_t i = 0; i < num_indices; i++) {
+        const float* p = meshproc_pos(positions, position_stride, indices[i]);
+        mesh_center[0] += p[0];
+        mesh_center[1] += p[1];
+        mesh_center[2] += p[2];
+    }
+    for (int i = 0; i < 3; i++) {
+        mesh_center[i] /= (float)num_indices;
+    }
+    meshproc_cluster_key_t* keys = (meshproc_cluster_key_t*)malloc(num_soft * sizeof(meshproc_cluster_key_t));
+    for (uint32_t c = 0; c < num_soft; c++) {
+        float area = 0.0f;
+        float center[3] = { 0.0f, 0.0f, 0.0f };
+        float normal[3] = { 0.0f, 0.0f, 0.0f };
+        for (uint32_t t = soft[c]; t < soft[c + 1]; t++) {
+            const float* p0 = meshproc_pos(positions, position_stride, indices[t * 3 + 0]);
+            const float* p1 = meshproc_pos(positions, position_stride, indices[t * 3 + 1]);
+            const float* p2 = meshproc_pos(positions, position_stride, indices[t * 3 + 2]);
+            const float e0[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+            const float e1[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+            const float n[3] = {
+                e0[1] * e1[2] - e0[2] * e1[1],
+                e0[2] * e1[0] - e0[0] * e1[2],
+                e0[0] * e1[1] - e0[1] * e1[0],
+            };
+            const float a = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+            for (int i = 0; i < 3; i++) {
+                center[i] += (p0[i] + p1[i] + p2[i]) * (a / 3.0f);
+                normal[i] += n[i];
+            }
+            area += a;
+        }
+        const float inv_area = (area > 0.0f) ? (1.0f / area) : 0.0f;
+        const float nl = sqrtf(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+        const float inv_nl = (nl > 0.0f) ? (1.0f / nl) : 0.0f;
+        float key = 0.0f;
+        for (int i = 0; i < 3; i++) {
+            key += (center[i] * inv_area - mesh_center[i]) * normal[i] * inv_nl;
+        }
+        keys[c].key = key;
+        keys[c].cluster = c;
+    }
+    qsort(keys, num_soft, sizeof(meshproc_cluster_key_t), meshproc_cmp_cluster_key);
+
+    uint32_t* out = (uint32_t*)malloc(num_indices * sizeof(uint32_t));
+    uint32_t num_out = 0;
+    for (uint32_t i = 0; i < num_soft; i++) {
+        const uint32_t c = keys[i].cluster;
+        const uint32_t n = (soft[c + 1] - soft[c]) * 3;
+        memcpy(&out[num_out], &indices[soft[c] * 3], n * sizeof(uint32_t));
+        num_out += n;
+    }
+    assert(num_out == num_tris * 3);
+    memcpy(indices, out, num_out * sizeof(uint32_t));
+
+    free(out);
+    free(keys);
+    free(soft);
+    free(hard);
+    free(stamps);
+}
+
+//== VERTEX FETCH OPTIMISATION =================================================
+uint32_t meshproc_optimize_vertex_fetch(uint32_t* remap, uint32_t* indices, uint32_t num_indices, uint32_t num_vertices) {
+    memset(remap, 0xFF, num_vertices * sizeof(uint32_t));
+    uint32_t next_vertex = 0;
+    for (uint32_t i = 0; i < num_indices; i++) {
+        uint32_t* v = &remap[indices[i]];
+        if (*v == UINT32_MAX) {
+            *v = next_vertex++;
+        }
+        indices[i] = *v;
+    }
+    const uint32_t num_referenced = next_vertex;
+    for (uint32_t i = 0; i < num_vertices; i++) {
+        if (remap[i] == UINT32_MAX) {
+            remap[i] = next_vertex++;
+        }
+    }
+    return num_referenced;
+}
+
+//== QUANTIZATION ==============================================================
+uint16_t meshproc_half(float f) {
+    union { float f; uint32_t u; } bits;
+    bits.f = f;
+    const uint32_t sign = (bits.u >> 16) & 0x8000;
+    const int32_t exp = (int32_t)((bits.u >> 23) & 0xFF) - 127 + 15;
+    uint32_t mant = bits.u & 0x007FFFFF;
+    if (exp >= 31) {
+        return (uint16_t)(sign | 0x7C00);
+    }
+    if (exp <= 0) {
+        // denormal or zero
+        if (exp < -10) {
+            return (uint16_t)sign;
+        }
+        mant |= 0x00800000;
+        const uint32_t shift = (uint32_t)(14 - exp);
+        uint32_t half = mant >> shift;
+        if ((mant >> (shift - 1)) & 1) {
+            half++;
+        }
+        return (uint16_t)(sign | half);
+    }
+    // round to nearest, a carry correctly bumps the exponent
+    uint32_t half = sign | ((uint32_t)exp << 10) | (mant >> 13);
+    if (mant & 0x1000) {
+        half++;
+    }
+    return (uint16_t)half;
+}
+
+int16_t meshproc_snorm16(float f) {
+    f = (f < -1.0f) ? -1.0f : ((f > 1.0f) ? 1.0f : f);
+    return (int16_t)lrintf(f * 32767.0f);
+}
+
+uint16_t meshproc_unorm16(float f) {
+    f = (f < 0.0f) ? 0.0f : ((f > 1.0f) ? 1.0f : f);
+    return (uint16_t)lrintf(f * 65535.0f);
+}
+
+// octahedron encoding, see "A Survey of Efficient Representations for Independent Unit Vectors"
+void meshproc_oct_encode(const float n[3], int16_t out[2]) {
+    const float l1 = fabsf(n[0]) + fabsf(n[1]) + fabsf(n[2]);
+    if (l1 == 0.0f) {
+        out[0] = 0;
+        out[1] = 0;
+        return;
+    }
+    float x = n[0] / l1;
+    float y = n[1] / l1;
+    if (n[2] < 0.0f) {
+        const float ox = (1.0f - fabsf(y)) * ((x >= 0.0f) ? 1.0f : -1.0f);
+        const float oy = (1.0f - fabsf(x)) * ((y >= 0.0f) ? 1.0f : -1.0f);
+        x = ox;
+        y = oy;
+    }
+    out[0] = meshproc_snorm16(x);
+    out[1] = meshproc_snorm16(y);
+}
+
+//== EXT_meshopt_compression: ATTRIBUTES =======================================
+static uint32_t meshproc_vertex_block_size(uint32_t stride) {
+    uint32_t result = MESHPROC_VERTEX_BLOCK_SIZE_BYTES / stride;
+    result &= ~(uint32_t)(MESHPROC_BYTE_GROUP_SIZE - 1);
+    return (result < MESHPROC_VERTEX_BLOCK_MAX_SIZE) ? result : MESHPROC_VERTEX_BLOCK_MAX_SIZE;
+}
+
+// 16 values of 0, 2, 4 or 8 bits, values which don't fit follow as full bytes
+static const uint8_t* meshproc_decode_bytes_group(const uint8_t* src, uint8_t* dst, int bits_log2) {
+    switch (bits_log2) {
+        case 0:
+            memset(dst, 0, MESHPROC_BYTE_GROUP_SIZE);
+            return src;
+        case 1:
+        case 2: {
+            const int bits = 1 << bits_log2;
+            const uint8_t sentinel = (uint8_t)((1 << bits) - 1);
+            const uint8_t* var = src + (MESHPROC_BYTE_GROUP_SIZE * bits) / 8;
+            for (int i = 0; i < MESHPROC_BYTE_GROUP_SIZE; i++) {
+                const int bit = i * bits;
+                const uint8_t enc = (uint8_t)((src[bit / 8] >> (8 - bits - (bit % 8))) & sentinel);
+                dst[i] = (enc == sentinel) ? *var++ : enc;
+            }
+            return var;
+        }
+        default:
+            memcpy(dst, src, MESHPROC_BYTE_GROUP_SIZE);
+            return src + MESHPROC_BYTE_GROUP_SIZE;
+    }
+}
+
+static const uint8_t* meshproc_decode_bytes(const uint8_t* src, const uint8_t* src_end, uint8_t* dst, uint32_t size) {
+    assert((size % MESHPROC_BYTE_GROUP_SIZE) == 0);
+    const uint8_t* header = src;
+    // 2 bits per group
+    const uint32_t header_size = (size / MESHPROC_BYTE_GROUP_SIZE + 3) / 4;
+    if ((size_t)(src_end - src) < header_size) {
+        return 0;
+    }
+    src += header_size;
+    for (uint32_t i = 0; i < size; i += MESHPROC_BYTE_GROUP_SIZE) {
+        if ((size_t)(src_end - src) < MESHPROC_BYTE_GROUP_DECODE_LIMIT) {
+            return 0;
+        }
+        const uint32_t group = i / MESHPROC_BYTE_GROUP_SIZE;
+        const int bits_log2 = (header[group / 4] >> ((group % 4) * 2)) & 3;
+        src = meshproc_decode_bytes_group(src, dst + i, bits_log2);
+    }
+    return src;
+}
+
+static const uint8_t* meshproc_decode_vertex_block(const uint8_t* src, const uint8_t* src_end, uint8_t* dst, uint32_t count, uint32_t stride, uint8_t* last_vertex) {
+    uint8_t deltas[MESHPROC_VERTEX_BLOCK_MAX_SIZE];
+    const uint32_t count_aligned = (count + MESHPROC_BYTE_GROUP_SIZE - 1) & ~(uint32_t)(MESHPROC_BYTE_GROUP_SIZE - 1);
+    // each byte of the vertex is stored separately as zigzag-encoded deltas
+    for (uint32_t k = 0; k < stride; k++) {
+        src = meshproc_decode_bytes(src, src_end, deltas, count_aligned);
+        if (!src) {
+            return 0;
+        }
+        uint8_t p = last_vertex[k];
+        for (uint32_t i = 0; i < count; i++) {
+            const uint8_t d = deltas[i];
+            p = (uint8_t)(p + (uint8_t)((0 - (d & 1)) ^ (d >> 1)));
+            dst[i * stride + k] = p;
+        }
+        last_vertex[k] = p;
+    }
+    return src;
+}
+
+bool meshproc_decode_vertex_buffer(void* dst, uint32_t count, uint32_t stride, const uint8_t* src, size_t src_size) {
+    if ((stride == 0) || (stride > 256) || ((stride % 4) != 0)) {
+        return false;
+    }
+    const uint8_t* src_end = src + src_size;
+    if (src_size < (1 + stride)) {
+        return false;
+    }
+    const uint8_t header = *src++;
+    if (((header & 0xF0) != MESHPROC_VERTEX_HEADER) || ((header & 0x0F) > 0)) {
+        return false;
+    }
+    // the first vertex is stored at the end of the tail
+    uint8_t last_vertex[256];
+    memcpy(last_vertex, src_end - stride, stride);
+    const uint32_t block_size = meshproc_vertex_block_size(stride);
+    for (uint32_t offset = 0; offset < count; offset += block_size) {
+        const uint32_t n = ((offset + block_size) < count) ? block_size : (count - offset);
+        src = meshproc_decode_vertex_block(src, src_end, (uint8_t*)dst + offset * stride, n, stride, last_vertex);
+        if (!src) {
+            return false;
+        }
+    }
+    const size_t tail_size = (stride < MESHPROC_TAIL_MAX_SIZE) ? MESHPROC_TAIL_MAX_SIZE : stride;
+    return (size_t)(src_end - src) == tail_size;
+}
+
+//== EXT_meshopt_compression: TRIANGLES and INDICES ============================
+static uint32_t meshproc_decode_vbyte(const uint8_t** src) {
+    const uint8_t* p = *src;
+    uint8_t lead = *p++;
+    uint32_t result = lead & 127;
+    if (lead >= 128) {
+        uint32_t shift = 7;
+        for (int i = 0; i < 4; i++) {
+            const uint8_t group = *p++;
+            result |= (uint32_t)(group & 127) << shift;
+            shift += 7;
+            if (group < 128) {
+                break;
+            }
+        }
+    }
+    *src = p;
+    return result;
+}
+
+// zigzag-encoded delta to the last free index
+static uint32_t meshproc_decode_index(const uint8_t** src, uint32_t last) {
+    const uint32_t v = meshproc_decode_vbyte(src);
+    const uint32_t d = (v >> 1) ^ (0 - (v & 1));
+    return last + d;
+}
+
+static void meshproc_write_index(void* dst, uint32_t i, uint32_t index_size, uint32_t v) {
+    if (index_size == 2) {
+        ((uint16_t*)dst)[i] = (uint16_t)v;
+    } else {
+        ((uint32_t*)dst)[i] = v;
+    }
+}
+
+typedef struct {
+    uint32_t edges[16][2];
+    uint32_t vertices[16];
+    uint32_t edge_offset;
+    uint32_t vertex_offset;
+} meshproc_fifos_t;
+
+static void meshproc_push_edge(meshproc_fifos_t* f, uint32_t a, uint32_t b) {
+    f->edges[f->edge_offset][0] = a;
+    f->edges[f->edge_offset][1] = b;
+    f->edge_offset = (f->edge_offset + 1) & 15;
+}
+
+static void meshproc_push_vertex(meshproc_fifos_t* f, uint32_t v, bool cond) {
+    f->vertices[f->vertex_offset] = v;
+    f->vertex_offset = (f->vertex_offset + (cond ? 1 : 0)) & 15;
+}
+
+bool meshproc_decode_index_buffer(void* dst, uint32_t count, uint32_t index_size, const uint8_t* src, size_t src_size) {
+    if (((count % 3) != 0) || ((index_size != 2) && (index_size != 4))) {
+        return false;
+    }
+    // header, one code byte per triangle, and the 16-byte codeaux table
+    if (src_size < (1 + count / 3 + 16)) {
+        return false;
+    }
+    if ((src[0] & 0xF0) != MESHPROC_INDEX_HEADER) {
+        return false;
+    }
+    const int version = src[0] & 0x0F;
+    if (version > 1) {
+        return false;
+    }
+    meshproc_fifos_t f;
+    memset(&f, 0xFF, sizeof(f.edges) + sizeof(f.vertices));
+    f.edge_offset = 0;
+    f.vertex_offset = 0;
+    uint32_t next = 0;
+    uint32_t last = 0;
+    const uint32_t fec_max = (version >= 1) ? 13 : 15;
+    const uint8_t* code = src + 1;
+    const uint8_t* data = code + count / 3;
+    const uint8_t* data_safe_end = src + src_size - 16;
+    const uint8_t* codeaux_table = data_safe_end;
+
+    for (uint32_t i = 0; i < count; i += 3) {
+        // a triangle reads at most 16 bytes, the codeaux table guards the end
+        if (data > data_safe_end) {
+            return false;
+        }
+        const uint8_t codetri = *code++;
+        uint32_t a, b, c;
+        if (codetri < 0xF0) {
+            // an edge from the edge FIFO, plus a new, cached or free vertex
+            const uint32_t fe = codetri >> 4;
+            a = f.edges[(f.edge_offset - 1 - fe) & 15][0];
+            b = f.edges[(f.edge_offset - 1 - fe) & 15][1];
+            const uint32_t fec = codetri & 15;
+            if (fec < fec_max) {
+                c = (fec == 0) ? next : f.vertices[(f.vertex_offset - 1 - fec) & 15];
+                if (fec == 0) {
+                    next++;
+                }
+                meshproc_push_vertex(&f, c, fec == 0);
+            } else {
+                // 13 and 14 are last - 1 and last + 1 (version 1), 15 is a free index
+                if (fec != 15) {
+                    c = (fec == 13) ? (last - 1) : (last + 1);
+                } else {
+                    c = meshproc_decode_index(&data, last);
+                }
+                last = c;
+                meshproc_push_vertex(&f, c, true);
+            }
+            meshproc_push_edge(&f, c, b);
+            meshproc_push_edge(&f, a, c);
+        } else {
+            uint32_t feb, fec;
+            bool fea_free = false;
+            if (codetri < 0xFE) {
+                // codeaux from the table, a is always a new vertex
+                const uint8_t codeaux = codeaux_table[codetri & 15];
+                feb = codeaux >> 4;
+                fec = codeaux & 15;
+            } else {
+                const uint8_t codeaux = *data++;
+                fea_free = codetri == 0xFF;
+                feb = codeaux >> 4;
+                fec = codeaux & 15;
+                // a codeaux of 0 outside the table resets the next vertex
+                if (codeaux == 0) {
+                    next = 0;
+                }
+            }
+            // all new vertices are taken before the free indices are decoded
+            a = fea_free ? 0 : next++;
+            b = (feb == 0) ? next++ : f.vertices[(f.vertex_offset - feb) & 15];
+            c = (fec == 0) ? next++ : f.vertices[(f.vertex_offset - fec) & 15];
+            if (codetri >= 0xFE) {
+                if (fea_free) {
+                    last = a = meshproc_decode_index(&data, last);
+                }
+                if (feb == 15) {
+                    last = b = meshproc_decode_index(&data, last);
+                }
+                if (fec == 15) {
+                    last = c = meshproc_decode_index(&data, last);
+                }
+            }
+            meshproc_push_vertex(&f, a, true);
+            meshproc_push_vertex(&f, b, (feb == 0) || (feb == 15));
+            meshproc_push_vertex(&f, c, (fec == 0) || (fec == 15));
+            meshproc_push_edge(&f, b, a);
+            meshproc_push_edge(&f, c, b);
+            meshproc_push_edge(&f, a, c);
+        }
+        meshproc_write_index(dst, i + 0, index_size, a);
+        meshproc_write_index(dst, i + 1, index_size, b);
+        meshproc_write_index(dst, i + 2, index_size, c);
+    }
+    // all data must be consumed up to the codeaux table
+    return data == data_safe_end;
+}
+
+bool meshproc_decode_index_sequence(void* dst, uint32_t count, uint32_t index_size, const uint8_t* src, size_t src_size) {
+    if ((index_size != 2) && (index_size != 4)) {
+        return false;
+    }
+    // header, at least one byte per index, and a 4-byte tail
+    if (src_size < (1 + (size_t)count + 4)) {
+        return false;
+    }
+    if (((src[0] & 0xF0) != MESHPROC_SEQUENCE_HEADER) || ((src[0] & 0x0F) > 1)) {
+        return false;
+    }
+    const uint8_t* data = src + 1;
+    const uint8_t* data_safe_end = src + src_size - 4;
+    // two baselines, the lowest bit of each value selects one
+    uint32_t last[2] = { 0, 0 };
+    for (uint32_t i = 0; i < count; i++) {
+        if (data >= data_safe_end) {
+            return false;
+        }
+        uint32_t v = meshproc_decode_vbyte(&data);
+        const uint32_t baseline = v & 1;
+        v >>= 1;
+        const uint32_t d = (v >> 1) ^ (0 - (v & 1));
+        last[baseline] += d;
+        meshproc_write_index(dst, i, index_size, last[baseline]);
+    }
+    return data == data_safe_end;
+}
+
+//== EXT_meshopt_compression: FILTERS ==========================================
+static int meshproc_round(float f) {
+    return (int)(f + ((f >= 0.0f) ? 0.5f : -0.5f));
+}
+
+// octahedral normals/tangents in 4 x 8 or 4 x 16 bits, z stores the encoding's 1.0
+static void meshproc_filter_oct8(int8_t* data, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+        int8_t* v = &data[i * 4];
+        float x = (float)v[0];
+        float y = (float)v[1];
+        const float z = (float)v[2] - fabsf(x) - fabsf(y);
+        const float t = (z < 0.0f) ? z : 0.0f;
+        x += (x >= 0.0f) ? t : -t;
+        y += (y >= 0.0f) ? t : -t;
+        const float s = 127.0f / sqrtf(x * x + y * y + z * z);
+        v[0] = (int8_t)meshproc_round(x * s);
+        v[1] = (int8_t)meshproc_round(y * s);
+        v[2] = (int8_t)meshproc_round(z * s);
+    }
+}
+
+static void meshproc_filter_oct16(int16_t* data, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+        int16_t* v = &data[i * 4];
+        float x = (float)v[0];
+        float y = (float)v[1];
+        const float z = (float)v[2] - fabsf(x) - fabsf(y);
+        const float t = (z < 0.0f) ? z : 0.0f;
+        x += (x >= 0.0f) ? t : -t;
+        y += (y >= 0.0f) ? t : -t;
+        const float s = 32767.0f / sqrtf(x * x + y * y + z * z);
+        v[0] = (int16_t)meshproc_round(x * s);
+        v[1] = (int16_t)meshproc_round(y * s);
+        v[2] = (int16_t)meshproc_round(z * s);
+    }
+}
+
+// unit quaternions as 3 components plus the index of the dropped largest one
+static void meshproc_filter_quat(int16_t* data, uint32_t count) {
+    const float scale = 1.0f / sqrtf(2.0f);
+    for (uint32_t i = 0; i < count; i++) {
+        int16_t* q = &data[i * 4];
+        // the scale of the stored components is in the high bits of the 4th component
+        const int sf = q[3] | 3;
+        const float ss = scale / (float)sf;
+        const float x = (float)q[0] * ss;
+        const float y = (float)q[1] * ss;
+        const float z = (float)q[2] * ss;
+        const float ww = 1.0f - x * x - y * y - z * z;
+        const float w = sqrtf((ww >= 0.0f) ? ww : 0.0f);
+        const int qc = q[3] & 3;
+        q[(qc + 1) & 3] = (int16_t)meshproc_round(x * 32767.0f);
+        q[(qc + 2) & 3] = (int16_t)meshproc_round(y * 32767.0f);
+        q[(qc + 3) & 3] = (int16_t)meshproc_round(z * 32767.0f);
+        q[(qc + 0) & 3] = (int16_t)meshproc_round(w * 32767.0f);
+    }
+}
+
+// 24-bit mantissa and 8-bit exponent to float
+static void meshproc_filter_exp(uint32_t* data, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+        const uint32_t v = data[i];
+        const int32_t m = (int32_t)(v << 8) >> 8;
+        const int32_t e = (int32_t)v >> 24;
+        union { float f; uint32_t u; } bits;
+        bits.u = (uint32_t)(e + 127) << 23;
+        bits.f *= (float)m;
+        data[i] = bits.u;
+    }
+}
+
+bool meshproc_decode_filter(meshproc_filter_t filter, void* data, uint32_t count, uint32_t stride) {
+    switch (filter) {
+        case MESHPROC_FILTER_NONE:
+            return true;
+        case MESHPROC_FILTER_OCTAHEDRAL:
+            if (stride == 4) {
+                meshproc_filter_oct8((int8_t*)data, count);
+                return true;
+            } else if (stride == 8) {
+                meshproc_filter_oct16((int16_t*)data, count);
+                return true;
+            }
+            return false;
+        case MESHPROC_FILTER_QUATERNION:
+            if (stride == 8) {
+                meshproc_filter_quat((int16_t*)data, count);
+                return true;
+            }
+            return false;
+        case MESHPROC_FILTER_EXPONENTIAL:
+            if ((stride % 4) == 0) {
+                meshproc_filter_exp((uint32_t*)data, count * (stride / 4));
+                return true;
+            }
+            return false;
+        default:
+            return false;
+    }
+}
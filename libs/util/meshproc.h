@@ -0,0 +1,76 @@
+#pragma once
+/*
+    Load-time mesh processing: index and vertex reordering, vertex
+    quantization helpers and decoders for EXT_meshopt_compression data.
+
+    Index and vertex reordering, in this order:
+
+    - meshproc_optimize_vertex_cache(): reorders the triangles for the
+      post-transform vertex cache (Tom Forsyth's linear-speed vertex
+      cache optimisation)
+    - meshproc_optimize_overdraw(): splits the cache-optimized triangles
+      into clusters and sorts the clusters so that outward facing ones
+      are drawn first, which keeps most of the cache efficiency while
+      reducing overdraw (after Sander et al., "Fast Triangle Reordering
+      for Vertex Locality and Reduced Overdraw")
+    - meshproc_optimize_vertex_fetch(): computes a vertex remap table
+      which orders the vertices by first use in the index buffer and
+      rewrites the indices
+
+    meshproc_acmr() computes the average cache miss ratio (vertex shader
+    invocations per triangle) of a 16-entry FIFO cache.
+
+    The quantization helpers convert floats to half floats, snorm16 and
+    unorm16, and encode unit vectors into 2 snorm16 values with the
+    octahedron mapping.
+
+    The EXT_meshopt_compression decoders implement the bitstream
+    version 0 of the ATTRIBUTES mode and versions 0 and 1 of the
+    TRIANGLES and INDICES modes, plus the OCTAHEDRAL, QUATERNION and
+    EXPONENTIAL filters:
+
+    https://github.com/KhronosGroup/glTF/tree/main/extensions/2.0/Vendor/EXT_meshopt_compression
+
+    All functions are single threaded and don't keep any state between calls.
+*/
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+typedef enum meshproc_filter_t {
+    MESHPROC_FILTER_NONE,
+    MESHPROC_FILTER_OCTAHEDRAL,
+    MESHPROC_FILTER_QUATERNION,
+    MESHPROC_FILTER_EXPONENTIAL,
+} meshproc_filter_t;
+
+// average cache miss ratio of a 16-entry FIFO cache
+float meshproc_acmr(const uint32_t* indices, uint32_t num_indices, uint32_t num_vertices);
+// reorder the triangles for the post-transform vertex cache, in place
+void meshproc_optimize_vertex_cache(uint32_t* indices, uint32_t num_indices, uint32_t num_vertices);
+// reorder triangle clusters against overdraw, positions are float3 with the given byte stride;
+// threshold is the allowed ACMR increase (e.g. 1.05 for 5%)
+void meshproc_optimize_overdraw(uint32_t* indices, uint32_t num_indices, const float* positions, uint32_t num_vertices, size_t position_stride, float threshold);
+// fill remap[num_vertices] with the new vertex indices by first use and rewrite
+// the indices, unreferenced vertices go to the end; returns the number of referenced vertices
+uint32_t meshproc_optimize_vertex_fetch(uint32_t* remap, uint32_t* indices, uint32_t num_indices, uint32_t num_vertices);
+
+// quantization
+uint16_t meshproc_half(float f);
+int16_t meshproc_snorm16(float f);
+uint16_t meshproc_unorm16(float f);
+void meshproc_oct_encode(const float n[3], int16_t out[2]);
+
+// EXT_meshopt_compression decoders, all return false on malformed input
+bool meshproc_decode_vertex_buffer(void* dst, uint32_t count, uint32_t stride, const uint8_t* src, size_t src_size);
+bool meshproc_decode_index_buffer(void* dst, uint32_t count, uint32_t index_size, const uint8_t* src, size_t src_size);
+bool meshproc_decode_index_sequence(void* dst, uint32_t count, uint32_t index_size, const uint8_t* src, size_t src_size);
+// apply a filter in place to the output of meshproc_decode_vertex_buffer()
+bool meshproc_decode_filter(meshproc_filter_t filter, void* data, uint32_t count, uint32_t stride);
+
+#if defined(__cplusplus)
+}
+#endif
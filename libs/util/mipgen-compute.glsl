@@ -0,0 +1,113 @@
+//------------------------------------------------------------------------------
+//  mipgen-compute.glsl
+//
+//  Compute shaders for mipgen.h, each workgroup reads a 32x32 texel
+//  region of the source mip level and writes up to 4 mip levels below it
+//  (16x16, 8x8, 4x4 and 2x2 texels), with the intermediate levels kept in
+//  workgroup shared memory.
+//
+//  There's one shader per storage image format (rgba8 and r32f).
+//------------------------------------------------------------------------------
+@include mipgen-reduce.glsl
+
+@block uniforms
+layout(binding=0) uniform mipgen_cs_params {
+    int filter_mode;
+    int num_levels;     // number of levels to write (1..4)
+};
+
+@image_sample_type src_tex unfilterable_float
+layout(binding=0) uniform texture2D src_tex;
+@sampler_type src_smp nonfiltering
+layout(binding=0) uniform sampler src_smp;
+@end
+
+@block downsample
+layout(local_size_x=16, local_size_y=16, local_size_z=1) in;
+
+shared vec4 tile[16][16];
+
+// reduce the 2x2 tile texels at (2 * pos) into (pos), the min/max filters
+// only get here for even-sized levels (see mipgen_compute_dispatch_levels())
+vec4 reduce_tile(ivec2 pos) {
+    const ivec2 p = pos * 2;
+    return reduce4(tile[p.y][p.x], tile[p.y][p.x + 1], tile[p.y + 1][p.x], tile[p.y + 1][p.x + 1], filter_mode);
+}
+
+void main() {
+    const ivec2 lid = ivec2(gl_LocalInvocationID.xy);
+    const ivec2 gid = ivec2(gl_WorkGroupID.xy);
+    const ivec2 src_max = textureSize(sampler2D(src_tex, src_smp), 0) - 1;
+
+    // first level directly from the source texture
+    vec4 v = reduce_src(gid * 16 + lid, src_max, filter_mode);
+    ivec2 dst = gid * 16 + lid;
+    if (all(lessThan(dst, imageSize(dst_mip1)))) {
+        imageStore(dst_mip1, dst, v);
+    }
+    tile[lid.y][lid.x] = v;
+    barrier();
+
+    // second level, 8x8 threads active
+    const bool active2 = (num_levels > 1) && all(lessThan(lid, ivec2(8, 8)));
+    if (active2) {
+        v = reduce_tile(lid);
+        dst = gid * 8 + lid;
+        if (all(lessThan(dst, imageSize(dst_mip2)))) {
+            imageStore(dst_mip2, dst, v);
+        }
+    }
+    barrier();
+    if (active2) {
+        tile[lid.y][lid.x] = v;
+    }
+    barrier();
+
+    // third level, 4x4 threads active
+    const bool active3 = (num_levels > 2) && all(lessThan(lid, ivec2(4, 4)));
+    if (active3) {
+        v = reduce_tile(lid);
+        dst = gid * 4 + lid;
+        if (all(lessThan(dst, imageSize(dst_mip3)))) {
+            imageStore(dst_mip3, dst, v);
+        }
+    }
+    barrier();
+    if (active3) {
+        tile[lid.y][lid.x] = v;
+    }
+    barrier();
+
+    // fourth level, 2x2 threads active
+    if ((num_levels > 3) && all(lessThan(lid, ivec2(2, 2)))) {
+        v = reduce_tile(lid);
+        dst = gid * 2 + lid;
+        if (all(lessThan(dst, imageSize(dst_mip4)))) {
+            imageStore(dst_mip4, dst, v);
+        }
+    }
+}
+@end
+
+@cs mipgen_cs_rgba8
+@include_block uniforms
+layout(binding=1, rgba8) uniform writeonly image2D dst_mip1;
+layout(binding=2, rgba8) uniform writeonly image2D dst_mip2;
+layout(binding=3, rgba8) uniform writeonly image2D dst_mip3;
+layout(binding=4, rgba8) uniform writeonly image2D dst_mip4;
+@include_block reduce
+@include_block downsample
+@end
+
+@cs mipgen_cs_r32f
+@include_block uniforms
+layout(binding=1, r32f) uniform writeonly image2D dst_mip1;
+layout(binding=2, r32f) uniform writeonly image2D dst_mip2;
+layout(binding=3, r32f) uniform writeonly image2D dst_mip3;
+layout(binding=4, r32f) uniform writeonly image2D dst_mip4;
+@include_block reduce
+@include_block downsample
+@end
+
+@program mipgen_cs_rgba8 mipgen_cs_rgba8
+@program mipgen_cs_r32f mipgen_cs_r32f
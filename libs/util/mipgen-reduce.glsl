@@ -0,0 +1,64 @@
+//------------------------------------------------------------------------------
+//  mipgen-reduce.glsl
+//
+//  Reduction functions shared by the mipgen.h fragment and compute shaders,
+//  expects a 'src_tex' texture and 'src_smp' sampler.
+//------------------------------------------------------------------------------
+@block reduce
+// see mipgen_filter_t
+#define FILTER_BOX (0)
+#define FILTER_KAISER (1)
+#define FILTER_MIN (2)
+#define FILTER_MAX (3)
+
+vec4 fetch(ivec2 pos, ivec2 src_max) {
+    return texelFetch(sampler2D(src_tex, src_smp), clamp(pos, ivec2(0, 0), src_max), 0);
+}
+
+// combine 4 texels of the previous level
+vec4 reduce4(vec4 a, vec4 b, vec4 c, vec4 d, int mode) {
+    if (mode == FILTER_MIN) {
+        return min(min(a, b), min(c, d));
+    } else if (mode == FILTER_MAX) {
+        return max(max(a, b), max(c, d));
+    } else {
+        return (a + b + c + d) * 0.25;
+    }
+}
+
+// compute a destination texel from the source texture
+vec4 reduce_src(ivec2 dst, ivec2 src_max, int mode) {
+    const ivec2 src = dst * 2;
+    if (mode == FILTER_KAISER) {
+        // separable 4x4 Kaiser-windowed sinc (alpha = 4)
+        const float w[4] = float[4](0.0544, 0.4456, 0.4456, 0.0544);
+        vec4 acc = vec4(0.0);
+        for (int y = 0; y < 4; y++) {
+            for (int x = 0; x < 4; x++) {
+                acc += (w[x] * w[y]) * fetch(src + ivec2(x - 1, y - 1), src_max);
+            }
+        }
+        return acc;
+    } else if ((mode == FILTER_MIN) || (mode == FILTER_MAX)) {
+        // with odd source sizes the last texel covers 3 source texels,
+        // this keeps min/max reductions conservative (e.g. for Hi-Z)
+        const int nx = (src.x + 2 == src_max.x) ? 3 : 2;
+        const int ny = (src.y + 2 == src_max.y) ? 3 : 2;
+        vec4 res = fetch(src, src_max);
+        for (int y = 0; y < ny; y++) {
+            for (int x = 0; x < nx; x++) {
+                const vec4 v = fetch(src + ivec2(x, y), src_max);
+                res = (mode == FILTER_MIN) ? min(res, v) : max(res, v);
+            }
+        }
+        return res;
+    } else {
+        return reduce4(
+            fetch(src, src_max),
+            fetch(src + ivec2(1, 0), src_max),
+            fetch(src + ivec2(0, 1), src_max),
+            fetch(src + ivec2(1, 1), src_max),
+            FILTER_BOX);
+    }
+}
+@end
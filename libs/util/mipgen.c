@@ -0,0 +1,235 @@
+//------------------------------------------------------------------------------
+//  mipgen.c
+//
+//  See mipgen.h for details.
+//------------------------------------------------------------------------------
+#include "mipgen.h"
+#include "mipgen.glsl.h"
+#if defined(MIPGEN_HAS_COMPUTE)
+#include "mipgen-compute.glsl.h"
+#endif
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+struct mipgen_chain_t {
+    sg_image image;
+    sg_pixel_format pixel_format;
+    int width;
+    int height;
+    int num_mips;
+    bool use_compute;
+    sg_view tex_views[SG_MAX_MIPMAPS];
+    // compute path: storage image views, unused outputs are bound to a dummy image
+    sg_pipeline compute_pip;
+    sg_view simg_views[SG_MAX_MIPMAPS];
+    sg_image dummy_image;
+    sg_view dummy_simg_view;
+    // fragment path: color attachment views and a pipeline for the image pixel format
+    sg_pipeline fragment_pip;
+    sg_view att_views[SG_MAX_MIPMAPS];
+};
+
+static struct {
+    bool valid;
+    sg_sampler smp;
+    sg_shader fragment_shd;
+    sg_shader compute_shd_rgba8;
+    sg_shader compute_shd_r32f;
+} mipgen;
+
+void mipgen_setup(void) {
+    assert(!mipgen.valid);
+    assert(sg_isvalid());
+    memset(&mipgen, 0, sizeof(mipgen));
+    mipgen.valid = true;
+    mipgen.smp = sg_make_sampler(&(sg_sampler_desc){
+        .min_filter = SG_FILTER_NEAREST,
+        .mag_filter = SG_FILTER_NEAREST,
+        .wrap_u = SG_WRAP_CLAMP_TO_EDGE,
+        .wrap_v = SG_WRAP_CLAMP_TO_EDGE,
+        .label = "mipgen-sampler",
+    });
+    mipgen.fragment_shd = sg_make_shader(mipgen_fs_shader_desc(sg_query_backend()));
+    #if defined(MIPGEN_HAS_COMPUTE)
+    if (sg_query_features().compute) {
+        mipgen.compute_shd_rgba8 = sg_make_shader(mipgen_cs_rgba8_shader_desc(sg_query_backend()));
+        mipgen.compute_shd_r32f = sg_make_shader(mipgen_cs_r32f_shader_desc(sg_query_backend()));
+    }
+    #endif
+}
+
+void mipgen_shutdown(void) {
+    assert(mipgen.valid);
+    sg_destroy_shader(mipgen.compute_shd_r32f);
+    sg_destroy_shader(mipgen.compute_shd_rgba8);
+    sg_destroy_shader(mipgen.fragment_shd);
+    sg_destroy_sampler(mipgen.smp);
+    mipgen.valid = false;
+}
+
+mipgen_chain_t* mipgen_make_chain(const mipgen_chain_desc_t* desc) {
+    assert(mipgen.valid && desc);
+    const sg_image_desc img_desc = sg_query_image_desc(desc->image);
+    assert((img_desc.type == SG_IMAGETYPE_2D) && (img_desc.num_mipmaps > 1));
+    assert(img_desc.sample_count <= 1);
+
+    mipgen_chain_t* chain = (mipgen_chain_t*)calloc(1, sizeof(mipgen_chain_t));
+    assert(chain);
+    chain->image = desc->image;
+    chain->pixel_format = img_desc.pixel_format;
+    chain->width = img_desc.width;
+    chain->height = img_desc.height;
+    chain->num_mips = img_desc.num_mipmaps;
+
+    sg_shader compute_shd = { SG_INVALID_ID };
+    if (!desc->force_fragment && img_desc.usage.storage_image) {
+        if (chain->pixel_format == SG_PIXELFORMAT_RGBA8) {
+            compute_shd = mipgen.compute_shd_rgba8;
+        } else if (chain->pixel_format == SG_PIXELFORMAT_R32F) {
+            compute_shd = mipgen.compute_shd_r32f;
+        }
+    }
+    chain->use_compute = compute_shd.id != SG_INVALID_ID;
+
+    for (int mip = 0; mip < chain->num_mips; mip++) {
+        chain->tex_views[mip] = sg_make_view(&(sg_view_desc){
+            .texture = { .image = chain->image, .mip_levels = { .base = mip, .count = 1 } },
+            .label = "mipgen-texture-view",
+        });
+    }
+    if (chain->use_compute) {
+        for (int mip = 1; mip < chain->num_mips; mip++) {
+            chain->simg_views[mip] = sg_make_view(&(sg_view_desc){
+                .storage_image = { .image = chain->image, .mip_level = mip },
+                .label = "mipgen-storage-image-view",
+            });
+        }
+        // the compute shaders always have 4 outputs, the ones past the last
+        // mip level are bound to a dummy image and never written
+        chain->dummy_image = sg_make_image(&(sg_image_desc){
+            .usage.storage_image = true,
+            .width = 1,
+            .height = 1,
+            .pixel_format = chain->pixel_format,
+            .label = "mipgen-dummy-image",
+        });
+        chain->dummy_simg_view = sg_make_view(&(sg_view_desc){
+            .storage_image = { .image = chain->dummy_image },
+            .label = "mipgen-dummy-storage-image-view",
+        });
+        chain->compute_pip = sg_make_pipeline(&(sg_pipeline_desc){
+            .compute = true,
+            .shader = compute_shd,
+            .label = "mipgen-compute-pipeline",
+        });
+    } else {
+        assert(img_desc.usage.color_attachment);
+        for (int mip = 1; mip < chain->num_mips; mip++) {
+            chain->att_views[mip] = sg_make_view(&(sg_view_desc){
+                .color_attachment = { .image = chain->image, .mip_level = mip },
+                .label = "mipgen-color-attachment-view",
+            });
+        }
+        chain->fragment_pip = sg_make_pipeline(&(sg_pipeline_desc){
+            .shader = mipgen.fragment_shd,
+            .colors[0].pixel_format = chain->pixel_format,
+            .depth.pixel_format = SG_PIXELFORMAT_NONE,
+            .sample_count = 1,
+            .label = "mipgen-fragment-pipeline",
+        });
+    }
+    return chain;
+}
+
+void mipgen_destroy_chain(mipgen_chain_t* chain) {
+    assert(mipgen.valid && chain);
+    sg_destroy_pipeline(chain->fragment_pip);
+    sg_destroy_pipeline(chain->compute_pip);
+    sg_destroy_view(chain->dummy_simg_view);
+    sg_destroy_image(chain->dummy_image);
+    for (int mip = 0; mip < chain->num_mips; mip++) {
+        sg_destroy_view(chain->tex_views[mip]);
+        sg_destroy_view(chain->simg_views[mip]);
+        sg_destroy_view(chain->att_views[mip]);
+    }
+    free(chain);
+}
+
+#if defined(MIPGEN_HAS_COMPUTE)
+static void mipgen_generate_compute(mipgen_chain_t* chain, mipgen_filter_t filter) {
+    // one compute pass per dispatch, since the next dispatch reads what the
+    // previous one has written, and sokol-gfx only guarantees the visibility
+    // of storage image writes across passes
+    int num_levels = 0;
+    for (int src_mip = 0; src_mip < (chain->num_mips - 1); src_mip += num_levels) {
+        num_levels = mipgen_compute_dispatch_levels(chain->width, chain->height, chain->num_mips, src_mip, filter);
+        sg_bindings bind = {
+            .views[VIEW_src_tex] = chain->tex_views[src_mip],
+            .views[VIEW_dst_mip1] = chain->simg_views[src_mip + 1],
+            .views[VIEW_dst_mip2] = (num_levels > 1) ? chain->simg_views[src_mip + 2] : chain->dummy_simg_view,
+            .views[VIEW_dst_mip3] = (num_levels > 2) ? chain->simg_views[src_mip + 3] : chain->dummy_simg_view,
+            .views[VIEW_dst_mip4] = (num_levels > 3) ? chain->simg_views[src_mip + 4] : chain->dummy_simg_view,
+            .samplers[SMP_src_smp] = mipgen.smp,
+        };
+        const mipgen_cs_params_t cs_params = {
+            .filter_mode = (int)filter,
+            .num_levels = num_levels,
+        };
+        const int dst_width = mipgen_mip_size(chain->width, src_mip + 1);
+        const int dst_height = mipgen_mip_size(chain->height, src_mip + 1);
+        sg_begin_pass(&(sg_pass){ .compute = true, .label = "mipgen-compute-pass" });
+        sg_apply_pipeline(chain->compute_pip);
+        sg_apply_bindings(&bind);
+        sg_apply_uniforms(UB_mipgen_cs_params, &SG_RANGE(cs_params));
+        sg_dispatch((dst_width + MIPGEN_TILE_DIM - 1) / MIPGEN_TILE_DIM, (dst_height + MIPGEN_TILE_DIM - 1) / MIPGEN_TILE_DIM, 1);
+        sg_end_pass();
+    }
+}
+#endif
+
+static void mipgen_generate_fragment(mipgen_chain_t* chain, mipgen_filter_t filter) {
+    const mipgen_fs_params_t fs_params = { .filter_mode = (int)filter };
+    for (int dst_mip = 1; dst_mip < chain->num_mips; dst_mip++) {
+        sg_begin_pass(&(sg_pass){
+            .action.colors[0].load_action = SG_LOADACTION_DONTCARE,
+            .attachments.colors[0] = chain->att_views[dst_mip],
+            .label = "mipgen-fragment-pass",
+        });
+        sg_apply_pipeline(chain->fragment_pip);
+        sg_apply_bindings(&(sg_bindings){
+            .views[VIEW_src_tex] = chain->tex_views[dst_mip - 1],
+            .samplers[SMP_src_smp] = mipgen.smp,
+        });
+        sg_apply_uniforms(UB_mipgen_fs_params, &SG_RANGE(fs_params));
+        sg_draw(0, 3, 1);
+        sg_end_pass();
+    }
+}
+
+void mipgen_generate(mipgen_chain_t* chain, mipgen_filter_t filter) {
+    assert(mipgen.valid && chain);
+    assert((filter >= 0) && (filter < MIPGEN_NUM_FILTERS));
+    #if defined(MIPGEN_HAS_COMPUTE)
+    if (chain->use_compute) {
+        mipgen_generate_compute(chain, filter);
+        return;
+    }
+    #endif
+    mipgen_generate_fragment(chain, filter);
+}
+
+bool mipgen_uses_compute(const mipgen_chain_t* chain) {
+    assert(chain);
+    return chain->use_compute;
+}
+
+const char* mipgen_filter_name(mipgen_filter_t filter) {
+    switch (filter) {
+        case MIPGEN_FILTER_BOX: return "box";
+        case MIPGEN_FILTER_KAISER: return "kaiser";
+        case MIPGEN_FILTER_MIN: return "min";
+        case MIPGEN_FILTER_MAX: return "max";
+        default: return "invalid";
+    }
+}
@@ -0,0 +1,37 @@
+//------------------------------------------------------------------------------
+//  mipgen.glsl
+//
+//  Fragment shader fallback for mipgen.h, renders one mip level from the
+//  previous mip level.
+//------------------------------------------------------------------------------
+@include mipgen-reduce.glsl
+
+@vs mipgen_vs
+const vec2 positions[3] = { vec2(-1, -1), vec2(3, -1), vec2(-1, 3), };
+
+void main() {
+    gl_Position = vec4(positions[gl_VertexIndex], 0, 1);
+}
+@end
+
+@fs mipgen_fs
+layout(binding=0) uniform mipgen_fs_params {
+    int filter_mode;
+};
+
+@image_sample_type src_tex unfilterable_float
+layout(binding=0) uniform texture2D src_tex;
+@sampler_type src_smp nonfiltering
+layout(binding=0) uniform sampler src_smp;
+
+@include_block reduce
+
+out vec4 frag_color;
+
+void main() {
+    const ivec2 src_max = textureSize(sampler2D(src_tex, src_smp), 0) - 1;
+    frag_color = reduce_src(ivec2(gl_FragCoord.xy), src_max, filter_mode);
+}
+@end
+
+@program mipgen_fs mipgen_vs mipgen_fs
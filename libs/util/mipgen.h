@@ -0,0 +1,114 @@
+#pragma once
+/*
+    Mipmap chain generation for render targets and storage images.
+
+    Builds mip levels 1..N-1 of a 2D image from its mip level 0 with one
+    of these reductions:
+
+    - MIPGEN_FILTER_BOX: 2x2 average
+    - MIPGEN_FILTER_KAISER: 4x4 separable Kaiser-windowed sinc, sharper
+      than the box filter
+    - MIPGEN_FILTER_MIN, MIPGEN_FILTER_MAX: conservative 2x2 min or max
+      (3 texels wide on odd source sizes so that no source texel is
+      skipped), for hierarchical depth buffers
+
+    There are two implementations:
+
+    - compute: each dispatch reads one mip level and writes the next 4
+      levels, keeping the intermediate levels in workgroup shared memory
+      (so the 9 levels below a 512x512 image need 3 dispatches instead
+      of 9 render passes). This is used when the backend supports compute
+      shaders and the image was created with .usage.storage_image and
+      pixel format RGBA8 or R32F.
+    - fragment: one render pass with a fullscreen triangle per mip level,
+      used otherwise (the image must have .usage.color_attachment).
+
+    The Kaiser filter reads outside a workgroup's 2x2 source footprint, so
+    the compute path writes only one level per dispatch with it. The min
+    and max filters end a dispatch after a level with an odd size, since
+    the 3 texel wide reduction of such a level may need a texel from the
+    shared memory of the neighbouring workgroup (see
+    mipgen_compute_dispatch_levels()).
+
+    Non-power-of-two images work, but with the box and Kaiser filters
+    the odd rows and columns get less weight than on power-of-two images.
+
+    Usage:
+
+        sg_setup(...);
+        mipgen_setup();
+
+        // the image needs num_mipmaps > 1
+        mipgen_chain_t* chain = mipgen_make_chain(&(mipgen_chain_desc_t){ .image = img });
+
+        // after rendering into mip level 0, outside of a pass
+        mipgen_generate(chain, MIPGEN_FILTER_BOX);
+
+        mipgen_destroy_chain(chain);
+        mipgen_shutdown();
+        sg_shutdown();
+*/
+#include <stdbool.h>
+#include "sokol_gfx.h"
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#define MIPGEN_LEVELS_PER_DISPATCH (4)  // must match mipgen-compute.glsl
+#define MIPGEN_TILE_DIM (16)            // must match mipgen-compute.glsl
+
+typedef enum mipgen_filter_t {
+    MIPGEN_FILTER_BOX,
+    MIPGEN_FILTER_KAISER,
+    MIPGEN_FILTER_MIN,
+    MIPGEN_FILTER_MAX,
+    MIPGEN_NUM_FILTERS,
+} mipgen_filter_t;
+
+typedef struct mipgen_chain_desc_t {
+    sg_image image;
+    bool force_fragment;    // use the fragment path even if compute is available
+} mipgen_chain_desc_t;
+
+typedef struct mipgen_chain_t mipgen_chain_t;
+
+void mipgen_setup(void);
+void mipgen_shutdown(void);
+// create the views and pipeline objects for generating the mip chain of an image
+mipgen_chain_t* mipgen_make_chain(const mipgen_chain_desc_t* desc);
+void mipgen_destroy_chain(mipgen_chain_t* chain);
+// generate mip levels 1..N-1 from mip level 0, must be called outside a pass
+void mipgen_generate(mipgen_chain_t* chain, mipgen_filter_t filter);
+// true if the chain uses compute shaders
+bool mipgen_uses_compute(const mipgen_chain_t* chain);
+const char* mipgen_filter_name(mipgen_filter_t filter);
+
+// size of a mip level, at least 1
+static inline int mipgen_mip_size(int size, int mip_level) {
+    const int s = size >> mip_level;
+    return (s > 0) ? s : 1;
+}
+
+// number of mip levels (1..MIPGEN_LEVELS_PER_DISPATCH) written by the compute
+// dispatch which reads mip level src_mip of a width x height image
+static inline int mipgen_compute_dispatch_levels(int width, int height, int num_mips, int src_mip, mipgen_filter_t filter) {
+    const int max_levels = (filter == MIPGEN_FILTER_KAISER) ? 1 : MIPGEN_LEVELS_PER_DISPATCH;
+    const bool min_max = (filter == MIPGEN_FILTER_MIN) || (filter == MIPGEN_FILTER_MAX);
+    int num_levels = 0;
+    while ((num_levels < max_levels) && ((src_mip + num_levels + 1) < num_mips)) {
+        num_levels++;
+        if (min_max) {
+            // the next level must be reduced from the texture by the next dispatch
+            const int w = mipgen_mip_size(width, src_mip + num_levels);
+            const int h = mipgen_mip_size(height, src_mip + num_levels);
+            if (((w > 1) && (w & 1)) || ((h > 1) && (h & 1))) {
+                break;
+            }
+        }
+    }
+    return num_levels;
+}
+
+#if defined(__cplusplus)
+} // extern "C"
+#endif
@@ -0,0 +1,900 @@
+//------------------------------------------------------------------------------
+//  pngdec.c
+//
+//  See pngdec.h for details.
+//------------------------------------------------------------------------------
+#include "pngdec.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <assert.h>
+
+#if !defined(PNGDEC_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2)))
+#define PNGDEC_SSE2
+#include <emmintrin.h>
+#endif
+
+#define PNGDEC_MAX_DIMENSION (1 << 24)
+// root table bits of the literal/length and distance codes, longer codes go to subtables
+#define PNGDEC_LITLEN_BITS (11)
+#define PNGDEC_DIST_BITS (10)
+#define PNGDEC_CODELEN_BITS (7)
+#define PNGDEC_MAX_CODE_LENGTH (15)
+// worst case: every code longer than the root bits has its own 2^(15 - root bits) subtable
+#define PNGDEC_LITLEN_TABLE_SIZE ((1 << PNGDEC_LITLEN_BITS) + 288 * (1 << (PNGDEC_MAX_CODE_LENGTH - PNGDEC_LITLEN_BITS)))
+#define PNGDEC_DIST_TABLE_SIZE ((1 << PNGDEC_DIST_BITS) + 32 * (1 << (PNGDEC_MAX_CODE_LENGTH - PNGDEC_DIST_BITS)))
+// slack behind the inflate output for the 8-byte match copies
+#define PNGDEC_OUTPUT_SLACK (8)
+
+/* Huffman table entries:
+
+    bits 0..4:   code length in bits (the root bits for subtable links)
+    bits 5..7:   entry kind
+    bits 8..15:  literal, extra bits of a length/distance, or subtable bits
+    bits 16..31: second literal, length/distance base, or subtable offset
+*/
+#define PNGDEC_KIND_INVALID (0)
+#define PNGDEC_KIND_LITERAL (1)
+#define PNGDEC_KIND_LITERAL2 (2)
+#define PNGDEC_KIND_LENGTH (3)
+#define PNGDEC_KIND_END (4)
+#define PNGDEC_KIND_SUBTABLE (5)
+#define PNGDEC_KIND_DIST (6)
+#define PNGDEC_ENTRY(kind, a, b) (((uint32_t)(kind) << 5) | ((uint32_t)(a) << 8) | ((uint32_t)(b) << 16))
+#define PNGDEC_ENTRY_LEN(e) ((e) & 31)
+#define PNGDEC_ENTRY_KIND(e) (((e) >> 5) & 7)
+#define PNGDEC_ENTRY_A(e) (((e) >> 8) & 0xFF)
+#define PNGDEC_ENTRY_B(e) ((e) >> 16)
+
+typedef struct {
+    const uint8_t* in;
+    const uint8_t* in_end;
+    uint64_t bits;          // valid from bit 0, may contain not yet counted input above num_bits
+    int num_bits;
+    int overrun;            // zero bytes read past the end of the input
+} pngdec_bitreader_t;
+
+typedef struct {
+    pngdec_bitreader_t br;
+    uint8_t* out_start;
+    uint8_t* out;
+    uint8_t* out_end;
+    uint32_t litlen[PNGDEC_LITLEN_TABLE_SIZE];
+    uint32_t dist[PNGDEC_DIST_TABLE_SIZE];
+} pngdec_inflate_t;
+
+static const uint16_t pngdec_length_base[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258,
+};
+static const uint8_t pngdec_length_extra[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0,
+};
+static const uint16_t pngdec_dist_base[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577,
+};
+static const uint8_t pngdec_dist_extra[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13,
+};
+
+//== BIT READER ================================================================
+static uint64_t pngdec_load64le(const uint8_t* p) {
+    return (uint64_t)p[0] | ((uint64_t)p[1] << 8) | ((uint64_t)p[2] << 16) | ((uint64_t)p[3] << 24) |
+        ((uint64_t)p[4] << 32) | ((uint64_t)p[5] << 40) | ((uint64_t)p[6] << 48) | ((uint64_t)p[7] << 56);
+}
+
+// fill the bit buffer to at least 56 bits
+static void pngdec_refill(pngdec_bitreader_t* z) {
+    if ((z->in_end - z->in) >= 8) {
+        // whole bytes which fit are counted, the partial byte on top is
+        // loaded again by the next refill
+        z->bits |= pngdec_load64le(z->in) << z->num_bits;
+        const int num_bytes = (63 - z->num_bits) >> 3;
+        z->in += num_bytes;
+        z->num_bits += num_bytes * 8;
+    } else {
+        while (z->num_bits <= 56) {
+            uint64_t b = 0;
+            if (z->in < z->in_end) {
+                b = *z->in++;
+            } else {
+                z->overrun++;
+            }
+            z->bits |= b << z->num_bits;
+            z->num_bits += 8;
+        }
+    }
+}
+
+static void pngdec_consume(pngdec_bitreader_t* z, int n) {
+    z->bits >>= n;
+    z->num_bits -= n;
+}
+
+// read up to 32 bits, the caller has to make sure that enough bits are buffered
+static uint32_t pngdec_bits(pngdec_bitreader_t* z, int n) {
+    const uint32_t v = (uint32_t)(z->bits & ((1ull << n) - 1));
+    pngdec_consume(z, n);
+    return v;
+}
+
+// true if the decoder has consumed bits past the end of the input
+static bool pngdec_overrun(const pngdec_bitreader_t* z) {
+    return (z->overrun * 8) > z->num_bits;
+}
+
+//== HUFFMAN TABLES ============================================================
+static uint32_t pngdec_reverse_bits(uint32_t code, int len) {
+    uint32_t r = 0;
+    for (int i = 0; i < len; i++) {
+        r = (r << 1) | (code & 1);
+        code >>= 1;
+    }
+    return r;
+}
+
+/* Build a lookup table for the code lengths, entries[] holds the entry of
+   each symbol without the code length. Incomplete codes are allowed, the
+   unused entries are invalid. Returns false for over-subscribed codes.
+*/
+static bool pngdec_build_table(uint32_t* table, int table_size, int root_bits, const uint8_t* lengths, const uint32_t* entries, int num_symbols) {
+    int count[PNGDEC_MAX_CODE_LENGTH + 1] = { 0 };
+    for (int i = 0; i < num_symbols; i++) {
+        count[lengths[i]]++;
+    }
+    count[0] = 0;
+    int left = 1;
+    uint32_t next_code[PNGDEC_MAX_CODE_LENGTH + 1];
+    uint32_t code = 0;
+    for (int len = 1; len <= PNGDEC_MAX_CODE_LENGTH; len++) {
+        left = (left << 1) - count[len];
+        if (left < 0) {
+            return false;
+        }
+        code = (code + (uint32_t)count[len - 1]) << 1;
+        next_code[len] = code;
+    }
+    const int root_size = 1 << root_bits;
+    const uint32_t root_mask = (uint32_t)root_size - 1;
+    for (int i = 0; i < root_size; i++) {
+        table[i] = PNGDEC_ENTRY(PNGDEC_KIND_INVALID, 0, 0);
+    }
+
+    // the longest code behind each root entry decides the subtable size
+    uint8_t sub_bits[1 << PNGDEC_LITLEN_BITS] = { 0 };
+    uint32_t codes[288];
+    for (int i = 0; i < num_symbols; i++) {
+        const int len = lengths[i];
+        if (len == 0) {
+            continue;
+        }
+        codes[i] = pngdec_reverse_bits(next_code[len]++, len);
+        if (len > root_bits) {
+            const uint32_t prefix = codes[i] & root_mask;
+            if ((len - root_bits) > sub_bits[prefix]) {
+                sub_bits[prefix] = (uint8_t)(len - root_bits);
+            }
+        }
+    }
+    int offset = root_size;
+    for (int i = 0; i < root_size; i++) {
+        if (sub_bits[i] > 0) {
+            const int size = 1 << sub_bits[i];
+            assert((offset + size) <= table_size);
+            for (int j = 0; j < size; j++) {
+                table[offset + j] = PNGDEC_ENTRY(PNGDEC_KIND_INVALID, 0, 0);
+            }
+            table[i] = PNGDEC_ENTRY(PNGDEC_KIND_SUBTABLE, sub_bits[i], offset) | (uint32_t)root_bits;
+            offset += size;
+        }
+    }
+    (void)table_size;
+
+    for (int i = 0; i < num_symbols; i++) {
+        const int len = lengths[i];
+        if (len == 0) {
+            continue;
+        }
+        const uint32_t entry = entries[i] | (uint32_t)len;
+        if (len <= root_bits) {
+            for (int j = (int)codes[i]; j < root_size; j += 1 << len) {
+                table[j] = entry;
+            }
+        } else {
+            const uint32_t link = table[codes[i] & root_mask];
+            uint32_t* sub = table + PNGDEC_ENTRY_B(link);
+            const int size = 1 << PNGDEC_ENTRY_A(link);
+            for (int j = (int)(codes[i] >> root_bits); j < size; j += 1 << (len - root_bits)) {
+                sub[j] = entry;
+            }
+        }
+    }
+    return true;
+}
+
+// merge two literals into one root entry where both codes fit into the root bits
+static void pngdec_pair_literals(uint32_t* table) {
+    const int root_size = 1 << PNGDEC_LITLEN_BITS;
+    uint32_t pairs[1 << PNGDEC_LITLEN_BITS];
+    for (int i = 0; i < root_size; i++) {
+        const uint32_t e = table[i];
+        pairs[i] = e;
+        if (PNGDEC_ENTRY_KIND(e) != PNGDEC_KIND_LITERAL) {
+            continue;
+        }
+        // the bits above the first code index the second, the unknown high bits are zero,
+        // which is fine as long as the second code fits into the known bits
+        const int len = (int)PNGDEC_ENTRY_LEN(e);
+        const uint32_t e2 = table[(uint32_t)i >> len];
+        if ((PNGDEC_ENTRY_KIND(e2) == PNGDEC_KIND_LITERAL) && ((int)PNGDEC_ENTRY_LEN(e2) <= (PNGDEC_LITLEN_BITS - len))) {
+            pairs[i] = PNGDEC_ENTRY(PNGDEC_KIND_LITERAL2, PNGDEC_ENTRY_A(e), PNGDEC_ENTRY_A(e2)) | (uint32_t)(len + (int)PNGDEC_ENTRY_LEN(e2));
+        }
+    }
+    memcpy(table, pairs, sizeof(pairs));
+}
+
+static bool pngdec_build_codes(pngdec_inflate_t* z, const uint8_t* litlen_lengths, int num_litlen, const uint8_t* dist_lengths, int num_dist) {
+    uint32_t entries[288];
+    for (int i = 0; i < 288; i++) {
+        if (i < 256) {
+            entries[i] = PNGDEC_ENTRY(PNGDEC_KIND_LITERAL, i, 0);
+        } else if (i == 256) {
+            entries[i] = PNGDEC_ENTRY(PNGDEC_KIND_END, 0, 0);
+        } else if (i < 286) {
+            entries[i] = PNGDEC_ENTRY(PNGDEC_KIND_LENGTH, pngdec_length_extra[i - 257], pngdec_length_base[i - 257]);
+        } else {
+            entries[i] = PNGDEC_ENTRY(PNGDEC_KIND_INVALID, 0, 0);
+        }
+    }
+    if (!pngdec_build_table(z->litlen, PNGDEC_LITLEN_TABLE_SIZE, PNGDEC_LITLEN_BITS, litlen_lengths, entries, num_litlen)) {
+        return false;
+    }
+    pngdec_pair_literals(z->litlen);
+    for (int i = 0; i < 32; i++) {
+        entries[i] = (i < 30) ? PNGDEC_ENTRY(PNGDEC_KIND_DIST, pngdec_dist_extra[i], pngdec_dist_base[i]) : PNGDEC_ENTRY(PNGDEC_KIND_INVALID, 0, 0);
+    }
+    return pngdec_build_table(z->dist, PNGDEC_DIST_TABLE_SIZE, PNGDEC_DIST_BITS, dist_lengths, entries, num_dist);
+}
+
+//== INFLATE ===================================================================
+static bool pngdec_fixed_codes(pngdec_inflate_t* z) {
+    uint8_t litlen[288];
+    uint8_t dist[32];
+    memset(litlen, 8, 144);
+    memset(litlen + 144, 9, 112);
+    memset(litlen + 256, 7, 24);
+    memset(litlen + 280, 8, 8);
+    memset(dist, 5, 32);
+    return pngdec_build_codes(z, litlen, 288, dist, 32);
+}
+
+static bool pngdec_dynamic_codes(pngdec_inflate_t* z) {
+    static const uint8_t order[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+    pngdec_refill(&z->br);
+    const int num_litlen = (int)pngdec_bits(&z->br, 5) + 257;
+    const int num_dist = (int)pngdec_bits(&z->br, 5) + 1;
+    const int num_codelen = (int)pngdec_bits(&z->br, 4) + 4;
+    if ((num_litlen > 286) || (num_dist > 30)) {
+        return false;
+    }
+    uint8_t codelen_lengths[19] = { 0 };
+    for (int i = 0; i < num_codelen; i++) {
+        pngdec_refill(&z->br);
+        codelen_lengths[order[i]] = (uint8_t)pngdec_bits(&z->br, 3);
+    }
+    uint32_t codelen_entries[19];
+    for (int i = 0; i < 19; i++) {
+        codelen_entries[i] = PNGDEC_ENTRY(PNGDEC_KIND_LITERAL, i, 0);
+    }
+    uint32_t codelen_table[1 << PNGDEC_CODELEN_BITS];
+    if (!pngdec_build_table(codelen_table, 1 << PNGDEC_CODELEN_BITS, PNGDEC_CODELEN_BITS, codelen_lengths, codelen_entries, 19)) {
+        return false;
+    }
+
+    // the literal/length and distance code lengths are one sequence
+    uint8_t lengths[286 + 30];
+    const int num = num_litlen + num_dist;
+    int n = 0;
+    while (n < num) {
+        pngdec_refill(&z->br);
+        const uint32_t e = codelen_table[z->br.bits & ((1 << PNGDEC_CODELEN_BITS) - 1)];
+        if (PNGDEC_ENTRY_KIND(e) != PNGDEC_KIND_LITERAL) {
+            return false;
+        }
+        pngdec_consume(&z->br, (int)PNGDEC_ENTRY_LEN(e));
+        const int sym = (int)PNGDEC_ENTRY_A(e);
+        if (sym < 16) {
+            lengths[n++] = (uint8_t)sym;
+            continue;
+        }
+        int repeat;
+        uint8_t value = 0;
+        if (sym == 16) {
+            if (n == 0) {
+                return false;
+            }
+            value = lengths[n - 1];
+            repeat = 3 + (int)pngdec_bits(&z->br, 2);
+        } else if (sym == 17) {
+            repeat = 3 + (int)pngdec_bits(&z->br, 3);
+        } else {
+            repeat = 11 + (int)pngdec_bits(&z->br, 7);
+        }
+        if ((n + repeat) > num) {
+            return false;
+        }
+        memset(lengths + n, value, (size_t)repeat);
+        n += repeat;
+    }
+    if (lengths[256] == 0) {
+        return false;
+    }
+    return pngdec_build_codes(z, lengths, num_litlen, lengths + num_litlen, num_dist);
+}
+
+static bool pngdec_stored_block(pngdec_inflate_t* z) {
+    pngdec_consume(&z->br, z->br.num_bits & 7);
+    pngdec_refill(&z->br);
+    const uint32_t len = pngdec_bits(&z->br, 16);
+    const uint32_t nlen = pngdec_bits(&z->br, 16);
+    if ((len ^ 0xFFFF) != nlen) {
+        return false;
+    }
+    if ((uint32_t)(z->out_end - z->out) < len) {
+        return false;
+    }
+    // first the whole bytes left in the bit buffer, then straight from the input
+    uint32_t n = 0;
+    while ((n < len) && (z->br.num_bits >= 8)) {
+        z->out[n++] = (uint8_t)pngdec_bits(&z->br, 8);
+    }
+    if (n < len) {
+        assert(z->br.num_bits == 0);
+        z->br.bits = 0;
+        if (z->br.overrun || ((uint32_t)(z->br.in_end - z->br.in) < (len - n))) {
+            return false;
+        }
+        memcpy(z->out + n, z->br.in, len - n);
+        z->br.in += len - n;
+    }
+    z->out += len;
+    return true;
+}
+
+static bool pngdec_huffman_block(pngdec_inflate_t* z) {
+    // a local copy of the bit reader stays in registers, the output writes could alias it
+    pngdec_bitreader_t br = z->br;
+    const uint32_t* litlen = z->litlen;
+    const uint32_t* dist = z->dist;
+    uint8_t* out = z->out;
+    uint8_t* const out_start = z->out_start;
+    uint8_t* const out_end = z->out_end;
+    for (;;) {
+        // enough bits for a length, a distance and their extra bits
+        pngdec_refill(&br);
+        uint32_t e = litlen[br.bits & ((1 << PNGDEC_LITLEN_BITS) - 1)];
+        if (PNGDEC_ENTRY_KIND(e) == PNGDEC_KIND_SUBTABLE) {
+            e = litlen[PNGDEC_ENTRY_B(e) + ((br.bits >> PNGDEC_LITLEN_BITS) & ((1u << PNGDEC_ENTRY_A(e)) - 1))];
+        }
+        pngdec_consume(&br, (int)PNGDEC_ENTRY_LEN(e));
+        const uint32_t kind = PNGDEC_ENTRY_KIND(e);
+        if (kind == PNGDEC_KIND_LITERAL2) {
+            if ((out_end - out) < 2) {
+                return false;
+            }
+            out[0] = (uint8_t)PNGDEC_ENTRY_A(e);
+            out[1] = (uint8_t)PNGDEC_ENTRY_B(e);
+            out += 2;
+            continue;
+        }
+        if (kind == PNGDEC_KIND_LITERAL) {
+            if (out == out_end) {
+                return false;
+            }
+            *out++ = (uint8_t)PNGDEC_ENTRY_A(e);
+            continue;
+        }
+        if (kind == PNGDEC_KIND_END) {
+            z->br = br;
+            z->out = out;
+            return !pngdec_overrun(&br);
+        }
+        if (kind != PNGDEC_KIND_LENGTH) {
+            return false;
+        }
+        const uint32_t length = PNGDEC_ENTRY_B(e) + pngdec_bits(&br, (int)PNGDEC_ENTRY_A(e));
+        e = dist[br.bits & ((1 << PNGDEC_DIST_BITS) - 1)];
+        if (PNGDEC_ENTRY_KIND(e) == PNGDEC_KIND_SUBTABLE) {
+            e = dist[PNGDEC_ENTRY_B(e) + ((br.bits >> PNGDEC_DIST_BITS) & ((1u << PNGDEC_ENTRY_A(e)) - 1))];
+        }
+        if (PNGDEC_ENTRY_KIND(e) != PNGDEC_KIND_DIST) {
+            return false;
+        }
+        pngdec_consume(&br, (int)PNGDEC_ENTRY_LEN(e));
+        const uint32_t d = PNGDEC_ENTRY_B(e) + pngdec_bits(&br, (int)PNGDEC_ENTRY_A(e));
+        if ((d > (uint32_t)(out - out_start)) || (length > (uint32_t)(out_end - out))) {
+            return false;
+        }
+        const uint8_t* src = out - d;
+        uint8_t* const end = out + length;
+        if (d >= 8) {
+            // may write up to 7 bytes past the end, into the next match or the slack
+            do {
+                memcpy(out, src, 8);
+                out += 8;
+                src += 8;
+            } while (out < end);
+        } else if (d == 1) {
+            memset(out, *src, length);
+        } else {
+            do {
+                *out++ = *src++;
+            } while (out < end);
+        }
+        out = end;
+    }
+}
+
+/* inflate a zlib stream into out[0..out_size), with PNGDEC_OUTPUT_SLACK
+   writable bytes behind, fails unless the output is exactly out_size bytes
+*/
+static pngdec_result_t pngdec_inflate(const uint8_t* in, size_t in_size, uint8_t* out, size_t out_size) {
+    if (in_size < 2) {
+        return PNGDEC_CORRUPT;
+    }
+    const uint32_t cmf = in[0];
+    const uint32_t flg = in[1];
+    if (((cmf & 15) != 8) || (((cmf << 8) | flg) % 31) != 0 || (flg & 32)) {
+        return PNGDEC_CORRUPT;
+    }
+    pngdec_inflate_t* z = (pngdec_inflate_t*)malloc(sizeof(pngdec_inflate_t));
+    if (!z) {
+        return PNGDEC_OUT_OF_MEMORY;
+    }
+    z->br = (pngdec_bitreader_t){ .in = in + 2, .in_end = in + in_size };
+    z->out_start = out;
+    z->out = out;
+    z->out_end = out + out_size;
+    bool ok = true;
+    bool last = false;
+    while (ok && !last) {
+        pngdec_refill(&z->br);
+        last = pngdec_bits(&z->br, 1) != 0;
+        switch (pngdec_bits(&z->br, 2)) {
+            case 0: ok = pngdec_stored_block(z); break;
+            case 1: ok = pngdec_fixed_codes(z) && pngdec_huffman_block(z); break;
+            case 2: ok = pngdec_dynamic_codes(z) && pngdec_huffman_block(z); break;
+            default: ok = false; break;
+        }
+        ok = ok && !pngdec_overrun(&z->br);
+    }
+    ok = ok && (z->out == z->out_end);
+    free(z);
+    return ok ? PNGDEC_OK : PNGDEC_CORRUPT;
+}
+
+//== UNFILTER ==================================================================
+static uint8_t pngdec_paeth(int a, int b, int c) {
+    const int pa = abs(b - c);
+    const int pb = abs(a - c);
+    const int pc = abs(a + b - 2 * c);
+    if ((pa <= pb) && (pa <= pc)) {
+        return (uint8_t)a;
+    }
+    return (uint8_t)((pb <= pc) ? b : c);
+}
+
+static void pngdec_unfilter_scalar(int filter, uint8_t* dst, const uint8_t* src, const uint8_t* prior, int len, int bpp) {
+    switch (filter) {
+        case 1:
+            memcpy(dst, src, (size_t)bpp);
+            for (int i = bpp; i < len; i++) {
+                dst[i] = (uint8_t)(src[i] + dst[i - bpp]);
+            }
+            break;
+        case 2:
+            for (int i = 0; i < len; i++) {
+                dst[i] = (uint8_t)(src[i] + prior[i]);
+            }
+            break;
+        case 3:
+            for (int i = 0; i < bpp; i++) {
+                dst[i] = (uint8_t)(src[i] + (prior[i] >> 1));
+            }
+            for (int i = bpp; i < len; i++) {
+                dst[i] = (uint8_t)(src[i] + ((dst[i - bpp] + prior[i]) >> 1));
+            }
+            break;
+        case 4:
+            for (int i = 0; i < bpp; i++) {
+                dst[i] = (uint8_t)(src[i] + prior[i]);
+            }
+            for (int i = bpp; i < len; i++) {
+                dst[i] = (uint8_t)(src[i] + pngdec_paeth(dst[i - bpp], prior[i], prior[i - bpp]));
+            }
+            break;
+        default:
+            memcpy(dst, src, (size_t)len);
+            break;
+    }
+}
+
+#if defined(PNGDEC_SSE2)
+// Sub, Average and Paeth depend on the pixel to the left, so they run one
+// pixel per step in vector registers (after libpng's filter_sse2_intrinsics.c),
+// except for Sub which is a prefix sum over 4 pixels per step
+// bpp is 3 or 4, the callers pass it as a constant so that the branches fold away
+static inline __m128i pngdec_load_pixel(const uint8_t* p, int bpp) {
+    uint32_t v = 0;
+    if (bpp == 4) {
+        memcpy(&v, p, 4);
+    } else {
+        uint16_t lo;
+        memcpy(&lo, p, 2);
+        v = (uint32_t)lo | ((uint32_t)p[2] << 16);
+    }
+    return _mm_cvtsi32_si128((int)v);
+}
+
+static inline void pngdec_store_pixel(uint8_t* p, __m128i v, int bpp) {
+    const uint32_t u = (uint32_t)_mm_cvtsi128_si32(v);
+    if (bpp == 4) {
+        memcpy(p, &u, 4);
+    } else {
+        const uint16_t lo = (uint16_t)u;
+        memcpy(p, &lo, 2);
+        p[2] = (uint8_t)(u >> 16);
+    }
+}
+
+static inline void pngdec_unfilter_sub_sse2(uint8_t* dst, const uint8_t* src, int len, int bpp) {
+    __m128i a = _mm_setzero_si128();
+    int i = 0;
+    if (bpp == 4) {
+        for (; (i + 16) <= len; i += 16) {
+            __m128i x = _mm_loadu_si128((const __m128i*)(src + i));
+            x = _mm_add_epi8(x, _mm_slli_si128(x, 4));
+            x = _mm_add_epi8(x, _mm_slli_si128(x, 8));
+            x = _mm_add_epi8(x, a);
+            _mm_storeu_si128((__m128i*)(dst + i), x);
+            a = _mm_shuffle_epi32(x, _MM_SHUFFLE(3, 3, 3, 3));
+        }
+    } else {
+        // 4 pixels in the low 12 bytes, the top 4 bytes are overwritten by the next step
+        const __m128i low3 = _mm_cvtsi32_si128(0xFFFFFF);
+        for (; (i + 16) <= len; i += 12) {
+            __m128i x = _mm_loadu_si128((const __m128i*)(src + i));
+            x = _mm_add_epi8(x, _mm_slli_si128(x, 3));
+            x = _mm_add_epi8(x, _mm_slli_si128(x, 6));
+            x = _mm_add_epi8(x, a);
+            _mm_storeu_si128((__m128i*)(dst + i), x);
+            a = _mm_and_si128(_mm_srli_si128(x, 9), low3);
+            a = _mm_or_si128(a, _mm_slli_si128(a, 3));
+            a = _mm_or_si128(a, _mm_slli_si128(a, 6));
+        }
+    }
+    a = (i > 0) ? pngdec_load_pixel(dst + i - bpp, bpp) : _mm_setzero_si128();
+    for (; i < len; i += bpp) {
+        a = _mm_add_epi8(a, pngdec_load_pixel(src + i, bpp));
+        pngdec_store_pixel(dst + i, a, bpp);
+    }
+}
+
+static void pngdec_unfilter_up_sse2(uint8_t* dst, const uint8_t* src, const uint8_t* prior, int len) {
+    int i = 0;
+    for (; (i + 16) <= len; i += 16) {
+        const __m128i x = _mm_loadu_si128((const __m128i*)(src + i));
+        const __m128i b = _mm_loadu_si128((const __m128i*)(prior + i));
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_add_epi8(x, b));
+    }
+    for (; i < len; i++) {
+        dst[i] = (uint8_t)(src[i] + prior[i]);
+    }
+}
+
+static inline void pngdec_unfilter_avg_sse2(uint8_t* dst, const uint8_t* src, const uint8_t* prior, int len, int bpp) {
+    const __m128i one = _mm_set1_epi8(1);
+    __m128i a = _mm_setzero_si128();
+    for (int i = 0; i < len; i += bpp) {
+        const __m128i b = pngdec_load_pixel(prior + i, bpp);
+        // _mm_avg_epu8() rounds up, PNG rounds down
+        const __m128i avg = _mm_sub_epi8(_mm_avg_epu8(a, b), _mm_and_si128(_mm_xor_si128(a, b), one));
+        a = _mm_add_epi8(avg, pngdec_load_pixel(src + i, bpp));
+        pngdec_store_pixel(dst + i, a, bpp);
+    }
+}
+
+static __m128i pngdec_abs_epi16(__m128i x) {
+    return _mm_max_epi16(x, _mm_sub_epi16(_mm_setzero_si128(), x));
+}
+
+static __m128i pngdec_select(__m128i mask, __m128i a, __m128i b) {
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+static inline void pngdec_unfilter_paeth_sse2(uint8_t* dst, const uint8_t* src, const uint8_t* prior, int len, int bpp) {
+    const __m128i zero = _mm_setzero_si128();
+    __m128i a = zero;
+    __m128i c = zero;
+    for (int i = 0; i < len; i += bpp) {
+        // a, b and c as 16-bit lanes
+        const __m128i b = _mm_unpacklo_epi8(pngdec_load_pixel(prior + i, bpp), zero);
+        const __m128i pa0 = _mm_sub_epi16(b, c);
+        const __m128i pb0 = _mm_sub_epi16(a, c);
+        const __m128i pa = pngdec_abs_epi16(pa0);
+        const __m128i pb = pngdec_abs_epi16(pb0);
+        const __m128i pc = pngdec_abs_epi16(_mm_add_epi16(pa0, pb0));
+        const __m128i smallest = _mm_min_epi16(pc, _mm_min_epi16(pa, pb));
+        const __m128i nearest = pngdec_select(_mm_cmpeq_epi16(smallest, pa), a, pngdec_select(_mm_cmpeq_epi16(smallest, pb), b, c));
+        const __m128i x = _mm_add_epi8(_mm_packus_epi16(nearest, nearest), pngdec_load_pixel(src + i, bpp));
+        pngdec_store_pixel(dst + i, x, bpp);
+        a = _mm_unpacklo_epi8(x, zero);
+        c = b;
+    }
+}
+#endif
+
+// prior is a zero row for the first row
+static void pngdec_unfilter(int filter, uint8_t* dst, const uint8_t* src, const uint8_t* prior, int len, int bpp) {
+    #if defined(PNGDEC_SSE2)
+    if (bpp == 4) {
+        switch (filter) {
+            case 1: pngdec_unfilter_sub_sse2(dst, src, len, 4); return;
+            case 2: pngdec_unfilter_up_sse2(dst, src, prior, len); return;
+            case 3: pngdec_unfilter_avg_sse2(dst, src, prior, len, 4); return;
+            case 4: pngdec_unfilter_paeth_sse2(dst, src, prior, len, 4); return;
+            default: break;
+        }
+    } else if (bpp == 3) {
+        switch (filter) {
+            case 1: pngdec_unfilter_sub_sse2(dst, src, len, 3); return;
+            case 2: pngdec_unfilter_up_sse2(dst, src, prior, len); return;
+            case 3: pngdec_unfilter_avg_sse2(dst, src, prior, len, 3); return;
+            case 4: pngdec_unfilter_paeth_sse2(dst, src, prior, len, 3); return;
+            default: break;
+        }
+    } else if (filter == 2) {
+        pngdec_unfilter_up_sse2(dst, src, prior, len);
+        return;
+    }
+    #endif
+    pngdec_unfilter_scalar(filter, dst, src, prior, len, bpp);
+}
+
+//== CHANNEL CONVERSION ========================================================
+// same as stbi__compute_y()
+static uint8_t pngdec_luma(int r, int g, int b) {
+    return (uint8_t)(((r * 77) + (g * 150) + (29 * b)) >> 8);
+}
+
+// same conversions as stbi__convert_format(), one loop per combination
+static void pngdec_convert_row(uint8_t* dst, const uint8_t* src, int width, int in_n, int out_n) {
+    #define PNGDEC_CONVERT(body) for (int i = 0; i < width; i++, src += in_n, dst += out_n) { body; } break
+    switch (in_n * 8 + out_n) {
+        case 1 * 8 + 2: PNGDEC_CONVERT(dst[0] = src[0]; dst[1] = 255);
+        case 1 * 8 + 3: PNGDEC_CONVERT(dst[0] = dst[1] = dst[2] = src[0]);
+        case 1 * 8 + 4: PNGDEC_CONVERT(dst[0] = dst[1] = dst[2] = src[0]; dst[3] = 255);
+        case 2 * 8 + 1: PNGDEC_CONVERT(dst[0] = src[0]);
+        case 2 * 8 + 3: PNGDEC_CONVERT(dst[0] = dst[1] = dst[2] = src[0]);
+        case 2 * 8 + 4: PNGDEC_CONVERT(dst[0] = dst[1] = dst[2] = src[0]; dst[3] = src[1]);
+        case 3 * 8 + 1: PNGDEC_CONVERT(dst[0] = pngdec_luma(src[0], src[1], src[2]));
+        case 3 * 8 + 2: PNGDEC_CONVERT(dst[0] = pngdec_luma(src[0], src[1], src[2]); dst[1] = 255);
+        case 3 * 8 + 4: PNGDEC_CONVERT(dst[0] = src[0]; dst[1] = src[1]; dst[2] = src[2]; dst[3] = 255);
+        case 4 * 8 + 1: PNGDEC_CONVERT(dst[0] = pngdec_luma(src[0], src[1], src[2]));
+        case 4 * 8 + 2: PNGDEC_CONVERT(dst[0] = pngdec_luma(src[0], src[1], src[2]); dst[1] = src[3]);
+        case 4 * 8 + 3: PNGDEC_CONVERT(dst[0] = src[0]; dst[1] = src[1]; dst[2] = src[2]);
+        default: memcpy(dst, src, (size_t)(width * in_n)); break;
+    }
+    #undef PNGDEC_CONVERT
+}
+
+// palette indices to 3 or 4 channels, the palette has 4 bytes per entry
+static void pngdec_expand_palette(uint8_t* dst, const uint8_t* src, int width, const uint8_t* palette, int out_n) {
+    if (out_n == 4) {
+        for (int i = 0; i < width; i++) {
+            memcpy(dst + i * 4, palette + src[i] * 4, 4);
+        }
+    } else {
+        for (int i = 0; i < width; i++) {
+            const uint8_t* c = palette + src[i] * 4;
+            dst[i * 3 + 0] = c[0];
+            dst[i * 3 + 1] = c[1];
+            dst[i * 3 + 2] = c[2];
+        }
+    }
+}
+
+//== PNG =======================================================================
+static uint32_t pngdec_get32be(const uint8_t* p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+#define PNGDEC_CHUNK(a, b, c, d) (((uint32_t)(a) << 24) | ((uint32_t)(b) << 16) | ((uint32_t)(c) << 8) | (uint32_t)(d))
+
+pngdec_result_t pngdec_decode(const void* data, size_t size, int req_channels, uint8_t** out_pixels, int* out_width, int* out_height, int* out_channels) {
+    static const uint8_t signature[8] = { 137, 80, 78, 71, 13, 10, 26, 10 };
+    assert(data && out_pixels && out_width && out_height);
+    assert((req_channels >= 0) && (req_channels <= 4));
+    *out_pixels = 0;
+    const uint8_t* p = (const uint8_t*)data;
+    const uint8_t* end = p + size;
+    if ((size < 8) || (memcmp(p, signature, 8) != 0)) {
+        return PNGDEC_NOT_PNG;
+    }
+    p += 8;
+
+    // chunks, the IDAT chunks are collected in a second pass
+    uint32_t width = 0, height = 0;
+    int color = -1;
+    uint8_t palette[256 * 4];
+    memset(palette, 0, sizeof(palette));
+    int palette_len = 0;
+    int palette_n = 3;
+    size_t idat_size = 0;
+    int num_idat = 0;
+    const uint8_t* first_idat = 0;
+    const uint8_t* chunks = p;
+    for (;;) {
+        if ((end - p) < 12) {
+            return PNGDEC_CORRUPT;
+        }
+        const uint32_t len = pngdec_get32be(p);
+        const uint32_t type = pngdec_get32be(p + 4);
+        if ((size_t)(end - p - 12) < len) {
+            return PNGDEC_CORRUPT;
+        }
+        const uint8_t* c = p + 8;
+        if ((color == -1) && (type != PNGDEC_CHUNK('I','H','D','R'))) {
+            // also Apple's CgBI chunk in front of IHDR
+            return (type == PNGDEC_CHUNK('C','g','B','I')) ? PNGDEC_UNSUPPORTED : PNGDEC_CORRUPT;
+        }
+        if (type == PNGDEC_CHUNK('I','H','D','R')) {
+            if ((color != -1) || (len != 13)) {
+                return PNGDEC_CORRUPT;
+            }
+            width = pngdec_get32be(c);
+            height = pngdec_get32be(c + 4);
+            const int depth = c[8];
+            color = c[9];
+            if ((width == 0) || (height == 0) || (width > PNGDEC_MAX_DIMENSION) || (height > PNGDEC_MAX_DIMENSION)) {
+                return PNGDEC_CORRUPT;
+            }
+            if ((color > 6) || ((color & 1) && (color != 3)) || (c[10] != 0) || (c[11] != 0) || (c[12] > 1)) {
+                return PNGDEC_CORRUPT;
+            }
+            if ((depth != 8) || (c[12] != 0)) {
+                return PNGDEC_UNSUPPORTED;
+            }
+        } else if (type == PNGDEC_CHUNK('P','L','T','E')) {
+            if ((len > 256 * 3) || ((len % 3) != 0)) {
+                return PNGDEC_CORRUPT;
+            }
+            palette_len = (int)(len / 3);
+            for (int i = 0; i < palette_len; i++) {
+                palette[i * 4 + 0] = c[i * 3 + 0];
+                palette[i * 4 + 1] = c[i * 3 + 1];
+                palette[i * 4 + 2] = c[i * 3 + 2];
+                palette[i * 4 + 3] = 255;
+            }
+        } else if (type == PNGDEC_CHUNK('t','R','N','S')) {
+            if (color != 3) {
+                return PNGDEC_UNSUPPORTED;
+            }
+            if ((num_idat > 0) || (palette_len == 0) || ((int)len > palette_len)) {
+                return PNGDEC_CORRUPT;
+            }
+            for (uint32_t i = 0; i < len; i++) {
+                palette[i * 4 + 3] = c[i];
+            }
+            palette_n = 4;
+        } else if (type == PNGDEC_CHUNK('I','D','A','T')) {
+            if ((color == 3) && (palette_len == 0)) {
+                return PNGDEC_CORRUPT;
+            }
+            if (num_idat++ == 0) {
+                first_idat = c;
+            }
+            idat_size += len;
+        } else if (type == PNGDEC_CHUNK('I','E','N','D')) {
+            break;
+        } else if ((type & (1 << 29)) == 0) {
+            // unknown critical chunk
+            return PNGDEC_CORRUPT;
+        }
+        p += 12 + len;
+    }
+    if (num_idat == 0) {
+        return PNGDEC_CORRUPT;
+    }
+
+    const int file_n = (color == 3) ? 1 : ((color & 2) ? 3 : 1) + ((color & 4) ? 1 : 0);
+    const int src_n = (color == 3) ? palette_n : file_n;
+    const int out_n = (req_channels != 0) ? req_channels : src_n;
+    if (((1 << 30) / width / 4) < height) {
+        return PNGDEC_CORRUPT;
+    }
+    const size_t row_bytes = (size_t)width * (size_t)file_n;
+    const size_t raw_size = (row_bytes + 1) * height;
+
+    // a single IDAT chunk is inflated in place
+    uint8_t* idat = 0;
+    const uint8_t* zdata = first_idat;
+    if (num_idat > 1) {
+        idat = (uint8_t*)malloc(idat_size);
+        if (!idat) {
+            return PNGDEC_OUT_OF_MEMORY;
+        }
+        size_t offset = 0;
+        for (p = chunks; offset < idat_size; p += 12 + pngdec_get32be(p)) {
+            if (pngdec_get32be(p + 4) == PNGDEC_CHUNK('I','D','A','T')) {
+                memcpy(idat + offset, p + 8, pngdec_get32be(p));
+                offset += pngdec_get32be(p);
+            }
+        }
+        zdata = idat;
+    }
+    uint8_t* raw = (uint8_t*)malloc(raw_size + PNGDEC_OUTPUT_SLACK);
+    uint8_t* pixels = (uint8_t*)malloc((size_t)width * height * (size_t)out_n);
+    // two unfiltered rows for the conversion, and a zero row
+    uint8_t* rows = (uint8_t*)calloc(3, row_bytes);
+    uint8_t* converted = (uint8_t*)malloc((size_t)width * 4);
+    pngdec_result_t res = PNGDEC_OUT_OF_MEMORY;
+    if (raw && pixels && rows && converted) {
+        res = pngdec_inflate(zdata, idat_size, raw, raw_size);
+    }
+    free(idat);
+
+    if (res == PNGDEC_OK) {
+        const uint8_t* zero_row = rows + 2 * row_bytes;
+        // without conversion, unfilter straight into the output
+        const bool direct = (color != 3) && (out_n == file_n);
+        const size_t out_row_bytes = (size_t)width * (size_t)out_n;
+        for (uint32_t y = 0; y < height; y++) {
+            const uint8_t* src = raw + y * (row_bytes + 1);
+            const int filter = src[0];
+            if (filter > 4) {
+                res = PNGDEC_CORRUPT;
+                break;
+            }
+            uint8_t* dst;
+            const uint8_t* prior;
+            if (direct) {
+                dst = pixels + y * out_row_bytes;
+                prior = (y > 0) ? (dst - out_row_bytes) : zero_row;
+            } else {
+                dst = rows + (y & 1) * row_bytes;
+                prior = (y > 0) ? (rows + ((y + 1) & 1) * row_bytes) : zero_row;
+            }
+            pngdec_unfilter(filter, dst, src + 1, prior, (int)row_bytes, file_n);
+            if (direct) {
+                continue;
+            }
+            uint8_t* out_row = pixels + y * out_row_bytes;
+            if ((color == 3) && (out_n >= 3)) {
+                pngdec_expand_palette(out_row, dst, (int)width, palette, out_n);
+            } else if (color == 3) {
+                pngdec_expand_palette(converted, dst, (int)width, palette, palette_n);
+                pngdec_convert_row(out_row, converted, (int)width, palette_n, out_n);
+            } else {
+                pngdec_convert_row(out_row, dst, (int)width, file_n, out_n);
+            }
+        }
+    }
+    free(raw);
+    free(rows);
+    free(converted);
+    if (res != PNGDEC_OK) {
+        free(pixels);
+        return res;
+    }
+    *out_pixels = pixels;
+    *out_width = (int)width;
+    *out_height = (int)height;
+    if (out_channels) {
+        *out_channels = src_n;
+    }
+    return PNGDEC_OK;
+}
@@ -0,0 +1,46 @@
+#pragma once
+/*
+    A fast decoder for the common PNG variants: 8 bits per channel,
+    not interlaced, gray, gray+alpha, RGB, RGBA and palette images.
+
+    Compared to stb_image's PNG path:
+
+    - inflate decodes with 64-bit bit buffer refills and an 11-bit root
+      lookup table with subtables for longer codes, a lookup which
+      covers two literals decodes both at once
+    - the output size is known up front, so inflate writes into a
+      buffer of the final size and copies matches 8 bytes at a time
+    - the Sub, Up, Average and Paeth unfilters use SSE2 for 3 and 4
+      bytes per pixel (defined(__SSE2__) or x64 MSVC, disable with
+      PNGDEC_NO_SIMD)
+
+    Everything else (1/2/4/16-bit images, Adam7 interlacing, tRNS on
+    non-palette images, Apple's CgBI PNGs) returns PNGDEC_UNSUPPORTED,
+    libs/stb/stb_image.c then falls back to stb_image. Like stb_image,
+    the chunk CRCs and the zlib Adler-32 checksum are not verified.
+
+    The output matches stbi_load_from_memory() including the conversion
+    to the requested number of channels, out_channels is the number of
+    channels in the file (3 or 4 for palette images, 4 if the palette
+    has alpha). The pixels are allocated with malloc().
+*/
+#include <stdint.h>
+#include <stddef.h>
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+typedef enum pngdec_result_t {
+    PNGDEC_OK,
+    PNGDEC_NOT_PNG,
+    PNGDEC_UNSUPPORTED,
+    PNGDEC_CORRUPT,
+    PNGDEC_OUT_OF_MEMORY,
+} pngdec_result_t;
+
+// req_channels is 0 (the file's channels) or 1..4
+pngdec_result_t pngdec_decode(const void* data, size_t size, int req_channels, uint8_t** out_pixels, int* out_width, int* out_height, int* out_channels);
+
+#if defined(__cplusplus)
+}
+#endif
@@ -0,0 +1,319 @@
+//------------------------------------------------------------------------------
+//  sglrec.c
+//
+//  See sglrec.h for details.
+//------------------------------------------------------------------------------
+#include "sglrec.h"
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#define SGLREC_DEFAULT_MAX_VERTICES (64 * 1024)
+
+typedef enum {
+    SGLREC_PRIMITIVE_POINTS,
+    SGLREC_PRIMITIVE_LINES,
+    SGLREC_PRIMITIVE_LINE_STRIP,
+    SGLREC_PRIMITIVE_TRIANGLES,
+    SGLREC_PRIMITIVE_TRIANGLE_STRIP,
+    SGLREC_PRIMITIVE_QUADS,
+} sglrec_primitive_t;
+
+// primitive kinds after conversion, one pipeline each
+typedef enum {
+    SGLREC_KIND_POINTS,
+    SGLREC_KIND_LINES,
+    SGLREC_KIND_TRIANGLES,
+    SGLREC_NUM_KINDS,
+} sglrec_kind_t;
+
+// same layout as sokol_gl.h's vertex
+typedef struct {
+    float pos[3];
+    float uv[2];
+    uint32_t rgba;
+    float psize;
+} sglrec_vertex_t;
+
+typedef struct {
+    sglrec_kind_t kind;
+    int first_vertex;
+    int num_vertices;
+} sglrec_batch_t;
+
+typedef struct {
+    sglrec_vertex_t* items;
+    int num;
+    int cap;
+} sglrec_vertex_array_t;
+
+struct sglrec_list_t {
+    sg_buffer vbuf;
+    int num_vertices;
+    int num_batches;
+    sglrec_batch_t* batches;
+};
+
+static struct {
+    bool valid;
+    sg_pipeline pip[SGLREC_NUM_KINDS];
+    // recording state
+    bool recording;
+    bool in_begin;
+    sglrec_primitive_t primitive;
+    sglrec_vertex_t cur;                // current texcoord, color and point size
+    sglrec_vertex_array_t prim;         // vertices of the current primitive
+    sglrec_vertex_array_t verts;        // converted vertices of the current recording
+    sglrec_batch_t* batches;
+    int num_batches;
+    int max_batches;
+} _sglrec;
+
+static void sglrec_reserve(sglrec_vertex_array_t* arr, int num) {
+    if ((arr->num + num) > arr->cap) {
+        while ((arr->num + num) > arr->cap) {
+            arr->cap = arr->cap ? arr->cap * 2 : SGLREC_DEFAULT_MAX_VERTICES;
+        }
+        arr->items = (sglrec_vertex_t*) realloc(arr->items, (size_t)arr->cap * sizeof(sglrec_vertex_t));
+        assert(arr->items);
+    }
+}
+
+static uint32_t sglrec_pack_rgba(float r, float g, float b, float a) {
+    const uint32_t r8 = (uint32_t) (r * 255.0f + 0.5f) & 0xFF;
+    const uint32_t g8 = (uint32_t) (g * 255.0f + 0.5f) & 0xFF;
+    const uint32_t b8 = (uint32_t) (b * 255.0f + 0.5f) & 0xFF;
+    const uint32_t a8 = (uint32_t) (a * 255.0f + 0.5f) & 0xFF;
+    return r8 | (g8 << 8) | (b8 << 16) | (a8 << 24);
+}
+
+void sglrec_setup(const sglrec_desc_t* desc) {
+    assert(desc && !_sglrec.valid);
+    memset(&_sglrec, 0, sizeof(_sglrec));
+    _sglrec.valid = true;
+    if (desc->max_vertices > 0) {
+        _sglrec.verts.cap = desc->max_vertices;
+        _sglrec.verts.items = (sglrec_vertex_t*) malloc((size_t)desc->max_vertices * sizeof(sglrec_vertex_t));
+    }
+    static const sg_primitive_type prim_types[SGLREC_NUM_KINDS] = {
+        SG_PRIMITIVETYPE_POINTS,
+        SG_PRIMITIVETYPE_LINES,
+        SG_PRIMITIVETYPE_TRIANGLES,
+    };
+    for (int i = 0; i < SGLREC_NUM_KINDS; i++) {
+        sg_pipeline_desc pip_desc = desc->pipeline;
+        pip_desc.layout = (sg_vertex_layout_state){
+            .buffers[0].stride = sizeof(sglrec_vertex_t),
+            .attrs = {
+                [0] = { .offset = offsetof(sglrec_vertex_t, pos), .format = SG_VERTEXFORMAT_FLOAT3 },
+                [1] = { .offset = offsetof(sglrec_vertex_t, uv), .format = SG_VERTEXFORMAT_FLOAT2 },
+                [2] = { .offset = offsetof(sglrec_vertex_t, rgba), .format = SG_VERTEXFORMAT_UBYTE4N },
+                [3] = { .offset = offsetof(sglrec_vertex_t, psize), .format = SG_VERTEXFORMAT_FLOAT },
+            },
+        };
+        pip_desc.primitive_type = prim_types[i];
+        pip_desc.index_type = SG_INDEXTYPE_NONE;
+        _sglrec.pip[i] = sg_make_pipeline(&pip_desc);
+    }
+}
+
+void sglrec_shutdown(void) {
+    assert(_sglrec.valid);
+    for (int i = 0; i < SGLREC_NUM_KINDS; i++) {
+        sg_destroy_pipeline(_sglrec.pip[i]);
+    }
+    free(_sglrec.prim.items);
+    free(_sglrec.verts.items);
+    free(_sglrec.batches);
+    memset(&_sglrec, 0, sizeof(_sglrec));
+}
+
+void sglrec_begin_record(void) {
+    assert(_sglrec.valid && !_sglrec.recording);
+    _sglrec.recording = true;
+    _sglrec.verts.num = 0;
+    _sglrec.num_batches = 0;
+    _sglrec.cur = (sglrec_vertex_t){ .rgba = 0xFFFFFFFF, .psize = 1.0f };
+}
+
+sglrec_list_t* sglrec_end_record(const char* label) {
+    assert(_sglrec.recording && !_sglrec.in_begin);
+    _sglrec.recording = false;
+    sglrec_list_t* list = (sglrec_list_t*) calloc(1, sizeof(sglrec_list_t));
+    list->num_vertices = _sglrec.verts.num;
+    list->num_batches = _sglrec.num_batches;
+    if (list->num_vertices > 0) {
+        list->vbuf = sg_make_buffer(&(sg_buffer_desc){
+            .data = {
+                .ptr = _sglrec.verts.items,
+                .size = (size_t)_sglrec.verts.num * sizeof(sglrec_vertex_t),
+            },
+            .label = label,
+        });
+        const size_t batches_size = (size_t)_sglrec.num_batches * sizeof(sglrec_batch_t);
+        list->batches = (sglrec_batch_t*) malloc(batches_size);
+        memcpy(list->batches, _sglrec.batches, batches_size);
+    }
+    return list;
+}
+
+void sglrec_destroy(sglrec_list_t* list) {
+    if (list) {
+        sg_destroy_buffer(list->vbuf);
+        free(list->batches);
+        free(list);
+    }
+}
+
+static void sglrec_begin(sglrec_primitive_t primitive) {
+    assert(_sglrec.recording && !_sglrec.in_begin);
+    _sglrec.in_begin = true;
+    _sglrec.primitive = primitive;
+    _sglrec.prim.num = 0;
+}
+
+void sglrec_begin_points(void) { sglrec_begin(SGLREC_PRIMITIVE_POINTS); }
+void sglrec_begin_lines(void) { sglrec_begin(SGLREC_PRIMITIVE_LINES); }
+void sglrec_begin_line_strip(void) { sglrec_begin(SGLREC_PRIMITIVE_LINE_STRIP); }
+void sglrec_begin_triangles(void) { sglrec_begin(SGLREC_PRIMITIVE_TRIANGLES); }
+void sglrec_begin_triangle_strip(void) { sglrec_begin(SGLREC_PRIMITIVE_TRIANGLE_STRIP); }
+void sglrec_begin_quads(void) { sglrec_begin(SGLREC_PRIMITIVE_QUADS); }
+
+// append num vertices to the current batch (or a new batch if the primitive kind changes)
+static sglrec_vertex_t* sglrec_alloc(sglrec_kind_t kind, int num) {
+    sglrec_batch_t* batch = _sglrec.num_batches > 0 ? &_sglrec.batches[_sglrec.num_batches - 1] : 0;
+    if (!batch || (batch->kind != kind)) {
+        if (_sglrec.num_batches == _sglrec.max_batches) {
+            _sglrec.max_batches = _sglrec.max_batches ? _sglrec.max_batches * 2 : 16;
+            _sglrec.batches = (sglrec_batch_t*) realloc(_sglrec.batches, (size_t)_sglrec.max_batches * sizeof(sglrec_batch_t));
+            assert(_sglrec.batches);
+        }
+        batch = &_sglrec.batches[_sglrec.num_batches++];
+        *batch = (sglrec_batch_t){ .kind = kind, .first_vertex = _sglrec.verts.num };
+    }
+    sglrec_reserve(&_sglrec.verts, num);
+    sglrec_vertex_t* dst = &_sglrec.verts.items[_sglrec.verts.num];
+    _sglrec.verts.num += num;
+    batch->num_vertices += num;
+    return dst;
+}
+
+// convert the current primitive into a point-, line- or triangle-list
+void sglrec_end(void) {
+    assert(_sglrec.in_begin);
+    _sglrec.in_begin = false;
+    const sglrec_vertex_t* src = _sglrec.prim.items;
+    const int n = _sglrec.prim.num;
+    switch (_sglrec.primitive) {
+        case SGLREC_PRIMITIVE_POINTS:
+            if (n > 0) {
+                memcpy(sglrec_alloc(SGLREC_KIND_POINTS, n), src, (size_t)n * sizeof(sglrec_vertex_t));
+            }
+            break;
+        case SGLREC_PRIMITIVE_LINES:
+            if (n >= 2) {
+                const int num = n & ~1;
+                memcpy(sglrec_alloc(SGLREC_KIND_LINES, num), src, (size_t)num * sizeof(sglrec_vertex_t));
+            }
+            break;
+        case SGLREC_PRIMITIVE_LINE_STRIP:
+            if (n >= 2) {
+                sglrec_vertex_t* dst = sglrec_alloc(SGLREC_KIND_LINES, (n - 1) * 2);
+                for (int i = 0; i < (n - 1); i++) {
+                    *dst++ = src[i];
+                    *dst++ = src[i + 1];
+                }
+            }
+            break;
+        case SGLREC_PRIMITIVE_TRIANGLES:
+            if (n >= 3) {
+                const int num = n - (n % 3);
+                memcpy(sglrec_alloc(SGLREC_KIND_TRIANGLES, num), src, (size_t)num * sizeof(sglrec_vertex_t));
+            }
+            break;
+        case SGLREC_PRIMITIVE_TRIANGLE_STRIP:
+            if (n >= 3) {
+                sglrec_vertex_t* dst = sglrec_alloc(SGLREC_KIND_TRIANGLES, (n - 2) * 3);
+                for (int i = 0; i < (n - 2); i++) {
+                    // keep the winding order of odd triangles
+                    *dst++ = src[(i & 1) ? i + 1 : i];
+                    *dst++ = src[(i & 1) ? i : i + 1];
+                    *dst++ = src[i + 2];
+                }
+            }
+            break;
+        case SGLREC_PRIMITIVE_QUADS:
+            if (n >= 4) {
+                const int num_quads = n / 4;
+                sglrec_vertex_t* dst = sglrec_alloc(SGLREC_KIND_TRIANGLES, num_quads * 6);
+                for (int i = 0; i < num_quads; i++, src += 4) {
+                    *dst++ = src[0]; *dst++ = src[1]; *dst++ = src[2];
+                    *dst++ = src[0]; *dst++ = src[2]; *dst++ = src[3];
+                }
+            }
+            break;
+    }
+}
+
+void sglrec_t2f(float u, float v) {
+    _sglrec.cur.uv[0] = u;
+    _sglrec.cur.uv[1] = v;
+}
+
+void sglrec_c3f(float r, float g, float b) {
+    _sglrec.cur.rgba = sglrec_pack_rgba(r, g, b, 1.0f);
+}
+
+void sglrec_c4f(float r, float g, float b, float a) {
+    _sglrec.cur.rgba = sglrec_pack_rgba(r, g, b, a);
+}
+
+void sglrec_c1i(uint32_t rgba) {
+    _sglrec.cur.rgba = rgba;
+}
+
+void sglrec_point_size(float s) {
+    _sglrec.cur.psize = s;
+}
+
+void sglrec_v3f(float x, float y, float z) {
+    assert(_sglrec.in_begin);
+    sglrec_reserve(&_sglrec.prim, 1);
+    sglrec_vertex_t* v = &_sglrec.prim.items[_sglrec.prim.num++];
+    *v = _sglrec.cur;
+    v->pos[0] = x;
+    v->pos[1] = y;
+    v->pos[2] = z;
+}
+
+void sglrec_v2f(float x, float y) {
+    sglrec_v3f(x, y, 0.0f);
+}
+
+void sglrec_v3f_c3f(float x, float y, float z, float r, float g, float b) {
+    sglrec_c3f(r, g, b);
+    sglrec_v3f(x, y, z);
+}
+
+void sglrec_draw(const sglrec_list_t* list, const float mvp[16]) {
+    assert(_sglrec.valid && list);
+    int cur_kind = -1;
+    for (int i = 0; i < list->num_batches; i++) {
+        const sglrec_batch_t* batch = &list->batches[i];
+        if ((int)batch->kind != cur_kind) {
+            cur_kind = (int)batch->kind;
+            sg_apply_pipeline(_sglrec.pip[cur_kind]);
+            sg_apply_bindings(&(sg_bindings){ .vertex_buffers[0] = list->vbuf });
+            sg_apply_uniforms(0, &(sg_range){ .ptr = mvp, .size = 16 * sizeof(float) });
+        }
+        sg_draw(batch->first_vertex, batch->num_vertices, 1);
+    }
+}
+
+sglrec_stats_t sglrec_query_stats(const sglrec_list_t* list) {
+    assert(list);
+    return (sglrec_stats_t){
+        .num_vertices = list->num_vertices,
+        .num_batches = list->num_batches,
+    };
+}
@@ -0,0 +1,92 @@
+#pragma once
+/*
+    Record-once / replay-many geometry for sokol_gl.h style workloads.
+
+    The recording API mirrors the sokol-gl vertex API (sgl_begin_*(),
+    sgl_c*(), sgl_v*(), sgl_end()), but instead of being re-submitted each
+    frame, the vertices are captured into an immutable vertex buffer. Strips
+    and quads are converted to lists at record time so that consecutive
+    primitives of the same kind merge into a single batch, and a replay
+    issues one draw call per batch with a caller-provided model-view-
+    projection matrix (column-major, same as sgl_load_matrix()).
+
+    The vertex layout is the same as sokol_gl.h:
+
+        ATTR 0: float3 position
+        ATTR 1: float2 texcoord
+        ATTR 2: ubyte4n color
+        ATTR 3: float point size
+
+    ...and the shader is provided by the caller with a single vertex shader
+    uniform block in slot 0 which contains exactly one mat4 mvp (the replay
+    applies a 64 byte uniform range, so the block can't have any other
+    members).
+
+    Usage:
+
+        sglrec_setup(&(sglrec_desc_t){ .pipeline = { .shader = shd, ... } });
+
+        sglrec_begin_record();
+        sglrec_begin_lines();
+        sglrec_c3f(1.0f, 0.0f, 0.0f);
+        sglrec_v3f(...);
+        ...
+        sglrec_end();
+        sglrec_list_t* list = sglrec_end_record("my-geometry");
+
+        // each frame inside a render pass:
+        sglrec_draw(list, mvp);
+*/
+#include <stdint.h>
+#include <stddef.h>
+#include "sokol_gfx.h"
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+typedef struct sglrec_desc_t {
+    // template for the point-, line- and triangle-pipelines, the
+    // vertex layout and primitive type will be overwritten
+    sg_pipeline_desc pipeline;
+    int max_vertices;   // initial size of the recording buffer, grows on demand, default: 64K
+} sglrec_desc_t;
+
+typedef struct sglrec_list_t sglrec_list_t;
+
+typedef struct sglrec_stats_t {
+    int num_vertices;
+    int num_batches;
+} sglrec_stats_t;
+
+void sglrec_setup(const sglrec_desc_t* desc);
+void sglrec_shutdown(void);
+
+// recording, only one recording can be active at a time
+void sglrec_begin_record(void);
+sglrec_list_t* sglrec_end_record(const char* label);
+void sglrec_destroy(sglrec_list_t* list);
+
+void sglrec_begin_points(void);
+void sglrec_begin_lines(void);
+void sglrec_begin_line_strip(void);
+void sglrec_begin_triangles(void);
+void sglrec_begin_triangle_strip(void);
+void sglrec_begin_quads(void);
+void sglrec_end(void);
+
+void sglrec_t2f(float u, float v);
+void sglrec_c3f(float r, float g, float b);
+void sglrec_c4f(float r, float g, float b, float a);
+void sglrec_c1i(uint32_t rgba);
+void sglrec_point_size(float s);
+void sglrec_v2f(float x, float y);
+void sglrec_v3f(float x, float y, float z);
+void sglrec_v3f_c3f(float x, float y, float z, float r, float g, float b);
+
+// replay a recorded list inside a render pass with one draw call per batch
+void sglrec_draw(const sglrec_list_t* list, const float mvp[16]);
+sglrec_stats_t sglrec_query_stats(const sglrec_list_t* list);
+
+#if defined(__cplusplus)
+}
+#endif
@@ -0,0 +1,286 @@
+//------------------------------------------------------------------------------
+//  sgprof.c
+//
+//  See sgprof.h for details.
+//------------------------------------------------------------------------------
+#if defined(_MSC_VER)
+#define _CRT_SECURE_NO_WARNINGS (1)
+#endif
+#include "sgprof.h"
+#include <stdio.h>
+#include <stddef.h> // offsetof
+#include <string.h>
+#include <assert.h>
+
+typedef struct {
+    bool valid;
+    uint32_t size;
+    uint64_t hash;
+} sgprof_uniform_state_t;
+
+static struct {
+    bool valid;
+    sg_trace_hooks prev;
+    sgprof_frame_t cur;
+    sgprof_frame_t last;
+    // redundancy tracking, reset at the start of each pass
+    uint32_t cur_pip;
+    bool bindings_valid;
+    sg_bindings cur_bindings;
+    sgprof_uniform_state_t cur_uniforms[SG_MAX_UNIFORMBLOCK_BINDSLOTS];
+    // capture state
+    FILE* capture_fp;
+    bool capture_pending;   // capture starts at the next frame
+    int capture_frames_left;
+    uint32_t capture_num_frames;
+} sgprof;
+
+// FNV-1a
+static uint64_t sgprof_hash(const void* ptr, size_t size) {
+    const uint8_t* bytes = (const uint8_t*)ptr;
+    uint64_t h = 0xCBF29CE484222325ULL;
+    for (size_t i = 0; i < size; i++) {
+        h = (h ^ bytes[i]) * 0x100000001B3ULL;
+    }
+    return h;
+}
+
+static void sgprof_record(sgprof_record_type_t type, bool redundant, uint16_t slot, uint32_t id, uint32_t arg0, uint32_t arg1) {
+    if (sgprof.capture_fp && !sgprof.capture_pending) {
+        const sgprof_record_t rec = {
+            .type = (uint8_t)type,
+            .flags = redundant ? SGPROF_RECORDFLAG_REDUNDANT : 0,
+            .slot = slot,
+            .id = id,
+            .arg0 = arg0,
+            .arg1 = arg1,
+        };
+        fwrite(&rec, sizeof(rec), 1, sgprof.capture_fp);
+    }
+}
+
+static void sgprof_reset_apply_state(void) {
+    sgprof.bindings_valid = false;
+    memset(sgprof.cur_uniforms, 0, sizeof(sgprof.cur_uniforms));
+}
+
+static void sgprof_begin_pass(const sg_pass* pass, void* user_data) {
+    (void)user_data;
+    sgprof.cur.passes++;
+    if (pass->compute) {
+        sgprof.cur.compute_passes++;
+    }
+    sgprof.cur_pip = SG_INVALID_ID;
+    sgprof_reset_apply_state();
+    sgprof_record(SGPROF_RECORD_BEGIN_PASS, false, 0, 0, pass->compute ? 1 : 0, 0);
+    if (sgprof.prev.begin_pass) {
+        sgprof.prev.begin_pass(pass, sgprof.prev.user_data);
+    }
+}
+
+static void sgprof_end_pass(void* user_data) {
+    (void)user_data;
+    sgprof_record(SGPROF_RECORD_END_PASS, false, 0, 0, 0, 0);
+    if (sgprof.prev.end_pass) {
+        sgprof.prev.end_pass(sgprof.prev.user_data);
+    }
+}
+
+static void sgprof_apply_pipeline(sg_pipeline pip, void* user_data) {
+    (void)user_data;
+    sgprof.cur.apply_pipeline++;
+    const bool redundant = (pip.id == sgprof.cur_pip);
+    if (redundant) {
+        sgprof.cur.redundant_apply_pipeline++;
+    } else {
+        sgprof.cur_pip = pip.id;
+        sgprof_reset_apply_state();
+    }
+    sgprof_record(SGPROF_RECORD_APPLY_PIPELINE, redundant, 0, pip.id, 0, 0);
+    if (sgprof.prev.apply_pipeline) {
+        sgprof.prev.apply_pipeline(pip, sgprof.prev.user_data);
+    }
+}
+
+static void sgprof_apply_bindings(const sg_bindings* bindings, void* user_data) {
+    (void)user_data;
+    sgprof.cur.apply_bindings++;
+    const bool redundant = sgprof.bindings_valid && (0 == memcmp(bindings, &sgprof.cur_bindings, sizeof(sg_bindings)));
+    if (redundant) {
+        sgprof.cur.redundant_apply_bindings++;
+    } else {
+        sgprof.cur_bindings = *bindings;
+        sgprof.bindings_valid = true;
+    }
+    if (sgprof.capture_fp && !sgprof.capture_pending) {
+        sgprof_record(SGPROF_RECORD_APPLY_BINDINGS, redundant, 0, (uint32_t)sgprof_hash(bindings, sizeof(sg_bindings)), 0, 0);
+    }
+    if (sgprof.prev.apply_bindings) {
+        sgprof.prev.apply_bindings(bindings, sgprof.prev.user_data);
+    }
+}
+
+static void sgprof_apply_uniforms(int ub_slot, const sg_range* data, void* user_data) {
+    (void)user_data;
+    assert((ub_slot >= 0) && (ub_slot < SG_MAX_UNIFORMBLOCK_BINDSLOTS));
+    sgprof.cur.apply_uniforms++;
+    sgprof.cur.uniform_bytes += data->size;
+    sgprof_uniform_state_t* ub = &sgprof.cur_uniforms[ub_slot];
+    const uint64_t hash = sgprof_hash(data->ptr, data->size);
+    const bool redundant = ub->valid && (ub->size == data->size) && (ub->hash == hash);
+    if (redundant) {
+        sgprof.cur.redundant_apply_uniforms++;
+    } else {
+        ub->valid = true;
+        ub->size = (uint32_t)data->size;
+        ub->hash = hash;
+    }
+    sgprof_record(SGPROF_RECORD_APPLY_UNIFORMS, redundant, (uint16_t)ub_slot, 0, (uint32_t)data->size, 0);
+    if (sgprof.prev.apply_uniforms) {
+        sgprof.prev.apply_uniforms(ub_slot, data, sgprof.prev.user_data);
+    }
+}
+
+static void sgprof_draw(int base_element, int num_elements, int num_instances, void* user_data) {
+    (void)user_data;
+    sgprof.cur.draw++;
+    sgprof.cur.num_elements += (uint64_t)num_elements * (uint64_t)num_instances;
+    sgprof_record(SGPROF_RECORD_DRAW, false, 0, (uint32_t)base_element, (uint32_t)num_elements, (uint32_t)num_instances);
+    if (sgprof.prev.draw) {
+        sgprof.prev.draw(base_element, num_elements, num_instances, sgprof.prev.user_data);
+    }
+}
+
+static void sgprof_dispatch(int num_groups_x, int num_groups_y, int num_groups_z, void* user_data) {
+    (void)user_data;
+    sgprof.cur.dispatch++;
+    sgprof_record(SGPROF_RECORD_DISPATCH, false, 0, (uint32_t)num_groups_x, (uint32_t)num_groups_y, (uint32_t)num_groups_z);
+    if (sgprof.prev.dispatch) {
+        sgprof.prev.dispatch(num_groups_x, num_groups_y, num_groups_z, sgprof.prev.user_data);
+    }
+}
+
+static void sgprof_update_buffer(sg_buffer buf, const sg_range* data, void* user_data) {
+    (void)user_data;
+    sgprof.cur.update_buffer++;
+    sgprof.cur.update_buffer_bytes += data->size;
+    sgprof_record(SGPROF_RECORD_UPDATE_BUFFER, false, 0, buf.id, (uint32_t)data->size, 0);
+    if (sgprof.prev.update_buffer) {
+        sgprof.prev.update_buffer(buf, data, sgprof.prev.user_data);
+    }
+}
+
+static void sgprof_append_buffer(sg_buffer buf, const sg_range* data, int result, void* user_data) {
+    (void)user_data;
+    sgprof.cur.append_buffer++;
+    sgprof.cur.append_buffer_bytes += data->size;
+    sgprof_record(SGPROF_RECORD_APPEND_BUFFER, false, 0, buf.id, (uint32_t)data->size, 0);
+    if (sgprof.prev.append_buffer) {
+        sgprof.prev.append_buffer(buf, data, result, sgprof.prev.user_data);
+    }
+}
+
+static void sgprof_update_image(sg_image img, const sg_image_data* data, void* user_data) {
+    (void)user_data;
+    size_t size = 0;
+    for (int face = 0; face < SG_CUBEFACE_NUM; face++) {
+        for (int mip = 0; mip < SG_MAX_MIPMAPS; mip++) {
+            size += data->subimage[face][mip].size;
+        }
+    }
+    sgprof.cur.update_image++;
+    sgprof.cur.update_image_bytes += size;
+    sgprof_record(SGPROF_RECORD_UPDATE_IMAGE, false, 0, img.id, (uint32_t)size, 0);
+    if (sgprof.prev.update_image) {
+        sgprof.prev.update_image(img, data, sgprof.prev.user_data);
+    }
+}
+
+static void sgprof_commit(void* user_data) {
+    (void)user_data;
+    sgprof_record(SGPROF_RECORD_FRAME, false, 0, (uint32_t)sgprof.cur.frame_index, 0, 0);
+    sgprof.last = sgprof.cur;
+    memset(&sgprof.cur, 0, sizeof(sgprof.cur));
+    sgprof.cur.frame_index = sgprof.last.frame_index + 1;
+    if (sgprof.capture_fp) {
+        if (sgprof.capture_pending) {
+            sgprof.capture_pending = false;
+        } else {
+            sgprof.capture_num_frames++;
+            if (--sgprof.capture_frames_left <= 0) {
+                sgprof_end_capture();
+            }
+        }
+    }
+    if (sgprof.prev.commit) {
+        sgprof.prev.commit(sgprof.prev.user_data);
+    }
+}
+
+void sgprof_setup(void) {
+    assert(!sgprof.valid);
+    assert(sg_isvalid());
+    memset(&sgprof, 0, sizeof(sgprof));
+    sgprof.valid = true;
+    // install our hooks on top of the existing hooks, the hooks we don't
+    // override are passed through unchanged
+    sg_trace_hooks hooks = sg_install_trace_hooks(&(sg_trace_hooks){0});
+    sgprof.prev = hooks;
+    hooks.begin_pass = sgprof_begin_pass;
+    hooks.end_pass = sgprof_end_pass;
+    hooks.apply_pipeline = sgprof_apply_pipeline;
+    hooks.apply_bindings = sgprof_apply_bindings;
+    hooks.apply_uniforms = sgprof_apply_uniforms;
+    hooks.draw = sgprof_draw;
+    hooks.dispatch = sgprof_dispatch;
+    hooks.update_buffer = sgprof_update_buffer;
+    hooks.append_buffer = sgprof_append_buffer;
+    hooks.update_image = sgprof_update_image;
+    hooks.commit = sgprof_commit;
+    sg_install_trace_hooks(&hooks);
+}
+
+void sgprof_shutdown(void) {
+    assert(sgprof.valid);
+    sgprof_end_capture();
+    sg_install_trace_hooks(&sgprof.prev);
+    sgprof.valid = false;
+}
+
+const sgprof_frame_t* sgprof_last_frame(void) {
+    assert(sgprof.valid);
+    return &sgprof.last;
+}
+
+bool sgprof_begin_capture(const char* path, int num_frames) {
+    assert(sgprof.valid && path && (num_frames > 0));
+    sgprof_end_capture();
+    sgprof.capture_fp = fopen(path, "wb");
+    if (!sgprof.capture_fp) {
+        return false;
+    }
+    // the frame count is patched in sgprof_end_capture()
+    const sgprof_file_header_t hdr = {
+        .magic = SGPROF_FILE_MAGIC,
+        .version = SGPROF_FILE_VERSION,
+        .record_size = sizeof(sgprof_record_t),
+    };
+    fwrite(&hdr, sizeof(hdr), 1, sgprof.capture_fp);
+    sgprof.capture_pending = true;
+    sgprof.capture_frames_left = num_frames;
+    sgprof.capture_num_frames = 0;
+    return true;
+}
+
+void sgprof_end_capture(void) {
+    if (sgprof.capture_fp) {
+        fseek(sgprof.capture_fp, (long)offsetof(sgprof_file_header_t, num_frames), SEEK_SET);
+        fwrite(&sgprof.capture_num_frames, sizeof(uint32_t), 1, sgprof.capture_fp);
+        fclose(sgprof.capture_fp);
+        sgprof.capture_fp = 0;
+    }
+}
+
+bool sgprof_capturing(void) {
+    return 0 != sgprof.capture_fp;
+}
@@ -0,0 +1,122 @@
+#pragma once
+/*
+    Per-frame sokol-gfx call profiler and frame capture on top of the
+    sokol_gfx.h trace hooks (requires SOKOL_TRACE_HOOKS in the sokol_gfx.h
+    implementation, which libs/sokol/sokol.c defines).
+
+    Counts each frame (from sg_commit() to sg_commit()) the passes,
+    pipeline/bindings/uniform applications, draws, dispatches and resource
+    updates with their size in bytes, and detects redundant applications:
+
+    - sg_apply_pipeline() with the pipeline that's already applied in
+      the current pass
+    - sg_apply_bindings() with the same bindings as the previous call,
+      without a pipeline change in between
+    - sg_apply_uniforms() with the same data for the same slot as the
+      previous call, without a pipeline change in between
+
+    A redundant pipeline application doesn't invalidate the following
+    bindings and uniforms, so re-applying the same pipeline, bindings and
+    uniforms counts all three as redundant.
+
+    Previously installed trace hooks (for instance by sokol_gfx_imgui.h)
+    are still called.
+
+    Optionally, the call stream of a number of frames can be written to a
+    compact binary capture file (a header followed by 16-byte records, see
+    sgprof_file_header_t and sgprof_record_t below), which can be
+    summarized offline with the sgprof-summary tool.
+
+    Usage:
+
+        sg_setup(...);
+        sgprof_setup();
+
+        // anywhere, the capture starts with the next frame
+        sgprof_begin_capture("frames.sgprof", 60);
+
+        // after sg_commit()
+        const sgprof_frame_t* f = sgprof_last_frame();
+
+        sgprof_shutdown();
+        sg_shutdown();
+*/
+#include <stdint.h>
+#include <stdbool.h>
+#include "sokol_gfx.h"
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+typedef struct sgprof_frame_t {
+    uint64_t frame_index;
+    int passes;
+    int compute_passes;
+    int apply_pipeline;
+    int redundant_apply_pipeline;
+    int apply_bindings;
+    int redundant_apply_bindings;
+    int apply_uniforms;
+    int redundant_apply_uniforms;
+    uint64_t uniform_bytes;
+    int draw;
+    uint64_t num_elements;      // num_elements * num_instances of all draws
+    int dispatch;
+    int update_buffer;
+    uint64_t update_buffer_bytes;
+    int append_buffer;
+    uint64_t append_buffer_bytes;
+    int update_image;
+    uint64_t update_image_bytes;
+} sgprof_frame_t;
+
+void sgprof_setup(void);
+void sgprof_shutdown(void);
+// counters of the last completed frame
+const sgprof_frame_t* sgprof_last_frame(void);
+// capture the next num_frames frames into a file, returns false if the file can't be opened
+bool sgprof_begin_capture(const char* path, int num_frames);
+// finish a capture early (called automatically after num_frames)
+void sgprof_end_capture(void);
+bool sgprof_capturing(void);
+
+//-- capture file format -------------------------------------------------------
+#define SGPROF_FILE_MAGIC (0x46504753)  // 'SGPF'
+#define SGPROF_FILE_VERSION (1)
+
+typedef struct sgprof_file_header_t {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t record_size;
+    uint32_t num_frames;
+} sgprof_file_header_t;
+
+typedef enum sgprof_record_type_t {
+    SGPROF_RECORD_FRAME,            // id: frame index (low 32 bits), ends a frame
+    SGPROF_RECORD_BEGIN_PASS,       // arg0: 1 if compute pass
+    SGPROF_RECORD_END_PASS,
+    SGPROF_RECORD_APPLY_PIPELINE,   // id: pipeline id
+    SGPROF_RECORD_APPLY_BINDINGS,   // id: hash of the bindings
+    SGPROF_RECORD_APPLY_UNIFORMS,   // slot: uniform block slot, arg0: size in bytes
+    SGPROF_RECORD_DRAW,             // id: base element, arg0: num elements, arg1: num instances
+    SGPROF_RECORD_DISPATCH,         // id, arg0, arg1: num groups x, y, z
+    SGPROF_RECORD_UPDATE_BUFFER,    // id: buffer id, arg0: size in bytes
+    SGPROF_RECORD_APPEND_BUFFER,    // id: buffer id, arg0: size in bytes
+    SGPROF_RECORD_UPDATE_IMAGE,     // id: image id, arg0: size in bytes
+    SGPROF_NUM_RECORD_TYPES,
+} sgprof_record_type_t;
+
+#define SGPROF_RECORDFLAG_REDUNDANT (1<<0)
+
+typedef struct sgprof_record_t {
+    uint8_t type;       // sgprof_record_type_t
+    uint8_t flags;      // SGPROF_RECORDFLAG_*
+    uint16_t slot;
+    uint32_t id;
+    uint32_t arg0;
+    uint32_t arg1;
+} sgprof_record_t;
+
+#if defined(__cplusplus)
+} // extern "C"
+#endif
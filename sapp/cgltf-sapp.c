@@ -4,6 +4,25 @@
 //  A simple(!) GLTF viewer, cgltf + basisu + sokol_app.h + sokol_gfx.h + sokol_fetch.h.
 //  Doesn't support all GLTF features.
 //
+//  Lighting is clustered forward: KHR_lights_punctual point and spot
+//  lights are binned into view space clusters on the CPU (util/lightgrid.h),
+//  and the fragment shader only loops over the lights of its cluster.
+//  Since the DamagedHelmet has no lights of its own, a configurable
+//  number of animated demo lights are added.
+//
+//  With process_meshes enabled, triangle primitives are processed at load
+//  time (util/meshproc.h): the triangles are reordered for the vertex cache
+//  and against overdraw, the vertices by first use, and the vertices are
+//  quantized to 16 bytes (16-bit positions in the bounding box of the
+//  primitive, octahedron-encoded normals and half-float UVs). Accessors
+//  from KHR_mesh_quantization and buffer views compressed with
+//  EXT_meshopt_compression are decoded in the process.
+//
+//  Draws go through a render queue: each frame the visible primitives
+//  are radix-sorted by a 64-bit key (translucency, pipeline, material,
+//  vertex buffer, depth), and only the pipeline, binding and uniform
+//  changes between consecutive draws are applied.
+//
 //  https://github.com/jkuhlmann/cgltf
 //------------------------------------------------------------------------------
 #define VECMATH_GENERICS
@@ -12,6 +31,7 @@
 #include "sokol_app.h"
 #include "sokol_fetch.h"
 #include "sokol_log.h"
+#include "sokol_time.h"
 #define SOKOL_DEBUGTEXT_IMPL
 #include "sokol_debugtext.h"
 #include "sokol_glue.h"
@@ -26,22 +46,38 @@
 #include "cgltf/cgltf.h"
 #include "util/camera.h"
 #include "util/fileutil.h"
+#include "util/lightgrid.h"
+#include "util/meshproc.h"
 #include <assert.h>
+#include <stddef.h>
+#include <float.h>
 
 #if defined(__GNUC__) || defined(__clang__)
 #pragma GCC diagnostic ignored "-Wmissing-braces"
 #endif
 
 static const char* filename = "DamagedHelmet.gltf";
+// quantize and reorder the mesh data at load time, otherwise the
+// buffer views are uploaded as they are
+static const bool process_meshes = true;
 
 #define SCENE_INVALID_INDEX (-1)
-#define SCENE_MAX_BUFFERS (16)
+#define SCENE_MAX_GLTF_BUFFERS (8)
+#define SCENE_MAX_BUFFER_VIEWS (16)
+// the buffer views, plus a vertex and index buffer per processed primitive
+#define SCENE_MAX_BUFFERS (SCENE_MAX_BUFFER_VIEWS + 2 * SCENE_MAX_PRIMITIVES)
 #define SCENE_MAX_IMAGES (16)
 #define SCENE_MAX_MATERIALS (16)
 #define SCENE_MAX_PIPELINES (16)
 #define SCENE_MAX_PRIMITIVES (16)   // aka submesh
 #define SCENE_MAX_MESHES (16)
 #define SCENE_MAX_NODES (16)
+#define SCENE_MAX_LIGHTS (256)
+#define MAX_DRAWS (SCENE_MAX_NODES * SCENE_MAX_PRIMITIVES)
+
+// lights without a range are cut off where their intensity drops below this
+#define LIGHT_CUTOFF (0.05f)
+#define MAX_DEMO_LIGHTS (512)
 
 // statically allocated buffers for file downloads
 #define SFETCH_NUM_CHANNELS (1)
@@ -104,8 +140,16 @@ typedef struct {
     int index_buffer;       // index into bufferview array for index buffer, or SCENE_INVALID_INDEX
     int base_element;       // index of first index or vertex to draw
     int num_elements;       // number of vertices or indices to draw
+    mat44_t dequant;        // quantized to model space positions, identity if not processed
 } primitive_t;
 
+// vertex layout of processed primitives
+typedef struct {
+    int16_t pos[4];         // SHORT4N, relative to the bounding box of the primitive
+    int16_t normal[2];      // SHORT2N, octahedron-encoded
+    uint16_t uv[2];         // HALF2
+} quantized_vertex_t;
+
 // a mesh is just a group of primitives (aka submeshes)
 typedef struct {
     int first_primitive;    // index into scene.primitives
@@ -119,6 +163,24 @@ typedef struct {
     mat44_t transform;
 } node_t;
 
+// a KHR_lights_punctual light, the node transform is baked into world space
+typedef struct {
+    cgltf_light_type type;
+    vec3_t pos;
+    vec3_t dir;
+    vec3_t color;       // color * intensity
+    float range;
+    float spot_scale;   // spot cone falloff, see KHR_lights_punctual
+    float spot_offset;
+} light_t;
+
+// an entry in the render queue
+typedef struct {
+    uint64_t key;
+    int node;           // index into scene.nodes
+    int primitive;      // index into scene.primitives
+} draw_item_t;
+
 typedef struct {
     sg_image img;
     sg_view tex_view;
@@ -134,6 +196,7 @@ typedef struct {
     int num_primitives; // aka 'submeshes'
     int num_meshes;
     int num_nodes;
+    int num_lights;
     sg_buffer buffers[SCENE_MAX_BUFFERS];
     image_t images[SCENE_MAX_IMAGES];
     sg_pipeline pipelines[SCENE_MAX_PIPELINES];
@@ -141,17 +204,55 @@ typedef struct {
     primitive_t primitives[SCENE_MAX_PRIMITIVES];
     mesh_t meshes[SCENE_MAX_MESHES];
     node_t nodes[SCENE_MAX_NODES];
+    light_t lights[SCENE_MAX_LIGHTS];
 } scene_t;
 
 // resource creation helper params, these are stored until the
 // async-loaded resources (buffers and images) have been loaded
+typedef enum {
+    MESHOPT_MODE_ATTRIBUTES,
+    MESHOPT_MODE_TRIANGLES,
+    MESHOPT_MODE_INDICES,
+} meshopt_mode_t;
+
 typedef struct {
     sg_buffer_usage usage;
     int offset;
     int size;
     int gltf_buffer_index;
+    bool used;              // uploaded as is for an unprocessed primitive
+    // EXT_meshopt_compression: the data is decoded from another buffer range
+    struct {
+        bool compressed;
+        int gltf_buffer_index;
+        int offset;
+        int size;
+        int stride;
+        int count;
+        meshopt_mode_t mode;
+        meshproc_filter_t filter;
+    } meshopt;
 } buffer_creation_params_t;
 
+// accessor parameters for the load-time processing
+typedef struct {
+    int buffer_view;        // SCENE_INVALID_INDEX if the accessor doesn't exist
+    int offset;
+    int stride;
+    int count;
+    int num_components;
+    cgltf_component_type component_type;
+    bool normalized;
+} accessor_creation_params_t;
+
+typedef struct {
+    bool process;
+    accessor_creation_params_t position;
+    accessor_creation_params_t normal;
+    accessor_creation_params_t texcoord;
+    accessor_creation_params_t indices;
+} primitive_creation_params_t;
+
 typedef struct {
     sg_filter min_filter;
     sg_filter mag_filter;
@@ -167,6 +268,7 @@ typedef struct {
     sg_primitive_type prim_type;
     sg_index_type index_type;
     bool alpha;
+    bool quantized;
 } pipeline_cache_params_t;
 
 // the top-level application state struct
@@ -178,21 +280,73 @@ static struct {
     } pass_actions;
     struct {
         sg_shader metallic;
+        sg_shader metallic_quantized;
         sg_shader specular;
     } shaders;
     sg_sampler smp;
     scene_t scene;
     camera_t camera;
-    cgltf_light_params_t point_light;     // code-generated from shader
+    light_t point_light;
     mat44_t root_transform;
     float rx, ry;
+    double time;
     struct {
-        buffer_creation_params_t buffers[SCENE_MAX_BUFFERS];
+        int num_demo;
+        bool show_clusters;
+        int num_global;             // directional lights at the start of light_data
+        int num_clustered;
+        double build_ms;
+        cgltf_light_params_t params;    // code-generated from shader
+        vec4_t light_data[LGRID_MAX_LIGHTS][3];
+        lgrid_light_t spheres[LGRID_MAX_LIGHTS];
+        lgrid_t grid;
+        sg_image light_img;
+        sg_image cluster_img;
+        sg_image index_img;
+        sg_view light_tex;
+        sg_view cluster_tex;
+        sg_view index_tex;
+        sg_sampler smp;
+    } lights;
+    struct {
+        light_t lights[MAX_DEMO_LIGHTS];
+        float radius[MAX_DEMO_LIGHTS];
+        float height[MAX_DEMO_LIGHTS];
+        float speed[MAX_DEMO_LIGHTS];
+        float phase[MAX_DEMO_LIGHTS];
+    } demo;
+    struct {
+        int num_buffer_views;
+        buffer_creation_params_t buffers[SCENE_MAX_BUFFER_VIEWS];
         image_sampler_creation_params_t images[SCENE_MAX_IMAGES];
+        primitive_creation_params_t primitives[SCENE_MAX_PRIMITIVES];
     } creation_params;
+    // the glTF buffers are kept until all of them have been loaded
+    struct {
+        int num_pending;
+        uint8_t* data[SCENE_MAX_GLTF_BUFFERS];
+        size_t size[SCENE_MAX_GLTF_BUFFERS];
+        uint8_t* decoded[SCENE_MAX_BUFFER_VIEWS];  // EXT_meshopt_compression buffer views
+    } load;
+    struct {
+        int num_processed;
+        size_t bytes_before;
+        size_t bytes_after;
+        uint32_t num_tris;
+        float acmr_before;      // triangle-weighted over all processed primitives
+        float acmr_after;
+    } mesh_stats;
     struct {
         pipeline_cache_params_t items[SCENE_MAX_PIPELINES];
     } pip_cache;
+    struct {
+        bool sort;
+        int num_draws;
+        draw_item_t items[MAX_DRAWS];
+        draw_item_t tmp[MAX_DRAWS];     // radix sort scratch buffer
+        int num_applies;    // pipeline, bindings and uniform applies in the last frame
+        int num_naive;      // the same without skipping redundant applies
+    } queue;
     struct {
         sg_view white;
         sg_view normal;
@@ -203,23 +357,31 @@ static struct {
 
 static void gltf_parse(sfetch_range_t file_data);
 static void gltf_parse_buffers(const cgltf_data* gltf);
+static void gltf_parse_meshopt_views(const cgltf_data* gltf);
 static void gltf_parse_images(const cgltf_data* gltf);
 static void gltf_parse_materials(const cgltf_data* gltf);
 static void gltf_parse_meshes(const cgltf_data* gltf);
 static void gltf_parse_nodes(const cgltf_data* gltf);
+static void gltf_parse_light(const cgltf_data* gltf, const cgltf_node* gltf_node);
 
 static void gltf_fetch_callback(const sfetch_response_t*);
 static void gltf_buffer_fetch_callback(const sfetch_response_t*);
 static void gltf_image_fetch_callback(const sfetch_response_t*);
 
-static void create_sg_buffers_for_gltf_buffer(int gltf_buffer_index, sg_range data);
+static void store_gltf_buffer(int gltf_buffer_index, sfetch_range_t data);
+static void create_sg_buffers(void);
 static void create_sg_image_samplers_for_gltf_image(int gltf_image_index, sg_range data);
 static vertex_buffer_mapping_t create_vertex_buffer_mapping_for_gltf_primitive(const cgltf_data* gltf, const cgltf_primitive* prim);
-static int create_sg_pipeline_for_gltf_primitive(const cgltf_data* gltf, const cgltf_primitive* prim, const vertex_buffer_mapping_t* vbuf_map);
+static int create_sg_pipeline_for_gltf_primitive(const cgltf_data* gltf, const cgltf_primitive* prim, const vertex_buffer_mapping_t* vbuf_map, const primitive_creation_params_t* processed);
 static mat44_t build_transform_for_gltf_node(const cgltf_data* gltf, const cgltf_node* node);
 
 static void update_scene(void);
+static void update_lights(void);
+static void init_lights(void);
 static cgltf_vs_params_t vs_params_for_node(int node_index);
+static void build_draw_queue(void);
+static void sort_draw_queue(void);
+static void draw_queue(void);
 
 // sokol-app init callback, called once at startup
 static void init(void) {
@@ -230,6 +392,7 @@ static void init(void) {
     });
     // setup the optional debugging UI
     __dbgui_setup(sapp_sample_count());
+    stm_setup();
 
     // initialize camera helper
     cam_init(&state.camera, &(camera_desc_t){
@@ -238,6 +401,8 @@ static void init(void) {
         .distance = 2.5f,
     });
 
+    state.queue.sort = true;
+
     // initialize Basis Universal
     sbasisu_setup();
 
@@ -268,15 +433,18 @@ static void init(void) {
 
     // create shaders
     state.shaders.metallic = sg_make_shader(cgltf_metallic_shader_desc(sg_query_backend()));
+    state.shaders.metallic_quantized = sg_make_shader(cgltf_metallic_quantized_shader_desc(sg_query_backend()));
     //state.shaders.specular = sg_make_shader(cgltf_specular_shader_desc());
 
-    // setup the point light
-    state.point_light = (cgltf_light_params_t){
-        .light_pos = vec3(10.0, 10.0, 10.0),
-        .light_range = 200.0,
-        .light_color = vec3(1.0, 1.5, 2.0),
-        .light_intensity = 700.0
+    // setup the default point light, the light textures and demo lights
+    state.point_light = (light_t){
+        .type = cgltf_light_type_point,
+        .pos = vec3(10.0f, 10.0f, 10.0f),
+        .range = 200.0f,
+        .color = vec3(700.0f, 1050.0f, 1400.0f),
+        .spot_offset = 1.0f,
     };
+    init_lights();
 
     // start loading the base gltf file...
     char path_buf[512];
@@ -342,12 +510,30 @@ static void frame(void) {
     sdtx_color1i(0xFFFFFFFF);
     sdtx_origin(1.0f, 2.0f);
     sdtx_puts("LMB + drag:  rotate\n");
-    sdtx_puts("mouse wheel: zoom");
+    sdtx_puts("mouse wheel: zoom\n");
+    sdtx_puts("L:           demo lights\n");
+    sdtx_puts("C:           show clusters\n");
+    sdtx_puts("S:           draw sorting\n\n");
 
     update_scene();
     const int fb_width = sapp_width();
     const int fb_height = sapp_height();
     cam_update(&state.camera, fb_width, fb_height);
+    update_lights();
+    sdtx_printf("lights:      %d + %d directional\n", state.lights.num_clustered, state.lights.num_global);
+    sdtx_printf("clusters:    %d / %d\n", state.lights.grid.num_occupied, LGRID_NUM_CLUSTERS);
+    sdtx_printf("indices:     %d", state.lights.grid.num_indices);
+    if (state.lights.grid.num_dropped > 0) {
+        sdtx_printf(" (%d dropped)", state.lights.grid.num_dropped);
+    }
+    sdtx_printf("\nbuild:       %.3f ms\n\n", state.lights.build_ms);
+    if (state.mesh_stats.num_processed > 0) {
+        sdtx_printf("processed:   %d primitives\n", state.mesh_stats.num_processed);
+        sdtx_printf("mesh data:   %d KB => %d KB\n", (int)(state.mesh_stats.bytes_before / 1024), (int)(state.mesh_stats.bytes_after / 1024));
+        sdtx_printf("ACMR:        %.3f => %.3f\n\n", state.mesh_stats.acmr_before, state.mesh_stats.acmr_after);
+    }
+    sdtx_printf("draws:       %d (%s)\n", state.queue.num_draws, state.queue.sort ? "sorted" : "scene order");
+    sdtx_printf("applies:     %d (%d redundant skipped)", state.queue.num_applies, state.queue.num_naive - state.queue.num_applies);
 
     // render the scene
     if (state.failed) {
@@ -356,79 +542,10 @@ static void frame(void) {
         __dbgui_draw();
         sg_end_pass();
     } else {
+        build_draw_queue();
+        sort_draw_queue();
         sg_begin_pass(&(sg_pass){ .action = state.pass_actions.ok, .swapchain = sglue_swapchain() });
-        for (int node_index = 0; node_index < state.scene.num_nodes; node_index++) {
-            const node_t* node = &state.scene.nodes[node_index];
-            cgltf_vs_params_t vs_params = vs_params_for_node(node_index);
-            const mesh_t* mesh = &state.scene.meshes[node->mesh];
-            for (int i = 0; i < mesh->num_primitives; i++) {
-                const primitive_t* prim = &state.scene.primitives[i + mesh->first_primitive];
-                const material_t* mat = &state.scene.materials[prim->material];
-                sg_apply_pipeline(state.scene.pipelines[prim->pipeline]);
-                sg_bindings bind = { 0 };
-                for (int vb_slot = 0; vb_slot < prim->vertex_buffers.num; vb_slot++) {
-                    bind.vertex_buffers[vb_slot] = state.scene.buffers[prim->vertex_buffers.buffer[vb_slot]];
-                }
-                if (prim->index_buffer != SCENE_INVALID_INDEX) {
-                    bind.index_buffer = state.scene.buffers[prim->index_buffer];
-                }
-                sg_apply_uniforms(UB_cgltf_vs_params, &SG_RANGE(vs_params));
-                sg_apply_uniforms(UB_cgltf_light_params, &SG_RANGE(state.point_light));
-                if (mat->is_metallic) {
-                    sg_view base_color_tex = state.scene.images[mat->metallic.images.base_color].tex_view;
-                    sg_view metallic_roughness_tex = state.scene.images[mat->metallic.images.metallic_roughness].tex_view;
-                    sg_view normal_tex = state.scene.images[mat->metallic.images.normal].tex_view;
-                    sg_view occlusion_tex = state.scene.images[mat->metallic.images.occlusion].tex_view;
-                    sg_view emissive_tex = state.scene.images[mat->metallic.images.emissive].tex_view;
-                    sg_sampler base_color_smp = state.scene.images[mat->metallic.images.base_color].smp;
-                    sg_sampler metallic_roughness_smp = state.scene.images[mat->metallic.images.metallic_roughness].smp;
-                    sg_sampler normal_smp = state.scene.images[mat->metallic.images.normal].smp;
-                    sg_sampler occlusion_smp = state.scene.images[mat->metallic.images.occlusion].smp;
-                    sg_sampler emissive_smp = state.scene.images[mat->metallic.images.emissive].smp;
-
-                    if (!base_color_tex.id) {
-                        base_color_tex = state.placeholders.white;
-                        base_color_smp = state.placeholders.smp;
-                    }
-                    if (!metallic_roughness_tex.id) {
-                        metallic_roughness_tex = state.placeholders.white;
-                        metallic_roughness_smp = state.placeholders.smp;
-                    }
-                    if (!normal_tex.id) {
-                        normal_tex = state.placeholders.normal;
-                        normal_smp = state.placeholders.smp;
-                    }
-                    if (!occlusion_tex.id) {
-                        occlusion_tex = state.placeholders.white;
-                        occlusion_smp = state.placeholders.smp;
-                    }
-                    if (!emissive_tex.id) {
-                        emissive_tex = state.placeholders.black;
-                        emissive_smp = state.placeholders.smp;
-                    }
-                    bind.views[VIEW_cgltf_base_color_tex] = base_color_tex;
-                    bind.views[VIEW_cgltf_metallic_roughness_tex] = metallic_roughness_tex;
-                    bind.views[VIEW_cgltf_normal_tex] = normal_tex;
-                    bind.views[VIEW_cgltf_occlusion_tex] = occlusion_tex;
-                    bind.views[VIEW_cgltf_emissive_tex] = emissive_tex;
-                    bind.samplers[SMP_cgltf_base_color_smp] = base_color_smp;
-                    bind.samplers[SMP_cgltf_metallic_roughness_smp] = metallic_roughness_smp;
-                    bind.samplers[SMP_cgltf_normal_smp] = normal_smp;
-                    bind.samplers[SMP_cgltf_occlusion_smp] = occlusion_smp;
-                    bind.samplers[SMP_cgltf_emissive_smp] = emissive_smp;
-                    sg_apply_uniforms(UB_cgltf_metallic_params, &SG_RANGE(mat->metallic.fs_params));
-                } else {
-                /*
-                    sg_apply_uniforms(SG_SHADERSTAGE_VS,
-                        SLOT_specular_params,
-                        &mat->specular.fs_params,
-                        sizeof(specular_params_t));
-                */
-                }
-                sg_apply_bindings(&bind);
-                sg_draw(prim->base_element, prim->num_elements, 1);
-            }
-        }
+        draw_queue();
         sdtx_draw();
         __dbgui_draw();
         sg_end_pass();
@@ -449,6 +566,19 @@ static void input(const sapp_event* ev) {
     if (__dbgui_event_with_retval(ev)) {
         return;
     }
+    if (ev->type == SAPP_EVENTTYPE_KEY_DOWN) {
+        if (ev->key_code == SAPP_KEYCODE_L) {
+            // cycle through 0, 64, 128, 256, 512 demo lights
+            state.lights.num_demo = (state.lights.num_demo == 0) ? 64 : state.lights.num_demo * 2;
+            if (state.lights.num_demo > MAX_DEMO_LIGHTS) {
+                state.lights.num_demo = 0;
+            }
+        } else if (ev->key_code == SAPP_KEYCODE_C) {
+            state.lights.show_clusters = !state.lights.show_clusters;
+        } else if (ev->key_code == SAPP_KEYCODE_S) {
+            state.queue.sort = !state.queue.sort;
+        }
+    }
     cam_handle_event(&state.camera, ev);
 }
 
@@ -479,7 +609,7 @@ static void gltf_buffer_fetch_callback(const sfetch_response_t* response) {
     } else if (response->fetched) {
         const gltf_buffer_fetch_userdata_t* user_data = (const gltf_buffer_fetch_userdata_t*)response->user_data;
         int gltf_buffer_index = (int)user_data->buffer_index;
-        create_sg_buffers_for_gltf_buffer(gltf_buffer_index, (sg_range){response->data.ptr, response->data.size});
+        store_gltf_buffer(gltf_buffer_index, response->data);
     }
     if (response->finished) {
         if (response->failed) {
@@ -515,11 +645,17 @@ static void gltf_parse(sfetch_range_t file_data) {
     const cgltf_result result = cgltf_parse(&options, file_data.ptr, file_data.size, &data);
     if (result == cgltf_result_success) {
         gltf_parse_buffers(data);
+        gltf_parse_meshopt_views(data);
         gltf_parse_images(data);
         gltf_parse_materials(data);
         gltf_parse_meshes(data);
         gltf_parse_nodes(data);
         cgltf_free(data);
+        // no buffer needs to be loaded, otherwise the last loaded
+        // buffer creates the sokol-gfx buffers in store_gltf_buffer()
+        if (!state.failed && (state.load.num_pending == 0)) {
+            create_sg_buffers();
+        }
     }
 }
 
@@ -556,12 +692,14 @@ static int gltf_mesh_index(const cgltf_data* gltf, const cgltf_mesh* mesh) {
 
 // parse the GLTF buffer definitions and start loading buffer blobs
 static void gltf_parse_buffers(const cgltf_data* gltf) {
-    if (gltf->buffer_views_count > SCENE_MAX_BUFFERS) {
+    if ((gltf->buffer_views_count > SCENE_MAX_BUFFER_VIEWS) || (gltf->buffers_count > SCENE_MAX_GLTF_BUFFERS)) {
         state.failed = true;
         return;
     }
 
-    // parse the buffer-view attributes
+    // parse the buffer-view attributes, the sokol-gfx buffers are allocated
+    // in gltf_parse_meshes() for the buffer views which are used as they are
+    state.creation_params.num_buffer_views = (int) gltf->buffer_views_count;
     state.scene.num_buffers = (int) gltf->buffer_views_count;
     for (int i = 0; i < state.scene.num_buffers; i++) {
         const cgltf_buffer_view* gltf_buf_view = &gltf->buffer_views[i];
@@ -574,13 +712,16 @@ static void gltf_parse_buffers(const cgltf_data* gltf) {
         } else {
             p->usage.vertex_buffer = true;
         }
-        // allocate a sokol-gfx buffer handle
-        state.scene.buffers[i] = sg_alloc_buffer();
     }
 
-    // start loading all buffers
+    // start loading all buffers, buffers without uri are EXT_meshopt_compression
+    // fallbacks (the sample doesn't support GLB files)
     for (cgltf_size i = 0; i < gltf->buffers_count; i++) {
         const cgltf_buffer* gltf_buf = &gltf->buffers[i];
+        if (!gltf_buf->uri) {
+            continue;
+        }
+        state.load.num_pending++;
         gltf_buffer_fetch_userdata_t user_data = {
             .buffer_index = i
         };
@@ -593,6 +734,94 @@ static void gltf_parse_buffers(const cgltf_data* gltf) {
     }
 }
 
+// cgltf doesn't know about EXT_meshopt_compression, so the buffer view
+// extension is picked out of the JSON with cgltf's own tokenizer
+static void gltf_parse_meshopt_view(const jsmntok_t* tokens, int i, const uint8_t* json, buffer_creation_params_t* p) {
+    const int size = tokens[i].size;
+    i++;
+    p->meshopt.compressed = true;
+    for (int k = 0; k < size; k++) {
+        const jsmntok_t* key = &tokens[i];
+        const jsmntok_t* val = &tokens[i + 1];
+        if (cgltf_json_strcmp(key, json, "buffer") == 0) {
+            p->meshopt.gltf_buffer_index = cgltf_json_to_int(val, json);
+        } else if (cgltf_json_strcmp(key, json, "byteOffset") == 0) {
+            p->meshopt.offset = cgltf_json_to_int(val, json);
+        } else if (cgltf_json_strcmp(key, json, "byteLength") == 0) {
+            p->meshopt.size = cgltf_json_to_int(val, json);
+        } else if (cgltf_json_strcmp(key, json, "byteStride") == 0) {
+            p->meshopt.stride = cgltf_json_to_int(val, json);
+        } else if (cgltf_json_strcmp(key, json, "count") == 0) {
+            p->meshopt.count = cgltf_json_to_int(val, json);
+        } else if (cgltf_json_strcmp(key, json, "mode") == 0) {
+            if (cgltf_json_strcmp(val, json, "TRIANGLES") == 0) {
+                p->meshopt.mode = MESHOPT_MODE_TRIANGLES;
+            } else if (cgltf_json_strcmp(val, json, "INDICES") == 0) {
+                p->meshopt.mode = MESHOPT_MODE_INDICES;
+            } else {
+                p->meshopt.mode = MESHOPT_MODE_ATTRIBUTES;
+            }
+        } else if (cgltf_json_strcmp(key, json, "filter") == 0) {
+            if (cgltf_json_strcmp(val, json, "OCTAHEDRAL") == 0) {
+                p->meshopt.filter = MESHPROC_FILTER_OCTAHEDRAL;
+            } else if (cgltf_json_strcmp(val, json, "QUATERNION") == 0) {
+                p->meshopt.filter = MESHPROC_FILTER_QUATERNION;
+            } else if (cgltf_json_strcmp(val, json, "EXPONENTIAL") == 0) {
+                p->meshopt.filter = MESHPROC_FILTER_EXPONENTIAL;
+            } else {
+                p->meshopt.filter = MESHPROC_FILTER_NONE;
+            }
+        }
+        i = cgltf_skip_json(tokens, i + 1);
+    }
+    // the decoded data replaces the buffer view
+    p->size = p->meshopt.count * p->meshopt.stride;
+    p->offset = 0;
+}
+
+static void gltf_parse_meshopt_views(const cgltf_data* gltf) {
+    if (state.failed) {
+        return;
+    }
+    const uint8_t* json = (const uint8_t*)gltf->json;
+    jsmn_parser parser;
+    jsmn_init(&parser);
+    const int num_tokens = jsmn_parse(&parser, gltf->json, gltf->json_size, 0, 0);
+    if (num_tokens <= 0) {
+        return;
+    }
+    jsmntok_t* tokens = (jsmntok_t*)calloc((size_t)num_tokens + 1, sizeof(jsmntok_t));
+    jsmn_init(&parser);
+    jsmn_parse(&parser, gltf->json, gltf->json_size, tokens, (size_t)num_tokens);
+
+    // root.bufferViews[].extensions.EXT_meshopt_compression
+    int i = 1;
+    for (int k = 0; (k < tokens[0].size) && (i > 0); k++) {
+        if ((cgltf_json_strcmp(&tokens[i], json, "bufferViews") == 0) && (tokens[i + 1].type == JSMN_ARRAY)) {
+            const int num_views = tokens[i + 1].size;
+            int view = i + 2;
+            for (int view_index = 0; (view_index < num_views) && (view_index < state.creation_params.num_buffer_views); view_index++) {
+                int j = view + 1;
+                for (int m = 0; (m < tokens[view].size) && (j > 0); m++) {
+                    if ((cgltf_json_strcmp(&tokens[j], json, "extensions") == 0) && (tokens[j + 1].type == JSMN_OBJECT)) {
+                        int e = j + 2;
+                        for (int n = 0; (n < tokens[j + 1].size) && (e > 0); n++) {
+                            if ((cgltf_json_strcmp(&tokens[e], json, "EXT_meshopt_compression") == 0) && (tokens[e + 1].type == JSMN_OBJECT)) {
+                                gltf_parse_meshopt_view(tokens, e + 1, json, &state.creation_params.buffers[view_index]);
+                            }
+                            e = cgltf_skip_json(tokens, e + 1);
+                        }
+                    }
+                    j = cgltf_skip_json(tokens, j + 1);
+                }
+                view = cgltf_skip_json(tokens, view);
+            }
+        }
+        i = cgltf_skip_json(tokens, i + 1);
+    }
+    free(tokens);
+}
+
 // parse all the image-related stuff in the GLTF data
 
 // https://github.com/KhronosGroup/glTF/tree/master/specification/2.0#samplerminfilter
@@ -728,6 +957,68 @@ static void gltf_parse_materials(const cgltf_data* gltf) {
     }
 }
 
+// buffer views which are used as they are need a sokol-gfx buffer
+static void use_buffer_view(int buffer_view_index) {
+    buffer_creation_params_t* p = &state.creation_params.buffers[buffer_view_index];
+    if (!p->used) {
+        p->used = true;
+        state.scene.buffers[buffer_view_index] = sg_alloc_buffer();
+    }
+}
+
+// sokol-gfx buffers for processed primitives go after the buffer views
+static int alloc_processed_buffer(void) {
+    assert(state.scene.num_buffers < SCENE_MAX_BUFFERS);
+    const int index = state.scene.num_buffers++;
+    state.scene.buffers[index] = sg_alloc_buffer();
+    return index;
+}
+
+static accessor_creation_params_t gltf_to_accessor_creation_params(const cgltf_data* gltf, const cgltf_accessor* acc) {
+    accessor_creation_params_t p = { .buffer_view = SCENE_INVALID_INDEX };
+    if (acc && acc->buffer_view) {
+        p.buffer_view = gltf_bufferview_index(gltf, acc->buffer_view);
+        p.offset = (int) acc->offset;
+        p.stride = (int) acc->stride;
+        p.count = (int) acc->count;
+        p.num_components = (int) cgltf_num_components(acc->type);
+        p.component_type = acc->component_type;
+        p.normalized = acc->normalized;
+    }
+    return p;
+}
+
+// only triangle lists with the metallic-roughness material, and without sparse accessors
+static primitive_creation_params_t gltf_to_primitive_creation_params(const cgltf_data* gltf, const cgltf_primitive* prim) {
+    primitive_creation_params_t p = { 0 };
+    const cgltf_accessor* position = 0;
+    const cgltf_accessor* normal = 0;
+    const cgltf_accessor* texcoord = 0;
+    bool has_sparse = prim->indices && prim->indices->is_sparse;
+    for (cgltf_size attr_index = 0; attr_index < prim->attributes_count; attr_index++) {
+        const cgltf_attribute* attr = &prim->attributes[attr_index];
+        has_sparse |= attr->data->is_sparse;
+        switch (attr->type) {
+            case cgltf_attribute_type_position: position = attr->data; break;
+            case cgltf_attribute_type_normal: normal = attr->data; break;
+            case cgltf_attribute_type_texcoord: if (attr->index == 0) { texcoord = attr->data; } break;
+            default: break;
+        }
+    }
+    p.position = gltf_to_accessor_creation_params(gltf, position);
+    p.normal = gltf_to_accessor_creation_params(gltf, normal);
+    p.texcoord = gltf_to_accessor_creation_params(gltf, texcoord);
+    p.indices = gltf_to_accessor_creation_params(gltf, prim->indices);
+    p.process = process_meshes &&
+        (prim->type == cgltf_primitive_type_triangles) &&
+        prim->material && prim->material->has_pbr_metallic_roughness &&
+        (p.position.buffer_view != SCENE_INVALID_INDEX) &&
+        (p.position.count > 0) &&
+        (!prim->indices || (p.indices.buffer_view != SCENE_INVALID_INDEX)) &&
+        !has_sparse;
+    return p;
+}
+
 // parse GLTF meshes into our own mesh and submesh definition
 static void gltf_parse_meshes(const cgltf_data* gltf) {
     if (gltf->meshes_count > SCENE_MAX_MESHES) {
@@ -746,19 +1037,40 @@ static void gltf_parse_meshes(const cgltf_data* gltf) {
         mesh->num_primitives = (int) gltf_mesh->primitives_count;
         for (cgltf_size prim_index = 0; prim_index < gltf_mesh->primitives_count; prim_index++) {
             const cgltf_primitive* gltf_prim = &gltf_mesh->primitives[prim_index];
-            primitive_t* prim = &state.scene.primitives[state.scene.num_primitives++];
+            const int scene_prim_index = state.scene.num_primitives++;
+            primitive_t* prim = &state.scene.primitives[scene_prim_index];
+            primitive_creation_params_t* cp = &state.creation_params.primitives[scene_prim_index];
+            *cp = gltf_to_primitive_creation_params(gltf, gltf_prim);
+            prim->dequant = mat44_identity();
+            // the material parameters
+            prim->material = gltf_material_index(gltf, gltf_prim->material);
+            if (cp->process) {
+                // one interleaved vertex buffer and an index buffer, filled
+                // in process_primitive() once all buffer data has been loaded
+                prim->vertex_buffers = (vertex_buffer_mapping_t){ .num = 1, .buffer[0] = alloc_processed_buffer() };
+                for (int i = 1; i < SG_MAX_VERTEXBUFFER_BINDSLOTS; i++) {
+                    prim->vertex_buffers.buffer[i] = SCENE_INVALID_INDEX;
+                }
+                prim->index_buffer = alloc_processed_buffer();
+                prim->base_element = 0;
+                prim->num_elements = gltf_prim->indices ? cp->indices.count : cp->position.count;
+                prim->pipeline = create_sg_pipeline_for_gltf_primitive(gltf, gltf_prim, &prim->vertex_buffers, cp);
+                continue;
+            }
 
             // a mapping from sokol-gfx vertex buffer bind slots into the scene.buffers array
             prim->vertex_buffers = create_vertex_buffer_mapping_for_gltf_primitive(gltf, gltf_prim);
+            for (int i = 0; i < prim->vertex_buffers.num; i++) {
+                use_buffer_view(prim->vertex_buffers.buffer[i]);
+            }
             // create or reuse a matching pipeline state object
-            prim->pipeline = create_sg_pipeline_for_gltf_primitive(gltf, gltf_prim, &prim->vertex_buffers);
-            // the material parameters
-            prim->material = gltf_material_index(gltf, gltf_prim->material);
+            prim->pipeline = create_sg_pipeline_for_gltf_primitive(gltf, gltf_prim, &prim->vertex_buffers, 0);
             // index buffer, base element, num elements
             if (gltf_prim->indices) {
                 prim->index_buffer = gltf_bufferview_index(gltf, gltf_prim->indices->buffer_view);
                 assert(state.creation_params.buffers[prim->index_buffer].usage.index_buffer);
                 assert(gltf_prim->indices->stride != 0);
+                use_buffer_view(prim->index_buffer);
                 prim->base_element = 0;
                 prim->num_elements = (int) gltf_prim->indices->count;
             } else {
@@ -772,38 +1084,343 @@ static void gltf_parse_meshes(const cgltf_data* gltf) {
     }
 }
 
-// parse GLTF nodes into our own node definition
+// parse GLTF nodes into our own node and light definitions
 static void gltf_parse_nodes(const cgltf_data* gltf) {
-    if (gltf->nodes_count > SCENE_MAX_NODES) {
-        state.failed = true;
-        return;
-    }
     for (cgltf_size node_index = 0; node_index < gltf->nodes_count; node_index++) {
         const cgltf_node* gltf_node = &gltf->nodes[node_index];
-        // ignore nodes without mesh, those are not relevant since we
+        // ignore nodes without mesh or light, those are not relevant since we
         // bake the transform hierarchy into per-node world space transforms
         if (gltf_node->mesh) {
+            if (state.scene.num_nodes == SCENE_MAX_NODES) {
+                state.failed = true;
+                return;
+            }
             node_t* node = &state.scene.nodes[state.scene.num_nodes++];
             node->mesh = gltf_mesh_index(gltf, gltf_node->mesh);
             node->transform = build_transform_for_gltf_node(gltf, gltf_node);
         }
+        // lights beyond SCENE_MAX_LIGHTS are ignored
+        if (gltf_node->light && (state.scene.num_lights < SCENE_MAX_LIGHTS)) {
+            gltf_parse_light(gltf, gltf_node);
+        }
     }
 }
 
-// create the sokol-gfx buffer objects associated with a GLTF buffer view
-static void create_sg_buffers_for_gltf_buffer(int gltf_buffer_index, sg_range data) {
-    for (int i = 0; i < state.scene.num_buffers; i++) {
+// parse a KHR_lights_punctual light attached to a node
+static void gltf_parse_light(const cgltf_data* gltf, const cgltf_node* gltf_node) {
+    const cgltf_light* src = gltf_node->light;
+    const mat44_t tform = build_transform_for_gltf_node(gltf, gltf_node);
+    const vec4_t pos = vec4_transform(vec4(0.0f, 0.0f, 0.0f, 1.0f), tform);
+    // lights point down the node's -Z axis
+    const vec4_t dir = vec4_transform(vec4(0.0f, 0.0f, -1.0f, 0.0f), tform);
+    light_t* dst = &state.scene.lights[state.scene.num_lights++];
+    dst->type = src->type;
+    dst->pos = vec3(pos.x, pos.y, pos.z);
+    dst->dir = vm_normalize(vec3(dir.x, dir.y, dir.z));
+    dst->color = vec3(src->color[0] * src->intensity, src->color[1] * src->intensity, src->color[2] * src->intensity);
+    dst->range = src->range;
+    if (dst->range <= 0.0f) {
+        // an infinite range needs a finite cutoff to be clustered
+        const float max_color = fmaxf(dst->color.x, fmaxf(dst->color.y, dst->color.z));
+        dst->range = sqrtf(max_color / LIGHT_CUTOFF);
+    }
+    if (src->type == cgltf_light_type_spot) {
+        const float cos_outer = cosf(src->spot_outer_cone_angle);
+        dst->spot_scale = 1.0f / fmaxf(0.001f, cosf(src->spot_inner_cone_angle) - cos_outer);
+        dst->spot_offset = -cos_outer * dst->spot_scale;
+    } else {
+        dst->spot_scale = 0.0f;
+        dst->spot_offset = 1.0f;
+    }
+}
+
+// keep a loaded GLTF buffer around until all buffers have been loaded
+static void store_gltf_buffer(int gltf_buffer_index, sfetch_range_t data) {
+    assert((gltf_buffer_index >= 0) && (gltf_buffer_index < SCENE_MAX_GLTF_BUFFERS));
+    state.load.data[gltf_buffer_index] = (uint8_t*) malloc(data.size);
+    memcpy(state.load.data[gltf_buffer_index], data.ptr, data.size);
+    state.load.size[gltf_buffer_index] = data.size;
+    if (--state.load.num_pending == 0) {
+        create_sg_buffers();
+    }
+}
+
+// returns the content of a buffer view, EXT_meshopt_compression views
+// are decoded on first use; returns 0 if the data is out of range or malformed
+static const uint8_t* buffer_view_data(int buffer_view_index) {
+    const buffer_creation_params_t* p = &state.creation_params.buffers[buffer_view_index];
+    if (!p->meshopt.compressed) {
+        const int b = p->gltf_buffer_index;
+        if (!state.load.data[b] || ((size_t)(p->offset + p->size) > state.load.size[b])) {
+            return 0;
+        }
+        return state.load.data[b] + p->offset;
+    }
+    if (!state.load.decoded[buffer_view_index]) {
+        const int b = p->meshopt.gltf_buffer_index;
+        if ((b < 0) || (b >= SCENE_MAX_GLTF_BUFFERS) || !state.load.data[b] ||
+            ((size_t)(p->meshopt.offset + p->meshopt.size) > state.load.size[b]) ||
+            (p->meshopt.count <= 0) || (p->meshopt.stride <= 0))
+        {
+            return 0;
+        }
+        const uint32_t count = (uint32_t) p->meshopt.count;
+        const uint32_t stride = (uint32_t) p->meshopt.stride;
+        const uint8_t* src = state.load.data[b] + p->meshopt.offset;
+        const size_t src_size = (size_t) p->meshopt.size;
+        uint8_t* dst = (uint8_t*) malloc(count * stride);
+        bool ok = false;
+        switch (p->meshopt.mode) {
+            case MESHOPT_MODE_ATTRIBUTES:
+                ok = meshproc_decode_vertex_buffer(dst, count, stride, src, src_size) &&
+                     meshproc_decode_filter(p->meshopt.filter, dst, count, stride);
+                break;
+            case MESHOPT_MODE_TRIANGLES:
+                ok = meshproc_decode_index_buffer(dst, count, stride, src, src_size);
+                break;
+            case MESHOPT_MODE_INDICES:
+                ok = meshproc_decode_index_sequence(dst, count, stride, src, src_size);
+                break;
+        }
+        if (!ok) {
+            free(dst);
+            return 0;
+        }
+        state.load.decoded[buffer_view_index] = dst;
+    }
+    return state.load.decoded[buffer_view_index];
+}
+
+// returns a pointer to the first element of an accessor, or 0 if out of range
+static const uint8_t* accessor_data(const accessor_creation_params_t* acc) {
+    if ((acc->buffer_view == SCENE_INVALID_INDEX) || (acc->count <= 0)) {
+        return 0;
+    }
+    const int elem_size = acc->num_components * (int) cgltf_component_size(acc->component_type);
+    const int end = acc->offset + acc->stride * (acc->count - 1) + elem_size;
+    if (end > state.creation_params.buffers[acc->buffer_view].size) {
+        return 0;
+    }
+    const uint8_t* data = buffer_view_data(acc->buffer_view);
+    return data ? (data + acc->offset) : 0;
+}
+
+static size_t accessor_size(const accessor_creation_params_t* acc) {
+    if (acc->buffer_view == SCENE_INVALID_INDEX) {
+        return 0;
+    }
+    return (size_t)acc->count * (size_t)acc->num_components * cgltf_component_size(acc->component_type);
+}
+
+// read an accessor element as floats, with the KHR_mesh_quantization rules
+// for normalized integers, missing components are set to 0
+static void read_accessor(const accessor_creation_params_t* acc, const uint8_t* data, uint32_t index, float* out, int num) {
+    const uint8_t* ptr = data + (size_t)acc->stride * index;
+    for (int i = 0; i < num; i++) {
+        if (i >= acc->num_components) {
+            out[i] = 0.0f;
+            continue;
+        }
+        switch (acc->component_type) {
+            case cgltf_component_type_r_8: {
+                const int8_t v = ((const int8_t*)ptr)[i];
+                out[i] = acc->normalized ? fmaxf((float)v / 127.0f, -1.0f) : (float)v;
+            } break;
+            case cgltf_component_type_r_8u: {
+                const uint8_t v = ptr[i];
+                out[i] = acc->normalized ? ((float)v / 255.0f) : (float)v;
+            } break;
+            case cgltf_component_type_r_16: {
+                int16_t v;
+                memcpy(&v, ptr + i * 2, sizeof(v));
+                out[i] = acc->normalized ? fmaxf((float)v / 32767.0f, -1.0f) : (float)v;
+            } break;
+            case cgltf_component_type_r_16u: {
+                uint16_t v;
+                memcpy(&v, ptr + i * 2, sizeof(v));
+                out[i] = acc->normalized ? ((float)v / 65535.0f) : (float)v;
+            } break;
+            case cgltf_component_type_r_32u: {
+                uint32_t v;
+                memcpy(&v, ptr + i * 4, sizeof(v));
+                out[i] = (float)v;
+            } break;
+            case cgltf_component_type_r_32f:
+                memcpy(&out[i], ptr + i * 4, sizeof(float));
+                break;
+            default:
+                out[i] = 0.0f;
+                break;
+        }
+    }
+}
+
+static uint32_t read_index(const accessor_creation_params_t* acc, const uint8_t* data, uint32_t index) {
+    const uint8_t* ptr = data + (size_t)acc->stride * index;
+    switch (acc->component_type) {
+        case cgltf_component_type_r_8u:
+            return *ptr;
+        case cgltf_component_type_r_16u: {
+            uint16_t v;
+            memcpy(&v, ptr, sizeof(v));
+            return v;
+        }
+        default: {
+            uint32_t v;
+            memcpy(&v, ptr, sizeof(v));
+            return v;
+        }
+    }
+}
+
+// processed primitives have 16-bit indices if possible
+static sg_index_type processed_index_type(const primitive_creation_params_t* cp) {
+    return (cp->position.count <= 0xFFFF) ? SG_INDEXTYPE_UINT16 : SG_INDEXTYPE_UINT32;
+}
+
+// reorder and quantize a primitive and create its vertex and index buffer
+static void process_primitive(int prim_index) {
+    const primitive_creation_params_t* cp = &state.creation_params.primitives[prim_index];
+    primitive_t* prim = &state.scene.primitives[prim_index];
+    const bool indexed = cp->indices.buffer_view != SCENE_INVALID_INDEX;
+    const uint8_t* pos_data = accessor_data(&cp->position);
+    const uint8_t* nrm_data = accessor_data(&cp->normal);
+    const uint8_t* uv_data = accessor_data(&cp->texcoord);
+    const uint8_t* idx_data = indexed ? accessor_data(&cp->indices) : 0;
+    if (!pos_data || (indexed && !idx_data)) {
+        state.failed = true;
+        return;
+    }
+    const uint32_t num_vertices = (uint32_t) cp->position.count;
+    uint32_t num_indices = indexed ? (uint32_t) cp->indices.count : num_vertices;
+    num_indices -= num_indices % 3;
+    if (num_indices == 0) {
+        state.failed = true;
+        return;
+    }
+
+    // non-indexed primitives get sequential indices, the vertices are not deduplicated
+    uint32_t* indices = (uint32_t*) malloc(num_indices * sizeof(uint32_t));
+    for (uint32_t i = 0; i < num_indices; i++) {
+        indices[i] = indexed ? read_index(&cp->indices, idx_data, i) : i;
+        if (indices[i] >= num_vertices) {
+            free(indices);
+            state.failed = true;
+            return;
+        }
+    }
+    float* positions = (float*) malloc(num_vertices * 3 * sizeof(float));
+    vec3_t bb_min = vec3(FLT_MAX, FLT_MAX, FLT_MAX);
+    vec3_t bb_max = vec3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+    for (uint32_t i = 0; i < num_vertices; i++) {
+        float* p = &positions[i * 3];
+        read_accessor(&cp->position, pos_data, i, p, 3);
+        bb_min = vec3(fminf(bb_min.x, p[0]), fminf(bb_min.y, p[1]), fminf(bb_min.z, p[2]));
+        bb_max = vec3(fmaxf(bb_max.x, p[0]), fmaxf(bb_max.y, p[1]), fmaxf(bb_max.z, p[2]));
+    }
+
+    // triangle order for the vertex cache and against overdraw, then the vertex order
+    const float acmr_before = meshproc_acmr(indices, num_indices, num_vertices);
+    meshproc_optimize_vertex_cache(indices, num_indices, num_vertices);
+    meshproc_optimize_overdraw(indices, num_indices, positions, num_vertices, 3 * sizeof(float), 1.05f);
+    uint32_t* remap = (uint32_t*) malloc(num_vertices * sizeof(uint32_t));
+    const uint32_t num_used = meshproc_optimize_vertex_fetch(remap, indices, num_indices, num_vertices);
+    const float acmr_after = meshproc_acmr(indices, num_indices, num_vertices);
+
+    // quantize the vertices into their new place
+    const vec3_t center = vm_mul(vm_add(bb_min, bb_max), 0.5f);
+    const vec3_t ext = vec3(
+        fmaxf((bb_max.x - bb_min.x) * 0.5f, 1e-6f),
+        fmaxf((bb_max.y - bb_min.y) * 0.5f, 1e-6f),
+        fmaxf((bb_max.z - bb_min.z) * 0.5f, 1e-6f));
+    quantized_vertex_t* vertices = (quantized_vertex_t*) calloc(num_vertices, sizeof(quantized_vertex_t));
+    for (uint32_t i = 0; i < num_vertices; i++) {
+        quantized_vertex_t* v = &vertices[remap[i]];
+        const float* p = &positions[i * 3];
+        v->pos[0] = meshproc_snorm16((p[0] - center.x) / ext.x);
+        v->pos[1] = meshproc_snorm16((p[1] - center.y) / ext.y);
+        v->pos[2] = meshproc_snorm16((p[2] - center.z) / ext.z);
+        v->pos[3] = 32767;
+        float n[3] = { 0.0f, 0.0f, 1.0f };
+        if (nrm_data && (i < (uint32_t)cp->normal.count)) {
+            read_accessor(&cp->normal, nrm_data, i, n, 3);
+        }
+        meshproc_oct_encode(n, v->normal);
+        float uv[2] = { 0.0f, 0.0f };
+        if (uv_data && (i < (uint32_t)cp->texcoord.count)) {
+            read_accessor(&cp->texcoord, uv_data, i, uv, 2);
+        }
+        v->uv[0] = meshproc_half(uv[0]);
+        v->uv[1] = meshproc_half(uv[1]);
+    }
+    prim->dequant = vm_mul(mat44_scaling(ext.x, ext.y, ext.z), mat44_translation(center.x, center.y, center.z));
+    prim->num_elements = (int) num_indices;
+
+    // the unreferenced vertices are at the end and are dropped
+    const size_t vertex_size = num_used * sizeof(quantized_vertex_t);
+    sg_init_buffer(state.scene.buffers[prim->vertex_buffers.buffer[0]], &(sg_buffer_desc){
+        .usage.vertex_buffer = true,
+        .data = { .ptr = vertices, .size = vertex_size },
+    });
+    size_t index_size = num_indices * sizeof(uint32_t);
+    if (processed_index_type(cp) == SG_INDEXTYPE_UINT16) {
+        // compact in place, front to back
+        uint16_t* indices16 = (uint16_t*) indices;
+        for (uint32_t i = 0; i < num_indices; i++) {
+            indices16[i] = (uint16_t) indices[i];
+        }
+        index_size = num_indices * sizeof(uint16_t);
+    }
+    sg_init_buffer(state.scene.buffers[prim->index_buffer], &(sg_buffer_desc){
+        .usage.index_buffer = true,
+        .data = { .ptr = indices, .size = index_size },
+    });
+
+    const uint32_t num_tris = num_indices / 3;
+    const float total_tris = (float)(state.mesh_stats.num_tris + num_tris);
+    state.mesh_stats.acmr_before = (state.mesh_stats.acmr_before * (float)state.mesh_stats.num_tris + acmr_before * (float)num_tris) / total_tris;
+    state.mesh_stats.acmr_after = (state.mesh_stats.acmr_after * (float)state.mesh_stats.num_tris + acmr_after * (float)num_tris) / total_tris;
+    state.mesh_stats.num_tris += num_tris;
+    state.mesh_stats.bytes_before += accessor_size(&cp->position) + accessor_size(&cp->normal) + accessor_size(&cp->texcoord) + accessor_size(&cp->indices);
+    state.mesh_stats.bytes_after += vertex_size + index_size;
+    state.mesh_stats.num_processed++;
+
+    free(vertices);
+    free(remap);
+    free(positions);
+    free(indices);
+}
+
+// create all sokol-gfx buffers once all GLTF buffers have been loaded
+static void create_sg_buffers(void) {
+    // buffer views used as they are by unprocessed primitives
+    for (int i = 0; i < state.creation_params.num_buffer_views; i++) {
         const buffer_creation_params_t* p = &state.creation_params.buffers[i];
-        if (p->gltf_buffer_index == gltf_buffer_index) {
-            assert((size_t)(p->offset + p->size) <= data.size);
-            sg_init_buffer(state.scene.buffers[i], &(sg_buffer_desc){
-                .usage = p->usage,
-                .data = {
-                    .ptr = (const uint8_t*)data.ptr + p->offset,
-                    .size = (size_t)p->size,
-                }
-            });
+        if (!p->used) {
+            continue;
         }
+        const uint8_t* data = buffer_view_data(i);
+        if (!data) {
+            state.failed = true;
+            continue;
+        }
+        sg_init_buffer(state.scene.buffers[i], &(sg_buffer_desc){
+            .usage = p->usage,
+            .data = { .ptr = data, .size = (size_t)p->size },
+        });
+    }
+    for (int i = 0; i < state.scene.num_primitives; i++) {
+        if (state.creation_params.primitives[i].process) {
+            process_primitive(i);
+        }
+    }
+    for (int i = 0; i < SCENE_MAX_GLTF_BUFFERS; i++) {
+        free(state.load.data[i]);
+        state.load.data[i] = 0;
+    }
+    for (int i = 0; i < SCENE_MAX_BUFFER_VIEWS; i++) {
+        free(state.load.decoded[i]);
+        state.load.decoded[i] = 0;
     }
 }
 
@@ -933,6 +1550,16 @@ static sg_vertex_layout_state create_sg_layout_for_gltf_primitive(const cgltf_da
     return layout;
 }
 
+// the vertex layout of processed primitives, see quantized_vertex_t
+static sg_vertex_layout_state quantized_vertex_layout(void) {
+    sg_vertex_layout_state layout = { 0 };
+    layout.buffers[0].stride = sizeof(quantized_vertex_t);
+    layout.attrs[ATTR_cgltf_metallic_quantized_position] = (sg_vertex_attr_state){ .offset = offsetof(quantized_vertex_t, pos), .format = SG_VERTEXFORMAT_SHORT4N };
+    layout.attrs[ATTR_cgltf_metallic_quantized_normal] = (sg_vertex_attr_state){ .offset = offsetof(quantized_vertex_t, normal), .format = SG_VERTEXFORMAT_SHORT2N };
+    layout.attrs[ATTR_cgltf_metallic_quantized_texcoord] = (sg_vertex_attr_state){ .offset = offsetof(quantized_vertex_t, uv), .format = SG_VERTEXFORMAT_HALF2 };
+    return layout;
+}
+
 // helper to compare to pipeline-cache items
 static bool pipelines_equal(const pipeline_cache_params_t* p0, const pipeline_cache_params_t* p1) {
     if (p0->prim_type != p1->prim_type) {
@@ -944,6 +1571,9 @@ static bool pipelines_equal(const pipeline_cache_params_t* p0, const pipeline_ca
     if (p0->index_type != p1->index_type) {
         return false;
     }
+    if (p0->quantized != p1->quantized) {
+        return false;
+    }
     for (int i = 0; i < SG_MAX_VERTEX_ATTRIBUTES; i++) {
         const sg_vertex_attr_state* a0 = &p0->layout.attrs[i];
         const sg_vertex_attr_state* a1 = &p1->layout.attrs[i];
@@ -960,12 +1590,13 @@ static bool pipelines_equal(const pipeline_cache_params_t* p0, const pipeline_ca
 // Create a unique sokol-gfx pipeline object for GLTF primitive (aka submesh),
 // maintains a cache of shared, unique pipeline objects. Returns an index
 // into state.scene.pipelines
-static int create_sg_pipeline_for_gltf_primitive(const cgltf_data* gltf, const cgltf_primitive* prim, const vertex_buffer_mapping_t* vbuf_map) {
+static int create_sg_pipeline_for_gltf_primitive(const cgltf_data* gltf, const cgltf_primitive* prim, const vertex_buffer_mapping_t* vbuf_map, const primitive_creation_params_t* processed) {
     pipeline_cache_params_t pip_params = {
-        .layout = create_sg_layout_for_gltf_primitive(gltf, prim, vbuf_map),
+        .layout = processed ? quantized_vertex_layout() : create_sg_layout_for_gltf_primitive(gltf, prim, vbuf_map),
         .prim_type = gltf_to_prim_type(prim->type),
-        .index_type = gltf_to_index_type(prim),
-        .alpha = prim->material->alpha_mode != cgltf_alpha_mode_opaque
+        .index_type = processed ? processed_index_type(processed) : gltf_to_index_type(prim),
+        .alpha = prim->material->alpha_mode != cgltf_alpha_mode_opaque,
+        .quantized = processed != 0,
     };
     int i = 0;
     for (; i < state.scene.num_pipelines; i++) {
@@ -980,7 +1611,7 @@ static int create_sg_pipeline_for_gltf_primitive(const cgltf_data* gltf, const c
         const bool is_metallic = prim->material->has_pbr_metallic_roughness;
         state.scene.pipelines[i] = sg_make_pipeline(&(sg_pipeline_desc){
             .layout = pip_params.layout,
-            .shader = is_metallic ? state.shaders.metallic : state.shaders.specular,
+            .shader = !is_metallic ? state.shaders.specular : (pip_params.quantized ? state.shaders.metallic_quantized : state.shaders.metallic),
             .primitive_type = pip_params.prim_type,
             .index_type = pip_params.index_type,
             .cull_mode = SG_CULLMODE_BACK,
@@ -1033,6 +1664,135 @@ static mat44_t build_transform_for_gltf_node(const cgltf_data* gltf, const cgltf
 
 static void update_scene(void) {
     state.root_transform = mat44_rotation_y(vm_radians(state.rx));
+    state.time += sapp_frame_duration();
+}
+
+static uint32_t xorshift32(void) {
+    static uint32_t x = 0x12345678;
+    x ^= x<<13;
+    x ^= x>>17;
+    x ^= x<<5;
+    return x;
+}
+
+static float rnd(float min_val, float max_val) {
+    return min_val + (max_val - min_val) * ((float)(xorshift32() & 0xFFFF) / (float)0xFFFF);
+}
+
+// create the light data textures and the demo light parameters
+static void init_lights(void) {
+    state.lights.light_img = sg_make_image(&(sg_image_desc){
+        .width = 3,
+        .height = LGRID_MAX_LIGHTS,
+        .pixel_format = SG_PIXELFORMAT_RGBA32F,
+        .usage.stream_update = true,
+        .label = "light-data",
+    });
+    state.lights.cluster_img = sg_make_image(&(sg_image_desc){
+        .width = LGRID_DIM_X * LGRID_DIM_Y,
+        .height = LGRID_DIM_Z,
+        .pixel_format = SG_PIXELFORMAT_R32UI,
+        .usage.stream_update = true,
+        .label = "light-clusters",
+    });
+    state.lights.index_img = sg_make_image(&(sg_image_desc){
+        .width = LGRID_INDEX_ROW,
+        .height = LGRID_MAX_INDICES / LGRID_INDEX_ROW,
+        .pixel_format = SG_PIXELFORMAT_R32UI,
+        .usage.stream_update = true,
+        .label = "light-indices",
+    });
+    state.lights.light_tex = sg_make_view(&(sg_view_desc){ .texture.image = state.lights.light_img });
+    state.lights.cluster_tex = sg_make_view(&(sg_view_desc){ .texture.image = state.lights.cluster_img });
+    state.lights.index_tex = sg_make_view(&(sg_view_desc){ .texture.image = state.lights.index_img });
+    state.lights.smp = sg_make_sampler(&(sg_sampler_desc){
+        .min_filter = SG_FILTER_NEAREST,
+        .mag_filter = SG_FILTER_NEAREST,
+        .wrap_u = SG_WRAP_CLAMP_TO_EDGE,
+        .wrap_v = SG_WRAP_CLAMP_TO_EDGE,
+        .label = "light-sampler",
+    });
+    state.lights.num_demo = 128;
+
+    // small colored point lights orbiting the model
+    for (int i = 0; i < MAX_DEMO_LIGHTS; i++) {
+        const float intensity = 0.25f;
+        state.demo.lights[i] = (light_t){
+            .type = cgltf_light_type_point,
+            .color = vec3(rnd(0.2f, 1.0f) * intensity, rnd(0.2f, 1.0f) * intensity, rnd(0.2f, 1.0f) * intensity),
+            .range = 0.5f,
+            .spot_offset = 1.0f,
+        };
+        state.demo.radius[i] = rnd(0.6f, 1.5f);
+        state.demo.height[i] = rnd(-1.0f, 1.0f);
+        state.demo.speed[i] = rnd(-1.0f, 1.0f);
+        state.demo.phase[i] = rnd(0.0f, 6.2831853f);
+    }
+}
+
+static void write_light(int index, const light_t* l, const mat44_t* tform) {
+    const vec4_t pos = vec4_transform(vec4(l->pos.x, l->pos.y, l->pos.z, 1.0f), *tform);
+    const vec4_t dir = vec4_transform(vec4(l->dir.x, l->dir.y, l->dir.z, 0.0f), *tform);
+    vec4_t* dst = state.lights.light_data[index];
+    dst[0] = vec4(pos.x, pos.y, pos.z, l->range);
+    dst[1] = vec4(l->color.x, l->color.y, l->color.z, l->spot_offset);
+    dst[2] = vec4(dir.x, dir.y, dir.z, l->spot_scale);
+    if (l->type != cgltf_light_type_directional) {
+        lgrid_light_t* sphere = &state.lights.spheres[state.lights.num_clustered++];
+        sphere->pos = vec3(pos.x, pos.y, pos.z);
+        sphere->radius = l->range;
+    }
+}
+
+// gather all lights, bin them into clusters and upload the light textures
+static void update_lights(void) {
+    const uint64_t start = stm_now();
+
+    // the directional lights go first and are applied to all fragments
+    state.lights.num_global = 0;
+    state.lights.num_clustered = 0;
+    for (int i = 0; i < state.scene.num_lights; i++) {
+        const light_t* l = &state.scene.lights[i];
+        if (l->type == cgltf_light_type_directional) {
+            write_light(state.lights.num_global++, l, &state.root_transform);
+        }
+    }
+    int n = state.lights.num_global;
+    const mat44_t identity = mat44_identity();
+    write_light(n++, &state.point_light, &identity);
+    for (int i = 0; (i < state.scene.num_lights) && (n < LGRID_MAX_LIGHTS); i++) {
+        const light_t* l = &state.scene.lights[i];
+        if (l->type != cgltf_light_type_directional) {
+            write_light(n++, l, &state.root_transform);
+        }
+    }
+    const float t = (float)state.time;
+    for (int i = 0; (i < state.lights.num_demo) && (n < LGRID_MAX_LIGHTS); i++) {
+        const float a = state.demo.phase[i] + t * state.demo.speed[i];
+        light_t* l = &state.demo.lights[i];
+        l->pos = vec3(vm_cos(a) * state.demo.radius[i], state.demo.height[i], vm_sin(a) * state.demo.radius[i]);
+        write_light(n++, l, &identity);
+    }
+
+    lgrid_build(&state.lights.grid, &(lgrid_view_t){
+        .view = state.camera.view,
+        .fov = state.camera.fov,
+        .aspect = sapp_widthf() / sapp_heightf(),
+        .nearz = state.camera.nearz,
+        .farz = state.camera.farz,
+    }, state.lights.spheres, state.lights.num_clustered, state.lights.num_global);
+    state.lights.build_ms = stm_ms(stm_since(start));
+
+    sg_update_image(state.lights.light_img, &(sg_image_data){ .subimage[0][0] = SG_RANGE(state.lights.light_data) });
+    sg_update_image(state.lights.cluster_img, &(sg_image_data){ .subimage[0][0] = SG_RANGE(state.lights.grid.clusters) });
+    sg_update_image(state.lights.index_img, &(sg_image_data){ .subimage[0][0] = SG_RANGE(state.lights.grid.indices) });
+
+    state.lights.params = (cgltf_light_params_t){
+        .view_matrix = state.camera.view,
+        .grid_params = state.lights.grid.shader_params,
+        .num_global_lights = state.lights.num_global,
+        .show_clusters = state.lights.show_clusters ? 1 : 0,
+    };
 }
 
 static cgltf_vs_params_t vs_params_for_node(int node_index) {
@@ -1043,6 +1803,218 @@ static cgltf_vs_params_t vs_params_for_node(int node_index) {
     };
 }
 
+/* Render queue sort keys, from the most significant bit:
+
+    opaque:      0 | pipeline:8 | material:8 | vertex buffer:8 | depth:16
+    translucent: 1 | inverted depth:16 | pipeline:8 | material:8
+
+   Opaque draws are grouped by state changes and sorted front to back
+   inside a group, translucent draws are sorted back to front.
+*/
+#define DRAW_KEY_BITS (41)
+#define DRAW_KEY_TRANSLUCENT (1ULL << 40)
+
+// the upper 16 bits of a positive float sort like the float
+static uint64_t depth_bits(float dist) {
+    uint32_t bits;
+    memcpy(&bits, &dist, sizeof(bits));
+    return (uint64_t)(bits >> 16);
+}
+
+static void build_draw_queue(void) {
+    state.queue.num_draws = 0;
+    for (int node_index = 0; node_index < state.scene.num_nodes; node_index++) {
+        const node_t* node = &state.scene.nodes[node_index];
+        const mesh_t* mesh = &state.scene.meshes[node->mesh];
+        const mat44_t model = vm_mul(node->transform, state.root_transform);
+        for (int i = 0; i < mesh->num_primitives; i++) {
+            const int prim_index = i + mesh->first_primitive;
+            const primitive_t* prim = &state.scene.primitives[prim_index];
+            draw_item_t* item = &state.queue.items[state.queue.num_draws];
+            item->node = node_index;
+            item->primitive = prim_index;
+            if (!state.queue.sort) {
+                item->key = (uint64_t)state.queue.num_draws++;
+                continue;
+            }
+            // the dequantization translation is the bounding box center of processed
+            // primitives, for all others the distance to the node origin has to do
+            const vec4_t center = vec4_transform(vec4(prim->dequant.w.x, prim->dequant.w.y, prim->dequant.w.z, 1.0f), model);
+            const float dist = vm_length(vm_sub(vec3(center.x, center.y, center.z), state.camera.eye_pos));
+            const uint64_t depth = depth_bits(dist);
+            const uint64_t pipeline = (uint64_t)(prim->pipeline & 0xFF);
+            const uint64_t material = (uint64_t)(prim->material & 0xFF);
+            if (state.pip_cache.items[prim->pipeline].alpha) {
+                item->key = DRAW_KEY_TRANSLUCENT | ((~depth & 0xFFFF) << 16) | (pipeline << 8) | material;
+            } else {
+                const uint64_t vbuf = (uint64_t)(prim->vertex_buffers.buffer[0] & 0xFF);
+                item->key = (pipeline << 32) | (material << 24) | (vbuf << 16) | depth;
+            }
+            state.queue.num_draws++;
+        }
+    }
+}
+
+// LSD radix sort with 8-bit digits, digits which are the same in all keys are skipped
+static void sort_draw_queue(void) {
+    const int num = state.queue.num_draws;
+    if (!state.queue.sort || (num < 2)) {
+        return;
+    }
+    draw_item_t* src = state.queue.items;
+    draw_item_t* dst = state.queue.tmp;
+    for (int shift = 0; shift < DRAW_KEY_BITS; shift += 8) {
+        int offsets[256] = { 0 };
+        for (int i = 0; i < num; i++) {
+            offsets[(src[i].key >> shift) & 0xFF]++;
+        }
+        if (offsets[(src[0].key >> shift) & 0xFF] == num) {
+            continue;
+        }
+        int sum = 0;
+        for (int d = 0; d < 256; d++) {
+            const int count = offsets[d];
+            offsets[d] = sum;
+            sum += count;
+        }
+        for (int i = 0; i < num; i++) {
+            dst[offsets[(src[i].key >> shift) & 0xFF]++] = src[i];
+        }
+        draw_item_t* tmp = src;
+        src = dst;
+        dst = tmp;
+    }
+    if (src != state.queue.items) {
+        memcpy(state.queue.items, src, (size_t)num * sizeof(draw_item_t));
+    }
+}
+
+// the bindings only depend on the material and the primitive's buffers
+static bool bindings_equal(const primitive_t* p0, const primitive_t* p1) {
+    if ((p0->material != p1->material) || (p0->index_buffer != p1->index_buffer) || (p0->vertex_buffers.num != p1->vertex_buffers.num)) {
+        return false;
+    }
+    for (int i = 0; i < p0->vertex_buffers.num; i++) {
+        if (p0->vertex_buffers.buffer[i] != p1->vertex_buffers.buffer[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static sg_bindings bindings_for_primitive(const primitive_t* prim) {
+    const material_t* mat = &state.scene.materials[prim->material];
+    sg_bindings bind = { 0 };
+    for (int vb_slot = 0; vb_slot < prim->vertex_buffers.num; vb_slot++) {
+        bind.vertex_buffers[vb_slot] = state.scene.buffers[prim->vertex_buffers.buffer[vb_slot]];
+    }
+    if (prim->index_buffer != SCENE_INVALID_INDEX) {
+        bind.index_buffer = state.scene.buffers[prim->index_buffer];
+    }
+    bind.views[VIEW_cgltf_light_tex] = state.lights.light_tex;
+    bind.views[VIEW_cgltf_cluster_tex] = state.lights.cluster_tex;
+    bind.views[VIEW_cgltf_light_index_tex] = state.lights.index_tex;
+    bind.samplers[SMP_cgltf_cluster_smp] = state.lights.smp;
+    if (mat->is_metallic) {
+        sg_view base_color_tex = state.scene.images[mat->metallic.images.base_color].tex_view;
+        sg_view metallic_roughness_tex = state.scene.images[mat->metallic.images.metallic_roughness].tex_view;
+        sg_view normal_tex = state.scene.images[mat->metallic.images.normal].tex_view;
+        sg_view occlusion_tex = state.scene.images[mat->metallic.images.occlusion].tex_view;
+        sg_view emissive_tex = state.scene.images[mat->metallic.images.emissive].tex_view;
+        sg_sampler base_color_smp = state.scene.images[mat->metallic.images.base_color].smp;
+        sg_sampler metallic_roughness_smp = state.scene.images[mat->metallic.images.metallic_roughness].smp;
+        sg_sampler normal_smp = state.scene.images[mat->metallic.images.normal].smp;
+        sg_sampler occlusion_smp = state.scene.images[mat->metallic.images.occlusion].smp;
+        sg_sampler emissive_smp = state.scene.images[mat->metallic.images.emissive].smp;
+
+        if (!base_color_tex.id) {
+            base_color_tex = state.placeholders.white;
+            base_color_smp = state.placeholders.smp;
+        }
+        if (!metallic_roughness_tex.id) {
+            metallic_roughness_tex = state.placeholders.white;
+            metallic_roughness_smp = state.placeholders.smp;
+        }
+        if (!normal_tex.id) {
+            normal_tex = state.placeholders.normal;
+            normal_smp = state.placeholders.smp;
+        }
+        if (!occlusion_tex.id) {
+            occlusion_tex = state.placeholders.white;
+            occlusion_smp = state.placeholders.smp;
+        }
+        if (!emissive_tex.id) {
+            emissive_tex = state.placeholders.black;
+            emissive_smp = state.placeholders.smp;
+        }
+        bind.views[VIEW_cgltf_base_color_tex] = base_color_tex;
+        bind.views[VIEW_cgltf_metallic_roughness_tex] = metallic_roughness_tex;
+        bind.views[VIEW_cgltf_normal_tex] = normal_tex;
+        bind.views[VIEW_cgltf_occlusion_tex] = occlusion_tex;
+        bind.views[VIEW_cgltf_emissive_tex] = emissive_tex;
+        bind.samplers[SMP_cgltf_base_color_smp] = base_color_smp;
+        bind.samplers[SMP_cgltf_metallic_roughness_smp] = metallic_roughness_smp;
+        bind.samplers[SMP_cgltf_normal_smp] = normal_smp;
+        bind.samplers[SMP_cgltf_occlusion_smp] = occlusion_smp;
+        bind.samplers[SMP_cgltf_emissive_smp] = emissive_smp;
+    }
+    return bind;
+}
+
+// Issue the draws in queue order. Applying a pipeline invalidates the
+// bindings and all uniform blocks in sokol-gfx, everything else is only
+// applied when it differs from the previous draw.
+static void draw_queue(void) {
+    int cur_pipeline = SCENE_INVALID_INDEX;
+    const primitive_t* cur_bindings = 0;
+    int cur_material = SCENE_INVALID_INDEX;
+    int cur_node = SCENE_INVALID_INDEX;
+    int cur_dequant = SCENE_INVALID_INDEX;
+    int num_applies = 0;
+    int num_naive = 0;
+    for (int i = 0; i < state.queue.num_draws; i++) {
+        const draw_item_t* item = &state.queue.items[i];
+        const primitive_t* prim = &state.scene.primitives[item->primitive];
+        const material_t* mat = &state.scene.materials[prim->material];
+        // pipeline, light params, bindings, vs params and material params
+        num_naive += mat->is_metallic ? 5 : 4;
+
+        if (prim->pipeline != cur_pipeline) {
+            cur_pipeline = prim->pipeline;
+            cur_bindings = 0;
+            cur_material = SCENE_INVALID_INDEX;
+            cur_node = SCENE_INVALID_INDEX;
+            sg_apply_pipeline(state.scene.pipelines[prim->pipeline]);
+            sg_apply_uniforms(UB_cgltf_light_params, &SG_RANGE(state.lights.params));
+            num_applies += 2;
+        }
+        if (!cur_bindings || !bindings_equal(cur_bindings, prim)) {
+            cur_bindings = prim;
+            const sg_bindings bind = bindings_for_primitive(prim);
+            sg_apply_bindings(&bind);
+            num_applies++;
+        }
+        if (mat->is_metallic && (prim->material != cur_material)) {
+            cur_material = prim->material;
+            sg_apply_uniforms(UB_cgltf_metallic_params, &SG_RANGE(mat->metallic.fs_params));
+            num_applies++;
+        }
+        // only processed primitives have their own dequantization matrix
+        const int dequant = state.creation_params.primitives[item->primitive].process ? item->primitive : SCENE_INVALID_INDEX;
+        if ((item->node != cur_node) || (dequant != cur_dequant)) {
+            cur_node = item->node;
+            cur_dequant = dequant;
+            cgltf_vs_params_t vs_params = vs_params_for_node(item->node);
+            vs_params.dequant = prim->dequant;
+            sg_apply_uniforms(UB_cgltf_vs_params, &SG_RANGE(vs_params));
+            num_applies++;
+        }
+        sg_draw(prim->base_element, prim->num_elements, 1);
+    }
+    state.queue.num_applies = num_applies;
+    state.queue.num_naive = num_naive;
+}
+
 sapp_desc sokol_main(int argc, char* argv[]) {
     (void)argc;
     (void)argv;
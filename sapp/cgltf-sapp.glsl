@@ -12,21 +12,26 @@
 @ctype vec4 vec4_t
 @ctype vec3 vec3_t
 
-@vs vs
+@block vs_common
 layout(binding=0) uniform vs_params {
     mat4 model;
     mat4 view_proj;
     vec3 eye_pos;
+    mat4 dequant;   // quantized positions to model space, only used by vs_quantized
 };
 
-layout(location=0) in vec4 position;
-layout(location=1) in vec3 normal;
-layout(location=2) in vec2 texcoord;
-
 out vec3 v_pos;
 out vec3 v_nrm;
 out vec2 v_uv;
 out vec3 v_eye_pos;
+@end
+
+@vs vs
+@include_block vs_common
+
+layout(location=0) in vec4 position;
+layout(location=1) in vec3 normal;
+layout(location=2) in vec2 texcoord;
 
 void main() {
     vec4 pos = model * position;
@@ -38,6 +43,33 @@ void main() {
 }
 @end
 
+// vertices processed at load time: 16-bit normalized positions relative
+// to the primitive's bounding box, octahedron-encoded normals, half UVs
+@vs vs_quantized
+@include_block vs_common
+
+layout(location=0) in vec4 position;
+layout(location=1) in vec2 normal;
+layout(location=2) in vec2 texcoord;
+
+vec3 oct_decode(vec2 e) {
+    vec3 n = vec3(e.x, e.y, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.x += (n.x >= 0.0) ? -t : t;
+    n.y += (n.y >= 0.0) ? -t : t;
+    return normalize(n);
+}
+
+void main() {
+    vec4 pos = model * (dequant * vec4(position.xyz, 1.0));
+    v_pos = pos.xyz / pos.w;
+    v_nrm = (model * vec4(oct_decode(normal), 0.0)).xyz;
+    v_uv = texcoord;
+    v_eye_pos = eye_pos;
+    gl_Position = view_proj * pos;
+}
+@end
+
 @fs metallic_fs
 
 in vec3 v_pos;
@@ -63,11 +95,14 @@ layout(binding=1) uniform metallic_params {
     float roughness_factor;
 };
 
+// clustered lighting, see util/lightgrid.h: the directional lights come
+// first in light_tex and are applied everywhere, point and spot lights
+// are found through the fragment's cluster
 layout(binding=2) uniform light_params {
-    vec3 light_pos;
-    float light_range;
-    vec3 light_color;
-    float light_intensity;
+    mat4 view_matrix;
+    vec4 grid_params;       // x: tan(fov_x/2), y: tan(fov_y/2), z: near plane, w: slices / log(far/near)
+    int num_global_lights;
+    int show_clusters;
 };
 
 layout(binding=0) uniform texture2D base_color_tex;
@@ -82,6 +117,24 @@ layout(binding=2) uniform sampler normal_smp;
 layout(binding=3) uniform sampler occlusion_smp;
 layout(binding=4) uniform sampler emissive_smp;
 
+// 3 texels per light: (pos, range), (color * intensity, spot offset), (direction, spot scale)
+@image_sample_type light_tex unfilterable_float
+layout(binding=5) uniform texture2D light_tex;
+// one texel per cluster: (offset << 12) | count
+@image_sample_type cluster_tex uint
+layout(binding=6) uniform utexture2D cluster_tex;
+@image_sample_type light_index_tex uint
+layout(binding=7) uniform utexture2D light_index_tex;
+@sampler_type cluster_smp nonfiltering
+layout(binding=5) uniform sampler cluster_smp;
+
+// must match util/lightgrid.h
+#define CLUSTER_DIM_X (16)
+#define CLUSTER_DIM_Y (8)
+#define CLUSTER_DIM_Z (24)
+#define CLUSTER_COUNT_BITS (12)
+#define LIGHT_INDEX_ROW (1024)
+
 vec3 linear_to_srgb(vec3 linear) {
     return pow(linear, vec3(1.0/2.2));
 }
@@ -205,12 +258,54 @@ float get_range_attenuation(float range, float distance) {
     return max(min(1.0 - pow(distance / range, 4.0), 1.0), 0.0) / pow(distance, 2.0);
 }
 
-vec3 apply_point_light(material_info_t material_info, vec3 normal, vec3 view) {
-    vec3 point_to_light = light_pos - v_pos;
-    float distance = length(point_to_light);
-    float attenuation = get_range_attenuation(light_range, distance);
+vec3 apply_light(int light_index, bool directional, material_info_t material_info, vec3 normal, vec3 view) {
+    vec4 pos_range = texelFetch(sampler2D(light_tex, cluster_smp), ivec2(0, light_index), 0);
+    vec4 color_offset = texelFetch(sampler2D(light_tex, cluster_smp), ivec2(1, light_index), 0);
+    vec4 dir_scale = texelFetch(sampler2D(light_tex, cluster_smp), ivec2(2, light_index), 0);
+    vec3 point_to_light;
+    float attenuation;
+    if (directional) {
+        point_to_light = -dir_scale.xyz;
+        attenuation = 1.0;
+    } else {
+        point_to_light = pos_range.xyz - v_pos;
+        float distance = length(point_to_light);
+        attenuation = get_range_attenuation(pos_range.w, distance);
+        // spot cone falloff, point lights have scale 0 and offset 1
+        float cd = dot(dir_scale.xyz, -point_to_light / distance);
+        float spot = clamp(cd * dir_scale.w + color_offset.w, 0.0, 1.0);
+        attenuation *= spot * spot;
+    }
     vec3 shade = get_point_shade(point_to_light, material_info, normal, view);
-    return attenuation * light_intensity * light_color * shade;
+    return attenuation * color_offset.rgb * shade;
+}
+
+int cluster_tile(float coord_over_depth, float tan_half_fov, int dim) {
+    return clamp(int(floor(((coord_over_depth / tan_half_fov) * 0.5 + 0.5) * float(dim))), 0, dim - 1);
+}
+
+// returns (first light index, light count) of the fragment's cluster
+ivec2 get_cluster() {
+    vec3 view_pos = (view_matrix * vec4(v_pos, 1.0)).xyz;
+    float depth = max(-view_pos.z, grid_params.z);
+    int x = cluster_tile(view_pos.x / depth, grid_params.x, CLUSTER_DIM_X);
+    int y = cluster_tile(view_pos.y / depth, grid_params.y, CLUSTER_DIM_Y);
+    int z = clamp(int(floor(log(depth / grid_params.z) * grid_params.w)), 0, CLUSTER_DIM_Z - 1);
+    uint entry = texelFetch(usampler2D(cluster_tex, cluster_smp), ivec2(y * CLUSTER_DIM_X + x, z), 0).x;
+    return ivec2(int(entry >> uint(CLUSTER_COUNT_BITS)), int(entry & uint((1 << CLUSTER_COUNT_BITS) - 1)));
+}
+
+vec3 apply_lights(material_info_t material_info, vec3 normal, vec3 view, ivec2 cluster) {
+    vec3 color = vec3(0.0);
+    for (int i = 0; i < num_global_lights; i++) {
+        color += apply_light(i, true, material_info, normal, view);
+    }
+    for (int i = 0; i < cluster.y; i++) {
+        int k = cluster.x + i;
+        uint light_index = texelFetch(usampler2D(light_index_tex, cluster_smp), ivec2(k % LIGHT_INDEX_ROW, k / LIGHT_INDEX_ROW), 0).x;
+        color += apply_light(int(light_index), false, material_info, normal, view);
+    }
+    return color;
 }
 
 // Uncharted 2 tone map
@@ -272,11 +367,19 @@ void main() {
     // lighting
     vec3 normal = get_normal();
     vec3 view = normalize(v_eye_pos - v_pos);
-    vec3 color = apply_point_light(material_info, normal, view);
+    ivec2 cluster = get_cluster();
+    vec3 color = apply_lights(material_info, normal, view, cluster);
     color *= texture(sampler2D(occlusion_tex, occlusion_smp), v_uv).r;
     color += srgb_to_linear(texture(sampler2D(emissive_tex, emissive_smp), v_uv)).rgb * emissive_factor;
-    frag_color = vec4(tone_map(color), 1.0);
+    color = tone_map(color);
+    if (show_clusters != 0) {
+        // light count heatmap, red at 32 lights
+        float heat = min(float(cluster.y) / 32.0, 1.0);
+        color = mix(color, vec3(heat, 1.0 - heat, 0.0), 0.4);
+    }
+    frag_color = vec4(color, 1.0);
 }
 @end
 
 @program metallic vs metallic_fs
+@program metallic_quantized vs_quantized metallic_fs
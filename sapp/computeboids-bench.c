@@ -0,0 +1,147 @@
+//------------------------------------------------------------------------------
+//  computeboids-bench.c
+//
+//  Headless benchmark for the CPU boids simulation in libs/util/boids.h.
+//
+//  First validates the spatial-grid update against the O(N^2) reference,
+//  then measures the grid update for 10K up to 1M boids. Rule distances are
+//  scaled with the boid density (the defaults of computeboids-sapp.c are
+//  tuned for 1500 boids), so that the number of neighbours per boid stays
+//  roughly constant and the cost per boid should remain flat.
+//
+//  Usage: computeboids-bench [max_boids] [num_threads]
+//------------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+#include "util/boids.h"
+
+#define DEFAULT_MAX_BOIDS (1000000)
+#define REFERENCE_NUM_BOIDS (1500)
+#define NUM_WARMUP_STEPS (2)
+#define NUM_STEPS (10)
+
+static uint32_t xorshift32(void) {
+    static uint32_t x = 0x12345678;
+    x ^= x<<13;
+    x ^= x>>17;
+    x ^= x<<5;
+    return x;
+}
+
+// return a pseudo-random float between -1.0f and +1.0
+static float rnd(void) {
+    return (((float)(xorshift32() & 0xFFFF) / (float)0xFFFF) - 0.5f) * 2.0f;
+}
+
+static double now_ms(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec * 1000.0 + (double)ts.tv_nsec / 1000000.0;
+}
+
+// the computeboids-sapp.c defaults with rule distances scaled to the boid density
+static boids_params_t scaled_params(int num_boids) {
+    const float s = sqrtf((float)REFERENCE_NUM_BOIDS / (float)num_boids);
+    return (boids_params_t){
+        .dt = 0.04f,
+        .rule1_distance = 0.1f * s,
+        .rule2_distance = 0.025f * s,
+        .rule3_distance = 0.025f * s,
+        .rule1_scale = 0.02f,
+        .rule2_scale = 0.05f,
+        .rule3_scale = 0.005f,
+    };
+}
+
+static void random_boids(boids_particle_t* boids, int num_boids) {
+    for (int i = 0; i < num_boids; i++) {
+        boids[i] = (boids_particle_t){
+            .pos = { rnd(), rnd() },
+            .vel = { rnd() * 0.1f, rnd() * 0.1f },
+        };
+    }
+}
+
+// compare one grid update against one brute-force update from the same start state
+static int validate(boids_particle_t* initial, int num_boids, int num_threads) {
+    boids_t* grid = boids_create(&(boids_desc_t){ .max_particles = num_boids, .num_threads = num_threads });
+    boids_t* ref = boids_create(&(boids_desc_t){ .max_particles = num_boids, .num_threads = num_threads });
+    const boids_params_t params = scaled_params(REFERENCE_NUM_BOIDS);
+    random_boids(initial, num_boids);
+    boids_set_particles(grid, initial, num_boids);
+    boids_set_particles(ref, initial, num_boids);
+    float max_err = 0.0f;
+    for (int step = 0; step < 4; step++) {
+        boids_update(grid, &params, num_boids);
+        boids_update_bruteforce(ref, &params, num_boids);
+        const boids_particle_t* a = boids_particles(grid);
+        const boids_particle_t* b = boids_particles(ref);
+        for (int i = 0; i < num_boids; i++) {
+            for (int c = 0; c < 2; c++) {
+                max_err = fmaxf(max_err, fabsf(a[i].pos[c] - b[i].pos[c]));
+                max_err = fmaxf(max_err, fabsf(a[i].vel[c] - b[i].vel[c]));
+            }
+        }
+        // continue both simulations from the same state, the summation order differs
+        boids_set_particles(grid, b, num_boids);
+    }
+    boids_destroy(ref);
+    boids_destroy(grid);
+    const int ok = max_err < 1.0e-4f;
+    printf("validation (%d boids, grid vs brute force): max error %g => %s\n\n", num_boids, (double)max_err, ok ? "OK" : "FAILED");
+    return ok;
+}
+
+int main(int argc, char* argv[]) {
+    const int max_boids = (argc > 1) ? atoi(argv[1]) : DEFAULT_MAX_BOIDS;
+    const int num_threads = (argc > 2) ? atoi(argv[2]) : 0;
+    if (max_boids < REFERENCE_NUM_BOIDS) {
+        printf("max_boids must be at least %d\n", REFERENCE_NUM_BOIDS);
+        return 10;
+    }
+    boids_particle_t* initial = (boids_particle_t*)malloc((size_t)max_boids * sizeof(boids_particle_t));
+    const int ok = validate(initial, REFERENCE_NUM_BOIDS, num_threads);
+
+    printf("%10s %8s %12s %12s %12s\n", "boids", "grid", "grid ms", "ns/boid", "brute ms");
+    static const int counts[] = { 10000, 30000, 100000, 300000, 1000000, 3000000 };
+    for (size_t i = 0; i < sizeof(counts) / sizeof(counts[0]); i++) {
+        const int num_boids = counts[i];
+        if (num_boids > max_boids) {
+            break;
+        }
+        const boids_params_t params = scaled_params(num_boids);
+        random_boids(initial, num_boids);
+        boids_t* boids = boids_create(&(boids_desc_t){ .max_particles = num_boids, .num_threads = num_threads });
+        boids_set_particles(boids, initial, num_boids);
+        for (int step = 0; step < NUM_WARMUP_STEPS; step++) {
+            boids_update(boids, &params, num_boids);
+        }
+        double start = now_ms();
+        for (int step = 0; step < NUM_STEPS; step++) {
+            boids_update(boids, &params, num_boids);
+        }
+        const double grid_ms = (now_ms() - start) / NUM_STEPS;
+
+        // only run the O(N^2) reference where it finishes in reasonable time
+        double brute_ms = 0.0;
+        if (num_boids <= 30000) {
+            start = now_ms();
+            boids_update_bruteforce(boids, &params, num_boids);
+            brute_ms = now_ms() - start;
+        }
+        const int dim = boids_grid_dim(&params);
+        char grid_str[32];
+        snprintf(grid_str, sizeof(grid_str), "%dx%d", dim, dim);
+        if (brute_ms > 0.0) {
+            printf("%10d %8s %12.3f %12.1f %12.3f\n", num_boids, grid_str, grid_ms, grid_ms * 1.0e6 / num_boids, brute_ms);
+        } else {
+            printf("%10d %8s %12.3f %12.1f %12s\n", num_boids, grid_str, grid_ms, grid_ms * 1.0e6 / num_boids, "-");
+        }
+        fflush(stdout);
+        boids_destroy(boids);
+    }
+    free(initial);
+    return ok ? 0 : 10;
+}
@@ -3,6 +3,16 @@
 //
 //  A port of the WebGPU compute-boids sample
 //  (https://webgpu.github.io/webgpu-samples/?sample=computeBoids)
+//
+//  Three simulation modes can be selected in the UI:
+//
+//  - GPU brute force: the original sample, each boid tests all other boids
+//  - GPU spatial grid: the boids are sorted into a uniform grid with a
+//    counting sort in compute shaders (atomic binning and a prefix sum),
+//    and only boids in the surrounding 3x3 grid cells are tested
+//  - CPU spatial grid: the same grid algorithm running multithreaded
+//    on the CPU (see libs/util/boids.h), the result is uploaded
+//    into a dynamic storage buffer each frame
 //------------------------------------------------------------------------------
 #include "sokol_app.h"
 #include "sokol_gfx.h"
@@ -13,22 +23,53 @@
 #include "sokol_imgui.h"
 #define SOKOL_GFX_IMGUI_IMPL
 #include "sokol_gfx_imgui.h"
+#include "util/boids.h"
 #include "computeboids-sapp.glsl.h"
 
-#define MAX_PARTICLES (10000)
+#define MAX_PARTICLES (256 * 1024)
+#define MAX_BRUTEFORCE_PARTICLES (10000)
+#define MAX_CELLS (BOIDS_MAX_GRID_DIM * BOIDS_MAX_GRID_DIM)
+
+typedef enum {
+    MODE_GPU_BRUTEFORCE,
+    MODE_GPU_GRID,
+    MODE_CPU_GRID,
+} sim_mode_t;
 
 static struct {
+    sim_mode_t mode;
     sim_params_t sim_params;
     struct {
         sg_buffer buf[2];
         sg_view view[2];
         sg_pipeline pip;
     } compute;
+    struct {
+        sg_buffer cell_count_buf;
+        sg_buffer cell_start_buf;
+        sg_buffer particle_slot_buf;
+        sg_buffer sorted_buf;
+        sg_view cell_count_view;
+        sg_view cell_start_view;
+        sg_view particle_slot_view;
+        sg_view sorted_view;
+        sg_pipeline binclear_pip;
+        sg_pipeline bin_pip;
+        sg_pipeline binscan_pip;
+        sg_pipeline binscatter_pip;
+        sg_pipeline sim_pip;
+    } grid;
+    struct {
+        boids_t* boids;
+        sg_buffer buf;
+        sg_view view;
+    } cpu;
     struct {
         sg_pipeline pip;
         sg_pass_action pass_action;
     } display;
 } state = {
+    .mode = MODE_GPU_GRID,
     .sim_params = {
         .dt = 0.04f,
         .rule1_distance = 0.1f,
@@ -65,6 +106,27 @@ static inline float rnd(void) {
     return (((float)(xorshift32() & 0xFFFF) / (float)0xFFFF) - 0.5f) * 2.0f;
 }
 
+// create an uninitialized storage buffer and view which is only written by compute shaders
+static sg_view make_compute_buffer(sg_buffer* out_buf, size_t size, const char* label) {
+    *out_buf = sg_make_buffer(&(sg_buffer_desc){
+        .usage.storage_buffer = true,
+        .size = size,
+        .label = label,
+    });
+    return sg_make_view(&(sg_view_desc){
+        .storage_buffer = { .buffer = *out_buf },
+        .label = label,
+    });
+}
+
+static sg_pipeline make_compute_pipeline(const sg_shader_desc* shd_desc, const char* label) {
+    return sg_make_pipeline(&(sg_pipeline_desc){
+        .compute = true,
+        .shader = sg_make_shader(shd_desc),
+        .label = label,
+    });
+}
+
 static void init(void) {
     sg_setup(&(sg_desc){
         .environment = sglue_environment(),
@@ -99,15 +161,36 @@ static void init(void) {
                 .label = (i == 0) ? "particle-view-0" : "particle-view-1",
             });
         }
+
+        // the CPU simulation starts with the same particles and writes
+        // its result into a dynamic storage buffer
+        state.cpu.boids = boids_create(&(boids_desc_t){ .max_particles = MAX_PARTICLES });
+        boids_set_particles(state.cpu.boids, (const boids_particle_t*)initial_data, MAX_PARTICLES);
+        state.cpu.buf = sg_make_buffer(&(sg_buffer_desc){
+            .usage = { .storage_buffer = true, .stream_update = true },
+            .size = initial_data_size,
+            .label = "cpu-particle-buffer",
+        });
+        state.cpu.view = sg_make_view(&(sg_view_desc){
+            .storage_buffer = { .buffer = state.cpu.buf },
+            .label = "cpu-particle-view",
+        });
         free(initial_data);
     }
 
-    // compute shader and pipeline
-    state.compute.pip = sg_make_pipeline(&(sg_pipeline_desc){
-        .compute = true,
-        .shader = sg_make_shader(compute_shader_desc(sg_query_backend())),
-        .label = "compute-pipeline",
-    });
+    // compute shader and pipeline for the brute force simulation
+    state.compute.pip = make_compute_pipeline(compute_shader_desc(sg_query_backend()), "compute-pipeline");
+
+    // storage buffers and compute pipelines for the spatial grid simulation
+    state.grid.cell_count_view = make_compute_buffer(&state.grid.cell_count_buf, MAX_CELLS * sizeof(uint32_t), "grid-cell-count");
+    state.grid.cell_start_view = make_compute_buffer(&state.grid.cell_start_buf, (MAX_CELLS + 1) * sizeof(uint32_t), "grid-cell-start");
+    state.grid.particle_slot_view = make_compute_buffer(&state.grid.particle_slot_buf, MAX_PARTICLES * sizeof(uint32_t), "grid-particle-slot");
+    state.grid.sorted_view = make_compute_buffer(&state.grid.sorted_buf, MAX_PARTICLES * sizeof(uint32_t), "grid-sorted");
+    state.grid.binclear_pip = make_compute_pipeline(binclear_shader_desc(sg_query_backend()), "grid-binclear-pipeline");
+    state.grid.bin_pip = make_compute_pipeline(bin_shader_desc(sg_query_backend()), "grid-bin-pipeline");
+    state.grid.binscan_pip = make_compute_pipeline(binscan_shader_desc(sg_query_backend()), "grid-binscan-pipeline");
+    state.grid.binscatter_pip = make_compute_pipeline(binscatter_shader_desc(sg_query_backend()), "grid-binscatter-pipeline");
+    state.grid.sim_pip = make_compute_pipeline(gridsim_shader_desc(sg_query_backend()), "grid-sim-pipeline");
 
     // a render pipeline and shader, note that vertices for the boids will be
     // synthesized by the vertex shader, so there's no separate vertex buffer,
@@ -118,26 +201,114 @@ static void init(void) {
     });
 }
 
-static void frame(void) {
-    draw_ui();
+// sort the boids into grid cells and run the simulation on the surrounding cells,
+// all dispatches go into the same compute pass since each depends on the previous one
+static void compute_grid(sg_view in_view, sg_view out_view) {
+    const int num_groups = (state.sim_params.num_particles + 63) / 64;
+    sg_apply_pipeline(state.grid.binclear_pip);
+    sg_apply_bindings(&(sg_bindings){
+        .views[VIEW_cs_cell_count] = state.grid.cell_count_view,
+    });
+    sg_apply_uniforms(UB_sim_params, &SG_RANGE(state.sim_params));
+    sg_dispatch((state.sim_params.num_cells + 63) / 64, 1, 1);
 
-    // input- and output- storage-buffers for this frame
-    const sg_view in_view = state.compute.view[sapp_frame_count() & 1];
-    const sg_view out_view = state.compute.view[(sapp_frame_count() + 1) & 1];
+    sg_apply_pipeline(state.grid.bin_pip);
+    sg_apply_bindings(&(sg_bindings){
+        .views = {
+            [VIEW_cs_ssbo_in] = in_view,
+            [VIEW_cs_cell_count] = state.grid.cell_count_view,
+            [VIEW_cs_particle_slot] = state.grid.particle_slot_view,
+        },
+    });
+    sg_apply_uniforms(UB_sim_params, &SG_RANGE(state.sim_params));
+    sg_dispatch(num_groups, 1, 1);
 
-    // compute pass to update boid positions and velocities, this works with buffer-ping-ponging,
-    // since the compute shader needs random access on the input parameters
-    sg_begin_pass(&(sg_pass){ .compute = true, .label = "compute-pass" });
-    sg_apply_pipeline(state.compute.pip);
+    sg_apply_pipeline(state.grid.binscan_pip);
+    sg_apply_bindings(&(sg_bindings){
+        .views = {
+            [VIEW_cs_cell_count] = state.grid.cell_count_view,
+            [VIEW_cs_cell_start] = state.grid.cell_start_view,
+        },
+    });
+    sg_apply_uniforms(UB_sim_params, &SG_RANGE(state.sim_params));
+    sg_dispatch(1, 1, 1);
+
+    sg_apply_pipeline(state.grid.binscatter_pip);
+    sg_apply_bindings(&(sg_bindings){
+        .views = {
+            [VIEW_cs_ssbo_in] = in_view,
+            [VIEW_cs_cell_start] = state.grid.cell_start_view,
+            [VIEW_cs_particle_slot] = state.grid.particle_slot_view,
+            [VIEW_cs_sorted] = state.grid.sorted_view,
+        },
+    });
+    sg_apply_uniforms(UB_sim_params, &SG_RANGE(state.sim_params));
+    sg_dispatch(num_groups, 1, 1);
+
+    sg_apply_pipeline(state.grid.sim_pip);
     sg_apply_bindings(&(sg_bindings){
         .views = {
             [VIEW_cs_ssbo_in] = in_view,
             [VIEW_cs_ssbo_out] = out_view,
+            [VIEW_cs_cell_start] = state.grid.cell_start_view,
+            [VIEW_cs_sorted] = state.grid.sorted_view,
         },
     });
     sg_apply_uniforms(UB_sim_params, &SG_RANGE(state.sim_params));
-    sg_dispatch((state.sim_params.num_particles+63)/64, 1, 1);
-    sg_end_pass();
+    sg_dispatch(num_groups, 1, 1);
+}
+
+static void frame(void) {
+    draw_ui();
+
+    // the O(N^2) simulation is limited to fewer boids
+    if ((state.mode == MODE_GPU_BRUTEFORCE) && (state.sim_params.num_particles > MAX_BRUTEFORCE_PARTICLES)) {
+        state.sim_params.num_particles = MAX_BRUTEFORCE_PARTICLES;
+    }
+    const boids_params_t boids_params = {
+        .dt = state.sim_params.dt,
+        .rule1_distance = state.sim_params.rule1_distance,
+        .rule2_distance = state.sim_params.rule2_distance,
+        .rule3_distance = state.sim_params.rule3_distance,
+        .rule1_scale = state.sim_params.rule1_scale,
+        .rule2_scale = state.sim_params.rule2_scale,
+        .rule3_scale = state.sim_params.rule3_scale,
+    };
+    state.sim_params.grid_dim = boids_grid_dim(&boids_params);
+    state.sim_params.num_cells = state.sim_params.grid_dim * state.sim_params.grid_dim;
+
+    // input- and output- storage-buffers for this frame
+    const sg_view in_view = state.compute.view[sapp_frame_count() & 1];
+    sg_view out_view = state.compute.view[(sapp_frame_count() + 1) & 1];
+
+    if (state.mode == MODE_CPU_GRID) {
+        if (state.sim_params.num_particles > 0) {
+            boids_update(state.cpu.boids, &boids_params, state.sim_params.num_particles);
+            sg_update_buffer(state.cpu.buf, &(sg_range){
+                .ptr = boids_particles(state.cpu.boids),
+                .size = (size_t)state.sim_params.num_particles * sizeof(particle_t),
+            });
+        }
+        out_view = state.cpu.view;
+    } else if (state.sim_params.num_particles > 0) {
+        // compute pass to update boid positions and velocities, this works with buffer-ping-ponging,
+        // since the compute shader needs random access on the input parameters
+        sg_begin_pass(&(sg_pass){ .compute = true, .label = "compute-pass" });
+        if (state.mode == MODE_GPU_GRID) {
+            compute_grid(in_view, out_view);
+        } else {
+            sg_apply_pipeline(state.compute.pip);
+            sg_apply_bindings(&(sg_bindings){
+                .views = {
+                    [VIEW_cs_ssbo_in] = in_view,
+                    [VIEW_cs_ssbo_out] = out_view,
+                },
+            });
+            sg_apply_uniforms(UB_sim_params, &SG_RANGE(state.sim_params));
+            sg_dispatch((state.sim_params.num_particles+63)/64, 1, 1);
+        }
+        sg_end_pass();
+    }
 
     // render pass for rendering the boids, instanced by the current output storage buffer
     sg_begin_pass(&(sg_pass){
@@ -156,6 +327,7 @@ static void frame(void) {
 }
 
 static void cleanup(void) {
+    boids_destroy(state.cpu.boids);
     sgimgui_discard(&sgimgui);
     simgui_shutdown();
     sg_shutdown();
@@ -184,6 +356,9 @@ static void draw_ui(void) {
         ImGuiWindowFlags_NoBringToFrontOnFocus |
         ImGuiWindowFlags_NoFocusOnAppearing;
     if (igBegin("controls", 0, flags)) {
+        igRadioButtonIntPtr("GPU brute force", (int*)&state.mode, MODE_GPU_BRUTEFORCE);
+        igRadioButtonIntPtr("GPU spatial grid", (int*)&state.mode, MODE_GPU_GRID);
+        igRadioButtonIntPtr("CPU spatial grid", (int*)&state.mode, MODE_CPU_GRID);
         igSliderFloat("Delta T", &state.sim_params.dt, 0.01, 0.1);
         igSliderFloat("Rule1 Distance", &state.sim_params.rule1_distance, 0.0f, 0.2f);
         igSliderFloat("Rule2 Distance", &state.sim_params.rule2_distance, 0.0f, 0.1f);
@@ -191,7 +366,10 @@ static void draw_ui(void) {
         igSliderFloat("Rule1 Scale", &state.sim_params.rule1_scale, 0.0f, 0.1f);
         igSliderFloat("Rule2 Scale", &state.sim_params.rule2_scale, 0.0f, 0.1f);
         igSliderFloat("Rule3 Scale", &state.sim_params.rule3_scale, 0.0f, 0.1f);
-        igSliderInt("Num Boids", &state.sim_params.num_particles, 0, MAX_PARTICLES);
+        const int max_particles = (state.mode == MODE_GPU_BRUTEFORCE) ? MAX_BRUTEFORCE_PARTICLES : MAX_PARTICLES;
+        igSliderInt("Num Boids", &state.sim_params.num_particles, 0, max_particles);
+        igText("Grid: %dx%d", state.sim_params.grid_dim, state.sim_params.grid_dim);
+        igText("Frame: %.2f ms", sapp_frame_duration() * 1000.0);
     }
     igEnd();
     sgimgui_draw(&sgimgui);
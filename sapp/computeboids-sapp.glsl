@@ -8,13 +8,8 @@ struct particle {
 };
 @end
 
-// compute shader for updating boid positions and velocities
-@cs cs
-@include_block common
-
-layout(binding=0) readonly buffer cs_ssbo_in { particle prt_in[]; };
-layout(binding=1) buffer cs_ssbo_out { particle prt_out[]; };
-
+// simulation parameters shared by all compute shaders
+@block sim
 layout(binding=0) uniform sim_params {
     float dt;
     float rule1_distance;
@@ -24,8 +19,58 @@ layout(binding=0) uniform sim_params {
     float rule2_scale;
     float rule3_scale;
     int num_particles;
+    int grid_dim;
+    int num_cells;
 };
 
+// grid cell coordinate of a position in the [-1, +1] simulation area,
+// must match boids_cell_coord() in libs/util/boids.c
+int cell_coord(float pos) {
+    return clamp(int((pos + 1.0) * 0.5 * float(grid_dim)), 0, grid_dim - 1);
+}
+
+int cell_index(vec2 pos) {
+    return cell_coord(pos.y) * grid_dim + cell_coord(pos.x);
+}
+@end
+
+// the boid rules, called with the accumulated neighbour values
+@block integrate
+particle integrate(vec2 v_pos, vec2 v_vel, vec2 c_mass, vec2 c_vel, vec2 col_vel, int c_mass_count, int c_vel_count) {
+    if (c_mass_count > 0) {
+        c_mass = c_mass / c_mass_count - v_pos;
+    }
+    if (c_vel_count > 0) {
+        c_vel = c_vel / c_vel_count;
+    }
+    v_vel += c_mass * rule1_scale + col_vel * rule2_scale + c_vel * rule3_scale;
+
+    // clamp velocity for a more pleasing simulation
+    v_vel = normalize(v_vel) * clamp(length(v_vel), 0, 0.1);
+
+    // kinematic update
+    v_pos += v_vel * dt;
+    // wrap around boundary
+    if (v_pos.x < -1.0) { v_pos.x = 1.0; }
+    else if (v_pos.x > 1.0) { v_pos.x = -1.0; }
+    if (v_pos.y < -1.0) { v_pos.y = 1.0; }
+    else if (v_pos.y > 1.0) { v_pos.y = -1.0; }
+    particle p;
+    p.pos = v_pos;
+    p.vel = v_vel;
+    return p;
+}
+@end
+
+// compute shader for updating boid positions and velocities, tests all particle pairs
+@cs cs
+@include_block common
+@include_block sim
+@include_block integrate
+
+layout(binding=0) readonly buffer cs_ssbo_in { particle prt_in[]; };
+layout(binding=1) buffer cs_ssbo_out { particle prt_out[]; };
+
 layout(local_size_x=64, local_size_y=1, local_size_z=1) in;
 void main() {
     const uint idx = gl_GlobalInvocationID.x;
@@ -59,31 +104,176 @@ void main() {
             c_vel_count++;
         }
     }
-    if (c_mass_count > 0) {
-        c_mass = c_mass / c_mass_count - v_pos;
+    prt_out[idx] = integrate(v_pos, v_vel, c_mass, c_vel, col_vel, c_mass_count, c_vel_count);
+}
+@end
+
+@program compute cs
+
+// The spatial grid version sorts the particles into grid cells (with a cell size
+// of at least the largest rule distance) and only tests the particles in the
+// surrounding 3x3 cells. Binning is a counting sort in 4 dispatches:
+//
+//  binclear:   clear the per-cell particle counters
+//  bin:        count particles per cell, each particle remembers its slot in the cell
+//  binscan:    exclusive prefix sum of the cell counters into the cell start offsets
+//  binscatter: write the particle indices sorted by cell
+//
+// ...followed by the simulation in 'gridsim'.
+@cs cs_binclear
+@include_block sim
+
+layout(binding=2) buffer cs_cell_count { uint cell_count[]; };
+
+layout(local_size_x=64, local_size_y=1, local_size_z=1) in;
+void main() {
+    const uint idx = gl_GlobalInvocationID.x;
+    if (idx < num_cells) {
+        cell_count[idx] = 0u;
     }
-    if (c_vel_count > 0) {
-        c_vel = c_vel / c_vel_count;
+}
+@end
+
+@cs cs_bin
+@include_block common
+@include_block sim
+
+layout(binding=0) readonly buffer cs_ssbo_in { particle prt_in[]; };
+layout(binding=2) buffer cs_cell_count { uint cell_count[]; };
+layout(binding=4) buffer cs_particle_slot { uint particle_slot[]; };
+
+layout(local_size_x=64, local_size_y=1, local_size_z=1) in;
+void main() {
+    const uint idx = gl_GlobalInvocationID.x;
+    if (idx >= num_particles) {
+        return;
     }
-    v_vel += c_mass * rule1_scale + col_vel * rule2_scale + c_vel * rule3_scale;
+    const int cell = cell_index(prt_in[idx].pos);
+    particle_slot[idx] = atomicAdd(cell_count[cell], 1u);
+}
+@end
 
-    // clamp velocity for a more pleasing simulation
-    v_vel = normalize(v_vel) * clamp(length(v_vel), 0, 0.1);
+// a single workgroup, each invocation sums a consecutive run of cells,
+// the run sums are scanned in shared memory
+@cs cs_binscan
+@include_block sim
 
-    // kinematic update
-    v_pos += v_vel * dt;
-    // wrap around boundary
-    if (v_pos.x < -1.0) { v_pos.x = 1.0; }
-    else if (v_pos.x > 1.0) { v_pos.x = -1.0; }
-    if (v_pos.y < -1.0) { v_pos.y = 1.0; }
-    else if (v_pos.y > 1.0) { v_pos.y = -1.0; }
+layout(binding=2) readonly buffer cs_cell_count { uint cell_count[]; };
+layout(binding=3) buffer cs_cell_start { uint cell_start[]; };
+
+shared uint run_sums[256];
 
-    prt_out[idx].pos = v_pos;
-    prt_out[idx].vel = v_vel;
+layout(local_size_x=256, local_size_y=1, local_size_z=1) in;
+void main() {
+    const int tid = int(gl_LocalInvocationID.x);
+    const int run_length = (num_cells + 255) / 256;
+    const int first = tid * run_length;
+    const int last = min(first + run_length, num_cells);
+    uint sum = 0u;
+    for (int i = first; i < last; i++) {
+        sum += cell_count[i];
+    }
+    run_sums[tid] = sum;
+    barrier();
+    for (int offset = 1; offset < 256; offset *= 2) {
+        const uint val = (tid >= offset) ? run_sums[tid - offset] : 0u;
+        barrier();
+        run_sums[tid] += val;
+        barrier();
+    }
+    uint start = run_sums[tid] - sum;
+    for (int i = first; i < last; i++) {
+        cell_start[i] = start;
+        start += cell_count[i];
+    }
+    if (tid == 255) {
+        cell_start[num_cells] = run_sums[255];
+    }
 }
 @end
 
-@program compute cs
+@cs cs_binscatter
+@include_block common
+@include_block sim
+
+layout(binding=0) readonly buffer cs_ssbo_in { particle prt_in[]; };
+layout(binding=3) readonly buffer cs_cell_start { uint cell_start[]; };
+layout(binding=4) readonly buffer cs_particle_slot { uint particle_slot[]; };
+layout(binding=5) buffer cs_sorted { uint sorted[]; };
+
+layout(local_size_x=64, local_size_y=1, local_size_z=1) in;
+void main() {
+    const uint idx = gl_GlobalInvocationID.x;
+    if (idx >= num_particles) {
+        return;
+    }
+    const int cell = cell_index(prt_in[idx].pos);
+    sorted[cell_start[cell] + particle_slot[idx]] = idx;
+}
+@end
+
+@cs cs_gridsim
+@include_block common
+@include_block sim
+@include_block integrate
+
+layout(binding=0) readonly buffer cs_ssbo_in { particle prt_in[]; };
+layout(binding=1) buffer cs_ssbo_out { particle prt_out[]; };
+layout(binding=3) readonly buffer cs_cell_start { uint cell_start[]; };
+layout(binding=5) readonly buffer cs_sorted { uint sorted[]; };
+
+layout(local_size_x=64, local_size_y=1, local_size_z=1) in;
+void main() {
+    const uint idx = gl_GlobalInvocationID.x;
+    if (idx >= num_particles) {
+        return;
+    }
+
+    vec2 v_pos = prt_in[idx].pos;
+    vec2 v_vel = prt_in[idx].vel;
+    vec2 c_mass = vec2(0, 0);
+    vec2 c_vel = vec2(0, 0);
+    vec2 col_vel = vec2(0, 0);
+    int c_mass_count = 0;
+    int c_vel_count = 0;
+    const int cx = cell_coord(v_pos.x);
+    const int cy = cell_coord(v_pos.y);
+    const int x0 = max(cx - 1, 0);
+    const int x1 = min(cx + 1, grid_dim - 1);
+    for (int y = max(cy - 1, 0); y <= min(cy + 1, grid_dim - 1); y++) {
+        // the cells of a row are consecutive in the sorted index array
+        const uint begin = cell_start[y * grid_dim + x0];
+        const uint end = cell_start[y * grid_dim + x1 + 1];
+        for (uint k = begin; k < end; k++) {
+            const uint i = sorted[k];
+            if (i == idx) {
+                continue;
+            }
+            const vec2 pos = prt_in[i].pos;
+            const vec2 vel = prt_in[i].vel;
+            const float dist = distance(pos, v_pos);
+            if (dist < rule1_distance) {
+                c_mass += pos;
+                c_mass_count++;
+            }
+            if (dist < rule2_distance) {
+                col_vel -= (pos - v_pos);
+            }
+            if (dist < rule3_distance) {
+                c_vel += vel;
+                c_vel_count++;
+            }
+        }
+    }
+    prt_out[idx] = integrate(v_pos, v_vel, c_mass, c_vel, col_vel, c_mass_count, c_vel_count);
+}
+@end
+
+@program binclear cs_binclear
+@program bin cs_bin
+@program binscan cs_binscan
+@program binscatter cs_binscatter
+@program gridsim cs_gridsim
 
 // vertex- and fragment shader for rendering the boids, vertex data is looked
 // up from shader constants, per-instance data is coming from a storage buffer
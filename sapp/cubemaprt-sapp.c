@@ -1,13 +1,26 @@
 //------------------------------------------------------------------------------
 //  cubemaprt-sapp.c
 //  Cubemap as render target.
+//
+//  The cubemap is a dynamic environment probe which only re-renders a few
+//  faces each frame (round-robin), and each face only renders the shapes
+//  inside its frustum. Optionally the shapes are rendered with a single
+//  instanced draw call per face.
+//
+//  Keys:
+//      1..6: number of cubemap faces updated per frame
+//      C: toggle per-face frustum culling
+//      I: toggle instanced rendering into the cubemap faces
 //------------------------------------------------------------------------------
 #define VECMATH_GENERICS
 #include "vecmath/vecmath.h"
+#include "util/frustum.h"
 #include "sokol_gfx.h"
 #include "sokol_app.h"
 #include "sokol_log.h"
 #include "sokol_glue.h"
+#define SOKOL_DEBUGTEXT_IMPL
+#include "sokol_debugtext.h"
 #include "dbgui/dbgui.h"
 #include <stddef.h> /* offsetof */
 #include "cubemaprt-sapp.glsl.h"
@@ -17,6 +30,30 @@
 #define OFFSCREEN_SAMPLE_COUNT (1)
 #define DISPLAY_SAMPLE_COUNT (4)
 #define NUM_SHAPES (32)
+#define SHAPE_RADIUS (0.25f * 1.7320508f)   // bounding sphere radius of the scaled cube
+
+// per-instance data for instanced rendering into the cubemap faces
+typedef struct {
+    mat44_t model;
+    vec4_t color;
+} instance_t;
+
+// the environment probe, updates a few cubemap faces each frame
+typedef struct {
+    sg_view color_views[SG_CUBEFACE_NUM];
+    sg_view depth_view;
+    int faces_per_frame;
+    int next_face;
+    bool valid;         // false until all faces have been rendered once
+    bool cull;
+    bool instanced;
+    // stats of the last frame
+    struct {
+        int shapes;
+        int culled;
+        int draws;
+    } stats;
+} probe_t;
 
 /* state struct for the little cubes rotating around the big cube */
 typedef struct {
@@ -46,12 +83,14 @@ typedef struct {
     sg_image cubemap;
     sg_view cubemap_texview;
     sg_sampler smp;
-    sg_view offscreen_color_views[SG_CUBEFACE_NUM];
-    sg_view offscreen_depth_view;
+    probe_t probe;
+    sg_buffer instance_buf;
+    instance_t instances[SG_CUBEFACE_NUM * NUM_SHAPES];
     sg_pass_action offscreen_pass_action;
     sg_pass_action display_pass_action;
     mesh_t cube;
     sg_pipeline offscreen_shapes_pip;
+    sg_pipeline offscreen_shapes_inst_pip;
     sg_pipeline display_shapes_pip;
     sg_pipeline display_cube_pip;
     mat44_t offscreen_proj;
@@ -62,8 +101,35 @@ typedef struct {
 static app_t app;
 
 static void draw_cubes(sg_pipeline pip, vec3_t eye_pos, mat44_t view_proj);
+static void update_probe(void);
+static void input(const sapp_event* ev);
 static mesh_t make_cube_mesh(void);
 
+// view directions and up vectors of the cubemap faces
+// FIXME: these values work for Metal and D3D11, not for GL, because
+// of the different handedness of the cubemap coordinate systems
+//
+// FIXME: is this actually correct???
+#if defined(SOKOL_METAL) || defined(SOKOL_D3D11) || defined(SOKOL_WGPU)
+static const vec3_t center_and_up[SG_CUBEFACE_NUM][2] = {
+    { { .x=+1.0f, .y= 0.0f, .z= 0.0f }, { .x=0.0f, .y=-1.0f, .z= 0.0f } },
+    { { .x=-1.0f, .y= 0.0f, .z= 0.0f }, { .x=0.0f, .y=-1.0f, .z= 0.0f } },
+    { { .x= 0.0f, .y=-1.0f, .z= 0.0f }, { .x=0.0f, .y= 0.0f, .z=-1.0f } },
+    { { .x= 0.0f, .y=+1.0f, .z= 0.0f }, { .x=0.0f, .y= 0.0f, .z=+1.0f } },
+    { { .x= 0.0f, .y= 0.0f, .z=+1.0f }, { .x=0.0f, .y=-1.0f, .z= 0.0f } },
+    { { .x= 0.0f, .y= 0.0f, .z=-1.0f }, { .x=0.0f, .y=-1.0f, .z= 0.0f } }
+};
+#else // GL
+static const vec3_t center_and_up[SG_CUBEFACE_NUM][2] = {
+    { { .x=+1.0f, .y= 0.0f, .z= 0.0f }, { .x=0.0f, .y=-1.0f, .z= 0.0f } },
+    { { .x=-1.0f, .y= 0.0f, .z= 0.0f }, { .x=0.0f, .y=-1.0f, .z= 0.0f } },
+    { { .x= 0.0f, .y=+1.0f, .z= 0.0f }, { .x=0.0f, .y= 0.0f, .z=+1.0f } },
+    { { .x= 0.0f, .y=-1.0f, .z= 0.0f }, { .x=0.0f, .y= 0.0f, .z=-1.0f } },
+    { { .x= 0.0f, .y= 0.0f, .z=+1.0f }, { .x=0.0f, .y=-1.0f, .z= 0.0f } },
+    { { .x= 0.0f, .y= 0.0f, .z=-1.0f }, { .x=0.0f, .y=-1.0f, .z= 0.0f } }
+};
+#endif
+
 static inline uint32_t xorshift32(void) {
     static uint32_t x = 0x12345678;
     x ^= x<<13;
@@ -81,6 +147,10 @@ void init(void) {
         .environment = sglue_environment(),
         .logger.func = slog_func,
     });
+    sdtx_setup(&(sdtx_desc_t){
+        .fonts[0] = sdtx_font_oric(),
+        .logger.func = slog_func,
+    });
     __dbgui_setup(DISPLAY_SAMPLE_COUNT);
 
     // create a cubemap as render target, a texture view, and a matching depth-buffer texture
@@ -110,15 +180,25 @@ void init(void) {
     for (int i = 0; i < SG_CUBEFACE_NUM; i++) {
         char label[32];
         snprintf(label, sizeof(label), "cubemap-texview-%d", i);
-        app.offscreen_color_views[i] = sg_make_view(&(sg_view_desc){
+        app.probe.color_views[i] = sg_make_view(&(sg_view_desc){
             .color_attachment = { .image = app.cubemap, .slice = i },
             .label = label,
         });
     }
-    app.offscreen_depth_view = sg_make_view(&(sg_view_desc){
+    app.probe.depth_view = sg_make_view(&(sg_view_desc){
         .depth_stencil_attachment = { .image = depth_img },
         .label = "depth-stencil-attachment",
     });
+    app.probe.faces_per_frame = 1;
+    app.probe.cull = true;
+    app.probe.instanced = true;
+
+    // per-instance data for all faces, updated once per frame
+    app.instance_buf = sg_make_buffer(&(sg_buffer_desc){
+        .usage.stream_update = true,
+        .size = sizeof(app.instances),
+        .label = "cubemap-instances",
+    });
 
     // pass action for offscreen pass (clear to black)
     app.offscreen_pass_action = (sg_pass_action) {
@@ -161,6 +241,33 @@ void init(void) {
     pip_desc.label = "display-shapes-pipeline";
     app.display_shapes_pip = sg_make_pipeline(&pip_desc);
 
+    // pipeline for instanced offscreen-rendering, the per-instance model matrix
+    // and color come from the second vertex buffer
+    app.offscreen_shapes_inst_pip = sg_make_pipeline(&(sg_pipeline_desc){
+        .shader = sg_make_shader(shapes_inst_shader_desc(sg_query_backend())),
+        .layout = {
+            .buffers[1] = { .stride = sizeof(instance_t), .step_func = SG_VERTEXSTEP_PER_INSTANCE },
+            .attrs = {
+                [ATTR_shapes_inst_pos] = { .offset = offsetof(vertex_t, pos), .format = SG_VERTEXFORMAT_FLOAT3 },
+                [ATTR_shapes_inst_norm] = { .offset = offsetof(vertex_t, norm), .format = SG_VERTEXFORMAT_FLOAT3 },
+                [ATTR_shapes_inst_inst_model_x] = { .buffer_index = 1, .offset = offsetof(instance_t, model.x), .format = SG_VERTEXFORMAT_FLOAT4 },
+                [ATTR_shapes_inst_inst_model_y] = { .buffer_index = 1, .offset = offsetof(instance_t, model.y), .format = SG_VERTEXFORMAT_FLOAT4 },
+                [ATTR_shapes_inst_inst_model_z] = { .buffer_index = 1, .offset = offsetof(instance_t, model.z), .format = SG_VERTEXFORMAT_FLOAT4 },
+                [ATTR_shapes_inst_inst_model_w] = { .buffer_index = 1, .offset = offsetof(instance_t, model.w), .format = SG_VERTEXFORMAT_FLOAT4 },
+                [ATTR_shapes_inst_inst_color] = { .buffer_index = 1, .offset = offsetof(instance_t, color), .format = SG_VERTEXFORMAT_FLOAT4 },
+            },
+        },
+        .index_type = SG_INDEXTYPE_UINT16,
+        .cull_mode = SG_CULLMODE_BACK,
+        .sample_count = OFFSCREEN_SAMPLE_COUNT,
+        .depth = {
+            .pixel_format = SG_PIXELFORMAT_DEPTH,
+            .compare = SG_COMPAREFUNC_LESS_EQUAL,
+            .write_enabled = true,
+        },
+        .label = "offscreen-shapes-instanced-pipeline"
+    });
+
     // shader and pipeline objects for display-rendering
     app.display_cube_pip = sg_make_pipeline(&(sg_pipeline_desc){
         .shader = sg_make_shader(cube_shader_desc(sg_query_backend())),
@@ -210,43 +317,8 @@ void frame(void) {
         app.shapes[i].model = vm_mul(vm_mul(scale, trans), rot);
     }
 
-    // offscreen pass which renders the environment cubemap
-    // FIXME: these values work for Metal and D3D11, not for GL, because
-    // of the different handedness of the cubemap coordinate systems
-    //
-    // FIXME: is this actually correct???
-    #if defined(SOKOL_METAL) || defined(SOKOL_D3D11) || defined(SOKOL_WGPU)
-    vec3_t center_and_up[SG_CUBEFACE_NUM][2] = {
-        { { .x=+1.0f, .y= 0.0f, .z= 0.0f }, { .x=0.0f, .y=-1.0f, .z= 0.0f } },
-        { { .x=-1.0f, .y= 0.0f, .z= 0.0f }, { .x=0.0f, .y=-1.0f, .z= 0.0f } },
-        { { .x= 0.0f, .y=-1.0f, .z= 0.0f }, { .x=0.0f, .y= 0.0f, .z=-1.0f } },
-        { { .x= 0.0f, .y=+1.0f, .z= 0.0f }, { .x=0.0f, .y= 0.0f, .z=+1.0f } },
-        { { .x= 0.0f, .y= 0.0f, .z=+1.0f }, { .x=0.0f, .y=-1.0f, .z= 0.0f } },
-        { { .x= 0.0f, .y= 0.0f, .z=-1.0f }, { .x=0.0f, .y=-1.0f, .z= 0.0f } }
-    };
-    #else // GL
-    vec3_t center_and_up[SG_CUBEFACE_NUM][2] = {
-        { { .x=+1.0f, .y= 0.0f, .z= 0.0f }, { .x=0.0f, .y=-1.0f, .z= 0.0f } },
-        { { .x=-1.0f, .y= 0.0f, .z= 0.0f }, { .x=0.0f, .y=-1.0f, .z= 0.0f } },
-        { { .x= 0.0f, .y=+1.0f, .z= 0.0f }, { .x=0.0f, .y= 0.0f, .z=+1.0f } },
-        { { .x= 0.0f, .y=-1.0f, .z= 0.0f }, { .x=0.0f, .y= 0.0f, .z=-1.0f } },
-        { { .x= 0.0f, .y= 0.0f, .z=+1.0f }, { .x=0.0f, .y=-1.0f, .z= 0.0f } },
-        { { .x= 0.0f, .y= 0.0f, .z=-1.0f }, { .x=0.0f, .y=-1.0f, .z= 0.0f } }
-    };
-    #endif
-    for (int face = 0; face < SG_CUBEFACE_NUM; face++) {
-        sg_begin_pass(&(sg_pass){
-            .action = app.offscreen_pass_action,
-            .attachments = {
-                .colors[0] = app.offscreen_color_views[face],
-                .depth_stencil = app.offscreen_depth_view,
-            }
-        });
-        mat44_t view = mat44_look_at_rh(vec3(0.0f, 0.0f, 0.0f), center_and_up[face][0], center_and_up[face][1]);
-        mat44_t view_proj = vm_mul(view, app.offscreen_proj);
-        draw_cubes(app.offscreen_shapes_pip, vec3(0.0f, 0.0f, 0.0f), view_proj);
-        sg_end_pass();
-    }
+    // re-render a few faces of the environment cubemap
+    update_probe();
 
     // render the default pass
     const int w = sapp_width();
@@ -283,6 +355,15 @@ void frame(void) {
     sg_apply_uniforms(UB_shape_uniforms, &SG_RANGE(uniforms));
     sg_draw(0, app.cube.num_elements, 1);
 
+    sdtx_canvas(w * 0.5f, h * 0.5f);
+    sdtx_origin(1.0f, 1.0f);
+    sdtx_printf("faces per frame: %d (1..6)\n", app.probe.faces_per_frame);
+    sdtx_printf("culling:         %s (C)\n", app.probe.cull ? "on" : "off");
+    sdtx_printf("instancing:      %s (I)\n\n", app.probe.instanced ? "on" : "off");
+    sdtx_printf("shapes rendered: %d\n", app.probe.stats.shapes);
+    sdtx_printf("shapes culled:   %d\n", app.probe.stats.culled);
+    sdtx_printf("cubemap draws:   %d\n", app.probe.stats.draws);
+    sdtx_draw();
     __dbgui_draw();
     sg_end_pass();
     sg_commit();
@@ -290,9 +371,23 @@ void frame(void) {
 
 void cleanup(void) {
     __dbgui_shutdown();
+    sdtx_shutdown();
     sg_shutdown();
 }
 
+static void input(const sapp_event* ev) {
+    if (ev->type == SAPP_EVENTTYPE_KEY_DOWN) {
+        if ((ev->key_code >= SAPP_KEYCODE_1) && (ev->key_code <= SAPP_KEYCODE_6)) {
+            app.probe.faces_per_frame = 1 + (int)(ev->key_code - SAPP_KEYCODE_1);
+        } else if (ev->key_code == SAPP_KEYCODE_C) {
+            app.probe.cull = !app.probe.cull;
+        } else if (ev->key_code == SAPP_KEYCODE_I) {
+            app.probe.instanced = !app.probe.instanced;
+        }
+    }
+    __dbgui_event(ev);
+}
+
 sapp_desc sokol_main(int argc, char* argv[]) {
     (void)argc;
     (void)argv;
@@ -300,7 +395,7 @@ sapp_desc sokol_main(int argc, char* argv[]) {
         .init_cb = init,
         .frame_cb = frame,
         .cleanup_cb = cleanup,
-        .event_cb = __dbgui_event,
+        .event_cb = input,
         .width = 800,
         .height = 600,
         .sample_count = DISPLAY_SAMPLE_COUNT,
@@ -330,6 +425,110 @@ static void draw_cubes(sg_pipeline pip, vec3_t eye_pos, mat44_t view_proj) {
     }
 }
 
+static bool sphere_visible(const vec4_t planes[6], vec3_t center, float radius) {
+    for (int i = 0; i < 6; i++) {
+        if (vec4_dot(planes[i], vec4v3f(center, 1.0f)) < -radius) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// render the next faces_per_frame cubemap faces (or all faces if the
+// probe hasn't been fully rendered yet), each face only renders the
+// shapes inside its frustum
+static void update_probe(void) {
+    probe_t* probe = &app.probe;
+    const int num_faces = probe->valid ? probe->faces_per_frame : SG_CUBEFACE_NUM;
+    const vec3_t eye_pos = vec3(0.0f, 0.0f, 0.0f);
+    int faces[SG_CUBEFACE_NUM];
+    mat44_t view_projs[SG_CUBEFACE_NUM];
+    int first_shape[SG_CUBEFACE_NUM];
+    int num_shapes[SG_CUBEFACE_NUM];
+    int visible[SG_CUBEFACE_NUM * NUM_SHAPES];
+    int num_visible = 0;
+    probe->stats.culled = 0;
+
+    // gather the visible shapes of all faces first, so that the instance
+    // data can be uploaded with a single buffer update
+    for (int i = 0; i < num_faces; i++) {
+        const int face = (probe->next_face + i) % SG_CUBEFACE_NUM;
+        const mat44_t view = mat44_look_at_rh(eye_pos, center_and_up[face][0], center_and_up[face][1]);
+        faces[i] = face;
+        view_projs[i] = vm_mul(view, app.offscreen_proj);
+        vec4_t planes[6];
+        frustum_planes(&view_projs[i], planes);
+        first_shape[i] = num_visible;
+        for (int shape_index = 0; shape_index < NUM_SHAPES; shape_index++) {
+            const mat44_t* model = &app.shapes[shape_index].model;
+            if (probe->cull && !sphere_visible(planes, vec3(model->w.x, model->w.y, model->w.z), SHAPE_RADIUS)) {
+                probe->stats.culled++;
+                continue;
+            }
+            if (probe->instanced) {
+                app.instances[num_visible] = (instance_t){ .model = *model, .color = app.shapes[shape_index].color };
+            }
+            visible[num_visible++] = shape_index;
+        }
+        num_shapes[i] = num_visible - first_shape[i];
+    }
+    if (probe->instanced && (num_visible > 0)) {
+        sg_update_buffer(app.instance_buf, &(sg_range){ .ptr = app.instances, .size = (size_t)num_visible * sizeof(instance_t) });
+    }
+
+    probe->stats.shapes = num_visible;
+    probe->stats.draws = 0;
+    for (int i = 0; i < num_faces; i++) {
+        sg_begin_pass(&(sg_pass){
+            .action = app.offscreen_pass_action,
+            .attachments = {
+                .colors[0] = probe->color_views[faces[i]],
+                .depth_stencil = probe->depth_view,
+            }
+        });
+        if (num_shapes[i] > 0) {
+            if (probe->instanced) {
+                sg_apply_pipeline(app.offscreen_shapes_inst_pip);
+                sg_apply_bindings(&(sg_bindings){
+                    .vertex_buffers = { [0] = app.cube.vbuf, [1] = app.instance_buf },
+                    .vertex_buffer_offsets[1] = first_shape[i] * (int)sizeof(instance_t),
+                    .index_buffer = app.cube.ibuf
+                });
+                const inst_uniforms_t uniforms = {
+                    .view_proj = view_projs[i],
+                    .light_dir = app.light_dir,
+                    .eye_pos = vec4v3f(eye_pos, 1.0f)
+                };
+                sg_apply_uniforms(UB_inst_uniforms, &SG_RANGE(uniforms));
+                sg_draw(0, app.cube.num_elements, num_shapes[i]);
+                probe->stats.draws++;
+            } else {
+                sg_apply_pipeline(app.offscreen_shapes_pip);
+                sg_apply_bindings(&(sg_bindings){
+                    .vertex_buffers[0] = app.cube.vbuf,
+                    .index_buffer = app.cube.ibuf
+                });
+                for (int j = 0; j < num_shapes[i]; j++) {
+                    const shape_t* shape = &app.shapes[visible[first_shape[i] + j]];
+                    const shape_uniforms_t uniforms = {
+                        .mvp = vm_mul(shape->model, view_projs[i]),
+                        .model = shape->model,
+                        .shape_color = shape->color,
+                        .light_dir = app.light_dir,
+                        .eye_pos = vec4v3f(eye_pos, 1.0f)
+                    };
+                    sg_apply_uniforms(UB_shape_uniforms, &SG_RANGE(uniforms));
+                    sg_draw(0, app.cube.num_elements, 1);
+                    probe->stats.draws++;
+                }
+            }
+        }
+        sg_end_pass();
+    }
+    probe->next_face = (probe->next_face + num_faces) % SG_CUBEFACE_NUM;
+    probe->valid = true;
+}
+
 static mesh_t make_cube_mesh(void) {
     vertex_t vertices[] =  {
         { { -1.0, -1.0, -1.0 }, { 0.0, 0.0, -1.0 } },
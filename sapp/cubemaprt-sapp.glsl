@@ -33,6 +33,41 @@ void main() {
 }
 @end
 
+// vertex shader for instanced offscreen rendering, the model matrix and
+// color are per-instance vertex attributes
+@vs vs_inst
+layout(binding=0) uniform inst_uniforms {
+    mat4 view_proj;
+    vec4 light_dir;     // light-direction in world space
+    vec4 eye_pos;       // eye-pos in world space
+};
+
+in vec4 pos;
+in vec3 norm;
+in vec4 inst_model_x;
+in vec4 inst_model_y;
+in vec4 inst_model_z;
+in vec4 inst_model_w;
+in vec4 inst_color;
+
+out vec3 world_position;
+out vec3 world_normal;
+out vec3 world_eyepos;
+out vec3 world_lightdir;
+out vec4 color;
+
+void main() {
+    mat4 model = mat4(inst_model_x, inst_model_y, inst_model_z, inst_model_w);
+    vec4 world_pos = model * pos;
+    gl_Position = view_proj * world_pos;
+    world_position = world_pos.xyz;
+    world_normal = vec4(model * vec4(norm, 0.0)).xyz;
+    world_eyepos = eye_pos.xyz;
+    world_lightdir = light_dir.xyz;
+    color = inst_color;
+}
+@end
+
 // shared code for fragment shaders
 @block lighting
 vec3 light(vec3 base_color, vec3 eye_vec, vec3 normal, vec3 light_vec) {
@@ -90,4 +125,5 @@ void main() {
 @end
 
 @program shapes vs fs_shapes
+@program shapes_inst vs_inst fs_shapes
 @program cube vs fs_cube
@@ -0,0 +1,550 @@
+//------------------------------------------------------------------------------
+//  deferred-sapp.c
+//
+//  Tiled deferred shading with a packed G-buffer, compared to forward
+//  shading with the same point lights. Builds on the render target
+//  handling of mrt-sapp.c.
+//
+//  The G-buffer is 3 x 32 bits per pixel:
+//
+//  - RGBA8: albedo + roughness
+//  - RG16 (or RG16F where RG16 isn't renderable): octahedral encoded normal
+//  - the depth buffer, the world space position is reconstructed from it
+//
+//  A compute pass with one workgroup per 16x16 pixel tile culls the lights
+//  against the tile's depth bounds and shades the tile's pixels with the
+//  visible lights only. The forward path evaluates all lights for every
+//  fragment.
+//
+//  Keys:
+//  - SPACE: switch between deferred and forward
+//  - UP/DOWN: more/fewer lights
+//  - T: show per-tile light counts
+//------------------------------------------------------------------------------
+#include "sokol_app.h"
+#include "sokol_gfx.h"
+#include "sokol_log.h"
+#include "sokol_glue.h"
+#define SOKOL_DEBUGTEXT_IMPL
+#include "sokol_debugtext.h"
+#define VECMATH_GENERICS
+#include "vecmath/vecmath.h"
+#include "dbgui/dbgui.h"
+#include "deferred-sapp.glsl.h"
+
+#define TILE_SIZE (16)
+#define MAX_LIGHTS (2048)
+#define MIN_LIGHTS (64)
+#define DEFAULT_NUM_LIGHTS (512)
+#define GRID_DIM (16)
+#define NUM_INSTANCES (GRID_DIM * GRID_DIM + 1)
+#define FIELD_SIZE (32.0f)
+#define NUM_FRAME_TIMES (64)
+
+typedef struct {
+    vec4_t pos;     // xyz: center, w: roughness
+    vec4_t size;    // xyz: half extents
+    vec4_t color;
+} instance_t;
+
+typedef struct {
+    sg_image img;
+    sg_view att_view;
+    sg_view tex_view;
+} render_target_t;
+
+static struct {
+    bool compute_ok;
+    bool forward;
+    bool show_tiles;
+    int num_lights;
+    float time;
+    sg_buffer vbuf;
+    sg_buffer ibuf;
+    sg_buffer inst_buf;
+    sg_buffer light_buf;
+    sg_view light_view;
+    sg_pixel_format normal_format;
+    struct {
+        int width, height;
+        render_target_t albedo;
+        render_target_t normal;
+        render_target_t depth;
+        sg_pipeline pip;
+    } gbuffer;
+    struct {
+        sg_image img;
+        sg_view simg_view;
+        sg_view tex_view;
+        sg_pipeline pip;
+        sg_sampler smp;
+    } lighting;
+    struct {
+        sg_pipeline pip;
+    } blit;
+    struct {
+        sg_pipeline pip;
+    } forward_pass;
+    sg_pass_action display_pass_action;
+    float frame_times[NUM_FRAME_TIMES];
+    int frame_index;
+    sb_light_t lights[MAX_LIGHTS];
+    float light_phase[MAX_LIGHTS];
+} state;
+
+static uint32_t xorshift32(void) {
+    static uint32_t x = 0x12345678;
+    x ^= x<<13;
+    x ^= x>>17;
+    x ^= x<<5;
+    return x;
+}
+
+static float rnd(float min_val, float max_val) {
+    return min_val + (max_val - min_val) * ((float)(xorshift32() & 0xFFFF) / (float)0x10000);
+}
+
+static void reinit_gbuffer(int width, int height);
+
+static void init(void) {
+    sg_setup(&(sg_desc){
+        .environment = sglue_environment(),
+        .logger.func = slog_func,
+    });
+    sdtx_setup(&(sdtx_desc_t){
+        .fonts[0] = sdtx_font_oric(),
+        .logger.func = slog_func,
+    });
+    __dbgui_setup(sapp_sample_count());
+    state.display_pass_action = (sg_pass_action){
+        .colors[0] = { .load_action = SG_LOADACTION_CLEAR, .clear_value = { 0.05f, 0.05f, 0.08f, 1.0f } },
+    };
+
+    // the light culling compute pass needs compute shader support
+    // (in this case only an error message is rendered)
+    state.compute_ok = sg_query_features().compute;
+    if (!state.compute_ok) {
+        return;
+    }
+    // RG16 isn't renderable everywhere (e.g. WebGPU), fall back to RG16F
+    state.normal_format = sg_query_pixelformat(SG_PIXELFORMAT_RG16).render ? SG_PIXELFORMAT_RG16 : SG_PIXELFORMAT_RG16F;
+    state.num_lights = DEFAULT_NUM_LIGHTS;
+
+    // a box with normals, scaled and colored per instance
+    const float box_vertices[] = {
+        -1.0f, -1.0f, -1.0f,    0.0f, 0.0f, -1.0f,
+         1.0f, -1.0f, -1.0f,    0.0f, 0.0f, -1.0f,
+         1.0f,  1.0f, -1.0f,    0.0f, 0.0f, -1.0f,
+        -1.0f,  1.0f, -1.0f,    0.0f, 0.0f, -1.0f,
+
+        -1.0f, -1.0f,  1.0f,    0.0f, 0.0f, 1.0f,
+         1.0f, -1.0f,  1.0f,    0.0f, 0.0f, 1.0f,
+         1.0f,  1.0f,  1.0f,    0.0f, 0.0f, 1.0f,
+        -1.0f,  1.0f,  1.0f,    0.0f, 0.0f, 1.0f,
+
+        -1.0f, -1.0f, -1.0f,    -1.0f, 0.0f, 0.0f,
+        -1.0f,  1.0f, -1.0f,    -1.0f, 0.0f, 0.0f,
+        -1.0f,  1.0f,  1.0f,    -1.0f, 0.0f, 0.0f,
+        -1.0f, -1.0f,  1.0f,    -1.0f, 0.0f, 0.0f,
+
+         1.0f, -1.0f, -1.0f,    1.0f, 0.0f, 0.0f,
+         1.0f,  1.0f, -1.0f,    1.0f, 0.0f, 0.0f,
+         1.0f,  1.0f,  1.0f,    1.0f, 0.0f, 0.0f,
+         1.0f, -1.0f,  1.0f,    1.0f, 0.0f, 0.0f,
+
+        -1.0f, -1.0f, -1.0f,    0.0f, -1.0f, 0.0f,
+        -1.0f, -1.0f,  1.0f,    0.0f, -1.0f, 0.0f,
+         1.0f, -1.0f,  1.0f,    0.0f, -1.0f, 0.0f,
+         1.0f, -1.0f, -1.0f,    0.0f, -1.0f, 0.0f,
+
+        -1.0f,  1.0f, -1.0f,    0.0f, 1.0f, 0.0f,
+        -1.0f,  1.0f,  1.0f,    0.0f, 1.0f, 0.0f,
+         1.0f,  1.0f,  1.0f,    0.0f, 1.0f, 0.0f,
+         1.0f,  1.0f, -1.0f,    0.0f, 1.0f, 0.0f,
+    };
+    const uint16_t box_indices[] = {
+        0, 1, 2,  0, 2, 3,
+        6, 5, 4,  7, 6, 4,
+        8, 9, 10,  8, 10, 11,
+        14, 13, 12,  15, 14, 12,
+        16, 17, 18,  16, 18, 19,
+        22, 21, 20,  23, 22, 20,
+    };
+    state.vbuf = sg_make_buffer(&(sg_buffer_desc){
+        .data = SG_RANGE(box_vertices),
+        .label = "box-vertices",
+    });
+    state.ibuf = sg_make_buffer(&(sg_buffer_desc){
+        .usage.index_buffer = true,
+        .data = SG_RANGE(box_indices),
+        .label = "box-indices",
+    });
+
+    // a grid of pillars with random colors and roughness on a ground plate
+    static instance_t instances[NUM_INSTANCES];
+    const float cell = FIELD_SIZE / GRID_DIM;
+    for (int y = 0; y < GRID_DIM; y++) {
+        for (int x = 0; x < GRID_DIM; x++) {
+            const float h = rnd(0.5f, 2.5f);
+            instances[y * GRID_DIM + x] = (instance_t){
+                .pos = vec4((x + 0.5f) * cell - FIELD_SIZE * 0.5f, h, (y + 0.5f) * cell - FIELD_SIZE * 0.5f, rnd(0.1f, 0.9f)),
+                .size = vec4(cell * 0.25f, h, cell * 0.25f, 0.0f),
+                .color = vec4(rnd(0.4f, 1.0f), rnd(0.4f, 1.0f), rnd(0.4f, 1.0f), 1.0f),
+            };
+        }
+    }
+    instances[NUM_INSTANCES - 1] = (instance_t){
+        .pos = vec4(0.0f, -0.1f, 0.0f, 0.7f),
+        .size = vec4(FIELD_SIZE * 0.5f, 0.1f, FIELD_SIZE * 0.5f, 0.0f),
+        .color = vec4(0.8f, 0.8f, 0.8f, 1.0f),
+    };
+    state.inst_buf = sg_make_buffer(&(sg_buffer_desc){
+        .data = SG_RANGE(instances),
+        .label = "instances",
+    });
+
+    // the lights are animated on the CPU and uploaded each frame
+    for (int i = 0; i < MAX_LIGHTS; i++) {
+        state.lights[i] = (sb_light_t){
+            .pos_radius = vec4(rnd(-0.5f, 0.5f) * FIELD_SIZE, rnd(0.3f, 3.0f), rnd(-0.5f, 0.5f) * FIELD_SIZE, rnd(1.5f, 3.0f)),
+            .color = vec4(rnd(0.0f, 1.0f), rnd(0.0f, 1.0f), rnd(0.0f, 1.0f), 1.0f),
+        };
+        state.light_phase[i] = rnd(0.0f, 6.28f);
+    }
+    state.light_buf = sg_make_buffer(&(sg_buffer_desc){
+        .usage = { .storage_buffer = true, .stream_update = true },
+        .size = sizeof(state.lights),
+        .label = "lights",
+    });
+    state.light_view = sg_make_view(&(sg_view_desc){
+        .storage_buffer = { .buffer = state.light_buf },
+        .label = "lights-view",
+    });
+
+    // the G-buffer pipeline renders into 2 color attachments and the depth buffer
+    const sg_vertex_layout_state scene_layout = {
+        .buffers[1] = { .stride = sizeof(instance_t), .step_func = SG_VERTEXSTEP_PER_INSTANCE },
+        .attrs = {
+            [ATTR_gbuffer_pos] = { .format = SG_VERTEXFORMAT_FLOAT3, .buffer_index = 0 },
+            [ATTR_gbuffer_norm] = { .format = SG_VERTEXFORMAT_FLOAT3, .buffer_index = 0 },
+            [ATTR_gbuffer_inst_pos] = { .format = SG_VERTEXFORMAT_FLOAT4, .buffer_index = 1 },
+            [ATTR_gbuffer_inst_size] = { .format = SG_VERTEXFORMAT_FLOAT4, .buffer_index = 1 },
+            [ATTR_gbuffer_inst_color] = { .format = SG_VERTEXFORMAT_FLOAT4, .buffer_index = 1 },
+        },
+    };
+    state.gbuffer.pip = sg_make_pipeline(&(sg_pipeline_desc){
+        .shader = sg_make_shader(gbuffer_shader_desc(sg_query_backend())),
+        .layout = scene_layout,
+        .index_type = SG_INDEXTYPE_UINT16,
+        .cull_mode = SG_CULLMODE_BACK,
+        .sample_count = 1,
+        .depth = {
+            .pixel_format = SG_PIXELFORMAT_DEPTH,
+            .compare = SG_COMPAREFUNC_LESS_EQUAL,
+            .write_enabled = true,
+        },
+        .color_count = 2,
+        .colors = {
+            [0].pixel_format = SG_PIXELFORMAT_RGBA8,
+            [1].pixel_format = state.normal_format,
+        },
+        .label = "gbuffer-pipeline",
+    });
+
+    // the forward pipeline renders directly into the framebuffer (the vertex
+    // shader is the same, so is the vertex layout)
+    state.forward_pass.pip = sg_make_pipeline(&(sg_pipeline_desc){
+        .shader = sg_make_shader(forward_shader_desc(sg_query_backend())),
+        .layout = scene_layout,
+        .index_type = SG_INDEXTYPE_UINT16,
+        .cull_mode = SG_CULLMODE_BACK,
+        .depth = {
+            .compare = SG_COMPAREFUNC_LESS_EQUAL,
+            .write_enabled = true,
+        },
+        .label = "forward-pipeline",
+    });
+
+    state.lighting.pip = sg_make_pipeline(&(sg_pipeline_desc){
+        .compute = true,
+        .shader = sg_make_shader(lighting_shader_desc(sg_query_backend())),
+        .label = "lighting-pipeline",
+    });
+    state.lighting.smp = sg_make_sampler(&(sg_sampler_desc){
+        .min_filter = SG_FILTER_NEAREST,
+        .mag_filter = SG_FILTER_NEAREST,
+        .wrap_u = SG_WRAP_CLAMP_TO_EDGE,
+        .wrap_v = SG_WRAP_CLAMP_TO_EDGE,
+        .label = "gbuffer-sampler",
+    });
+    state.blit.pip = sg_make_pipeline(&(sg_pipeline_desc){
+        .shader = sg_make_shader(blit_shader_desc(sg_query_backend())),
+        .label = "blit-pipeline",
+    });
+
+    // pre-allocate the G-buffer handles, they are initialized in reinit_gbuffer()
+    // when the window size changes, same as in mrt-sapp.c
+    render_target_t* rts[3] = { &state.gbuffer.albedo, &state.gbuffer.normal, &state.gbuffer.depth };
+    for (int i = 0; i < 3; i++) {
+        rts[i]->img = sg_alloc_image();
+        rts[i]->att_view = sg_alloc_view();
+        rts[i]->tex_view = sg_alloc_view();
+    }
+    state.lighting.img = sg_alloc_image();
+    state.lighting.simg_view = sg_alloc_view();
+    state.lighting.tex_view = sg_alloc_view();
+    reinit_gbuffer(sapp_width(), sapp_height());
+}
+
+// called initially and when the window size changes
+static void reinit_gbuffer(int width, int height) {
+    state.gbuffer.width = width;
+    state.gbuffer.height = height;
+    const struct {
+        render_target_t* rt;
+        sg_pixel_format fmt;
+        const char* label;
+    } rts[3] = {
+        { &state.gbuffer.albedo, SG_PIXELFORMAT_RGBA8, "gbuffer-albedo-roughness" },
+        { &state.gbuffer.normal, state.normal_format, "gbuffer-normal" },
+        { &state.gbuffer.depth, SG_PIXELFORMAT_DEPTH, "gbuffer-depth" },
+    };
+    for (int i = 0; i < 3; i++) {
+        render_target_t* rt = rts[i].rt;
+        const bool is_depth = rts[i].fmt == SG_PIXELFORMAT_DEPTH;
+        sg_uninit_view(rt->att_view);
+        sg_uninit_view(rt->tex_view);
+        sg_uninit_image(rt->img);
+        sg_init_image(rt->img, &(sg_image_desc){
+            .usage = { .color_attachment = !is_depth, .depth_stencil_attachment = is_depth },
+            .width = width,
+            .height = height,
+            .pixel_format = rts[i].fmt,
+            .sample_count = 1,
+            .label = rts[i].label,
+        });
+        if (is_depth) {
+            sg_init_view(rt->att_view, &(sg_view_desc){ .depth_stencil_attachment.image = rt->img });
+        } else {
+            sg_init_view(rt->att_view, &(sg_view_desc){ .color_attachment.image = rt->img });
+        }
+        sg_init_view(rt->tex_view, &(sg_view_desc){ .texture.image = rt->img });
+    }
+    sg_uninit_view(state.lighting.simg_view);
+    sg_uninit_view(state.lighting.tex_view);
+    sg_uninit_image(state.lighting.img);
+    sg_init_image(state.lighting.img, &(sg_image_desc){
+        .usage.storage_image = true,
+        .width = width,
+        .height = height,
+        .pixel_format = SG_PIXELFORMAT_RGBA8,
+        .label = "lighting-image",
+    });
+    sg_init_view(state.lighting.simg_view, &(sg_view_desc){ .storage_image.image = state.lighting.img });
+    sg_init_view(state.lighting.tex_view, &(sg_view_desc){ .texture.image = state.lighting.img });
+}
+
+static void update_lights(float dt) {
+    state.time += dt;
+    for (int i = 0; i < state.num_lights; i++) {
+        const float a = state.time * 0.5f + state.light_phase[i];
+        state.lights[i].pos_radius.x += vm_sin(a) * dt;
+        state.lights[i].pos_radius.z += vm_cos(a) * dt;
+    }
+    sg_update_buffer(state.light_buf, &(sg_range){
+        .ptr = state.lights,
+        .size = (size_t)state.num_lights * sizeof(sb_light_t),
+    });
+}
+
+static void draw_scene(void) {
+    sg_draw(0, 36, NUM_INSTANCES);
+}
+
+static void draw_stats(void) {
+    state.frame_times[state.frame_index++ % NUM_FRAME_TIMES] = (float)sapp_frame_duration();
+    float avg = 0.0f;
+    for (int i = 0; i < NUM_FRAME_TIMES; i++) {
+        avg += state.frame_times[i];
+    }
+    avg /= NUM_FRAME_TIMES;
+
+    // estimated render target traffic per frame, without overdraw and caches
+    const double pixels = (double)state.gbuffer.width * (double)state.gbuffer.height;
+    const double mb = 1.0 / (1024.0 * 1024.0);
+    sdtx_canvas(sapp_widthf() * 0.5f, sapp_heightf() * 0.5f);
+    sdtx_origin(1.0f, 1.0f);
+    sdtx_printf("%s (SPACE), %d lights (UP/DOWN)\n\n", state.forward ? "forward" : "tiled deferred", state.num_lights);
+    sdtx_printf("frame time: %.2f ms\n\n", avg * 1000.0f);
+    if (state.forward) {
+        // color + depth write, all lights per fragment
+        sdtx_printf("framebuffer: 8 bytes/px, %.1f MB\n", pixels * 8.0 * mb);
+        sdtx_printf("lights per fragment: %d\n", state.num_lights);
+    } else {
+        // G-buffer write + read, lighting image write + read, framebuffer write
+        sdtx_printf("G-buffer: 12 bytes/px (%s normals)\n", (state.normal_format == SG_PIXELFORMAT_RG16) ? "RG16" : "RG16F");
+        sdtx_printf("traffic: %.1f MB (unpacked: %.1f MB)\n", pixels * (12.0 * 2.0 + 4.0 * 3.0) * mb, pixels * (32.0 * 2.0 + 4.0 * 3.0) * mb);
+        sdtx_printf("show tile light counts (T)\n");
+    }
+}
+
+static void frame(void) {
+    if (!state.compute_ok) {
+        sg_begin_pass(&(sg_pass){ .action = state.display_pass_action, .swapchain = sglue_swapchain() });
+        sdtx_canvas(sapp_widthf() * 0.5f, sapp_heightf() * 0.5f);
+        sdtx_origin(1.0f, 1.0f);
+        sdtx_puts("COMPUTE SHADERS NOT SUPPORTED");
+        sdtx_draw();
+        __dbgui_draw();
+        sg_end_pass();
+        sg_commit();
+        return;
+    }
+    update_lights((float)sapp_frame_duration());
+
+    const vec3_t eye_pos = vec3(vm_sin(state.time * 0.1f) * 20.0f, 10.0f, vm_cos(state.time * 0.1f) * 20.0f);
+    const mat44_t view = mat44_look_at_rh(eye_pos, vec3(0.0f, 0.0f, 0.0f), vec3(0.0f, 1.0f, 0.0f));
+    const mat44_t proj = mat44_perspective_fov_rh(vm_radians(60.0f), sapp_widthf() / sapp_heightf(), 0.1f, 100.0f);
+    const mat44_t view_proj = vm_mul(view, proj);
+    const vs_params_t vs_params = { .view_proj = view_proj };
+    const vec4_t ambient = vec4(0.05f, 0.05f, 0.08f, 1.0f);
+    const sg_bindings scene_bind = {
+        .vertex_buffers = { [0] = state.vbuf, [1] = state.inst_buf },
+        .index_buffer = state.ibuf,
+    };
+    draw_stats();
+
+    if (state.forward) {
+        sg_begin_pass(&(sg_pass){ .action = state.display_pass_action, .swapchain = sglue_swapchain() });
+        sg_apply_pipeline(state.forward_pass.pip);
+        sg_bindings bind = scene_bind;
+        bind.views[VIEW_fs_lights] = state.light_view;
+        sg_apply_bindings(&bind);
+        const fs_params_t fs_params = {
+            .eye_pos = vec4(eye_pos.x, eye_pos.y, eye_pos.z, 1.0f),
+            .ambient = ambient,
+            .num_lights = state.num_lights,
+        };
+        sg_apply_uniforms(UB_vs_params, &SG_RANGE(vs_params));
+        sg_apply_uniforms(UB_fs_params, &SG_RANGE(fs_params));
+        draw_scene();
+    } else {
+        // G-buffer pass, the attachment contents are fully overwritten
+        // where there's geometry, the background is detected via depth
+        sg_begin_pass(&(sg_pass){
+            .action = {
+                .colors = {
+                    [0] = { .load_action = SG_LOADACTION_DONTCARE },
+                    [1] = { .load_action = SG_LOADACTION_DONTCARE },
+                },
+                .depth = { .load_action = SG_LOADACTION_CLEAR, .store_action = SG_STOREACTION_STORE, .clear_value = 1.0f },
+            },
+            .attachments = {
+                .colors = { [0] = state.gbuffer.albedo.att_view, [1] = state.gbuffer.normal.att_view },
+                .depth_stencil = state.gbuffer.depth.att_view,
+            },
+            .label = "gbuffer-pass",
+        });
+        sg_apply_pipeline(state.gbuffer.pip);
+        sg_apply_bindings(&scene_bind);
+        sg_apply_uniforms(UB_vs_params, &SG_RANGE(vs_params));
+        draw_scene();
+        sg_end_pass();
+
+        // tiled light culling and shading
+        const sg_backend backend = sg_query_backend();
+        const bool gl = (backend == SG_BACKEND_GLCORE) || (backend == SG_BACKEND_GLES3);
+        mat44_t inv_proj, inv_view_proj;
+        mat44_inverse(&inv_proj, 0, proj);
+        mat44_inverse(&inv_view_proj, 0, view_proj);
+        const cs_params_t cs_params = {
+            .view = view,
+            .inv_proj = inv_proj,
+            .inv_view_proj = inv_view_proj,
+            .eye_pos = vec4(eye_pos.x, eye_pos.y, eye_pos.z, 1.0f),
+            .ambient = ambient,
+            .num_lights = state.num_lights,
+            .gl_depth = gl ? 1 : 0,
+            .flip_y = gl ? 0 : 1,
+            .show_tiles = state.show_tiles ? 1 : 0,
+        };
+        sg_begin_pass(&(sg_pass){ .compute = true, .label = "lighting-pass" });
+        sg_apply_pipeline(state.lighting.pip);
+        sg_apply_bindings(&(sg_bindings){
+            .views = {
+                [VIEW_albedo_tex] = state.gbuffer.albedo.tex_view,
+                [VIEW_normal_tex] = state.gbuffer.normal.tex_view,
+                [VIEW_depth_tex] = state.gbuffer.depth.tex_view,
+                [VIEW_cs_lights] = state.light_view,
+                [VIEW_color_img] = state.lighting.simg_view,
+            },
+            .samplers[SMP_gbuf_smp] = state.lighting.smp,
+        });
+        sg_apply_uniforms(UB_cs_params, &SG_RANGE(cs_params));
+        sg_dispatch((state.gbuffer.width + TILE_SIZE - 1) / TILE_SIZE, (state.gbuffer.height + TILE_SIZE - 1) / TILE_SIZE, 1);
+        sg_end_pass();
+
+        sg_begin_pass(&(sg_pass){ .action = state.display_pass_action, .swapchain = sglue_swapchain() });
+        sg_apply_pipeline(state.blit.pip);
+        sg_apply_bindings(&(sg_bindings){
+            .views[VIEW_blit_tex] = state.lighting.tex_view,
+            .samplers[SMP_blit_smp] = state.lighting.smp,
+        });
+        sg_draw(0, 3, 1);
+    }
+    sdtx_draw();
+    __dbgui_draw();
+    sg_end_pass();
+    sg_commit();
+}
+
+static void event(const sapp_event* ev) {
+    if (state.compute_ok) {
+        if (ev->type == SAPP_EVENTTYPE_RESIZED) {
+            reinit_gbuffer(ev->framebuffer_width, ev->framebuffer_height);
+        } else if (ev->type == SAPP_EVENTTYPE_KEY_DOWN) {
+            switch (ev->key_code) {
+                case SAPP_KEYCODE_SPACE:
+                    state.forward = !state.forward;
+                    break;
+                case SAPP_KEYCODE_UP:
+                    if (state.num_lights < MAX_LIGHTS) {
+                        state.num_lights *= 2;
+                    }
+                    break;
+                case SAPP_KEYCODE_DOWN:
+                    if (state.num_lights > MIN_LIGHTS) {
+                        state.num_lights /= 2;
+                    }
+                    break;
+                case SAPP_KEYCODE_T:
+                    state.show_tiles = !state.show_tiles;
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+    __dbgui_event(ev);
+}
+
+static void cleanup(void) {
+    __dbgui_shutdown();
+    sdtx_shutdown();
+    sg_shutdown();
+}
+
+sapp_desc sokol_main(int argc, char* argv[]) {
+    (void)argc; (void)argv;
+    return (sapp_desc){
+        .init_cb = init,
+        .frame_cb = frame,
+        .cleanup_cb = cleanup,
+        .event_cb = event,
+        .width = 1024,
+        .height = 768,
+        .window_title = "Tiled Deferred Shading (sokol-app)",
+        .icon.sokol_default = true,
+        .logger.func = slog_func,
+    };
+}
@@ -0,0 +1,297 @@
+//------------------------------------------------------------------------------
+//  shaders for deferred-sapp sample
+//------------------------------------------------------------------------------
+@ctype mat4 mat44_t
+@ctype vec4 vec4_t
+
+// point lights in a storage buffer, and the lighting function shared
+// by the deferred and forward paths
+@block lighting
+struct sb_light {
+    vec4 pos_radius;    // xyz: world space position, w: radius
+    vec4 color;
+};
+
+vec3 shade_light(sb_light l, vec3 pos, vec3 n, vec3 v, vec3 albedo, float roughness) {
+    const vec3 to_light = l.pos_radius.xyz - pos;
+    const float dist_sq = dot(to_light, to_light);
+    const float radius = l.pos_radius.w;
+    if (dist_sq >= (radius * radius)) {
+        return vec3(0.0);
+    }
+    const vec3 ld = to_light * inversesqrt(dist_sq);
+    const float n_dot_l = max(dot(n, ld), 0.0);
+    const float falloff = 1.0 - dist_sq / (radius * radius);
+    const float att = falloff * falloff;
+    const float shininess = exp2(10.0 * (1.0 - roughness) + 1.0);
+    const float spec = pow(max(dot(n, normalize(ld + v)), 0.0), shininess) * (1.0 - roughness);
+    return (albedo * n_dot_l + vec3(spec * n_dot_l)) * l.color.xyz * att;
+}
+@end
+
+// octahedral normal encoding into 2 channels in the 0..1 range
+@block octahedral
+vec2 oct_wrap(vec2 v) {
+    return (1.0 - abs(v.yx)) * vec2((v.x >= 0.0) ? 1.0 : -1.0, (v.y >= 0.0) ? 1.0 : -1.0);
+}
+
+vec2 oct_encode(vec3 n) {
+    n /= (abs(n.x) + abs(n.y) + abs(n.z));
+    const vec2 e = (n.z >= 0.0) ? n.xy : oct_wrap(n.xy);
+    return e * 0.5 + 0.5;
+}
+
+vec3 oct_decode(vec2 e) {
+    e = e * 2.0 - 1.0;
+    vec3 n = vec3(e.x, e.y, 1.0 - abs(e.x) - abs(e.y));
+    const float t = clamp(-n.z, 0.0, 1.0);
+    n.x += (n.x >= 0.0) ? -t : t;
+    n.y += (n.y >= 0.0) ? -t : t;
+    return normalize(n);
+}
+@end
+
+// instanced boxes, shared by the G-buffer and forward pass
+@block scene_vs
+layout(binding=0) uniform vs_params {
+    mat4 view_proj;
+};
+
+in vec3 pos;
+in vec3 norm;
+in vec4 inst_pos;       // xyz: center, w: roughness
+in vec4 inst_size;      // xyz: half extents
+in vec4 inst_color;
+
+out vec3 world_pos;
+out vec3 world_norm;
+out vec4 albedo_rough;
+
+void main() {
+    world_pos = inst_pos.xyz + pos * inst_size.xyz;
+    world_norm = norm;
+    albedo_rough = vec4(inst_color.xyz, inst_pos.w);
+    gl_Position = view_proj * vec4(world_pos, 1.0);
+}
+@end
+
+@vs vs_scene
+@include_block scene_vs
+@end
+
+//=== G-buffer pass: albedo + roughness in RGBA8, octahedral normal in RG16
+@fs fs_gbuffer
+@include_block octahedral
+
+in vec3 world_pos;
+in vec3 world_norm;
+in vec4 albedo_rough;
+
+layout(location=0) out vec4 frag_albedo_rough;
+layout(location=1) out vec4 frag_normal;
+
+void main() {
+    frag_albedo_rough = albedo_rough;
+    frag_normal = vec4(oct_encode(normalize(world_norm)), 0.0, 0.0);
+}
+@end
+
+@program gbuffer vs_scene fs_gbuffer
+
+//=== tiled deferred lighting: each workgroup culls the lights against the
+//    depth bounds of its 16x16 pixel tile into shared memory, and then
+//    shades its pixels with the tile's light list
+@cs cs_lighting
+@include_block lighting
+@include_block octahedral
+
+layout(binding=0) uniform cs_params {
+    mat4 view;
+    mat4 inv_proj;
+    mat4 inv_view_proj;
+    vec4 eye_pos;
+    vec4 ambient;
+    int num_lights;
+    int gl_depth;       // 1: GL clip space depth range -1..+1
+    int flip_y;         // 1: texel row 0 is the top of the image
+    int show_tiles;
+};
+
+@image_sample_type albedo_tex unfilterable_float
+layout(binding=0) uniform texture2D albedo_tex;
+@image_sample_type normal_tex unfilterable_float
+layout(binding=1) uniform texture2D normal_tex;
+@image_sample_type depth_tex unfilterable_float
+layout(binding=2) uniform texture2D depth_tex;
+@sampler_type gbuf_smp nonfiltering
+layout(binding=0) uniform sampler gbuf_smp;
+layout(binding=3) readonly buffer cs_lights { sb_light lights[]; };
+layout(binding=4, rgba8) uniform writeonly image2D color_img;
+
+#define TILE_SIZE (16)
+#define MAX_TILE_LIGHTS (256)
+
+shared uint tile_min_depth;
+shared uint tile_max_depth;
+shared uint tile_num_lights;
+shared uint tile_lights[MAX_TILE_LIGHTS];
+
+vec3 unproject(mat4 m, vec3 ndc) {
+    const vec4 p = m * vec4(ndc, 1.0);
+    return p.xyz / p.w;
+}
+
+vec2 pixel_to_ndc(vec2 pix, vec2 size) {
+    vec2 ndc = (pix / size) * 2.0 - 1.0;
+    if (flip_y != 0) {
+        ndc.y = -ndc.y;
+    }
+    return ndc;
+}
+
+float depth_to_ndc(float depth) {
+    return (gl_depth != 0) ? (depth * 2.0 - 1.0) : depth;
+}
+
+layout(local_size_x=TILE_SIZE, local_size_y=TILE_SIZE, local_size_z=1) in;
+void main() {
+    const ivec2 size = imageSize(color_img);
+    const ivec2 pix = ivec2(gl_GlobalInvocationID.xy);
+    const bool inside = all(lessThan(pix, size));
+    const uint tid = gl_LocalInvocationIndex;
+    if (tid == 0u) {
+        tile_min_depth = 0xFFFFFFFFu;
+        tile_max_depth = 0u;
+        tile_num_lights = 0u;
+    }
+    barrier();
+
+    // depth bounds of the tile, the background doesn't count (positive
+    // floats compare like their bit patterns)
+    const float depth = inside ? texelFetch(sampler2D(depth_tex, gbuf_smp), pix, 0).x : 1.0;
+    if (depth < 1.0) {
+        atomicMin(tile_min_depth, floatBitsToUint(depth));
+        atomicMax(tile_max_depth, floatBitsToUint(depth));
+    }
+    barrier();
+
+    if (tile_max_depth != 0u) {
+        // view space tile frustum: 4 side planes through the eye, and the depth bounds
+        const vec2 fsize = vec2(size);
+        const vec2 tile_min = vec2(gl_WorkGroupID.xy) * float(TILE_SIZE);
+        const vec2 tile_max = tile_min + float(TILE_SIZE);
+        const vec3 c0 = unproject(inv_proj, vec3(pixel_to_ndc(tile_min, fsize), 1.0));
+        const vec3 c1 = unproject(inv_proj, vec3(pixel_to_ndc(vec2(tile_max.x, tile_min.y), fsize), 1.0));
+        const vec3 c2 = unproject(inv_proj, vec3(pixel_to_ndc(tile_max, fsize), 1.0));
+        const vec3 c3 = unproject(inv_proj, vec3(pixel_to_ndc(vec2(tile_min.x, tile_max.y), fsize), 1.0));
+        const vec3 center = c0 + c1 + c2 + c3;
+        vec3 planes[4] = { cross(c0, c1), cross(c1, c2), cross(c2, c3), cross(c3, c0) };
+        for (int i = 0; i < 4; i++) {
+            planes[i] = normalize(planes[i]);
+            // the winding depends on the y direction, make all planes point inward
+            if (dot(planes[i], center) < 0.0) {
+                planes[i] = -planes[i];
+            }
+        }
+        const float near_z = unproject(inv_proj, vec3(0.0, 0.0, depth_to_ndc(uintBitsToFloat(tile_min_depth)))).z;
+        const float far_z = unproject(inv_proj, vec3(0.0, 0.0, depth_to_ndc(uintBitsToFloat(tile_max_depth)))).z;
+
+        for (uint i = tid; i < uint(num_lights); i += uint(TILE_SIZE * TILE_SIZE)) {
+            const vec3 p = (view * vec4(lights[i].pos_radius.xyz, 1.0)).xyz;
+            const float r = lights[i].pos_radius.w;
+            // view space looks along -z, near_z > far_z
+            bool visible = ((p.z - r) <= near_z) && ((p.z + r) >= far_z);
+            for (int k = 0; (k < 4) && visible; k++) {
+                visible = dot(planes[k], p) >= -r;
+            }
+            if (visible) {
+                const uint slot = atomicAdd(tile_num_lights, 1u);
+                if (slot < uint(MAX_TILE_LIGHTS)) {
+                    tile_lights[slot] = i;
+                }
+            }
+        }
+    }
+    barrier();
+
+    if (!inside) {
+        return;
+    }
+    const uint num_tile_lights = min(tile_num_lights, uint(MAX_TILE_LIGHTS));
+    vec3 c = ambient.xyz;
+    if (depth < 1.0) {
+        const vec4 albedo_rough = texelFetch(sampler2D(albedo_tex, gbuf_smp), pix, 0);
+        const vec3 n = oct_decode(texelFetch(sampler2D(normal_tex, gbuf_smp), pix, 0).xy);
+        const vec2 ndc_xy = pixel_to_ndc(vec2(pix) + 0.5, vec2(size));
+        const vec3 pos = unproject(inv_view_proj, vec3(ndc_xy, depth_to_ndc(depth)));
+        const vec3 v = normalize(eye_pos.xyz - pos);
+        c = albedo_rough.xyz * ambient.xyz;
+        for (uint i = 0u; i < num_tile_lights; i++) {
+            c += shade_light(lights[tile_lights[i]], pos, n, v, albedo_rough.xyz, albedo_rough.w);
+        }
+    }
+    if (show_tiles != 0) {
+        // light count heatmap, red at MAX_TILE_LIGHTS
+        const float heat = float(num_tile_lights) / float(MAX_TILE_LIGHTS);
+        c = mix(c, vec3(heat, 1.0 - heat, 0.0), 0.5);
+    }
+    imageStore(color_img, pix, vec4(pow(c, vec3(1.0 / 2.2)), 1.0));
+}
+@end
+
+@program lighting cs_lighting
+
+//=== copies the lighting result to the framebuffer
+@vs vs_blit
+const vec2 positions[3] = { vec2(-1, -1), vec2(3, -1), vec2(-1, 3), };
+
+void main() {
+    gl_Position = vec4(positions[gl_VertexIndex], 0, 1);
+}
+@end
+
+@fs fs_blit
+@image_sample_type blit_tex unfilterable_float
+layout(binding=0) uniform texture2D blit_tex;
+@sampler_type blit_smp nonfiltering
+layout(binding=0) uniform sampler blit_smp;
+
+out vec4 frag_color;
+
+void main() {
+    frag_color = texelFetch(sampler2D(blit_tex, blit_smp), ivec2(gl_FragCoord.xy), 0);
+}
+@end
+
+@program blit vs_blit fs_blit
+
+//=== forward path: every fragment loops over all lights
+@fs fs_forward
+@include_block lighting
+
+layout(binding=1) uniform fs_params {
+    vec4 eye_pos;
+    vec4 ambient;
+    int num_lights;
+};
+
+layout(binding=0) readonly buffer fs_lights { sb_light lights[]; };
+
+in vec3 world_pos;
+in vec3 world_norm;
+in vec4 albedo_rough;
+
+out vec4 frag_color;
+
+void main() {
+    const vec3 n = normalize(world_norm);
+    const vec3 v = normalize(eye_pos.xyz - world_pos);
+    vec3 c = albedo_rough.xyz * ambient.xyz;
+    for (int i = 0; i < num_lights; i++) {
+        c += shade_light(lights[i], world_pos, n, v, albedo_rough.xyz, albedo_rough.w);
+    }
+    frag_color = vec4(pow(c, vec3(1.0 / 2.2)), 1.0);
+}
+@end
+
+@program forward vs_scene fs_forward
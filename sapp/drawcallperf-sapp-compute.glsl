@@ -0,0 +1,277 @@
+// the bucketed, GPU-culled and Hi-Z render modes of drawcallperf-sapp.c,
+// only compiled for shader languages with storage buffers and compute shaders
+@ctype mat4 mat44_t
+@ctype vec4 vec4_t
+
+// the bucketed paths keep per-object data in a storage buffer, draws are
+// sorted by texture into buckets and each bucket is one instanced draw,
+// the instance index is translated into an object index through a storage
+// buffer of sorted object indices (with the bucket index in the top 8 bits)
+@block objects
+struct sb_object {
+    vec4 world_pos;
+};
+@end
+
+@vs vs_bucket
+@include_block objects
+
+layout(binding=0) uniform vs_bucket_per_frame {
+    mat4 viewproj;
+};
+
+layout(binding=1) uniform vs_per_bucket {
+    int first_slot;
+    int bucket;
+    int culled;
+};
+
+// bindings start at 1, binding 0 is the fragment shader texture
+layout(binding=1) readonly buffer vs_objects { sb_object objs[]; };
+layout(binding=2) readonly buffer vs_slots { uint slots[]; };
+layout(binding=3) readonly buffer vs_visible_counts { uint visible_counts[]; };
+
+in vec3 in_pos;
+in vec2 in_uv;
+in float in_bright;
+out vec2 uv;
+out float bright;
+
+void main() {
+    // with GPU culling, the instance count is still the bucket size, and
+    // instances past the visible count collapse into degenerate triangles
+    if ((culled != 0) && (uint(gl_InstanceIndex) >= visible_counts[bucket])) {
+        gl_Position = vec4(0.0, 0.0, 0.0, 0.0);
+        uv = vec2(0.0);
+        bright = 0.0;
+        return;
+    }
+    const uint obj_index = slots[first_slot + gl_InstanceIndex] & 0x00FFFFFFu;
+    const vec4 world_pos = objs[obj_index].world_pos;
+    gl_Position = viewproj * (world_pos + vec4(in_pos * 0.05, 1.0));
+    uv = in_uv;
+    bright = in_bright;
+}
+@end
+
+@fs fs_bucket
+layout(binding=0) uniform texture2D bucket_tex;
+layout(binding=0) uniform sampler bucket_smp;
+
+in vec2 uv;
+in float bright;
+out vec4 frag_color;
+
+void main() {
+    frag_color = vec4(texture(sampler2D(bucket_tex, bucket_smp), uv).xyz * bright, 1.0);
+}
+@end
+
+@program drawcallperf_bucket vs_bucket fs_bucket
+
+// frustum culling, writes the visible object indices of each bucket
+// compacted to the start of the bucket's range
+@cs cs_cull_clear
+layout(binding=4) buffer cs_visible_counts { uint visible_counts[]; };
+
+layout(local_size_x=4, local_size_y=1, local_size_z=1) in;
+void main() {
+    visible_counts[gl_GlobalInvocationID.x] = 0u;
+}
+@end
+
+@cs cs_cull
+@include_block objects
+
+layout(binding=0) uniform cs_cull_params {
+    vec4 planes[6];
+    float radius;
+};
+
+layout(binding=1) uniform cs_cull_slots {
+    ivec4 bucket_first;
+    int num_slots;
+};
+
+layout(binding=1) readonly buffer cs_objects { sb_object objs[]; };
+layout(binding=2) readonly buffer cs_slots { uint slots[]; };
+layout(binding=4) buffer cs_visible_counts { uint visible_counts[]; };
+layout(binding=5) buffer cs_visible_slots { uint visible_slots[]; };
+
+layout(local_size_x=64, local_size_y=1, local_size_z=1) in;
+void main() {
+    const uint idx = gl_GlobalInvocationID.x;
+    if (idx >= num_slots) {
+        return;
+    }
+    const uint slot = slots[idx];
+    const vec3 pos = objs[slot & 0x00FFFFFFu].world_pos.xyz;
+    for (int i = 0; i < 6; i++) {
+        if ((dot(planes[i].xyz, pos) + planes[i].w) < -radius) {
+            return;
+        }
+    }
+    const uint bucket = slot >> 24;
+    const uint dst = atomicAdd(visible_counts[bucket], 1u);
+    visible_slots[bucket_first[bucket] + dst] = slot;
+}
+@end
+
+@program cull_clear cs_cull_clear
+@program cull cs_cull
+
+// Hi-Z occlusion culling: copy the depth buffer of the first pass into mip
+// level 0 of an R32F storage image, the rest of the max-depth pyramid
+// is built with mipgen.h
+@cs cs_hiz_copy
+@image_sample_type depth_tex unfilterable_float
+layout(binding=0) uniform texture2D depth_tex;
+@sampler_type depth_smp nonfiltering
+layout(binding=0) uniform sampler depth_smp;
+layout(binding=1, r32f) uniform writeonly image2D hiz_mip0;
+
+layout(local_size_x=16, local_size_y=16, local_size_z=1) in;
+void main() {
+    const ivec2 pos = ivec2(gl_GlobalInvocationID.xy);
+    if (all(lessThan(pos, imageSize(hiz_mip0)))) {
+        imageStore(hiz_mip0, pos, vec4(texelFetch(sampler2D(depth_tex, depth_smp), pos, 0).x));
+    }
+}
+@end
+
+@program hiz_copy cs_hiz_copy
+
+// frustum and occlusion culling against the max-depth pyramid, writes the
+// visible objects of each bucket (drawn first in the next frame), and the
+// visible objects which were not visible in the previous frame (drawn
+// after the culling pass)
+@cs cs_hiz_cull
+@include_block objects
+
+layout(binding=0) uniform cs_hiz_params {
+    mat4 viewproj;
+    vec4 planes[6];
+    vec4 screen_map;    // NDC to window space: depth scale, depth bias, y scale, y bias
+    ivec4 bucket_first;
+    vec2 hiz_size;
+    float radius;
+    float half_extent;
+    int num_slots;
+    int num_levels;
+    int use_history;
+};
+
+@image_sample_type hiz_tex unfilterable_float
+layout(binding=0) uniform texture2D hiz_tex;
+@sampler_type hiz_smp nonfiltering
+layout(binding=0) uniform sampler hiz_smp;
+layout(binding=1) readonly buffer cs_objects { sb_object objs[]; };
+layout(binding=2) readonly buffer cs_slots { uint slots[]; };
+layout(binding=4) buffer cs_visible_counts { uint visible_counts[]; };
+layout(binding=5) buffer cs_visible_slots { uint visible_slots[]; };
+layout(binding=6) buffer cs_new_counts { uint new_counts[]; };
+layout(binding=7) buffer cs_new_slots { uint new_slots[]; };
+layout(binding=8) buffer cs_visible_flags { uint visible_flags[]; };
+
+// max depth under a window space rectangle, from the pyramid level
+// where the rectangle covers at most 2x2 texels, a pixel past the
+// last texel of an odd-sized level is clamped to that texel, which
+// also covers it
+float hiz_max_depth(vec2 uv_min, vec2 uv_max) {
+    const vec2 px_min = clamp(uv_min * hiz_size, vec2(0.0), hiz_size - 1.0);
+    const vec2 px_max = clamp(uv_max * hiz_size, vec2(0.0), hiz_size - 1.0);
+    const vec2 extent = px_max - px_min + 1.0;
+    const int level = clamp(int(ceil(log2(max(extent.x, extent.y)))), 0, num_levels - 1);
+    const ivec2 level_max = textureSize(sampler2D(hiz_tex, hiz_smp), level) - 1;
+    const ivec2 t0 = min(ivec2(px_min) >> level, level_max);
+    const ivec2 t1 = min(ivec2(px_max) >> level, level_max);
+    float depth = 0.0;
+    for (int y = t0.y; y <= t1.y; y++) {
+        for (int x = t0.x; x <= t1.x; x++) {
+            depth = max(depth, texelFetch(sampler2D(hiz_tex, hiz_smp), ivec2(x, y), level).x);
+        }
+    }
+    return depth;
+}
+
+bool occluded(vec3 pos) {
+    // project the bounding box corners, boxes crossing the
+    // camera plane are never occluded
+    vec3 ndc_min = vec3(1.0e9);
+    vec3 ndc_max = vec3(-1.0e9);
+    for (int i = 0; i < 8; i++) {
+        const vec3 corner = pos + vec3(
+            ((i & 1) != 0) ? half_extent : -half_extent,
+            ((i & 2) != 0) ? half_extent : -half_extent,
+            ((i & 4) != 0) ? half_extent : -half_extent);
+        const vec4 clip = viewproj * vec4(corner, 1.0);
+        if (clip.w <= 0.0) {
+            return false;
+        }
+        const vec3 ndc = clip.xyz / clip.w;
+        ndc_min = min(ndc_min, ndc);
+        ndc_max = max(ndc_max, ndc);
+    }
+    const float depth = ndc_min.z * screen_map.x + screen_map.y;
+    const float y0 = ndc_min.y * screen_map.z + screen_map.w;
+    const float y1 = ndc_max.y * screen_map.z + screen_map.w;
+    const vec2 uv_min = vec2(ndc_min.x * 0.5 + 0.5, min(y0, y1));
+    const vec2 uv_max = vec2(ndc_max.x * 0.5 + 0.5, max(y0, y1));
+    return depth > hiz_max_depth(uv_min, uv_max);
+}
+
+layout(local_size_x=64, local_size_y=1, local_size_z=1) in;
+void main() {
+    const uint idx = gl_GlobalInvocationID.x;
+    if (idx >= num_slots) {
+        return;
+    }
+    const uint slot = slots[idx];
+    const uint obj_index = slot & 0x00FFFFFFu;
+    const vec3 pos = objs[obj_index].world_pos.xyz;
+    bool visible = true;
+    for (int i = 0; i < 6; i++) {
+        if ((dot(planes[i].xyz, pos) + planes[i].w) < -radius) {
+            visible = false;
+        }
+    }
+    if (visible) {
+        visible = !occluded(pos);
+    }
+    const bool was_visible = (use_history != 0) && (visible_flags[obj_index] != 0u);
+    visible_flags[obj_index] = visible ? 1u : 0u;
+    if (visible) {
+        const uint bucket = slot >> 24;
+        visible_slots[bucket_first[bucket] + atomicAdd(visible_counts[bucket], 1u)] = slot;
+        if (!was_visible) {
+            new_slots[bucket_first[bucket] + atomicAdd(new_counts[bucket], 1u)] = slot;
+        }
+    }
+}
+@end
+
+@program hiz_cull cs_hiz_cull
+
+// copies the offscreen color target of the Hi-Z mode to the framebuffer
+@vs vs_blit
+const vec2 positions[3] = { vec2(-1, -1), vec2(3, -1), vec2(-1, 3), };
+
+void main() {
+    gl_Position = vec4(positions[gl_VertexIndex], 0, 1);
+}
+@end
+
+@fs fs_blit
+@image_sample_type blit_tex unfilterable_float
+layout(binding=0) uniform texture2D blit_tex;
+@sampler_type blit_smp nonfiltering
+layout(binding=0) uniform sampler blit_smp;
+
+out vec4 frag_color;
+
+void main() {
+    frag_color = texelFetch(sampler2D(blit_tex, blit_smp), ivec2(gl_FragCoord.xy), 0);
+}
+@end
+
+@program blit vs_blit fs_blit
@@ -1,5 +1,24 @@
 //------------------------------------------------------------------------------
 //  drawcallperf-sapp.c
+//
+//  Compares three ways to render many small objects:
+//
+//  - per-draw: one uniform update and draw call per object, with
+//    rebinding the texture every 'DC/texture' draws
+//  - buckets: per-object data lives in a storage buffer, objects are
+//    sorted by texture into buckets, and each bucket is one instanced
+//    draw which looks up the object through the instance index
+//  - buckets + GPU culling: like buckets, but a compute pass does
+//    frustum culling and compacts the visible objects of each bucket
+//  - buckets + Hi-Z culling: two-pass occlusion culling, first the
+//    objects visible in the previous frame are drawn, a max-depth
+//    pyramid is built from the resulting depth buffer, a compute pass
+//    tests all objects against the frustum and the pyramid, and the
+//    objects which became visible are drawn in a second pass
+//
+//  The bucketed paths need storage buffer and compute shader support, their
+//  shaders are in drawcallperf-sapp-compute.glsl, which is only compiled
+//  where sokol-shdc can generate compute shaders (HAS_COMPUTE_SHADERS).
 //------------------------------------------------------------------------------
 #include "sokol_gfx.h"
 #include "sokol_app.h"
@@ -13,13 +32,39 @@
 #include "sokol_gfx_imgui.h"
 #define VECMATH_GENERICS
 #include "vecmath/vecmath.h"
+#include "util/frustum.h"
+#include "util/mipgen.h"
+#include "util/sgprof.h"
 #include "drawcallperf-sapp.glsl.h"
+#if defined(HAS_COMPUTE_SHADERS)
+#include "drawcallperf-sapp-compute.glsl.h"
+#endif
 
 #define NUM_IMAGES (3)
 #define IMG_WIDTH (8)
 #define IMG_HEIGHT (8)
 #define MAX_INSTANCES (100000)
 #define MAX_BIND_FREQUENCY (1000)
+#define MAX_BUCKETS (4)
+#define BENCH_WARMUP_FRAMES (30)
+#define BENCH_FRAMES (120)
+#define PROF_CAPTURE_PATH "drawcallperf.sgprof"
+#define PROF_CAPTURE_FRAMES (60)
+
+typedef enum {
+    RENDER_MODE_PER_DRAW,
+    RENDER_MODE_BUCKETS,
+    RENDER_MODE_BUCKETS_CULLED,
+    RENDER_MODE_BUCKETS_HIZ,
+    NUM_RENDER_MODES,
+} render_mode_t;
+
+static const char* render_mode_names[NUM_RENDER_MODES] = {
+    "Per-draw uniforms",
+    "Bucketed instancing",
+    "Bucketed instancing + GPU culling",
+    "Bucketed instancing + Hi-Z occlusion culling",
+};
 
 static struct {
     sg_pass_action pass_action;
@@ -29,18 +74,86 @@ static struct {
     sg_bindings bind;
     int num_instances;
     int bind_frequency;
+    render_mode_t mode;
+    float cam_dist;
     float angle;
     uint64_t last_time;
+    double encode_time_ms;
+    // storage buffers and pipelines for the bucketed paths
+    struct {
+        bool supported;
+        bool dirty;
+        int num_instances;
+        int bind_frequency;
+        int first[MAX_BUCKETS];
+        int count[MAX_BUCKETS];
+        sg_pipeline pip;
+        sg_pipeline cull_clear_pip;
+        sg_pipeline cull_pip;
+        sg_view objects_view;
+        sg_buffer slots_buf;
+        sg_view slots_view;
+        sg_view visible_counts_view;
+        sg_view visible_slots_view;
+    } bucket;
+    #if defined(HAS_COMPUTE_SHADERS)
+    // the Hi-Z mode renders into offscreen targets of framebuffer size,
+    // the visible lists of the previous frame are only valid if the
+    // previous frame was also rendered in Hi-Z mode with the same buckets
+    struct {
+        int width;
+        int height;
+        int num_levels;
+        bool history_valid;
+        sg_image color_img;
+        sg_image depth_img;
+        sg_image hiz_img;
+        sg_view color_att_view;
+        sg_view depth_att_view;
+        sg_view color_tex_view;
+        sg_view depth_tex_view;
+        sg_view hiz_tex_view;
+        sg_view hiz_simg_view;
+        mipgen_chain_t* chain;
+        sg_sampler smp;
+        sg_pipeline pip;
+        sg_pipeline copy_pip;
+        sg_pipeline cull_pip;
+        sg_pipeline blit_pip;
+        sg_view new_counts_view;
+        sg_view new_slots_view;
+        sg_view visible_flags_view;
+    } hiz;
+    #endif
+    // cycles through the render modes at MAX_INSTANCES
+    struct {
+        bool active;
+        int mode;
+        int frame;
+        double frame_time_ms;
+        double encode_time_ms;
+        double result_frame_ms[NUM_RENDER_MODES];
+        double result_encode_ms[NUM_RENDER_MODES];
+    } bench;
     struct {
         int num_uniform_updates;
         int num_binding_updates;
         int num_draw_calls;
     } stats;
+    // optional sokol-gfx call profiling with util/sgprof.h
+    struct {
+        bool enabled;
+        bool capture_failed;
+    } prof;
     const char* backend;
     sgimgui_t sgimgui;
 } state;
 
 static vs_per_instance_t positions[MAX_INSTANCES];
+#if defined(HAS_COMPUTE_SHADERS)
+// object indices sorted by bucket, with the bucket index in the top 8 bits
+static uint32_t slots[MAX_INSTANCES];
+#endif
 
 static inline uint32_t xorshift32(void) {
     static uint32_t x = 0x12345678;
@@ -73,6 +186,7 @@ static void init(void) {
     };
     state.num_instances = 100;
     state.bind_frequency = MAX_BIND_FREQUENCY;
+    state.cam_dist = 4.5f;
 
     switch (sg_query_backend()) {
         case SG_BACKEND_GLCORE: state.backend = "GLCORE"; break;
@@ -185,19 +299,538 @@ static void init(void) {
     for (int i = 0; i < MAX_INSTANCES; i++) {
         positions[i].world_pos = rand_pos();
     }
+
+    // resources for the bucketed paths, the object data storage buffer
+    // has the same layout as the per-instance uniform block
+    #if defined(HAS_COMPUTE_SHADERS)
+    state.bucket.supported = sg_query_features().compute;
+    if (state.bucket.supported) {
+        state.bucket.dirty = true;
+        state.bucket.objects_view = sg_make_view(&(sg_view_desc){
+            .storage_buffer = {
+                .buffer = sg_make_buffer(&(sg_buffer_desc){
+                    .usage.storage_buffer = true,
+                    .data = SG_RANGE(positions),
+                    .label = "objects",
+                }),
+            },
+        });
+        state.bucket.slots_buf = sg_make_buffer(&(sg_buffer_desc){
+            .usage = { .storage_buffer = true, .dynamic_update = true },
+            .size = sizeof(slots),
+            .label = "slots",
+        });
+        state.bucket.slots_view = sg_make_view(&(sg_view_desc){
+            .storage_buffer = { .buffer = state.bucket.slots_buf },
+        });
+        state.bucket.visible_counts_view = sg_make_view(&(sg_view_desc){
+            .storage_buffer = {
+                .buffer = sg_make_buffer(&(sg_buffer_desc){
+                    .usage.storage_buffer = true,
+                    .size = MAX_BUCKETS * sizeof(uint32_t),
+                    .label = "visible-counts",
+                }),
+            },
+        });
+        state.bucket.visible_slots_view = sg_make_view(&(sg_view_desc){
+            .storage_buffer = {
+                .buffer = sg_make_buffer(&(sg_buffer_desc){
+                    .usage.storage_buffer = true,
+                    .size = sizeof(slots),
+                    .label = "visible-slots",
+                }),
+            },
+        });
+        // the bucket shader is shared with the offscreen pipeline of the Hi-Z mode
+        const sg_shader bucket_shd = sg_make_shader(drawcallperf_bucket_shader_desc(sg_query_backend()));
+        state.bucket.pip = sg_make_pipeline(&(sg_pipeline_desc){
+            .layout = {
+                .attrs = {
+                    [ATTR_drawcallperf_bucket_in_pos] = { .format = SG_VERTEXFORMAT_FLOAT3 },
+                    [ATTR_drawcallperf_bucket_in_uv] = { .format = SG_VERTEXFORMAT_FLOAT2 },
+                    [ATTR_drawcallperf_bucket_in_bright] = { .format = SG_VERTEXFORMAT_FLOAT },
+                }
+            },
+            .shader = bucket_shd,
+            .index_type = SG_INDEXTYPE_UINT16,
+            .cull_mode = SG_CULLMODE_BACK,
+            .depth = {
+                .write_enabled = true,
+                .compare = SG_COMPAREFUNC_LESS_EQUAL,
+            },
+            .label = "bucket-pipeline",
+        });
+        state.bucket.cull_clear_pip = sg_make_pipeline(&(sg_pipeline_desc){
+            .compute = true,
+            .shader = sg_make_shader(cull_clear_shader_desc(sg_query_backend())),
+            .label = "cull-clear-pipeline",
+        });
+        state.bucket.cull_pip = sg_make_pipeline(&(sg_pipeline_desc){
+            .compute = true,
+            .shader = sg_make_shader(cull_shader_desc(sg_query_backend())),
+            .label = "cull-pipeline",
+        });
+
+        // Hi-Z mode resources, the offscreen render targets and the
+        // depth pyramid are created in hiz_resize()
+        mipgen_setup();
+        state.hiz.new_counts_view = sg_make_view(&(sg_view_desc){
+            .storage_buffer = {
+                .buffer = sg_make_buffer(&(sg_buffer_desc){
+                    .usage.storage_buffer = true,
+                    .size = MAX_BUCKETS * sizeof(uint32_t),
+                    .label = "new-counts",
+                }),
+            },
+        });
+        state.hiz.new_slots_view = sg_make_view(&(sg_view_desc){
+            .storage_buffer = {
+                .buffer = sg_make_buffer(&(sg_buffer_desc){
+                    .usage.storage_buffer = true,
+                    .size = sizeof(slots),
+                    .label = "new-slots",
+                }),
+            },
+        });
+        state.hiz.visible_flags_view = sg_make_view(&(sg_view_desc){
+            .storage_buffer = {
+                .buffer = sg_make_buffer(&(sg_buffer_desc){
+                    .usage.storage_buffer = true,
+                    .size = MAX_INSTANCES * sizeof(uint32_t),
+                    .label = "visible-flags",
+                }),
+            },
+        });
+        state.hiz.smp = sg_make_sampler(&(sg_sampler_desc){
+            .min_filter = SG_FILTER_NEAREST,
+            .mag_filter = SG_FILTER_NEAREST,
+            .wrap_u = SG_WRAP_CLAMP_TO_EDGE,
+            .wrap_v = SG_WRAP_CLAMP_TO_EDGE,
+            .label = "hiz-sampler",
+        });
+        state.hiz.pip = sg_make_pipeline(&(sg_pipeline_desc){
+            .layout = {
+                .attrs = {
+                    [ATTR_drawcallperf_bucket_in_pos] = { .format = SG_VERTEXFORMAT_FLOAT3 },
+                    [ATTR_drawcallperf_bucket_in_uv] = { .format = SG_VERTEXFORMAT_FLOAT2 },
+                    [ATTR_drawcallperf_bucket_in_bright] = { .format = SG_VERTEXFORMAT_FLOAT },
+                }
+            },
+            .shader = bucket_shd,
+            .index_type = SG_INDEXTYPE_UINT16,
+            .cull_mode = SG_CULLMODE_BACK,
+            .sample_count = 1,
+            .depth = {
+                .write_enabled = true,
+                .compare = SG_COMPAREFUNC_LESS_EQUAL,
+                .pixel_format = SG_PIXELFORMAT_DEPTH,
+            },
+            .colors[0].pixel_format = SG_PIXELFORMAT_RGBA8,
+            .label = "hiz-bucket-pipeline",
+        });
+        state.hiz.copy_pip = sg_make_pipeline(&(sg_pipeline_desc){
+            .compute = true,
+            .shader = sg_make_shader(hiz_copy_shader_desc(sg_query_backend())),
+            .label = "hiz-copy-pipeline",
+        });
+        state.hiz.cull_pip = sg_make_pipeline(&(sg_pipeline_desc){
+            .compute = true,
+            .shader = sg_make_shader(hiz_cull_shader_desc(sg_query_backend())),
+            .label = "hiz-cull-pipeline",
+        });
+        state.hiz.blit_pip = sg_make_pipeline(&(sg_pipeline_desc){
+            .shader = sg_make_shader(blit_shader_desc(sg_query_backend())),
+            .label = "hiz-blit-pipeline",
+        });
+    }
+    #endif
+}
+
+#if defined(HAS_COMPUTE_SHADERS)
+// (re-)create the offscreen render targets and depth pyramid of the Hi-Z
+// mode when the framebuffer size changes
+static void hiz_resize(void) {
+    const int width = sapp_width();
+    const int height = sapp_height();
+    if ((width == state.hiz.width) && (height == state.hiz.height)) {
+        return;
+    }
+    if (state.hiz.chain) {
+        mipgen_destroy_chain(state.hiz.chain);
+        sg_destroy_view(state.hiz.color_att_view);
+        sg_destroy_view(state.hiz.depth_att_view);
+        sg_destroy_view(state.hiz.color_tex_view);
+        sg_destroy_view(state.hiz.depth_tex_view);
+        sg_destroy_view(state.hiz.hiz_tex_view);
+        sg_destroy_view(state.hiz.hiz_simg_view);
+        sg_destroy_image(state.hiz.color_img);
+        sg_destroy_image(state.hiz.depth_img);
+        sg_destroy_image(state.hiz.hiz_img);
+    }
+    state.hiz.width = width;
+    state.hiz.height = height;
+    state.hiz.history_valid = false;
+    state.hiz.num_levels = 1;
+    for (int size = (width > height) ? width : height; (size > 1) && (state.hiz.num_levels < SG_MAX_MIPMAPS); size >>= 1) {
+        state.hiz.num_levels++;
+    }
+    state.hiz.color_img = sg_make_image(&(sg_image_desc){
+        .usage.color_attachment = true,
+        .width = width,
+        .height = height,
+        .pixel_format = SG_PIXELFORMAT_RGBA8,
+        .sample_count = 1,
+        .label = "hiz-color-image",
+    });
+    state.hiz.depth_img = sg_make_image(&(sg_image_desc){
+        .usage.depth_stencil_attachment = true,
+        .width = width,
+        .height = height,
+        .pixel_format = SG_PIXELFORMAT_DEPTH,
+        .sample_count = 1,
+        .label = "hiz-depth-image",
+    });
+    // the depth pyramid stores the max depth, so that a texel is
+    // in front of everything it covers, on odd level sizes the last
+    // texel of a row or column also covers the 3rd texel of the level
+    // above (see MIPGEN_FILTER_MAX), the cull shader relies on this
+    // when it clamps texel coordinates to the level size
+    state.hiz.hiz_img = sg_make_image(&(sg_image_desc){
+        .usage.storage_image = true,
+        .width = width,
+        .height = height,
+        .num_mipmaps = state.hiz.num_levels,
+        .pixel_format = SG_PIXELFORMAT_R32F,
+        .label = "hiz-pyramid-image",
+    });
+    state.hiz.color_att_view = sg_make_view(&(sg_view_desc){ .color_attachment.image = state.hiz.color_img });
+    state.hiz.depth_att_view = sg_make_view(&(sg_view_desc){ .depth_stencil_attachment.image = state.hiz.depth_img });
+    state.hiz.color_tex_view = sg_make_view(&(sg_view_desc){ .texture.image = state.hiz.color_img });
+    state.hiz.depth_tex_view = sg_make_view(&(sg_view_desc){ .texture.image = state.hiz.depth_img });
+    state.hiz.hiz_tex_view = sg_make_view(&(sg_view_desc){ .texture.image = state.hiz.hiz_img });
+    state.hiz.hiz_simg_view = sg_make_view(&(sg_view_desc){ .storage_image.image = state.hiz.hiz_img });
+    state.hiz.chain = mipgen_make_chain(&(mipgen_chain_desc_t){ .image = state.hiz.hiz_img });
+}
+
+// sort the objects by texture into buckets with a counting sort, the
+// texture assignment is the same as in the per-draw path
+static void build_buckets(void) {
+    static uint8_t textures[MAX_INSTANCES];
+    int cur_bind_count = 0;
+    int cur_img = 0;
+    int tex = 0;
+    for (int i = 0; i < MAX_BUCKETS; i++) {
+        state.bucket.count[i] = 0;
+    }
+    for (int i = 0; i < state.num_instances; i++) {
+        if (++cur_bind_count == state.bind_frequency) {
+            cur_bind_count = 0;
+            if (cur_img == NUM_IMAGES) {
+                cur_img = 0;
+            }
+            tex = cur_img++;
+        }
+        textures[i] = (uint8_t)tex;
+        state.bucket.count[tex]++;
+    }
+    int first = 0;
+    int cursor[MAX_BUCKETS];
+    for (int i = 0; i < MAX_BUCKETS; i++) {
+        state.bucket.first[i] = cursor[i] = first;
+        first += state.bucket.count[i];
+    }
+    for (int i = 0; i < state.num_instances; i++) {
+        const uint32_t bucket = textures[i];
+        slots[cursor[bucket]++] = (uint32_t)i | (bucket << 24);
+    }
+    sg_update_buffer(state.bucket.slots_buf, &(sg_range){ .ptr = slots, .size = (size_t)state.num_instances * sizeof(uint32_t) });
+    state.bucket.num_instances = state.num_instances;
+    state.bucket.bind_frequency = state.bind_frequency;
+    state.bucket.dirty = false;
+    // the slots have moved, the visible lists of the Hi-Z mode are stale
+    state.hiz.history_valid = false;
+}
+
+// frustum planes and the bounding sphere radius of the objects for culling
+static void compute_frustum_planes(const mat44_t* viewproj, cs_cull_params_t* params) {
+    frustum_planes(viewproj, params->planes);
+    // bounding sphere radius of the cube
+    params->radius = 0.05f * 1.7320508f;
 }
+#endif
 
 static mat44_t compute_viewproj(void) {
     const float w = sapp_widthf();
     const float h = sapp_heightf();
     state.angle = fmodf(state.angle + 0.01, 360.0f);
-    const float dist = 4.5f;
+    const float dist = state.cam_dist;
     const vec3_t eye = vec3(vm_sin(state.angle) * dist, 1.5f, vm_cos(state.angle) * dist);
     const mat44_t proj = mat44_perspective_fov_rh(vm_radians(60.0f), w/h, 0.01f, 10.0f);
     const mat44_t view = mat44_look_at_rh(eye, vec3(0.0f, 0.0f, 0.0f), vec3(0.0f, 1.0f, 0.0f));
     return vm_mul(view, proj);
 }
 
+// one uniform update and draw call per instance
+static void draw_per_draw(const vs_per_frame_t* vs_per_frame) {
+    sg_apply_pipeline(state.pip);
+    sg_apply_uniforms(UB_vs_per_frame, &(sg_range){ vs_per_frame, sizeof(vs_per_frame_t) });
+    state.stats.num_uniform_updates++;
+
+    state.bind.views[VIEW_tex] = state.view[0];
+    sg_apply_bindings(&state.bind);
+    state.stats.num_binding_updates++;
+    int cur_bind_count = 0;
+    int cur_img = 0;
+    for (int i = 0; i < state.num_instances; i++) {
+        if (++cur_bind_count == state.bind_frequency) {
+            cur_bind_count = 0;
+            if (cur_img == NUM_IMAGES) {
+                cur_img = 0;
+            }
+            state.bind.views[VIEW_tex] = state.view[cur_img++];
+            sg_apply_bindings(&state.bind);
+            state.stats.num_binding_updates++;
+        }
+        sg_apply_uniforms(UB_vs_per_instance, &SG_RANGE(positions[i]));
+        state.stats.num_uniform_updates++;
+        sg_draw(0, 36, 1);
+        state.stats.num_draw_calls++;
+    }
+}
+
+#if defined(HAS_COMPUTE_SHADERS)
+// frustum culling compute pass, must be called outside a render pass
+static void cull_buckets(const mat44_t* viewproj) {
+    cs_cull_params_t cull_params;
+    compute_frustum_planes(viewproj, &cull_params);
+    cs_cull_slots_t cull_slots = { .num_slots = state.bucket.num_instances };
+    for (int i = 0; i < MAX_BUCKETS; i++) {
+        cull_slots.bucket_first[i] = state.bucket.first[i];
+    }
+    sg_begin_pass(&(sg_pass){ .compute = true, .label = "cull-pass" });
+    sg_apply_pipeline(state.bucket.cull_clear_pip);
+    sg_apply_bindings(&(sg_bindings){
+        .views[VIEW_cs_visible_counts] = state.bucket.visible_counts_view,
+    });
+    sg_dispatch(1, 1, 1);
+    sg_apply_pipeline(state.bucket.cull_pip);
+    sg_apply_bindings(&(sg_bindings){
+        .views = {
+            [VIEW_cs_objects] = state.bucket.objects_view,
+            [VIEW_cs_slots] = state.bucket.slots_view,
+            [VIEW_cs_visible_counts] = state.bucket.visible_counts_view,
+            [VIEW_cs_visible_slots] = state.bucket.visible_slots_view,
+        },
+    });
+    sg_apply_uniforms(UB_cs_cull_params, &SG_RANGE(cull_params));
+    sg_apply_uniforms(UB_cs_cull_slots, &SG_RANGE(cull_slots));
+    sg_dispatch((state.bucket.num_instances + 63) / 64, 1, 1);
+    sg_end_pass();
+}
+
+// one instanced draw per texture bucket, with culling only the first
+// counts[bucket] instances of each bucket are visible
+static void draw_buckets(const vs_per_frame_t* vs_per_frame, sg_pipeline pip, sg_view slots_view, sg_view counts_view, bool culled) {
+    sg_apply_pipeline(pip);
+    const vs_bucket_per_frame_t vs_bucket_per_frame = { .viewproj = vs_per_frame->viewproj };
+    sg_apply_uniforms(UB_vs_bucket_per_frame, &SG_RANGE(vs_bucket_per_frame));
+    state.stats.num_uniform_updates++;
+    for (int bucket = 0; bucket < MAX_BUCKETS; bucket++) {
+        if (state.bucket.count[bucket] == 0) {
+            continue;
+        }
+        sg_apply_bindings(&(sg_bindings){
+            .vertex_buffers[0] = state.bind.vertex_buffers[0],
+            .index_buffer = state.bind.index_buffer,
+            .views = {
+                [VIEW_bucket_tex] = state.view[bucket],
+                [VIEW_vs_objects] = state.bucket.objects_view,
+                [VIEW_vs_slots] = slots_view,
+                [VIEW_vs_visible_counts] = counts_view,
+            },
+            .samplers[SMP_bucket_smp] = state.bind.samplers[SMP_smp],
+        });
+        state.stats.num_binding_updates++;
+        const vs_per_bucket_t vs_per_bucket = {
+            .first_slot = state.bucket.first[bucket],
+            .bucket = bucket,
+            .culled = culled ? 1 : 0,
+        };
+        sg_apply_uniforms(UB_vs_per_bucket, &SG_RANGE(vs_per_bucket));
+        state.stats.num_uniform_updates++;
+        sg_draw(0, 36, state.bucket.count[bucket]);
+        state.stats.num_draw_calls++;
+    }
+}
+
+// two-pass Hi-Z occlusion culling into the offscreen render target, must
+// be called outside a render pass:
+//
+// 1. draw the objects which were visible in the previous frame
+// 2. build a max-depth pyramid from the resulting depth buffer
+// 3. test all objects against the frustum and the depth pyramid, this
+//    writes the visible lists for the next frame, and the lists of
+//    objects which were not visible in the previous frame
+// 4. draw the newly visible objects on top
+//
+// Without a valid history, the first pass draws nothing and all objects
+// in the frustum are drawn in the second pass.
+static void draw_hiz(const vs_per_frame_t* vs_per_frame) {
+    hiz_resize();
+    const bool use_history = state.hiz.history_valid;
+
+    sg_begin_pass(&(sg_pass){
+        .action = {
+            .colors[0] = state.pass_action.colors[0],
+            .depth = { .load_action = SG_LOADACTION_CLEAR, .clear_value = 1.0f },
+        },
+        .attachments = {
+            .colors[0] = state.hiz.color_att_view,
+            .depth_stencil = state.hiz.depth_att_view,
+        },
+        .label = "hiz-first-pass",
+    });
+    if (use_history) {
+        draw_buckets(vs_per_frame, state.hiz.pip, state.bucket.visible_slots_view, state.bucket.visible_counts_view, true);
+    }
+    sg_end_pass();
+
+    sg_begin_pass(&(sg_pass){ .compute = true, .label = "hiz-copy-pass" });
+    sg_apply_pipeline(state.hiz.copy_pip);
+    sg_apply_bindings(&(sg_bindings){
+        .views = {
+            [VIEW_depth_tex] = state.hiz.depth_tex_view,
+            [VIEW_hiz_mip0] = state.hiz.hiz_simg_view,
+        },
+        .samplers[SMP_depth_smp] = state.hiz.smp,
+    });
+    sg_dispatch((state.hiz.width + 15) / 16, (state.hiz.height + 15) / 16, 1);
+    sg_end_pass();
+    mipgen_generate(state.hiz.chain, MIPGEN_FILTER_MAX);
+
+    // NDC to window space, GL has a -1..+1 depth range and the
+    // window space origin at the bottom left
+    const bool gl = (sg_query_backend() == SG_BACKEND_GLCORE) || (sg_query_backend() == SG_BACKEND_GLES3);
+    cs_cull_params_t frustum;
+    compute_frustum_planes(&vs_per_frame->viewproj, &frustum);
+    cs_hiz_params_t hiz_params = {
+        .viewproj = vs_per_frame->viewproj,
+        .screen_map = gl ? vec4(0.5f, 0.5f, 0.5f, 0.5f) : vec4(1.0f, 0.0f, -0.5f, 0.5f),
+        .hiz_size = { (float)state.hiz.width, (float)state.hiz.height },
+        .radius = frustum.radius,
+        .half_extent = 0.05f,
+        .num_slots = state.bucket.num_instances,
+        .num_levels = state.hiz.num_levels,
+        .use_history = use_history ? 1 : 0,
+    };
+    for (int i = 0; i < 6; i++) {
+        hiz_params.planes[i] = frustum.planes[i];
+    }
+    for (int i = 0; i < MAX_BUCKETS; i++) {
+        hiz_params.bucket_first[i] = state.bucket.first[i];
+    }
+    sg_begin_pass(&(sg_pass){ .compute = true, .label = "hiz-cull-pass" });
+    sg_apply_pipeline(state.bucket.cull_clear_pip);
+    sg_apply_bindings(&(sg_bindings){ .views[VIEW_cs_visible_counts] = state.bucket.visible_counts_view });
+    sg_dispatch(1, 1, 1);
+    sg_apply_bindings(&(sg_bindings){ .views[VIEW_cs_visible_counts] = state.hiz.new_counts_view });
+    sg_dispatch(1, 1, 1);
+    sg_apply_pipeline(state.hiz.cull_pip);
+    sg_apply_bindings(&(sg_bindings){
+        .views = {
+            [VIEW_hiz_tex] = state.hiz.hiz_tex_view,
+            [VIEW_cs_objects] = state.bucket.objects_view,
+            [VIEW_cs_slots] = state.bucket.slots_view,
+            [VIEW_cs_visible_counts] = state.bucket.visible_counts_view,
+            [VIEW_cs_visible_slots] = state.bucket.visible_slots_view,
+            [VIEW_cs_new_counts] = state.hiz.new_counts_view,
+            [VIEW_cs_new_slots] = state.hiz.new_slots_view,
+            [VIEW_cs_visible_flags] = state.hiz.visible_flags_view,
+        },
+        .samplers[SMP_hiz_smp] = state.hiz.smp,
+    });
+    sg_apply_uniforms(UB_cs_hiz_params, &SG_RANGE(hiz_params));
+    sg_dispatch((state.bucket.num_instances + 63) / 64, 1, 1);
+    sg_end_pass();
+
+    sg_begin_pass(&(sg_pass){
+        .action = {
+            .colors[0].load_action = SG_LOADACTION_LOAD,
+            .depth.load_action = SG_LOADACTION_LOAD,
+        },
+        .attachments = {
+            .colors[0] = state.hiz.color_att_view,
+            .depth_stencil = state.hiz.depth_att_view,
+        },
+        .label = "hiz-second-pass",
+    });
+    draw_buckets(vs_per_frame, state.hiz.pip, state.hiz.new_slots_view, state.hiz.new_counts_view, true);
+    sg_end_pass();
+    state.hiz.history_valid = true;
+}
+
+// the work of the bucketed modes outside the swapchain pass
+static void update_bucketed(const vs_per_frame_t* vs_per_frame) {
+    // the buckets only need to be rebuilt when the instances change
+    if (state.bucket.dirty
+        || (state.bucket.num_instances != state.num_instances)
+        || (state.bucket.bind_frequency != state.bind_frequency))
+    {
+        build_buckets();
+    }
+    if (state.mode == RENDER_MODE_BUCKETS_CULLED) {
+        cull_buckets(&vs_per_frame->viewproj);
+    } else if (state.mode == RENDER_MODE_BUCKETS_HIZ) {
+        draw_hiz(vs_per_frame);
+    }
+}
+
+// the bucketed modes in the swapchain pass
+static void draw_bucketed(const vs_per_frame_t* vs_per_frame) {
+    if (state.mode == RENDER_MODE_BUCKETS_HIZ) {
+        sg_apply_pipeline(state.hiz.blit_pip);
+        sg_apply_bindings(&(sg_bindings){
+            .views[VIEW_blit_tex] = state.hiz.color_tex_view,
+            .samplers[SMP_blit_smp] = state.hiz.smp,
+        });
+        sg_draw(0, 3, 1);
+    } else {
+        const bool culled = state.mode == RENDER_MODE_BUCKETS_CULLED;
+        draw_buckets(vs_per_frame,
+            state.bucket.pip,
+            culled ? state.bucket.visible_slots_view : state.bucket.slots_view,
+            state.bucket.visible_counts_view,
+            culled);
+    }
+}
+#endif
+
+// runs each available render mode for a number of frames at MAX_INSTANCES,
+// called at the end of the frame
+static void bench_update(double frame_time_ms) {
+    if (!state.bench.active) {
+        return;
+    }
+    if (state.bench.frame >= BENCH_WARMUP_FRAMES) {
+        state.bench.frame_time_ms += frame_time_ms;
+        state.bench.encode_time_ms += state.encode_time_ms;
+    }
+    if (++state.bench.frame == (BENCH_WARMUP_FRAMES + BENCH_FRAMES)) {
+        state.bench.result_frame_ms[state.bench.mode] = state.bench.frame_time_ms / BENCH_FRAMES;
+        state.bench.result_encode_ms[state.bench.mode] = state.bench.encode_time_ms / BENCH_FRAMES;
+        state.bench.frame = 0;
+        state.bench.frame_time_ms = 0.0;
+        state.bench.encode_time_ms = 0.0;
+        state.bench.mode++;
+        if (!state.bucket.supported || (state.bench.mode == NUM_RENDER_MODES)) {
+            state.bench.active = false;
+            return;
+        }
+    }
+    state.num_instances = MAX_INSTANCES;
+    state.mode = (render_mode_t)state.bench.mode;
+}
+
 static void frame(void) {
     double frame_measured_time = stm_sec(stm_laptime(&state.last_time));
 
@@ -217,17 +850,70 @@ static void frame(void) {
 
     // control ui
     igSetNextWindowPos((ImVec2){20,20}, ImGuiCond_Once);
-    igSetNextWindowSize((ImVec2){600,200}, ImGuiCond_Once);
+    igSetNextWindowSize((ImVec2){640,580}, ImGuiCond_Once);
     if (igBegin("Controls", 0, ImGuiWindowFlags_NoResize)) {
-        igText("Each cube/instance is 1 16-byte uniform update and 1 draw call\n");
+        igText("Per-draw: each cube/instance is 1 16-byte uniform update and 1 draw call\n");
         igText("DC/texture is the number of adjacent draw calls with the same texture binding\n");
+        igText("Bucketed: one instanced draw per texture, objects in a storage buffer\n");
+        igText("Hi-Z: previously visible objects, then the newly visible ones (2 draws per texture)\n");
+        igBeginDisabled(state.bench.active);
+        for (int i = 0; i < NUM_RENDER_MODES; i++) {
+            igBeginDisabled((i != RENDER_MODE_PER_DRAW) && !state.bucket.supported);
+            igRadioButtonIntPtr(render_mode_names[i], (int*)&state.mode, i);
+            igEndDisabled();
+        }
         igSliderIntEx("Num Instances", &state.num_instances, 100, MAX_INSTANCES, "%d", ImGuiSliderFlags_Logarithmic);
         igSliderIntEx("DC/texture", &state.bind_frequency, 1, MAX_BIND_FREQUENCY, "%d", ImGuiSliderFlags_Logarithmic);
+        igSliderFloat("Camera distance", &state.cam_dist, 0.25f, 4.5f);
+        if (igButton("Run benchmark")) {
+            state.bench.active = true;
+            state.bench.mode = 0;
+            state.bench.frame = 0;
+            state.bench.frame_time_ms = 0.0;
+            state.bench.encode_time_ms = 0.0;
+        }
+        igEndDisabled();
+        if (!state.bucket.supported) {
+            igText("Bucketed modes need storage buffers and compute shaders");
+        }
         igText("Backend: %s", state.backend);
         igText("Frame duration: %.4fms", frame_measured_time * 1000.0);
+        igText("CPU encode time: %.4fms", state.encode_time_ms);
         igText("sg_apply_bindings(): %d\n", state.stats.num_binding_updates);
         igText("sg_apply_uniforms(): %d\n", state.stats.num_uniform_updates);
         igText("sg_draw(): %d\n", state.stats.num_draw_calls);
+        if (igCheckbox("Profile sokol-gfx calls", &state.prof.enabled)) {
+            if (state.prof.enabled) {
+                sgprof_setup();
+            } else {
+                sgprof_shutdown();
+            }
+            state.prof.capture_failed = false;
+        }
+        if (state.prof.enabled) {
+            // counts of the last frame, including the UI
+            const sgprof_frame_t* f = sgprof_last_frame();
+            igText("passes: %d, compute passes: %d", f->passes, f->compute_passes);
+            igText("apply pipeline: %d (%d redundant)", f->apply_pipeline, f->redundant_apply_pipeline);
+            igText("apply bindings: %d (%d redundant)", f->apply_bindings, f->redundant_apply_bindings);
+            igText("apply uniforms: %d (%d redundant, %llu bytes)", f->apply_uniforms, f->redundant_apply_uniforms, (unsigned long long)f->uniform_bytes);
+            igText("draws: %d (%llu elements), dispatches: %d", f->draw, (unsigned long long)f->num_elements, f->dispatch);
+            if (igButton("Capture to " PROF_CAPTURE_PATH)) {
+                state.prof.capture_failed = !sgprof_begin_capture(PROF_CAPTURE_PATH, PROF_CAPTURE_FRAMES);
+            }
+            if (state.prof.capture_failed) {
+                igText("Failed to open " PROF_CAPTURE_PATH);
+            }
+        }
+        if (state.bench.active) {
+            igText("Benchmarking %s...", render_mode_names[state.bench.mode]);
+        } else {
+            for (int i = 0; i < NUM_RENDER_MODES; i++) {
+                if (state.bench.result_frame_ms[i] > 0.0) {
+                    igText("%s: frame %.3fms, encode %.3fms", render_mode_names[i], state.bench.result_frame_ms[i], state.bench.result_encode_ms[i]);
+                }
+            }
+        }
     }
     igEnd();
 
@@ -236,6 +922,9 @@ static void frame(void) {
     } else if (state.num_instances > MAX_INSTANCES) {
         state.num_instances = MAX_INSTANCES;
     }
+    if (!state.bucket.supported) {
+        state.mode = RENDER_MODE_PER_DRAW;
+    }
 
     // view-proj matrix for the frame
     const vs_per_frame_t vs_per_frame = {
@@ -246,34 +935,32 @@ static void frame(void) {
     state.stats.num_binding_updates = 0;
     state.stats.num_draw_calls = 0;
 
+    const uint64_t encode_start = stm_now();
+    // without compute shader support, only the per-draw mode can be selected
+    if (state.mode != RENDER_MODE_PER_DRAW) {
+        #if defined(HAS_COMPUTE_SHADERS)
+        update_bucketed(&vs_per_frame);
+        #endif
+    }
+    // the other modes overwrite the visible lists of the Hi-Z mode
+    #if defined(HAS_COMPUTE_SHADERS)
+    if (state.mode != RENDER_MODE_BUCKETS_HIZ) {
+        state.hiz.history_valid = false;
+    }
+    #endif
     sg_begin_pass(&(sg_pass){ .action = state.pass_action, .swapchain = sglue_swapchain() });
-    sg_apply_pipeline(state.pip);
-    sg_apply_uniforms(UB_vs_per_frame, &SG_RANGE(vs_per_frame));
-    state.stats.num_uniform_updates++;
-
-    state.bind.views[VIEW_tex] = state.view[0];
-    sg_apply_bindings(&state.bind);
-    state.stats.num_binding_updates++;
-    int cur_bind_count = 0;
-    int cur_img = 0;
-    for (int i = 0; i < state.num_instances; i++) {
-        if (++cur_bind_count == state.bind_frequency) {
-            cur_bind_count = 0;
-            if (cur_img == NUM_IMAGES) {
-                cur_img = 0;
-            }
-            state.bind.views[VIEW_tex] = state.view[cur_img++];
-            sg_apply_bindings(&state.bind);
-            state.stats.num_binding_updates++;
-        }
-        sg_apply_uniforms(UB_vs_per_instance, &SG_RANGE(positions[i]));
-        state.stats.num_uniform_updates++;
-        sg_draw(0, 36, 1);
-        state.stats.num_draw_calls++;
+    if (state.mode == RENDER_MODE_PER_DRAW) {
+        draw_per_draw(&vs_per_frame);
+    } else {
+        #if defined(HAS_COMPUTE_SHADERS)
+        draw_bucketed(&vs_per_frame);
+        #endif
     }
+    state.encode_time_ms = stm_ms(stm_since(encode_start));
     simgui_render();
     sg_end_pass();
     sg_commit();
+    bench_update(frame_measured_time * 1000.0);
 }
 
 static void input(const sapp_event* ev) {
@@ -281,6 +968,17 @@ static void input(const sapp_event* ev) {
 }
 
 static void cleanup(void) {
+    #if defined(HAS_COMPUTE_SHADERS)
+    if (state.hiz.chain) {
+        mipgen_destroy_chain(state.hiz.chain);
+    }
+    if (state.bucket.supported) {
+        mipgen_shutdown();
+    }
+    #endif
+    if (state.prof.enabled) {
+        sgprof_shutdown();
+    }
     sgimgui_discard(&state.sgimgui);
     simgui_shutdown();
     sg_shutdown();
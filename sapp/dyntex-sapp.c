@@ -1,55 +1,134 @@
 //------------------------------------------------------------------------------
 //  dyntex-sapp.c
 //  Update dynamic texture with CPU-generated data each frame.
+//
+//  The texture content is a game-of-life simulation:
+//
+//  - cells are stored as 1 bit per cell, a board row is an array of 64-bit
+//    words, and the neighbour counts for 64 cells are computed at once with
+//    bit-sliced adders on whole words
+//  - the board is split into horizontal bands which are updated in parallel
+//    on worker threads (on the web everything runs on the main thread)
+//  - each band expands its new rows into an R8 staging buffer, which is
+//    uploaded into an R8 texture, the colors are applied in the shader
+//
+//  Press 1..8 to change the board size from 64x64 up to 8192x8192.
 //------------------------------------------------------------------------------
-#include <stdlib.h> /* rand */
+#define SOKOL_DEBUGTEXT_IMPL
+#include <stdlib.h> /* malloc, free */
+#include <string.h> /* memcpy */
 #include "sokol_app.h"
 #include "sokol_gfx.h"
+#include "sokol_time.h"
 #include "sokol_log.h"
 #include "sokol_glue.h"
+#include "sokol_debugtext.h"
 #define VECMATH_GENERICS
 #include "vecmath/vecmath.h"
 #include "dbgui/dbgui.h"
 #include "dyntex-sapp.glsl.h"
 
-#define IMAGE_WIDTH (64)
-#define IMAGE_HEIGHT (64)
-#define LIVING (0xFFFFFFFF)
-#define DEAD (0xFF000000)
+#if defined(__EMSCRIPTEN__)
+#define USE_WORKER_THREADS (0)
+#elif defined(_WIN32)
+#define USE_WORKER_THREADS (1)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#define USE_WORKER_THREADS (1)
+#include <pthread.h>
+#endif
+
+#define MIN_BOARD_SIZE (64)
+#define MAX_BOARD_SIZE (8192)
+#define NUM_BANDS (4)
+#define NUM_WORKER_THREADS (NUM_BANDS - 1)  // the main thread updates the first band
 
 static struct {
     sg_pass_action pass_action;
     sg_pipeline pip;
     sg_image img;
+    sg_view tex_view;
     sg_bindings bind;
     float rx, ry;
-    int update_count;
-    uint32_t pixels[IMAGE_WIDTH][IMAGE_HEIGHT];
+    int max_board_size;
+    int num_board_sizes;
+    struct {
+        int size;               // board width and height in cells
+        int words_per_row;      // size / 64
+        uint64_t* cells[2];     // current and next generation, 1 bit per cell
+        int cur;
+        uint8_t* pixels;        // R8 staging buffer, size * size bytes
+        int update_count;
+        uint64_t rand_state;
+    } board;
+    uint64_t expand_lut[256];   // 8 cell bits => 8 R8 pixels
+    struct {
+        double update_ms;
+        double upload_ms;
+    } timing;
+    #if USE_WORKER_THREADS
+    struct {
+        bool quit;
+        int generation;
+        int num_done;
+        #if defined(_WIN32)
+        CRITICAL_SECTION mutex;
+        CONDITION_VARIABLE start_cond;
+        CONDITION_VARIABLE done_cond;
+        HANDLE threads[NUM_WORKER_THREADS];
+        #else
+        pthread_mutex_t mutex;
+        pthread_cond_t start_cond;
+        pthread_cond_t done_cond;
+        pthread_t threads[NUM_WORKER_THREADS];
+        #endif
+    } workers;
+    #endif
 } state;
 
-static void game_of_life_init();
-static void game_of_life_update();
+static void board_resize(int size);
+static void board_randomize(void);
+static void board_update(void);
+static void board_shutdown(void);
+static void workers_setup(void);
+static void workers_shutdown(void);
 static vs_params_t compute_vsparams(float rx, float ry);
 
-void init(void) {
+static void init(void) {
     sg_setup(&(sg_desc){
         .environment = sglue_environment(),
         .logger.func = slog_func,
     });
+    stm_setup();
     __dbgui_setup(sapp_sample_count());
-
-    // a 128x128 image and texture view with streaming update strategy
-    state.img = sg_make_image(&(sg_image_desc){
-        .width = IMAGE_WIDTH,
-        .height = IMAGE_HEIGHT,
-        .pixel_format = SG_PIXELFORMAT_RGBA8,
-        .usage.stream_update = true,
-        .label = "dynamic-texture"
-    });
-    sg_view tex_view = sg_make_view(&(sg_view_desc){
-        .texture = { .image = state.img },
-        .label = "dynamic-texture-view",
+    sdtx_setup(&(sdtx_desc_t){
+        .fonts[0] = sdtx_font_oric(),
+        .logger.func = slog_func,
     });
+    state.max_board_size = sg_query_limits().max_image_size_2d;
+    if (state.max_board_size > MAX_BOARD_SIZE) {
+        state.max_board_size = MAX_BOARD_SIZE;
+    }
+    for (int size = MIN_BOARD_SIZE; size <= state.max_board_size; size *= 2) {
+        state.num_board_sizes++;
+    }
+
+    // lookup table to expand 8 cell bits into 8 R8 pixels
+    for (int i = 0; i < 256; i++) {
+        uint64_t pixels = 0;
+        for (int bit = 0; bit < 8; bit++) {
+            if (i & (1 << bit)) {
+                pixels |= (uint64_t)0xFF << (bit * 8);
+            }
+        }
+        state.expand_lut[i] = pixels;
+    }
 
     // a sampler object
     sg_sampler smp = sg_make_sampler(&(sg_sampler_desc){
@@ -133,30 +212,50 @@ void init(void) {
         .label = "cube-pipelin"
     });
 
-    // setup the resource bindings
+    // setup the resource bindings, the texture view is filled in by board_resize()
     state.bind = (sg_bindings) {
         .vertex_buffers[0] = vbuf,
         .index_buffer = ibuf,
-        .views[VIEW_tex] = tex_view,
         .samplers[SMP_smp] = smp,
     };
 
-    // initialize the game-of-life state
-    game_of_life_init();
+    // initialize the game-of-life state and the dynamic texture
+    state.board.rand_state = 0x2545F4914F6CDD1DULL;
+    workers_setup();
+    board_resize(MIN_BOARD_SIZE);
 }
 
-void frame(void) {
+static void frame(void) {
     const float t = (float)(sapp_frame_duration() * 60.0);
     state.rx += 1.0f * t; state.ry += 2.0f * t;
     const vs_params_t vs_params = compute_vsparams(state.rx, state.ry);
 
-    // update game-of-life state
-    game_of_life_update();
+    // update game-of-life state, this also expands the new state into the R8 staging buffer
+    uint64_t start = stm_now();
+    board_update();
+    const double update_ms = stm_ms(stm_since(start));
 
     // update the texture
+    start = stm_now();
     sg_update_image(state.img, &(sg_image_data){
-        .subimage[0][0] = SG_RANGE(state.pixels)
+        .subimage[0][0] = {
+            .ptr = state.board.pixels,
+            .size = (size_t)(state.board.size * state.board.size),
+        }
     });
+    const double upload_ms = stm_ms(stm_since(start));
+    state.timing.update_ms += (update_ms - state.timing.update_ms) * 0.05;
+    state.timing.upload_ms += (upload_ms - state.timing.upload_ms) * 0.05;
+
+    sdtx_canvas(sapp_widthf() * 0.5f, sapp_heightf() * 0.5f);
+    sdtx_origin(1.0f, 1.0f);
+    sdtx_color3f(1.0f, 1.0f, 1.0f);
+    sdtx_printf("board:  %dx%d (press 1..%d)\n", state.board.size, state.board.size, state.num_board_sizes);
+    sdtx_printf("update: %.3f ms\n", state.timing.update_ms);
+    sdtx_printf("upload: %.3f ms (%.2f MB)\n", state.timing.upload_ms, (state.board.size * state.board.size) / (1024.0 * 1024.0));
+    #if !USE_WORKER_THREADS
+    sdtx_puts("\n(no worker threads on this platform)");
+    #endif
 
     // render the frame
     sg_begin_pass(&(sg_pass){ .action = state.pass_action, .swapchain = sglue_swapchain() });
@@ -164,12 +263,26 @@ void frame(void) {
     sg_apply_bindings(&state.bind);
     sg_apply_uniforms(UB_vs_params, &SG_RANGE(vs_params));
     sg_draw(0, 36, 1);
+    sdtx_draw();
     __dbgui_draw();
     sg_end_pass();
     sg_commit();
 }
 
-void cleanup(void) {
+static void event(const sapp_event* ev) {
+    if ((ev->type == SAPP_EVENTTYPE_KEY_DOWN) && (ev->key_code >= SAPP_KEYCODE_1) && (ev->key_code <= SAPP_KEYCODE_8)) {
+        const int size = MIN_BOARD_SIZE << (ev->key_code - SAPP_KEYCODE_1);
+        if ((size <= state.max_board_size) && (size != state.board.size)) {
+            board_resize(size);
+        }
+    }
+    __dbgui_event(ev);
+}
+
+static void cleanup(void) {
+    workers_shutdown();
+    board_shutdown();
+    sdtx_shutdown();
     __dbgui_shutdown();
     sg_shutdown();
 }
@@ -186,52 +299,284 @@ static vs_params_t compute_vsparams(float rx, float ry) {
     return (vs_params_t){ .mvp = vm_mul(model, view_proj) };
 }
 
-void game_of_life_init() {
-    for (int y = 0; y < IMAGE_HEIGHT; y++) {
-        for (int x = 0; x < IMAGE_WIDTH; x++) {
-            if ((rand() & 255) > 230) {
-                state.pixels[y][x] = LIVING;
-            } else {
-                state.pixels[y][x] = DEAD;
-            }
+//== GAME OF LIFE ==============================================================
+static uint64_t xorshift64(void) {
+    uint64_t x = state.board.rand_state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    state.board.rand_state = x;
+    return x;
+}
+
+// (re-)allocate the board and the dynamic texture
+static void board_resize(int size) {
+    board_shutdown();
+    state.board.size = size;
+    state.board.words_per_row = size / 64;
+    const size_t num_words = (size_t)(state.board.words_per_row * size);
+    state.board.cells[0] = (uint64_t*) malloc(num_words * sizeof(uint64_t));
+    state.board.cells[1] = (uint64_t*) malloc(num_words * sizeof(uint64_t));
+    state.board.pixels = (uint8_t*) malloc((size_t)(size * size));
+    state.board.cur = 0;
+
+    // an R8 image and texture view with streaming update strategy
+    state.img = sg_make_image(&(sg_image_desc){
+        .width = size,
+        .height = size,
+        .pixel_format = SG_PIXELFORMAT_R8,
+        .usage.stream_update = true,
+        .label = "dynamic-texture"
+    });
+    state.tex_view = sg_make_view(&(sg_view_desc){
+        .texture = { .image = state.img },
+        .label = "dynamic-texture-view",
+    });
+    state.bind.views[VIEW_tex] = state.tex_view;
+    board_randomize();
+}
+
+static void board_shutdown(void) {
+    sg_destroy_view(state.tex_view);
+    sg_destroy_image(state.img);
+    free(state.board.cells[0]);
+    free(state.board.cells[1]);
+    free(state.board.pixels);
+    state.board.cells[0] = state.board.cells[1] = 0;
+    state.board.pixels = 0;
+}
+
+static void board_randomize(void) {
+    const int num_words = state.board.words_per_row * state.board.size;
+    uint64_t* cells = state.board.cells[state.board.cur];
+    for (int i = 0; i < num_words; i++) {
+        // about 1/8 of all cells are alive
+        cells[i] = xorshift64() & xorshift64() & xorshift64();
+    }
+    state.board.update_count = 0;
+}
+
+static inline void half_add(uint64_t a, uint64_t b, uint64_t* sum, uint64_t* carry) {
+    *sum = a ^ b;
+    *carry = a & b;
+}
+
+static inline void full_add(uint64_t a, uint64_t b, uint64_t c, uint64_t* sum, uint64_t* carry) {
+    const uint64_t t = a ^ b;
+    *sum = t ^ c;
+    *carry = (a & b) | (t & c);
+}
+
+// compute the next generation of one board row, 64 cells per word, bit n of a word
+// is the cell at x = word_index * 64 + n, the board wraps around at the edges
+static void step_row(const uint64_t* up, const uint64_t* mid, const uint64_t* down, uint64_t* dst, int num_words) {
+    const int mask = num_words - 1;
+    for (int i = 0; i < num_words; i++) {
+        const int l = (i - 1) & mask;
+        const int r = (i + 1) & mask;
+        // the 8 neighbour bit-planes, west is x-1, east is x+1
+        const uint64_t uw = (up[i] << 1) | (up[l] >> 63);
+        const uint64_t ue = (up[i] >> 1) | (up[r] << 63);
+        const uint64_t mw = (mid[i] << 1) | (mid[l] >> 63);
+        const uint64_t me = (mid[i] >> 1) | (mid[r] << 63);
+        const uint64_t dw = (down[i] << 1) | (down[l] >> 63);
+        const uint64_t de = (down[i] >> 1) | (down[r] << 63);
+
+        // bit-sliced neighbour count, s0/s1/s2 are the bits of the count (modulo 8)
+        uint64_t sa, ca, sb, cb, sc, cc, s0, cd, t1, t2, s1, ce;
+        full_add(uw, up[i], ue, &sa, &ca);
+        full_add(mw, me, dw, &sb, &cb);
+        half_add(down[i], de, &sc, &cc);
+        full_add(sa, sb, sc, &s0, &cd);
+        full_add(ca, cb, cc, &t1, &t2);
+        half_add(t1, cd, &s1, &ce);
+        const uint64_t s2 = t2 ^ ce;
+
+        // alive if 3 neighbours, or 2 neighbours and already alive
+        dst[i] = s1 & ~s2 & (s0 | mid[i]);
+    }
+}
+
+// expand one row of cell bits into R8 pixels
+static void expand_row(const uint64_t* src, uint8_t* dst, int num_words) {
+    for (int i = 0; i < num_words; i++) {
+        const uint64_t bits = src[i];
+        for (int b = 0; b < 8; b++) {
+            memcpy(dst + i * 64 + b * 8, &state.expand_lut[(bits >> (b * 8)) & 0xFF], 8);
         }
     }
 }
 
-void game_of_life_update() {
-    for (int y = 0; y < IMAGE_HEIGHT; y++) {
-        for (int x = 0; x < IMAGE_WIDTH; x++) {
-            int num_living_neighbours = 0;
-            for (int ny = -1; ny < 2; ny++) {
-                for (int nx = -1; nx < 2; nx++) {
-                    if ((nx == 0) && (ny == 0)) {
-                        continue;
-                    }
-                    if (state.pixels[(y+ny)&(IMAGE_HEIGHT-1)][(x+nx)&(IMAGE_WIDTH-1)] == LIVING) {
-                        num_living_neighbours++;
-                    }
-                }
-            }
-            // any live cell...
-            if (state.pixels[y][x] == LIVING) {
-                if (num_living_neighbours < 2) {
-                    /* ... with fewer than 2 living neighbours dies, as if caused by underpopulation */
-                    state.pixels[y][x] = DEAD;
-                } else if (num_living_neighbours > 3) {
-                    /* ... with more than 3 living neighbours dies, as if caused by overpopulation */
-                    state.pixels[y][x] = DEAD;
-                }
-            } else if (num_living_neighbours == 3) {
-                // any dead cell with exactly 3 living neighbours becomes a live cell, as if by reproduction
-                state.pixels[y][x] = LIVING;
-            }
+static void update_band(int band) {
+    const int size = state.board.size;
+    const int wpr = state.board.words_per_row;
+    const uint64_t* src = state.board.cells[state.board.cur];
+    uint64_t* dst = state.board.cells[state.board.cur ^ 1];
+    const int y0 = (band * size) / NUM_BANDS;
+    const int y1 = ((band + 1) * size) / NUM_BANDS;
+    for (int y = y0; y < y1; y++) {
+        const uint64_t* up = &src[((y - 1) & (size - 1)) * wpr];
+        const uint64_t* mid = &src[y * wpr];
+        const uint64_t* down = &src[((y + 1) & (size - 1)) * wpr];
+        step_row(up, mid, down, &dst[y * wpr], wpr);
+        expand_row(&dst[y * wpr], &state.board.pixels[y * size], wpr);
+    }
+}
+
+#if USE_WORKER_THREADS
+static void workers_lock(void) {
+    #if defined(_WIN32)
+    EnterCriticalSection(&state.workers.mutex);
+    #else
+    pthread_mutex_lock(&state.workers.mutex);
+    #endif
+}
+
+static void workers_unlock(void) {
+    #if defined(_WIN32)
+    LeaveCriticalSection(&state.workers.mutex);
+    #else
+    pthread_mutex_unlock(&state.workers.mutex);
+    #endif
+}
+
+static void workers_wait_start(void) {
+    #if defined(_WIN32)
+    SleepConditionVariableCS(&state.workers.start_cond, &state.workers.mutex, INFINITE);
+    #else
+    pthread_cond_wait(&state.workers.start_cond, &state.workers.mutex);
+    #endif
+}
+
+static void workers_wait_done(void) {
+    #if defined(_WIN32)
+    SleepConditionVariableCS(&state.workers.done_cond, &state.workers.mutex, INFINITE);
+    #else
+    pthread_cond_wait(&state.workers.done_cond, &state.workers.mutex);
+    #endif
+}
+
+static void workers_signal_start(void) {
+    #if defined(_WIN32)
+    WakeAllConditionVariable(&state.workers.start_cond);
+    #else
+    pthread_cond_broadcast(&state.workers.start_cond);
+    #endif
+}
+
+static void workers_signal_done(void) {
+    #if defined(_WIN32)
+    WakeConditionVariable(&state.workers.done_cond);
+    #else
+    pthread_cond_signal(&state.workers.done_cond);
+    #endif
+}
+
+// each worker thread updates one band per generation, band 0 is done by the main thread
+static void worker_loop(int band) {
+    int generation = 0;
+    workers_lock();
+    while (true) {
+        while (!state.workers.quit && (state.workers.generation == generation)) {
+            workers_wait_start();
+        }
+        if (state.workers.quit) {
+            break;
+        }
+        generation = state.workers.generation;
+        workers_unlock();
+        update_band(band);
+        workers_lock();
+        if (++state.workers.num_done == NUM_WORKER_THREADS) {
+            workers_signal_done();
         }
     }
-    if (state.update_count++ > 240) {
-        game_of_life_init();
-        state.update_count = 0;
+    workers_unlock();
+}
+
+#if defined(_WIN32)
+static DWORD WINAPI worker_thread_func(LPVOID arg) {
+    worker_loop((int)(intptr_t)arg);
+    return 0;
+}
+#else
+static void* worker_thread_func(void* arg) {
+    worker_loop((int)(intptr_t)arg);
+    return 0;
+}
+#endif
+
+static void workers_setup(void) {
+    #if defined(_WIN32)
+    InitializeCriticalSection(&state.workers.mutex);
+    InitializeConditionVariable(&state.workers.start_cond);
+    InitializeConditionVariable(&state.workers.done_cond);
+    for (int i = 0; i < NUM_WORKER_THREADS; i++) {
+        state.workers.threads[i] = CreateThread(NULL, 0, worker_thread_func, (LPVOID)(intptr_t)(i + 1), 0, NULL);
+    }
+    #else
+    pthread_mutex_init(&state.workers.mutex, 0);
+    pthread_cond_init(&state.workers.start_cond, 0);
+    pthread_cond_init(&state.workers.done_cond, 0);
+    for (int i = 0; i < NUM_WORKER_THREADS; i++) {
+        pthread_create(&state.workers.threads[i], 0, worker_thread_func, (void*)(intptr_t)(i + 1));
+    }
+    #endif
+}
+
+static void workers_shutdown(void) {
+    workers_lock();
+    state.workers.quit = true;
+    workers_signal_start();
+    workers_unlock();
+    #if defined(_WIN32)
+    WaitForMultipleObjects(NUM_WORKER_THREADS, state.workers.threads, TRUE, INFINITE);
+    for (int i = 0; i < NUM_WORKER_THREADS; i++) {
+        CloseHandle(state.workers.threads[i]);
+    }
+    DeleteCriticalSection(&state.workers.mutex);
+    #else
+    for (int i = 0; i < NUM_WORKER_THREADS; i++) {
+        pthread_join(state.workers.threads[i], 0);
+    }
+    pthread_cond_destroy(&state.workers.done_cond);
+    pthread_cond_destroy(&state.workers.start_cond);
+    pthread_mutex_destroy(&state.workers.mutex);
+    #endif
+}
+
+static void board_update(void) {
+    // kick off the worker threads, update the first band, and wait for the workers
+    workers_lock();
+    state.workers.num_done = 0;
+    state.workers.generation++;
+    workers_signal_start();
+    workers_unlock();
+    update_band(0);
+    workers_lock();
+    while (state.workers.num_done < NUM_WORKER_THREADS) {
+        workers_wait_done();
+    }
+    workers_unlock();
+    state.board.cur ^= 1;
+    if (state.board.update_count++ > 240) {
+        board_randomize();
+    }
+}
+#else
+static void workers_setup(void) { }
+static void workers_shutdown(void) { }
+
+static void board_update(void) {
+    for (int band = 0; band < NUM_BANDS; band++) {
+        update_band(band);
+    }
+    state.board.cur ^= 1;
+    if (state.board.update_count++ > 240) {
+        board_randomize();
     }
 }
+#endif
 
 sapp_desc sokol_main(int argc, char* argv[]) {
     (void)argc;
@@ -240,7 +585,7 @@ sapp_desc sokol_main(int argc, char* argv[]) {
         .init_cb = init,
         .frame_cb = frame,
         .cleanup_cb = cleanup,
-        .event_cb = __dbgui_event,
+        .event_cb = event,
         .width = 800,
         .height = 600,
         .sample_count = 4,
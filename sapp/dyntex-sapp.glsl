@@ -30,7 +30,9 @@ layout(location=1) in vec2 uv;
 out vec4 frag_color;
 
 void main() {
-    frag_color = texture(sampler2D(tex, smp), uv) * color;
+    // the texture is R8 with one byte per game-of-life cell (0: dead, 255: alive)
+    float cell = texture(sampler2D(tex, smp), uv).r;
+    frag_color = vec4(cell, cell, cell, 1.0) * color;
 }
 @end
 
@@ -133,6 +133,7 @@ static void frame(void) {
 
     // only render text once font data has been loaded
     FONScontext* fs = state.fons;
+    fonsNextFrame(fs);
     fonsClearState(fs);
     if (state.font != FONS_INVALID) {
         fonsSetFont(fs, state.font);
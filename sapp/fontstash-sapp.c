@@ -2,6 +2,10 @@
 //  fontstash-sapp.c
 //
 //  Text rendering via fontstash, stb_truetype and sokol_fontstash.h
+//
+//  The Japanese glyphs are pre-warmed on worker threads when the font
+//  has been loaded, and all static text goes through fontstash's layout
+//  cache (fonsDrawTextCached), which only copies the cached quads.
 //------------------------------------------------------------------------------
 #include "sokol_app.h"
 #include "sokol_gfx.h"
@@ -28,6 +32,15 @@
 #include "sokol_fontstash.h"
 #include "dbgui/dbgui.h"
 #include "util/fileutil.h"
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#elif !defined(__EMSCRIPTEN__)
+#include <pthread.h>
+#endif
+
+#define NUM_JOB_THREADS (4)
+static const char* japanese_text = "私はガラスを食べられます。それは私を傷つけません。";
 
 typedef struct {
     FONScontext* fons;
@@ -54,6 +67,65 @@ static void my_free(void* ptr, void* user_data) {
     free(ptr);
 }
 
+// fontstash job callback, runs the glyph rasterization jobs of
+// fonsPrewarmText() on a few short-lived threads (inline on the web)
+typedef struct {
+    void (*job)(void* data, int index);
+    void* data;
+    int count;
+    int first;
+} job_range_t;
+
+static void run_job_range(const job_range_t* range) {
+    for (int i = range->first; i < range->count; i += NUM_JOB_THREADS) {
+        range->job(range->data, i);
+    }
+}
+
+#if defined(_WIN32)
+static DWORD WINAPI job_thread(LPVOID arg) {
+    run_job_range((const job_range_t*)arg);
+    return 0;
+}
+#elif !defined(__EMSCRIPTEN__)
+static void* job_thread(void* arg) {
+    run_job_range((const job_range_t*)arg);
+    return 0;
+}
+#endif
+
+static void run_jobs(void* user_data, void (*job)(void* data, int index), void* data, int count) {
+    (void)user_data;
+    job_range_t ranges[NUM_JOB_THREADS];
+    for (int i = 0; i < NUM_JOB_THREADS; i++) {
+        ranges[i] = (job_range_t){ .job = job, .data = data, .count = count, .first = i };
+    }
+    #if defined(__EMSCRIPTEN__)
+        for (int i = 0; i < NUM_JOB_THREADS; i++) {
+            run_job_range(&ranges[i]);
+        }
+    #elif defined(_WIN32)
+        HANDLE threads[NUM_JOB_THREADS - 1];
+        for (int i = 1; i < NUM_JOB_THREADS; i++) {
+            threads[i - 1] = CreateThread(NULL, 0, job_thread, &ranges[i], 0, NULL);
+        }
+        run_job_range(&ranges[0]);
+        WaitForMultipleObjects(NUM_JOB_THREADS - 1, threads, TRUE, INFINITE);
+        for (int i = 0; i < NUM_JOB_THREADS - 1; i++) {
+            CloseHandle(threads[i]);
+        }
+    #else
+        pthread_t threads[NUM_JOB_THREADS - 1];
+        for (int i = 1; i < NUM_JOB_THREADS; i++) {
+            pthread_create(&threads[i - 1], 0, job_thread, &ranges[i]);
+        }
+        run_job_range(&ranges[0]);
+        for (int i = 0; i < NUM_JOB_THREADS - 1; i++) {
+            pthread_join(threads[i], 0);
+        }
+    #endif
+}
+
 // sokol-fetch load callbacks
 static void font_normal_loaded(const sfetch_response_t* response) {
     if (response->fetched) {
@@ -76,6 +148,13 @@ static void font_bold_loaded(const sfetch_response_t* response) {
 static void font_japanese_loaded(const sfetch_response_t* response) {
     if (response->fetched) {
         state.font_japanese = fonsAddFontMem(state.fons, "sans-japanese", (void*)response->data.ptr, (int)response->data.size, false);
+        // rasterize the Japanese glyphs in parallel before they are drawn the first time
+        fonsPushState(state.fons);
+        fonsClearState(state.fons);
+        fonsSetFont(state.fons, state.font_japanese);
+        fonsSetSize(state.fons, 18.0f * state.dpi_scale);
+        fonsPrewarmText(state.fons, japanese_text, NULL);
+        fonsPopState(state.fons);
     }
 }
 
@@ -111,6 +190,7 @@ static void init(void) {
         }
     });
     state.fons = fons_context;
+    fonsSetJobCallback(state.fons, run_jobs, 0);
     state.font_normal = FONS_INVALID;
     state.font_italic = FONS_INVALID;
     state.font_bold = FONS_INVALID;
@@ -166,6 +246,9 @@ static void frame(void) {
     uint32_t black = sfons_rgba(0, 0, 0, 255);
     uint32_t brown = sfons_rgba(192, 128, 0, 128);
     uint32_t blue  = sfons_rgba(0, 192, 255, 255);
+    // start a new glyph cache frame, this allows fontstash to evict
+    // glyphs which haven't been used this frame when the atlas is full
+    fonsNextFrame(state.fons);
     fonsClearState(state.fons);
 
     sgl_defaults();
@@ -183,30 +266,30 @@ static void frame(void) {
         dx = sx;
         dy += lh;
         fonsSetColor(fs, white);
-        dx = fonsDrawText(fs, dx, dy, "The quick ", NULL);
+        dx = fonsDrawTextCached(fs, dx, dy, "The quick ", NULL);
     }
     if (state.font_italic != FONS_INVALID) {
         fonsSetFont(fs, state.font_italic);
         fonsSetSize(fs, 48.0f*dpis);
         fonsSetColor(fs, brown);
-        dx = fonsDrawText(fs, dx, dy, "brown ", NULL);
+        dx = fonsDrawTextCached(fs, dx, dy, "brown ", NULL);
     }
     if (state.font_normal != FONS_INVALID) {
         fonsSetFont(fs, state.font_normal);
         fonsSetSize(fs, 24.0f*dpis);
         fonsSetColor(fs, white);
-        dx = fonsDrawText(fs, dx, dy,"fox ", NULL);
+        dx = fonsDrawTextCached(fs, dx, dy,"fox ", NULL);
     }
     if ((state.font_normal != FONS_INVALID) && (state.font_italic != FONS_INVALID) && (state.font_bold != FONS_INVALID)) {
         fonsVertMetrics(fs, NULL, NULL, &lh);
         dx = sx;
         dy += lh*1.2f;
         fonsSetFont(fs, state.font_italic);
-        dx = fonsDrawText(fs, dx, dy, "jumps over ",NULL);
+        dx = fonsDrawTextCached(fs, dx, dy, "jumps over ",NULL);
         fonsSetFont(fs, state.font_bold);
-        dx = fonsDrawText(fs, dx, dy, "the lazy ",NULL);
+        dx = fonsDrawTextCached(fs, dx, dy, "the lazy ",NULL);
         fonsSetFont(fs, state.font_normal);
-        dx = fonsDrawText(fs, dx, dy, "dog.",NULL);
+        dx = fonsDrawTextCached(fs, dx, dy, "dog.",NULL);
     }
     if (state.font_normal != FONS_INVALID) {
         dx = sx;
@@ -214,7 +297,7 @@ static void frame(void) {
         fonsSetSize(fs, 12.0f*dpis);
         fonsSetFont(fs, state.font_normal);
         fonsSetColor(fs, blue);
-        fonsDrawText(fs, dx,dy,"Now is the time for all good men to come to the aid of the party.",NULL);
+        fonsDrawTextCached(fs, dx,dy,"Now is the time for all good men to come to the aid of the party.",NULL);
     }
     if (state.font_italic != FONS_INVALID) {
         fonsVertMetrics(fs, NULL, NULL, &lh);
@@ -223,14 +306,14 @@ static void frame(void) {
         fonsSetSize(fs, 18.0f*dpis);
         fonsSetFont(fs, state.font_italic);
         fonsSetColor(fs, white);
-        fonsDrawText(fs, dx, dy, "Ég get etið gler án þess að meiða mig.", NULL);
+        fonsDrawTextCached(fs, dx, dy, "Ég get etið gler án þess að meiða mig.", NULL);
     }
     if (state.font_japanese != FONS_INVALID) {
         fonsVertMetrics(fs, NULL,NULL,&lh);
         dx = sx;
         dy += lh*1.2f;
         fonsSetFont(fs, state.font_japanese);
-        fonsDrawText(fs, dx,dy,"私はガラスを食べられます。それは私を傷つけません。",NULL);
+        fonsDrawTextCached(fs, dx,dy,japanese_text,NULL);
     }
 
     // Font alignment
@@ -241,26 +324,26 @@ static void frame(void) {
         dx = 50*dpis; dy = 350*dpis;
         line(dx-10*dpis,dy,dx+250*dpis,dy);
         fonsSetAlign(fs, FONS_ALIGN_LEFT | FONS_ALIGN_TOP);
-        dx = fonsDrawText(fs, dx,dy,"Top",NULL);
+        dx = fonsDrawTextCached(fs, dx,dy,"Top",NULL);
         dx += 10*dpis;
         fonsSetAlign(fs, FONS_ALIGN_LEFT | FONS_ALIGN_MIDDLE);
-        dx = fonsDrawText(fs, dx,dy,"Middle",NULL);
+        dx = fonsDrawTextCached(fs, dx,dy,"Middle",NULL);
         dx += 10*dpis;
         fonsSetAlign(fs, FONS_ALIGN_LEFT | FONS_ALIGN_BASELINE);
-        dx = fonsDrawText(fs, dx,dy,"Baseline",NULL);
+        dx = fonsDrawTextCached(fs, dx,dy,"Baseline",NULL);
         dx += 10*dpis;
         fonsSetAlign(fs, FONS_ALIGN_LEFT | FONS_ALIGN_BOTTOM);
-        fonsDrawText(fs, dx,dy,"Bottom",NULL);
+        fonsDrawTextCached(fs, dx,dy,"Bottom",NULL);
         dx = 150*dpis; dy = 400*dpis;
         line(dx,dy-30*dpis,dx,dy+80.0f*dpis);
         fonsSetAlign(fs, FONS_ALIGN_LEFT | FONS_ALIGN_BASELINE);
-        fonsDrawText(fs, dx,dy,"Left",NULL);
+        fonsDrawTextCached(fs, dx,dy,"Left",NULL);
         dy += 30*dpis;
         fonsSetAlign(fs, FONS_ALIGN_CENTER | FONS_ALIGN_BASELINE);
-        fonsDrawText(fs, dx,dy,"Center",NULL);
+        fonsDrawTextCached(fs, dx,dy,"Center",NULL);
         dy += 30*dpis;
         fonsSetAlign(fs, FONS_ALIGN_RIGHT | FONS_ALIGN_BASELINE);
-        fonsDrawText(fs, dx,dy,"Right",NULL);
+        fonsDrawTextCached(fs, dx,dy,"Right",NULL);
     }
 
     // Blur
@@ -272,7 +355,7 @@ static void frame(void) {
         fonsSetColor(fs, white);
         fonsSetSpacing(fs, 5.0f*dpis);
         fonsSetBlur(fs, 10.0f);
-        fonsDrawText(fs, dx,dy,"Blurry...",NULL);
+        fonsDrawTextCached(fs, dx,dy,"Blurry...",NULL);
     }
 
     if (state.font_bold != FONS_INVALID) {
@@ -282,10 +365,10 @@ static void frame(void) {
         fonsSetColor(fs, black);
         fonsSetSpacing(fs, 0.0f);
         fonsSetBlur(fs, 3.0f);
-        fonsDrawText(fs, dx,dy+2,"DROP THAT SHADOW",NULL);
+        fonsDrawTextCached(fs, dx,dy+2,"DROP THAT SHADOW",NULL);
         fonsSetColor(fs, white);
         fonsSetBlur(fs, 0);
-        fonsDrawText(fs, dx,dy,"DROP THAT SHADOW",NULL);
+        fonsDrawTextCached(fs, dx,dy,"DROP THAT SHADOW",NULL);
     }
 
     // flush fontstash's font atlas to sokol-gfx texture
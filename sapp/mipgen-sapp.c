@@ -0,0 +1,299 @@
+//------------------------------------------------------------------------------
+//  mipgen-sapp.c
+//
+//  Generating the mipmap chain of a render target with libs/util/mipgen.h,
+//  after rendering into mip level 0.
+//
+//  Keys 1..4 select the reduction filter (box, kaiser, min, max), C switches
+//  between the compute shader and fragment shader path (if compute shaders
+//  are supported).
+//------------------------------------------------------------------------------
+#include "sokol_app.h"
+#include "sokol_gfx.h"
+#include "sokol_log.h"
+#include "sokol_glue.h"
+#define SOKOL_SHAPE_IMPL
+#include "sokol_shape.h"
+#define SOKOL_DEBUGTEXT_IMPL
+#include "sokol_debugtext.h"
+#define VECMATH_GENERICS
+#include "vecmath/vecmath.h"
+#include "dbgui/dbgui.h"
+#include "util/mipgen.h"
+#include "mipgen-sapp.glsl.h"
+
+#define IMG_WIDTH (512)
+#define IMG_HEIGHT (512)
+#define IMG_NUM_MIPMAPS (10)
+
+static struct {
+    float rx, ry;
+    double time;
+    sg_buffer vbuf;
+    sg_buffer ibuf;
+    sg_view tex_view;
+    sg_sampler smp;
+    mipgen_filter_t filter;
+    bool use_compute;
+    mipgen_chain_t* compute_chain;
+    mipgen_chain_t* fragment_chain;
+    struct {
+        sg_pipeline pip;
+        sg_pass_action pass_action;
+        sg_bindings bindings;
+        sg_view color_att_view;
+        sg_view depth_att_view;
+        sshape_element_range_t torus;
+    } offscreen;
+    struct {
+        sg_pipeline pip;
+        sg_pass_action pass_action;
+        sg_bindings bindings;
+        sshape_element_range_t plane;
+    } display;
+} state;
+
+static vs_params_t compute_offscreen_vsparams(void);
+static vs_params_t compute_display_vsparams(void);
+
+static void init(void) {
+    sg_setup(&(sg_desc){
+        .environment = sglue_environment(),
+        .logger.func = slog_func,
+    });
+    sdtx_setup(&(sdtx_desc_t){
+        .fonts[0] = sdtx_font_oric(),
+        .logger.func = slog_func,
+    });
+    mipgen_setup();
+    __dbgui_setup(sapp_sample_count());
+
+    // a torus for the offscreen pass and a plane for the display pass
+    static sshape_vertex_t vertices[4 * 1024];
+    static uint16_t indices[12 * 1024];
+    sshape_buffer_t buf = {
+        .vertices.buffer = SSHAPE_RANGE(vertices),
+        .indices.buffer = SSHAPE_RANGE(indices),
+    };
+    buf = sshape_build_torus(&buf, &(sshape_torus_t){ .radius = 1.0f, .ring_radius = 0.3f, .rings = 36, .sides = 18 });
+    state.offscreen.torus = sshape_element_range(&buf);
+    buf = sshape_build_plane(&buf, &(sshape_plane_t){ .width = 2.0f, .depth = 2.0f });
+    state.display.plane = sshape_element_range(&buf);
+    assert(buf.valid);
+    sg_buffer_desc vbuf_desc = sshape_vertex_buffer_desc(&buf);
+    vbuf_desc.label = "shape-vertices";
+    sg_buffer_desc ibuf_desc = sshape_index_buffer_desc(&buf);
+    ibuf_desc.label = "shape-indices";
+    state.vbuf = sg_make_buffer(&vbuf_desc);
+    state.ibuf = sg_make_buffer(&ibuf_desc);
+
+    // an offscreen render target with a complete mipmap chain, which can
+    // also be written by compute shaders if supported
+    const bool has_compute = sg_query_features().compute;
+    sg_image color_img = sg_make_image(&(sg_image_desc){
+        .usage = {
+            .color_attachment = true,
+            .storage_image = has_compute,
+        },
+        .width = IMG_WIDTH,
+        .height = IMG_HEIGHT,
+        .num_mipmaps = IMG_NUM_MIPMAPS,
+        .pixel_format = SG_PIXELFORMAT_RGBA8,
+        .sample_count = 1,
+        .label = "color-image",
+    });
+
+    // the depth buffer only needs the top mip level
+    sg_image depth_img = sg_make_image(&(sg_image_desc){
+        .usage.depth_stencil_attachment = true,
+        .width = IMG_WIDTH,
+        .height = IMG_HEIGHT,
+        .pixel_format = SG_PIXELFORMAT_DEPTH,
+        .sample_count = 1,
+        .label = "depth-image",
+    });
+    state.offscreen.color_att_view = sg_make_view(&(sg_view_desc){
+        .color_attachment = { .image = color_img },
+        .label = "color-attachment-view",
+    });
+    state.offscreen.depth_att_view = sg_make_view(&(sg_view_desc){
+        .depth_stencil_attachment = { .image = depth_img },
+        .label = "depth-attachment-view",
+    });
+    state.tex_view = sg_make_view(&(sg_view_desc){
+        .texture = { .image = color_img },
+        .label = "color-texture-view",
+    });
+
+    // one mipgen chain for each code path, the compute chain falls
+    // back to the fragment path if compute shaders are not supported
+    state.compute_chain = mipgen_make_chain(&(mipgen_chain_desc_t){ .image = color_img });
+    state.fragment_chain = mipgen_make_chain(&(mipgen_chain_desc_t){ .image = color_img, .force_fragment = true });
+    state.use_compute = mipgen_uses_compute(state.compute_chain);
+
+    // a sampler which blends between mipmaps
+    state.smp = sg_make_sampler(&(sg_sampler_desc){
+        .min_filter = SG_FILTER_LINEAR,
+        .mag_filter = SG_FILTER_LINEAR,
+        .mipmap_filter = SG_FILTER_LINEAR,
+        .wrap_u = SG_WRAP_CLAMP_TO_EDGE,
+        .wrap_v = SG_WRAP_CLAMP_TO_EDGE,
+        .label = "sampler",
+    });
+
+    state.offscreen.pip = sg_make_pipeline(&(sg_pipeline_desc){
+        .layout = {
+            .buffers[0].stride = sizeof(sshape_vertex_t),
+            .attrs = {
+                [ATTR_offscreen_in_pos] = sshape_position_vertex_attr_state(),
+                [ATTR_offscreen_in_nrm] = sshape_normal_vertex_attr_state(),
+            },
+        },
+        .shader = sg_make_shader(offscreen_shader_desc(sg_query_backend())),
+        .index_type = SG_INDEXTYPE_UINT16,
+        .cull_mode = SG_CULLMODE_BACK,
+        .sample_count = 1,
+        .depth = {
+            .write_enabled = true,
+            .compare = SG_COMPAREFUNC_LESS_EQUAL,
+            .pixel_format = SG_PIXELFORMAT_DEPTH,
+        },
+        .colors[0].pixel_format = SG_PIXELFORMAT_RGBA8,
+        .label = "offscreen-pipeline",
+    });
+    state.display.pip = sg_make_pipeline(&(sg_pipeline_desc){
+        .layout = {
+            .buffers[0].stride = sizeof(sshape_vertex_t),
+            .attrs = {
+                [ATTR_display_in_pos] = sshape_position_vertex_attr_state(),
+                [ATTR_display_in_uv] = sshape_texcoord_vertex_attr_state(),
+            },
+        },
+        .shader = sg_make_shader(display_shader_desc(sg_query_backend())),
+        .index_type = SG_INDEXTYPE_UINT16,
+        .cull_mode = SG_CULLMODE_NONE,
+        .depth = {
+            .write_enabled = true,
+            .compare = SG_COMPAREFUNC_LESS_EQUAL,
+        },
+        .label = "display-pipeline",
+    });
+
+    state.offscreen.bindings = (sg_bindings) {
+        .vertex_buffers[0] = state.vbuf,
+        .index_buffer = state.ibuf,
+    };
+    state.display.bindings = (sg_bindings) {
+        .vertex_buffers[0] = state.vbuf,
+        .index_buffer = state.ibuf,
+        .views[VIEW_tex] = state.tex_view,
+        .samplers[SMP_smp] = state.smp,
+    };
+    state.offscreen.pass_action = (sg_pass_action) {
+        .colors[0] = { .load_action = SG_LOADACTION_CLEAR, .clear_value = { 0.5f, 0.5f, 0.5f, 1.0f } },
+    };
+    state.display.pass_action = (sg_pass_action) {
+        .colors[0] = { .load_action = SG_LOADACTION_CLEAR, .clear_value = { 0.0f, 0.0f, 0.0f, 1.0f } },
+    };
+}
+
+static void frame(void) {
+    double dt = sapp_frame_duration();
+    state.time += dt;
+    state.rx += (float)(dt * 20.0f);
+    state.ry += (float)(dt * 40.0f);
+
+    const vs_params_t offscreen_vsparams = compute_offscreen_vsparams();
+    const vs_params_t display_vsparams = compute_display_vsparams();
+
+    // render into the top mip level...
+    sg_begin_pass(&(sg_pass) {
+        .action = state.offscreen.pass_action,
+        .attachments = {
+            .colors[0] = state.offscreen.color_att_view,
+            .depth_stencil = state.offscreen.depth_att_view,
+        },
+    });
+    sg_apply_pipeline(state.offscreen.pip);
+    sg_apply_bindings(&state.offscreen.bindings);
+    sg_apply_uniforms(UB_vs_params, &SG_RANGE(offscreen_vsparams));
+    sg_draw(state.offscreen.torus.base_element, state.offscreen.torus.num_elements, 1);
+    sg_end_pass();
+
+    // ...and generate the remaining mip levels from it
+    mipgen_generate(state.use_compute ? state.compute_chain : state.fragment_chain, state.filter);
+
+    // default pass: render a textured plane that moves back and forth to use different mipmap levels
+    sdtx_canvas(sapp_widthf() * 0.5f, sapp_heightf() * 0.5f);
+    sdtx_origin(1.0f, 1.0f);
+    sdtx_printf("filter: %s (1..4)\n", mipgen_filter_name(state.filter));
+    sdtx_printf("path:   %s%s\n", state.use_compute ? "compute" : "fragment", mipgen_uses_compute(state.compute_chain) ? " (C)" : "");
+    sg_begin_pass(&(sg_pass){ .action = state.display.pass_action, .swapchain = sglue_swapchain() });
+    sg_apply_pipeline(state.display.pip);
+    sg_apply_bindings(&state.display.bindings);
+    sg_apply_uniforms(UB_vs_params, &SG_RANGE(display_vsparams));
+    sg_draw(state.display.plane.base_element, state.display.plane.num_elements, 1);
+    sdtx_draw();
+    __dbgui_draw();
+    sg_end_pass();
+    sg_commit();
+}
+
+static void input(const sapp_event* ev) {
+    if (ev->type == SAPP_EVENTTYPE_KEY_DOWN) {
+        if ((ev->key_code >= SAPP_KEYCODE_1) && (ev->key_code <= SAPP_KEYCODE_4)) {
+            state.filter = (mipgen_filter_t)(ev->key_code - SAPP_KEYCODE_1);
+        } else if (ev->key_code == SAPP_KEYCODE_C) {
+            state.use_compute = !state.use_compute && mipgen_uses_compute(state.compute_chain);
+        }
+    }
+    __dbgui_event(ev);
+}
+
+static void cleanup(void) {
+    __dbgui_shutdown();
+    mipgen_destroy_chain(state.fragment_chain);
+    mipgen_destroy_chain(state.compute_chain);
+    mipgen_shutdown();
+    sdtx_shutdown();
+    sg_shutdown();
+}
+
+// compute a model-view-projection matrix for offscreen rendering (aspect ratio 1:1)
+static vs_params_t compute_offscreen_vsparams(void) {
+    const mat44_t proj = mat44_perspective_fov_rh(vm_radians(60.0f), 1.0f, 0.01f, 10.0f);
+    const mat44_t view = mat44_look_at_rh(vec3(0.0f, 0.0f, 3.0f), vec3(0.0f, 0.0f, 0.0f), vec3(0.0f, 1.0f, 0.0f));
+    const mat44_t view_proj = vm_mul(view, proj);
+    const mat44_t rxm = mat44_rotation_x(vm_radians(state.rx));
+    const mat44_t rym = mat44_rotation_z(vm_radians(state.ry));
+    const mat44_t model = vm_mul(rym, rxm);
+    return (vs_params_t){ .mvp = vm_mul(model, view_proj) };
+}
+
+// compute a model-view-projection matrix with display aspect ratio
+static vs_params_t compute_display_vsparams(void) {
+    const float w = sapp_widthf();
+    const float h = sapp_heightf();
+    const float scale = (vm_sin((float)state.time * 0.5f) + 1.0f) * 0.5f;
+    const mat44_t proj = mat44_perspective_fov_rh(vm_radians(40.0f), w/h, 0.01f, 10.0f);
+    const mat44_t view = mat44_look_at_rh(vec3(0.0f, 0.0f, 2.5f), vec3(0.0f, 0.0f, 0.0f), vec3(0.0f, 1.0f, 0.0f));
+    const mat44_t view_proj = vm_mul(view, proj);
+    const mat44_t model = vm_mul(mat44_rotation_x(vm_radians(90.0f)), mat44_scaling(scale, scale, 1.0f));
+    return (vs_params_t){ .mvp = vm_mul(model, view_proj) };
+}
+
+sapp_desc sokol_main(int argc, char* argv[]) {
+    (void)argc; (void)argv;
+    return (sapp_desc){
+        .init_cb = init,
+        .frame_cb = frame,
+        .cleanup_cb = cleanup,
+        .event_cb = input,
+        .width = 800,
+        .height = 600,
+        .sample_count = 1,
+        .window_title = "mipgen-sapp.c",
+        .icon.sokol_default = true,
+        .logger.func = slog_func,
+    };
+}
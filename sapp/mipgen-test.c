@@ -0,0 +1,177 @@
+//------------------------------------------------------------------------------
+//  mipgen-test.c
+//
+//  Checks the min/max mip chains of the libs/util/mipgen.h compute path
+//  on non-power-of-two sizes against a CPU reference.
+//
+//  The compute shader in mipgen-compute.glsl is emulated on the CPU
+//  (16x16 workgroups, the intermediate levels in a shared memory tile),
+//  with the dispatches split like mipgen_generate() does it. The reference
+//  reduces one level at a time with the 3 texel wide min/max of
+//  mipgen-reduce.glsl, which is also what the fragment path does, so that
+//  every texel of a level covers all source texels below it.
+//
+//  Usage: mipgen-test
+//------------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "util/mipgen.h"
+
+typedef struct {
+    int width;
+    int height;
+    float* texels;
+} level_t;
+
+static int num_mips_for(int width, int height) {
+    const int max_dim = (width > height) ? width : height;
+    int num_mips = 1;
+    while ((max_dim >> num_mips) > 0) {
+        num_mips++;
+    }
+    return num_mips;
+}
+
+static float fetch(const level_t* l, int x, int y) {
+    x = (x < 0) ? 0 : ((x >= l->width) ? l->width - 1 : x);
+    y = (y < 0) ? 0 : ((y >= l->height) ? l->height - 1 : y);
+    return l->texels[y * l->width + x];
+}
+
+static float reduce(float a, float b, mipgen_filter_t filter) {
+    if (filter == MIPGEN_FILTER_MIN) {
+        return (a < b) ? a : b;
+    } else {
+        return (a > b) ? a : b;
+    }
+}
+
+// reduce_src() in mipgen-reduce.glsl
+static float reduce_src(const level_t* src, int dst_x, int dst_y, mipgen_filter_t filter) {
+    const int sx = dst_x * 2;
+    const int sy = dst_y * 2;
+    const int nx = (sx + 2 == src->width - 1) ? 3 : 2;
+    const int ny = (sy + 2 == src->height - 1) ? 3 : 2;
+    float res = fetch(src, sx, sy);
+    for (int y = 0; y < ny; y++) {
+        for (int x = 0; x < nx; x++) {
+            res = reduce(res, fetch(src, sx + x, sy + y), filter);
+        }
+    }
+    return res;
+}
+
+static void reference_level(const level_t* src, level_t* dst, mipgen_filter_t filter) {
+    for (int y = 0; y < dst->height; y++) {
+        for (int x = 0; x < dst->width; x++) {
+            dst->texels[y * dst->width + x] = reduce_src(src, x, y, filter);
+        }
+    }
+}
+
+// one dispatch of mipgen-compute.glsl, reading levels[0] and writing levels[1..num_levels]
+static void emulate_dispatch(level_t* levels, int num_levels, mipgen_filter_t filter) {
+    const int num_groups_x = (levels[1].width + MIPGEN_TILE_DIM - 1) / MIPGEN_TILE_DIM;
+    const int num_groups_y = (levels[1].height + MIPGEN_TILE_DIM - 1) / MIPGEN_TILE_DIM;
+    for (int gy = 0; gy < num_groups_y; gy++) {
+        for (int gx = 0; gx < num_groups_x; gx++) {
+            float tile[MIPGEN_TILE_DIM][MIPGEN_TILE_DIM];
+            for (int ly = 0; ly < MIPGEN_TILE_DIM; ly++) {
+                for (int lx = 0; lx < MIPGEN_TILE_DIM; lx++) {
+                    tile[ly][lx] = reduce_src(&levels[0], gx * MIPGEN_TILE_DIM + lx, gy * MIPGEN_TILE_DIM + ly, filter);
+                }
+            }
+            int dim = MIPGEN_TILE_DIM;
+            for (int level = 1; level <= num_levels; level++) {
+                if (level > 1) {
+                    // reduce_tile(), in place is fine since the reads are ahead of the writes
+                    dim /= 2;
+                    for (int ly = 0; ly < dim; ly++) {
+                        for (int lx = 0; lx < dim; lx++) {
+                            const float a = reduce(tile[ly * 2][lx * 2], tile[ly * 2][lx * 2 + 1], filter);
+                            const float b = reduce(tile[ly * 2 + 1][lx * 2], tile[ly * 2 + 1][lx * 2 + 1], filter);
+                            tile[ly][lx] = reduce(a, b, filter);
+                        }
+                    }
+                }
+                level_t* dst = &levels[level];
+                for (int ly = 0; ly < dim; ly++) {
+                    for (int lx = 0; lx < dim; lx++) {
+                        const int x = gx * dim + lx;
+                        const int y = gy * dim + ly;
+                        if ((x < dst->width) && (y < dst->height)) {
+                            dst->texels[y * dst->width + x] = tile[ly][lx];
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+static bool test(int width, int height, mipgen_filter_t filter) {
+    const char* name = (filter == MIPGEN_FILTER_MIN) ? "min" : "max";
+    const int num_mips = num_mips_for(width, height);
+    level_t ref[SG_MAX_MIPMAPS];
+    level_t gpu[SG_MAX_MIPMAPS];
+    for (int mip = 0; mip < num_mips; mip++) {
+        const int w = mipgen_mip_size(width, mip);
+        const int h = mipgen_mip_size(height, mip);
+        ref[mip] = (level_t){ .width = w, .height = h, .texels = (float*)calloc((size_t)(w * h), sizeof(float)) };
+        gpu[mip] = (level_t){ .width = w, .height = h, .texels = (float*)calloc((size_t)(w * h), sizeof(float)) };
+    }
+    // random depth values with a single extreme texel in the last row
+    // and column, which must survive into the 1x1 level
+    uint32_t seed = (uint32_t)(width * 7919 + height);
+    for (int i = 0; i < width * height; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        ref[0].texels[i] = 0.25f + 0.5f * (float)(seed >> 8) / (float)(1 << 24);
+    }
+    ref[0].texels[width * height - 1] = (filter == MIPGEN_FILTER_MIN) ? 0.0f : 1.0f;
+    memcpy(gpu[0].texels, ref[0].texels, (size_t)(width * height) * sizeof(float));
+
+    for (int mip = 1; mip < num_mips; mip++) {
+        reference_level(&ref[mip - 1], &ref[mip], filter);
+    }
+    int num_dispatches = 0;
+    int num_levels = 0;
+    for (int src_mip = 0; src_mip < (num_mips - 1); src_mip += num_levels) {
+        num_levels = mipgen_compute_dispatch_levels(width, height, num_mips, src_mip, filter);
+        emulate_dispatch(&gpu[src_mip], num_levels, filter);
+        num_dispatches++;
+    }
+
+    bool ok = true;
+    for (int mip = 1; mip < num_mips; mip++) {
+        const size_t num_bytes = (size_t)(ref[mip].width * ref[mip].height) * sizeof(float);
+        if (0 != memcmp(ref[mip].texels, gpu[mip].texels, num_bytes)) {
+            printf("%4dx%-4d %s: mip %d (%dx%d) differs from the reference\n",
+                width, height, name, mip, ref[mip].width, ref[mip].height);
+            ok = false;
+            break;
+        }
+    }
+    if (ok) {
+        printf("%4dx%-4d %s: %d levels in %d dispatches ok\n", width, height, name, num_mips - 1, num_dispatches);
+    }
+    for (int mip = 0; mip < num_mips; mip++) {
+        free(ref[mip].texels);
+        free(gpu[mip].texels);
+    }
+    return ok;
+}
+
+int main(void) {
+    static const int sizes[][2] = {
+        { 135, 77 }, { 1920, 1080 }, { 1280, 720 }, { 1366, 768 }, { 33, 17 },
+        { 17, 1 }, { 1, 255 }, { 1000, 3 }, { 99, 99 }, { 512, 512 },
+    };
+    bool ok = true;
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        ok &= test(sizes[i][0], sizes[i][1], MIPGEN_FILTER_MIN);
+        ok &= test(sizes[i][0], sizes[i][1], MIPGEN_FILTER_MAX);
+    }
+    printf("%s\n", ok ? "all tests passed" : "FAILED");
+    return ok ? 0 : 10;
+}
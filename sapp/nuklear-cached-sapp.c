@@ -0,0 +1,483 @@
+//------------------------------------------------------------------------------
+//  nuklear-cached-sapp.c
+//
+//  Nuklear UI with a custom renderer instead of snk_render(), sokol_nuklear.h
+//  is still used for setup, input and font baking (see nuklear-sapp.c for
+//  the standard way of rendering Nuklear with sokol_nuklear.h).
+//
+//  The renderer at the end of this file:
+//
+//  - skips nk_convert() and the vertex/index buffer updates when the
+//    Nuklear command buffer is identical to the previous frame's
+//  - allocates the convert output buffers from an arena instead of malloc,
+//    each buffer has its own region of the arena and only moves to the
+//    heap when it outgrows its region
+//  - grows the GPU buffers geometrically and only when needed, instead
+//    of re-creating or re-filling them each frame
+//
+//  The 'Animate' checkbox changes the UI every frame, so that each frame
+//  needs a convert.
+//------------------------------------------------------------------------------
+#include "sokol_app.h"
+#include "sokol_gfx.h"
+#include "sokol_log.h"
+#include "sokol_glue.h"
+#include "dbgui/dbgui.h"
+
+// include nuklear.h before the sokol_nuklear.h implementation
+#define NK_INCLUDE_FIXED_TYPES
+#define NK_INCLUDE_STANDARD_IO
+#define NK_INCLUDE_DEFAULT_ALLOCATOR
+#define NK_INCLUDE_VERTEX_BUFFER_OUTPUT
+#define NK_INCLUDE_FONT_BAKING
+#define NK_INCLUDE_DEFAULT_FONT
+#define NK_INCLUDE_STANDARD_VARARGS
+#include "nuklear/nuklear.h"
+#define SOKOL_NUKLEAR_IMPL
+#include "sokol_nuklear.h"
+#include "nuklear-cached-sapp.glsl.h"
+
+// Nuklear renderer functions (implementation is at the end of this file)
+typedef struct {
+    uint64_t frames;
+    uint64_t converts;
+    uint64_t failed_converts;
+    size_t heap_bytes;      // size of the convert buffers which have outgrown their arena region
+} r_stats_t;
+static void r_init(void);
+static void r_shutdown(void);
+static void r_render(struct nk_context* ctx, int width, int height);
+static r_stats_t r_stats(void);
+
+static struct {
+    nk_bool animate;
+    int num_rows;
+    float slider;
+    int option;
+    struct nk_colorf color;
+    double time;
+    double stats_time;
+    r_stats_t stats;    // shown stats, only updated once per second so that the UI stays unchanged
+} state = {
+    .stats_time = -1.0,
+    .num_rows = 16,
+    .slider = 0.5f,
+    .color = { 0.25f, 0.5f, 0.7f, 1.0f },
+};
+
+static void draw_ui(struct nk_context* ctx) {
+    state.time += sapp_frame_duration();
+    if ((state.stats_time < 0.0) || ((state.time - state.stats_time) >= 1.0)) {
+        state.stats = r_stats();
+        state.stats_time = state.time;
+    }
+
+    if (nk_begin(ctx, "Cached Renderer", nk_rect(20, 20, 300, 240), NK_WINDOW_BORDER|NK_WINDOW_MOVABLE|NK_WINDOW_SCALABLE|NK_WINDOW_TITLE|NK_WINDOW_MINIMIZABLE)) {
+        nk_layout_row_dynamic(ctx, 20, 1);
+        nk_labelf(ctx, NK_TEXT_LEFT, "frames: %llu", (unsigned long long)state.stats.frames);
+        nk_labelf(ctx, NK_TEXT_LEFT, "converts: %llu", (unsigned long long)state.stats.converts);
+        nk_labelf(ctx, NK_TEXT_LEFT, "cached frames: %.1f%%", (state.stats.frames > 0) ?
+            (100.0 * (double)(state.stats.frames - state.stats.converts) / (double)state.stats.frames) : 0.0);
+        nk_labelf(ctx, NK_TEXT_LEFT, "failed converts: %llu", (unsigned long long)state.stats.failed_converts);
+        nk_labelf(ctx, NK_TEXT_LEFT, "buffers on heap: %d KB", (int)(state.stats.heap_bytes / 1024));
+        nk_checkbox_label(ctx, "Animate", &state.animate);
+        nk_layout_row_dynamic(ctx, 25, 2);
+        nk_label(ctx, "Rows:", NK_TEXT_LEFT);
+        nk_slider_int(ctx, 1, &state.num_rows, 256, 1);
+    }
+    nk_end(ctx);
+
+    if (nk_begin(ctx, "Widgets", nk_rect(340, 20, 400, 500), NK_WINDOW_BORDER|NK_WINDOW_MOVABLE|NK_WINDOW_SCALABLE|NK_WINDOW_TITLE)) {
+        if (state.animate) {
+            nk_layout_row_dynamic(ctx, 20, 1);
+            nk_size progress = (nk_size)(state.time * 50.0) % 100;
+            nk_progress(ctx, &progress, 100, nk_false);
+        }
+        nk_layout_row_dynamic(ctx, 25, 2);
+        nk_slider_float(ctx, 0.0f, &state.slider, 1.0f, 0.01f);
+        nk_property_int(ctx, "Option:", 0, &state.option, 2, 1, 1);
+        nk_layout_row_dynamic(ctx, 120, 1);
+        state.color = nk_color_picker(ctx, state.color, NK_RGBA);
+        nk_layout_row_dynamic(ctx, 20, 3);
+        for (int i = 0; i < state.num_rows; i++) {
+            nk_labelf(ctx, NK_TEXT_LEFT, "Row %d", i);
+            nk_button_label(ctx, "Button");
+            nk_option_label(ctx, "Option", state.option == (i % 3));
+        }
+    }
+    nk_end(ctx);
+}
+
+static void init(void) {
+    sg_setup(&(sg_desc){
+        .environment = sglue_environment(),
+        .logger.func = slog_func,
+    });
+    __dbgui_setup(sapp_sample_count());
+    snk_setup(&(snk_desc_t){
+        .enable_set_mouse_cursor = true,
+        .dpi_scale = sapp_dpi_scale(),
+        .logger.func = slog_func,
+    });
+    r_init();
+}
+
+static void frame(void) {
+    struct nk_context* ctx = snk_new_frame();
+    draw_ui(ctx);
+    sg_begin_pass(&(sg_pass){
+        .action = {
+            .colors[0] = {
+                .load_action = SG_LOADACTION_CLEAR,
+                .clear_value = { state.color.r, state.color.g, state.color.b, 1.0f },
+            },
+        },
+        .swapchain = sglue_swapchain()
+    });
+    r_render(ctx, sapp_width(), sapp_height());
+    __dbgui_draw();
+    sg_end_pass();
+    sg_commit();
+}
+
+static void cleanup(void) {
+    r_shutdown();
+    __dbgui_shutdown();
+    snk_shutdown();
+    sg_shutdown();
+}
+
+static void input(const sapp_event* event) {
+    if (!__dbgui_event_with_retval(event)) {
+        snk_handle_event(event);
+    }
+}
+
+sapp_desc sokol_main(int argc, char* argv[]) {
+    (void)argc;
+    (void)argv;
+    return (sapp_desc) {
+        .init_cb = init,
+        .frame_cb = frame,
+        .cleanup_cb = cleanup,
+        .event_cb = input,
+        .enable_clipboard = true,
+        .width = 1024,
+        .height = 768,
+        .window_title = "nuklear-cached (sokol-app)",
+        .ios_keyboard_resizes_canvas = true,
+        .icon.sokol_default = true,
+        .logger.func = slog_func,
+    };
+}
+
+//== Nuklear renderer ==========================================================
+#define R_ARENA_SIZE (8 * 1024 * 1024)
+#define R_INITIAL_VERTICES (16 * 1024)
+#define R_INITIAL_INDICES (48 * 1024)
+#define R_MAX_DRAW_CMDS (1024)
+
+typedef struct {
+    float pos[2];
+    float uv[2];
+    uint8_t col[4];
+} r_vertex_t;
+
+typedef struct {
+    unsigned int elem_count;
+    struct nk_rect clip_rect;
+    sg_view tex_view;
+    sg_sampler smp;
+} r_draw_cmd_t;
+
+// One region of the arena per Nuklear buffer, so that each buffer can
+// grow in place up to the region size. Beyond that the buffer moves to
+// the heap (and back into its region if it is ever re-created smaller).
+typedef struct {
+    uint8_t* base;
+    size_t size;
+    size_t heap_size;   // size of the buffer's heap block, 0 while in the region
+    struct nk_allocator alloc;
+} r_region_t;
+
+typedef enum {
+    R_REGION_CMDS,
+    R_REGION_VERTS,
+    R_REGION_IDX,
+    R_REGION_PREV_MEMORY,
+    R_NUM_REGIONS,
+} r_region_index_t;
+
+// region sizes in percent of the arena
+static const int r_region_percent[R_NUM_REGIONS] = { 10, 50, 25, 15 };
+
+static struct {
+    uint8_t* arena;
+    r_region_t regions[R_NUM_REGIONS];
+    struct nk_buffer cmds;
+    struct nk_buffer verts;
+    struct nk_buffer idx;
+    struct nk_buffer prev_memory;   // copy of the previous frame's command memory
+    struct {
+        size_t first_cmd;
+        int width;
+        int height;
+        bool valid;
+    } prev;
+    r_stats_t stats;
+    // GPU resources
+    sg_buffer vbuf;
+    sg_buffer ibuf;
+    size_t vbuf_size;
+    size_t ibuf_size;
+    sg_pipeline pip;
+    sg_image white_img;
+    sg_view white_view;
+    sg_sampler white_smp;
+    // the draw commands of the last convert
+    int num_draw_cmds;
+    r_draw_cmd_t draw_cmds[R_MAX_DRAW_CMDS];
+} r;
+
+// nk_buffer_realloc() copies the content and frees the old block when
+// the returned pointer differs from the old one, so a heap block is never
+// resized in place
+static void* r_region_alloc(nk_handle handle, void* old, nk_size size) {
+    (void)old;
+    r_region_t* region = (r_region_t*)handle.ptr;
+    if (size <= region->size) {
+        region->heap_size = 0;
+        return region->base;
+    }
+    void* ptr = malloc(size);
+    if (ptr) {
+        region->heap_size = size;
+    }
+    return ptr;
+}
+
+static void r_region_free(nk_handle handle, void* ptr) {
+    r_region_t* region = (r_region_t*)handle.ptr;
+    if (ptr != region->base) {
+        free(ptr);
+    }
+}
+
+// create or grow a dynamic GPU buffer, the size at least doubles, so
+// that re-creating the buffer is rare
+static void r_reserve_buffer(sg_buffer* buf, size_t* cur_size, size_t needed_size, bool index_buffer) {
+    if (needed_size <= *cur_size) {
+        return;
+    }
+    size_t new_size = *cur_size ? *cur_size : needed_size;
+    while (new_size < needed_size) {
+        new_size *= 2;
+    }
+    sg_destroy_buffer(*buf);
+    *buf = sg_make_buffer(&(sg_buffer_desc){
+        .usage = {
+            .vertex_buffer = !index_buffer,
+            .index_buffer = index_buffer,
+            .dynamic_update = true,
+        },
+        .size = new_size,
+        .label = index_buffer ? "nuklear-indices" : "nuklear-vertices",
+    });
+    *cur_size = new_size;
+}
+
+static void r_init(void) {
+    r.arena = (uint8_t*) malloc(R_ARENA_SIZE);
+    size_t offset = 0;
+    for (int i = 0; i < R_NUM_REGIONS; i++) {
+        r_region_t* region = &r.regions[i];
+        region->base = r.arena + offset;
+        region->size = ((size_t)R_ARENA_SIZE * (size_t)r_region_percent[i] / 100) & ~(size_t)15;
+        region->alloc = (struct nk_allocator){
+            .userdata = nk_handle_ptr(region),
+            .alloc = r_region_alloc,
+            .free = r_region_free,
+        };
+        offset += region->size;
+    }
+    nk_buffer_init(&r.cmds, &r.regions[R_REGION_CMDS].alloc, 64 * 1024);
+    nk_buffer_init(&r.verts, &r.regions[R_REGION_VERTS].alloc, R_INITIAL_VERTICES * sizeof(r_vertex_t));
+    nk_buffer_init(&r.idx, &r.regions[R_REGION_IDX].alloc, R_INITIAL_INDICES * sizeof(nk_draw_index));
+    nk_buffer_init(&r.prev_memory, &r.regions[R_REGION_PREV_MEMORY].alloc, 64 * 1024);
+    r_reserve_buffer(&r.vbuf, &r.vbuf_size, R_INITIAL_VERTICES * sizeof(r_vertex_t), false);
+    r_reserve_buffer(&r.ibuf, &r.ibuf_size, R_INITIAL_INDICES * sizeof(nk_draw_index), true);
+
+    // a white texture for untextured shapes
+    const uint32_t white_pixel = 0xFFFFFFFF;
+    r.white_img = sg_make_image(&(sg_image_desc){
+        .width = 1,
+        .height = 1,
+        .data.subimage[0][0] = SG_RANGE(white_pixel),
+        .label = "nuklear-white-image",
+    });
+    r.white_view = sg_make_view(&(sg_view_desc){
+        .texture = { .image = r.white_img },
+        .label = "nuklear-white-view",
+    });
+    r.white_smp = sg_make_sampler(&(sg_sampler_desc){ .label = "nuklear-white-sampler" });
+
+    r.pip = sg_make_pipeline(&(sg_pipeline_desc){
+        .shader = sg_make_shader(nuklear_shader_desc(sg_query_backend())),
+        .layout = {
+            .attrs = {
+                [ATTR_nuklear_position] = { .offset = offsetof(r_vertex_t, pos), .format = SG_VERTEXFORMAT_FLOAT2 },
+                [ATTR_nuklear_texcoord0] = { .offset = offsetof(r_vertex_t, uv), .format = SG_VERTEXFORMAT_FLOAT2 },
+                [ATTR_nuklear_color0] = { .offset = offsetof(r_vertex_t, col), .format = SG_VERTEXFORMAT_UBYTE4N },
+            },
+        },
+        .index_type = SG_INDEXTYPE_UINT16,
+        .colors[0] = {
+            .write_mask = SG_COLORMASK_RGB,
+            .blend = {
+                .enabled = true,
+                .src_factor_rgb = SG_BLENDFACTOR_SRC_ALPHA,
+                .dst_factor_rgb = SG_BLENDFACTOR_ONE_MINUS_SRC_ALPHA,
+            },
+        },
+        .label = "nuklear-pipeline",
+    });
+}
+
+static void r_shutdown(void) {
+    // frees the heap blocks of buffers which have outgrown their region
+    nk_buffer_free(&r.cmds);
+    nk_buffer_free(&r.verts);
+    nk_buffer_free(&r.idx);
+    nk_buffer_free(&r.prev_memory);
+    free(r.arena);
+    r.arena = 0;
+}
+
+static r_stats_t r_stats(void) {
+    r_stats_t stats = r.stats;
+    for (int i = 0; i < R_NUM_REGIONS; i++) {
+        stats.heap_bytes += r.regions[i].heap_size;
+    }
+    return stats;
+}
+
+// true if the command buffer is identical to the previous frame's,
+// nk__begin() links the window command lists, so that the command memory
+// also captures window order and visibility
+static bool r_commands_unchanged(struct nk_context* ctx, int width, int height) {
+    const nk_byte* memory = (const nk_byte*) ctx->memory.memory.ptr;
+    const struct nk_command* first = nk__begin(ctx);
+    const size_t first_cmd = first ? (size_t)((const nk_byte*)first - memory) : (size_t)-1;
+    const nk_size size = ctx->memory.allocated;
+    const bool unchanged = r.prev.valid &&
+        (r.prev.width == width) && (r.prev.height == height) &&
+        (r.prev.first_cmd == first_cmd) &&
+        (r.prev_memory.allocated == size) &&
+        (0 == memcmp(r.prev_memory.memory.ptr, memory, size));
+    if (!unchanged) {
+        nk_buffer_clear(&r.prev_memory);
+        nk_buffer_push(&r.prev_memory, NK_BUFFER_FRONT, memory, size, 1);
+        r.prev.valid = (r.prev_memory.allocated == size);
+        r.prev.first_cmd = first_cmd;
+        r.prev.width = width;
+        r.prev.height = height;
+    }
+    return unchanged;
+}
+
+static void r_convert(struct nk_context* ctx) {
+    static const struct nk_draw_vertex_layout_element vertex_layout[] = {
+        { NK_VERTEX_POSITION, NK_FORMAT_FLOAT, offsetof(r_vertex_t, pos) },
+        { NK_VERTEX_TEXCOORD, NK_FORMAT_FLOAT, offsetof(r_vertex_t, uv) },
+        { NK_VERTEX_COLOR, NK_FORMAT_R8G8B8A8, offsetof(r_vertex_t, col) },
+        { NK_VERTEX_LAYOUT_END }
+    };
+    const struct nk_convert_config cfg = {
+        .vertex_layout = vertex_layout,
+        .vertex_size = sizeof(r_vertex_t),
+        .vertex_alignment = 4,
+        .tex_null = { .texture = nk_handle_id(0), .uv = { 0.5f, 0.5f } },
+        .circle_segment_count = 22,
+        .curve_segment_count = 22,
+        .arc_segment_count = 22,
+        .global_alpha = 1.0f,
+        .shape_AA = NK_ANTI_ALIASING_ON,
+        .line_AA = NK_ANTI_ALIASING_ON,
+    };
+    nk_buffer_clear(&r.cmds);
+    nk_buffer_clear(&r.verts);
+    nk_buffer_clear(&r.idx);
+    r.num_draw_cmds = 0;
+    r.stats.converts++;
+    const nk_flags res = nk_convert(ctx, &r.cmds, &r.verts, &r.idx, &cfg);
+    if (res != NK_CONVERT_SUCCESS) {
+        // only when out of memory, the buffers move to the heap when they outgrow their region
+        r.stats.failed_converts++;
+        r.prev.valid = false;
+        return;
+    }
+
+    // only update the GPU buffers here, cached frames reuse their content
+    const size_t vsize = r.verts.needed;
+    const size_t isize = r.idx.needed;
+    if ((vsize > 0) && (isize > 0)) {
+        r_reserve_buffer(&r.vbuf, &r.vbuf_size, vsize, false);
+        r_reserve_buffer(&r.ibuf, &r.ibuf_size, isize, true);
+        sg_update_buffer(r.vbuf, &(sg_range){ .ptr = nk_buffer_memory_const(&r.verts), .size = vsize });
+        sg_update_buffer(r.ibuf, &(sg_range){ .ptr = nk_buffer_memory_const(&r.idx), .size = isize });
+    }
+
+    // keep the draw commands, these are gone after nk_clear()
+    const struct nk_draw_command* cmd = 0;
+    nk_draw_foreach(cmd, ctx, &r.cmds) {
+        if ((cmd->elem_count == 0) || (r.num_draw_cmds == R_MAX_DRAW_CMDS)) {
+            continue;
+        }
+        r_draw_cmd_t* dc = &r.draw_cmds[r.num_draw_cmds++];
+        dc->elem_count = cmd->elem_count;
+        dc->clip_rect = cmd->clip_rect;
+        if (cmd->texture.id != 0) {
+            const snk_image_desc_t img_desc = snk_query_image_desc(snk_image_from_nkhandle(cmd->texture));
+            dc->tex_view = img_desc.texture_view;
+            dc->smp = img_desc.sampler;
+        } else {
+            dc->tex_view = r.white_view;
+            dc->smp = r.white_smp;
+        }
+    }
+}
+
+static void r_render(struct nk_context* ctx, int width, int height) {
+    r.stats.frames++;
+    if (!r_commands_unchanged(ctx, width, height)) {
+        r_convert(ctx);
+    }
+    nk_clear(ctx);
+
+    const float dpi_scale = sapp_dpi_scale();
+    const vs_params_t vs_params = {
+        .disp_size[0] = (float)width / dpi_scale,
+        .disp_size[1] = (float)height / dpi_scale,
+    };
+    sg_apply_pipeline(r.pip);
+    sg_apply_uniforms(UB_vs_params, &SG_RANGE(vs_params));
+    int idx_offset = 0;
+    for (int i = 0; i < r.num_draw_cmds; i++) {
+        const r_draw_cmd_t* dc = &r.draw_cmds[i];
+        sg_apply_bindings(&(sg_bindings){
+            .vertex_buffers[0] = r.vbuf,
+            .index_buffer = r.ibuf,
+            .views[VIEW_tex] = dc->tex_view,
+            .samplers[SMP_smp] = dc->smp,
+        });
+        sg_apply_scissor_rectf(
+            dc->clip_rect.x * dpi_scale,
+            dc->clip_rect.y * dpi_scale,
+            dc->clip_rect.w * dpi_scale,
+            dc->clip_rect.h * dpi_scale,
+            true);
+        sg_draw(idx_offset, (int)dc->elem_count, 1);
+        idx_offset += (int)dc->elem_count;
+    }
+    sg_apply_scissor_rect(0, 0, width, height, true);
+}
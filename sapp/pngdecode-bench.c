@@ -0,0 +1,156 @@
+//------------------------------------------------------------------------------
+//  pngdecode-bench.c
+//
+//  Benchmark for the PNG decoder in libs/util/pngdec.h against stock
+//  stb_image (compiled into this file, without the pngdec fast path of
+//  libs/stb/stb_image.c).
+//
+//  Each file is decoded to RGBA like the samples do, the pngdec output
+//  is first validated against stb_image, then both decoders run a number
+//  of times and the best run is reported as MB/s of decoded pixels.
+//
+//  Usage: pngdecode-bench [-n iterations] file.png [file.png ...]
+//
+//  For instance with the sample assets:
+//
+//      pngdecode-bench sapp/data/baboon.png sapp/data/spine/*.png
+//------------------------------------------------------------------------------
+#if defined(_MSC_VER)
+#define _CRT_SECURE_NO_WARNINGS (1)
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#define STB_IMAGE_STATIC
+#define STB_IMAGE_IMPLEMENTATION
+#define STBI_ONLY_PNG
+#if defined(__clang__)
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wunused-function"
+#pragma clang diagnostic ignored "-Wsign-conversion"
+#elif defined(__GNUC__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-function"
+#pragma GCC diagnostic ignored "-Wsign-conversion"
+#endif
+#include "stb/stb_image.h"
+#if defined(__clang__)
+#pragma clang diagnostic pop
+#elif defined(__GNUC__)
+#pragma GCC diagnostic pop
+#endif
+#include "util/pngdec.h"
+
+#define DEFAULT_NUM_ITERATIONS (20)
+#define NUM_CHANNELS (4)
+
+static double now_ms(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec * 1000.0 + (double)ts.tv_nsec / 1000000.0;
+}
+
+static uint8_t* load_file(const char* path, int* out_size) {
+    FILE* fp = fopen(path, "rb");
+    if (!fp) {
+        return 0;
+    }
+    fseek(fp, 0, SEEK_END);
+    const long size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    uint8_t* data = (size > 0) ? (uint8_t*)malloc((size_t)size) : 0;
+    if (data && (fread(data, 1, (size_t)size, fp) != (size_t)size)) {
+        free(data);
+        data = 0;
+    }
+    fclose(fp);
+    *out_size = (int)size;
+    return data;
+}
+
+// best time of a number of decodes in milliseconds
+static double bench_stb(const uint8_t* data, int size, int num_iterations) {
+    double best = 1.0e30;
+    for (int i = 0; i < num_iterations; i++) {
+        int w, h, n;
+        const double start = now_ms();
+        stbi_uc* pixels = stbi_load_from_memory(data, size, &w, &h, &n, NUM_CHANNELS);
+        const double t = now_ms() - start;
+        stbi_image_free(pixels);
+        best = (t < best) ? t : best;
+    }
+    return best;
+}
+
+static double bench_pngdec(const uint8_t* data, int size, int num_iterations) {
+    double best = 1.0e30;
+    for (int i = 0; i < num_iterations; i++) {
+        int w, h, n;
+        uint8_t* pixels = 0;
+        const double start = now_ms();
+        pngdec_decode(data, (size_t)size, NUM_CHANNELS, &pixels, &w, &h, &n);
+        const double t = now_ms() - start;
+        free(pixels);
+        best = (t < best) ? t : best;
+    }
+    return best;
+}
+
+int main(int argc, char* argv[]) {
+    int num_iterations = DEFAULT_NUM_ITERATIONS;
+    int first_file = 1;
+    if ((argc > 2) && (0 == strcmp(argv[1], "-n"))) {
+        num_iterations = atoi(argv[2]);
+        first_file = 3;
+    }
+    if ((first_file >= argc) || (num_iterations < 1)) {
+        printf("usage: pngdecode-bench [-n iterations] file.png [file.png ...]\n");
+        return 10;
+    }
+
+    int ok = 1;
+    double total_mb = 0.0, total_stb_ms = 0.0, total_pngdec_ms = 0.0;
+    printf("%-24s %12s %10s %12s %8s\n", "file", "size", "stb MB/s", "pngdec MB/s", "speedup");
+    for (int i = first_file; i < argc; i++) {
+        const char* name = strrchr(argv[i], '/') ? strrchr(argv[i], '/') + 1 : argv[i];
+        int size = 0;
+        uint8_t* data = load_file(argv[i], &size);
+        if (!data) {
+            printf("%-24s failed to load\n", name);
+            ok = 0;
+            continue;
+        }
+        int w0, h0, n0, w1, h1, n1;
+        stbi_uc* ref = stbi_load_from_memory(data, size, &w0, &h0, &n0, NUM_CHANNELS);
+        uint8_t* pixels = 0;
+        const pngdec_result_t res = pngdec_decode(data, (size_t)size, NUM_CHANNELS, &pixels, &w1, &h1, &n1);
+        if (!ref) {
+            printf("%-24s stb_image failed: %s\n", name, stbi_failure_reason());
+            ok = 0;
+        } else if (res == PNGDEC_UNSUPPORTED) {
+            printf("%-24s not supported by pngdec (stb_image fallback)\n", name);
+        } else if ((res != PNGDEC_OK) || (w0 != w1) || (h0 != h1) || (n0 != n1) || (0 != memcmp(ref, pixels, (size_t)(w0 * h0 * NUM_CHANNELS)))) {
+            printf("%-24s validation FAILED (result %d)\n", name, res);
+            ok = 0;
+        } else {
+            const double mb = (double)w0 * (double)h0 * NUM_CHANNELS / (1024.0 * 1024.0);
+            const double stb_ms = bench_stb(data, size, num_iterations);
+            const double pngdec_ms = bench_pngdec(data, size, num_iterations);
+            char size_str[32];
+            snprintf(size_str, sizeof(size_str), "%dx%dx%d", w0, h0, n0);
+            printf("%-24s %12s %10.1f %12.1f %7.2fx\n", name, size_str, mb * 1000.0 / stb_ms, mb * 1000.0 / pngdec_ms, stb_ms / pngdec_ms);
+            fflush(stdout);
+            total_mb += mb;
+            total_stb_ms += stb_ms;
+            total_pngdec_ms += pngdec_ms;
+        }
+        stbi_image_free(ref);
+        free(pixels);
+        free(data);
+    }
+    if (total_mb > 0.0) {
+        printf("%-24s %12s %10.1f %12.1f %7.2fx\n", "total", "", total_mb * 1000.0 / total_stb_ms, total_mb * 1000.0 / total_pngdec_ms, total_stb_ms / total_pngdec_ms);
+    }
+    return ok ? 0 : 10;
+}
@@ -6,6 +6,12 @@
 //
 //  NOTE: for the debugging UI, cimgui is used via sokol_gfx_cimgui.h
 //  (C bindings to Dear ImGui instead of the ImGui C++ API)
+//
+//  The renderer caches the tessellated vertices of each microui root
+//  container (window, popup) and only re-tessellates containers whose
+//  commands have changed, if the whole command list is unchanged since
+//  the last frame the per-container check is skipped too, and the cached
+//  vertex streams are replayed into sokol-gl.
 //------------------------------------------------------------------------------
 #if defined(_MSC_VER)
 #define _CRT_SECURE_NO_WARNINGS (1)
@@ -41,7 +47,9 @@ static void style_window(mu_Context* ctx);
 
 // microui renderer functions (implementation is at the end of this file)
 static void r_init(void);
+static void r_shutdown(void);
 static void r_begin(int disp_width, int disp_height);
+static void r_render_commands(mu_Context* ctx);
 static void r_end(void);
 static void r_draw(void);
 static void r_push_quad(mu_Rect dst, mu_Rect src, mu_Color color);
@@ -156,15 +164,7 @@ void frame(void) {
 
     // micro-ui rendering
     r_begin(sapp_width(), sapp_height());
-    mu_Command* cmd = 0;
-    while(mu_next_command(&state.mu_ctx, &cmd)) {
-        switch (cmd->type) {
-            case MU_COMMAND_TEXT: r_draw_text(cmd->text.str, cmd->text.pos, cmd->text.color); break;
-            case MU_COMMAND_RECT: r_draw_rect(cmd->rect.rect, cmd->rect.color); break;
-            case MU_COMMAND_ICON: r_draw_icon(cmd->icon.id, cmd->icon.rect, cmd->icon.color); break;
-            case MU_COMMAND_CLIP: r_set_clip_rect(cmd->clip.rect); break;
-        }
-    }
+    r_render_commands(&state.mu_ctx);
     r_end();
 
     // render the sokol-gfx default pass
@@ -184,6 +184,7 @@ void frame(void) {
 }
 
 static void cleanup(void) {
+    r_shutdown();
     __cdbgui_shutdown();
     sgl_shutdown();
     sg_shutdown();
@@ -384,6 +385,40 @@ static sg_view atlas_view;
 static sg_sampler atlas_smp;
 static sgl_pipeline pip;
 
+// a tessellated vertex, color is packed as 0xAABBGGRR like sgl_c1i()
+typedef struct {
+    float x, y, u, v;
+    uint32_t color;
+} r_vertex_t;
+
+// a range of vertices, optionally starting with a new scissor rect
+typedef struct {
+    bool set_clip;
+    mu_Rect clip;
+    int first_vertex;
+    int num_vertices;
+} r_batch_t;
+
+// cached vertices of one root container
+typedef struct {
+    bool valid;
+    uint64_t hash;
+    r_vertex_t* vertices;
+    int num_vertices;
+    int max_vertices;
+    r_batch_t* batches;
+    int num_batches;
+    int max_batches;
+} r_cache_t;
+
+static struct {
+    uint64_t frame_hash;
+    r_cache_t* cur;                                 // the cache currently tessellated into
+    r_cache_t containers[MU_CONTAINERPOOL_SIZE];    // one cache per microui container slot
+    int num_roots;
+    int roots[MU_ROOTLIST_SIZE];                    // container slots in draw order
+} r_cache;
+
 static void r_init(void) {
 
     // atlas image data is in atlas.inl file, this only contains alpha
@@ -430,6 +465,14 @@ static void r_init(void) {
     free(rgba8_pixels);
 }
 
+static void r_shutdown(void) {
+    for (int i = 0; i < MU_CONTAINERPOOL_SIZE; i++) {
+        free(r_cache.containers[i].vertices);
+        free(r_cache.containers[i].batches);
+    }
+    memset(&r_cache, 0, sizeof(r_cache));
+}
+
 static void r_begin(int disp_width, int disp_height) {
     sgl_defaults();
     sgl_push_pipeline();
@@ -452,6 +495,156 @@ static void r_draw(void) {
     sgl_draw();
 }
 
+static uint64_t r_hash(uint64_t hash, const void* ptr, size_t size) {
+    const uint8_t* bytes = (const uint8_t*) ptr;
+    while (size >= 8) {
+        uint64_t word;
+        memcpy(&word, bytes, 8);
+        hash = (hash ^ word) * 0x9E3779B97F4A7C15ULL;
+        hash ^= hash >> 32;
+        bytes += 8;
+        size -= 8;
+    }
+    while (size > 0) {
+        hash = (hash ^ *bytes++) * 0x100000001B3ULL;
+        size--;
+    }
+    return hash;
+}
+
+// Hash only the meaningful fields of a command: the structs may contain
+// uninitialized padding, and text commands are sized with room to spare
+// behind the string terminator.
+static uint64_t r_hash_command(uint64_t hash, const mu_Command* cmd) {
+    hash = r_hash(hash, &cmd->type, sizeof(cmd->type));
+    switch (cmd->type) {
+        case MU_COMMAND_JUMP:
+            hash = r_hash(hash, &cmd->jump.dst, sizeof(cmd->jump.dst));
+            break;
+        case MU_COMMAND_CLIP:
+            hash = r_hash(hash, &cmd->clip.rect, sizeof(cmd->clip.rect));
+            break;
+        case MU_COMMAND_RECT:
+            hash = r_hash(hash, &cmd->rect.rect, sizeof(cmd->rect.rect));
+            hash = r_hash(hash, &cmd->rect.color, sizeof(cmd->rect.color));
+            break;
+        case MU_COMMAND_TEXT:
+            hash = r_hash(hash, &cmd->text.font, sizeof(cmd->text.font));
+            hash = r_hash(hash, &cmd->text.pos, sizeof(cmd->text.pos));
+            hash = r_hash(hash, &cmd->text.color, sizeof(cmd->text.color));
+            // including the terminator keeps adjacent strings apart
+            hash = r_hash(hash, cmd->text.str, strlen(cmd->text.str) + 1);
+            break;
+        case MU_COMMAND_ICON:
+            hash = r_hash(hash, &cmd->icon.rect, sizeof(cmd->icon.rect));
+            hash = r_hash(hash, &cmd->icon.id, sizeof(cmd->icon.id));
+            hash = r_hash(hash, &cmd->icon.color, sizeof(cmd->icon.color));
+            break;
+    }
+    return hash;
+}
+
+// Iterate the commands of a root container, 'begin' and 'end' delimit the
+// container's commands without its head and tail jump commands. A jump
+// inside this range is the head of a nested root container (e.g. a popup),
+// which skips the nested commands, the nested container has its own cache.
+static mu_Command* r_next_container_command(mu_Command* cmd, const char* end) {
+    while ((char*) cmd < end) {
+        if (cmd->type != MU_COMMAND_JUMP) {
+            return cmd;
+        }
+        cmd = (mu_Command*) cmd->jump.dst;
+    }
+    return 0;
+}
+
+static mu_Command* r_skip_command(mu_Command* cmd) {
+    return (mu_Command*) (((char*) cmd) + cmd->base.size);
+}
+
+static uint64_t r_hash_container(mu_Command* begin, const char* end) {
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    for (mu_Command* cmd = r_next_container_command(begin, end); cmd; cmd = r_next_container_command(r_skip_command(cmd), end)) {
+        hash = r_hash_command(hash, cmd);
+    }
+    return hash;
+}
+
+static void r_push_batch(bool set_clip, mu_Rect clip) {
+    r_cache_t* cache = r_cache.cur;
+    if (cache->num_batches == cache->max_batches) {
+        cache->max_batches = cache->max_batches ? cache->max_batches * 2 : 16;
+        cache->batches = (r_batch_t*) realloc(cache->batches, (size_t)cache->max_batches * sizeof(r_batch_t));
+    }
+    cache->batches[cache->num_batches++] = (r_batch_t){
+        .set_clip = set_clip,
+        .clip = clip,
+        .first_vertex = cache->num_vertices,
+    };
+}
+
+static void r_tessellate_container(r_cache_t* cache, mu_Command* begin, const char* end) {
+    r_cache.cur = cache;
+    cache->num_vertices = 0;
+    cache->num_batches = 0;
+    r_push_batch(false, mu_rect(0, 0, 0, 0));
+    for (mu_Command* cmd = r_next_container_command(begin, end); cmd; cmd = r_next_container_command(r_skip_command(cmd), end)) {
+        switch (cmd->type) {
+            case MU_COMMAND_TEXT: r_draw_text(cmd->text.str, cmd->text.pos, cmd->text.color); break;
+            case MU_COMMAND_RECT: r_draw_rect(cmd->rect.rect, cmd->rect.color); break;
+            case MU_COMMAND_ICON: r_draw_icon(cmd->icon.id, cmd->icon.rect, cmd->icon.color); break;
+            case MU_COMMAND_CLIP: r_set_clip_rect(cmd->clip.rect); break;
+        }
+    }
+    r_cache.cur = 0;
+}
+
+static void r_replay_container(const r_cache_t* cache) {
+    for (int bi = 0; bi < cache->num_batches; bi++) {
+        const r_batch_t* batch = &cache->batches[bi];
+        if (batch->set_clip) {
+            sgl_end();
+            sgl_scissor_rect(batch->clip.x, batch->clip.y, batch->clip.w, batch->clip.h, true);
+            sgl_begin_quads();
+        }
+        const r_vertex_t* vtx = &cache->vertices[batch->first_vertex];
+        for (int vi = 0; vi < batch->num_vertices; vi++, vtx++) {
+            sgl_v2f_t2f_c1i(vtx->x, vtx->y, vtx->u, vtx->v, vtx->color);
+        }
+    }
+}
+
+// called after mu_end(): re-tessellates changed root containers and replays all of them
+static void r_render_commands(mu_Context* ctx) {
+    // root container order and content are unchanged if the whole command list is
+    uint64_t frame_hash = 0xCBF29CE484222325ULL;
+    const char* cmd_end = ctx->command_list.items + ctx->command_list.idx;
+    for (mu_Command* cmd = (mu_Command*) ctx->command_list.items; (char*) cmd < cmd_end; cmd = r_skip_command(cmd)) {
+        frame_hash = r_hash_command(frame_hash, cmd);
+    }
+    if (frame_hash != r_cache.frame_hash) {
+        r_cache.frame_hash = frame_hash;
+        r_cache.num_roots = 0;
+        for (int i = 0; i < ctx->root_list.idx; i++) {
+            mu_Container* cnt = ctx->root_list.items[i];
+            mu_Command* begin = (mu_Command*) (((char*) cnt->head) + sizeof(mu_JumpCommand));
+            const char* end = (const char*) cnt->tail;
+            const int slot = (int) (cnt - ctx->containers);
+            r_cache_t* cache = &r_cache.containers[slot];
+            const uint64_t hash = r_hash_container(begin, end);
+            if (!cache->valid || (cache->hash != hash)) {
+                r_tessellate_container(cache, begin, end);
+                cache->hash = hash;
+                cache->valid = true;
+            }
+            r_cache.roots[r_cache.num_roots++] = slot;
+        }
+    }
+    for (int i = 0; i < r_cache.num_roots; i++) {
+        r_replay_container(&r_cache.containers[r_cache.roots[i]]);
+    }
+}
+
 static void r_push_quad(mu_Rect dst, mu_Rect src, mu_Color color) {
     float u0 = (float) src.x / (float) ATLAS_WIDTH;
     float v0 = (float) src.y / (float) ATLAS_HEIGHT;
@@ -463,11 +656,19 @@ static void r_push_quad(mu_Rect dst, mu_Rect src, mu_Color color) {
     float x1 = (float) (dst.x + dst.w);
     float y1 = (float) (dst.y + dst.h);
 
-    sgl_c4b(color.r, color.g, color.b, color.a);
-    sgl_v2f_t2f(x0, y0, u0, v0);
-    sgl_v2f_t2f(x1, y0, u1, v0);
-    sgl_v2f_t2f(x1, y1, u1, v1);
-    sgl_v2f_t2f(x0, y1, u0, v1);
+    r_cache_t* cache = r_cache.cur;
+    if ((cache->num_vertices + 4) > cache->max_vertices) {
+        cache->max_vertices = cache->max_vertices ? cache->max_vertices * 2 : 1024;
+        cache->vertices = (r_vertex_t*) realloc(cache->vertices, (size_t)cache->max_vertices * sizeof(r_vertex_t));
+    }
+    const uint32_t c = (uint32_t)color.r | ((uint32_t)color.g<<8) | ((uint32_t)color.b<<16) | ((uint32_t)color.a<<24);
+    r_vertex_t* vtx = &cache->vertices[cache->num_vertices];
+    vtx[0] = (r_vertex_t){ x0, y0, u0, v0, c };
+    vtx[1] = (r_vertex_t){ x1, y0, u1, v0, c };
+    vtx[2] = (r_vertex_t){ x1, y1, u1, v1, c };
+    vtx[3] = (r_vertex_t){ x0, y1, u0, v1, c };
+    cache->num_vertices += 4;
+    cache->batches[cache->num_batches - 1].num_vertices += 4;
 }
 
 static void r_draw_rect(mu_Rect rect, mu_Color color) {
@@ -505,7 +706,5 @@ static int r_get_text_height(void) {
 }
 
 static void r_set_clip_rect(mu_Rect rect) {
-    sgl_end();
-    sgl_scissor_rect(rect.x, rect.y, rect.w, rect.h, true);
-    sgl_begin_quads();
+    r_push_batch(true, rect);
 }
@@ -0,0 +1,234 @@
+//------------------------------------------------------------------------------
+//  sgl-record-sapp.c
+//
+//  Compares re-submitting static geometry through sokol_gl.h each frame
+//  with recording it once into an immutable vertex buffer and replaying
+//  it with one draw call per batch (see libs/util/sglrec.h).
+//
+//  The same scene generator (a point cloud, many line strips and triangle
+//  strips, about 200K vertices) drives both paths. Press SPACE to toggle
+//  between immediate and recorded mode, the CPU time for emitting and
+//  submitting the geometry is displayed.
+//------------------------------------------------------------------------------
+#include "sokol_app.h"
+#include "sokol_gfx.h"
+#include "sokol_log.h"
+#include "sokol_glue.h"
+#include "sokol_time.h"
+#define SOKOL_GL_IMPL
+#include "sokol_gl.h"
+#define SOKOL_DEBUGTEXT_IMPL
+#include "sokol_debugtext.h"
+#define VECMATH_GENERICS
+#include "vecmath/vecmath.h"
+#include "util/sglrec.h"
+#include "dbgui/dbgui.h"
+#include "sgl-record-sapp.glsl.h"
+#include <math.h>
+
+#define NUM_POINTS (64 * 1024)
+#define NUM_LINE_STRIPS (256)
+#define LINE_STRIP_LENGTH (256)
+#define NUM_TRI_STRIPS (64)
+#define TRI_STRIP_LENGTH (1024)
+#define MAX_VERTICES (NUM_POINTS + NUM_LINE_STRIPS * LINE_STRIP_LENGTH + NUM_TRI_STRIPS * TRI_STRIP_LENGTH)
+
+// the vertex API subset used by the scene generator, implemented
+// by sokol_gl.h for the immediate path and sglrec.h for recording
+typedef struct {
+    void (*begin_points)(void);
+    void (*begin_line_strip)(void);
+    void (*begin_triangle_strip)(void);
+    void (*end)(void);
+    void (*c3f)(float r, float g, float b);
+    void (*v3f)(float x, float y, float z);
+} vertex_api_t;
+
+static const vertex_api_t sgl_api = {
+    .begin_points = sgl_begin_points,
+    .begin_line_strip = sgl_begin_line_strip,
+    .begin_triangle_strip = sgl_begin_triangle_strip,
+    .end = sgl_end,
+    .c3f = sgl_c3f,
+    .v3f = sgl_v3f,
+};
+
+static const vertex_api_t sglrec_api = {
+    .begin_points = sglrec_begin_points,
+    .begin_line_strip = sglrec_begin_line_strip,
+    .begin_triangle_strip = sglrec_begin_triangle_strip,
+    .end = sglrec_end,
+    .c3f = sglrec_c3f,
+    .v3f = sglrec_v3f,
+};
+
+static struct {
+    bool recorded;
+    sgl_pipeline sgl_pip;
+    sglrec_list_t* list;
+    uint64_t last_time;
+    double emit_ms;     // smoothed CPU time for emitting and submitting the geometry
+    double frame_ms;
+} state;
+
+static void emit_scene(const vertex_api_t* api) {
+    const float pi = 3.14159265f;
+
+    // a point cloud on a torus
+    api->begin_points();
+    for (int i = 0; i < NUM_POINTS; i++) {
+        const float u = (float)(i & 255) / 256.0f * 2.0f * pi;
+        const float v = (float)(i >> 8) / (float)(NUM_POINTS >> 8) * 2.0f * pi;
+        const float r = 0.8f + 0.25f * cosf(v);
+        api->c3f(0.5f + 0.5f * cosf(u), 0.5f + 0.5f * sinf(v), 1.0f);
+        api->v3f(r * cosf(u), 0.25f * sinf(v), r * sinf(u));
+    }
+    api->end();
+
+    // lissajous curves around the torus
+    for (int s = 0; s < NUM_LINE_STRIPS; s++) {
+        const float phase = (float)s / NUM_LINE_STRIPS * 2.0f * pi;
+        api->begin_line_strip();
+        api->c3f(1.0f, 0.5f + 0.5f * sinf(phase), 0.2f);
+        for (int i = 0; i < LINE_STRIP_LENGTH; i++) {
+            const float t = (float)i / (LINE_STRIP_LENGTH - 1) * 2.0f * pi;
+            api->v3f(1.4f * sinf(3.0f * t + phase), 1.0f * sinf(2.0f * t), 1.4f * cosf(5.0f * t + phase));
+        }
+        api->end();
+    }
+
+    // a sphere built from triangle strips
+    const int slices = TRI_STRIP_LENGTH / 2;
+    for (int s = 0; s < NUM_TRI_STRIPS; s++) {
+        const float lat0 = ((float)s / NUM_TRI_STRIPS - 0.5f) * pi;
+        const float lat1 = ((float)(s + 1) / NUM_TRI_STRIPS - 0.5f) * pi;
+        api->begin_triangle_strip();
+        for (int i = 0; i < slices; i++) {
+            const float lon = (float)i / (slices - 1) * 2.0f * pi;
+            api->c3f(0.2f, 0.3f + 0.2f * (float)(s & 1), 0.4f + 0.3f * cosf(lon));
+            api->v3f(0.5f * cosf(lat0) * cosf(lon), 0.5f * sinf(lat0), 0.5f * cosf(lat0) * sinf(lon));
+            api->v3f(0.5f * cosf(lat1) * cosf(lon), 0.5f * sinf(lat1), 0.5f * cosf(lat1) * sinf(lon));
+        }
+        api->end();
+    }
+}
+
+static void init(void) {
+    sg_setup(&(sg_desc){
+        .environment = sglue_environment(),
+        .logger.func = slog_func,
+    });
+    __dbgui_setup(sapp_sample_count());
+    stm_setup();
+    sgl_setup(&(sgl_desc_t){
+        .max_vertices = MAX_VERTICES + 1024,
+        .max_commands = 4096,
+        .logger.func = slog_func,
+    });
+    sdtx_setup(&(sdtx_desc_t){
+        .fonts[0] = sdtx_font_oric(),
+        .logger.func = slog_func,
+    });
+
+    const sg_pipeline_desc pip_desc = {
+        .depth = {
+            .write_enabled = true,
+            .compare = SG_COMPAREFUNC_LESS_EQUAL,
+        },
+        .cull_mode = SG_CULLMODE_NONE,
+    };
+    state.sgl_pip = sgl_make_pipeline(&pip_desc);
+
+    // record the scene once into an immutable vertex buffer
+    sg_pipeline_desc rec_pip_desc = pip_desc;
+    rec_pip_desc.shader = sg_make_shader(record_shader_desc(sg_query_backend()));
+    rec_pip_desc.label = "sglrec-pipeline";
+    sglrec_setup(&(sglrec_desc_t){
+        .pipeline = rec_pip_desc,
+        .max_vertices = MAX_VERTICES * 2,
+    });
+    sglrec_begin_record();
+    emit_scene(&sglrec_api);
+    state.list = sglrec_end_record("recorded-scene");
+}
+
+static mat44_t compute_mvp(void) {
+    const float w = sapp_widthf();
+    const float h = sapp_heightf();
+    const float t = (float)(sapp_frame_count() % 3600) * 0.1f;
+    const mat44_t proj = mat44_perspective_fov_rh(vm_radians(45.0f), w/h, 0.1f, 100.0f);
+    const mat44_t view = mat44_look_at_rh(vec3(0.0f, 1.5f, 4.0f), vec3(0.0f, 0.0f, 0.0f), vec3(0.0f, 1.0f, 0.0f));
+    const mat44_t model = mat44_rotation_y(vm_radians(t));
+    return vm_mul(model, vm_mul(view, proj));
+}
+
+static void frame(void) {
+    state.frame_ms = stm_ms(stm_laptime(&state.last_time));
+    const mat44_t mvp = compute_mvp();
+    const sglrec_stats_t stats = sglrec_query_stats(state.list);
+
+    sdtx_canvas(sapp_widthf() * 0.5f, sapp_heightf() * 0.5f);
+    sdtx_origin(1, 1);
+    sdtx_printf("mode:     %s (SPACE to toggle)\n\n", state.recorded ? "recorded" : "immediate");
+    sdtx_printf("vertices: %d submitted, %d recorded\n", MAX_VERTICES, stats.num_vertices);
+    sdtx_printf("batches:  %d\n\n", stats.num_batches);
+    sdtx_printf("emit+submit: %.3f ms\n", state.emit_ms);
+    sdtx_printf("frame:       %.3f ms\n", state.frame_ms);
+
+    sg_begin_pass(&(sg_pass){
+        .action = {
+            .colors[0] = { .load_action = SG_LOADACTION_CLEAR, .clear_value = { 0.0f, 0.0f, 0.0f, 1.0f } },
+        },
+        .swapchain = sglue_swapchain()
+    });
+    // only time the emit and submit work, not the pass setup
+    const uint64_t start = stm_now();
+    if (state.recorded) {
+        sglrec_draw(state.list, (const float*)&mvp);
+    } else {
+        sgl_defaults();
+        sgl_load_pipeline(state.sgl_pip);
+        sgl_matrix_mode_projection();
+        sgl_load_matrix((const float*)&mvp);
+        emit_scene(&sgl_api);
+        sgl_draw();
+    }
+    const double emit_ms = stm_ms(stm_since(start));
+    state.emit_ms = (state.emit_ms * 0.95) + (emit_ms * 0.05);
+    sdtx_draw();
+    __dbgui_draw();
+    sg_end_pass();
+    sg_commit();
+}
+
+static void input(const sapp_event* ev) {
+    if ((ev->type == SAPP_EVENTTYPE_KEY_DOWN) && (ev->key_code == SAPP_KEYCODE_SPACE)) {
+        state.recorded = !state.recorded;
+    }
+    __dbgui_event(ev);
+}
+
+static void cleanup(void) {
+    __dbgui_shutdown();
+    sglrec_destroy(state.list);
+    sglrec_shutdown();
+    sdtx_shutdown();
+    sgl_shutdown();
+    sg_shutdown();
+}
+
+sapp_desc sokol_main(int argc, char* argv[]) {
+    (void)argc; (void)argv;
+    return (sapp_desc) {
+        .init_cb = init,
+        .frame_cb = frame,
+        .cleanup_cb = cleanup,
+        .event_cb = input,
+        .width = 800,
+        .height = 600,
+        .sample_count = 4,
+        .window_title = "sgl-record-sapp.c",
+        .icon.sokol_default = true,
+        .logger.func = slog_func,
+    };
+}
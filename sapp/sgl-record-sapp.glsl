@@ -0,0 +1,34 @@
+// shader for replaying recorded sokol-gl geometry (see libs/util/sglrec.h),
+// the vertex layout is the same as sokol_gl.h
+@ctype mat4 mat44_t
+
+@vs vs
+layout(binding=0) uniform vs_params {
+    mat4 mvp;
+};
+
+layout(location=0) in vec4 position;
+layout(location=1) in vec2 texcoord0;
+layout(location=2) in vec4 color0;
+layout(location=3) in float psize;
+
+out vec4 color;
+
+void main() {
+    gl_Position = mvp * position;
+    gl_PointSize = psize;
+    // no texturing, but keep the texcoord attribute alive to match the vertex layout
+    color = color0 + vec4(texcoord0 * 0.0, 0.0, 0.0);
+}
+@end
+
+@fs fs
+in vec4 color;
+out vec4 frag_color;
+
+void main() {
+    frag_color = color;
+}
+@end
+
+@program record vs fs
@@ -0,0 +1,233 @@
+//------------------------------------------------------------------------------
+//  sgprof-summary.c
+//
+//  Offline summary of a frame capture written by libs/util/sgprof.h:
+//  per-frame call counts, redundant state applications, upload sizes,
+//  and the pipelines with the most draw calls and redundant applications.
+//
+//  Usage: sgprof-summary capture.sgprof [--frames]
+//
+//  With --frames, also prints one line per captured frame.
+//------------------------------------------------------------------------------
+#if defined(_MSC_VER)
+#define _CRT_SECURE_NO_WARNINGS (1)
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "util/sgprof.h"
+
+#define MAX_PIPELINES (1024)
+#define NUM_TOP_PIPELINES (10)
+
+typedef struct {
+    uint32_t calls[SGPROF_NUM_RECORD_TYPES];
+    uint32_t redundant[SGPROF_NUM_RECORD_TYPES];
+    uint64_t bytes[SGPROF_NUM_RECORD_TYPES];
+    uint64_t num_elements;
+} counters_t;
+
+typedef struct {
+    uint32_t id;
+    uint32_t applies;
+    uint32_t redundant_applies;
+    uint32_t draws;
+    uint64_t num_elements;
+} pipeline_stats_t;
+
+static const char* record_names[SGPROF_NUM_RECORD_TYPES] = {
+    "frames", "begin_pass", "end_pass", "apply_pipeline", "apply_bindings", "apply_uniforms",
+    "draw", "dispatch", "update_buffer", "append_buffer", "update_image",
+};
+
+static struct {
+    counters_t total;
+    counters_t frame;
+    counters_t max;     // max per frame
+    pipeline_stats_t pipelines[MAX_PIPELINES];
+    int num_pipelines;
+    pipeline_stats_t* cur_pip;
+    bool print_frames;
+} state;
+
+static pipeline_stats_t* lookup_pipeline(uint32_t id) {
+    for (int i = 0; i < state.num_pipelines; i++) {
+        if (state.pipelines[i].id == id) {
+            return &state.pipelines[i];
+        }
+    }
+    if (state.num_pipelines < MAX_PIPELINES) {
+        pipeline_stats_t* pip = &state.pipelines[state.num_pipelines++];
+        pip->id = id;
+        return pip;
+    }
+    return 0;
+}
+
+static void end_frame(uint32_t frame_index) {
+    if (state.print_frames) {
+        printf("frame %6u: passes %3u, pipelines %4u (%u redundant), bindings %4u (%u redundant), "
+               "uniforms %5u (%u redundant), draws %5u, uploads %llu bytes\n",
+            frame_index,
+            state.frame.calls[SGPROF_RECORD_BEGIN_PASS],
+            state.frame.calls[SGPROF_RECORD_APPLY_PIPELINE], state.frame.redundant[SGPROF_RECORD_APPLY_PIPELINE],
+            state.frame.calls[SGPROF_RECORD_APPLY_BINDINGS], state.frame.redundant[SGPROF_RECORD_APPLY_BINDINGS],
+            state.frame.calls[SGPROF_RECORD_APPLY_UNIFORMS], state.frame.redundant[SGPROF_RECORD_APPLY_UNIFORMS],
+            state.frame.calls[SGPROF_RECORD_DRAW],
+            (unsigned long long)(state.frame.bytes[SGPROF_RECORD_UPDATE_BUFFER] +
+                                 state.frame.bytes[SGPROF_RECORD_APPEND_BUFFER] +
+                                 state.frame.bytes[SGPROF_RECORD_UPDATE_IMAGE]));
+    }
+    for (int i = 0; i < SGPROF_NUM_RECORD_TYPES; i++) {
+        if (state.frame.calls[i] > state.max.calls[i]) {
+            state.max.calls[i] = state.frame.calls[i];
+        }
+        if (state.frame.redundant[i] > state.max.redundant[i]) {
+            state.max.redundant[i] = state.frame.redundant[i];
+        }
+        if (state.frame.bytes[i] > state.max.bytes[i]) {
+            state.max.bytes[i] = state.frame.bytes[i];
+        }
+    }
+    memset(&state.frame, 0, sizeof(state.frame));
+}
+
+static void process(const sgprof_record_t* rec) {
+    if (rec->type >= SGPROF_NUM_RECORD_TYPES) {
+        return;
+    }
+    const bool redundant = 0 != (rec->flags & SGPROF_RECORDFLAG_REDUNDANT);
+    counters_t* counters[2] = { &state.total, &state.frame };
+    for (int i = 0; i < 2; i++) {
+        counters[i]->calls[rec->type]++;
+        if (redundant) {
+            counters[i]->redundant[rec->type]++;
+        }
+    }
+    switch (rec->type) {
+        case SGPROF_RECORD_FRAME:
+            end_frame(rec->id);
+            break;
+        case SGPROF_RECORD_BEGIN_PASS:
+            state.cur_pip = 0;
+            break;
+        case SGPROF_RECORD_APPLY_PIPELINE:
+            state.cur_pip = lookup_pipeline(rec->id);
+            if (state.cur_pip) {
+                state.cur_pip->applies++;
+                if (redundant) {
+                    state.cur_pip->redundant_applies++;
+                }
+            }
+            break;
+        case SGPROF_RECORD_APPLY_UNIFORMS:
+        case SGPROF_RECORD_UPDATE_BUFFER:
+        case SGPROF_RECORD_APPEND_BUFFER:
+        case SGPROF_RECORD_UPDATE_IMAGE:
+            state.total.bytes[rec->type] += rec->arg0;
+            state.frame.bytes[rec->type] += rec->arg0;
+            break;
+        case SGPROF_RECORD_DRAW:
+            {
+                const uint64_t num_elements = (uint64_t)rec->arg0 * rec->arg1;
+                state.total.num_elements += num_elements;
+                if (state.cur_pip) {
+                    state.cur_pip->draws++;
+                    state.cur_pip->num_elements += num_elements;
+                }
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+static int compare_pipeline_draws(const void* a, const void* b) {
+    const pipeline_stats_t* pa = (const pipeline_stats_t*)a;
+    const pipeline_stats_t* pb = (const pipeline_stats_t*)b;
+    return (pa->draws < pb->draws) ? 1 : ((pa->draws > pb->draws) ? -1 : 0);
+}
+
+static double percent(uint32_t part, uint32_t total) {
+    return (total > 0) ? ((100.0 * part) / total) : 0.0;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: sgprof-summary capture.sgprof [--frames]\n");
+        return 10;
+    }
+    state.print_frames = (argc > 2) && (0 == strcmp(argv[2], "--frames"));
+    FILE* fp = fopen(argv[1], "rb");
+    if (!fp) {
+        fprintf(stderr, "failed to open '%s'\n", argv[1]);
+        return 10;
+    }
+    sgprof_file_header_t hdr;
+    if ((1 != fread(&hdr, sizeof(hdr), 1, fp)) ||
+        (hdr.magic != SGPROF_FILE_MAGIC) ||
+        (hdr.version != SGPROF_FILE_VERSION) ||
+        (hdr.record_size != sizeof(sgprof_record_t)))
+    {
+        fprintf(stderr, "'%s' is not an sgprof capture file (or has the wrong version)\n", argv[1]);
+        fclose(fp);
+        return 10;
+    }
+    sgprof_record_t recs[4096];
+    size_t num_recs;
+    while ((num_recs = fread(recs, sizeof(sgprof_record_t), 4096, fp)) > 0) {
+        for (size_t i = 0; i < num_recs; i++) {
+            process(&recs[i]);
+        }
+    }
+    fclose(fp);
+
+    const uint32_t num_frames = state.total.calls[SGPROF_RECORD_FRAME];
+    if (num_frames == 0) {
+        fprintf(stderr, "no complete frames in '%s'\n", argv[1]);
+        return 10;
+    }
+    if (num_frames != hdr.num_frames) {
+        printf("warning: header says %u frames, found %u (capture not finished?)\n", hdr.num_frames, num_frames);
+    }
+    printf("\n%u frames\n\n", num_frames);
+    printf("%-16s %12s %10s %10s %12s %14s\n", "call", "total", "per frame", "max/frame", "redundant", "bytes/frame");
+    for (int i = SGPROF_RECORD_BEGIN_PASS; i < SGPROF_NUM_RECORD_TYPES; i++) {
+        if (i == SGPROF_RECORD_END_PASS) {
+            continue;
+        }
+        char redundant[32] = "";
+        if ((i == SGPROF_RECORD_APPLY_PIPELINE) || (i == SGPROF_RECORD_APPLY_BINDINGS) || (i == SGPROF_RECORD_APPLY_UNIFORMS)) {
+            snprintf(redundant, sizeof(redundant), "%.1f%%", percent(state.total.redundant[i], state.total.calls[i]));
+        }
+        char bytes[32] = "";
+        if (state.total.bytes[i] > 0) {
+            snprintf(bytes, sizeof(bytes), "%.0f", (double)state.total.bytes[i] / num_frames);
+        }
+        printf("%-16s %12u %10.1f %10u %12s %14s\n",
+            record_names[i],
+            state.total.calls[i],
+            (double)state.total.calls[i] / num_frames,
+            state.max.calls[i],
+            redundant,
+            bytes);
+    }
+    printf("\nelements per frame: %.0f\n", (double)state.total.num_elements / num_frames);
+    const uint32_t wasted = state.total.redundant[SGPROF_RECORD_APPLY_PIPELINE] +
+                            state.total.redundant[SGPROF_RECORD_APPLY_BINDINGS] +
+                            state.total.redundant[SGPROF_RECORD_APPLY_UNIFORMS];
+    printf("redundant apply calls per frame: %.1f\n", (double)wasted / num_frames);
+
+    qsort(state.pipelines, (size_t)state.num_pipelines, sizeof(pipeline_stats_t), compare_pipeline_draws);
+    printf("\n%-10s %12s %12s %12s %14s\n", "pipeline", "draws/frame", "applies", "redundant", "elements/draw");
+    for (int i = 0; (i < state.num_pipelines) && (i < NUM_TOP_PIPELINES); i++) {
+        const pipeline_stats_t* pip = &state.pipelines[i];
+        printf("%-10u %12.1f %12u %11.1f%% %14.1f\n",
+            pip->id,
+            (double)pip->draws / num_frames,
+            pip->applies,
+            percent(pip->redundant_applies, pip->applies),
+            (pip->draws > 0) ? ((double)pip->num_elements / pip->draws) : 0.0);
+    }
+    return 0;
+}
@@ -0,0 +1,574 @@
+//------------------------------------------------------------------------------
+//  shadows-csm-sapp.c
+//
+//  Cascaded shadow maps with libs/util/csm.h over a large field of boxes:
+//
+//  - 4 cascades with texel-snapped, rotation-invariant light projections
+//  - per-cascade caster culling against the cascade's light volume
+//  - the 2 far cascades are cached: their static casters are rendered
+//    into a separate depth map only when the cascade has moved, the light
+//    has changed, or the static casters have moved; the moving boxes are
+//    rendered on top of a copy of the cached depth, and when no moving box
+//    is in the cascade, the cached depth map is sampled directly
+//
+//  Keys:
+//  - C: toggle cascade caching
+//  - L: toggle light animation
+//  - S: move the static boxes
+//  - D: show cascades
+//  - P: pause camera
+//------------------------------------------------------------------------------
+#include <assert.h>
+#include <stddef.h>
+#include "sokol_app.h"
+#include "sokol_gfx.h"
+#include "sokol_log.h"
+#include "sokol_glue.h"
+#define SOKOL_DEBUGTEXT_IMPL
+#include "sokol_debugtext.h"
+#include "dbgui/dbgui.h"
+#define VECMATH_GENERICS
+#include "vecmath/vecmath.h"
+#include "util/csm.h"
+#include "shadows-csm-sapp.glsl.h"
+
+#define SHADOW_MAP_SIZE (1024)
+#define FIELD_SIZE (200.0f)
+#define GRID_DIM (24)
+#define NUM_STATIC_BOXES (GRID_DIM * GRID_DIM)
+#define NUM_DYNAMIC_BOXES (16)
+#define NUM_BOXES (NUM_STATIC_BOXES + NUM_DYNAMIC_BOXES)
+#define GROUND_INSTANCE (NUM_BOXES)
+#define NUM_INSTANCES (NUM_BOXES + 1)
+// worst case: all boxes in all cascades, twice for cached cascades, plus the display pass
+#define MAX_FRAME_INSTANCES (NUM_BOXES * CSM_MAX_CASCADES * 2 + NUM_INSTANCES)
+#define CAMERA_PATH_RADIUS (40.0f)
+#define CAMERA_HEIGHT (4.0f)
+#define CAMERA_FOV (60.0f)
+#define CAMERA_NEARZ (0.1f)
+#define CAMERA_FARZ (150.0f)
+
+typedef struct {
+    vec4_t pos;     // xyz: center
+    vec4_t size;    // xyz: half extents
+    vec4_t color;
+} instance_t;
+
+typedef struct {
+    int base;       // first instance in the stream buffer
+    int count;
+} instance_range_t;
+
+static struct {
+    sg_buffer vbuf;
+    sg_buffer ibuf;
+    sg_buffer inst_buf;
+    csm_t csm;
+    float time;
+    float cam_angle;
+    float light_angle;
+    bool paused;
+    bool animate_light;
+    bool use_cache;
+    bool show_cascades;
+    instance_t instances[NUM_INSTANCES];
+    float radius[NUM_BOXES];    // bounding sphere radius of each box
+    instance_t frame_instances[MAX_FRAME_INSTANCES];
+    int num_frame_instances;
+    struct {
+        sg_pipeline pip;
+        sg_pipeline copy_pip;
+        sg_sampler copy_smp;
+        // per cascade: the shadow map, and the cached static caster depth
+        sg_view live_att[CSM_MAX_CASCADES];
+        sg_view live_tex[CSM_MAX_CASCADES];
+        sg_view static_att[CSM_MAX_CASCADES];
+        sg_view static_tex[CSM_MAX_CASCADES];
+    } shadow;
+    struct {
+        sg_pass_action pass_action;
+        sg_pipeline pip;
+        sg_sampler shadow_smp;
+    } display;
+    struct {
+        int casters[CSM_MAX_CASCADES];      // boxes rendered into each cascade this frame
+        bool static_rendered[CSM_MAX_CASCADES];
+        bool copied[CSM_MAX_CASCADES];
+        int static_renders;                 // total static caster re-renders of cached cascades
+    } stats;
+} state;
+
+static uint32_t xorshift32(void) {
+    static uint32_t x = 0x12345678;
+    x ^= x<<13;
+    x ^= x>>17;
+    x ^= x<<5;
+    return x;
+}
+
+static float rnd(float min_val, float max_val) {
+    return min_val + (max_val - min_val) * ((float)(xorshift32() & 0xFFFF) / (float)0x10000);
+}
+
+// place the static boxes on a jittered grid with random heights
+static void place_static_boxes(void) {
+    const float cell = FIELD_SIZE / GRID_DIM;
+    for (int y = 0; y < GRID_DIM; y++) {
+        for (int x = 0; x < GRID_DIM; x++) {
+            const int i = y * GRID_DIM + x;
+            const float w = rnd(0.5f, 2.0f);
+            const float h = rnd(1.0f, 8.0f);
+            const float d = rnd(0.5f, 2.0f);
+            state.instances[i] = (instance_t){
+                .pos = vec4((x + 0.5f) * cell - FIELD_SIZE * 0.5f + rnd(-1.5f, 1.5f), h, (y + 0.5f) * cell - FIELD_SIZE * 0.5f + rnd(-1.5f, 1.5f), 0.0f),
+                .size = vec4(w, h, d, 0.0f),
+                .color = vec4(rnd(0.5f, 1.0f), rnd(0.5f, 1.0f), rnd(0.5f, 1.0f), 1.0f),
+            };
+            state.radius[i] = vec3_length(vec3(w, h, d));
+        }
+    }
+}
+
+// the moving boxes circle around the field at different distances
+static void update_dynamic_boxes(void) {
+    for (int i = 0; i < NUM_DYNAMIC_BOXES; i++) {
+        const int inst = NUM_STATIC_BOXES + i;
+        const float r = 10.0f + 5.0f * i;
+        const float a = state.time * (0.5f + 0.05f * i) + i;
+        state.instances[inst] = (instance_t){
+            .pos = vec4(vm_sin(a) * r, 3.0f + vm_sin(state.time + i), vm_cos(a) * r, 0.0f),
+            .size = vec4(1.0f, 1.0f, 1.0f, 0.0f),
+            .color = vec4(1.0f, 0.3f, 0.1f, 1.0f),
+        };
+        state.radius[inst] = 1.7320508f;
+    }
+}
+
+static void init(void) {
+    sg_setup(&(sg_desc){
+        .environment = sglue_environment(),
+        .logger.func = slog_func,
+    });
+    sdtx_setup(&(sdtx_desc_t){
+        .fonts[0] = sdtx_font_oric(),
+        .logger.func = slog_func,
+    });
+    __dbgui_setup(sapp_sample_count());
+    csm_init(&state.csm, &(csm_desc_t){ .resolution = SHADOW_MAP_SIZE });
+    state.use_cache = true;
+
+    // a unit box with normals, scaled by the instance size
+    const float box_vertices[] = {
+        -1.0f, -1.0f, -1.0f,    0.0f, 0.0f, -1.0f,
+         1.0f, -1.0f, -1.0f,    0.0f, 0.0f, -1.0f,
+         1.0f,  1.0f, -1.0f,    0.0f, 0.0f, -1.0f,
+        -1.0f,  1.0f, -1.0f,    0.0f, 0.0f, -1.0f,
+
+        -1.0f, -1.0f,  1.0f,    0.0f, 0.0f, 1.0f,
+         1.0f, -1.0f,  1.0f,    0.0f, 0.0f, 1.0f,
+         1.0f,  1.0f,  1.0f,    0.0f, 0.0f, 1.0f,
+        -1.0f,  1.0f,  1.0f,    0.0f, 0.0f, 1.0f,
+
+        -1.0f, -1.0f, -1.0f,    -1.0f, 0.0f, 0.0f,
+        -1.0f,  1.0f, -1.0f,    -1.0f, 0.0f, 0.0f,
+        -1.0f,  1.0f,  1.0f,    -1.0f, 0.0f, 0.0f,
+        -1.0f, -1.0f,  1.0f,    -1.0f, 0.0f, 0.0f,
+
+         1.0f, -1.0f, -1.0f,    1.0f, 0.0f, 0.0f,
+         1.0f,  1.0f, -1.0f,    1.0f, 0.0f, 0.0f,
+         1.0f,  1.0f,  1.0f,    1.0f, 0.0f, 0.0f,
+         1.0f, -1.0f,  1.0f,    1.0f, 0.0f, 0.0f,
+
+        -1.0f, -1.0f, -1.0f,    0.0f, -1.0f, 0.0f,
+        -1.0f, -1.0f,  1.0f,    0.0f, -1.0f, 0.0f,
+         1.0f, -1.0f,  1.0f,    0.0f, -1.0f, 0.0f,
+         1.0f, -1.0f, -1.0f,    0.0f, -1.0f, 0.0f,
+
+        -1.0f,  1.0f, -1.0f,    0.0f, 1.0f, 0.0f,
+        -1.0f,  1.0f,  1.0f,    0.0f, 1.0f, 0.0f,
+         1.0f,  1.0f,  1.0f,    0.0f, 1.0f, 0.0f,
+         1.0f,  1.0f, -1.0f,    0.0f, 1.0f, 0.0f,
+    };
+    const uint16_t box_indices[] = {
+        0, 1, 2,  0, 2, 3,
+        6, 5, 4,  7, 6, 4,
+        8, 9, 10,  8, 10, 11,
+        14, 13, 12,  15, 14, 12,
+        16, 17, 18,  16, 18, 19,
+        22, 21, 20,  23, 22, 20,
+    };
+    state.vbuf = sg_make_buffer(&(sg_buffer_desc){
+        .data = SG_RANGE(box_vertices),
+        .label = "box-vertices",
+    });
+    state.ibuf = sg_make_buffer(&(sg_buffer_desc){
+        .usage.index_buffer = true,
+        .data = SG_RANGE(box_indices),
+        .label = "box-indices",
+    });
+    // per-instance data of all passes is appended to one stream buffer each frame
+    state.inst_buf = sg_make_buffer(&(sg_buffer_desc){
+        .usage.stream_update = true,
+        .size = sizeof(state.frame_instances),
+        .label = "instances",
+    });
+
+    // the scene: static boxes, moving boxes and the ground (which doesn't cast shadows)
+    place_static_boxes();
+    update_dynamic_boxes();
+    state.instances[GROUND_INSTANCE] = (instance_t){
+        .pos = vec4(0.0f, -0.1f, 0.0f, 0.0f),
+        .size = vec4(FIELD_SIZE * 0.6f, 0.1f, FIELD_SIZE * 0.6f, 0.0f),
+        .color = vec4(0.6f, 0.55f, 0.45f, 1.0f),
+    };
+
+    // two depth-only render targets per cascade, the shadow map, and the static caster cache
+    for (int i = 0; i < CSM_MAX_CASCADES; i++) {
+        for (int cached = 0; cached < 2; cached++) {
+            sg_image img = sg_make_image(&(sg_image_desc){
+                .usage.depth_stencil_attachment = true,
+                .width = SHADOW_MAP_SIZE,
+                .height = SHADOW_MAP_SIZE,
+                .pixel_format = SG_PIXELFORMAT_DEPTH,
+                .sample_count = 1,
+                .label = cached ? "static-shadow-map" : "shadow-map",
+            });
+            sg_view att = sg_make_view(&(sg_view_desc){ .depth_stencil_attachment = { .image = img } });
+            sg_view tex = sg_make_view(&(sg_view_desc){ .texture = { .image = img } });
+            if (cached) {
+                state.shadow.static_att[i] = att;
+                state.shadow.static_tex[i] = tex;
+            } else {
+                state.shadow.live_att[i] = att;
+                state.shadow.live_tex[i] = tex;
+            }
+        }
+    }
+
+    // a pipeline for rendering instanced boxes into a cascade
+    state.shadow.pip = sg_make_pipeline(&(sg_pipeline_desc){
+        .layout = {
+            // need to provide vertex stride, because normal component is skipped in shadow pass
+            .buffers = {
+                [0].stride = 6 * sizeof(float),
+                [1] = { .stride = sizeof(instance_t), .step_func = SG_VERTEXSTEP_PER_INSTANCE },
+            },
+            .attrs = {
+                [ATTR_shadow_pos] = { .format = SG_VERTEXFORMAT_FLOAT3, .buffer_index = 0 },
+                [ATTR_shadow_inst_pos] = { .format = SG_VERTEXFORMAT_FLOAT4, .buffer_index = 1, .offset = offsetof(instance_t, pos) },
+                [ATTR_shadow_inst_size] = { .format = SG_VERTEXFORMAT_FLOAT4, .buffer_index = 1, .offset = offsetof(instance_t, size) },
+            },
+        },
+        .shader = sg_make_shader(shadow_shader_desc(sg_query_backend())),
+        .index_type = SG_INDEXTYPE_UINT16,
+        // render back-faces in shadow pass to prevent shadow acne on front-faces
+        .cull_mode = SG_CULLMODE_FRONT,
+        .sample_count = 1,
+        .depth = {
+            .pixel_format = SG_PIXELFORMAT_DEPTH,
+            .compare = SG_COMPAREFUNC_LESS_EQUAL,
+            .write_enabled = true,
+        },
+        .colors[0].pixel_format = SG_PIXELFORMAT_NONE,
+        .label = "shadow-pipeline",
+    });
+
+    // a pipeline which copies the cached static caster depth into a shadow map
+    state.shadow.copy_pip = sg_make_pipeline(&(sg_pipeline_desc){
+        .shader = sg_make_shader(copy_shader_desc(sg_query_backend())),
+        .sample_count = 1,
+        .depth = {
+            .pixel_format = SG_PIXELFORMAT_DEPTH,
+            .compare = SG_COMPAREFUNC_ALWAYS,
+            .write_enabled = true,
+        },
+        .colors[0].pixel_format = SG_PIXELFORMAT_NONE,
+        .label = "copy-pipeline",
+    });
+    state.shadow.copy_smp = sg_make_sampler(&(sg_sampler_desc){
+        .min_filter = SG_FILTER_NEAREST,
+        .mag_filter = SG_FILTER_NEAREST,
+        .wrap_u = SG_WRAP_CLAMP_TO_EDGE,
+        .wrap_v = SG_WRAP_CLAMP_TO_EDGE,
+        .label = "copy-sampler",
+    });
+
+    state.display.pip = sg_make_pipeline(&(sg_pipeline_desc){
+        .layout = {
+            .buffers[1] = { .stride = sizeof(instance_t), .step_func = SG_VERTEXSTEP_PER_INSTANCE },
+            .attrs = {
+                [ATTR_display_pos] = { .format = SG_VERTEXFORMAT_FLOAT3, .buffer_index = 0 },
+                [ATTR_display_norm] = { .format = SG_VERTEXFORMAT_FLOAT3, .buffer_index = 0 },
+                [ATTR_display_inst_pos] = { .format = SG_VERTEXFORMAT_FLOAT4, .buffer_index = 1 },
+                [ATTR_display_inst_size] = { .format = SG_VERTEXFORMAT_FLOAT4, .buffer_index = 1 },
+                [ATTR_display_inst_color] = { .format = SG_VERTEXFORMAT_FLOAT4, .buffer_index = 1 },
+            },
+        },
+        .shader = sg_make_shader(display_shader_desc(sg_query_backend())),
+        .index_type = SG_INDEXTYPE_UINT16,
+        .cull_mode = SG_CULLMODE_BACK,
+        .depth = {
+            .compare = SG_COMPAREFUNC_LESS_EQUAL,
+            .write_enabled = true,
+        },
+        .label = "display-pipeline",
+    });
+    state.display.shadow_smp = sg_make_sampler(&(sg_sampler_desc){
+        .min_filter = SG_FILTER_LINEAR,
+        .mag_filter = SG_FILTER_LINEAR,
+        .wrap_u = SG_WRAP_CLAMP_TO_EDGE,
+        .wrap_v = SG_WRAP_CLAMP_TO_EDGE,
+        .compare = SG_COMPAREFUNC_LESS,
+        .label = "shadow-sampler",
+    });
+    state.display.pass_action = (sg_pass_action){
+        .colors[0] = { .load_action = SG_LOADACTION_CLEAR, .clear_value = { 0.5f, 0.7f, 0.9f, 1.0f } },
+    };
+}
+
+// copy instances into the per-frame instance array, returns the range in the stream buffer
+static instance_range_t begin_instances(void) {
+    return (instance_range_t){ .base = state.num_frame_instances };
+}
+
+static void add_instance(instance_range_t* range, int inst) {
+    assert(state.num_frame_instances < MAX_FRAME_INSTANCES);
+    state.frame_instances[state.num_frame_instances++] = state.instances[inst];
+    range->count++;
+}
+
+// collect the boxes in the range [first, first+num) which are inside a cascade
+static void cull_casters(instance_range_t* range, const csm_cascade_t* cascade, int first, int num) {
+    for (int i = first; i < (first + num); i++) {
+        const vec4_t p = state.instances[i].pos;
+        if (csm_sphere_visible(cascade, vec3(p.x, p.y, p.z), state.radius[i])) {
+            add_instance(range, i);
+        }
+    }
+}
+
+static void draw_casters(const csm_cascade_t* cascade, instance_range_t range) {
+    sg_apply_pipeline(state.shadow.pip);
+    sg_apply_bindings(&(sg_bindings){
+        .vertex_buffers = { [0] = state.vbuf, [1] = state.inst_buf },
+        .vertex_buffer_offsets[1] = range.base * (int)sizeof(instance_t),
+        .index_buffer = state.ibuf,
+    });
+    const vs_shadow_params_t params = { .light_view_proj = cascade->view_proj };
+    sg_apply_uniforms(UB_vs_shadow_params, &SG_RANGE(params));
+    sg_draw(0, 36, range.count);
+}
+
+// render the shadow maps of all cascades, returns the texture view to sample for each cascade
+static void render_shadows(sg_view* out_tex_views) {
+    const sg_pass_action depth_clear = {
+        .depth = { .load_action = SG_LOADACTION_CLEAR, .store_action = SG_STOREACTION_STORE, .clear_value = 1.0f },
+    };
+    const sg_pass_action depth_dontcare = {
+        .depth = { .load_action = SG_LOADACTION_DONTCARE, .store_action = SG_STOREACTION_STORE },
+    };
+
+    // gather all instance lists first, so that the stream buffer is only updated once
+    instance_range_t static_ranges[CSM_MAX_CASCADES] = {0};
+    instance_range_t live_ranges[CSM_MAX_CASCADES] = {0};
+    for (int i = 0; i < state.csm.num_cascades; i++) {
+        const csm_cascade_t* cascade = &state.csm.cascades[i];
+        if (cascade->cached) {
+            if (cascade->dirty) {
+                static_ranges[i] = begin_instances();
+                cull_casters(&static_ranges[i], cascade, 0, NUM_STATIC_BOXES);
+            }
+            live_ranges[i] = begin_instances();
+            cull_casters(&live_ranges[i], cascade, NUM_STATIC_BOXES, NUM_DYNAMIC_BOXES);
+        } else {
+            live_ranges[i] = begin_instances();
+            cull_casters(&live_ranges[i], cascade, 0, NUM_BOXES);
+        }
+    }
+
+    // the display pass instances go last
+    instance_range_t display_range = begin_instances();
+    for (int i = 0; i < NUM_INSTANCES; i++) {
+        add_instance(&display_range, i);
+    }
+    sg_update_buffer(state.inst_buf, &(sg_range){
+        .ptr = state.frame_instances,
+        .size = (size_t)state.num_frame_instances * sizeof(instance_t),
+    });
+
+    for (int i = 0; i < state.csm.num_cascades; i++) {
+        const csm_cascade_t* cascade = &state.csm.cascades[i];
+        state.stats.static_rendered[i] = false;
+        state.stats.copied[i] = false;
+        state.stats.casters[i] = 0;
+        if (cascade->cached) {
+            if (cascade->dirty) {
+                sg_begin_pass(&(sg_pass){ .action = depth_clear, .attachments.depth_stencil = state.shadow.static_att[i], .label = "static-shadow-pass" });
+                draw_casters(cascade, static_ranges[i]);
+                sg_end_pass();
+                state.stats.static_rendered[i] = true;
+                state.stats.static_renders++;
+                state.stats.casters[i] += static_ranges[i].count;
+            }
+            if (live_ranges[i].count == 0) {
+                // no moving boxes in the cascade, directly sample the cached depth
+                out_tex_views[i] = state.shadow.static_tex[i];
+                continue;
+            }
+            sg_begin_pass(&(sg_pass){ .action = depth_dontcare, .attachments.depth_stencil = state.shadow.live_att[i], .label = "shadow-pass" });
+            sg_apply_pipeline(state.shadow.copy_pip);
+            sg_apply_bindings(&(sg_bindings){
+                .views[VIEW_static_map] = state.shadow.static_tex[i],
+                .samplers[SMP_copy_smp] = state.shadow.copy_smp,
+            });
+            sg_draw(0, 3, 1);
+            state.stats.copied[i] = true;
+        } else {
+            sg_begin_pass(&(sg_pass){ .action = depth_clear, .attachments.depth_stencil = state.shadow.live_att[i], .label = "shadow-pass" });
+        }
+        draw_casters(cascade, live_ranges[i]);
+        sg_end_pass();
+        state.stats.casters[i] += live_ranges[i].count;
+        out_tex_views[i] = state.shadow.live_tex[i];
+    }
+    // unused cascades are bound to a valid texture
+    for (int i = state.csm.num_cascades; i < CSM_MAX_CASCADES; i++) {
+        out_tex_views[i] = out_tex_views[0];
+    }
+}
+
+static void frame(void) {
+    const float dt = (float)sapp_frame_duration();
+    state.time += dt;
+    if (!state.paused) {
+        state.cam_angle += dt * 0.05f;
+    }
+    if (state.animate_light) {
+        state.light_angle += dt * 0.1f;
+    }
+    update_dynamic_boxes();
+    state.num_frame_instances = 0;
+
+    // the camera flies along a circle over the field
+    const vec3_t eye_pos = vec3(vm_sin(state.cam_angle) * CAMERA_PATH_RADIUS, CAMERA_HEIGHT, vm_cos(state.cam_angle) * CAMERA_PATH_RADIUS);
+    const vec3_t forward = vm_normalize(vec3(vm_cos(state.cam_angle), -0.15f, -vm_sin(state.cam_angle)));
+    const float aspect = sapp_widthf() / sapp_heightf();
+    const mat44_t view = mat44_look_at_rh(eye_pos, vec3_add(eye_pos, forward), vec3(0.0f, 1.0f, 0.0f));
+    const mat44_t proj = mat44_perspective_fov_rh(vm_radians(CAMERA_FOV), aspect, CAMERA_NEARZ, CAMERA_FARZ);
+    const vec3_t light_dir = vm_normalize(vec3(vm_sin(state.light_angle), 1.5f, vm_cos(state.light_angle)));
+
+    csm_update(&state.csm, &(csm_view_t){
+        .eye_pos = eye_pos,
+        .forward = forward,
+        .fov = CAMERA_FOV,
+        .aspect = aspect,
+        .nearz = CAMERA_NEARZ,
+        .farz = CAMERA_FARZ,
+    }, light_dir);
+
+    sg_view shadow_tex_views[CSM_MAX_CASCADES];
+    render_shadows(shadow_tex_views);
+
+    vs_display_params_t vs_params = { .view_proj = vm_mul(view, proj) };
+    fs_display_params_t fs_params = {
+        .light_dir = vec4(light_dir.x, light_dir.y, light_dir.z, 0.0f),
+        .eye_pos = vec4(eye_pos.x, eye_pos.y, eye_pos.z, 1.0f),
+        .eye_forward = vec4(forward.x, forward.y, forward.z, 0.0f),
+        .num_cascades = state.csm.num_cascades,
+        .show_cascades = state.show_cascades ? 1 : 0,
+    };
+    float* cascade_far = &fs_params.cascade_far.x;
+    float* cascade_texel = &fs_params.cascade_texel.x;
+    for (int i = 0; i < state.csm.num_cascades; i++) {
+        const csm_cascade_t* cascade = &state.csm.cascades[i];
+        fs_params.light_view_proj[i] = cascade->view_proj;
+        cascade_far[i] = cascade->far_dist;
+        cascade_texel[i] = (2.0f * cascade->radius) / SHADOW_MAP_SIZE;
+    }
+
+    sdtx_canvas(sapp_widthf() * 0.5f, sapp_heightf() * 0.5f);
+    sdtx_origin(1.0f, 1.0f);
+    sdtx_printf("caching (C): %s\n", state.use_cache ? "on" : "off");
+    sdtx_printf("light (L):   %s\n", state.animate_light ? "animated" : "fixed");
+    sdtx_printf("move static boxes (S), show cascades (D), pause (P)\n\n");
+    for (int i = 0; i < state.csm.num_cascades; i++) {
+        const csm_cascade_t* cascade = &state.csm.cascades[i];
+        sdtx_printf("cascade %d: %6.1fm %s %4d casters%s\n",
+            i, cascade->far_dist,
+            cascade->cached ? "cached" : "      ",
+            state.stats.casters[i],
+            state.stats.static_rendered[i] ? " (static re-render)" : (state.stats.copied[i] ? " (copy)" : ""));
+    }
+    sdtx_printf("\nstatic re-renders: %d\n", state.stats.static_renders);
+
+    sg_begin_pass(&(sg_pass){ .action = state.display.pass_action, .swapchain = sglue_swapchain() });
+    sg_apply_pipeline(state.display.pip);
+    sg_apply_bindings(&(sg_bindings){
+        .vertex_buffers = { [0] = state.vbuf, [1] = state.inst_buf },
+        .vertex_buffer_offsets[1] = (state.num_frame_instances - NUM_INSTANCES) * (int)sizeof(instance_t),
+        .index_buffer = state.ibuf,
+        .views = {
+            [VIEW_shadow_map0] = shadow_tex_views[0],
+            [VIEW_shadow_map1] = shadow_tex_views[1],
+            [VIEW_shadow_map2] = shadow_tex_views[2],
+            [VIEW_shadow_map3] = shadow_tex_views[3],
+        },
+        .samplers[SMP_shadow_smp] = state.display.shadow_smp,
+    });
+    sg_apply_uniforms(UB_vs_display_params, &SG_RANGE(vs_params));
+    sg_apply_uniforms(UB_fs_display_params, &SG_RANGE(fs_params));
+    sg_draw(0, 36, NUM_INSTANCES);
+    sdtx_draw();
+    __dbgui_draw();
+    sg_end_pass();
+    sg_commit();
+}
+
+static void input(const sapp_event* ev) {
+    if (ev->type == SAPP_EVENTTYPE_KEY_DOWN) {
+        switch (ev->key_code) {
+            case SAPP_KEYCODE_C:
+                state.use_cache = !state.use_cache;
+                csm_set_cache(&state.csm, state.use_cache, state.csm.num_cascades / 2);
+                break;
+            case SAPP_KEYCODE_L:
+                state.animate_light = !state.animate_light;
+                break;
+            case SAPP_KEYCODE_S:
+                place_static_boxes();
+                csm_invalidate_static(&state.csm);
+                break;
+            case SAPP_KEYCODE_D:
+                state.show_cascades = !state.show_cascades;
+                break;
+            case SAPP_KEYCODE_P:
+                state.paused = !state.paused;
+                break;
+            default:
+                break;
+        }
+    }
+    __dbgui_event(ev);
+}
+
+static void cleanup(void) {
+    __dbgui_shutdown();
+    sdtx_shutdown();
+    sg_shutdown();
+}
+
+sapp_desc sokol_main(int argc, char* argv[]) {
+    (void)argc; (void)argv;
+    return (sapp_desc){
+        .init_cb = init,
+        .frame_cb = frame,
+        .cleanup_cb = cleanup,
+        .event_cb = input,
+        .width = 1024,
+        .height = 768,
+        .sample_count = 4,
+        .window_title = "shadows-csm-sapp",
+        .icon.sokol_default = true,
+        .logger.func = slog_func,
+    };
+}
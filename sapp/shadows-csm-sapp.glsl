@@ -0,0 +1,148 @@
+@ctype mat4 mat44_t
+@ctype vec4 vec4_t
+
+//=== shadow pass, renders instanced boxes into one cascade
+@vs vs_shadow
+@glsl_options fixup_clipspace // important: map clipspace z from -1..+1 to 0..+1 on GL
+
+layout(binding=0) uniform vs_shadow_params {
+    mat4 light_view_proj;
+};
+
+in vec3 pos;
+in vec4 inst_pos;
+in vec4 inst_size;
+
+void main() {
+    gl_Position = light_view_proj * vec4(inst_pos.xyz + pos * inst_size.xyz, 1.0);
+}
+@end
+
+@fs fs_shadow
+void main() { }
+@end
+
+@program shadow vs_shadow fs_shadow
+
+//=== copies the static caster depth of a cached cascade into the cascade's shadow map
+@vs vs_copy
+const vec2 positions[3] = { vec2(-1, -1), vec2(3, -1), vec2(-1, 3), };
+
+void main() {
+    gl_Position = vec4(positions[gl_VertexIndex], 0, 1);
+}
+@end
+
+@fs fs_copy
+@image_sample_type static_map unfilterable_float
+layout(binding=0) uniform texture2D static_map;
+@sampler_type copy_smp nonfiltering
+layout(binding=0) uniform sampler copy_smp;
+
+void main() {
+    gl_FragDepth = texelFetch(sampler2D(static_map, copy_smp), ivec2(gl_FragCoord.xy), 0).x;
+}
+@end
+
+@program copy vs_copy fs_copy
+
+//=== display pass
+@vs vs_display
+layout(binding=0) uniform vs_display_params {
+    mat4 view_proj;
+};
+
+in vec3 pos;
+in vec3 norm;
+in vec4 inst_pos;
+in vec4 inst_size;
+in vec4 inst_color;
+out vec3 world_pos;
+out vec3 world_norm;
+out vec3 color;
+
+void main() {
+    world_pos = inst_pos.xyz + pos * inst_size.xyz;
+    world_norm = norm;
+    color = inst_color.xyz;
+    gl_Position = view_proj * vec4(world_pos, 1.0);
+}
+@end
+
+@fs fs_display
+layout(binding=1) uniform fs_display_params {
+    mat4 light_view_proj[4];
+    vec4 cascade_far;       // far view distance of each cascade
+    vec4 cascade_texel;     // world space texel size of each cascade
+    vec4 light_dir;
+    vec4 eye_pos;
+    vec4 eye_forward;
+    int num_cascades;
+    int show_cascades;
+};
+
+layout(binding=0) uniform texture2D shadow_map0;
+layout(binding=1) uniform texture2D shadow_map1;
+layout(binding=2) uniform texture2D shadow_map2;
+layout(binding=3) uniform texture2D shadow_map3;
+layout(binding=0) uniform sampler shadow_smp;
+
+in vec3 world_pos;
+in vec3 world_norm;
+in vec3 color;
+out vec4 frag_color;
+
+vec4 gamma(vec4 c) {
+    float p = 1.0 / 2.2;
+    return vec4(pow(c.xyz, vec3(p)), c.w);
+}
+
+float sample_shadow(int cascade, vec3 pos) {
+    vec4 light_pos = light_view_proj[cascade] * vec4(pos, 1.0);
+    #if !SOKOL_GLSL
+        light_pos.y = -light_pos.y;
+    #endif
+    const vec3 sm_pos = vec3((light_pos.xy + 1.0) * 0.5, light_pos.z);
+    if (cascade == 0) {
+        return texture(sampler2DShadow(shadow_map0, shadow_smp), sm_pos);
+    } else if (cascade == 1) {
+        return texture(sampler2DShadow(shadow_map1, shadow_smp), sm_pos);
+    } else if (cascade == 2) {
+        return texture(sampler2DShadow(shadow_map2, shadow_smp), sm_pos);
+    } else {
+        return texture(sampler2DShadow(shadow_map3, shadow_smp), sm_pos);
+    }
+}
+
+void main() {
+    const vec3 cascade_colors[4] = {
+        vec3(1.0, 0.6, 0.6), vec3(0.6, 1.0, 0.6), vec3(0.6, 0.6, 1.0), vec3(1.0, 1.0, 0.6),
+    };
+    const float ambient_intensity = 0.25;
+    const vec3 l = normalize(light_dir.xyz);
+    const vec3 n = normalize(world_norm);
+    const float n_dot_l = dot(n, l);
+    const float view_dist = dot(world_pos - eye_pos.xyz, eye_forward.xyz);
+    int cascade = num_cascades;
+    for (int i = num_cascades - 1; i >= 0; i--) {
+        if (view_dist <= cascade_far[i]) {
+            cascade = i;
+        }
+    }
+    vec3 c = color;
+    float s = 1.0;
+    if (cascade < num_cascades) {
+        if (n_dot_l > 0.0) {
+            // offset along the normal by the cascade's texel size against shadow acne
+            s = sample_shadow(cascade, world_pos + n * (cascade_texel[cascade] * 1.5));
+        }
+        if (show_cascades != 0) {
+            c *= cascade_colors[cascade];
+        }
+    }
+    const float diff_intensity = max(n_dot_l * s, 0.0);
+    frag_color = gamma(vec4((diff_intensity + ambient_intensity) * c, 1.0));
+}
+@end
+
+@program display vs_display fs_display
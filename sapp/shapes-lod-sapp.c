@@ -0,0 +1,219 @@
+//------------------------------------------------------------------------------
+//  shapes-lod-sapp.c
+//
+//  Many highly tessellated shapes with distance-based LODs, generated
+//  in parallel with libs/util/meshgen.h into one vertex buffer with
+//  quantized vertices (half positions, octahedron-encoded normals) and
+//  one vertex-cache-optimized 32-bit index buffer.
+//------------------------------------------------------------------------------
+#include "sokol_app.h"
+#include "sokol_gfx.h"
+#include "sokol_time.h"
+#include "sokol_log.h"
+#include "sokol_glue.h"
+#define SOKOL_DEBUGTEXT_IMPL
+#include "sokol_debugtext.h"
+#define VECMATH_GENERICS
+#include "vecmath/vecmath.h"
+#include "util/meshgen.h"
+#include "dbgui/dbgui.h"
+#include "shapes-lod-sapp.glsl.h"
+#include <stdlib.h> // calloc, free
+#include <assert.h>
+#include <math.h>   // log2f, sinf
+
+#define GRID_DIM (12)
+#define NUM_SHAPES (GRID_DIM * GRID_DIM)
+#define NUM_LODS (4)
+#define SHAPE_SPACING (2.0f)
+
+static struct {
+    sg_pass_action pass_action;
+    sg_pipeline pip;
+    sg_buffer vbuf;
+    sg_buffer ibuf;
+    meshgen_shape_t shapes[NUM_SHAPES];
+    meshgen_mesh_t meshes[NUM_SHAPES];
+    meshgen_result_t result;
+    double build_time_ms;
+    vs_params_t vs_params;
+    float ry;
+    double time;
+} state;
+
+static void init(void) {
+    sg_setup(&(sg_desc){
+        .environment = sglue_environment(),
+        .logger.func = slog_func,
+    });
+    sdtx_setup(&(sdtx_desc_t) {
+        .fonts[0] = sdtx_font_oric(),
+        .logger.func = slog_func,
+    });
+    stm_setup();
+    __dbgui_setup(sapp_sample_count());
+
+    state.pass_action = (sg_pass_action) {
+        .colors[0] = { .load_action = SG_LOADACTION_CLEAR, .clear_value = { 0.0f, 0.0f, 0.0f, 1.0f } }
+    };
+    state.vs_params.draw_mode = 2.0f;
+
+    state.pip = sg_make_pipeline(&(sg_pipeline_desc){
+        .shader = sg_make_shader(shapes_lod_shader_desc(sg_query_backend())),
+        .layout = {
+            .attrs = {
+                [ATTR_shapes_lod_position].format = SG_VERTEXFORMAT_HALF4,
+                [ATTR_shapes_lod_oct_normal].format = SG_VERTEXFORMAT_SHORT2N,
+                [ATTR_shapes_lod_texcoord].format = SG_VERTEXFORMAT_USHORT2N,
+            }
+        },
+        .index_type = SG_INDEXTYPE_UINT32,
+        .cull_mode = SG_CULLMODE_BACK,
+        .face_winding = SG_FACEWINDING_CCW,
+        .depth = {
+            .compare = SG_COMPAREFUNC_LESS_EQUAL,
+            .write_enabled = true
+        },
+        .label = "shapes-lod-pipeline",
+    });
+
+    // a grid of shapes, each with 4 LODs
+    for (int i = 0; i < NUM_SHAPES; i++) {
+        meshgen_shape_t* shape = &state.shapes[i];
+        shape->type = (meshgen_shape_type_t)(i % MESHGEN_NUM_SHAPE_TYPES);
+        shape->num_lods = NUM_LODS;
+        switch (shape->type) {
+            case MESHGEN_SHAPE_BOX:         shape->tiles = 32; break;
+            case MESHGEN_SHAPE_PLANE:       shape->tiles = 64; break;
+            case MESHGEN_SHAPE_SPHERE:      shape->slices = 128; shape->stacks = 64; break;
+            case MESHGEN_SHAPE_CYLINDER:    shape->slices = 128; shape->stacks = 32; shape->radius = 0.4f; break;
+            case MESHGEN_SHAPE_TORUS:       shape->slices = 32; shape->stacks = 128; shape->radius = 0.5f; shape->ring_radius = 0.25f; break;
+            default: break;
+        }
+    }
+
+    // generate all shapes into the vertex and index arenas, and upload them
+    const meshgen_sizes_t sizes = meshgen_query_sizes(state.shapes, NUM_SHAPES);
+    meshgen_vertex_t* vertices = (meshgen_vertex_t*) calloc(sizes.num_vertices, sizeof(meshgen_vertex_t));
+    uint32_t* indices = (uint32_t*) calloc(sizes.num_indices, sizeof(uint32_t));
+    const uint64_t start_time = stm_now();
+    state.result = meshgen_build(&(meshgen_desc_t){
+        .shapes = state.shapes,
+        .num_shapes = NUM_SHAPES,
+        .meshes = state.meshes,
+        .vertices = vertices,
+        .max_vertices = sizes.num_vertices,
+        .indices = indices,
+        .max_indices = sizes.num_indices,
+    });
+    state.build_time_ms = stm_ms(stm_since(start_time));
+    assert(state.result.valid);
+    state.vbuf = sg_make_buffer(&(sg_buffer_desc){
+        .data = { .ptr = vertices, .size = sizes.num_vertices * sizeof(meshgen_vertex_t) },
+        .label = "shapes-lod-vertices",
+    });
+    state.ibuf = sg_make_buffer(&(sg_buffer_desc){
+        .usage.index_buffer = true,
+        .data = { .ptr = indices, .size = sizes.num_indices * sizeof(uint32_t) },
+        .label = "shapes-lod-indices",
+    });
+    free(indices);
+    free(vertices);
+}
+
+// each LOD halves the tessellation, so switch LODs at each doubling of the distance
+static int select_lod(const meshgen_mesh_t* mesh, float dist) {
+    const float lod = log2f(dist / (mesh->radius * 8.0f));
+    if (lod < 1.0f) {
+        return 0;
+    }
+    return ((int)lod < mesh->num_lods) ? (int)lod : (mesh->num_lods - 1);
+}
+
+static void frame(void) {
+    const float dt = (float)sapp_frame_duration();
+    state.time += dt;
+    state.ry += 10.0f * dt;
+
+    // the camera moves in and out so that the LODs change
+    const float cam_dist = 14.0f + 10.0f * sinf((float)state.time * 0.3f);
+    const vec3_t eye = vec3(0.0f, cam_dist * 0.6f, cam_dist);
+    const mat44_t proj = mat44_perspective_fov_rh(vm_radians(60.0f), sapp_widthf()/sapp_heightf(), 0.1f, 200.0f);
+    const mat44_t view = mat44_look_at_rh(eye, vec3(0.0f, 0.0f, 0.0f), vec3(0.0f, 1.0f, 0.0f));
+    const mat44_t view_proj = vm_mul(view, proj);
+    const mat44_t rm = vm_mul(mat44_rotation_y(vm_radians(state.ry)), mat44_rotation_x(vm_radians(20.0f)));
+
+    sg_begin_pass(&(sg_pass){ .action = state.pass_action, .swapchain = sglue_swapchain() });
+    sg_apply_pipeline(state.pip);
+    sg_apply_bindings(&(sg_bindings) {
+        .vertex_buffers[0] = state.vbuf,
+        .index_buffer = state.ibuf
+    });
+    int lod_counts[NUM_LODS] = { 0 };
+    uint32_t num_tris = 0;
+    for (int i = 0; i < NUM_SHAPES; i++) {
+        const vec3_t pos = vec3(
+            ((float)(i % GRID_DIM) - (GRID_DIM - 1) * 0.5f) * SHAPE_SPACING,
+            0.0f,
+            ((float)(i / GRID_DIM) - (GRID_DIM - 1) * 0.5f) * SHAPE_SPACING);
+        const meshgen_mesh_t* mesh = &state.meshes[i];
+        const int lod = select_lod(mesh, vec3_length(vec3_sub(pos, eye)));
+        lod_counts[lod]++;
+        num_tris += mesh->lods[lod].num_elements / 3;
+
+        const mat44_t model = vm_mul(rm, mat44_translation(pos.x, pos.y, pos.z));
+        state.vs_params.mvp = vm_mul(model, view_proj);
+        state.vs_params.lod = (float)lod;
+        sg_apply_uniforms(UB_vs_params, &SG_RANGE(state.vs_params));
+        sg_draw(mesh->lods[lod].base_element, mesh->lods[lod].num_elements, 1);
+    }
+
+    sdtx_canvas(sapp_widthf() * 0.5f, sapp_heightf() * 0.5f);
+    sdtx_origin(1.0f, 1.0f);
+    sdtx_printf("generated in: %.2f ms\n", state.build_time_ms);
+    sdtx_printf("vertices:     %u (%u KB)\n", state.result.num_vertices,
+        (unsigned)((state.result.num_vertices * sizeof(meshgen_vertex_t)) / 1024));
+    sdtx_printf("indices:      %u\n", state.result.num_indices);
+    sdtx_printf("ACMR:         %.3f => %.3f\n\n", state.result.acmr_before, state.result.acmr_after);
+    sdtx_printf("triangles:    %u\n", num_tris);
+    sdtx_printf("LODs:         %d %d %d %d\n\n", lod_counts[0], lod_counts[1], lod_counts[2], lod_counts[3]);
+    sdtx_puts("1: normals 2: texcoords 3: LODs");
+    sdtx_draw();
+    __dbgui_draw();
+    sg_end_pass();
+    sg_commit();
+}
+
+static void input(const sapp_event* ev) {
+    if (ev->type == SAPP_EVENTTYPE_KEY_DOWN) {
+        switch (ev->key_code) {
+            case SAPP_KEYCODE_1: state.vs_params.draw_mode = 0.0f; break;
+            case SAPP_KEYCODE_2: state.vs_params.draw_mode = 1.0f; break;
+            case SAPP_KEYCODE_3: state.vs_params.draw_mode = 2.0f; break;
+            default: break;
+        }
+    }
+    __dbgui_event(ev);
+}
+
+static void cleanup(void) {
+    __dbgui_shutdown();
+    sdtx_shutdown();
+    sg_shutdown();
+}
+
+sapp_desc sokol_main(int argc, char* argv[]) {
+    (void)argc; (void)argv;
+    return (sapp_desc) {
+        .init_cb = init,
+        .frame_cb = frame,
+        .cleanup_cb = cleanup,
+        .event_cb = input,
+        .width = 800,
+        .height = 600,
+        .sample_count = 4,
+        .window_title = "shapes-lod-sapp.c",
+        .icon.sokol_default = true,
+        .logger.func = slog_func,
+    };
+}
@@ -0,0 +1,55 @@
+@ctype mat4 mat44_t
+
+@vs vs
+layout(binding=0) uniform vs_params {
+    mat4 mvp;
+    float draw_mode;
+    float lod;
+};
+
+// see libs/util/meshgen.h for the vertex format
+layout(location=0) in vec4 position;
+layout(location=1) in vec2 oct_normal;
+layout(location=2) in vec2 texcoord;
+
+out vec4 color;
+
+vec3 oct_decode(vec2 e) {
+    vec3 n = vec3(e.xy, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.x += (n.x >= 0.0) ? -t : t;
+    n.y += (n.y >= 0.0) ? -t : t;
+    return normalize(n);
+}
+
+void main() {
+    gl_Position = mvp * position;
+    vec3 normal = oct_decode(oct_normal);
+    if (draw_mode == 0.0) {
+        color = vec4((normal + 1.0) * 0.5, 1.0);
+    }
+    else if (draw_mode == 1.0) {
+        color = vec4(texcoord, 0.0, 1.0);
+    }
+    else {
+        const vec3 lod_colors[4] = vec3[4](
+            vec3(1.0, 0.3, 0.3),
+            vec3(0.3, 1.0, 0.3),
+            vec3(0.3, 0.3, 1.0),
+            vec3(1.0, 1.0, 0.3));
+        float l = 0.5 + 0.5 * max(dot(normal, normalize(vec3(0.5, 1.0, 0.25))), 0.0);
+        color = vec4(lod_colors[int(lod) % 4] * l, 1.0);
+    }
+}
+@end
+
+@fs fs
+in vec4 color;
+out vec4 frag_color;
+
+void main() {
+    frag_color = color;
+}
+@end
+
+@program shapes_lod vs fs
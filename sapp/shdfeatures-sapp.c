@@ -27,10 +27,17 @@
 //  takes some shortcuts which make the whole system less flexible for the
 //  sake of brevity. Also the code-generated shader-reflection functions
 //  aren't necessarily set in stone, and may change in the future.
+//
+//  Shader and pipeline objects are created lazily on first use and cached
+//  by (shader features, vertex layout, render state). The pipeline
+//  combinations that were actually rendered with are written to a file on
+//  shutdown, and the next run prewarms exactly those, a few per frame.
 //------------------------------------------------------------------------------
+#define _CRT_SECURE_NO_WARNINGS (1)
 #include "sokol_gfx.h"
 #include "sokol_app.h"
 #include "sokol_fetch.h"
+#include "sokol_time.h"
 #include "sokol_log.h"
 #include "sokol_glue.h"
 #include "dbgui/dbgui.h"
@@ -47,6 +54,7 @@
 #include "vecmath/vecmath.h"
 #include "util/camera.h"
 #include "util/fileutil.h"
+#include <stdio.h>  // fopen, fscanf, fprintf
 
 // shader feature flags
 #define SHD_NONE     (0)     // no features enabled
@@ -68,6 +76,9 @@
 #define MAX_SHADER_VARIATIONS  (1<<3)       // the max number of shader variations (3 bits => 8)
 #define MAX_VERTEX_COMPONENTS (4)           // see ozz_vertex_t: position, normal, jindices, jweights
 #define MAX_UNIFORMBLOCK_SIZE (256)
+#define MAX_PIPELINES (2 * MAX_SHADER_VARIATIONS)  // shader variations * cull modes
+#define PREWARM_PIPELINES_PER_FRAME (1)     // budget for creating pipelines ahead of time
+#define PIPELINE_USAGE_PATH "shdfeatures-pipelines.txt"
 
 // generic uniform data upload buffers
 static uint8_t vs_params_buffer[MAX_UNIFORMBLOCK_SIZE];
@@ -102,7 +113,7 @@ typedef struct {
 // a struct describing a stamped out shader variation
 typedef struct {
     bool valid;
-    sg_pipeline pip;        // shader and vertex layout differs between variations
+    sg_shader shd;          // created on first use
     sg_bindings bind;       // bound images and bind slots may differ between variations
 
     // pointerized uniform block structs, filled from runtime reflection data,
@@ -123,6 +134,24 @@ typedef struct {
     sg_glsl_shader_uniform (*uniform_desc_fn)(const char* ub_name, const char* u_name);
 } shader_variation_t;
 
+// render state which isn't part of a shader variation
+typedef struct {
+    sg_cull_mode cull_mode;
+} render_state_t;
+
+// pipeline objects are cached by shader features, vertex layout and render state
+typedef struct {
+    uint8_t features;
+    uint8_t cull_mode;
+    uint32_t layout_hash;
+} pipeline_key_t;
+
+typedef struct {
+    pipeline_key_t key;
+    sg_pipeline pip;
+    bool used;          // was rendered with, not only prewarmed
+} pipeline_cache_item_t;
+
 // a helper struct to describe a dynamically looked up vertex component
 typedef struct {
     const char* name;
@@ -157,6 +186,19 @@ static struct {
         vec3_t specular;
         float spec_power;
     } material;
+    struct {
+        bool cull_backfaces;
+    } render;
+    struct {
+        pipeline_cache_item_t items[MAX_PIPELINES];
+        int num_items;
+        // pipelines to create ahead of time, loaded from the last run's usage file
+        pipeline_key_t prewarm_queue[MAX_PIPELINES];
+        int num_prewarm;
+        int num_prewarmed;
+        int num_shaders;
+        double last_create_ms;
+    } pipelines;
     shader_variation_t variations[MAX_SHADER_VARIATIONS];
     vertex_component_t vertex_components[MAX_VERTEX_COMPONENTS];
 } state = {
@@ -178,6 +220,9 @@ static struct {
         .specular = { 1.0f, 1.0f, 1.0f },
         .spec_power = 8.0f
     },
+    .render = {
+        .cull_backfaces = true,
+    },
 
     // initialize the shader variation function table the code-generated reflection-functions
     .variations = {
@@ -291,6 +336,10 @@ static void animation_data_loaded(const sfetch_response_t* response);
 static void mesh_data_loaded(const sfetch_response_t* response);
 static void draw_light_debug(void);
 static void draw_ui(void);
+static sg_pipeline get_pipeline(uint8_t features, render_state_t rs, bool use);
+static void prewarm_pipelines(void);
+static void load_pipeline_usage(void);
+static void save_pipeline_usage(void);
 static sg_vertex_layout_state vertex_layout_for_variation(const shader_variation_t* var);
 static void fill_vs_params(const shader_variation_t* var);
 static void fill_phong_params(const shader_variation_t* var);
@@ -324,6 +373,7 @@ static void init(void) {
     simgui_setup(&(simgui_desc_t){
         .logger.func = slog_func,
     });
+    stm_setup();
 
     // initialize clear color
     state.pass_action = (sg_pass_action) {
@@ -347,7 +397,8 @@ static void init(void) {
     });
     state.ozz = ozz_create_instance(0);
 
-    // initialize per-shader-variation resources
+    // initialize per-shader-variation reflection data, this doesn't create
+    // any sokol-gfx objects, shaders and pipelines are created on first use
     for (int i = 0; i < MAX_SHADER_VARIATIONS; i++) {
         shader_variation_t* var = &state.variations[i];
         if (!var->valid) {
@@ -390,22 +441,11 @@ static void init(void) {
             p->mat_specular = uniform_ptr_vec3(var, base_ptr, "phong_params", "mat_specular");
             p->mat_spec_power = uniform_ptr_float(var, base_ptr, "phong_params", "mat_spec_power");
         }
-
-        // create shader and pipeline object, note that the shader and
-        // vertex layout depend on the current shader variation
-        var->pip = sg_make_pipeline(&(sg_pipeline_desc){
-            .shader = sg_make_shader(var->shader_desc_fn(sg_query_backend())),
-            .layout = vertex_layout_for_variation(var),
-            .index_type = SG_INDEXTYPE_UINT16,
-            .face_winding = SG_FACEWINDING_CCW,
-            .cull_mode = SG_CULLMODE_BACK,
-            .depth = {
-                .write_enabled = true,
-                .compare = SG_COMPAREFUNC_LESS_EQUAL
-            }
-        });
     }
 
+    // queue the pipelines which were used in the last run for prewarming
+    load_pipeline_usage();
+
     // start loading character data
     char path_buf[512];
     sfetch_send(&(sfetch_request_t){
@@ -437,6 +477,7 @@ static void frame(void) {
     const int vp_height = (int) fb_height;
 
     state.frame_time_sec = sapp_frame_duration();
+    prewarm_pipelines();
     cam_update(&state.camera, vp_width, vp_height);
     simgui_new_frame(&(simgui_frame_desc_t){
         .width = fb_width,
@@ -482,8 +523,11 @@ static void frame(void) {
         assert(var_mask < MAX_SHADER_VARIATIONS);
         const shader_variation_t* var = &state.variations[var_mask];
         assert(var->valid);
+        const render_state_t rs = {
+            .cull_mode = state.render.cull_backfaces ? SG_CULLMODE_BACK : SG_CULLMODE_NONE,
+        };
 
-        sg_apply_pipeline(var->pip);
+        sg_apply_pipeline(get_pipeline(var_mask, rs, true));
         sg_apply_bindings(&var->bind);
 
         // update uniform data as needed by the current shader variation
@@ -505,6 +549,7 @@ static void frame(void) {
 }
 
 static void cleanup(void) {
+    save_pipeline_usage();
     ozz_destroy_instance(state.ozz);
     ozz_shutdown();
     simgui_shutdown();
@@ -566,6 +611,111 @@ static void draw_light_debug(void) {
     sgl_end();
 }
 
+// FNV-1a
+static uint32_t hash_bytes(const void* ptr, size_t size) {
+    const uint8_t* bytes = (const uint8_t*)ptr;
+    uint32_t h = 0x811C9DC5;
+    for (size_t i = 0; i < size; i++) {
+        h = (h ^ bytes[i]) * 0x01000193;
+    }
+    return h;
+}
+
+static bool pipeline_key_equal(pipeline_key_t k0, pipeline_key_t k1) {
+    return (k0.features == k1.features) && (k0.cull_mode == k1.cull_mode) && (k0.layout_hash == k1.layout_hash);
+}
+
+// lookup a cached pipeline object, or create the pipeline (and shader if needed)
+// on first use, 'use' is false when the pipeline is only prewarmed
+static sg_pipeline get_pipeline(uint8_t features, render_state_t rs, bool use) {
+    assert(features < MAX_SHADER_VARIATIONS);
+    shader_variation_t* var = &state.variations[features];
+    assert(var->valid);
+    const sg_vertex_layout_state layout = vertex_layout_for_variation(var);
+    const pipeline_key_t key = {
+        .features = features,
+        .cull_mode = (uint8_t)rs.cull_mode,
+        .layout_hash = hash_bytes(&layout, sizeof(layout)),
+    };
+    for (int i = 0; i < state.pipelines.num_items; i++) {
+        pipeline_cache_item_t* item = &state.pipelines.items[i];
+        if (pipeline_key_equal(item->key, key)) {
+            item->used |= use;
+            return item->pip;
+        }
+    }
+    assert(state.pipelines.num_items < MAX_PIPELINES);
+    const uint64_t start_time = stm_now();
+    if (var->shd.id == SG_INVALID_ID) {
+        var->shd = sg_make_shader(var->shader_desc_fn(sg_query_backend()));
+        state.pipelines.num_shaders++;
+    }
+    pipeline_cache_item_t* item = &state.pipelines.items[state.pipelines.num_items++];
+    item->key = key;
+    item->used = use;
+    item->pip = sg_make_pipeline(&(sg_pipeline_desc){
+        .shader = var->shd,
+        .layout = layout,
+        .index_type = SG_INDEXTYPE_UINT16,
+        .face_winding = SG_FACEWINDING_CCW,
+        .cull_mode = rs.cull_mode,
+        .depth = {
+            .write_enabled = true,
+            .compare = SG_COMPAREFUNC_LESS_EQUAL
+        }
+    });
+    state.pipelines.last_create_ms = stm_ms(stm_since(start_time));
+    return item->pip;
+}
+
+// create a few of the queued pipelines each frame
+static void prewarm_pipelines(void) {
+    for (int i = 0; (i < PREWARM_PIPELINES_PER_FRAME) && (state.pipelines.num_prewarmed < state.pipelines.num_prewarm); i++) {
+        const pipeline_key_t key = state.pipelines.prewarm_queue[state.pipelines.num_prewarmed++];
+        get_pipeline(key.features, (render_state_t){ .cull_mode = (sg_cull_mode)key.cull_mode }, false);
+    }
+}
+
+// the pipeline usage file has one line per used pipeline with the shader
+// feature bits, cull mode and vertex layout hash, entries with a different
+// layout hash (because the vertex layout code changed) are ignored
+static void load_pipeline_usage(void) {
+    FILE* fp = fopen(PIPELINE_USAGE_PATH, "r");
+    if (!fp) {
+        return;
+    }
+    unsigned int features, cull_mode, layout_hash;
+    while ((state.pipelines.num_prewarm < MAX_PIPELINES) && (3 == fscanf(fp, "%u %u %x", &features, &cull_mode, &layout_hash))) {
+        if ((features >= MAX_SHADER_VARIATIONS) || !state.variations[features].valid || (cull_mode >= _SG_CULLMODE_NUM)) {
+            continue;
+        }
+        const sg_vertex_layout_state layout = vertex_layout_for_variation(&state.variations[features]);
+        if (layout_hash != hash_bytes(&layout, sizeof(layout))) {
+            continue;
+        }
+        state.pipelines.prewarm_queue[state.pipelines.num_prewarm++] = (pipeline_key_t){
+            .features = (uint8_t)features,
+            .cull_mode = (uint8_t)cull_mode,
+            .layout_hash = layout_hash,
+        };
+    }
+    fclose(fp);
+}
+
+static void save_pipeline_usage(void) {
+    FILE* fp = fopen(PIPELINE_USAGE_PATH, "w");
+    if (!fp) {
+        return;
+    }
+    for (int i = 0; i < state.pipelines.num_items; i++) {
+        const pipeline_cache_item_t* item = &state.pipelines.items[i];
+        if (item->used) {
+            fprintf(fp, "%u %u %08x\n", item->key.features, item->key.cull_mode, item->key.layout_hash);
+        }
+    }
+    fclose(fp);
+}
+
 // helper functions to build a matching vertex layout for a shader variation
 static sg_vertex_layout_state vertex_layout_for_variation(const shader_variation_t* var) {
     assert(var);
@@ -712,6 +862,12 @@ static void draw_ui(void) {
                 igSliderFloatEx("Spec Pwr", &state.material.spec_power, 1.0f, 64.0f, "%.1f", ImGuiSliderFlags_None);
                 igPopID();
             }
+            igSeparator();
+            igCheckbox("Cull Backfaces", &state.render.cull_backfaces);
+            igSeparator();
+            igText("Shaders: %d/%d", state.pipelines.num_shaders, MAX_SHADER_VARIATIONS);
+            igText("Pipelines: %d (%d prewarmed)", state.pipelines.num_items, state.pipelines.num_prewarmed);
+            igText("Last created in: %.3f ms", state.pipelines.last_create_ms);
         }
     }
     igEnd();
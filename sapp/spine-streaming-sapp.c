@@ -0,0 +1,639 @@
+//------------------------------------------------------------------------------
+//  spine-streaming-sapp.c
+//
+//  Demonstrates streaming Spine atlas pages:
+//
+//  - atlas objects are created as soon as the atlas file has been loaded,
+//    without waiting for the skeleton file, and the atlas page image fetches
+//    are started right away so they overlap with skeleton loading
+//  - each atlas page is initialized with a tiny placeholder texture, which
+//    allows the skeleton instances to be rendered before the actual page
+//    images have been loaded
+//  - page images are decoded on worker threads (except on the web, where
+//    decoding happens on the main thread), and the placeholder is replaced
+//    with the decoded image via sg_uninit_image() + sg_init_image()
+//------------------------------------------------------------------------------
+#define SOKOL_SPINE_IMPL
+#define SOKOL_DEBUGTEXT_IMPL
+#include "sokol_app.h"
+#include "sokol_gfx.h"
+#include "sokol_fetch.h"
+#include "sokol_time.h"
+#include "sokol_log.h"
+#include "spine/spine.h"
+#include "sokol_spine.h"
+#include "sokol_debugtext.h"
+#include "sokol_glue.h"
+#include "stb/stb_image.h"
+#include "util/fileutil.h"
+#include "dbgui/dbgui.h"
+#include <assert.h>
+
+#if defined(__EMSCRIPTEN__)
+#define USE_DECODE_THREADS (0)
+#elif defined(_WIN32)
+#define USE_DECODE_THREADS (1)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#define USE_DECODE_THREADS (1)
+#include <pthread.h>
+#endif
+
+#define NUM_SCENES (4)
+#define MAX_PAGES (8)
+#define NUM_DECODE_THREADS (2)
+#define PLACEHOLDER_SIZE (4)
+
+typedef struct {
+    const char* atlas_file;
+    const char* skel_file_json;     // skeleton files are either json or binary
+    const char* skel_file_binary;
+    const char* anim;
+    float prescale;
+    sspine_vec2 pos;
+} scene_desc_t;
+
+static const scene_desc_t scene_descs[NUM_SCENES] = {
+    { .atlas_file = "spineboy.atlas", .skel_file_json = "spineboy-pro.json", .anim = "run", .prescale = 0.4f, .pos = { -300.0f, 280.0f } },
+    { .atlas_file = "raptor-pma.atlas", .skel_file_binary = "raptor-pro.skel", .anim = "walk", .prescale = 0.3f, .pos = { 200.0f, 280.0f } },
+    { .atlas_file = "alien-pma.atlas", .skel_file_binary = "alien-pro.skel", .anim = "run", .prescale = 0.3f, .pos = { -300.0f, -20.0f } },
+    { .atlas_file = "speedy-pma.atlas", .skel_file_binary = "speedy-ess.skel", .anim = "run", .prescale = 0.5f, .pos = { 200.0f, -20.0f } },
+};
+
+typedef struct {
+    sspine_atlas atlas;
+    sspine_skeleton skeleton;
+    sspine_instance instance;
+    sspine_range skel_data;
+    bool skel_data_is_binary;
+    bool failed;
+    int num_pages;
+    int num_pages_done;     // uploaded or failed
+} scene_t;
+
+// the lifetime of an atlas page image, pages in DECODE_PENDING, DECODING
+// and DECODED state are shared with the decode threads and must only be
+// accessed while holding the decoder lock
+typedef enum {
+    PAGE_FREE,
+    PAGE_FETCHING,
+    PAGE_DECODE_PENDING,
+    PAGE_DECODING,
+    PAGE_DECODED,
+    PAGE_FAILED,
+} page_state_t;
+
+typedef struct {
+    page_state_t state;
+    int scene_index;
+    sspine_image img;
+    const void* data;
+    size_t size;
+    stbi_uc* pixels;
+    int width;
+    int height;
+} page_t;
+
+static struct {
+    sg_pass_action pass_action;
+    scene_t scenes[NUM_SCENES];
+    page_t pages[MAX_PAGES];
+    struct {
+        uint64_t start;
+        double interactive_ms;
+        double complete_ms;
+        int num_pages_requested;
+        int num_pages_done;
+        int num_failed_scenes;
+    } timing;
+    #if USE_DECODE_THREADS
+    struct {
+        bool quit;
+        #if defined(_WIN32)
+        CRITICAL_SECTION mutex;
+        CONDITION_VARIABLE cond;
+        HANDLE threads[NUM_DECODE_THREADS];
+        #else
+        pthread_mutex_t mutex;
+        pthread_cond_t cond;
+        pthread_t threads[NUM_DECODE_THREADS];
+        #endif
+    } decoder;
+    #endif
+    struct {
+        uint8_t atlas[NUM_SCENES][16 * 1024];
+        uint8_t skeleton[NUM_SCENES][256 * 1024];
+        uint8_t page[MAX_PAGES][512 * 1024];
+    } buffers;
+} state;
+
+static void atlas_data_loaded(const sfetch_response_t* response);
+static void skeleton_data_loaded(const sfetch_response_t* response);
+static void page_data_loaded(const sfetch_response_t* response);
+static void create_skeleton(int scene_index);
+static void decoder_setup(void);
+static void decoder_shutdown(void);
+static page_t* alloc_page(sspine_image img, int scene_index);
+static void set_page_state(page_t* page, page_state_t page_state);
+static void decoder_push(page_t* page);
+static void finish_decoded_pages(void);
+static void update_timing(void);
+
+static void init(void) {
+    sg_setup(&(sg_desc){
+        .environment = sglue_environment(),
+        .logger.func = slog_func,
+    });
+    stm_setup();
+    __dbgui_setup(sapp_sample_count());
+    sdtx_setup(&(sdtx_desc_t){
+        .fonts[0] = sdtx_font_oric(),
+        .logger.func = slog_func,
+    });
+    sspine_setup(&(sspine_desc){
+        .max_vertices = 16 * 1024,
+        .max_commands = 64,
+        .atlas_pool_size = NUM_SCENES,
+        .skeleton_pool_size = NUM_SCENES,
+        .instance_pool_size = NUM_SCENES,
+        .logger.func = slog_func,
+    });
+    // atlas, skeleton and page images are loaded on separate channels,
+    // and with one lane per scene so that all scenes load in parallel
+    // (each request gets its own buffer)
+    sfetch_setup(&(sfetch_desc_t){
+        .max_requests = 2 * NUM_SCENES + MAX_PAGES,
+        .num_channels = 3,
+        .num_lanes = NUM_SCENES,
+        .logger.func = slog_func,
+    });
+    decoder_setup();
+
+    state.pass_action = (sg_pass_action){
+        .colors[0] = { .load_action = SG_LOADACTION_CLEAR, .clear_value = { 0.0f, 0.0f, 0.0f, 1.0f } }
+    };
+
+    // start loading all atlas and skeleton files at once
+    state.timing.start = stm_now();
+    char path_buf[512];
+    for (int i = 0; i < NUM_SCENES; i++) {
+        sfetch_send(&(sfetch_request_t){
+            .path = fileutil_get_path(scene_descs[i].atlas_file, path_buf, sizeof(path_buf)),
+            .channel = 0,
+            .buffer = SFETCH_RANGE(state.buffers.atlas[i]),
+            .callback = atlas_data_loaded,
+            .user_data = SFETCH_RANGE(i),
+        });
+        const char* skel_file = scene_descs[i].skel_file_json;
+        if (!skel_file) {
+            skel_file = scene_descs[i].skel_file_binary;
+            state.scenes[i].skel_data_is_binary = true;
+        }
+        sfetch_send(&(sfetch_request_t){
+            .path = fileutil_get_path(skel_file, path_buf, sizeof(path_buf)),
+            .channel = 1,
+            // in case the skeleton file is JSON text data, make sure we have room for a terminating zero
+            .buffer = { .ptr = state.buffers.skeleton[i], .size = sizeof(state.buffers.skeleton[i]) - 1 },
+            .callback = skeleton_data_loaded,
+            .user_data = SFETCH_RANGE(i),
+        });
+    }
+}
+
+// The atlas object doesn't depend on the skeleton, so it is created immediately,
+// and each page image is populated with a placeholder texture before the actual
+// page image file starts loading.
+static void atlas_data_loaded(const sfetch_response_t* response) {
+    const int scene_index = *(int*)response->user_data;
+    scene_t* scene = &state.scenes[scene_index];
+    if (response->fetched) {
+        scene->atlas = sspine_make_atlas(&(sspine_atlas_desc){
+            .data = { response->data.ptr, response->data.size },
+        });
+        assert(sspine_atlas_valid(scene->atlas));
+
+        // a tiny, half-transparent grey placeholder, with or without
+        // premultiplied alpha to match the atlas page
+        static uint32_t placeholder_pixels[PLACEHOLDER_SIZE * PLACEHOLDER_SIZE];
+        static uint32_t placeholder_pixels_pma[PLACEHOLDER_SIZE * PLACEHOLDER_SIZE];
+        for (int i = 0; i < PLACEHOLDER_SIZE * PLACEHOLDER_SIZE; i++) {
+            placeholder_pixels[i] = 0x80808080;
+            placeholder_pixels_pma[i] = 0x80404040;
+        }
+        const int num_images = sspine_num_images(scene->atlas);
+        scene->num_pages = num_images;
+        for (int img_index = 0; img_index < num_images; img_index++) {
+            const sspine_image img = sspine_image_by_index(scene->atlas, img_index);
+            const sspine_image_info img_info = sspine_get_image_info(img);
+            assert(img_info.valid);
+            sg_init_image(img_info.sgimage, &(sg_image_desc){
+                .width = PLACEHOLDER_SIZE,
+                .height = PLACEHOLDER_SIZE,
+                .pixel_format = SG_PIXELFORMAT_RGBA8,
+                .label = "placeholder",
+                .data.subimage[0][0] = img_info.premul_alpha ? SG_RANGE(placeholder_pixels_pma) : SG_RANGE(placeholder_pixels),
+            });
+            sg_init_view(img_info.sgview, &(sg_view_desc){
+                .texture = { .image = img_info.sgimage },
+            });
+            sg_init_sampler(img_info.sgsampler, &(sg_sampler_desc){
+                .min_filter = img_info.min_filter,
+                .mag_filter = img_info.mag_filter,
+                .mipmap_filter = img_info.mipmap_filter,
+                .wrap_u = img_info.wrap_u,
+                .wrap_v = img_info.wrap_v,
+                .label = img_info.filename.cstr,
+            });
+
+            // if this triggers, increase MAX_PAGES
+            page_t* page = alloc_page(img, scene_index);
+            assert(page);
+            const int page_index = (int)(page - state.pages);
+            char path_buf[512];
+            sfetch_send(&(sfetch_request_t){
+                .path = fileutil_get_path(img_info.filename.cstr, path_buf, sizeof(path_buf)),
+                .channel = 2,
+                .buffer = SFETCH_RANGE(state.buffers.page[page_index]),
+                .callback = page_data_loaded,
+                .user_data = SFETCH_RANGE(page_index),
+            });
+            state.timing.num_pages_requested++;
+        }
+        // the skeleton file might have finished loading first
+        if (scene->skel_data.ptr) {
+            create_skeleton(scene_index);
+        }
+    } else if (response->failed) {
+        scene->failed = true;
+    }
+}
+
+static void skeleton_data_loaded(const sfetch_response_t* response) {
+    const int scene_index = *(int*)response->user_data;
+    scene_t* scene = &state.scenes[scene_index];
+    if (response->fetched) {
+        // in case the loaded data file is JSON text, make sure it's zero terminated
+        assert(response->data.size < sizeof(state.buffers.skeleton[scene_index]));
+        state.buffers.skeleton[scene_index][response->data.size] = 0;
+        scene->skel_data = (sspine_range){ response->data.ptr, response->data.size };
+        if (sspine_atlas_valid(scene->atlas)) {
+            create_skeleton(scene_index);
+        }
+    } else if (response->failed) {
+        scene->failed = true;
+    }
+}
+
+static void create_skeleton(int scene_index) {
+    scene_t* scene = &state.scenes[scene_index];
+    const scene_desc_t* desc = &scene_descs[scene_index];
+    scene->skeleton = sspine_make_skeleton(&(sspine_skeleton_desc){
+        .atlas = scene->atlas,
+        .prescale = desc->prescale,
+        .anim_default_mix = 0.2f,
+        .json_data = scene->skel_data_is_binary ? 0 : (const char*)scene->skel_data.ptr,
+        .binary_data = scene->skel_data_is_binary ? scene->skel_data : (sspine_range){0},
+    });
+    assert(sspine_skeleton_valid(scene->skeleton));
+    scene->instance = sspine_make_instance(&(sspine_instance_desc){
+        .skeleton = scene->skeleton,
+    });
+    sspine_set_position(scene->instance, desc->pos);
+    sspine_set_animation(scene->instance, sspine_anim_by_name(scene->skeleton, desc->anim), 0, true);
+}
+
+static void page_data_loaded(const sfetch_response_t* response) {
+    const int page_index = *(int*)response->user_data;
+    page_t* page = &state.pages[page_index];
+    if (response->fetched) {
+        page->data = response->data.ptr;
+        page->size = response->data.size;
+        decoder_push(page);
+    } else if (response->failed) {
+        set_page_state(page, PAGE_FAILED);
+    }
+}
+
+static void frame(void) {
+    sfetch_dowork();
+    finish_decoded_pages();
+    update_timing();
+
+    const float delta_time = (float)sapp_frame_duration();
+    const float w = sapp_widthf();
+    const float h = sapp_heightf();
+    const sspine_layer_transform layer_transform = {
+        .size = { .x = w, .y = h },
+        .origin = { .x = w * 0.5f, .y = h * 0.5f }
+    };
+    for (int i = 0; i < NUM_SCENES; i++) {
+        sspine_update_instance(state.scenes[i].instance, delta_time);
+        sspine_draw_instance_in_layer(state.scenes[i].instance, 0);
+    }
+
+    sdtx_canvas(w * 0.5f, h * 0.5f);
+    sdtx_origin(1.0f, 1.0f);
+    sdtx_color3f(1.0f, 1.0f, 1.0f);
+    sdtx_printf("pages loaded: %d/%d\n\n", state.timing.num_pages_done, state.timing.num_pages_requested);
+    if (state.timing.interactive_ms > 0.0) {
+        sdtx_printf("interactive after: %.2f ms\n", state.timing.interactive_ms);
+    }
+    if (state.timing.complete_ms > 0.0) {
+        sdtx_printf("all pages after:   %.2f ms\n", state.timing.complete_ms);
+    }
+    if (state.timing.num_failed_scenes > 0) {
+        sdtx_printf("\nfailed to load:    %d scene(s)\n", state.timing.num_failed_scenes);
+    }
+    #if !USE_DECODE_THREADS
+    sdtx_puts("\n(no decode threads on this platform)");
+    #endif
+
+    sg_begin_pass(&(sg_pass){ .action = state.pass_action, .swapchain = sglue_swapchain() });
+    sspine_draw_layer(0, &layer_transform);
+    sdtx_draw();
+    __dbgui_draw();
+    sg_end_pass();
+    sg_commit();
+}
+
+static void cleanup(void) {
+    decoder_shutdown();
+    sfetch_shutdown();
+    sspine_shutdown();
+    sdtx_shutdown();
+    __dbgui_shutdown();
+    sg_shutdown();
+}
+
+sapp_desc sokol_main(int argc, char* argv[]) {
+    (void)argc; (void)argv;
+    return (sapp_desc){
+        .init_cb = init,
+        .frame_cb = frame,
+        .cleanup_cb = cleanup,
+        .event_cb = __dbgui_event,
+        .width = 1024,
+        .height = 768,
+        .window_title = "spine-streaming-sapp.c",
+        .icon.sokol_default = true,
+        .logger.func = slog_func,
+    };
+}
+
+//== PAGE DECODING =============================================================
+static void decode_page(page_t* page) {
+    const int desired_channels = 4;
+    int num_channels;
+    page->pixels = stbi_load_from_memory(page->data, (int)page->size, &page->width, &page->height, &num_channels, desired_channels);
+}
+
+// replace the placeholder texture with the decoded page image, the sokol-gfx
+// image and view handles must remain the same because sokol-spine holds on to them
+static void upload_page(page_t* page) {
+    const sspine_image_info img_info = sspine_get_image_info(page->img);
+    if (img_info.valid) {
+        sg_uninit_view(img_info.sgview);
+        sg_uninit_image(img_info.sgimage);
+        sg_init_image(img_info.sgimage, &(sg_image_desc){
+            .width = page->width,
+            .height = page->height,
+            .pixel_format = SG_PIXELFORMAT_RGBA8,
+            .label = img_info.filename.cstr,
+            .data.subimage[0][0] = {
+                .ptr = page->pixels,
+                .size = (size_t)(page->width * page->height * 4),
+            },
+        });
+        sg_init_view(img_info.sgview, &(sg_view_desc){
+            .texture = { .image = img_info.sgimage },
+        });
+    }
+    stbi_image_free(page->pixels);
+    page->pixels = 0;
+}
+
+#if USE_DECODE_THREADS
+static void decoder_lock(void) {
+    #if defined(_WIN32)
+    EnterCriticalSection(&state.decoder.mutex);
+    #else
+    pthread_mutex_lock(&state.decoder.mutex);
+    #endif
+}
+
+static void decoder_unlock(void) {
+    #if defined(_WIN32)
+    LeaveCriticalSection(&state.decoder.mutex);
+    #else
+    pthread_mutex_unlock(&state.decoder.mutex);
+    #endif
+}
+
+static void decoder_wait(void) {
+    #if defined(_WIN32)
+    SleepConditionVariableCS(&state.decoder.cond, &state.decoder.mutex, INFINITE);
+    #else
+    pthread_cond_wait(&state.decoder.cond, &state.decoder.mutex);
+    #endif
+}
+
+static void decoder_wakeup(void) {
+    #if defined(_WIN32)
+    WakeAllConditionVariable(&state.decoder.cond);
+    #else
+    pthread_cond_broadcast(&state.decoder.cond);
+    #endif
+}
+
+static void decoder_thread_loop(void) {
+    decoder_lock();
+    while (!state.decoder.quit) {
+        page_t* page = 0;
+        for (int i = 0; i < MAX_PAGES; i++) {
+            if (state.pages[i].state == PAGE_DECODE_PENDING) {
+                page = &state.pages[i];
+                break;
+            }
+        }
+        if (!page) {
+            decoder_wait();
+            continue;
+        }
+        page->state = PAGE_DECODING;
+        decoder_unlock();
+        decode_page(page);
+        decoder_lock();
+        page->state = page->pixels ? PAGE_DECODED : PAGE_FAILED;
+    }
+    decoder_unlock();
+}
+
+#if defined(_WIN32)
+static DWORD WINAPI decoder_thread_func(LPVOID arg) {
+    (void)arg;
+    decoder_thread_loop();
+    return 0;
+}
+#else
+static void* decoder_thread_func(void* arg) {
+    (void)arg;
+    decoder_thread_loop();
+    return 0;
+}
+#endif
+
+static void decoder_setup(void) {
+    #if defined(_WIN32)
+    InitializeCriticalSection(&state.decoder.mutex);
+    InitializeConditionVariable(&state.decoder.cond);
+    for (int i = 0; i < NUM_DECODE_THREADS; i++) {
+        state.decoder.threads[i] = CreateThread(NULL, 0, decoder_thread_func, NULL, 0, NULL);
+    }
+    #else
+    pthread_mutex_init(&state.decoder.mutex, 0);
+    pthread_cond_init(&state.decoder.cond, 0);
+    for (int i = 0; i < NUM_DECODE_THREADS; i++) {
+        pthread_create(&state.decoder.threads[i], 0, decoder_thread_func, 0);
+    }
+    #endif
+}
+
+static void decoder_shutdown(void) {
+    decoder_lock();
+    state.decoder.quit = true;
+    decoder_wakeup();
+    decoder_unlock();
+    #if defined(_WIN32)
+    WaitForMultipleObjects(NUM_DECODE_THREADS, state.decoder.threads, TRUE, INFINITE);
+    for (int i = 0; i < NUM_DECODE_THREADS; i++) {
+        CloseHandle(state.decoder.threads[i]);
+    }
+    DeleteCriticalSection(&state.decoder.mutex);
+    #else
+    for (int i = 0; i < NUM_DECODE_THREADS; i++) {
+        pthread_join(state.decoder.threads[i], 0);
+    }
+    pthread_cond_destroy(&state.decoder.cond);
+    pthread_mutex_destroy(&state.decoder.mutex);
+    #endif
+    for (int i = 0; i < MAX_PAGES; i++) {
+        if (state.pages[i].pixels) {
+            stbi_image_free(state.pages[i].pixels);
+            state.pages[i].pixels = 0;
+        }
+    }
+}
+
+static void decoder_push(page_t* page) {
+    decoder_lock();
+    page->state = PAGE_DECODE_PENDING;
+    decoder_wakeup();
+    decoder_unlock();
+}
+
+static page_state_t get_page_state(page_t* page) {
+    decoder_lock();
+    page_state_t res = page->state;
+    decoder_unlock();
+    return res;
+}
+
+static void set_page_state(page_t* page, page_state_t page_state) {
+    decoder_lock();
+    page->state = page_state;
+    decoder_unlock();
+}
+
+static page_t* alloc_page(sspine_image img, int scene_index) {
+    page_t* res = 0;
+    decoder_lock();
+    for (int i = 0; i < MAX_PAGES; i++) {
+        if (state.pages[i].state == PAGE_FREE) {
+            res = &state.pages[i];
+            *res = (page_t){ .state = PAGE_FETCHING, .scene_index = scene_index, .img = img };
+            break;
+        }
+    }
+    decoder_unlock();
+    return res;
+}
+#else
+// no threads on the web, decode directly in the fetch callback
+static void decoder_setup(void) { }
+static void decoder_shutdown(void) { }
+
+static void decoder_push(page_t* page) {
+    decode_page(page);
+    page->state = page->pixels ? PAGE_DECODED : PAGE_FAILED;
+}
+
+static page_state_t get_page_state(page_t* page) {
+    return page->state;
+}
+
+static void set_page_state(page_t* page, page_state_t page_state) {
+    page->state = page_state;
+}
+
+static page_t* alloc_page(sspine_image img, int scene_index) {
+    for (int i = 0; i < MAX_PAGES; i++) {
+        if (state.pages[i].state == PAGE_FREE) {
+            state.pages[i] = (page_t){ .state = PAGE_FETCHING, .scene_index = scene_index, .img = img };
+            return &state.pages[i];
+        }
+    }
+    return 0;
+}
+#endif
+
+// called once per frame on the main thread, uploads decoded page images
+// and releases their page slots
+static void finish_decoded_pages(void) {
+    for (int i = 0; i < MAX_PAGES; i++) {
+        page_t* page = &state.pages[i];
+        const page_state_t page_st = get_page_state(page);
+        if ((page_st != PAGE_DECODED) && (page_st != PAGE_FAILED)) {
+            continue;
+        }
+        // if loading or decoding has failed, just keep the placeholder texture
+        if (page_st == PAGE_DECODED) {
+            upload_page(page);
+        }
+        state.scenes[page->scene_index].num_pages_done++;
+        state.timing.num_pages_done++;
+        set_page_state(page, PAGE_FREE);
+    }
+}
+
+// Called once per frame after finish_decoded_pages(). A scene is 'interactive'
+// once its instance exists (no matter if the page images are loaded), and
+// 'complete' once all of its page images have been uploaded (or have failed).
+// A scene which has failed to load counts as both, so that the timings are
+// still shown.
+static void update_timing(void) {
+    bool interactive = true;
+    bool complete = true;
+    int num_failed_scenes = 0;
+    for (int i = 0; i < NUM_SCENES; i++) {
+        const scene_t* scene = &state.scenes[i];
+        if (scene->failed) {
+            num_failed_scenes++;
+        } else {
+            interactive &= sspine_instance_valid(scene->instance);
+            complete &= sspine_atlas_valid(scene->atlas) && (scene->num_pages_done == scene->num_pages);
+        }
+    }
+    state.timing.num_failed_scenes = num_failed_scenes;
+    if (interactive && (state.timing.interactive_ms == 0.0)) {
+        state.timing.interactive_ms = stm_ms(stm_since(state.timing.start));
+    }
+    if (interactive && complete && (state.timing.complete_ms == 0.0)) {
+        state.timing.complete_ms = stm_ms(stm_since(state.timing.start));
+    }
+}
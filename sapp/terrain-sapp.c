@@ -0,0 +1,446 @@
+//------------------------------------------------------------------------------
+//  terrain-sapp.c
+//
+//  Quadtree terrain with continuous distance-dependent level of detail
+//  (CDLOD, libs/util/cdlod.h), building on the idea of vertextexture-sapp:
+//
+//  - all selected quadtree nodes are rendered as instances of a single
+//    32x32 grid patch in one draw call, the vertices are synthesized
+//    from the vertex index and displaced with heights fetched from a
+//    texture in the vertex shader
+//  - vertices morph into the grid of the next coarser level with
+//    distance, so there are no popping LOD transitions and no cracks
+//    between levels
+//  - the LOD ranges are derived from a target triangle size in pixels,
+//    so the cost scales with the screen resolution
+//  - the heights are streamed in as one tile per node into a tile atlas
+//    with LRU eviction, a limited number of tiles per frame and coarse
+//    levels first, the tiles are generated on the GPU from a procedural
+//    height function which stands in for loading them from disk
+//
+//  Keys:
+//  - P: pause camera
+//  - F: freeze the LOD selection and culling
+//  - T: tint the LOD levels
+//  - UP/DOWN: camera altitude
+//  - LEFT/RIGHT: target triangle size
+//------------------------------------------------------------------------------
+#include <stdlib.h>
+#include <stddef.h>
+#include "sokol_app.h"
+#include "sokol_gfx.h"
+#include "sokol_log.h"
+#include "sokol_glue.h"
+#define SOKOL_DEBUGTEXT_IMPL
+#include "sokol_debugtext.h"
+#include "dbgui/dbgui.h"
+#define VECMATH_GENERICS
+#include "vecmath/vecmath.h"
+#include "util/cdlod.h"
+#include "util/frustum.h"
+#include "terrain-sapp.glsl.h"
+
+#define TERRAIN_SIZE (16384.0f)
+#define TERRAIN_LEVELS (10)                 // leaf nodes are 32 units wide
+#define HEIGHT_SCALE (1500.0f)
+// the height function, must match terrain-sapp.glsl
+#define FEATURE_SIZE (4096.0f)
+#define NUM_OCTAVES (12)
+// grid quads along the patch edge (don't change this since the value is hardcoded in shader)
+#define PATCH_SIZE (32)
+#define PATCH_VERTICES ((PATCH_SIZE + 1) * (PATCH_SIZE + 1))
+#define PATCH_INDICES (PATCH_SIZE * PATCH_SIZE * 6)
+// one border texel on each side for the normals, plus the patch's last vertex
+#define TILE_TEXELS (PATCH_SIZE + 3)
+#define ATLAS_SLOTS_PER_ROW (32)
+#define ATLAS_SIZE (ATLAS_SLOTS_PER_ROW * TILE_TEXELS)
+#define TILES_PER_FRAME (16)                // the streaming budget
+#define CAMERA_PATH_RADIUS (5000.0f)
+#define CAMERA_FOV (60.0f)
+#define CAMERA_NEARZ (1.0f)
+#define CAMERA_FARZ (20000.0f)
+
+typedef struct {
+    vec4_t node;    // xy: min corner xz, z: size, w: tile slot
+    vec4_t morph;   // x: morph start, y: morph end, z: level
+} instance_t;
+
+static struct {
+    cdlod_t terrain;
+    cdlod_view_t cull_view;
+    float time;
+    float cam_angle;
+    float altitude;
+    float pixel_size;
+    bool paused;
+    bool frozen;
+    bool show_lods;
+    bool origin_top_left;
+    instance_t instances[CDLOD_MAX_SELECTED];
+    struct {
+        sg_pipeline pip;
+        sg_view att_view;
+    } tiles;
+    struct {
+        sg_pass_action pass_action;
+        sg_pipeline pip;
+        sg_bindings bind;
+    } display;
+    struct {
+        int streamed;                       // tiles streamed this frame
+        int total_streamed;
+        int per_level[CDLOD_MAX_LEVELS];
+    } stats;
+} state;
+
+//== the height function ======================================================
+static float lattice(int x, int z, int octave) {
+    uint32_t h = (uint32_t)x * 0x8da6b343 ^ (uint32_t)z * 0xd8163841 ^ (uint32_t)octave * 0xcb1ab31f;
+    h ^= h >> 16;
+    h *= 0x7feb352d;
+    h ^= h >> 15;
+    h *= 0x846ca68b;
+    h ^= h >> 16;
+    return (float)(h & 0xFFFFFF) / 16777215.0f;
+}
+
+static float value_noise(float x, float z, int octave) {
+    const float ix = floorf(x);
+    const float iz = floorf(z);
+    const float fx = x - ix;
+    const float fz = z - iz;
+    const float ux = fx * fx * (3.0f - 2.0f * fx);
+    const float uz = fz * fz * (3.0f - 2.0f * fz);
+    const int cx = (int)ix;
+    const int cz = (int)iz;
+    const float a = lattice(cx, cz, octave);
+    const float b = lattice(cx + 1, cz, octave);
+    const float d = lattice(cx, cz + 1, octave);
+    const float e = lattice(cx + 1, cz + 1, octave);
+    const float ab = a + (b - a) * ux;
+    const float de = d + (e - d) * ux;
+    return ab + (de - ab) * uz;
+}
+
+// normalized height 0..1 at a world space xz position
+static float terrain_height(float x, float z) {
+    x /= FEATURE_SIZE;
+    z /= FEATURE_SIZE;
+    float sum = 0.0f;
+    float amp = 0.5f;
+    for (int i = 0; i < NUM_OCTAVES; i++) {
+        sum += value_noise(x, z, i) * amp;
+        x *= 2.0f;
+        z *= 2.0f;
+        amp *= 0.5f;
+    }
+    // flat valleys and steep peaks
+    const float h = fminf(fmaxf((sum - 0.3f) * 2.5f, 0.0f), 1.0f);
+    return h * h;
+}
+
+static float world_height(float x, float z, void* user_data) {
+    (void)user_data;
+    return terrain_height(x, z) * HEIGHT_SCALE;
+}
+
+// the height detail which the min/max samples can miss: the amplitudes of the
+// octaves finer than 4 min/max cells, times the steepest slope of the shaping
+static float height_margin(void) {
+    const float cell = TERRAIN_SIZE / CDLOD_MINMAX_DIM;
+    float spacing = FEATURE_SIZE;
+    float amp = 0.5f;
+    float detail = 0.0f;
+    for (int i = 0; i < NUM_OCTAVES; i++) {
+        if (spacing < 4.0f * cell) {
+            detail += amp;
+        }
+        spacing *= 0.5f;
+        amp *= 0.5f;
+    }
+    return detail * 5.0f * HEIGHT_SCALE;
+}
+
+static void init(void) {
+    sg_setup(&(sg_desc){
+        .environment = sglue_environment(),
+        .logger.func = slog_func,
+    });
+    sdtx_setup(&(sdtx_desc_t){
+        .fonts[0] = sdtx_font_oric(),
+        .logger.func = slog_func,
+    });
+    __dbgui_setup(sapp_sample_count());
+    cdlod_init(&state.terrain, &(cdlod_desc_t){
+        .size = TERRAIN_SIZE,
+        .num_levels = TERRAIN_LEVELS,
+        .height = world_height,
+        .margin = height_margin(),
+    });
+    state.altitude = 100.0f;
+    state.pixel_size = 4.0f;
+    // the tile viewports are placed in texel rows, which count from the bottom in GL
+    state.origin_top_left = (sg_query_backend() != SG_BACKEND_GLCORE) && (sg_query_backend() != SG_BACKEND_GLES3);
+
+    // the tile atlas, one slot per tile cache slot, heights are 16 bits in RG8
+    assert((ATLAS_SLOTS_PER_ROW * ATLAS_SLOTS_PER_ROW) == CDLOD_CACHE_SLOTS);
+    sg_image atlas = sg_make_image(&(sg_image_desc){
+        .usage.color_attachment = true,
+        .width = ATLAS_SIZE,
+        .height = ATLAS_SIZE,
+        .pixel_format = SG_PIXELFORMAT_RG8,
+        .sample_count = 1,
+        .label = "tile-atlas",
+    });
+    state.tiles.att_view = sg_make_view(&(sg_view_desc){
+        .color_attachment = { .image = atlas },
+        .label = "tile-atlas-attachment",
+    });
+
+    // renders a fullscreen triangle into the viewport of a tile slot
+    state.tiles.pip = sg_make_pipeline(&(sg_pipeline_desc){
+        .shader = sg_make_shader(tile_shader_desc(sg_query_backend())),
+        .colors[0].pixel_format = SG_PIXELFORMAT_RG8,
+        .depth.pixel_format = SG_PIXELFORMAT_NONE,
+        .sample_count = 1,
+        .label = "tile-pipeline",
+    });
+
+    // the grid patch indices, the vertices are synthesized in the vertex shader
+    uint16_t* indices = malloc(PATCH_INDICES * sizeof(uint16_t));
+    uint16_t* ptr = indices;
+    for (int z = 0; z < PATCH_SIZE; z++) {
+        for (int x = 0; x < PATCH_SIZE; x++) {
+            const uint16_t i0 = (uint16_t)(z * (PATCH_SIZE + 1) + x);
+            const uint16_t i1 = i0 + 1;
+            const uint16_t i2 = i0 + PATCH_SIZE + 1;
+            const uint16_t i3 = i2 + 1;
+            *ptr++ = i0; *ptr++ = i1; *ptr++ = i3;
+            *ptr++ = i0; *ptr++ = i3; *ptr++ = i2;
+        }
+    }
+    state.display.bind = (sg_bindings){
+        .index_buffer = sg_make_buffer(&(sg_buffer_desc){
+            .usage.index_buffer = true,
+            .data = { .ptr = indices, .size = PATCH_INDICES * sizeof(uint16_t) },
+            .label = "patch-indices",
+        }),
+        .vertex_buffers[0] = sg_make_buffer(&(sg_buffer_desc){
+            .usage.stream_update = true,
+            .size = sizeof(state.instances),
+            .label = "node-instances",
+        }),
+        .views[VIEW_height_tex] = sg_make_view(&(sg_view_desc){
+            .texture = { .image = atlas },
+            .label = "tile-atlas-view",
+        }),
+        .samplers[SMP_height_smp] = sg_make_sampler(&(sg_sampler_desc){
+            .min_filter = SG_FILTER_NEAREST,
+            .mag_filter = SG_FILTER_NEAREST,
+            .wrap_u = SG_WRAP_CLAMP_TO_EDGE,
+            .wrap_v = SG_WRAP_CLAMP_TO_EDGE,
+            .label = "tile-atlas-sampler",
+        }),
+    };
+    free(indices);
+
+    state.display.pip = sg_make_pipeline(&(sg_pipeline_desc){
+        .layout = {
+            .buffers[0] = { .stride = sizeof(instance_t), .step_func = SG_VERTEXSTEP_PER_INSTANCE },
+            .attrs = {
+                [ATTR_terrain_inst_node] = { .format = SG_VERTEXFORMAT_FLOAT4, .offset = offsetof(instance_t, node) },
+                [ATTR_terrain_inst_morph] = { .format = SG_VERTEXFORMAT_FLOAT4, .offset = offsetof(instance_t, morph) },
+            },
+        },
+        .shader = sg_make_shader(terrain_shader_desc(sg_query_backend())),
+        .index_type = SG_INDEXTYPE_UINT16,
+        // the patch triangles are clockwise seen from above
+        .face_winding = SG_FACEWINDING_CW,
+        .cull_mode = SG_CULLMODE_BACK,
+        .depth = {
+            .compare = SG_COMPAREFUNC_LESS_EQUAL,
+            .write_enabled = true,
+        },
+        .label = "terrain-pipeline",
+    });
+    state.display.pass_action = (sg_pass_action){
+        .colors[0] = { .load_action = SG_LOADACTION_CLEAR, .clear_value = { 0.6f, 0.7f, 0.8f, 1.0f } },
+    };
+}
+
+// render up to TILES_PER_FRAME of the tiles requested by the last selection into the atlas
+static void stream_tiles(void) {
+    cdlod_t* t = &state.terrain;
+    state.stats.streamed = 0;
+    for (int i = 0; (i < t->num_requests) && (state.stats.streamed < TILES_PER_FRAME); i++) {
+        const uint32_t key = t->requests[i];
+        const int slot = cdlod_alloc_tile(t, key);
+        if (slot == -1) {
+            // all slots are in use by the current selection
+            break;
+        }
+        if (state.stats.streamed == 0) {
+            sg_begin_pass(&(sg_pass){
+                .action.colors[0].load_action = SG_LOADACTION_LOAD,
+                .attachments.colors[0] = state.tiles.att_view,
+                .label = "tile-pass",
+            });
+            sg_apply_pipeline(state.tiles.pip);
+        }
+        const float size = cdlod_node_size(t, cdlod_key_level(key));
+        const float spacing = size / PATCH_SIZE;
+        const int sx = (slot % ATLAS_SLOTS_PER_ROW) * TILE_TEXELS;
+        const int sy = (slot / ATLAS_SLOTS_PER_ROW) * TILE_TEXELS;
+        sg_apply_viewport(sx, sy, TILE_TEXELS, TILE_TEXELS, state.origin_top_left);
+        const tile_params_t params = {
+            .slot_origin = vec4((float)sx, (float)sy, 0.0f, 0.0f),
+            .world_origin = vec4(cdlod_key_x(key) * size - spacing, cdlod_key_z(key) * size - spacing, spacing, 0.0f),
+        };
+        sg_apply_uniforms(UB_tile_params, &SG_RANGE(params));
+        sg_draw(0, 3, 1);
+        state.stats.streamed++;
+    }
+    if (state.stats.streamed > 0) {
+        sg_end_pass();
+    }
+    state.stats.total_streamed += state.stats.streamed;
+}
+
+static void frame(void) {
+    const float dt = (float)sapp_frame_duration();
+    state.time += dt;
+    if (!state.paused) {
+        state.cam_angle += dt * 0.02f;
+    }
+
+    // the camera flies along a circle around the terrain center, above the ground ahead
+    const float center = TERRAIN_SIZE * 0.5f;
+    const vec3_t forward = vm_normalize(vec3(vm_cos(state.cam_angle), -0.15f, -vm_sin(state.cam_angle)));
+    vec3_t eye_pos = vec3(center + vm_sin(state.cam_angle) * CAMERA_PATH_RADIUS, 0.0f, center + vm_cos(state.cam_angle) * CAMERA_PATH_RADIUS);
+    const float ground = fmaxf(world_height(eye_pos.x, eye_pos.z, 0), world_height(eye_pos.x + forward.x * 300.0f, eye_pos.z + forward.z * 300.0f, 0));
+    eye_pos.y = ground + state.altitude;
+    const float aspect = sapp_widthf() / sapp_heightf();
+    const mat44_t view = mat44_look_at_rh(eye_pos, vec3_add(eye_pos, forward), vec3(0.0f, 1.0f, 0.0f));
+    const mat44_t proj = mat44_perspective_fov_rh(vm_radians(CAMERA_FOV), aspect, CAMERA_NEARZ, CAMERA_FARZ);
+    const mat44_t view_proj = vm_mul(view, proj);
+
+    // the distance at which a quad of the finest level is pixel_size pixels high on screen,
+    // each coarser level doubles both the quad size and the distance
+    const float leaf_quad = cdlod_node_size(&state.terrain, 0) / PATCH_SIZE;
+    const float leaf_range = leaf_quad * sapp_heightf() / (2.0f * tanf(vm_radians(CAMERA_FOV) * 0.5f) * state.pixel_size);
+    cdlod_set_ranges(&state.terrain, leaf_range);
+    if (!state.frozen) {
+        state.cull_view.eye_pos = eye_pos;
+        frustum_planes(&view_proj, state.cull_view.planes);
+    }
+    cdlod_select(&state.terrain, &state.cull_view);
+    stream_tiles();
+
+    memset(state.stats.per_level, 0, sizeof(state.stats.per_level));
+    const int num_nodes = state.terrain.num_selected;
+    for (int i = 0; i < num_nodes; i++) {
+        const cdlod_node_t* n = &state.terrain.selected[i];
+        state.instances[i] = (instance_t){
+            .node = vec4(n->x, n->z, n->size, (float)n->slot),
+            .morph = vec4(n->morph_start, n->morph_end, (float)n->level, 0.0f),
+        };
+        state.stats.per_level[n->level]++;
+    }
+    if (num_nodes > 0) {
+        sg_update_buffer(state.display.bind.vertex_buffers[0], &(sg_range){ .ptr = state.instances, .size = (size_t)num_nodes * sizeof(instance_t) });
+    }
+
+    // the morph factor must use the same eye position as the selection
+    const vec3_t lod_eye = state.cull_view.eye_pos;
+    const vs_params_t vs_params = {
+        .view_proj = view_proj,
+        .eye_pos = vec4(lod_eye.x, lod_eye.y, lod_eye.z, 1.0f),
+        .height_scale = HEIGHT_SCALE,
+        .slots_per_row = ATLAS_SLOTS_PER_ROW,
+    };
+    const fs_params_t fs_params = {
+        .light_dir = vec4(0.5f, 0.6f, 0.3f, 0.0f),
+        .fog_color = vec4(0.6f, 0.7f, 0.8f, 1.0f / 12000.0f),
+        .show_lods = state.show_lods ? 1 : 0,
+    };
+
+    sdtx_canvas(sapp_widthf() * 0.5f, sapp_heightf() * 0.5f);
+    sdtx_origin(1.0f, 1.0f);
+    sdtx_printf("pause (P): %s, freeze (F): %s, tint (T)\n", state.paused ? "on" : "off", state.frozen ? "on" : "off");
+    sdtx_printf("triangle size (LEFT/RIGHT): %.0f px\n", state.pixel_size);
+    sdtx_printf("altitude (UP/DOWN):         %.0f m\n\n", state.altitude);
+    sdtx_printf("nodes:     %d (%d triangles)\n", num_nodes, num_nodes * PATCH_SIZE * PATCH_SIZE * 2);
+    sdtx_printf("per level:");
+    for (int i = 0; i < TERRAIN_LEVELS; i++) {
+        sdtx_printf(" %d", state.stats.per_level[i]);
+    }
+    sdtx_printf("\nleaf range: %.0f m\n", state.terrain.ranges[0]);
+    sdtx_printf("tiles:     %d resident, %d streamed, %d pending\n", state.terrain.num_resident, state.stats.streamed, state.terrain.num_requests);
+    sdtx_printf("streamed:  %d total\n", state.stats.total_streamed);
+
+    sg_begin_pass(&(sg_pass){ .action = state.display.pass_action, .swapchain = sglue_swapchain() });
+    if (num_nodes > 0) {
+        sg_apply_pipeline(state.display.pip);
+        sg_apply_bindings(&state.display.bind);
+        sg_apply_uniforms(UB_vs_params, &SG_RANGE(vs_params));
+        sg_apply_uniforms(UB_fs_params, &SG_RANGE(fs_params));
+        sg_draw(0, PATCH_INDICES, num_nodes);
+    }
+    sdtx_draw();
+    __dbgui_draw();
+    sg_end_pass();
+    sg_commit();
+}
+
+static void input(const sapp_event* ev) {
+    if (ev->type == SAPP_EVENTTYPE_KEY_DOWN) {
+        switch (ev->key_code) {
+            case SAPP_KEYCODE_P:
+                state.paused = !state.paused;
+                break;
+            case SAPP_KEYCODE_F:
+                state.frozen = !state.frozen;
+                break;
+            case SAPP_KEYCODE_T:
+                state.show_lods = !state.show_lods;
+                break;
+            case SAPP_KEYCODE_UP:
+                state.altitude = fminf(state.altitude * 1.5f, 3000.0f);
+                break;
+            case SAPP_KEYCODE_DOWN:
+                state.altitude = fmaxf(state.altitude / 1.5f, 10.0f);
+                break;
+            case SAPP_KEYCODE_LEFT:
+                state.pixel_size = fmaxf(state.pixel_size - 1.0f, 2.0f);
+                break;
+            case SAPP_KEYCODE_RIGHT:
+                state.pixel_size = fminf(state.pixel_size + 1.0f, 16.0f);
+                break;
+            default:
+                break;
+        }
+    }
+    __dbgui_event(ev);
+}
+
+static void cleanup(void) {
+    __dbgui_shutdown();
+    sdtx_shutdown();
+    sg_shutdown();
+}
+
+sapp_desc sokol_main(int argc, char* argv[]) {
+    (void)argc; (void)argv;
+    return (sapp_desc){
+        .init_cb = init,
+        .frame_cb = frame,
+        .cleanup_cb = cleanup,
+        .event_cb = input,
+        .width = 1024,
+        .height = 768,
+        .sample_count = 4,
+        .window_title = "terrain-sapp",
+        .icon.sokol_default = true,
+        .logger.func = slog_func,
+    };
+}
@@ -0,0 +1,183 @@
+@ctype mat4 mat44_t
+@ctype vec4 vec4_t
+
+// the height function, a value noise fBm (this must match terrain_height() in terrain-sapp.c)
+@block height_func
+const float FEATURE_SIZE = 4096.0;
+const int NUM_OCTAVES = 12;
+
+float lattice(ivec2 p, int octave) {
+    uint h = uint(p.x) * 0x8da6b343u ^ uint(p.y) * 0xd8163841u ^ uint(octave) * 0xcb1ab31fu;
+    h ^= h >> 16;
+    h *= 0x7feb352du;
+    h ^= h >> 15;
+    h *= 0x846ca68bu;
+    h ^= h >> 16;
+    return float(h & 0xFFFFFFu) / 16777215.0;
+}
+
+float value_noise(vec2 p, int octave) {
+    const vec2 i = floor(p);
+    const vec2 f = p - i;
+    const vec2 u = f * f * (3.0 - 2.0 * f);
+    const ivec2 c = ivec2(i);
+    const float a = lattice(c, octave);
+    const float b = lattice(c + ivec2(1, 0), octave);
+    const float d = lattice(c + ivec2(0, 1), octave);
+    const float e = lattice(c + ivec2(1, 1), octave);
+    return mix(mix(a, b, u.x), mix(d, e, u.x), u.y);
+}
+
+// normalized height 0..1 at a world space xz position
+float terrain_height(vec2 pos) {
+    vec2 p = pos / FEATURE_SIZE;
+    float sum = 0.0;
+    float amp = 0.5;
+    for (int i = 0; i < NUM_OCTAVES; i++) {
+        sum += value_noise(p, i) * amp;
+        p *= 2.0;
+        amp *= 0.5;
+    }
+    // flat valleys and steep peaks
+    const float h = clamp((sum - 0.3) * 2.5, 0.0, 1.0);
+    return h * h;
+}
+@end
+
+//=== renders the heights of one tile into its slot of the tile atlas
+@vs vs_tile
+const vec2 positions[3] = { vec2(-1, -1), vec2(3, -1), vec2(-1, 3), };
+
+void main() {
+    gl_Position = vec4(positions[gl_VertexIndex], 0, 1);
+}
+@end
+
+@fs fs_tile
+@include_block height_func
+
+layout(binding=0) uniform tile_params {
+    vec4 slot_origin;   // xy: first texel of the slot in the atlas
+    vec4 world_origin;  // xy: world space xz of the slot's first texel, z: texel spacing
+};
+
+out vec4 frag_color;
+
+void main() {
+    const vec2 texel = floor(gl_FragCoord.xy) - slot_origin.xy;
+    const float h = terrain_height(world_origin.xy + texel * world_origin.z);
+    // 16-bit height in the red (high byte) and green (low byte) channel
+    const float v = floor(h * 65535.0 + 0.5);
+    const float hi = floor(v / 256.0);
+    frag_color = vec4(hi / 255.0, (v - hi * 256.0) / 255.0, 0.0, 1.0);
+}
+@end
+
+@program tile vs_tile fs_tile
+
+//=== renders the selected quadtree nodes as instances of one grid patch
+@vs vs_terrain
+// grid quads along the patch edge, and tile texels along the edge (1 texel border on each side),
+// these must match PATCH_SIZE and TILE_TEXELS in terrain-sapp.c
+const int PATCH_SIZE = 32;
+const int TILE_TEXELS = PATCH_SIZE + 3;
+
+layout(binding=0) uniform vs_params {
+    mat4 view_proj;
+    vec4 eye_pos;
+    float height_scale;
+    int slots_per_row;
+};
+layout(binding=0) uniform texture2D height_tex;
+layout(binding=0) uniform sampler height_smp;
+
+in vec4 inst_node;      // xy: min corner xz, z: size, w: tile slot
+in vec4 inst_morph;     // x: morph start, y: morph end, z: level
+
+out vec3 normal;
+out float height;
+out float view_dist;
+out float lod;
+
+float fetch_height(ivec2 texel) {
+    const vec2 rg = texelFetch(sampler2D(height_tex, height_smp), texel, 0).xy;
+    return (rg.x * 65280.0 + rg.y * 255.0) / 65535.0;
+}
+
+// bilinear filtered height at a grid position in -1..PATCH_SIZE+1
+float sample_height(ivec2 base, vec2 grid) {
+    const vec2 t = grid + 1.0;
+    const vec2 i = floor(t);
+    const vec2 f = t - i;
+    const ivec2 p0 = base + ivec2(i);
+    const ivec2 p1 = base + min(ivec2(i) + 1, ivec2(TILE_TEXELS - 1));
+    const float h00 = fetch_height(p0);
+    const float h10 = fetch_height(ivec2(p1.x, p0.y));
+    const float h01 = fetch_height(ivec2(p0.x, p1.y));
+    const float h11 = fetch_height(p1);
+    return mix(mix(h00, h10, f.x), mix(h01, h11, f.x), f.y);
+}
+
+void main() {
+    // grid coords from the vertex index, there's no vertex buffer
+    const vec2 grid = vec2(gl_VertexIndex % (PATCH_SIZE + 1), gl_VertexIndex / (PATCH_SIZE + 1));
+    const int slot = int(inst_node.w);
+    const ivec2 base = ivec2(slot % slots_per_row, slot / slots_per_row) * TILE_TEXELS;
+    const float spacing = inst_node.z / float(PATCH_SIZE);
+
+    // the morph factor comes from the distance of the unmorphed vertex, odd
+    // grid vertices then slide onto their even neighbours, which are the
+    // vertices of the next coarser level
+    const vec3 grid_pos = vec3(inst_node.x + grid.x * spacing, fetch_height(base + ivec2(grid) + 1) * height_scale, inst_node.y + grid.y * spacing);
+    const float k = clamp((distance(grid_pos, eye_pos.xyz) - inst_morph.x) / (inst_morph.y - inst_morph.x), 0.0, 1.0);
+    const vec2 morphed = grid - fract(grid * 0.5) * 2.0 * k;
+
+    height = sample_height(base, morphed);
+    const vec3 pos = vec3(inst_node.x + morphed.x * spacing, height * height_scale, inst_node.y + morphed.y * spacing);
+    const float hl = sample_height(base, morphed - vec2(1.0, 0.0));
+    const float hr = sample_height(base, morphed + vec2(1.0, 0.0));
+    const float hd = sample_height(base, morphed - vec2(0.0, 1.0));
+    const float hu = sample_height(base, morphed + vec2(0.0, 1.0));
+    normal = vec3((hl - hr) * height_scale, 2.0 * spacing, (hd - hu) * height_scale);
+    view_dist = distance(pos, eye_pos.xyz);
+    lod = inst_morph.z + k;
+    gl_Position = view_proj * vec4(pos, 1.0);
+}
+@end
+
+@fs fs_terrain
+layout(binding=1) uniform fs_params {
+    vec4 light_dir;
+    vec4 fog_color;     // w: fog density
+    int show_lods;
+};
+
+in vec3 normal;
+in float height;
+in float view_dist;
+in float lod;
+out vec4 frag_color;
+
+void main() {
+    const vec3 lod_colors[6] = {
+        vec3(1.0, 0.5, 0.5), vec3(0.5, 1.0, 0.5), vec3(0.5, 0.5, 1.0),
+        vec3(1.0, 1.0, 0.5), vec3(0.5, 1.0, 1.0), vec3(1.0, 0.5, 1.0),
+    };
+    const vec3 n = normalize(normal);
+    const float slope = 1.0 - n.y;
+    // grass, rock on steep slopes, snow on flat high ground
+    vec3 c = mix(vec3(0.25, 0.4, 0.15), vec3(0.45, 0.4, 0.35), smoothstep(0.15, 0.35, slope));
+    c = mix(c, vec3(0.95), smoothstep(0.45, 0.55, height) * (1.0 - smoothstep(0.3, 0.5, slope)));
+    if (show_lods != 0) {
+        // blend between the level colors while morphing
+        const int l = int(lod);
+        c *= mix(lod_colors[l % 6], lod_colors[(l + 1) % 6], fract(lod));
+    }
+    const float diffuse = max(dot(n, normalize(light_dir.xyz)), 0.0);
+    c *= 0.3 + 0.7 * diffuse;
+    const float fog = 1.0 - exp(-view_dist * fog_color.w);
+    frag_color = vec4(mix(c, fog_color.xyz, fog), 1.0);
+}
+@end
+
+@program terrain vs_terrain fs_terrain
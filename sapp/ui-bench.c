@@ -0,0 +1,567 @@
+//------------------------------------------------------------------------------
+//  ui-bench.c
+//
+//  Headless stress benchmark for the UI rendering backends:
+//
+//  - Dear ImGui via sokol_imgui.h
+//  - Nuklear via sokol_nuklear.h
+//  - microui via sokol_gl.h
+//
+//  Each backend builds the same widget load (a grid of windows with labels,
+//  buttons, checkboxes, sliders and a text paragraph) under the same scripted
+//  mouse input for a number of frames. Rendering goes through the sokol-gfx
+//  dummy backend, so only CPU cost is measured.
+//
+//  Per frame, the CPU time is split into:
+//
+//  - build:    building the UI (widget functions)
+//  - convert:  finalizing the UI into vertex data, up to the first buffer update
+//  - update:   from the first to the last vertex/index buffer update
+//  - draw:     from the last buffer update to the end of the render call
+//
+//  The phase boundaries inside the backends' render functions are found
+//  with sokol-gfx trace hooks, which also count the uploaded bytes and
+//  draw calls. Note that trace hooks are called at the end of a sokol-gfx
+//  call, so the first buffer update itself is accounted to 'convert'
+//  (with the dummy backend the update cost is negligible).
+//
+//  Output is a JSON document on stdout.
+//
+//  Usage: ui-bench [num_frames] [num_windows]
+//------------------------------------------------------------------------------
+#if defined(_MSC_VER)
+#define _CRT_SECURE_NO_WARNINGS (1)
+#endif
+// always use the dummy backend, regardless of the build config
+#undef SOKOL_GLCORE
+#undef SOKOL_GLES3
+#undef SOKOL_D3D11
+#undef SOKOL_METAL
+#undef SOKOL_WGPU
+#define SOKOL_DUMMY_BACKEND
+#define SOKOL_TRACE_HOOKS
+#define SOKOL_IMPL
+#include "sokol_gfx.h"
+#include "sokol_time.h"
+#include "sokol_log.h"
+#define SOKOL_GL_IMPL
+#include "sokol_gl.h"
+#include "cimgui.h"
+#define SOKOL_IMGUI_IMPL
+#define SOKOL_IMGUI_NO_SOKOL_APP
+#include "sokol_imgui.h"
+#define NK_INCLUDE_FIXED_TYPES
+#define NK_INCLUDE_STANDARD_IO
+#define NK_INCLUDE_DEFAULT_ALLOCATOR
+#define NK_INCLUDE_VERTEX_BUFFER_OUTPUT
+#define NK_INCLUDE_FONT_BAKING
+#define NK_INCLUDE_DEFAULT_FONT
+#define NK_INCLUDE_STANDARD_VARARGS
+#include "nuklear/nuklear.h"
+#define SOKOL_NUKLEAR_IMPL
+#define SOKOL_NUKLEAR_NO_SOKOL_APP
+#include "sokol_nuklear.h"
+#include "microui/microui.h"
+#include "microui/atlas.inl"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define DEFAULT_NUM_FRAMES (600)
+#define DEFAULT_NUM_WINDOWS (16)
+#define DISPLAY_WIDTH (1920)
+#define DISPLAY_HEIGHT (1080)
+#define WINDOW_WIDTH (220)
+#define WINDOW_HEIGHT (260)
+#define WINDOWS_PER_ROW (8)
+#define NUM_BUTTONS (4)
+#define NUM_CHECKBOXES (2)
+#define NUM_SLIDERS (2)
+
+typedef enum {
+    PHASE_BUILD,
+    PHASE_CONVERT,
+    PHASE_UPDATE,
+    PHASE_DRAW,
+    NUM_PHASES,
+} phase_t;
+
+static const char* phase_names[NUM_PHASES] = { "build_us", "convert_us", "update_us", "draw_us" };
+
+typedef struct {
+    double phase_us[NUM_PHASES];
+    uint32_t bytes_uploaded;
+    uint32_t num_draws;
+} frame_stats_t;
+
+typedef struct {
+    const char* name;
+    void (*setup)(void);
+    void (*shutdown)(void);
+    void (*input)(float mouse_x, float mouse_y, bool mouse_down);
+    void (*build)(int frame);
+    void (*render)(void);
+} backend_t;
+
+static struct {
+    int num_frames;
+    int num_windows;
+    // widget state, shared by all backends
+    struct {
+        bool checks[NUM_CHECKBOXES];
+        float sliders[NUM_SLIDERS];
+    } win[256];
+    // trace hook state of the current render call
+    struct {
+        uint64_t first_update;
+        uint64_t last_update;
+        uint32_t bytes;
+        uint32_t draws;
+    } trace;
+    // nuklear input is fed inside the frame, see nuklear_build()
+    struct {
+        float x, y;
+        bool down;
+    } nk_input;
+    mu_Context mu_ctx;
+    sgl_pipeline mu_pip;
+    sg_image mu_img;
+    sg_view mu_view;
+    sg_sampler mu_smp;
+} state;
+
+static const char* paragraph =
+    "Lorem ipsum dolor sit amet, consectetur adipiscing elit. "
+    "Maecenas lacinia, sem eu lacinia molestie, mi risus faucibus ipsum.";
+
+//== trace hooks ===============================================================
+static void trace_buffer_update(const sg_range* data) {
+    const uint64_t now = stm_now();
+    if (state.trace.first_update == 0) {
+        state.trace.first_update = now;
+    }
+    state.trace.last_update = now;
+    state.trace.bytes += (uint32_t)data->size;
+}
+
+static void trace_update_buffer(sg_buffer buf, const sg_range* data, void* user_data) {
+    (void)buf; (void)user_data;
+    trace_buffer_update(data);
+}
+
+static void trace_append_buffer(sg_buffer buf, const sg_range* data, int result, void* user_data) {
+    (void)buf; (void)result; (void)user_data;
+    trace_buffer_update(data);
+}
+
+static void trace_draw(int base_element, int num_elements, int num_instances, void* user_data) {
+    (void)base_element; (void)num_elements; (void)num_instances; (void)user_data;
+    state.trace.draws++;
+}
+
+//== window layout and scripted input ==========================================
+static void window_rect(int i, int* x, int* y) {
+    *x = 10 + (i % WINDOWS_PER_ROW) * (WINDOW_WIDTH + 10);
+    *y = 10 + (i / WINDOWS_PER_ROW) * (WINDOW_HEIGHT + 10);
+}
+
+// the mouse sweeps over the display, with a click every 30 frames
+static void scripted_input(int frame, float* x, float* y, bool* down) {
+    const float t = (float)frame * 0.02f;
+    *x = DISPLAY_WIDTH * (0.5f + 0.45f * sinf(t * 1.3f));
+    *y = DISPLAY_HEIGHT * (0.5f + 0.45f * cosf(t * 0.7f));
+    *down = (frame % 30) < 2;
+}
+
+//== Dear ImGui ================================================================
+static void imgui_setup(void) {
+    simgui_setup(&(simgui_desc_t){ .logger.func = slog_func });
+}
+
+static void imgui_shutdown(void) {
+    simgui_shutdown();
+}
+
+static void imgui_input(float mouse_x, float mouse_y, bool mouse_down) {
+    simgui_add_mouse_pos_event(mouse_x, mouse_y);
+    simgui_add_mouse_button_event(0, mouse_down);
+}
+
+static void imgui_build(int frame) {
+    simgui_new_frame(&(simgui_frame_desc_t){
+        .width = DISPLAY_WIDTH,
+        .height = DISPLAY_HEIGHT,
+        .delta_time = 1.0 / 60.0,
+        .dpi_scale = 1.0f,
+    });
+    char name[32];
+    for (int i = 0; i < state.num_windows; i++) {
+        int x, y;
+        window_rect(i, &x, &y);
+        snprintf(name, sizeof(name), "Window %d", i);
+        igSetNextWindowPos((ImVec2){ (float)x, (float)y }, ImGuiCond_Once);
+        igSetNextWindowSize((ImVec2){ WINDOW_WIDTH, WINDOW_HEIGHT }, ImGuiCond_Once);
+        if (igBegin(name, 0, 0)) {
+            igText("Frame: %d", frame);
+            for (int b = 0; b < NUM_BUTTONS; b++) {
+                snprintf(name, sizeof(name), "Button %d", b);
+                igButton(name);
+            }
+            for (int c = 0; c < NUM_CHECKBOXES; c++) {
+                snprintf(name, sizeof(name), "Check %d", c);
+                igCheckbox(name, &state.win[i].checks[c]);
+            }
+            for (int s = 0; s < NUM_SLIDERS; s++) {
+                snprintf(name, sizeof(name), "Slider %d", s);
+                igSliderFloat(name, &state.win[i].sliders[s], 0.0f, 1.0f);
+            }
+            igText("%s", paragraph);
+        }
+        igEnd();
+    }
+}
+
+static void imgui_render(void) {
+    simgui_render();
+}
+
+//== Nuklear ===================================================================
+static void nuklear_setup(void) {
+    snk_setup(&(snk_desc_t){ .dpi_scale = 1.0f, .logger.func = slog_func });
+}
+
+static void nuklear_shutdown(void) {
+    snk_shutdown();
+}
+
+static void nuklear_input(float mouse_x, float mouse_y, bool mouse_down) {
+    state.nk_input.x = mouse_x;
+    state.nk_input.y = mouse_y;
+    state.nk_input.down = mouse_down;
+}
+
+static void nuklear_build(int frame) {
+    struct nk_context* ctx = snk_new_frame();
+    // sokol_nuklear.h has no input without sokol_app.h, feed the scripted input directly
+    nk_input_begin(ctx);
+    nk_input_motion(ctx, (int)state.nk_input.x, (int)state.nk_input.y);
+    nk_input_button(ctx, NK_BUTTON_LEFT, (int)state.nk_input.x, (int)state.nk_input.y, state.nk_input.down);
+    nk_input_end(ctx);
+
+    char name[32];
+    for (int i = 0; i < state.num_windows; i++) {
+        int x, y;
+        window_rect(i, &x, &y);
+        snprintf(name, sizeof(name), "Window %d", i);
+        const nk_flags flags = NK_WINDOW_BORDER | NK_WINDOW_MOVABLE | NK_WINDOW_TITLE;
+        if (nk_begin(ctx, name, nk_rect((float)x, (float)y, WINDOW_WIDTH, WINDOW_HEIGHT), flags)) {
+            nk_layout_row_dynamic(ctx, 20, 1);
+            nk_labelf(ctx, NK_TEXT_LEFT, "Frame: %d", frame);
+            for (int b = 0; b < NUM_BUTTONS; b++) {
+                snprintf(name, sizeof(name), "Button %d", b);
+                nk_button_label(ctx, name);
+            }
+            for (int c = 0; c < NUM_CHECKBOXES; c++) {
+                snprintf(name, sizeof(name), "Check %d", c);
+                nk_bool active = state.win[i].checks[c];
+                nk_checkbox_label(ctx, name, &active);
+                state.win[i].checks[c] = active;
+            }
+            for (int s = 0; s < NUM_SLIDERS; s++) {
+                nk_slider_float(ctx, 0.0f, &state.win[i].sliders[s], 1.0f, 0.01f);
+            }
+            nk_layout_row_dynamic(ctx, 40, 1);
+            nk_label_wrap(ctx, paragraph);
+        }
+        nk_end(ctx);
+    }
+}
+
+static void nuklear_render(void) {
+    snk_render(DISPLAY_WIDTH, DISPLAY_HEIGHT);
+}
+
+//== microui + sokol-gl ========================================================
+static int microui_text_width(mu_Font font, const char* text, int len) {
+    (void)font;
+    int res = 0;
+    for (const char* p = text; *p && len--; p++) {
+        res += atlas[ATLAS_FONT + (unsigned char)*p].w;
+    }
+    return res;
+}
+
+static int microui_text_height(mu_Font font) {
+    (void)font;
+    return 18;
+}
+
+static void microui_setup(void) {
+    sgl_setup(&(sgl_desc_t){
+        .max_vertices = 256 * 1024,
+        .max_commands = 16 * 1024,
+        .logger.func = slog_func,
+    });
+    uint32_t* pixels = (uint32_t*) malloc(ATLAS_WIDTH * ATLAS_HEIGHT * 4);
+    for (int i = 0; i < ATLAS_WIDTH * ATLAS_HEIGHT; i++) {
+        pixels[i] = 0x00FFFFFF | ((uint32_t)atlas_texture[i] << 24);
+    }
+    state.mu_img = sg_make_image(&(sg_image_desc){
+        .width = ATLAS_WIDTH,
+        .height = ATLAS_HEIGHT,
+        .data.subimage[0][0] = { .ptr = pixels, .size = ATLAS_WIDTH * ATLAS_HEIGHT * 4 },
+    });
+    free(pixels);
+    state.mu_view = sg_make_view(&(sg_view_desc){ .texture = { .image = state.mu_img } });
+    state.mu_smp = sg_make_sampler(&(sg_sampler_desc){ 0 });
+    state.mu_pip = sgl_make_pipeline(&(sg_pipeline_desc){
+        .colors[0].blend = {
+            .enabled = true,
+            .src_factor_rgb = SG_BLENDFACTOR_SRC_ALPHA,
+            .dst_factor_rgb = SG_BLENDFACTOR_ONE_MINUS_SRC_ALPHA,
+        },
+    });
+    mu_init(&state.mu_ctx);
+    state.mu_ctx.text_width = microui_text_width;
+    state.mu_ctx.text_height = microui_text_height;
+}
+
+static void microui_shutdown(void) {
+    sgl_destroy_pipeline(state.mu_pip);
+    sg_destroy_sampler(state.mu_smp);
+    sg_destroy_view(state.mu_view);
+    sg_destroy_image(state.mu_img);
+    sgl_shutdown();
+}
+
+static void microui_input(float mouse_x, float mouse_y, bool mouse_down) {
+    static bool was_down;
+    mu_input_mousemove(&state.mu_ctx, (int)mouse_x, (int)mouse_y);
+    if (mouse_down && !was_down) {
+        mu_input_mousedown(&state.mu_ctx, (int)mouse_x, (int)mouse_y, MU_MOUSE_LEFT);
+    } else if (!mouse_down && was_down) {
+        mu_input_mouseup(&state.mu_ctx, (int)mouse_x, (int)mouse_y, MU_MOUSE_LEFT);
+    }
+    was_down = mouse_down;
+}
+
+static void microui_build(int frame) {
+    mu_Context* ctx = &state.mu_ctx;
+    mu_begin(ctx);
+    char name[32];
+    for (int i = 0; i < state.num_windows; i++) {
+        int x, y;
+        window_rect(i, &x, &y);
+        snprintf(name, sizeof(name), "Window %d", i);
+        if (mu_begin_window(ctx, name, mu_rect(x, y, WINDOW_WIDTH, WINDOW_HEIGHT))) {
+            mu_layout_row(ctx, 1, (int[]) { -1 }, 0);
+            snprintf(name, sizeof(name), "Frame: %d", frame);
+            mu_label(ctx, name);
+            for (int b = 0; b < NUM_BUTTONS; b++) {
+                snprintf(name, sizeof(name), "Button %d", b);
+                mu_button(ctx, name);
+            }
+            for (int c = 0; c < NUM_CHECKBOXES; c++) {
+                snprintf(name, sizeof(name), "Check %d", c);
+                int active = state.win[i].checks[c];
+                mu_checkbox(ctx, name, &active);
+                state.win[i].checks[c] = active;
+            }
+            for (int s = 0; s < NUM_SLIDERS; s++) {
+                mu_slider(ctx, &state.win[i].sliders[s], 0.0f, 1.0f);
+            }
+            mu_text(ctx, paragraph);
+            mu_end_window(ctx);
+        }
+    }
+    mu_end(ctx);
+}
+
+static void microui_push_quad(mu_Rect dst, mu_Rect src, mu_Color color) {
+    const float u0 = (float)src.x / ATLAS_WIDTH;
+    const float v0 = (float)src.y / ATLAS_HEIGHT;
+    const float u1 = (float)(src.x + src.w) / ATLAS_WIDTH;
+    const float v1 = (float)(src.y + src.h) / ATLAS_HEIGHT;
+    const float x0 = (float)dst.x;
+    const float y0 = (float)dst.y;
+    const float x1 = (float)(dst.x + dst.w);
+    const float y1 = (float)(dst.y + dst.h);
+    sgl_c4b(color.r, color.g, color.b, color.a);
+    sgl_v2f_t2f(x0, y0, u0, v0);
+    sgl_v2f_t2f(x1, y0, u1, v0);
+    sgl_v2f_t2f(x1, y1, u1, v1);
+    sgl_v2f_t2f(x0, y1, u0, v1);
+}
+
+static void microui_render(void) {
+    sgl_defaults();
+    sgl_push_pipeline();
+    sgl_load_pipeline(state.mu_pip);
+    sgl_enable_texture();
+    sgl_texture(state.mu_view, state.mu_smp);
+    sgl_matrix_mode_projection();
+    sgl_ortho(0.0f, DISPLAY_WIDTH, DISPLAY_HEIGHT, 0.0f, -1.0f, +1.0f);
+    sgl_begin_quads();
+    mu_Command* cmd = 0;
+    while (mu_next_command(&state.mu_ctx, &cmd)) {
+        switch (cmd->type) {
+            case MU_COMMAND_TEXT: {
+                mu_Rect dst = { cmd->text.pos.x, cmd->text.pos.y, 0, 0 };
+                for (const char* p = cmd->text.str; *p; p++) {
+                    const mu_Rect src = atlas[ATLAS_FONT + (unsigned char)*p];
+                    dst.w = src.w;
+                    dst.h = src.h;
+                    microui_push_quad(dst, src, cmd->text.color);
+                    dst.x += dst.w;
+                }
+            } break;
+            case MU_COMMAND_RECT:
+                microui_push_quad(cmd->rect.rect, atlas[ATLAS_WHITE], cmd->rect.color);
+                break;
+            case MU_COMMAND_ICON: {
+                const mu_Rect src = atlas[cmd->icon.id];
+                const int x = cmd->icon.rect.x + (cmd->icon.rect.w - src.w) / 2;
+                const int y = cmd->icon.rect.y + (cmd->icon.rect.h - src.h) / 2;
+                microui_push_quad(mu_rect(x, y, src.w, src.h), src, cmd->icon.color);
+            } break;
+            case MU_COMMAND_CLIP:
+                sgl_end();
+                sgl_scissor_rect(cmd->clip.rect.x, cmd->clip.rect.y, cmd->clip.rect.w, cmd->clip.rect.h, true);
+                sgl_begin_quads();
+                break;
+        }
+    }
+    sgl_end();
+    sgl_pop_pipeline();
+    sgl_draw();
+}
+
+//== benchmark driver ==========================================================
+static const backend_t backends[] = {
+    { "imgui", imgui_setup, imgui_shutdown, imgui_input, imgui_build, imgui_render },
+    { "nuklear", nuklear_setup, nuklear_shutdown, nuklear_input, nuklear_build, nuklear_render },
+    { "microui", microui_setup, microui_shutdown, microui_input, microui_build, microui_render },
+};
+#define NUM_BACKENDS ((int)(sizeof(backends) / sizeof(backends[0])))
+
+static void run_frame(const backend_t* backend, int frame, frame_stats_t* stats) {
+    float mouse_x, mouse_y;
+    bool mouse_down;
+    scripted_input(frame, &mouse_x, &mouse_y, &mouse_down);
+    backend->input(mouse_x, mouse_y, mouse_down);
+
+    const uint64_t t0 = stm_now();
+    backend->build(frame);
+    const uint64_t t1 = stm_now();
+
+    memset(&state.trace, 0, sizeof(state.trace));
+    sg_begin_pass(&(sg_pass){
+        .action.colors[0].load_action = SG_LOADACTION_CLEAR,
+        .swapchain = {
+            .width = DISPLAY_WIDTH,
+            .height = DISPLAY_HEIGHT,
+            .sample_count = 1,
+            .color_format = SG_PIXELFORMAT_RGBA8,
+            .depth_format = SG_PIXELFORMAT_DEPTH_STENCIL,
+        },
+    });
+    const uint64_t t2 = stm_now();
+    backend->render();
+    const uint64_t t3 = stm_now();
+    sg_end_pass();
+    sg_commit();
+
+    // without buffer updates, everything inside the render call counts as conversion
+    const uint64_t first_update = state.trace.first_update ? state.trace.first_update : t3;
+    const uint64_t last_update = state.trace.last_update ? state.trace.last_update : t3;
+    stats->phase_us[PHASE_BUILD] = stm_us(stm_diff(t1, t0));
+    stats->phase_us[PHASE_CONVERT] = stm_us(stm_diff(first_update, t2));
+    stats->phase_us[PHASE_UPDATE] = stm_us(stm_diff(last_update, first_update));
+    stats->phase_us[PHASE_DRAW] = stm_us(stm_diff(t3, last_update));
+    stats->bytes_uploaded = state.trace.bytes;
+    stats->num_draws = state.trace.draws;
+}
+
+static int compare_double(const void* a, const void* b) {
+    const double da = *(const double*)a;
+    const double db = *(const double*)b;
+    return (da < db) ? -1 : ((da > db) ? 1 : 0);
+}
+
+static void print_summary(const frame_stats_t* frames, int num_frames) {
+    double* values = (double*) malloc((size_t)num_frames * sizeof(double));
+    printf("      \"summary\": {\n");
+    for (int p = 0; p < NUM_PHASES; p++) {
+        double sum = 0.0;
+        for (int i = 0; i < num_frames; i++) {
+            values[i] = frames[i].phase_us[p];
+            sum += values[i];
+        }
+        qsort(values, (size_t)num_frames, sizeof(double), compare_double);
+        printf("        \"%s\": { \"mean\": %.3f, \"median\": %.3f, \"p95\": %.3f, \"max\": %.3f },\n",
+            phase_names[p], sum / num_frames, values[num_frames / 2], values[(num_frames * 95) / 100], values[num_frames - 1]);
+    }
+    double bytes = 0.0, draws = 0.0;
+    for (int i = 0; i < num_frames; i++) {
+        bytes += frames[i].bytes_uploaded;
+        draws += frames[i].num_draws;
+    }
+    printf("        \"bytes_uploaded\": { \"mean\": %.1f },\n", bytes / num_frames);
+    printf("        \"num_draws\": { \"mean\": %.1f }\n", draws / num_frames);
+    printf("      },\n");
+    free(values);
+}
+
+int main(int argc, char* argv[]) {
+    state.num_frames = (argc > 1) ? atoi(argv[1]) : DEFAULT_NUM_FRAMES;
+    state.num_windows = (argc > 2) ? atoi(argv[2]) : DEFAULT_NUM_WINDOWS;
+    if ((state.num_frames < 1) || (state.num_windows < 1) || (state.num_windows > 256)) {
+        fprintf(stderr, "usage: ui-bench [num_frames] [num_windows (1..256)]\n");
+        return 10;
+    }
+    stm_setup();
+    sg_setup(&(sg_desc){
+        .environment.defaults = {
+            .color_format = SG_PIXELFORMAT_RGBA8,
+            .depth_format = SG_PIXELFORMAT_DEPTH_STENCIL,
+            .sample_count = 1,
+        },
+        .logger.func = slog_func,
+    });
+    sg_install_trace_hooks(&(sg_trace_hooks){
+        .update_buffer = trace_update_buffer,
+        .append_buffer = trace_append_buffer,
+        .draw = trace_draw,
+    });
+
+    frame_stats_t* frames = (frame_stats_t*) calloc((size_t)state.num_frames, sizeof(frame_stats_t));
+    printf("{\n  \"num_frames\": %d,\n  \"num_windows\": %d,\n", state.num_frames, state.num_windows);
+    printf("  \"columns\": [ \"%s\", \"%s\", \"%s\", \"%s\", \"bytes_uploaded\", \"num_draws\" ],\n",
+        phase_names[0], phase_names[1], phase_names[2], phase_names[3]);
+    printf("  \"backends\": [\n");
+    for (int bi = 0; bi < NUM_BACKENDS; bi++) {
+        const backend_t* backend = &backends[bi];
+        memset(state.win, 0, sizeof(state.win));
+        backend->setup();
+        for (int i = 0; i < state.num_frames; i++) {
+            run_frame(backend, i, &frames[i]);
+        }
+        backend->shutdown();
+
+        printf("    {\n      \"name\": \"%s\",\n", backend->name);
+        print_summary(frames, state.num_frames);
+        printf("      \"frames\": [\n");
+        for (int i = 0; i < state.num_frames; i++) {
+            const frame_stats_t* f = &frames[i];
+            printf("        [ %.3f, %.3f, %.3f, %.3f, %u, %u ]%s\n",
+                f->phase_us[PHASE_BUILD], f->phase_us[PHASE_CONVERT], f->phase_us[PHASE_UPDATE], f->phase_us[PHASE_DRAW],
+                f->bytes_uploaded, f->num_draws, (i < (state.num_frames - 1)) ? "," : "");
+        }
+        printf("      ]\n    }%s\n", (bi < (NUM_BACKENDS - 1)) ? "," : "");
+    }
+    printf("  ]\n}\n");
+    free(frames);
+    sg_shutdown();
+    return 0;
+}